@@ -0,0 +1,242 @@
+/*
+*	aggregate.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "aggregate.h"
+
+#define HIST_EXACT      16    // Values below this get a bin each
+#define HIST_SUB_BITS   3     // 2^3 = 8 bins per power of two above that
+
+
+/* Function prototypes */
+static uint16_t hist_bin(uint16_t value);
+static uint16_t hist_value(uint16_t bin);
+static void reset_window(agg_window_t *window);
+
+
+/*
+* @brief Sets up an empty window. See aggregate.h.
+*/
+void agg_init(agg_window_t *window, uint32_t period_s, uint8_t num_channels)
+{
+  uint8_t i;
+
+  memset(window, 0, sizeof(*window));
+  window->period_us = (int64_t) period_s * 1000000;
+  window->num_channels = (num_channels > AGG_MAX_CHANNELS) ? AGG_MAX_CHANNELS : num_channels;
+
+  for(i = 0; i < AGG_MAX_CHANNELS; i++)
+  {
+    window->ch[i].min = UINT16_MAX;
+  }
+}
+
+
+/*
+* @brief Adds a sample, closing the window first if the sample is past its
+*        end. See aggregate.h.
+*/
+int agg_add(agg_window_t *window, int64_t time_us, const uint16_t *values, agg_summary_t *summary)
+{
+  agg_channel_t *ch;
+  uint16_t bin;
+  uint32_t target;
+  int done = 0;
+  int first = 0;
+  uint8_t i;
+
+  if(!window->started)
+  {
+    window->start_us = time_us;
+    window->started = 1;
+    first = 1;
+  }
+  else if(time_us - window->start_us >= window->period_us)
+  {
+    if(window->count > 0)
+    {
+      agg_summarize(window, summary);
+      done = 1;
+    }
+
+    // Skip over any empty windows so boundaries stay aligned.
+    window->start_us += ((time_us - window->start_us) / window->period_us) * window->period_us;
+    reset_window(window);
+  }
+
+  window->count++;
+  for(i = 0; i < window->num_channels; i++)
+  {
+    ch = &window->ch[i];
+    ch->sum += values[i];
+    if(values[i] < ch->min)
+      ch->min = values[i];
+    if(values[i] > ch->max)
+      ch->max = values[i];
+
+    bin = hist_bin(values[i]);
+    if(ch->hist[bin] != UINT16_MAX)
+      ch->hist[bin]++;
+
+    // EWMA in Q8, seeded with the first value ever seen.
+    target = (uint32_t) values[i] << 8;
+    if(first)
+      ch->ewma = target;
+    else if(target > ch->ewma)
+      ch->ewma += (target - ch->ewma) >> AGG_EWMA_SHIFT;
+    else
+      ch->ewma -= (ch->ewma - target) >> AGG_EWMA_SHIFT;
+  }
+
+  return done;
+}
+
+
+/*
+* @brief Summarises the current window. See aggregate.h.
+*/
+void agg_summarize(const agg_window_t *window, agg_summary_t *summary)
+{
+  const agg_channel_t *ch;
+  uint8_t i;
+
+  memset(summary, 0, sizeof(*summary));
+  summary->start_us = window->start_us;
+  summary->period_s = (uint32_t) (window->period_us / 1000000);
+  summary->count = window->count;
+  summary->num_channels = window->num_channels;
+
+  if(window->count == 0)
+    return;
+
+  for(i = 0; i < window->num_channels; i++)
+  {
+    ch = &window->ch[i];
+    summary->ch[i].mean = (uint16_t) ((ch->sum + window->count / 2) / window->count);
+    summary->ch[i].min = ch->min;
+    summary->ch[i].max = ch->max;
+    summary->ch[i].ewma = (uint16_t) ((ch->ewma + 0x80) >> 8);
+    summary->ch[i].p50 = agg_percentile(window, i, 50);
+    summary->ch[i].p90 = agg_percentile(window, i, 90);
+    summary->ch[i].p99 = agg_percentile(window, i, 99);
+  }
+}
+
+
+/*
+* @brief Approximate percentile from the histogram. See aggregate.h.
+*/
+uint16_t agg_percentile(const agg_window_t *window, uint8_t channel, uint8_t pct)
+{
+  const agg_channel_t *ch = &window->ch[channel];
+  uint32_t total = 0;
+  uint32_t rank;
+  uint32_t seen = 0;
+  uint16_t value;
+  uint16_t bin;
+
+  if(window->count == 0 || channel >= window->num_channels)
+    return 0;
+
+  // Bins saturate, so count what is actually in them rather than trusting
+  // window->count.
+  for(bin = 0; bin < AGG_HIST_BINS; bin++)
+  {
+    total += ch->hist[bin];
+  }
+
+  rank = (total * pct + 99) / 100;
+  if(rank == 0)
+    rank = 1;
+
+  for(bin = 0; bin < AGG_HIST_BINS; bin++)
+  {
+    seen += ch->hist[bin];
+    if(seen >= rank)
+      break;
+  }
+
+  // Clamp to what was really seen so the ends of the range are exact.
+  value = hist_value(bin);
+  if(value < ch->min)
+    value = ch->min;
+  if(value > ch->max)
+    value = ch->max;
+
+  return value;
+}
+
+
+/*
+* @brief Maps a value to its histogram bin.
+*
+* @param value - sample value
+*
+* @return bin index, 0 to AGG_HIST_BINS-1
+*/
+static uint16_t hist_bin(uint16_t value)
+{
+  uint16_t octave;
+
+  if(value < HIST_EXACT)
+    return value;
+
+  // Position of the top set bit, 4 to 15.
+  octave = 31 - __builtin_clz(value);
+
+  return HIST_EXACT + ((octave - 4) << HIST_SUB_BITS) +
+         ((value >> (octave - HIST_SUB_BITS)) & ((1 << HIST_SUB_BITS) - 1));
+}
+
+
+/*
+* @brief Maps a histogram bin back to the middle of the values it covers.
+*
+* @param bin - bin index
+*
+* @return representative value
+*/
+static uint16_t hist_value(uint16_t bin)
+{
+  uint16_t octave;
+  uint32_t sub;
+  uint32_t low;
+  uint32_t width;
+
+  if(bin < HIST_EXACT)
+    return bin;
+
+  octave = 4 + ((bin - HIST_EXACT) >> HIST_SUB_BITS);
+  sub = (bin - HIST_EXACT) & ((1 << HIST_SUB_BITS) - 1);
+  width = 1u << (octave - HIST_SUB_BITS);
+  low = ((1u << HIST_SUB_BITS) + sub) * width;
+
+  return (uint16_t) (low + width / 2);
+}
+
+
+/*
+* @brief Clears the per window state, keeping the EWMA.
+*
+* @param window - window to reset
+*
+* @return void
+*/
+static void reset_window(agg_window_t *window)
+{
+  uint8_t i;
+
+  window->count = 0;
+  for(i = 0; i < window->num_channels; i++)
+  {
+    window->ch[i].sum = 0;
+    window->ch[i].min = UINT16_MAX;
+    window->ch[i].max = 0;
+    memset(window->ch[i].hist, 0, sizeof(window->ch[i].hist));
+  }
+}
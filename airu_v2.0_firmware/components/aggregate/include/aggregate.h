@@ -0,0 +1,138 @@
+/*
+*	aggregate.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Constant-memory streaming statistics over fixed time windows.
+*
+*   Each window keeps count, sum, min, max and a fixed-size log-linear
+*   histogram per channel, so mean, min, max and approximate percentiles can
+*   be reported without storing raw samples. An EWMA per channel carries over
+*   from one window to the next. When a sample falls past the end of the
+*   current window, a compact summary of that window is produced and the
+*   window starts over.
+*
+*   Percentiles come from the histogram: values below 16 are exact, above
+*   that each power of two is split into 8 bins, so the reported value is
+*   within about 6% of the true one.
+*
+*   The PM driver does not run windows itself: the uplink sends every
+*   reading and the BLE history keeps its own means, so a consumer that
+*   wants summaries feeds its own windows from a pm_ring_t.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host:
+*   host/test/agg_check.c checks the statistics and the percentile error.
+*/
+
+#ifndef _AGGREGATE_H
+#define _AGGREGATE_H
+
+#include <stdint.h>
+
+#define AGG_MAX_CHANNELS  3     // Values per sample (PM1, PM2.5, PM10)
+#define AGG_HIST_BINS     112   // 16 exact bins + 12 octaves * 8 bins covers 0-65535
+#define AGG_EWMA_SHIFT    3     // EWMA weight of a new sample is 1/2^AGG_EWMA_SHIFT
+
+
+/*
+* @brief Per channel running state for one window
+*/
+typedef struct
+{
+  uint64_t sum;
+  uint16_t min;
+  uint16_t max;
+  uint32_t ewma;                  // Q8 fixed point, not reset between windows
+  uint16_t hist[AGG_HIST_BINS];   // Saturating bin counts
+} agg_channel_t;
+
+/*
+* @brief A time window
+*/
+typedef struct
+{
+  int64_t start_us;               // Start of the current window
+  int64_t period_us;              // Window length
+  uint32_t count;                 // Samples in the current window
+  uint8_t num_channels;
+  uint8_t started;                // Set once the first sample has fixed the window alignment
+  agg_channel_t ch[AGG_MAX_CHANNELS];
+} agg_window_t;
+
+/*
+* @brief Summary of a completed window, this is what gets uplinked
+*/
+typedef struct
+{
+  int64_t start_us;               // Start of the window
+  uint32_t period_s;              // Window length in seconds
+  uint32_t count;                 // Samples in the window
+  uint8_t num_channels;
+  struct
+  {
+    uint16_t mean;
+    uint16_t min;
+    uint16_t max;
+    uint16_t ewma;
+    uint16_t p50;
+    uint16_t p90;
+    uint16_t p99;
+  } ch[AGG_MAX_CHANNELS];
+} agg_summary_t;
+
+
+/*
+* @brief Sets up an empty window.
+*
+* @param window       - window to initialise
+* @param period_s     - window length in seconds
+* @param num_channels - values per sample, at most AGG_MAX_CHANNELS
+*
+* @return void
+*/
+void agg_init(agg_window_t *window, uint32_t period_s, uint8_t num_channels);
+
+/*
+* @brief Adds a sample to the window.
+*
+* If the sample is past the end of the current window, the current window is
+* summarised into *summary first and a new window is started that contains
+* this sample. Windows stay aligned to the time of the very first sample.
+*
+* @param window  - window to update
+* @param time_us - sample time in microseconds, must not go backwards
+* @param values  - num_channels values
+* @param summary - filled in when a window completes
+*
+* @return 1 if *summary was filled in, 0 otherwise
+*/
+int agg_add(agg_window_t *window, int64_t time_us, const uint16_t *values, agg_summary_t *summary);
+
+/*
+* @brief Summarises the current window without closing it.
+*
+* @param window  - window to summarise
+* @param summary - where to store the summary
+*
+* @return void
+*/
+void agg_summarize(const agg_window_t *window, agg_summary_t *summary);
+
+/*
+* @brief Returns the approximate value at a percentile of one channel of the
+*        current window.
+*
+* @param window  - window to query
+* @param channel - channel index
+* @param pct     - percentile, 0-100
+*
+* @return value at the percentile, 0 if the window is empty
+*/
+uint16_t agg_percentile(const agg_window_t *window, uint8_t channel, uint8_t pct);
+
+
+#endif
@@ -0,0 +1,764 @@
+/*
+*	ble_data.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Sensor data over BLE, see ble_data.h. The sensor task feeds the history
+*   (and the live queue) through the sink; Bluedroid's BTC task runs the
+*   handlers, which only record what happened and set event bits; the data
+*   task does all the sending.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+#include "ble_data.h"
+#include "ble_prov.h"
+
+#define DATA_APP_ID         0
+#define DATA_SUBSCRIBED     BIT0      // The client enabled notifications
+#define DATA_CONF           BIT1      // The notification in the stack is done with
+#define DATA_UNCONGESTED    BIT2
+#define DATA_ADV_DATA       0x01      // adv_config bits: set, advertising not started yet
+#define DATA_SCAN_RSP       0x02
+
+
+// Attribute table
+enum
+{
+  IDX_SVC,
+  IDX_REC_CHAR,
+  IDX_REC_VAL,
+  IDX_REC_CCCD,
+  IDX_NUM
+};
+
+// A period's running mean of one stream
+typedef struct
+{
+  int64_t time_us;          // First sample
+  int64_t utc_us;
+  uint8_t count;
+  uint32_t n;
+  int64_t sums[SENSOR_MAX_VALUES];
+} data_mean_t;
+
+
+/* Function prototypes */
+static void sink(const sensor_sample_t *sample, void *arg);
+static void store_mean(uint8_t stream, data_mean_t *mean);
+static void vData_task(void *pvParameters);
+static esp_err_t send_history(uint16_t cap);
+static void send_live(uint16_t cap);
+static esp_err_t send_block(const record_block_t *block);
+static esp_err_t notify(const uint8_t *value, uint16_t len);
+static void gatts_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+static void gap_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+static void set_subscribed(uint8_t subscribed);
+static void shutdown();
+
+/* Global variables */
+static const uint16_t primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t char_decl_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t cccd_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint16_t service_uuid = BLE_DATA_SERVICE_UUID;
+static const uint16_t records_uuid = BLE_DATA_RECORDS_UUID;
+static const uint8_t prop_notify = ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static uint8_t cccd_value[2];
+
+// Nothing here can be read but the CCCD; the stack answers for all of it.
+static const esp_gatts_attr_db_t data_db[IDX_NUM] =
+{
+  [IDX_SVC] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &primary_service_uuid,
+                ESP_GATT_PERM_READ, sizeof(service_uuid), sizeof(service_uuid), (uint8_t *) &service_uuid } },
+  [IDX_REC_CHAR] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &char_decl_uuid,
+                     ESP_GATT_PERM_READ, 1, 1, (uint8_t *) &prop_notify } },
+  [IDX_REC_VAL] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &records_uuid,
+                    0, BLE_DATA_LOCAL_MTU - 3, 0, NULL } },
+  [IDX_REC_CCCD] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &cccd_uuid,
+                     ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, sizeof(cccd_value), sizeof(cccd_value),
+                     cccd_value } }
+};
+
+// The service UUID in 128 bit form, for the advertisement
+static uint8_t adv_uuid128[16] = {
+  0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00,
+  BLE_DATA_SERVICE_UUID & 0xff, BLE_DATA_SERVICE_UUID >> 8, 0x00, 0x00
+};
+
+static esp_ble_adv_data_t adv_data = {
+  .set_scan_rsp = false,
+  .include_name = true,
+  .include_txpower = false,
+  .min_interval = 0x06,
+  .max_interval = 0x0C,
+  .service_uuid_len = sizeof(adv_uuid128),
+  .p_service_uuid = adv_uuid128,
+  .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_data_t scan_rsp_data = {
+  .set_scan_rsp = true,
+  .include_name = true,
+  .include_txpower = true,
+  .service_uuid_len = sizeof(adv_uuid128),
+  .p_service_uuid = adv_uuid128,
+  .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_params_t adv_params = {
+  .adv_int_min = 0x320,         // 0.5-1 s: it advertises for as long as it runs
+  .adv_int_max = 0x640,
+  .adv_type = ADV_TYPE_IND,
+  .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+  .channel_map = ADV_CHNL_ALL,
+  .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static EventGroupHandle_t data_events;
+static QueueHandle_t data_live_queue;
+static SemaphoreHandle_t data_lock;                     // History ring
+static portMUX_TYPE data_mux = portMUX_INITIALIZER_UNLOCKED;   // data_stats
+static uint8_t *data_hist;                              // BLE_DATA_HISTORY_BLOCKS blocks
+static record_block_t data_block;                       // Newest block, being added to
+static uint32_t data_first;                             // Oldest block's sequence number
+static uint32_t data_head;                              // data_block's
+static uint16_t data_slot_count[BLE_DATA_HISTORY_BLOCKS];
+static int64_t data_slot_us[BLE_DATA_HISTORY_BLOCKS];   // Time of each block's first mean
+static data_mean_t data_means[SENSOR_MAX_DRIVERS];      // Sensor task only
+static uint16_t data_handles[IDX_NUM];
+static esp_gatt_if_t data_gatts_if = ESP_GATT_IF_NONE;
+static uint8_t data_adv_config;
+static volatile uint8_t data_connected;
+static volatile uint8_t data_subscribed;
+static volatile uint8_t data_live;                      // The sink queues raw samples
+static volatile uint16_t data_conn_id;
+static volatile uint16_t data_mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+static volatile esp_gatt_status_t data_conf_status;
+static uint8_t data_copy[BLE_DATA_BLOCK_LEN];           // Data task only
+static uint8_t data_out[BLE_DATA_LOCAL_MTU - 3];
+static ble_data_stats_t data_stats;
+
+
+
+/*
+* @brief Allocates the history and adds the sink. See ble_data.h.
+*/
+esp_err_t ble_data_init()
+{
+  if(data_hist != NULL)
+    return ESP_OK;
+
+  data_lock = xSemaphoreCreateMutex();
+  data_live_queue = xQueueCreate(BLE_DATA_LIVE_QUEUE, sizeof(sensor_sample_t));
+  data_hist = malloc(BLE_DATA_HISTORY_BLOCKS * BLE_DATA_BLOCK_LEN);
+  if(data_lock == NULL || data_live_queue == NULL || data_hist == NULL)
+  {
+    free(data_hist);
+    data_hist = NULL;
+    return ESP_ERR_NO_MEM;
+  }
+
+  record_block_init(&data_block, data_hist, BLE_DATA_BLOCK_LEN);
+  return sensor_add_sink(sink, NULL);
+}
+
+
+/*
+* @brief Adds a sample to the period's mean. See ble_data.h.
+*/
+void ble_data_add(const sensor_sample_t *sample)
+{
+  data_mean_t *mean;
+  uint8_t i;
+
+  if(data_hist == NULL || sample->sensor >= SENSOR_MAX_DRIVERS || sample->count > SENSOR_MAX_VALUES)
+    return;
+
+  // A period ends at the first sample after it, or when the schema changes.
+  mean = &data_means[sample->sensor];
+  if(mean->n > 0 && (sample->time_us - mean->time_us >= (int64_t) BLE_DATA_PERIOD_S * 1000000 ||
+                     sample->count != mean->count))
+    store_mean(sample->sensor, mean);
+  if(mean->n == 0)
+  {
+    memset(mean, 0, sizeof(*mean));
+    mean->time_us = sample->time_us;
+    mean->utc_us = sample->utc_us;
+    mean->count = sample->count;
+  }
+  for(i = 0; i < sample->count; i++)
+    mean->sums[i] += sample->values[i];
+  mean->n++;
+
+  if(data_live && xQueueSend(data_live_queue, sample, 0) != pdPASS)
+  {
+    portENTER_CRITICAL(&data_mux);
+    data_stats.live_dropped++;
+    portEXIT_CRITICAL(&data_mux);
+  }
+}
+
+
+/*
+* @brief Brings BLE up. See ble_data.h.
+*/
+esp_err_t ble_data_start()
+{
+  esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+  uint32_t free_before;
+  esp_err_t err;
+
+  if(data_hist == NULL || data_events != NULL)
+    return ESP_ERR_INVALID_STATE;
+  data_events = xEventGroupCreate();
+  if(data_events == NULL)
+    return ESP_ERR_NO_MEM;
+
+  // BR/EDR is never used; its share of the controller memory goes now.
+  esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
+  free_before = esp_get_free_heap_size();
+
+  err = esp_bt_controller_init(&bt_cfg);
+  if(err == ESP_OK)
+    err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+  if(err == ESP_OK)
+    err = esp_bluedroid_init();
+  if(err == ESP_OK)
+    err = esp_bluedroid_enable();
+  if(err == ESP_OK)
+    err = esp_ble_gatts_register_callback(gatts_handler);
+  if(err == ESP_OK)
+    err = esp_ble_gap_register_callback(gap_handler);
+  if(err == ESP_OK)
+    err = esp_ble_gatts_app_register(DATA_APP_ID);
+  if(err == ESP_OK)
+    err = esp_ble_gatt_set_local_mtu(BLE_DATA_LOCAL_MTU);
+  if(err != ESP_OK)
+  {
+    ESP_LOGE(TAG_BLE_DATA, "BLE did not start: %s", esp_err_to_name(err));
+    shutdown();
+    return err;
+  }
+
+  portENTER_CRITICAL(&data_mux);
+  data_stats.running = 1;
+  data_stats.heap_used = free_before - esp_get_free_heap_size();
+  portEXIT_CRITICAL(&data_mux);
+
+  if(xTaskCreate(vData_task, "vData_task", BLE_DATA_TASK_STACK, NULL, BLE_DATA_TASK_PRIO, NULL) != pdPASS)
+  {
+    shutdown();
+    return ESP_ERR_NO_MEM;
+  }
+
+  ESP_LOGI(TAG_BLE_DATA, "advertising as %s, BLE took %u bytes", BLE_PROV_DEVICE_NAME, data_stats.heap_used);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the statistics out. See ble_data.h.
+*/
+void ble_data_get_stats(ble_data_stats_t *stats)
+{
+  portENTER_CRITICAL(&data_mux);
+  *stats = data_stats;
+  portEXIT_CRITICAL(&data_mux);
+}
+
+
+/*
+* @brief The sensor sink.
+*/
+static void sink(const sensor_sample_t *sample, void *arg)
+{
+  ble_data_add(sample);
+}
+
+
+/*
+* @brief Appends a period's mean to the history. When the newest block is
+*        full the next one is started, over the oldest if the ring is full.
+*
+* @param stream - stream the mean is of
+* @param mean   - the period, reset here
+*
+* @return void
+*/
+static void store_mean(uint8_t stream, data_mean_t *mean)
+{
+  sensor_sample_t sample;
+  int64_t half = mean->n / 2;
+  uint32_t slot;
+  uint8_t i;
+
+  memset(&sample, 0, sizeof(sample));
+  sample.time_us = mean->time_us;
+  sample.utc_us = mean->utc_us;
+  sample.sensor = stream;
+  sample.count = mean->count;
+  for(i = 0; i < mean->count; i++)
+    sample.values[i] = (int32_t) ((mean->sums[i] >= 0 ? mean->sums[i] + half : mean->sums[i] - half) /
+                                  (int64_t) mean->n);
+  mean->n = 0;
+
+  xSemaphoreTake(data_lock, portMAX_DELAY);
+  if(!record_block_add(&data_block, &sample))
+  {
+    data_head++;
+    if(data_head - data_first == BLE_DATA_HISTORY_BLOCKS)
+    {
+      portENTER_CRITICAL(&data_mux);
+      data_stats.records_stored -= data_slot_count[data_first % BLE_DATA_HISTORY_BLOCKS];
+      portEXIT_CRITICAL(&data_mux);
+      data_first++;
+    }
+    slot = data_head % BLE_DATA_HISTORY_BLOCKS;
+    record_block_init(&data_block, data_hist + slot * BLE_DATA_BLOCK_LEN, BLE_DATA_BLOCK_LEN);
+    data_slot_count[slot] = 0;
+    record_block_add(&data_block, &sample);
+  }
+  slot = data_head % BLE_DATA_HISTORY_BLOCKS;
+  if(data_block.count == 1)
+    data_slot_us[slot] = sample.time_us;
+  data_slot_count[slot]++;
+
+  portENTER_CRITICAL(&data_mux);
+  data_stats.records_stored++;
+  data_stats.history_bytes = (data_head - data_first) * BLE_DATA_BLOCK_LEN + data_block.len;
+  data_stats.history_s = (uint32_t) ((sample.time_us - data_slot_us[data_first % BLE_DATA_HISTORY_BLOCKS]) / 1000000);
+  portEXIT_CRITICAL(&data_mux);
+  xSemaphoreGive(data_lock);
+}
+
+
+/*
+* @brief Streams to each subscription in turn: the history, the empty
+*        block, then live samples until the client unsubscribes or goes.
+*
+* @param pvParameters - not used
+*
+* @return void
+*/
+static void vData_task(void *pvParameters)
+{
+  uint16_t cap;
+
+  for(;;)
+  {
+    xEventGroupWaitBits(data_events, DATA_SUBSCRIBED, pdFALSE, pdFALSE, portMAX_DELAY);
+
+    cap = data_mtu - 3;
+    if(cap > sizeof(data_out))
+      cap = sizeof(data_out);
+    if(cap < RECORD_OVERHEAD + RECORD_MAX_LEN)
+    {
+      ESP_LOGW(TAG_BLE_DATA, "MTU %u is too small, %u needed", data_mtu, BLE_DATA_MTU_MIN);
+      portENTER_CRITICAL(&data_mux);
+      data_stats.mtu_refused++;
+      portEXIT_CRITICAL(&data_mux);
+    }
+    else
+    {
+      xQueueReset(data_live_queue);
+      data_live = 1;
+      if(send_history(cap) == ESP_OK)
+        send_live(cap);
+      data_live = 0;
+      if(data_subscribed)
+        ESP_LOGW(TAG_BLE_DATA, "stream stopped, the client has to subscribe again");
+    }
+
+    while(data_subscribed)
+      vTaskDelay(pdMS_TO_TICKS(BLE_DATA_LIVE_MS));
+  }
+}
+
+
+/*
+* @brief Sends the history, oldest first, re-packed into blocks of up to
+*        cap bytes, and then the empty block. Means stored meanwhile in
+*        blocks already sent are left for the next subscription.
+*
+* @param cap - largest block the MTU takes
+*
+* @return ESP_OK, or ESP_FAIL if the stream stopped
+*/
+static esp_err_t send_history(uint16_t cap)
+{
+  record_block_t out;
+  record_reader_t reader;
+  sensor_sample_t sample;
+  int64_t start_us = esp_timer_get_time();
+  uint32_t records = 0;
+  uint32_t bytes = 0;
+  uint32_t seq;
+  int done;
+
+  record_block_init(&out, data_out, cap);
+
+  xSemaphoreTake(data_lock, portMAX_DELAY);
+  seq = data_first;
+  xSemaphoreGive(data_lock);
+
+  for(;;)
+  {
+    // Blocks overwritten while the ones before went out are skipped.
+    xSemaphoreTake(data_lock, portMAX_DELAY);
+    if((int32_t) (seq - data_first) < 0)
+      seq = data_first;
+    done = (int32_t) (seq - data_head) > 0;
+    if(!done)
+      memcpy(data_copy, data_hist + (seq % BLE_DATA_HISTORY_BLOCKS) * BLE_DATA_BLOCK_LEN, BLE_DATA_BLOCK_LEN);
+    xSemaphoreGive(data_lock);
+    if(done)
+      break;
+    seq++;
+
+    if(record_reader_init(&reader, data_copy, sizeof(data_copy)) < 0)
+      continue;
+    while(record_reader_next(&reader, &sample) == 1)
+    {
+      if(record_block_add(&out, &sample))
+        continue;
+      if(send_block(&out) != ESP_OK)
+        return ESP_FAIL;
+      records += out.count;
+      bytes += out.len;
+      record_block_init(&out, data_out, cap);
+      record_block_add(&out, &sample);
+    }
+  }
+
+  if(out.count > 0)
+  {
+    if(send_block(&out) != ESP_OK)
+      return ESP_FAIL;
+    records += out.count;
+    bytes += out.len;
+    record_block_init(&out, data_out, cap);
+  }
+  if(send_block(&out) != ESP_OK)
+    return ESP_FAIL;
+
+  portENTER_CRITICAL(&data_mux);
+  data_stats.backlog_records = records;
+  data_stats.backlog_bytes = bytes;
+  data_stats.backlog_ms = (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+  portEXIT_CRITICAL(&data_mux);
+  ESP_LOGI(TAG_BLE_DATA, "history sent: %u records, %u bytes in %u ms", records, bytes, data_stats.backlog_ms);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sends raw samples as they come, a block once it is full or its
+*        oldest sample is BLE_DATA_LIVE_MS old.
+*
+* @param cap - largest block the MTU takes
+*
+* @return void, once the stream stops
+*/
+static void send_live(uint16_t cap)
+{
+  record_block_t out;
+  sensor_sample_t sample;
+  int64_t first_us = 0;
+  int64_t left_us;
+  TickType_t ticks;
+
+  record_block_init(&out, data_out, cap);
+
+  while(data_subscribed)
+  {
+    ticks = pdMS_TO_TICKS(BLE_DATA_LIVE_MS);
+    if(out.count > 0)
+    {
+      left_us = first_us + (int64_t) BLE_DATA_LIVE_MS * 1000 - esp_timer_get_time();
+      ticks = (left_us > 0) ? (TickType_t) (left_us / 1000 / portTICK_PERIOD_MS) + 1 : 0;
+    }
+
+    if(xQueueReceive(data_live_queue, &sample, ticks) == pdPASS)
+    {
+      if(!record_block_add(&out, &sample))
+      {
+        if(send_block(&out) != ESP_OK)
+          return;
+        record_block_init(&out, data_out, cap);
+        record_block_add(&out, &sample);
+      }
+      if(out.count == 1)
+        first_us = esp_timer_get_time();
+    }
+
+    if(out.count > 0 && esp_timer_get_time() - first_us >= (int64_t) BLE_DATA_LIVE_MS * 1000)
+    {
+      if(send_block(&out) != ESP_OK)
+        return;
+      record_block_init(&out, data_out, cap);
+    }
+  }
+}
+
+
+/*
+* @brief Notifies a block and counts it.
+*
+* @param block - block to send
+*
+* @return ESP_OK, or ESP_FAIL if the stream stopped
+*/
+static esp_err_t send_block(const record_block_t *block)
+{
+  if(notify(block->buf, block->len) != ESP_OK)
+    return ESP_FAIL;
+
+  portENTER_CRITICAL(&data_mux);
+  data_stats.notifications++;
+  data_stats.bytes += block->len;
+  data_stats.records += block->count;
+  portEXIT_CRITICAL(&data_mux);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sends one notification and waits for its CONF event. One that the
+*        stack dropped on a congested link is sent again once the link
+*        clears; nothing is sent while it is congested.
+*
+* @param value - notification value
+* @param len   - its length, at most the MTU - 3
+*
+* @return ESP_OK once the stack has taken it, ESP_FAIL if the client
+*         unsubscribed or went, or the stack did not answer
+*/
+static esp_err_t notify(const uint8_t *value, uint16_t len)
+{
+  EventBits_t bits;
+
+  for(;;)
+  {
+    do
+      bits = xEventGroupWaitBits(data_events, DATA_UNCONGESTED, pdFALSE, pdFALSE,
+                                 pdMS_TO_TICKS(BLE_DATA_LIVE_MS));
+    while(!(bits & DATA_UNCONGESTED) && data_subscribed);
+    if(!data_subscribed)
+      return ESP_FAIL;
+
+    xEventGroupClearBits(data_events, DATA_CONF);
+    if(esp_ble_gatts_send_indicate(data_gatts_if, data_conn_id, data_handles[IDX_REC_VAL], len,
+                                   (uint8_t *) value, false) != ESP_OK)
+      return ESP_FAIL;
+    bits = xEventGroupWaitBits(data_events, DATA_CONF, pdTRUE, pdFALSE, pdMS_TO_TICKS(BLE_DATA_CONF_MS));
+    if(!(bits & DATA_CONF) || (data_conf_status != ESP_GATT_OK && data_conf_status != ESP_GATT_CONGESTED))
+      return ESP_FAIL;
+    if(data_conf_status == ESP_GATT_OK)
+      return ESP_OK;
+
+    portENTER_CRITICAL(&data_mux);
+    data_stats.resends++;
+    portEXIT_CRITICAL(&data_mux);
+  }
+}
+
+
+/*
+* @brief GATTS events, from the BTC task.
+*/
+static void gatts_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+  esp_ble_conn_update_params_t conn_params = { 0 };
+
+  switch(event)
+  {
+    case ESP_GATTS_REG_EVT:
+      if(param->reg.status != ESP_GATT_OK)
+      {
+        ESP_LOGE(TAG_BLE_DATA, "app register failed: %d", param->reg.status);
+        break;
+      }
+      data_gatts_if = gatts_if;
+      esp_ble_gap_set_device_name(BLE_PROV_DEVICE_NAME);
+      data_adv_config = DATA_ADV_DATA | DATA_SCAN_RSP;
+      esp_ble_gap_config_adv_data(&adv_data);
+      esp_ble_gap_config_adv_data(&scan_rsp_data);
+      esp_ble_gatts_create_attr_tab(data_db, gatts_if, IDX_NUM, 0);
+      break;
+
+    case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+      if(param->add_attr_tab.status != ESP_GATT_OK || param->add_attr_tab.num_handle != IDX_NUM)
+      {
+        ESP_LOGE(TAG_BLE_DATA, "attribute table failed: %d", param->add_attr_tab.status);
+        break;
+      }
+      memcpy(data_handles, param->add_attr_tab.handles, sizeof(data_handles));
+      esp_ble_gatts_start_service(data_handles[IDX_SVC]);
+      break;
+
+    case ESP_GATTS_CONNECT_EVT:
+      data_conn_id = param->connect.conn_id;
+      data_connected = 1;
+      data_mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+      set_subscribed(0);
+      xEventGroupSetBits(data_events, DATA_UNCONGESTED);
+      portENTER_CRITICAL(&data_mux);
+      data_stats.connects++;
+      portEXIT_CRITICAL(&data_mux);
+
+      // 7.5-15 ms connection interval: the shortest a phone grants, as
+      // every interval is a chance to move another few packets.
+      memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+      conn_params.min_int = 0x06;
+      conn_params.max_int = 0x0C;
+      conn_params.latency = 0;
+      conn_params.timeout = 400;
+      esp_ble_gap_update_conn_params(&conn_params);
+      break;
+
+    case ESP_GATTS_DISCONNECT_EVT:
+      data_connected = 0;
+      set_subscribed(0);
+      esp_ble_gap_start_advertising(&adv_params);
+      break;
+
+    case ESP_GATTS_MTU_EVT:
+      data_mtu = param->mtu.mtu;
+      portENTER_CRITICAL(&data_mux);
+      data_stats.mtu = param->mtu.mtu;
+      portEXIT_CRITICAL(&data_mux);
+      break;
+
+    case ESP_GATTS_WRITE_EVT:
+      if(param->write.handle == data_handles[IDX_REC_CCCD] && param->write.len == 2)
+        set_subscribed(param->write.value[0] & 0x01);
+      break;
+
+    case ESP_GATTS_CONF_EVT:
+      // A notification dropped for congestion is followed by CONGEST_EVT
+      // once the link clears, so the wait for it starts here, in order.
+      data_conf_status = param->conf.status;
+      if(param->conf.status == ESP_GATT_CONGESTED)
+        xEventGroupClearBits(data_events, DATA_UNCONGESTED);
+      xEventGroupSetBits(data_events, DATA_CONF);
+      break;
+
+    case ESP_GATTS_CONGEST_EVT:
+      if(param->congest.congested)
+      {
+        xEventGroupClearBits(data_events, DATA_UNCONGESTED);
+        portENTER_CRITICAL(&data_mux);
+        data_stats.congested++;
+        portEXIT_CRITICAL(&data_mux);
+      }
+      else
+        xEventGroupSetBits(data_events, DATA_UNCONGESTED);
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+* @brief GAP events, from the BTC task. Advertising starts once both the
+*        advertisement and the scan response are set.
+*/
+static void gap_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+  switch(event)
+  {
+    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+      data_adv_config &= ~DATA_ADV_DATA;
+      if(data_adv_config == 0)
+        esp_ble_gap_start_advertising(&adv_params);
+      break;
+
+    case ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT:
+      data_adv_config &= ~DATA_SCAN_RSP;
+      if(data_adv_config == 0)
+        esp_ble_gap_start_advertising(&adv_params);
+      break;
+
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+      if(param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS)
+        ESP_LOGE(TAG_BLE_DATA, "advertising did not start: %d", param->adv_start_cmpl.status);
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+* @brief Records the CCCD, and wakes the data task on a subscription.
+*
+* @param subscribed - notifications enabled
+*
+* @return void
+*/
+static void set_subscribed(uint8_t subscribed)
+{
+  portENTER_CRITICAL(&data_mux);
+  if(subscribed && !data_subscribed)
+    data_stats.subscriptions++;
+  data_stats.subscribed = subscribed;
+  portEXIT_CRITICAL(&data_mux);
+
+  data_subscribed = subscribed;
+  if(subscribed)
+    xEventGroupSetBits(data_events, DATA_SUBSCRIBED);
+  else
+    xEventGroupClearBits(data_events, DATA_SUBSCRIBED);
+}
+
+
+/*
+* @brief Cleans up after a failed start: takes down whatever came up and
+*        gives the controller's memory to the heap, as nothing else will
+*        use it.
+*
+* @return void
+*/
+static void shutdown()
+{
+  if(esp_bluedroid_get_status() == ESP_BLUEDROID_STATUS_ENABLED)
+  {
+    if(data_gatts_if != ESP_GATT_IF_NONE)
+      esp_ble_gatts_app_unregister(data_gatts_if);
+    esp_bluedroid_disable();
+  }
+  if(esp_bluedroid_get_status() == ESP_BLUEDROID_STATUS_INITIALIZED)
+    esp_bluedroid_deinit();
+  if(esp_bt_controller_get_status() == ESP_BT_CONTROLLER_STATUS_ENABLED)
+    esp_bt_controller_disable();
+  if(esp_bt_controller_get_status() == ESP_BT_CONTROLLER_STATUS_INITED)
+    esp_bt_controller_deinit();
+  esp_bt_controller_mem_release(ESP_BT_MODE_BTDM);
+
+  portENTER_CRITICAL(&data_mux);
+  data_stats.running = 0;
+  portEXIT_CRITICAL(&data_mux);
+}
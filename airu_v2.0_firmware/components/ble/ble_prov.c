@@ -0,0 +1,604 @@
+/*
+*	ble_prov.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   BLE provisioning, see ble_prov.h. Bluedroid calls the GATTS and GAP
+*   handlers from its BTC task; they only record what happened and set
+*   event bits. The provisioning task does the slow parts (NVS commit,
+*   WiFi connect, teardown).
+*/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+#include "ble_prov.h"
+#include "settings.h"
+#include "internet_if.h"
+
+#define PROV_APP_ID         0
+#define PROV_LOCAL_MTU      500
+#define PROV_CREDENTIALS    BIT0      // A complete credentials write is waiting
+#define PROV_NOTIFIED       BIT1      // The last status notification went out
+#define PROV_ADV_DATA       0x01      // adv_config bits: set, advertising not started yet
+#define PROV_SCAN_RSP       0x02
+
+
+// Attribute table
+enum
+{
+  IDX_SVC,
+  IDX_CRED_CHAR,
+  IDX_CRED_VAL,
+  IDX_STATUS_CHAR,
+  IDX_STATUS_VAL,
+  IDX_STATUS_CCCD,
+  IDX_NUM
+};
+
+
+/* Function prototypes */
+static void vProv_task(void *pvParameters);
+static void gatts_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+static void gap_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+static void cred_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param);
+static void cred_done(const uint8_t *value, size_t len);
+static int cred_names_ok(const char *text, size_t len);
+static void set_status(ble_prov_status_t status);
+static void shutdown();
+
+/* Global variables */
+static const uint16_t primary_service_uuid = ESP_GATT_UUID_PRI_SERVICE;
+static const uint16_t char_decl_uuid = ESP_GATT_UUID_CHAR_DECLARE;
+static const uint16_t cccd_uuid = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+static const uint16_t service_uuid = BLE_PROV_SERVICE_UUID;
+static const uint16_t cred_uuid = BLE_PROV_CREDENTIALS_UUID;
+static const uint16_t status_uuid = BLE_PROV_STATUS_UUID;
+static const uint8_t prop_write = ESP_GATT_CHAR_PROP_BIT_WRITE;
+static const uint8_t prop_read_notify = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+static uint8_t status_value = BLE_PROV_WAITING;
+static uint8_t cccd_value[2];
+
+// Credentials are answered by the app, to take long writes; the rest by the stack.
+static const esp_gatts_attr_db_t prov_db[IDX_NUM] =
+{
+  [IDX_SVC] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &primary_service_uuid,
+                ESP_GATT_PERM_READ, sizeof(service_uuid), sizeof(service_uuid), (uint8_t *) &service_uuid } },
+  [IDX_CRED_CHAR] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &char_decl_uuid,
+                      ESP_GATT_PERM_READ, 1, 1, (uint8_t *) &prop_write } },
+  [IDX_CRED_VAL] = { { ESP_GATT_RSP_BY_APP }, { ESP_UUID_LEN_16, (uint8_t *) &cred_uuid,
+                     ESP_GATT_PERM_WRITE, BLE_PROV_CRED_MAX, 0, NULL } },
+  [IDX_STATUS_CHAR] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &char_decl_uuid,
+                        ESP_GATT_PERM_READ, 1, 1, (uint8_t *) &prop_read_notify } },
+  [IDX_STATUS_VAL] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &status_uuid,
+                       ESP_GATT_PERM_READ, 1, 1, &status_value } },
+  [IDX_STATUS_CCCD] = { { ESP_GATT_AUTO_RSP }, { ESP_UUID_LEN_16, (uint8_t *) &cccd_uuid,
+                        ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, sizeof(cccd_value), sizeof(cccd_value),
+                        cccd_value } }
+};
+
+// The service UUID in 128 bit form, for the advertisement
+static uint8_t adv_uuid128[16] = {
+  0xfb, 0x34, 0x9b, 0x5f, 0x80, 0x00, 0x00, 0x80, 0x00, 0x10, 0x00, 0x00,
+  BLE_PROV_SERVICE_UUID & 0xff, BLE_PROV_SERVICE_UUID >> 8, 0x00, 0x00
+};
+
+static esp_ble_adv_data_t adv_data = {
+  .set_scan_rsp = false,
+  .include_name = true,
+  .include_txpower = false,
+  .min_interval = 0x10,
+  .max_interval = 0x20,
+  .service_uuid_len = sizeof(adv_uuid128),
+  .p_service_uuid = adv_uuid128,
+  .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_data_t scan_rsp_data = {
+  .set_scan_rsp = true,
+  .include_name = true,
+  .include_txpower = true,
+  .service_uuid_len = sizeof(adv_uuid128),
+  .p_service_uuid = adv_uuid128,
+  .flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT),
+};
+
+static esp_ble_adv_params_t adv_params = {
+  .adv_int_min = 0x20,          // 20-40 ms while waiting to be found
+  .adv_int_max = 0x40,
+  .adv_type = ADV_TYPE_IND,
+  .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
+  .channel_map = ADV_CHNL_ALL,
+  .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static EventGroupHandle_t prov_events;
+static portMUX_TYPE prov_mux = portMUX_INITIALIZER_UNLOCKED;   // prov_cred, prov_stats
+static uint16_t prov_handles[IDX_NUM];
+static esp_gatt_if_t prov_gatts_if = ESP_GATT_IF_NONE;
+static uint8_t prov_adv_config;
+static volatile uint8_t prov_connected;
+static volatile uint8_t prov_notify;          // Client enabled status notifications
+static volatile uint8_t prov_stopping;
+static volatile uint16_t prov_conn_id;
+static uint8_t prov_prep[BLE_PROV_CRED_MAX];  // Long write being put together, BTC task only
+static size_t prov_prep_len;
+static esp_gatt_rsp_t prov_rsp;               // BTC task only
+static char prov_cred[BLE_PROV_CRED_MAX];     // Last complete write
+static size_t prov_cred_len;
+static int64_t prov_cred_us;
+static ble_prov_stats_t prov_stats;
+
+
+
+/*
+* @brief Brings BLE up. See ble_prov.h.
+*/
+esp_err_t ble_prov_start()
+{
+  esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+  uint32_t free_before;
+  esp_err_t err;
+
+  if(prov_events != NULL)
+    return ESP_ERR_INVALID_STATE;
+  prov_events = xEventGroupCreate();
+  if(prov_events == NULL)
+    return ESP_ERR_NO_MEM;
+
+  // BR/EDR is never used; its share of the controller memory goes now.
+  esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
+  free_before = esp_get_free_heap_size();
+
+  err = esp_bt_controller_init(&bt_cfg);
+  if(err == ESP_OK)
+    err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+  if(err == ESP_OK)
+    err = esp_bluedroid_init();
+  if(err == ESP_OK)
+    err = esp_bluedroid_enable();
+  if(err == ESP_OK)
+    err = esp_ble_gatts_register_callback(gatts_handler);
+  if(err == ESP_OK)
+    err = esp_ble_gap_register_callback(gap_handler);
+  if(err == ESP_OK)
+    err = esp_ble_gatts_app_register(PROV_APP_ID);
+  if(err == ESP_OK)
+    err = esp_ble_gatt_set_local_mtu(PROV_LOCAL_MTU);
+  if(err != ESP_OK)
+  {
+    ESP_LOGE(TAG_BLE_PROV, "BLE did not start: %s", esp_err_to_name(err));
+    shutdown();
+    return err;
+  }
+
+  prov_stats.running = 1;
+  prov_stats.heap_used = free_before - esp_get_free_heap_size();
+
+  if(xTaskCreate(vProv_task, "vProv_task", BLE_PROV_TASK_STACK, NULL, BLE_PROV_TASK_PRIO, NULL) != pdPASS)
+  {
+    shutdown();
+    return ESP_ERR_NO_MEM;
+  }
+
+  ESP_LOGI(TAG_BLE_PROV, "advertising as %s for %u s, BLE took %u bytes", BLE_PROV_DEVICE_NAME,
+           BLE_PROV_WINDOW_S, prov_stats.heap_used);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Releases the controller memory unused. See ble_prov.h.
+*/
+esp_err_t ble_prov_release()
+{
+  uint32_t free_before = esp_get_free_heap_size();
+  esp_err_t err;
+
+  if(prov_stats.running)
+    return ESP_ERR_INVALID_STATE;
+
+  err = esp_bt_controller_mem_release(ESP_BT_MODE_BTDM);
+  if(err == ESP_OK)
+  {
+    portENTER_CRITICAL(&prov_mux);
+    prov_stats.released = 1;
+    prov_stats.heap_recovered = esp_get_free_heap_size() - free_before;
+    portEXIT_CRITICAL(&prov_mux);
+  }
+
+  return err;
+}
+
+
+/*
+* @brief Copies the statistics out. See ble_prov.h.
+*/
+void ble_prov_get_stats(ble_prov_stats_t *stats)
+{
+  portENTER_CRITICAL(&prov_mux);
+  *stats = prov_stats;
+  portEXIT_CRITICAL(&prov_mux);
+}
+
+
+/*
+* @brief Waits for credentials, tries them and takes BLE down.
+*
+* @param pvParameters - not used
+*
+* @return void
+*/
+static void vProv_task(void *pvParameters)
+{
+  char cred[BLE_PROV_CRED_MAX];
+  settings_t settings;
+  int64_t end_us = esp_timer_get_time() + (int64_t) BLE_PROV_WINDOW_S * 1000000;
+  int64_t write_us;
+  int64_t now;
+  EventBits_t bits;
+  size_t len;
+
+  for(;;)
+  {
+    now = esp_timer_get_time();
+    bits = (now < end_us) ? xEventGroupWaitBits(prov_events, PROV_CREDENTIALS, pdTRUE, pdFALSE,
+                                                (TickType_t) ((end_us - now) / 1000 / portTICK_PERIOD_MS) + 1) : 0;
+    if((bits & PROV_CREDENTIALS) == 0)
+    {
+      ESP_LOGW(TAG_BLE_PROV, "no credentials in %u s", BLE_PROV_WINDOW_S);
+      break;
+    }
+
+    portENTER_CRITICAL(&prov_mux);
+    len = prov_cred_len;
+    memcpy(cred, prov_cred, len);
+    write_us = prov_cred_us;
+    portEXIT_CRITICAL(&prov_mux);
+
+    settings_get(&settings);
+    if(!cred_names_ok(cred, len) || settings_parse(&settings, cred, len) <= 0 ||
+       settings_commit(&settings) != ESP_OK)
+    {
+      ESP_LOGW(TAG_BLE_PROV, "credentials refused");
+      portENTER_CRITICAL(&prov_mux);
+      prov_stats.bad_writes++;
+      portEXIT_CRITICAL(&prov_mux);
+      set_status(BLE_PROV_BAD_VALUE);
+      continue;
+    }
+
+    set_status(BLE_PROV_CONNECTING);
+    wifi_reconnect();
+    if(wifi_wait_connected(pdMS_TO_TICKS(BLE_PROV_CONNECT_MS)) != ESP_OK)
+    {
+      ESP_LOGW(TAG_BLE_PROV, "no connection to %s", settings.ssid);
+      portENTER_CRITICAL(&prov_mux);
+      prov_stats.failures++;
+      portEXIT_CRITICAL(&prov_mux);
+      set_status(BLE_PROV_FAILED);
+      continue;
+    }
+
+    // The client hears it worked before the link goes.
+    now = esp_timer_get_time();
+    xEventGroupClearBits(prov_events, PROV_NOTIFIED);
+    set_status(BLE_PROV_CONNECTED);
+    xEventGroupWaitBits(prov_events, PROV_NOTIFIED, pdTRUE, pdFALSE, pdMS_TO_TICKS(BLE_PROV_NOTIFY_MS));
+
+    portENTER_CRITICAL(&prov_mux);
+    prov_stats.connect_ms = (uint32_t) ((now - write_us) / 1000);
+    prov_stats.latency_ms = (uint32_t) ((esp_timer_get_time() - write_us) / 1000);
+    portEXIT_CRITICAL(&prov_mux);
+    ESP_LOGI(TAG_BLE_PROV, "provisioned for %s: connected %u ms after the write, client told after %u ms",
+             settings.ssid, prov_stats.connect_ms, prov_stats.latency_ms);
+    break;
+  }
+
+  shutdown();
+  vTaskDelete(NULL);
+}
+
+
+/*
+* @brief GATTS events, from the BTC task.
+*/
+static void gatts_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+  esp_ble_conn_update_params_t conn_params = { 0 };
+
+  switch(event)
+  {
+    case ESP_GATTS_REG_EVT:
+      if(param->reg.status != ESP_GATT_OK)
+      {
+        ESP_LOGE(TAG_BLE_PROV, "app register failed: %d", param->reg.status);
+        break;
+      }
+      prov_gatts_if = gatts_if;
+      esp_ble_gap_set_device_name(BLE_PROV_DEVICE_NAME);
+      prov_adv_config = PROV_ADV_DATA | PROV_SCAN_RSP;
+      esp_ble_gap_config_adv_data(&adv_data);
+      esp_ble_gap_config_adv_data(&scan_rsp_data);
+      esp_ble_gatts_create_attr_tab(prov_db, gatts_if, IDX_NUM, 0);
+      break;
+
+    case ESP_GATTS_CREAT_ATTR_TAB_EVT:
+      if(param->add_attr_tab.status != ESP_GATT_OK || param->add_attr_tab.num_handle != IDX_NUM)
+      {
+        ESP_LOGE(TAG_BLE_PROV, "attribute table failed: %d", param->add_attr_tab.status);
+        break;
+      }
+      memcpy(prov_handles, param->add_attr_tab.handles, sizeof(prov_handles));
+      esp_ble_gatts_start_service(prov_handles[IDX_SVC]);
+      break;
+
+    case ESP_GATTS_CONNECT_EVT:
+      prov_conn_id = param->connect.conn_id;
+      prov_connected = 1;
+      prov_notify = 0;
+      prov_prep_len = 0;
+      portENTER_CRITICAL(&prov_mux);
+      prov_stats.connects++;
+      portEXIT_CRITICAL(&prov_mux);
+
+      // 20-40 ms connection interval: a long write takes one per chunk.
+      memcpy(conn_params.bda, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+      conn_params.min_int = 0x10;
+      conn_params.max_int = 0x20;
+      conn_params.latency = 0;
+      conn_params.timeout = 400;
+      esp_ble_gap_update_conn_params(&conn_params);
+      break;
+
+    case ESP_GATTS_DISCONNECT_EVT:
+      prov_connected = 0;
+      prov_notify = 0;
+      if(!prov_stopping)
+        esp_ble_gap_start_advertising(&adv_params);
+      break;
+
+    case ESP_GATTS_MTU_EVT:
+      portENTER_CRITICAL(&prov_mux);
+      prov_stats.mtu = param->mtu.mtu;
+      portEXIT_CRITICAL(&prov_mux);
+      break;
+
+    case ESP_GATTS_WRITE_EVT:
+      if(param->write.handle == prov_handles[IDX_CRED_VAL])
+        cred_write(gatts_if, param);
+      else if(param->write.handle == prov_handles[IDX_STATUS_CCCD] && param->write.len == 2)
+        prov_notify = param->write.value[0] & 0x01;
+      break;
+
+    case ESP_GATTS_EXEC_WRITE_EVT:
+      esp_ble_gatts_send_response(gatts_if, param->exec_write.conn_id, param->exec_write.trans_id,
+                                  ESP_GATT_OK, NULL);
+      if(param->exec_write.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC && prov_prep_len > 0)
+        cred_done(prov_prep, prov_prep_len);
+      prov_prep_len = 0;
+      break;
+
+    case ESP_GATTS_CONF_EVT:
+      xEventGroupSetBits(prov_events, PROV_NOTIFIED);
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+* @brief GAP events, from the BTC task. Advertising starts once both the
+*        advertisement and the scan response are set.
+*/
+static void gap_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+  switch(event)
+  {
+    case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
+      prov_adv_config &= ~PROV_ADV_DATA;
+      if(prov_adv_config == 0 && !prov_stopping)
+        esp_ble_gap_start_advertising(&adv_params);
+      break;
+
+    case ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT:
+      prov_adv_config &= ~PROV_SCAN_RSP;
+      if(prov_adv_config == 0 && !prov_stopping)
+        esp_ble_gap_start_advertising(&adv_params);
+      break;
+
+    case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+      if(param->adv_start_cmpl.status != ESP_BT_STATUS_SUCCESS)
+        ESP_LOGE(TAG_BLE_PROV, "advertising did not start: %d", param->adv_start_cmpl.status);
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+* @brief A write to the credentials. A long write comes as prepared
+*        writes, put together here until the execute.
+*
+* @param gatts_if - interface
+* @param param    - the write
+*
+* @return void
+*/
+static void cred_write(esp_gatt_if_t gatts_if, esp_ble_gatts_cb_param_t *param)
+{
+  esp_gatt_status_t status = ESP_GATT_OK;
+  uint16_t offset = param->write.offset;
+  uint16_t len = param->write.len;
+
+  if(param->write.is_prep)
+  {
+    if(offset > BLE_PROV_CRED_MAX)
+      status = ESP_GATT_INVALID_OFFSET;
+    else if(offset + len > BLE_PROV_CRED_MAX)
+      status = ESP_GATT_INVALID_ATTR_LEN;
+    else
+    {
+      memcpy(prov_prep + offset, param->write.value, len);
+      if(offset + len > prov_prep_len)
+        prov_prep_len = offset + len;
+    }
+
+    // A prepared write is answered with what was written.
+    if(param->write.need_rsp)
+    {
+      memset(&prov_rsp, 0, sizeof(prov_rsp));
+      prov_rsp.attr_value.handle = param->write.handle;
+      prov_rsp.attr_value.offset = offset;
+      prov_rsp.attr_value.len = len;
+      prov_rsp.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+      memcpy(prov_rsp.attr_value.value, param->write.value, len);
+      esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, &prov_rsp);
+    }
+    return;
+  }
+
+  if(len > BLE_PROV_CRED_MAX)
+    status = ESP_GATT_INVALID_ATTR_LEN;
+  if(param->write.need_rsp)
+    esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, status, NULL);
+  if(status == ESP_GATT_OK)
+    cred_done(param->write.value, len);
+}
+
+
+/*
+* @brief Hands a complete credentials write to the task.
+*
+* @param value - what was written
+* @param len   - its length
+*
+* @return void
+*/
+static void cred_done(const uint8_t *value, size_t len)
+{
+  portENTER_CRITICAL(&prov_mux);
+  memcpy(prov_cred, value, len);
+  prov_cred_len = len;
+  prov_cred_us = esp_timer_get_time();
+  prov_stats.writes++;
+  portEXIT_CRITICAL(&prov_mux);
+
+  xEventGroupSetBits(prov_events, PROV_CREDENTIALS);
+}
+
+
+/*
+* @brief Checks a credentials write only names the WiFi credentials. The
+*        characteristic takes writes from anyone in range, who must not be
+*        able to point the node at another url or change its schedule.
+*
+* @param text - NAME=VALUE lines, as settings_parse() takes them
+* @param len  - length of text
+*
+* @return 1 if every line is ssid=... or password=..., else 0
+*/
+static int cred_names_ok(const char *text, size_t len)
+{
+  const char *end = text + len;
+  const char *nl;
+  size_t n;
+
+  while(text < end)
+  {
+    nl = memchr(text, '\n', end - text);
+    n = ((nl != NULL) ? nl : end) - text;
+    if(n > 0 && text[n - 1] == '\r')
+      n--;
+
+    if(n > 0 && !(n >= 5 && memcmp(text, "ssid=", 5) == 0) &&
+       !(n >= 9 && memcmp(text, "password=", 9) == 0))
+      return 0;
+
+    text = (nl != NULL) ? nl + 1 : end;
+  }
+
+  return 1;
+}
+
+
+/*
+* @brief Sets the status characteristic and notifies it if the client
+*        asked to be. PROV_NOTIFIED is set once it is out, or at once if
+*        there is no one to tell.
+*
+* @param status - new status
+*
+* @return void
+*/
+static void set_status(ble_prov_status_t status)
+{
+  uint8_t value = status;
+
+  portENTER_CRITICAL(&prov_mux);
+  prov_stats.status = status;
+  portEXIT_CRITICAL(&prov_mux);
+
+  esp_ble_gatts_set_attr_value(prov_handles[IDX_STATUS_VAL], sizeof(value), &value);
+  if(!prov_connected || !prov_notify ||
+     esp_ble_gatts_send_indicate(prov_gatts_if, prov_conn_id, prov_handles[IDX_STATUS_VAL], sizeof(value),
+                                 &value, false) != ESP_OK)
+    xEventGroupSetBits(prov_events, PROV_NOTIFIED);
+}
+
+
+/*
+* @brief Takes Bluedroid and the controller down and gives the
+*        controller's memory to the heap. Each step only undoes what came
+*        up, so this also cleans up after a failed start.
+*
+* @return void
+*/
+static void shutdown()
+{
+  uint32_t free_before = esp_get_free_heap_size();
+
+  prov_stopping = 1;
+  if(esp_bluedroid_get_status() == ESP_BLUEDROID_STATUS_ENABLED)
+  {
+    esp_ble_gap_stop_advertising();
+    if(prov_connected)
+      esp_ble_gatts_close(prov_gatts_if, prov_conn_id);
+    if(prov_gatts_if != ESP_GATT_IF_NONE)
+      esp_ble_gatts_app_unregister(prov_gatts_if);
+    esp_bluedroid_disable();
+  }
+  if(esp_bluedroid_get_status() == ESP_BLUEDROID_STATUS_INITIALIZED)
+    esp_bluedroid_deinit();
+  if(esp_bt_controller_get_status() == ESP_BT_CONTROLLER_STATUS_ENABLED)
+    esp_bt_controller_disable();
+  if(esp_bt_controller_get_status() == ESP_BT_CONTROLLER_STATUS_INITED)
+    esp_bt_controller_deinit();
+  esp_bt_controller_mem_release(ESP_BT_MODE_BTDM);
+
+  portENTER_CRITICAL(&prov_mux);
+  prov_stats.running = 0;
+  prov_stats.released = 1;
+  prov_stats.heap_recovered = esp_get_free_heap_size() - free_before;
+  portEXIT_CRITICAL(&prov_mux);
+
+  ESP_LOGI(TAG_BLE_PROV, "BLE down, %u bytes back in the heap", prov_stats.heap_recovered);
+}
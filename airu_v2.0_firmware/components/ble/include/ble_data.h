@@ -0,0 +1,129 @@
+/*
+*	ble_data.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Sensor data over BLE.
+*
+*   A provisioned node keeps a history of BLE_DATA_PERIOD_S means of every
+*   sensor stream, BLE_DATA_HISTORY_BLOCKS blocks of record.h records in a
+*   ring (about a day of them), and advertises as BLE_PROV_DEVICE_NAME with
+*   one GATT service:
+*
+*     records   notify only. Every notification is one complete record.h
+*               block, as long as the MTU allows (MTU - 3 bytes).
+*
+*   Writing 0x0001 to the records CCCD starts the stream:
+*
+*     1. the whole history, oldest first, re-packed into MTU sized blocks
+*     2. an empty block (count 0): the history is done
+*     3. raw samples as they come, a block once it is full or the oldest
+*        sample in it is BLE_DATA_LIVE_MS old
+*
+*   Writing 0x0000, or dropping the link, stops it; the next subscription
+*   starts at the history again. A client has to raise the MTU to
+*   BLE_DATA_MTU_MIN before subscribing, or nothing is sent.
+*
+*   One notification is in the stack at a time. Bluedroid drops a
+*   notification on a congested link and says so in its CONF event; it is
+*   sent again once the link reports it is no longer congested.
+*
+*   ble_data and provisioning (ble_prov.h) are not up together: a node
+*   that has never been provisioned runs provisioning, which gives the
+*   Bluetooth memory to the heap when it is done.
+*/
+
+#ifndef _BLE_DATA_H
+#define _BLE_DATA_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sensor.h"
+#include "record.h"
+
+static const char *TAG_BLE_DATA = "BLE_DATA";
+
+#define BLE_DATA_ENABLED          1
+#define BLE_DATA_SERVICE_UUID     0x00FE
+#define BLE_DATA_RECORDS_UUID     0xFE01
+#define BLE_DATA_PERIOD_S         60        // History keeps one mean per stream per period
+#define BLE_DATA_HISTORY_BLOCKS   64
+#define BLE_DATA_BLOCK_LEN        512       // History block, record.h
+#define BLE_DATA_LIVE_QUEUE       32        // Raw samples waiting to go out
+#define BLE_DATA_LIVE_MS          1000
+#define BLE_DATA_CONF_MS          1000      // A CONF event is always this quick while connected
+#define BLE_DATA_LOCAL_MTU        500
+#define BLE_DATA_MTU_MIN          (RECORD_OVERHEAD + RECORD_MAX_LEN + 3)
+#define BLE_DATA_TASK_STACK       4096
+#define BLE_DATA_TASK_PRIO        4
+
+
+/*
+* @brief Data service statistics
+*/
+typedef struct
+{
+  uint8_t running;          // BLE is up
+  uint8_t subscribed;       // A client is taking the stream
+  uint16_t mtu;             // Negotiated with the last client
+  uint32_t connects;        // Clients that connected...
+  uint32_t subscriptions;   // ...and subscribed
+  uint32_t mtu_refused;     // Subscriptions below BLE_DATA_MTU_MIN
+  uint32_t records_stored;  // Means in the history
+  uint32_t history_bytes;
+  uint32_t history_s;       // Oldest to newest mean
+  uint32_t notifications;   // Blocks sent...
+  uint32_t bytes;           // ...their bytes...
+  uint32_t records;         // ...and records, history and live
+  uint32_t congested;       // Times the link reported congestion
+  uint32_t resends;         // Notifications dropped on a congested link and sent again
+  uint32_t live_dropped;    // Raw samples the live queue had no room for
+  uint32_t backlog_records; // Last history sent: records,
+  uint32_t backlog_bytes;   // bytes
+  uint32_t backlog_ms;      // and time from subscribing to the empty block
+  uint32_t heap_used;       // Free heap BLE took when it came up
+} ble_data_stats_t;
+
+
+/*
+* @brief Allocates the history and adds the sensor sink that fills it.
+*        Has to be called before sensor_start().
+*
+* @return ESP_OK, ESP_ERR_NO_MEM, or the sensor_add_sink() error
+*/
+esp_err_t ble_data_init();
+
+/*
+* @brief Takes one sample into the history, and the live stream if a client
+*        is subscribed. This is the sensor sink; the bench fills the history
+*        with it directly.
+*
+* @param sample - sample from the sensor task
+*
+* @return void
+*/
+void ble_data_add(const sensor_sample_t *sample);
+
+/*
+* @brief Brings BLE up with the data service and starts the task that
+*        streams to subscribers. BLE stays up until reset.
+*
+* @return ESP_OK, ESP_ERR_INVALID_STATE if ble_data_init() has not been
+*         called or this has been already, or the Bluetooth error
+*/
+esp_err_t ble_data_start();
+
+/*
+* @brief Copies the statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void ble_data_get_stats(ble_data_stats_t *stats);
+
+#endif
@@ -0,0 +1,112 @@
+/*
+*	ble_prov.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   WiFi provisioning over BLE.
+*
+*   A node with no settings stored (settings.h) advertises as
+*   BLE_PROV_DEVICE_NAME with one GATT service:
+*
+*     credentials  write only. "ssid=...\npassword=..." as NAME=VALUE
+*                  lines of settings_store.h; no other field is taken,
+*                  as the write needs no pairing. Long (prepared) writes
+*                  are taken, so the value need not fit the MTU.
+*     status       read and notify, one byte of ble_prov_status_t.
+*
+*   A write sets a bit in an event group that the provisioning task waits
+*   on. The task commits the settings, hands them to the WiFi connection
+*   manager (wifi_reconnect()) and notifies the outcome. A connect that
+*   fails leaves the service up for another write. Once connected, or
+*   after BLE_PROV_WINDOW_S with no good write, the task takes Bluedroid
+*   and the controller down and gives the controller's memory to the heap
+*   with esp_bt_controller_mem_release(). BLE cannot be started again
+*   until the next reset.
+*
+*   The password can't be read back over GATT and is never logged.
+*/
+
+#ifndef _BLE_PROV_H
+#define _BLE_PROV_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+static const char *TAG_BLE_PROV = "BLE_PROV";
+
+#define BLE_PROV_ENABLED            1
+#define BLE_PROV_DEVICE_NAME        "AirU"
+#define BLE_PROV_SERVICE_UUID       0x00FF
+#define BLE_PROV_CREDENTIALS_UUID   0xFF01
+#define BLE_PROV_STATUS_UUID        0xFF02
+#define BLE_PROV_CRED_MAX           256       // Longest credentials write
+#define BLE_PROV_WINDOW_S           600       // Advertising with nothing written before giving up
+#define BLE_PROV_CONNECT_MS         30000     // WiFi connect after a write
+#define BLE_PROV_NOTIFY_MS          2000      // Wait for the last status to go out
+#define BLE_PROV_TASK_STACK         3072
+#define BLE_PROV_TASK_PRIO          5
+
+
+/*
+* @brief Value of the status characteristic
+*/
+typedef enum
+{
+  BLE_PROV_WAITING = 0,     // Nothing written yet
+  BLE_PROV_CONNECTING,      // Settings committed, WiFi connecting with them
+  BLE_PROV_CONNECTED,       // Connected; BLE is going down
+  BLE_PROV_BAD_VALUE,       // Not ssid/password lines, or a value out of its limits
+  BLE_PROV_FAILED           // No connection within BLE_PROV_CONNECT_MS
+} ble_prov_status_t;
+
+/*
+* @brief Provisioning statistics
+*/
+typedef struct
+{
+  ble_prov_status_t status;
+  uint8_t running;          // BLE is up
+  uint8_t released;         // Controller memory given to the heap
+  uint16_t mtu;             // Negotiated with the last client
+  uint32_t connects;        // Clients that connected
+  uint32_t writes;          // Credential writes...
+  uint32_t bad_writes;      // ...that were refused
+  uint32_t failures;        // WiFi connects that failed
+  uint32_t connect_ms;      // Write to WiFi connected...
+  uint32_t latency_ms;      // ...and to the client told so
+  uint32_t heap_used;       // Free heap BLE took when it came up
+  uint32_t heap_recovered;  // Free heap gained by taking it down
+} ble_prov_stats_t;
+
+
+/*
+* @brief Brings BLE up with the provisioning service and starts the task
+*        that waits for credentials.
+*
+* @return ESP_OK, ESP_ERR_INVALID_STATE if provisioning has run already
+*         since reset, or the Bluetooth error
+*/
+esp_err_t ble_prov_start();
+
+/*
+* @brief Gives the controller's memory to the heap without bringing BLE
+*        up, for a node that has been provisioned already.
+*
+* @return ESP_OK, or ESP_ERR_INVALID_STATE if provisioning is running
+*/
+esp_err_t ble_prov_release();
+
+/*
+* @brief Copies the statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void ble_prov_get_stats(ble_prov_stats_t *stats);
+
+#endif
@@ -0,0 +1,202 @@
+/*
+*	duty.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "duty.h"
+
+
+/*
+* @brief Starts a cycle. See duty.h.
+*/
+void duty_begin(duty_state_t *state, const duty_config_t *config, duty_plan_t *plan)
+{
+  uint32_t every = (config->uplink_every > 0) ? config->uplink_every : 1;
+
+  // RTC memory holds garbage after power on, start over.
+  if(state->magic != DUTY_STATE_MAGIC || state->count > DUTY_RTC_RECORDS ||
+     state->head >= DUTY_RTC_RECORDS)
+  {
+    memset(state, 0, sizeof(*state));
+    state->magic = DUTY_STATE_MAGIC;
+  }
+
+  memset(state->phase_end_us, 0, sizeof(state->phase_end_us));
+  memset(state->sum, 0, sizeof(state->sum));
+  state->frames = 0;
+  state->utc_us = 0;
+  state->temp = PM_TEMP_NONE;
+  state->hum = PM_HUM_NONE;
+  state->records_sent = 0;
+  state->data_age_s = 0;
+
+  plan->cycle = state->cycle;
+  plan->warmup_ms = config->sensor_switched ? config->warmup_ms : 0;
+  plan->deadline_ms = plan->warmup_ms + config->sample_timeout_ms;
+
+  // Send on every uplink_every-th cycle, or early so this cycle's record
+  // does not push out one that was never sent.
+  plan->uplink = (state->cycle % every == every - 1) ||
+                 (state->count >= DUTY_RTC_RECORDS - 1);
+}
+
+
+/*
+* @brief Marks the end of a phase. See duty.h.
+*/
+void duty_phase(duty_state_t *state, duty_phase_t phase, int64_t now_us)
+{
+  if(phase < DUTY_NUM_PHASES)
+    state->phase_end_us[phase] = now_us;
+}
+
+
+/*
+* @brief Adds a frame to the cycle average. See duty.h.
+*/
+int duty_add_frame(duty_state_t *state, const duty_config_t *config, const pm_sample_t *sample)
+{
+  if(state->frames < config->frames)
+  {
+    state->sum[0] += sample->pm1;
+    state->sum[1] += sample->pm2_5;
+    state->sum[2] += sample->pm10;
+    state->utc_us = sample->utc_us;
+    state->temp = sample->temp;
+    state->hum = sample->hum;
+    state->frames++;
+  }
+
+  return state->frames >= config->frames;
+}
+
+
+/*
+* @brief Stores the cycle average. See duty.h.
+*/
+void duty_store(duty_state_t *state)
+{
+  pm_sample_t *rec;
+  uint32_t half = state->frames / 2;
+
+  if(state->frames == 0)
+    return;
+
+  if(state->count == DUTY_RTC_RECORDS)
+  {
+    state->head = (state->head + 1) % DUTY_RTC_RECORDS;
+    state->count--;
+    state->records_lost++;
+  }
+
+  rec = &state->records[(state->head + state->count) % DUTY_RTC_RECORDS];
+  rec->time_us = state->time_us + state->phase_end_us[DUTY_SAMPLE];
+  rec->utc_us = state->utc_us;
+  rec->seq = state->cycle;
+  rec->channel = 0;
+  rec->pm1 = (state->sum[0] + half) / state->frames;
+  rec->pm2_5 = (state->sum[1] + half) / state->frames;
+  rec->pm10 = (state->sum[2] + half) / state->frames;
+  rec->temp = state->temp;
+  rec->hum = state->hum;
+  state->count++;
+}
+
+
+/*
+* @brief Copies the stored records. See duty.h.
+*/
+size_t duty_records(const duty_state_t *state, pm_sample_t *out, size_t max)
+{
+  size_t n = (state->count < max) ? state->count : max;
+  size_t i;
+
+  for(i = 0; i < n; i++)
+  {
+    out[i] = state->records[(state->head + i) % DUTY_RTC_RECORDS];
+  }
+
+  return n;
+}
+
+
+/*
+* @brief Drops records that have been sent. See duty.h.
+*/
+void duty_ack_records(duty_state_t *state, size_t n, int64_t now_us)
+{
+  if(n > state->count)
+    n = state->count;
+  if(n == 0)
+    return;
+
+  state->data_age_s = (uint32_t) ((state->time_us + now_us - state->records[state->head].time_us) / 1000000);
+  state->records_sent += n;
+  state->head = (state->head + n) % DUTY_RTC_RECORDS;
+  state->count -= n;
+}
+
+
+/*
+* @brief Ends the cycle. See duty.h.
+*/
+uint64_t duty_end(duty_state_t *state, const duty_config_t *config, const duty_power_t *power,
+                  int64_t now_us, duty_report_t *report)
+{
+  uint64_t period_us = (uint64_t) config->period_s * 1000000;
+  uint64_t awake_us = (uint64_t) power->boot_ms * 1000 + now_us;
+  uint64_t sleep_us;
+  uint64_t sensor_us;
+  uint64_t charge_pc;     // uA * us
+  int64_t prev = 0;
+  int i;
+
+  memset(report, 0, sizeof(*report));
+  report->cycle = state->cycle;
+
+  // Skipped phases keep the end time of the phase before them.
+  for(i = 0; i < DUTY_NUM_PHASES; i++)
+  {
+    if(state->phase_end_us[i] > prev)
+    {
+      report->phase_us[i] = (uint32_t) (state->phase_end_us[i] - prev);
+      prev = state->phase_end_us[i];
+    }
+  }
+
+  // Keep the wake ups period_s apart however long the cycle took.
+  if(awake_us + (uint64_t) DUTY_MIN_SLEEP_MS * 1000 > period_us)
+    sleep_us = (uint64_t) DUTY_MIN_SLEEP_MS * 1000;
+  else
+    sleep_us = period_us - awake_us;
+
+  if(config->sensor_switched)
+    sensor_us = (uint64_t) power->boot_ms * 1000 + report->phase_us[DUTY_WARMUP] + report->phase_us[DUTY_SAMPLE];
+  else
+    sensor_us = awake_us + sleep_us;
+
+  charge_pc = (uint64_t) power->active_ua * awake_us +
+              (uint64_t) power->sensor_ua * sensor_us +
+              (uint64_t) power->wifi_ua * report->phase_us[DUTY_UPLINK] +
+              (uint64_t) power->sleep_ua * sleep_us;
+
+  report->awake_us = (uint32_t) awake_us;
+  report->sleep_us = (uint32_t) sleep_us;
+  report->frames = state->frames;
+  report->uplinked = (report->phase_us[DUTY_UPLINK] > 0);
+  report->records_sent = state->records_sent;
+  report->data_age_s = state->data_age_s;
+  report->charge_uc = (uint32_t) (charge_pc / 1000000);
+  report->energy_uj = (uint32_t) (charge_pc / 1000000 * power->supply_mv / 1000);
+  report->avg_ua = (uint32_t) (charge_pc / (awake_us + sleep_us));
+
+  state->energy_uj += report->energy_uj;
+  state->time_us += awake_us + sleep_us;
+  state->cycle++;
+
+  return sleep_us;
+}
@@ -0,0 +1,192 @@
+/*
+*	duty_esp.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Deep sleep duty cycle on the node. The state lives in RTC slow memory so
+*   the stored records survive deep sleep; everything else starts from
+*   scratch on every wake up.
+*/
+#ifdef ESP_PLATFORM
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+#include "duty.h"
+#include "pm_if.h"
+#include "sensor.h"
+#include "hdc1080.h"
+#include "internet_if.h"
+#include "uplink.h"
+
+static const char *TAG_DUTY = "DUTY";
+
+#define DUTY_POLL_MS  100
+
+
+/* Function prototypes */
+static void sample(const duty_config_t *config, const duty_plan_t *plan);
+static void send_records(const duty_config_t *config);
+
+/* Global variables */
+static RTC_DATA_ATTR duty_state_t duty_state;
+static pm_ring_t duty_ring;
+static pm_sample_t duty_out[DUTY_RTC_RECORDS];
+
+
+/*
+* @brief Runs one cycle and goes to deep sleep. See duty.h.
+*/
+void duty_run(const duty_config_t *config)
+{
+  duty_config_t defaults = DUTY_CONFIG_DEFAULT();
+  duty_power_t power = DUTY_POWER_DEFAULT();
+  const pm_channel_config_t pm_channels[PM_MAX_CHANNELS] = PM_CHANNELS;
+  const pm_power_config_t pm_awake = { 0, 0, 0, 0 };
+  int8_t set_pin = pm_channels[0].set_pin;
+  const pm_sample_t *settling;
+  duty_plan_t plan;
+  duty_report_t report;
+  uint64_t sleep_us;
+  size_t n;
+
+  if(config == NULL)
+    config = &defaults;
+
+  duty_begin(&duty_state, config, &plan);
+
+  // Release the hold from the last sleep and wake the sensor up.
+  if(set_pin != PM_NO_PIN)
+  {
+    gpio_deep_sleep_hold_dis();
+    gpio_hold_dis(set_pin);
+    gpio_set_direction(set_pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(set_pin, 1);
+  }
+
+  // The cycle is the sleep schedule here, so keep the fan running until
+  // the sensor is switched off below.
+  pm_ring_init(&duty_ring);
+  PM_set_power(&pm_awake);
+  PM_init();
+  PM_add_consumer(&duty_ring);
+  hdc1080_i2c_start();
+  sensor_start();
+
+  if(plan.warmup_ms > 0)
+    vTaskDelay(plan.warmup_ms / portTICK_PERIOD_MS);
+  // Frames that came in while the sensor was settling don't count. The
+  // sensor task is pushing by now, so they are taken out from this side;
+  // only the producer may reset the ring.
+  while((n = pm_ring_peek(&duty_ring, &settling)) > 0)
+    pm_ring_release(&duty_ring, n);
+  duty_phase(&duty_state, DUTY_WARMUP, esp_timer_get_time());
+
+  sample(config, &plan);
+  duty_phase(&duty_state, DUTY_SAMPLE, esp_timer_get_time());
+  duty_store(&duty_state);
+
+  // SET is a digital pad: its hold only lasts through deep sleep with the
+  // digital pad hold on as well.
+  if(config->sensor_switched && set_pin != PM_NO_PIN)
+  {
+    gpio_set_level(set_pin, 0);
+    gpio_hold_en(set_pin);
+    gpio_deep_sleep_hold_en();
+  }
+
+  if(plan.uplink)
+  {
+    send_records(config);
+    duty_phase(&duty_state, DUTY_UPLINK, esp_timer_get_time());
+  }
+
+  sleep_us = duty_end(&duty_state, config, &power, esp_timer_get_time(), &report);
+
+  ESP_LOGI(TAG_DUTY, "cycle %u: warmup %u ms, sample %u ms (%u frames), uplink %u ms (%u records, %u s old), "
+           "avg %u uA, %u uJ, sleep %u ms",
+           report.cycle, report.phase_us[DUTY_WARMUP] / 1000, report.phase_us[DUTY_SAMPLE] / 1000,
+           report.frames, report.phase_us[DUTY_UPLINK] / 1000, report.records_sent, report.data_age_s,
+           report.avg_ua, report.energy_uj, report.sleep_us / 1000);
+
+  esp_sleep_enable_timer_wakeup(sleep_us);
+  esp_deep_sleep_start();
+}
+
+
+/*
+* @brief Averages channel 0 frames from the PM ring until enough have come in or the
+*        deadline passes.
+*
+* @param config - duty cycle settings
+* @param plan   - this cycle's plan
+*
+* @return void
+*
+*/
+static void sample(const duty_config_t *config, const duty_plan_t *plan)
+{
+  pm_sample_t s;
+  int64_t deadline_us = (int64_t) plan->deadline_ms * 1000;
+
+  while(esp_timer_get_time() < deadline_us)
+  {
+    while(pm_ring_pop(&duty_ring, &s, 1) == 1)
+    {
+      // A duty record holds one reading; it comes from the first sensor.
+      if(s.channel != 0)
+        continue;
+      if(duty_add_frame(&duty_state, config, &s))
+        return;
+    }
+    vTaskDelay(DUTY_POLL_MS / portTICK_PERIOD_MS);
+  }
+}
+
+
+/*
+* @brief Brings WiFi up, sends the stored records and shuts WiFi down.
+*        Records stay in RTC memory for the next uplink cycle if anything
+*        fails.
+*
+* @param config - duty cycle settings
+*
+* @return void
+*
+*/
+static void send_records(const duty_config_t *config)
+{
+  uplink_config_t uplink_config = UPLINK_CONFIG_DEFAULT();
+  size_t n;
+
+  if(config->url != NULL)
+    uplink_config.url = config->url;
+
+  wifi_start_sta();
+
+  if(wifi_wait_connected(DUTY_UPLINK_TIMEOUT_MS / portTICK_PERIOD_MS) == ESP_OK)
+  {
+    n = duty_records(&duty_state, duty_out, DUTY_RTC_RECORDS);
+    if(n > 0 && uplink_send_samples(&uplink_config, duty_out, n) == ESP_OK)
+      duty_ack_records(&duty_state, n, esp_timer_get_time());
+    else
+      ESP_LOGW(TAG_DUTY, "uplink failed, keeping %u records", (unsigned) n);
+  }
+  else
+  {
+    ESP_LOGW(TAG_DUTY, "no IP after %u ms", DUTY_UPLINK_TIMEOUT_MS);
+  }
+
+  wifi_stop();
+}
+
+#endif
@@ -0,0 +1,72 @@
+/*
+*	duty_sim.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Simulated duty cycle for a host. Walks one cycle through the same calls
+*   duty_run() makes, advancing a fake clock instead of waiting, so schedules
+*   and current models can be compared from the per-cycle reports.
+*/
+#ifndef ESP_PLATFORM
+
+#include "duty.h"
+
+
+/*
+* @brief Runs one simulated cycle. See duty.h.
+*/
+void duty_sim(duty_state_t *state, const duty_config_t *config, const duty_power_t *power,
+              const duty_sim_t *sim, duty_report_t *report)
+{
+  duty_plan_t plan;
+  pm_sample_t sample;
+  pm_sample_t out[DUTY_RTC_RECORDS];
+  uint32_t every = (config->uplink_every > 0) ? config->uplink_every : 1;
+  uint32_t frame = 0;
+  int64_t now = 0;
+  size_t n;
+
+  duty_begin(state, config, &plan);
+
+  now += (int64_t) plan.warmup_ms * 1000;
+  duty_phase(state, DUTY_WARMUP, now);
+
+  while(now + (int64_t) sim->frame_interval_ms * 1000 <= (int64_t) plan.deadline_ms * 1000)
+  {
+    now += (int64_t) sim->frame_interval_ms * 1000;
+    frame++;
+    if(sim->frame_error_every > 0 && frame % sim->frame_error_every == 0)
+      continue;
+
+    sample.time_us = now;
+    sample.utc_us = 0;
+    sample.seq = frame;
+    sample.channel = 0;
+    sample.pm1 = sim->pm2_5 / 2;
+    sample.pm2_5 = sim->pm2_5;
+    sample.pm10 = sim->pm2_5 + sim->pm2_5 / 2;
+    sample.temp = PM_TEMP_NONE;
+    sample.hum = PM_HUM_NONE;
+    if(duty_add_frame(state, config, &sample))
+      break;
+  }
+  duty_phase(state, DUTY_SAMPLE, now);
+  duty_store(state);
+
+  if(plan.uplink)
+  {
+    now += (int64_t) (sim->wifi_connect_ms + sim->post_ms) * 1000;
+    n = duty_records(state, out, DUTY_RTC_RECORDS);
+    if(sim->uplink_fail_every == 0 || (plan.cycle / every + 1) % sim->uplink_fail_every != 0)
+      duty_ack_records(state, n, now);
+    duty_phase(state, DUTY_UPLINK, now);
+  }
+
+  duty_end(state, config, power, now, report);
+}
+
+#endif
@@ -0,0 +1,308 @@
+/*
+*	duty.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Deep sleep duty cycle.
+*
+*   Instead of running the sensor task and WiFi all the time the node can
+*   wake up once every period_s, let the PM sensor warm up, average 'frames'
+*   valid frames into one record, keep the record in RTC slow memory and go
+*   back to deep sleep. Every uplink_every cycles (or sooner if the RTC buffer is
+*   nearly full) the cycle also brings WiFi up and sends the stored records.
+*
+*   A cycle looks like:
+*
+*     duty_begin()        after wake up, returns what this cycle has to do
+*     duty_phase()        at the end of warm up, sampling and uplink
+*     duty_add_frame()    for every valid frame while sampling
+*     duty_store()        once sampling is over
+*     duty_records() / duty_ack_records()   on uplink cycles
+*     duty_end()          works out the sleep time and the cycle report
+*
+*   All times are passed in, so the same code runs against esp_timer on the
+*   node and against a simulated clock on a host (see duty_sim(), and
+*   pm_bench -s duty, which runs a day of cycles per schedule). Each cycle
+*   produces a duty_report_t with the time spent in every phase and the
+*   charge and energy used according to a duty_power_t current model.
+*
+*   With sensor_switched the PMS3003 is put to sleep through its SET pin
+*   (IO5) for the deep sleep. IO5 is a digital pad, not an RTC GPIO, so
+*   gpio_hold_en() alone lets it float once the chip is asleep; duty_run()
+*   also enables gpio_deep_sleep_hold_en() and releases both on wake up.
+*
+*   duty.c has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _DUTY_H
+#define _DUTY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "pm_ring.h"
+
+#define DUTY_ENABLED            0       // 1: app_main runs the deep sleep duty cycle
+#define DUTY_PERIOD_S           60      // Wake up once a minute
+#define DUTY_WARMUP_MS          30000   // PMS3003 settling time after power up
+#define DUTY_FRAMES             5       // Valid frames averaged per record
+#define DUTY_SAMPLE_TIMEOUT_MS  10000   // Give up sampling after this long
+#define DUTY_UPLINK_EVERY       15      // Bring WiFi up every 15 cycles
+#define DUTY_UPLINK_TIMEOUT_MS  15000   // Max time to wait for an IP
+#define DUTY_MIN_SLEEP_MS       1000
+#define DUTY_RTC_RECORDS        64      // Records kept in RTC slow memory
+#define DUTY_STATE_MAGIC        0x44555459  // "DUTY"
+
+// Default current model for the AirU board, in uA
+#define DUTY_SLEEP_UA           150     // ESP32 deep sleep plus regulator
+#define DUTY_ACTIVE_UA          40000   // CPU at 160 MHz, radio off
+#define DUTY_SENSOR_UA          100000  // PMS3003 fan and laser
+#define DUTY_WIFI_UA            80000   // Extra while WiFi is up
+#define DUTY_BOOT_MS            300     // Wake stub to app_main
+#define DUTY_SUPPLY_MV          3300
+
+
+/*
+* @brief Phases of a cycle, in order
+*/
+typedef enum
+{
+  DUTY_WARMUP = 0,
+  DUTY_SAMPLE,
+  DUTY_UPLINK,
+  DUTY_NUM_PHASES
+} duty_phase_t;
+
+/*
+* @brief Duty cycle settings
+*/
+typedef struct
+{
+  uint32_t period_s;            // Time between wake ups
+  uint32_t warmup_ms;           // Sensor settling time at the start of a cycle
+  uint16_t frames;              // Frames averaged per record
+  uint32_t sample_timeout_ms;   // Max sampling time after warm up
+  uint16_t uplink_every;        // Cycles between uplinks
+  uint8_t sensor_switched;      // 1 if the sensor is put to sleep (SET held low) while asleep
+  const char *url;              // Uplink endpoint, NULL for UPLINK_DEFAULT_URL
+} duty_config_t;
+
+#define DUTY_CONFIG_DEFAULT() {                   \
+    .period_s = DUTY_PERIOD_S,                    \
+    .warmup_ms = DUTY_WARMUP_MS,                  \
+    .frames = DUTY_FRAMES,                        \
+    .sample_timeout_ms = DUTY_SAMPLE_TIMEOUT_MS,  \
+    .uplink_every = DUTY_UPLINK_EVERY,            \
+    .sensor_switched = 0,                         \
+    .url = NULL                                   \
+}
+
+/*
+* @brief Current model used for the energy report
+*/
+typedef struct
+{
+  uint32_t sleep_ua;
+  uint32_t active_ua;
+  uint32_t sensor_ua;
+  uint32_t wifi_ua;
+  uint32_t boot_ms;
+  uint16_t supply_mv;
+} duty_power_t;
+
+#define DUTY_POWER_DEFAULT() {          \
+    .sleep_ua = DUTY_SLEEP_UA,          \
+    .active_ua = DUTY_ACTIVE_UA,        \
+    .sensor_ua = DUTY_SENSOR_UA,        \
+    .wifi_ua = DUTY_WIFI_UA,            \
+    .boot_ms = DUTY_BOOT_MS,            \
+    .supply_mv = DUTY_SUPPLY_MV         \
+}
+
+/*
+* @brief What the current cycle has to do
+*/
+typedef struct
+{
+  uint32_t cycle;
+  uint32_t warmup_ms;
+  uint32_t deadline_ms;         // Stop sampling at this time since wake up
+  uint8_t uplink;               // 1 if this cycle should send the records
+} duty_plan_t;
+
+/*
+* @brief Per-cycle report
+*/
+typedef struct
+{
+  uint32_t cycle;
+  uint32_t phase_us[DUTY_NUM_PHASES]; // Time spent in each phase
+  uint32_t awake_us;            // Boot plus all phases
+  uint32_t sleep_us;            // Time until the next wake up
+  uint16_t frames;              // Frames that went into the record
+  uint8_t uplinked;             // 1 if WiFi was brought up
+  uint16_t records_sent;
+  uint32_t data_age_s;          // Age of the oldest record sent, 0 if none
+  uint32_t charge_uc;           // Charge used over the whole period
+  uint32_t energy_uj;           // ...and the energy
+  uint32_t avg_ua;              // Average current over the period
+} duty_report_t;
+
+/*
+* @brief State kept in RTC slow memory across deep sleep
+*/
+typedef struct
+{
+  uint32_t magic;
+  uint32_t cycle;               // Cycles since power on
+  int64_t time_us;              // Time of this cycle's wake up since power on
+  int64_t phase_end_us[DUTY_NUM_PHASES];  // Since wake up, 0 if skipped
+
+  uint32_t frames;              // Frames averaged so far this cycle
+  uint32_t sum[3];              // PM1, PM2.5, PM10 sums this cycle
+  int64_t utc_us;               // UTC of the latest frame this cycle, 0 if none
+  int16_t temp;                 // Latest temperature and humidity this cycle
+  uint16_t hum;
+  uint16_t records_sent;
+  uint32_t data_age_s;
+
+  uint16_t head;                // Oldest record
+  uint16_t count;
+  uint32_t records_lost;        // Records overwritten before they were sent
+  pm_sample_t records[DUTY_RTC_RECORDS];
+
+  uint64_t energy_uj;           // Total since power on
+} duty_state_t;
+
+/*
+* @brief Simulated environment for duty_sim()
+*/
+typedef struct
+{
+  uint32_t frame_interval_ms;   // Time between sensor frames
+  uint32_t frame_error_every;   // Every n-th frame fails its checksum, 0 for never
+  uint32_t wifi_connect_ms;     // Time to get an IP
+  uint32_t post_ms;             // Time for the POST
+  uint32_t uplink_fail_every;   // Every n-th uplink fails, 0 for never
+  uint16_t pm2_5;               // Reading the simulated sensor returns
+} duty_sim_t;
+
+
+/*
+* @brief Starts a cycle after wake up. An invalid RTC state (power on or
+*        brown out) is reset to cycle 0.
+*
+* @param state  - RTC state
+* @param config - duty cycle settings
+* @param plan   - filled in with what this cycle has to do
+*
+* @return void
+*/
+void duty_begin(duty_state_t *state, const duty_config_t *config, duty_plan_t *plan);
+
+/*
+* @brief Marks the end of a phase.
+*
+* @param state  - RTC state
+* @param phase  - phase that just finished
+* @param now_us - time since wake up
+*
+* @return void
+*/
+void duty_phase(duty_state_t *state, duty_phase_t phase, int64_t now_us);
+
+/*
+* @brief Adds a valid frame to this cycle's average.
+*
+* @param state  - RTC state
+* @param config - duty cycle settings
+* @param sample - decoded frame
+*
+* @return 1 once config->frames frames have been collected, 0 otherwise
+*/
+int duty_add_frame(duty_state_t *state, const duty_config_t *config, const pm_sample_t *sample);
+
+/*
+* @brief Stores this cycle's average as a record. If the buffer is full the
+*        oldest record is overwritten. Does nothing if no frames came in.
+*
+* @param state  - RTC state
+*
+* @return void
+*/
+void duty_store(duty_state_t *state);
+
+/*
+* @brief Copies the stored records, oldest first, without removing them.
+*
+* @param state - RTC state
+* @param out   - output array
+* @param max   - size of the output array
+*
+* @return number of records copied
+*/
+size_t duty_records(const duty_state_t *state, pm_sample_t *out, size_t max);
+
+/*
+* @brief Removes the n oldest records once they have been sent.
+*
+* @param state  - RTC state
+* @param n      - records sent
+* @param now_us - time since wake up
+*
+* @return void
+*/
+void duty_ack_records(duty_state_t *state, size_t n, int64_t now_us);
+
+/*
+* @brief Ends the cycle: fills in the report and moves the state to the
+*        next wake up.
+*
+* @param state  - RTC state
+* @param config - duty cycle settings
+* @param power  - current model
+* @param now_us - time since wake up
+* @param report - filled in with the cycle report
+*
+* @return time to sleep in us
+*/
+uint64_t duty_end(duty_state_t *state, const duty_config_t *config, const duty_power_t *power,
+                  int64_t now_us, duty_report_t *report);
+
+
+/*
+* @brief Runs one cycle against a simulated clock and sensor, using the same
+*        calls the node makes. Host only (duty_sim.c).
+*
+* @param state  - RTC state
+* @param config - duty cycle settings
+* @param power  - current model
+* @param sim    - simulated environment
+* @param report - filled in with the cycle report
+*
+* @return void
+*/
+void duty_sim(duty_state_t *state, const duty_config_t *config, const duty_power_t *power,
+              const duty_sim_t *sim, duty_report_t *report);
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Runs one duty cycle on the node and enters deep sleep. Called from
+*        app_main on every wake up; never returns.
+*
+* @param config - duty cycle settings, or NULL for the DUTY_* defaults
+*
+* @return void
+*/
+void duty_run(const duty_config_t *config);
+
+#endif
+
+
+#endif
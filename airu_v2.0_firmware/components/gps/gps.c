@@ -0,0 +1,306 @@
+/*
+*	gps.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   L70 driver for the sensor task, see gps.h.
+*/
+#ifdef ESP_PLATFORM
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "gps.h"
+#include "sensor.h"
+#include "timesync.h"
+
+static const char *TAG_GPS = "GPS";
+
+#define GPS_OUT_LEN     4     // Sentences parsed in one poll
+
+
+/* Function prototypes */
+static esp_err_t gps_driver_init(void *ctx, void **events);
+static uint32_t gps_poll(void *ctx, int64_t now_us, int event);
+static int gps_decode(void *ctx, sensor_sample_t *sample);
+static void read_sentences(int64_t now_us);
+static void IRAM_ATTR pps_isr(void *arg);
+
+/* Global variables */
+static QueueHandle_t gps_event_queue;
+static nmea_parser_t gps_parser;              // Only used from vSensor_task
+static nmea_fix_t gps_fix;
+static volatile uint32_t gps_fix_seq;         // Odd while vSensor_task is updating gps_fix
+static gps_stats_t gps_stats;
+static volatile int64_t gps_pps_us;           // Last 1PPS edge, written by pps_isr
+
+// Samples waiting for gps_decode()
+static nmea_fix_t gps_out[GPS_OUT_LEN];
+static uint32_t gps_out_read;
+static uint32_t gps_out_count;
+
+static const sensor_field_t gps_fields[5] =
+{
+  { "lat", "deg", 10000000 },
+  { "lon", "deg", 10000000 },
+  { "alt", "m", 100 },
+  { "sats", "", 1 },
+  { "hdop", "", 100 }
+};
+static const sensor_schema_t gps_schema = { 5, gps_fields };
+static const sensor_driver_t gps_driver =
+{
+  .name = "l70",
+  .schema = &gps_schema,
+  .period_ms = 0,
+  .init = gps_driver_init,
+  .poll = gps_poll,
+  .decode = gps_decode,
+  .ctx = NULL
+};
+
+
+
+/*
+* @brief Sets up the UART and registers the driver. See gps.h.
+*/
+esp_err_t gps_start()
+{
+  esp_err_t err;
+  uart_config_t uart_config =
+  {
+    .baud_rate = GPS_BAUD,
+    .data_bits = UART_DATA_8_BITS,
+    .parity = UART_PARITY_DISABLE,
+    .stop_bits = UART_STOP_BITS_1,
+    .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+  };
+
+  nmea_init(&gps_parser);
+
+  err = uart_param_config(GPS_UART_CH, &uart_config);
+  if(err == ESP_OK)
+    err = uart_set_pin(GPS_UART_CH, GPS_TXD_PIN, GPS_RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  if(err == ESP_OK)
+    err = uart_driver_install(GPS_UART_CH, GPS_BUF_SIZE * 2, 0, GPS_QUEUE_LEN, &gps_event_queue, 0);
+  if(err != ESP_OK)
+  {
+    ESP_LOGW(TAG_GPS, "uart setup failed: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  // Without the PPS edge time keeping falls back to sentence arrival.
+  gpio_set_direction(GPS_PPS_PIN, GPIO_MODE_INPUT);
+  gpio_set_intr_type(GPS_PPS_PIN, GPIO_INTR_POSEDGE);
+  gpio_install_isr_service(0);
+  if(gpio_isr_handler_add(GPS_PPS_PIN, pps_isr, NULL) != ESP_OK)
+    ESP_LOGW(TAG_GPS, "no PPS interrupt");
+
+  return sensor_register(&gps_driver);
+}
+
+
+/*
+* @brief Copies the latest fix out. See gps.h.
+*/
+esp_err_t gps_get_fix(nmea_fix_t *fix)
+{
+  uint32_t seq;
+
+  // Sequence lock: retry if vSensor_task was in the middle of an update.
+  do
+  {
+    seq = __atomic_load_n(&gps_fix_seq, __ATOMIC_ACQUIRE);
+    *fix = gps_fix;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || seq != gps_fix_seq);
+
+  if(fix->time_us == 0)
+    return ESP_FAIL;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the GPS statistics out. See gps.h.
+*/
+void gps_get_stats(gps_stats_t *stats)
+{
+  *stats = gps_stats;
+  stats->nmea = gps_parser.stats;
+}
+
+
+/*
+* @brief Sensor driver init. Hands the UART event queue to the sensor task.
+*
+* @param ctx    - unused
+* @param events - set to the UART event queue
+*
+* @return ESP_OK
+*
+*/
+static esp_err_t gps_driver_init(void *ctx, void **events)
+{
+  *events = gps_event_queue;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sensor driver poll. Handles one UART event.
+*
+* @param ctx    - unused
+* @param now_us - current time
+* @param event  - 1 if gps_event_queue has an item
+*
+* @return SENSOR_NEXT_PERIOD
+*
+*/
+static uint32_t gps_poll(void *ctx, int64_t now_us, int event)
+{
+  uart_event_t uart_event;
+
+  if(!event || !xQueueReceive(gps_event_queue, (void * )&uart_event, 0))
+    return SENSOR_NEXT_PERIOD;
+
+  switch(uart_event.type)
+  {
+    case UART_DATA:
+      read_sentences(now_us);
+      break;
+
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      // The partial sentence is lost; the parser resyncs on the next '$'.
+      gps_stats.overflows++;
+      uart_flush_input(GPS_UART_CH);
+      xQueueReset(gps_event_queue);
+      break;
+
+    default:
+      ESP_LOGD(TAG_GPS, "uart event type: %d", uart_event.type);
+      break;
+  }
+
+  return SENSOR_NEXT_PERIOD;
+}
+
+
+/*
+* @brief Sensor driver decode. Hands out one sample per GGA or RMC.
+*
+* @param ctx    - unused
+* @param sample - filled in with the next sample
+*
+* @return 1 if a sample was copied out, 0 if there are none
+*
+*/
+static int gps_decode(void *ctx, sensor_sample_t *sample)
+{
+  const nmea_fix_t *fix;
+
+  if(gps_out_read == gps_out_count)
+  {
+    gps_out_read = gps_out_count = 0;
+    return 0;
+  }
+
+  fix = &gps_out[gps_out_read++];
+  sample->time_us = fix->time_us;
+  sample->count = 5;
+  sample->values[0] = fix->lat;
+  sample->values[1] = fix->lon;
+  sample->values[2] = fix->alt_cm;
+  sample->values[3] = fix->sats;
+  sample->values[4] = fix->hdop;
+
+  return 1;
+}
+
+
+/*
+* @brief Reads all waiting bytes from the UART and parses them in place.
+*
+* @param now_us - time of the UART event
+*
+* @return void
+*
+*/
+static void read_sentences(int64_t now_us)
+{
+  uint8_t buf[GPS_BUF_SIZE];
+  const uint8_t *p;
+  size_t len;
+  int n;
+  int64_t start = esp_timer_get_time();
+  int64_t pps_us;
+  uint32_t busy;
+  nmea_type_t type;
+
+  while(1)
+  {
+    n = uart_read_bytes(GPS_UART_CH, buf, sizeof(buf), 0);
+    if(n <= 0)
+      break;
+
+    gps_stats.bytes += n;
+    p = buf;
+    len = n;
+    while((type = nmea_next(&gps_parser, &p, &len, now_us)) != NMEA_NONE)
+    {
+      if(type == NMEA_OTHER)
+        continue;
+
+      if((type == NMEA_RMC || type == NMEA_ZDA) && gps_parser.fix.year != 0)
+      {
+        // 64 bit reads aren't atomic; reread if the ISR got in between.
+        do
+        {
+          pps_us = gps_pps_us;
+        } while(pps_us != gps_pps_us);
+
+        timesync_gps(now_us, pps_us, gps_parser.fix.year, gps_parser.fix.month,
+                     gps_parser.fix.day, gps_parser.fix.utc_ms);
+      }
+
+      // Sequence lock around the update, see gps_get_fix().
+      __atomic_store_n(&gps_fix_seq, gps_fix_seq + 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      gps_fix = gps_parser.fix;
+      __atomic_store_n(&gps_fix_seq, gps_fix_seq + 1, __ATOMIC_RELEASE);
+
+      if((type == NMEA_GGA || type == NMEA_RMC) && gps_parser.fix.valid && gps_out_count < GPS_OUT_LEN)
+        gps_out[gps_out_count++] = gps_parser.fix;
+    }
+
+    if(n < sizeof(buf))
+      break;
+  }
+
+  busy = (uint32_t) (esp_timer_get_time() - start);
+  gps_stats.busy_us += busy;
+  if(busy > gps_stats.worst_us)
+    gps_stats.worst_us = busy;
+}
+
+
+/*
+* @brief 1PPS rising edge: the start of a UTC second.
+*/
+static void IRAM_ATTR pps_isr(void *arg)
+{
+  gps_pps_us = esp_timer_get_time();
+  gps_stats.pps++;
+}
+
+#endif
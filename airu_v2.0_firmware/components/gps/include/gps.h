@@ -0,0 +1,88 @@
+/*
+*	gps.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Quectel L70 GPS on UART1.
+*
+*   The L70 sends its NMEA sentences once a second at 9600 baud. The UART
+*   driver's event queue is handed to the sensor task, which reads whatever
+*   bytes are waiting on every UART_DATA event and runs them through the
+*   streaming parser in nmea.c. A sample is put out for every GGA and RMC
+*   with a good checksum. Every RMC/ZDA with a date is passed to timesync,
+*   together with the time of the last 1PPS edge (GPIO34, captured in an
+*   ISR) so the clock can be disciplined to the edge rather than to the
+*   sentence's arrival.
+*
+*   The pins are the ones on the board: ESP RX on SD2 (GPIO9) and TX on SD3
+*   (GPIO10), which are free because the flash runs in DIO mode.
+*/
+
+#ifndef _GPS_H
+#define _GPS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "nmea.h"
+
+#define GPS_ENABLED     1
+#define GPS_UART_CH     UART_NUM_1
+#define GPS_TXD_PIN     10
+#define GPS_RXD_PIN     9
+#define GPS_PPS_PIN     34
+#define GPS_BAUD        9600
+#define GPS_BUF_SIZE    256
+#define GPS_QUEUE_LEN   10
+
+
+/*
+* @brief GPS statistics
+*/
+typedef struct
+{
+  uint32_t bytes;
+  uint32_t busy_us;         // Time spent reading and parsing
+  uint32_t worst_us;        // Longest single poll
+  uint32_t overflows;       // UART FIFO or ring buffer overflows
+  uint32_t pps;             // 1PPS edges
+  nmea_stats_t nmea;
+} gps_stats_t;
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Sets up UART1 and registers the GPS with the sensor task. Must be
+*        called before sensor_start().
+*
+* @param
+*
+* @return ESP_OK, or the UART driver's error
+*/
+esp_err_t gps_start();
+
+/*
+* @brief Copies the latest fix out.
+*
+* @param fix - filled in with the fix
+*
+* @return ESP_OK, ESP_FAIL if no sentence has been parsed yet
+*/
+esp_err_t gps_get_fix(nmea_fix_t *fix);
+
+/*
+* @brief Copies the GPS statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void gps_get_stats(gps_stats_t *stats);
+
+#endif
+
+#endif
@@ -0,0 +1,134 @@
+/*
+*	nmea.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Streaming NMEA 0183 parser for the L70 GPS.
+*
+*   Bytes are fed in as they come out of uart_read_bytes() and each byte is
+*   looked at once. There is no line buffer: the checksum is XORed up as
+*   the sentence goes by, and each field is parsed into an integer
+*   accumulator as its characters arrive. When a field ends, its value goes
+*   into a pending fix. The pending values are only copied to the fix if
+*   the sentence's checksum matches, so a corrupted sentence changes
+*   nothing. No sscanf, no floating point and no heap.
+*
+*   GGA (position, altitude, quality), RMC (position, speed, course, date)
+*   and ZDA (date and time) are decoded; other sentences are checksummed
+*   and skipped.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host;
+*   host/bench/pm_bench.c (-s nmea) runs it on a generated capture.
+*/
+
+#ifndef _NMEA_H
+#define _NMEA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define NMEA_MAX_LEN      82    // Longest sentence the standard allows, '$' to LF
+#define NMEA_COORD_DEC    4     // Minute decimals kept from lat/lon fields
+
+
+/*
+* @brief Sentences the parser understands
+*/
+typedef enum
+{
+  NMEA_NONE = 0,
+  NMEA_GGA,
+  NMEA_RMC,
+  NMEA_ZDA,
+  NMEA_OTHER
+} nmea_type_t;
+
+/*
+* @brief Latest fix, built up from GGA, RMC and ZDA
+*/
+typedef struct
+{
+  int64_t time_us;          // When the sentence that last updated it ended
+  uint32_t utc_ms;          // UTC time of day in ms
+  uint16_t year;            // 0 until a date has been seen
+  uint8_t month;
+  uint8_t day;
+  uint8_t valid;            // 1 if the receiver reports a fix
+  uint8_t quality;          // GGA fix quality, 0 = none
+  uint8_t sats;
+  uint16_t hdop;            // 0.01
+  int32_t lat;              // 1e-7 degrees, north positive
+  int32_t lon;              // 1e-7 degrees, east positive
+  int32_t alt_cm;           // Above mean sea level
+  uint32_t speed_mmps;      // Ground speed
+  uint16_t course;          // 0.01 degrees
+} nmea_fix_t;
+
+/*
+* @brief Parser statistics
+*/
+typedef struct
+{
+  uint32_t sentences;       // Sentences with a good checksum
+  uint32_t checksum_errs;
+  uint32_t overruns;        // Sentences longer than NMEA_MAX_LEN
+  uint32_t bytes_skipped;   // Bytes outside any sentence
+} nmea_stats_t;
+
+/*
+* @brief Parser state
+*/
+typedef struct
+{
+  uint8_t state;
+  uint8_t sum;              // XOR of the characters between '$' and '*'
+  uint8_t check;            // Checksum given after '*'
+  uint8_t len;              // Characters since '$'
+  uint8_t field;            // Field index, 0 is the address
+  nmea_type_t type;
+  char addr[6];             // Address field, e.g. "GPGGA"
+
+  // Field accumulator
+  int64_t mant;             // Digits seen so far
+  int8_t decimals;          // Digits after '.', -1 before it
+  uint8_t digits;
+  char letter;              // Last non-digit character in the field
+
+  nmea_fix_t pending;
+  nmea_fix_t fix;
+  nmea_stats_t stats;
+} nmea_parser_t;
+
+
+/*
+* @brief Resets the parser and clears the fix and statistics.
+*
+* @param p - parser
+*
+* @return void
+*/
+void nmea_init(nmea_parser_t *p);
+
+/*
+* @brief Pulls the next complete sentence out of a byte stream.
+*
+* Consumes bytes from *buf and advances *buf / *len past them. Call it in a
+* loop until it returns NMEA_NONE, at which point all of the input has been
+* consumed (a partial sentence is carried over to the next call).
+*
+* @param p      - parser
+* @param buf    - in/out pointer to the unread input
+* @param len    - in/out number of unread input bytes
+* @param now_us - time the bytes were read, stamped on the fix
+*
+* @return type of the sentence that just completed with a good checksum
+*         (p->fix has been updated), or NMEA_NONE when the input is used up
+*/
+nmea_type_t nmea_next(nmea_parser_t *p, const uint8_t **buf, size_t *len, int64_t now_us);
+
+
+#endif
@@ -0,0 +1,335 @@
+/*
+*	nmea.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "nmea.h"
+
+#define HUNT  0     // Waiting for '$'
+#define BODY  1     // Between '$' and '*'
+#define CK1   2     // First checksum digit
+#define CK2   3     // Second checksum digit
+
+#define MAX_DIGITS  18  // Keeps the accumulator inside int64
+
+
+/* Function prototypes */
+static void start_sentence(nmea_parser_t *p);
+static void start_field(nmea_parser_t *p);
+static void end_field(nmea_parser_t *p);
+static int64_t scaled(const nmea_parser_t *p, int8_t decimals);
+static int32_t coord(const nmea_parser_t *p);
+static int hex_value(uint8_t c);
+
+
+/*
+* @brief Resets the parser. See nmea.h.
+*/
+void nmea_init(nmea_parser_t *p)
+{
+  memset(p, 0, sizeof(*p));
+  p->state = HUNT;
+}
+
+
+/*
+* @brief Pulls the next sentence out of the stream. See nmea.h.
+*/
+nmea_type_t nmea_next(nmea_parser_t *p, const uint8_t **buf, size_t *len, int64_t now_us)
+{
+  const uint8_t *in = *buf;
+  const uint8_t *end = in + *len;
+  nmea_type_t done = NMEA_NONE;
+  uint8_t c;
+  int h;
+
+  while(in < end && done == NMEA_NONE)
+  {
+    c = *in++;
+
+    // A '$' always starts over, whatever state the last sentence was in.
+    if(c == '$')
+    {
+      if(p->state != HUNT)
+        p->stats.checksum_errs++;
+      start_sentence(p);
+      continue;
+    }
+
+    switch(p->state)
+    {
+      case HUNT:
+        p->stats.bytes_skipped++;
+        break;
+
+      case BODY:
+        if(c == '*')
+        {
+          end_field(p);
+          p->state = CK1;
+        }
+        else if(c == '\r' || c == '\n' || ++p->len > NMEA_MAX_LEN - 6)
+        {
+          // No checksum, or too long to be a sentence.
+          if(c == '\r' || c == '\n')
+            p->stats.checksum_errs++;
+          else
+            p->stats.overruns++;
+          p->state = HUNT;
+        }
+        else
+        {
+          p->sum ^= c;
+          if(c == ',')
+          {
+            end_field(p);
+            p->field++;
+            start_field(p);
+          }
+          else if(p->field == 0)
+          {
+            if(p->digits < sizeof(p->addr) - 1)
+              p->addr[p->digits++] = c;
+          }
+          else if(c >= '0' && c <= '9')
+          {
+            if(p->digits < MAX_DIGITS)
+            {
+              p->mant = p->mant * 10 + (c - '0');
+              p->digits++;
+              if(p->decimals >= 0)
+                p->decimals++;
+            }
+          }
+          else if(c == '.')
+          {
+            p->decimals = 0;
+          }
+          else
+          {
+            p->letter = c;
+          }
+        }
+        break;
+
+      case CK1:
+        h = hex_value(c);
+        if(h < 0)
+        {
+          p->stats.checksum_errs++;
+          p->state = HUNT;
+          break;
+        }
+        p->check = h << 4;
+        p->state = CK2;
+        break;
+
+      case CK2:
+        h = hex_value(c);
+        p->state = HUNT;
+        if(h < 0 || (p->check | h) != p->sum)
+        {
+          p->stats.checksum_errs++;
+          break;
+        }
+
+        p->stats.sentences++;
+        if(p->type != NMEA_OTHER)
+        {
+          p->fix = p->pending;
+          p->fix.time_us = now_us;
+        }
+        done = p->type;
+        break;
+    }
+  }
+
+  *len -= in - *buf;
+  *buf = in;
+
+  return done;
+}
+
+
+/*
+* @brief Starts a sentence after a '$'.
+*
+* @param p - parser
+*
+* @return void
+*
+*/
+static void start_sentence(nmea_parser_t *p)
+{
+  p->state = BODY;
+  p->sum = 0;
+  p->len = 0;
+  p->field = 0;
+  p->type = NMEA_OTHER;
+  memset(p->addr, 0, sizeof(p->addr));
+  p->pending = p->fix;
+  start_field(p);
+}
+
+
+/*
+* @brief Clears the field accumulator.
+*
+* @param p - parser
+*
+* @return void
+*
+*/
+static void start_field(nmea_parser_t *p)
+{
+  p->mant = 0;
+  p->decimals = -1;
+  p->digits = 0;
+  p->letter = 0;
+}
+
+
+/*
+* @brief Stores the field that just ended in the pending fix.
+*
+* @param p - parser
+*
+* @return void
+*
+*/
+static void end_field(nmea_parser_t *p)
+{
+  nmea_fix_t *f = &p->pending;
+  int64_t v;
+
+  if(p->field == 0)
+  {
+    // Talker id ("GP", "GN", ...) then the sentence formatter.
+    if(p->digits == 5 && memcmp(p->addr + 2, "GGA", 3) == 0)
+      p->type = NMEA_GGA;
+    else if(p->digits == 5 && memcmp(p->addr + 2, "RMC", 3) == 0)
+      p->type = NMEA_RMC;
+    else if(p->digits == 5 && memcmp(p->addr + 2, "ZDA", 3) == 0)
+      p->type = NMEA_ZDA;
+    return;
+  }
+
+  // Empty fields keep the last value; fix flags come from their own fields.
+  if(p->digits == 0 && p->letter == 0)
+    return;
+
+  switch(p->type)
+  {
+    case NMEA_GGA:
+      switch(p->field)
+      {
+        case 1: v = scaled(p, 3); f->utc_ms = (v / 10000000) * 3600000 + (v / 100000 % 100) * 60000 + v % 100000; break;
+        case 2: f->lat = coord(p); break;
+        case 3: if(p->letter == 'S') f->lat = -f->lat; break;
+        case 4: f->lon = coord(p); break;
+        case 5: if(p->letter == 'W') f->lon = -f->lon; break;
+        case 6: f->quality = (uint8_t) p->mant; f->valid = (p->mant > 0); break;
+        case 7: f->sats = (uint8_t) p->mant; break;
+        case 8: f->hdop = (uint16_t) scaled(p, 2); break;
+        case 9: f->alt_cm = (int32_t) ((p->letter == '-') ? -scaled(p, 2) : scaled(p, 2)); break;
+      }
+      break;
+
+    case NMEA_RMC:
+      switch(p->field)
+      {
+        case 1: v = scaled(p, 3); f->utc_ms = (v / 10000000) * 3600000 + (v / 100000 % 100) * 60000 + v % 100000; break;
+        case 2: f->valid = (p->letter == 'A'); break;
+        case 3: f->lat = coord(p); break;
+        case 4: if(p->letter == 'S') f->lat = -f->lat; break;
+        case 5: f->lon = coord(p); break;
+        case 6: if(p->letter == 'W') f->lon = -f->lon; break;
+        case 7: f->speed_mmps = (uint32_t) (scaled(p, 3) * 514444 / 1000000); break;
+        case 8: f->course = (uint16_t) scaled(p, 2); break;
+        case 9:
+          f->day = (uint8_t) (p->mant / 10000);
+          f->month = (uint8_t) (p->mant / 100 % 100);
+          f->year = (uint16_t) (2000 + p->mant % 100);
+          break;
+      }
+      break;
+
+    case NMEA_ZDA:
+      switch(p->field)
+      {
+        case 1: v = scaled(p, 3); f->utc_ms = (v / 10000000) * 3600000 + (v / 100000 % 100) * 60000 + v % 100000; break;
+        case 2: f->day = (uint8_t) p->mant; break;
+        case 3: f->month = (uint8_t) p->mant; break;
+        case 4: f->year = (uint16_t) p->mant; break;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+
+/*
+* @brief Value of the current field with a fixed number of decimals.
+*
+* @param p        - parser
+* @param decimals - decimals wanted
+*
+* @return field value * 10^decimals
+*
+*/
+static int64_t scaled(const nmea_parser_t *p, int8_t decimals)
+{
+  int64_t v = p->mant;
+  int8_t have = (p->decimals < 0) ? 0 : p->decimals;
+
+  for(; have < decimals; have++)
+    v *= 10;
+  for(; have > decimals; have--)
+    v /= 10;
+
+  return v;
+}
+
+
+/*
+* @brief Converts a (d)ddmm.mmmm field to 1e-7 degrees.
+*
+* @param p - parser
+*
+* @return unsigned coordinate, the hemisphere field sets the sign
+*
+*/
+static int32_t coord(const nmea_parser_t *p)
+{
+  int64_t v = scaled(p, NMEA_COORD_DEC);
+  int64_t deg = v / 1000000;                // 100 * 10^4
+  int64_t min = v % 1000000;                // Minutes * 10^4
+
+  return (int32_t) (deg * 10000000 + min * 1000 / 60);
+}
+
+
+/*
+* @brief Value of a hex digit.
+*
+* @param c - character
+*
+* @return 0-15, or -1 if c is not a hex digit
+*
+*/
+static int hex_value(uint8_t c)
+{
+  if(c >= '0' && c <= '9')
+    return c - '0';
+  if(c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
@@ -0,0 +1,226 @@
+/*
+*	hdc1080.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include "hdc1080.h"
+
+
+/* Function prototypes */
+static esp_err_t read_reg(hdc1080_t *dev, uint8_t reg, uint16_t *value);
+static uint32_t hdc1080_poll(void *ctx, int64_t now_us, int event);
+static int hdc1080_decode(void *ctx, sensor_sample_t *sample);
+
+static const sensor_field_t hdc1080_fields[2] =
+{
+  { "temp", "C", 100 },
+  { "hum", "%RH", 100 }
+};
+static const sensor_schema_t hdc1080_schema = { 2, hdc1080_fields };
+
+
+/*
+* @brief Checks the IDs and sets up the sensor. See hdc1080.h.
+*/
+esp_err_t hdc1080_init(hdc1080_t *dev, const hdc1080_bus_t *bus)
+{
+  const uint8_t config[3] = { HDC1080_REG_CONFIG, HDC1080_CFG_MODE >> 8, HDC1080_CFG_MODE & 0xFF };
+  uint16_t mfg;
+  uint16_t id;
+  esp_err_t err;
+
+  dev->bus = *bus;
+  dev->started_us = 0;
+  dev->retries = 0;
+  dev->ready = 0;
+  dev->stats.conversions = 0;
+  dev->stats.readings = 0;
+  dev->stats.nacks = 0;
+  dev->stats.errors = 0;
+
+  err = read_reg(dev, HDC1080_REG_MFG_ID, &mfg);
+  if(err == ESP_OK)
+    err = read_reg(dev, HDC1080_REG_DEV_ID, &id);
+  if(err != ESP_OK)
+    return err;
+  if(mfg != HDC1080_MFG_ID || id != HDC1080_DEV_ID)
+    return ESP_ERR_NOT_FOUND;
+
+  // 14 bit temperature and humidity, both measured on one trigger.
+  return dev->bus.write(dev->bus.ctx, HDC1080_ADDR, config, sizeof(config));
+}
+
+
+/*
+* @brief Starts a conversion. See hdc1080.h.
+*/
+esp_err_t hdc1080_start(hdc1080_t *dev, int64_t now_us)
+{
+  const uint8_t reg = HDC1080_REG_TEMP;
+  esp_err_t err;
+
+  err = dev->bus.write(dev->bus.ctx, HDC1080_ADDR, &reg, 1);
+  if(err != ESP_OK)
+    return err;
+
+  dev->started_us = now_us;
+  dev->retries = 0;
+  dev->stats.conversions++;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Reads back a conversion. See hdc1080.h.
+*/
+esp_err_t hdc1080_collect(hdc1080_t *dev, int64_t now_us, hdc1080_reading_t *reading)
+{
+  uint8_t buf[4];
+
+  if(dev->started_us == 0)
+    return ESP_FAIL;
+
+  if(dev->bus.read(dev->bus.ctx, HDC1080_ADDR, buf, sizeof(buf)) != ESP_OK)
+  {
+    dev->stats.nacks++;
+    if(++dev->retries < HDC1080_MAX_RETRIES)
+      return ESP_ERR_TIMEOUT;
+
+    dev->stats.errors++;
+    dev->started_us = 0;
+    return ESP_FAIL;
+  }
+
+  reading->time_us = dev->started_us + (now_us - dev->started_us) / 2;
+  reading->temp = hdc1080_temp(((uint16_t) buf[0] << 8) | buf[1]);
+  reading->hum = hdc1080_hum(((uint16_t) buf[2] << 8) | buf[3]);
+  dev->started_us = 0;
+  dev->stats.readings++;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Fills in the sensor driver. See hdc1080.h.
+*/
+void hdc1080_driver(hdc1080_t *dev, sensor_driver_t *driver, uint32_t period_ms)
+{
+  driver->name = "hdc1080";
+  driver->schema = &hdc1080_schema;
+  driver->period_ms = period_ms;
+  driver->init = NULL;
+  driver->poll = hdc1080_poll;
+  driver->decode = hdc1080_decode;
+  driver->ctx = dev;
+}
+
+
+/*
+* @brief Converts the temperature register: T = raw / 2^16 * 165 - 40 C.
+*/
+int16_t hdc1080_temp(uint16_t raw)
+{
+  return (int16_t) (((int32_t) raw * 16500) >> 16) - 4000;
+}
+
+
+/*
+* @brief Converts the humidity register: RH = raw / 2^16 * 100 %.
+*/
+uint16_t hdc1080_hum(uint16_t raw)
+{
+  return (uint16_t) (((uint32_t) raw * 10000) >> 16);
+}
+
+
+/*
+* @brief Reads a 16 bit register.
+*
+* @param dev   - device state
+* @param reg   - register address
+* @param value - filled in with the register value
+*
+* @return ESP_OK, or the bus error
+*
+*/
+static esp_err_t read_reg(hdc1080_t *dev, uint8_t reg, uint16_t *value)
+{
+  uint8_t buf[2];
+  esp_err_t err;
+
+  err = dev->bus.write(dev->bus.ctx, HDC1080_ADDR, &reg, 1);
+  if(err == ESP_OK)
+    err = dev->bus.read(dev->bus.ctx, HDC1080_ADDR, buf, sizeof(buf));
+  if(err != ESP_OK)
+    return err;
+
+  *value = ((uint16_t) buf[0] << 8) | buf[1];
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sensor driver poll. Starts a conversion on a period boundary and
+*        comes back for the result once it should be done.
+*
+* @param ctx    - device state
+* @param now_us - current time
+* @param event  - unused
+*
+* @return ms until the next poll, or SENSOR_NEXT_PERIOD
+*
+*/
+static uint32_t hdc1080_poll(void *ctx, int64_t now_us, int event)
+{
+  hdc1080_t *dev = (hdc1080_t *) ctx;
+  esp_err_t err;
+
+  if(dev->started_us == 0)
+  {
+    if(hdc1080_start(dev, now_us) != ESP_OK)
+    {
+      dev->stats.errors++;
+      return SENSOR_NEXT_PERIOD;
+    }
+    return HDC1080_CONV_MS;
+  }
+
+  err = hdc1080_collect(dev, now_us, &dev->last);
+  if(err == ESP_ERR_TIMEOUT)
+    return HDC1080_RETRY_MS;
+  if(err == ESP_OK)
+    dev->ready = 1;
+
+  return SENSOR_NEXT_PERIOD;
+}
+
+
+/*
+* @brief Sensor driver decode. Hands out the latest reading once.
+*
+* @param ctx    - device state
+* @param sample - where to store the sample
+*
+* @return 1 if a sample was copied, 0 otherwise
+*
+*/
+static int hdc1080_decode(void *ctx, sensor_sample_t *sample)
+{
+  hdc1080_t *dev = (hdc1080_t *) ctx;
+
+  if(!dev->ready)
+    return 0;
+
+  sample->time_us = dev->last.time_us;
+  sample->count = 2;
+  sample->values[0] = dev->last.temp;
+  sample->values[1] = dev->last.hum;
+  dev->ready = 0;
+
+  return 1;
+}
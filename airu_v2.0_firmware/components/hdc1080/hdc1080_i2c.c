@@ -0,0 +1,71 @@
+/*
+*	hdc1080_i2c.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   HDC1080 on the shared sensor I2C bus, registered with the sensor task.
+*/
+#ifdef ESP_PLATFORM
+
+#include "esp_log.h"
+#include "hdc1080.h"
+#include "sensor_i2c.h"
+#include "pm_if.h"
+
+static const char *TAG_HDC = "HDC1080";
+
+
+/* Function prototypes */
+static int env_decode(void *ctx, sensor_sample_t *sample);
+
+/* Global variables */
+static hdc1080_t hdc;
+static sensor_driver_t hdc_core;
+static sensor_driver_t hdc_driver;
+
+
+/*
+* @brief Sets up the bus and sensor and registers it. See hdc1080.h.
+*/
+esp_err_t hdc1080_i2c_start()
+{
+  hdc1080_bus_t bus = { sensor_i2c_write, sensor_i2c_read, NULL };
+  esp_err_t err;
+
+  err = sensor_i2c_init();
+  if(err != ESP_OK)
+    return err;
+
+  err = hdc1080_init(&hdc, &bus);
+  if(err != ESP_OK)
+  {
+    ESP_LOGW(TAG_HDC, "no sensor: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  // Same driver, but readings are also passed on to the PM samples.
+  hdc1080_driver(&hdc, &hdc_core, HDC1080_PERIOD_MS);
+  hdc_driver = hdc_core;
+  hdc_driver.decode = env_decode;
+
+  return sensor_register(&hdc_driver);
+}
+
+
+/*
+* @brief Decodes a reading and hands it to the PM driver.
+*/
+static int env_decode(void *ctx, sensor_sample_t *sample)
+{
+  if(!hdc_core.decode(ctx, sample))
+    return 0;
+
+  PM_set_env((int16_t) sample->values[0], (uint16_t) sample->values[1]);
+  return 1;
+}
+
+#endif
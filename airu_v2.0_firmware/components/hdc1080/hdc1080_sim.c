@@ -0,0 +1,131 @@
+/*
+*	hdc1080_sim.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Register model of the HDC1080 for host builds. Writing the temperature
+*   pointer starts a conversion that finishes after the datasheet conversion
+*   time for the configured resolution; reads before then are NACKed, like
+*   the real part.
+*/
+#ifndef ESP_PLATFORM
+
+#include <string.h>
+#include "hdc1080.h"
+
+#define SIM_CONV_US  12850    // 14 bit temperature + 14 bit humidity
+
+
+/* Function prototypes */
+static esp_err_t sim_write(void *ctx, uint8_t addr, const uint8_t *data, size_t len);
+static esp_err_t sim_read(void *ctx, uint8_t addr, uint8_t *data, size_t len);
+
+
+/*
+* @brief Sets up the simulated sensor. See hdc1080.h.
+*/
+void hdc1080_sim_init(hdc1080_sim_t *sim, hdc1080_bus_t *bus)
+{
+  memset(sim, 0, sizeof(*sim));
+  sim->config = HDC1080_CFG_MODE;
+
+  bus->write = sim_write;
+  bus->read = sim_read;
+  bus->ctx = sim;
+}
+
+
+/*
+* @brief Write transaction: register pointer, then optionally a 16 bit value.
+*/
+static esp_err_t sim_write(void *ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+  hdc1080_sim_t *sim = (hdc1080_sim_t *) ctx;
+
+  if(addr != HDC1080_ADDR || len == 0)
+    return ESP_FAIL;
+
+  sim->writes++;
+  sim->pointer = data[0];
+
+  if(len == 3 && sim->pointer == HDC1080_REG_CONFIG)
+    sim->config = ((uint16_t) data[1] << 8) | data[2];
+
+  // Pointing at a result register starts a conversion.
+  if(len == 1 && (sim->pointer == HDC1080_REG_TEMP || sim->pointer == HDC1080_REG_HUM))
+  {
+    sim->done_us = sim->now_us + SIM_CONV_US;
+    sim->result[0] = sim->temp_raw;
+    sim->result[1] = sim->hum_raw;
+  }
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Read transaction from the current pointer.
+*/
+static esp_err_t sim_read(void *ctx, uint8_t addr, uint8_t *data, size_t len)
+{
+  hdc1080_sim_t *sim = (hdc1080_sim_t *) ctx;
+  uint16_t value[2];
+  size_t n = 0;
+  size_t i;
+
+  if(addr != HDC1080_ADDR)
+    return ESP_FAIL;
+
+  switch(sim->pointer)
+  {
+    case HDC1080_REG_TEMP:
+    case HDC1080_REG_HUM:
+      if(sim->done_us == 0 || sim->now_us < sim->done_us)
+        return ESP_FAIL;
+      value[0] = sim->result[0];
+      value[1] = sim->result[1];
+      // In combined mode both results come out of one read.
+      n = (sim->config & HDC1080_CFG_MODE) ? 2 : 1;
+      if(sim->pointer == HDC1080_REG_HUM)
+      {
+        value[0] = sim->result[1];
+        n = 1;
+      }
+      break;
+
+    case HDC1080_REG_CONFIG:
+      value[0] = sim->config;
+      n = 1;
+      break;
+
+    case HDC1080_REG_MFG_ID:
+      value[0] = HDC1080_MFG_ID;
+      n = 1;
+      break;
+
+    case HDC1080_REG_DEV_ID:
+      value[0] = HDC1080_DEV_ID;
+      n = 1;
+      break;
+
+    default:
+      return ESP_FAIL;
+  }
+
+  if(len > n * 2)
+    return ESP_FAIL;
+
+  for(i = 0; i < len; i++)
+  {
+    data[i] = (i % 2 == 0) ? value[i / 2] >> 8 : value[i / 2] & 0xFF;
+  }
+  sim->reads++;
+
+  return ESP_OK;
+}
+
+#endif
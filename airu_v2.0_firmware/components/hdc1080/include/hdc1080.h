@@ -0,0 +1,206 @@
+/*
+*	hdc1080.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Non-blocking driver for the TI HDC1080 temperature/humidity sensor.
+*
+*   The sensor is set up to measure temperature and humidity in one go at
+*   14 bits each. A measurement is started by pointing at the temperature
+*   register, which takes one short I2C write, and both results are read
+*   back in one 4 byte read once HDC1080_CONV_MS have passed. The sensor
+*   NACKs reads while it is still converting; the driver then retries a few
+*   ms later instead of blocking.
+*
+*   As a sensor driver (hdc1080_driver()) the first poll of every period
+*   starts a conversion and asks to be polled again after HDC1080_CONV_MS,
+*   so vSensor_task never waits on the sensor.
+*
+*   The I2C bus is a pair of callbacks, see hdc1080_i2c.c for the ESP32 I2C
+*   master and hdc1080_sim.c for a simulated register model on a host. This
+*   file and hdc1080.c have no ESP-IDF dependencies.
+*/
+
+#ifndef _HDC1080_H
+#define _HDC1080_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sensor.h"
+
+#define HDC1080_ADDR          0x40
+#define HDC1080_REG_TEMP      0x00
+#define HDC1080_REG_HUM       0x01
+#define HDC1080_REG_CONFIG    0x02
+#define HDC1080_REG_MFG_ID    0xFE
+#define HDC1080_REG_DEV_ID    0xFF
+#define HDC1080_MFG_ID        0x5449  // "TI"
+#define HDC1080_DEV_ID        0x1050
+#define HDC1080_CFG_RST       0x8000
+#define HDC1080_CFG_MODE      0x1000  // Measure temperature then humidity
+#define HDC1080_CONV_MS       15      // 6.35 ms + 6.5 ms at 14 bits, plus margin
+#define HDC1080_RETRY_MS      2       // Wait before reading again after a NACK
+#define HDC1080_MAX_RETRIES   4
+#define HDC1080_PERIOD_MS     1000    // About one reading per PM frame
+
+
+/*
+* @brief I2C bus callbacks. Both return ESP_OK, or ESP_FAIL if the device
+*        NACKed.
+*/
+typedef struct
+{
+  esp_err_t (*write)(void *ctx, uint8_t addr, const uint8_t *data, size_t len);
+  esp_err_t (*read)(void *ctx, uint8_t addr, uint8_t *data, size_t len);
+  void *ctx;
+} hdc1080_bus_t;
+
+/*
+* @brief One reading
+*/
+typedef struct
+{
+  int64_t time_us;          // Middle of the conversion
+  int16_t temp;             // 0.01 C
+  uint16_t hum;             // 0.01 %RH
+} hdc1080_reading_t;
+
+/*
+* @brief Driver statistics
+*/
+typedef struct
+{
+  uint32_t conversions;     // Conversions started
+  uint32_t readings;        // ...and read back
+  uint32_t nacks;           // Reads NACKed because the conversion was not done
+  uint32_t errors;          // Conversions abandoned
+} hdc1080_stats_t;
+
+/*
+* @brief Device state
+*/
+typedef struct
+{
+  hdc1080_bus_t bus;
+  int64_t started_us;       // Conversion in progress since, 0 if idle
+  uint8_t retries;
+  uint8_t ready;            // 1 if 'last' has not been handed out yet
+  hdc1080_reading_t last;
+  hdc1080_stats_t stats;
+} hdc1080_t;
+
+
+/*
+* @brief Checks the device IDs and sets up combined 14 bit measurements.
+*
+* @param dev - device state
+* @param bus - I2C bus the sensor is on
+*
+* @return ESP_OK, ESP_ERR_NOT_FOUND if the IDs do not match, or the bus error
+*/
+esp_err_t hdc1080_init(hdc1080_t *dev, const hdc1080_bus_t *bus);
+
+/*
+* @brief Starts a temperature and humidity conversion and returns at once.
+*
+* @param dev    - device state
+* @param now_us - current time
+*
+* @return ESP_OK, or the bus error
+*/
+esp_err_t hdc1080_start(hdc1080_t *dev, int64_t now_us);
+
+/*
+* @brief Reads back the conversion started by hdc1080_start().
+*
+* @param dev     - device state
+* @param now_us  - current time
+* @param reading - filled in on success
+*
+* @return ESP_OK, ESP_ERR_TIMEOUT if the sensor is still converting (try
+*         again after HDC1080_RETRY_MS), or ESP_FAIL once it has NACKed
+*         HDC1080_MAX_RETRIES times or if no conversion was started
+*/
+esp_err_t hdc1080_collect(hdc1080_t *dev, int64_t now_us, hdc1080_reading_t *reading);
+
+/*
+* @brief Fills in a sensor driver that takes one reading every period_ms.
+*        The device must already be set up with hdc1080_init().
+*
+* @param dev       - device state, used as the driver context
+* @param driver    - driver to fill in
+* @param period_ms - time between readings
+*
+* @return void
+*/
+void hdc1080_driver(hdc1080_t *dev, sensor_driver_t *driver, uint32_t period_ms);
+
+/*
+* @brief Temperature in 0.01 C from the raw register value.
+*
+* @param raw - temperature register
+*
+* @return temperature
+*/
+int16_t hdc1080_temp(uint16_t raw);
+
+/*
+* @brief Relative humidity in 0.01 % from the raw register value.
+*
+* @param raw - humidity register
+*
+* @return humidity
+*/
+uint16_t hdc1080_hum(uint16_t raw);
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Sets up the I2C master and the sensor, and registers it with the
+*        sensor task. Every reading is also handed to PM_set_env() so PM
+*        samples carry the latest temperature and humidity.
+*
+* @param
+*
+* @return ESP_OK, or an error if the sensor is missing
+*/
+esp_err_t hdc1080_i2c_start();
+
+#else
+
+/*
+* @brief Simulated HDC1080 register file
+*/
+typedef struct
+{
+  int64_t now_us;           // Set by the caller, the model has no clock
+  uint8_t pointer;
+  uint16_t config;
+  int64_t done_us;          // When the conversion in progress finishes, 0 if none
+  uint16_t temp_raw;        // Values the next conversion returns
+  uint16_t hum_raw;
+  uint16_t result[2];
+  uint32_t writes;
+  uint32_t reads;
+} hdc1080_sim_t;
+
+/*
+* @brief Sets up a simulated sensor and a bus that talks to it.
+*
+* @param sim - simulated sensor
+* @param bus - filled in with callbacks to the simulated sensor
+*
+* @return void
+*/
+void hdc1080_sim_init(hdc1080_sim_t *sim, hdc1080_bus_t *bus);
+
+#endif
+
+
+#endif
@@ -0,0 +1,194 @@
+/*
+*	mics.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   MiCS-4514 gas sensor on the wADC board.
+*
+*   The RED and OX sensing resistors sit under 820R load resistors. On the
+*   wADC board their voltages are buffered by a TLV2333 and read by an
+*   ADS1015 12 bit I2C ADC (AIN0 = OX, AIN1 = RED); the heater supply is
+*   switched by IO33. The airu_v2.0 board instead routes VOX and VRED to
+*   IO33 and IO25, the ESP32's own ADC, and has no ADS1015. This driver is
+*   for the wADC board only: MICS_PWR_PIN would drive VOX on the airu_v2.0
+*   board, so the pins only exist, and mics_start() only does anything,
+*   with MICS_ENABLED.
+*
+*   The airu_v2.0 base board is not supported and a node built for it has
+*   no gas readings: mics_start() returns ESP_ERR_NOT_SUPPORTED. Reading
+*   it would need the ESP32 ADC path, which is not written: VRED on IO25
+*   is ADC2, which cannot be read while WiFi is up, and VOX on IO33
+*   (ADC1) would need the I2S-ADC DMA mode and the eFuse Vref for the
+*   accuracy mics_filter.c assumes.
+*
+*   The gas readings move over tens of seconds, so the ADS1015 is run in
+*   single-shot mode off the sensor task's schedule: every MICS_PERIOD_MS
+*   poll reads the conversion the previous poll started and starts one on
+*   the other channel. The ADC powers down between conversions and the
+*   task wakes MICS_PERIOD_MS apart, not once per conversion. ALERT/RDY is
+*   not used.
+*
+*   Each channel has its own boxcar filter, which turns 4^k samples into k
+*   extra bits. The output is a 16 bit code on the same scale as
+*   the ADS1015 conversion register. A lookup table made once at start up
+*   maps the code to the sensing resistance, so the per-sample work is one
+*   add and, per output, one table lookup with linear interpolation
+*   instead of a division.
+*
+*   The filter and calibration (mics_filter.c) have no ESP-IDF
+*   dependencies so they can be run on recorded waveforms on a host:
+*   host/test/mics_check.c checks their error, pm_bench -s mics times them.
+*/
+
+#ifndef _MICS_H
+#define _MICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define MICS_ENABLED        0       // 1 on the wADC board
+#define MICS_ADS_ADDR       0x48    // ADDR tied to GND
+#if MICS_ENABLED
+#define MICS_PWR_PIN        33      // wADC heater switch, VOX on airu_v2.0
+#endif
+#define MICS_PERIOD_MS      100     // One conversion per poll, the channels in turn
+#define MICS_OVERSAMPLE_LOG2  6     // 64 conversions per output, a pair every 12.8 s
+#define MICS_OUT_BITS       16
+#define MICS_CODE_BITS      12
+#define MICS_LUT_LOG2       8       // 256 LUT segments
+#define MICS_FSR_MV         4096    // ADS1015 PGA +-4.096 V
+#define MICS_VC_MV          5000    // Supply across load and sensor
+#define MICS_RL_OHM         820     // R20 / R22
+#define MICS_RS_MAX         UINT32_MAX
+
+// ADS1015 registers and config fields
+#define ADS_REG_CONV        0x00
+#define ADS_REG_CONFIG      0x01
+#define ADS_REG_LO_THRESH   0x02
+#define ADS_REG_HI_THRESH   0x03
+#define ADS_MUX_AIN0        0x4000  // AIN0 against GND
+#define ADS_MUX_AIN1        0x5000
+#define ADS_OS_SINGLE       0x8000  // Start a single conversion
+#define ADS_PGA_4V          0x0200
+#define ADS_MODE_SINGLE     0x0100  // Power down after each conversion
+#define ADS_DR_1600         0x0080  // 0.7 ms per conversion
+#define ADS_COMP_QUE_OFF    0x0003  // ALERT/RDY unused, high impedance
+
+
+/*
+* @brief Boxcar decimator
+*/
+typedef struct
+{
+  uint32_t sum;
+  uint16_t n;
+  uint8_t log2;             // 2^log2 samples per output
+} mics_boxcar_t;
+
+/*
+* @brief Calibration settings
+*/
+typedef struct
+{
+  uint32_t fsr_mv;          // Full scale of the ADC input range
+  uint32_t vc_mv;           // Voltage across load + sensor
+  uint32_t rl_ohm;          // Load resistor
+  int32_t offset_uv;        // Subtracted from the measured voltage
+  int32_t gain_ppm;         // Gain correction, 0 for none
+} mics_cal_config_t;
+
+#define MICS_CAL_CONFIG_DEFAULT() {  \
+    .fsr_mv = MICS_FSR_MV,           \
+    .vc_mv = MICS_VC_MV,             \
+    .rl_ohm = MICS_RL_OHM,           \
+    .offset_uv = 0,                  \
+    .gain_ppm = 0                    \
+}
+
+/*
+* @brief Code to resistance lookup table
+*/
+typedef struct
+{
+  uint32_t rs[(1 << MICS_LUT_LOG2) + 1];
+} mics_cal_t;
+
+
+/*
+* @brief Resets a decimator.
+*
+* @param f    - decimator
+* @param log2 - 2^log2 samples per output, at least
+*               2 * (MICS_OUT_BITS - MICS_CODE_BITS) for full output bits
+*
+* @return void
+*/
+void mics_boxcar_init(mics_boxcar_t *f, uint8_t log2);
+
+/*
+* @brief Adds one ADC code.
+*
+* @param f    - decimator
+* @param code - 12 bit code, negative codes are clamped to 0
+* @param out  - set to the 16 bit output when one is ready
+*
+* @return 1 if *out was set, 0 otherwise
+*/
+int mics_boxcar_add(mics_boxcar_t *f, int16_t code, uint16_t *out);
+
+/*
+* @brief Decimates a block of ADC codes.
+*
+* @param f     - decimator
+* @param codes - 12 bit codes
+* @param n     - number of codes
+* @param out   - outputs
+* @param max   - size of out
+*
+* @return number of outputs written
+*/
+size_t mics_boxcar_block(mics_boxcar_t *f, const int16_t *codes, size_t n, uint16_t *out, size_t max);
+
+/*
+* @brief Builds the code to resistance table.
+*
+* @param cal    - table to fill in
+* @param config - calibration settings
+*
+* @return void
+*/
+void mics_cal_init(mics_cal_t *cal, const mics_cal_config_t *config);
+
+/*
+* @brief Sensing resistance for a decimated code.
+*
+* @param cal  - table
+* @param code - 16 bit decimated code
+*
+* @return resistance in ohms, MICS_RS_MAX if the input was at the supply
+*/
+uint32_t mics_cal_apply(const mics_cal_t *cal, uint16_t code);
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Powers the sensor, checks the ADS1015 and registers the driver
+*        with the sensor task. Samples carry the OX and RED resistances.
+*
+* @param
+*
+* @return ESP_OK, ESP_ERR_NOT_SUPPORTED unless MICS_ENABLED, or an error
+*         if the ADC is missing
+*/
+esp_err_t mics_start();
+
+#endif
+
+
+#endif
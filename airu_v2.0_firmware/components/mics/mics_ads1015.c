@@ -0,0 +1,225 @@
+/*
+*	mics_ads1015.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   ADS1015 acquisition for the MiCS-4514: single-shot conversions started
+*   and read on the sensor task's schedule.
+*/
+#ifdef ESP_PLATFORM
+
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "mics.h"
+#include "sensor.h"
+#include "sensor_i2c.h"
+
+static const char *TAG_MICS = "MICS";
+
+#define MICS_CHANNELS   2
+#define ADS_CONFIG(mux) (ADS_OS_SINGLE | (mux) | ADS_PGA_4V | ADS_MODE_SINGLE | ADS_DR_1600 | ADS_COMP_QUE_OFF)
+
+
+#if MICS_ENABLED
+
+/* Function prototypes */
+static esp_err_t write_reg(uint8_t reg, uint16_t value);
+static esp_err_t start_conversion(uint8_t channel);
+static esp_err_t mics_driver_init(void *ctx, void **events);
+static uint32_t mics_poll(void *ctx, int64_t now_us, int event);
+static int mics_decode(void *ctx, sensor_sample_t *sample);
+
+/* Global variables */
+static mics_boxcar_t mics_filter[MICS_CHANNELS];
+static mics_cal_t mics_cal;
+static uint8_t mics_channel;              // Channel of the conversion in progress
+static uint8_t mics_started;              // A conversion was started by the last poll
+static uint16_t mics_out[MICS_CHANNELS];
+static uint8_t mics_have;                 // Bit per channel with a fresh output
+static int64_t mics_time_us;
+
+static const uint16_t mics_mux[MICS_CHANNELS] = { ADS_MUX_AIN0, ADS_MUX_AIN1 };
+static const sensor_field_t mics_fields[MICS_CHANNELS] =
+{
+  { "ox", "ohm", 1 },
+  { "red", "ohm", 1 }
+};
+static const sensor_schema_t mics_schema = { MICS_CHANNELS, mics_fields };
+static const sensor_driver_t mics_driver =
+{
+  .name = "mics4514",
+  .schema = &mics_schema,
+  .period_ms = MICS_PERIOD_MS,
+  .init = mics_driver_init,
+  .poll = mics_poll,
+  .decode = mics_decode,
+  .ctx = NULL
+};
+
+#endif
+
+
+
+/*
+* @brief Sets everything up and registers the driver. See mics.h.
+*/
+esp_err_t mics_start()
+{
+#if MICS_ENABLED
+  mics_cal_config_t cal_config = MICS_CAL_CONFIG_DEFAULT();
+  uint8_t reg = ADS_REG_CONFIG;
+  uint8_t buf[2];
+  uint8_t i;
+  esp_err_t err;
+
+  err = sensor_i2c_init();
+  if(err != ESP_OK)
+    return err;
+
+  // Check the part is there before powering the heater.
+  err = sensor_i2c_write(NULL, MICS_ADS_ADDR, &reg, 1);
+  if(err == ESP_OK)
+    err = sensor_i2c_read(NULL, MICS_ADS_ADDR, buf, sizeof(buf));
+  if(err != ESP_OK)
+  {
+    ESP_LOGW(TAG_MICS, "no ADS1015: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  gpio_set_direction(MICS_PWR_PIN, GPIO_MODE_OUTPUT);
+  gpio_set_level(MICS_PWR_PIN, 1);
+
+  mics_cal_init(&mics_cal, &cal_config);
+  for(i = 0; i < MICS_CHANNELS; i++)
+    mics_boxcar_init(&mics_filter[i], MICS_OVERSAMPLE_LOG2);
+
+  return sensor_register(&mics_driver);
+#else
+  // The airu_v2.0 board has VOX and VRED on the ESP32's ADC pins.
+  ESP_LOGW(TAG_MICS, "no ADS1015 on this board");
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+
+#if MICS_ENABLED
+
+/*
+* @brief Sensor driver init. Starts the first conversion.
+*/
+static esp_err_t mics_driver_init(void *ctx, void **events)
+{
+  esp_err_t err;
+
+  err = start_conversion(0);
+  mics_started = (err == ESP_OK);
+
+  return err;
+}
+
+
+/*
+* @brief Sensor driver poll. Reads the conversion the last poll started
+*        into its channel's filter and starts one on the other channel.
+*        At 1600 SPS it has been done for most of MICS_PERIOD_MS.
+*/
+static uint32_t mics_poll(void *ctx, int64_t now_us, int event)
+{
+  uint8_t channel = mics_channel;
+  uint8_t buf[2];
+  int16_t code;
+  esp_err_t err = ESP_FAIL;
+
+  // The pointer is left at the conversion register.
+  if(mics_started)
+    err = sensor_i2c_read(NULL, MICS_ADS_ADDR, buf, sizeof(buf));
+
+  mics_started = (start_conversion((channel + 1) % MICS_CHANNELS) == ESP_OK);
+  if(!mics_started)
+    ESP_LOGW(TAG_MICS, "conversion start failed");
+  if(err != ESP_OK)
+    return SENSOR_NEXT_PERIOD;
+
+  code = (int16_t) (((uint16_t) buf[0] << 8) | buf[1]) >> 4;
+  if(!mics_boxcar_add(&mics_filter[channel], code, &mics_out[channel]))
+    return SENSOR_NEXT_PERIOD;
+
+  mics_have |= 1 << channel;
+  if(mics_have == (1 << MICS_CHANNELS) - 1)
+    mics_time_us = now_us;
+
+  return SENSOR_NEXT_PERIOD;
+}
+
+
+/*
+* @brief Sensor driver decode. Hands out a pair once both channels have a
+*        fresh output.
+*/
+static int mics_decode(void *ctx, sensor_sample_t *sample)
+{
+  uint8_t i;
+
+  if(mics_have != (1 << MICS_CHANNELS) - 1)
+    return 0;
+
+  sample->time_us = mics_time_us;
+  sample->count = MICS_CHANNELS;
+  for(i = 0; i < MICS_CHANNELS; i++)
+  {
+    sample->values[i] = (int32_t) mics_cal_apply(&mics_cal, mics_out[i]);
+  }
+  mics_have = 0;
+
+  return 1;
+}
+
+
+/*
+* @brief Writes a 16 bit register.
+*
+* @param reg   - register address
+* @param value - value to write
+*
+* @return ESP_OK, or the bus error
+*
+*/
+static esp_err_t write_reg(uint8_t reg, uint16_t value)
+{
+  const uint8_t buf[3] = { reg, value >> 8, value & 0xFF };
+
+  return sensor_i2c_write(NULL, MICS_ADS_ADDR, buf, sizeof(buf));
+}
+
+
+/*
+* @brief Starts a single conversion on a channel and points the register
+*        pointer back at the conversion register for the next poll.
+*
+* @param channel - 0 for OX, 1 for RED
+*
+* @return ESP_OK, or the bus error
+*
+*/
+static esp_err_t start_conversion(uint8_t channel)
+{
+  const uint8_t conv = ADS_REG_CONV;
+  esp_err_t err;
+
+  err = write_reg(ADS_REG_CONFIG, ADS_CONFIG(mics_mux[channel]));
+  if(err == ESP_OK)
+    err = sensor_i2c_write(NULL, MICS_ADS_ADDR, &conv, 1);
+
+  mics_channel = channel;
+
+  return err;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+/*
+*	mics_filter.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include "mics.h"
+
+#define CODE_MAX    (1 << (MICS_OUT_BITS - 1))                    // Full scale, positive side
+#define SEG_SHIFT   (MICS_OUT_BITS - 1 - MICS_LUT_LOG2)
+#define NUM_SEGS    (1 << MICS_LUT_LOG2)
+#define CODE_SHIFT  (MICS_OUT_BITS - MICS_CODE_BITS)              // 12 bit code to register scale
+
+
+/*
+* @brief Resets a decimator. See mics.h.
+*/
+void mics_boxcar_init(mics_boxcar_t *f, uint8_t log2)
+{
+  f->sum = 0;
+  f->n = 0;
+  f->log2 = log2;
+}
+
+
+/*
+* @brief Adds one code. See mics.h.
+*/
+int mics_boxcar_add(mics_boxcar_t *f, int16_t code, uint16_t *out)
+{
+  uint32_t value;
+
+  f->sum += (code > 0) ? code : 0;
+  if(++f->n < (1u << f->log2))
+    return 0;
+
+  // Scale the sum of 2^log2 codes to one 16 bit code.
+  if(f->log2 >= CODE_SHIFT)
+    value = f->sum >> (f->log2 - CODE_SHIFT);
+  else
+    value = f->sum << (CODE_SHIFT - f->log2);
+
+  *out = (value > UINT16_MAX) ? UINT16_MAX : (uint16_t) value;
+  f->sum = 0;
+  f->n = 0;
+
+  return 1;
+}
+
+
+/*
+* @brief Decimates a block. See mics.h.
+*/
+size_t mics_boxcar_block(mics_boxcar_t *f, const int16_t *codes, size_t n, uint16_t *out, size_t max)
+{
+  size_t count = 0;
+  size_t i;
+
+  for(i = 0; i < n && count < max; i++)
+  {
+    count += mics_boxcar_add(f, codes[i], &out[count]);
+  }
+
+  return count;
+}
+
+
+/*
+* @brief Builds the lookup table. See mics.h.
+*
+* The node voltage is v = Vc * Rs / (Rs + RL), so Rs = RL * v / (Vc - v).
+*/
+void mics_cal_init(mics_cal_t *cal, const mics_cal_config_t *config)
+{
+  int64_t v_uv;
+  int64_t vc_uv = (int64_t) config->vc_mv * 1000;
+  uint64_t rs;
+  uint32_t i;
+
+  for(i = 0; i <= NUM_SEGS; i++)
+  {
+    v_uv = ((int64_t) i << SEG_SHIFT) * config->fsr_mv * 1000 / CODE_MAX;
+    v_uv = (v_uv - config->offset_uv) * (1000000 + config->gain_ppm) / 1000000;
+
+    if(v_uv <= 0)
+      cal->rs[i] = 0;
+    else if(v_uv >= vc_uv)
+      cal->rs[i] = MICS_RS_MAX;
+    else
+    {
+      rs = (uint64_t) config->rl_ohm * v_uv / (vc_uv - v_uv);
+      cal->rs[i] = (rs >= MICS_RS_MAX) ? MICS_RS_MAX : (uint32_t) rs;
+    }
+  }
+}
+
+
+/*
+* @brief Looks a code up. See mics.h.
+*/
+uint32_t mics_cal_apply(const mics_cal_t *cal, uint16_t code)
+{
+  uint32_t idx = code >> SEG_SHIFT;
+  uint32_t frac = code & ((1 << SEG_SHIFT) - 1);
+  uint32_t lo;
+  uint32_t hi;
+
+  if(idx >= NUM_SEGS)
+    return cal->rs[NUM_SEGS];
+
+  lo = cal->rs[idx];
+  hi = cal->rs[idx + 1];
+  if(hi == MICS_RS_MAX)
+    return (frac == 0) ? lo : MICS_RS_MAX;
+
+  return lo + (uint32_t) (((uint64_t) (hi - lo) * frac) >> SEG_SHIFT);
+}
@@ -0,0 +1,167 @@
+/*
+*	pm_frame.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Streaming frame parser for the PMS sensor UART stream.
+*
+*   Bytes are fed in as they come out of uart_read_bytes() and each byte is
+*   looked at once. The framer resyncs on the "BM" header without rescanning
+*   old data and hands validated frames back by pointer. When a frame is fully
+*   contained in the caller's buffer the returned pointer points straight into
+*   that buffer (no copy); only frames that straddle two reads are stitched
+*   together in the framer's own buffer.
+*
+*   pm_frame_decode() then pulls every field out of a frame in one pass.
+*   The sensor model is fixed at compile time with PM_MODEL:
+*
+*     PMS3003          24 byte frames: PM1/PM2.5/PM10 as CF=1 and as
+*                      atmospheric environment concentrations. No commands;
+*                      sleep is the SET pin only.
+*     PMS5003/PMS7003  32 byte frames: the same six, plus particle counts
+*                      per 0.1 L of air for >0.3, 0.5, 1.0, 2.5, 5 and 10 um.
+*                      Take commands (pm_frame_command()) for sleep and
+*                      passive mode.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _PM_FRAME_H
+#define _PM_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PM_MODEL_PMS3003  0
+#define PM_MODEL_PMS5003  1
+#define PM_MODEL_PMS7003  2
+#define PM_MODEL          PM_MODEL_PMS3003
+
+#if PM_MODEL == PM_MODEL_PMS3003
+#define PM_FRAME_LEN      24    // Frame length in bytes
+#define PM_FRAME_FIELDS   6     // Fields the model sends, in pm_field_t order
+#define PM_FRAME_COMMANDS 0     // 1 if the model takes commands
+#else
+#define PM_FRAME_LEN      32
+#define PM_FRAME_FIELDS   12
+#define PM_FRAME_COMMANDS 1
+#endif
+#define PM_FRAME_START1   0x42  // 'B'
+#define PM_FRAME_START2   0x4D  // 'M'
+
+#define PM_CMD_LEN        7
+#define PM_CMD_READ       0xE2  // Passive mode: send one frame
+#define PM_CMD_MODE       0xE1  // Data 0: passive, 1: active
+#define PM_CMD_SLEEP      0xE4  // Data 0: sleep, 1: wake up
+
+
+/*
+* @brief Fields of a decoded frame. Concentrations are in ug/m3, counts
+*        are particles larger than the size per 0.1 L of air. Fields the
+*        model doesn't send decode as 0.
+*/
+typedef enum
+{
+  PM_FIELD_PM1 = 0,         // CF=1, standard particle
+  PM_FIELD_PM2_5,
+  PM_FIELD_PM10,
+  PM_FIELD_PM1_ATM,         // Atmospheric environment
+  PM_FIELD_PM2_5_ATM,
+  PM_FIELD_PM10_ATM,
+  PM_FIELD_N0_3,
+  PM_FIELD_N0_5,
+  PM_FIELD_N1_0,
+  PM_FIELD_N2_5,
+  PM_FIELD_N5_0,
+  PM_FIELD_N10,
+  PM_FIELD_NUM
+} pm_field_t;
+
+
+/*
+* @brief Framer statistics
+*/
+typedef struct
+{
+  uint32_t frames;          // Valid frames handed out
+  uint32_t checksum_errs;   // Frames with a good header but a bad checksum/length
+  uint32_t bytes_skipped;   // Bytes discarded while hunting for a header
+} pm_frame_stats_t;
+
+/*
+* @brief Framer state
+*
+* 'stash' only ever holds the start of a frame that was split across two
+* reads. 'fill' is the number of bytes currently held in it.
+*/
+typedef struct
+{
+  uint8_t stash[PM_FRAME_LEN];
+  uint16_t fill;
+  pm_frame_stats_t stats;
+} pm_framer_t;
+
+
+/*
+* @brief Resets the framer to its initial state and clears the statistics.
+*
+* @param framer - framer to initialise
+*
+* @return void
+*/
+void pm_framer_init(pm_framer_t *framer);
+
+/*
+* @brief Pulls the next valid frame out of a byte stream.
+*
+* Consumes bytes from *buf and advances *buf / *len past them. Call it in a
+* loop until it returns NULL, at which point all of the input has been
+* consumed (a trailing partial frame is kept inside the framer).
+*
+* @param framer - framer state
+* @param buf    - in/out pointer to the unread input
+* @param len    - in/out number of unread input bytes
+*
+* @return pointer to a validated PM_FRAME_LEN byte frame, or NULL when the
+*         input is exhausted. The pointer is valid until the next call or
+*         until the caller's buffer is reused, whichever comes first.
+*/
+const uint8_t *pm_framer_next(pm_framer_t *framer, const uint8_t **buf, size_t *len);
+
+/*
+* @brief Checks the header, length field and checksum of a complete frame.
+*
+* @param frame - PM_FRAME_LEN bytes
+*
+* @return 1 if the frame is valid, 0 otherwise
+*/
+int pm_frame_valid(const uint8_t *frame);
+
+/*
+* @brief Decodes every field of a valid frame.
+*
+* @param frame  - PM_FRAME_LEN bytes, checked by pm_frame_valid()
+* @param fields - PM_FIELD_NUM values, indexed by pm_field_t
+*
+* @return void
+*/
+void pm_frame_decode(const uint8_t *frame, uint16_t *fields);
+
+/*
+* @brief Builds a command for the sensor: header, command, 16 bit data and
+*        checksum.
+*
+* @param out  - PM_CMD_LEN bytes
+* @param cmd  - PM_CMD_xxx
+* @param data - command data
+*
+* @return PM_CMD_LEN
+*/
+size_t pm_frame_command(uint8_t *out, uint8_t cmd, uint16_t data);
+
+
+#endif
@@ -0,0 +1,258 @@
+/*
+*	pm_health.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Fault detection and recovery for a PMS sensor.
+*
+*   The driver reports every valid frame, checksum failures and UART
+*   overflows; the health state machine turns them into faults:
+*
+*     checksum  - more than 'bad_pct' % of the last PM_HEALTH_WINDOW frames
+*                 failed their checksum
+*     stuck     - 'stuck_frames' identical non-zero frames in a row (real
+*                 readings wander by a count or two even in steady air, and
+*                 all zeros is clean air)
+*     silence   - no usable frame for 'silence_ms' while frames are expected
+*     overflow  - 'overflows' UART overflows within 'overflow_ms'
+*
+*   and recovers from them one step at a time, giving each step a bounded
+*   time to bring 'good_frames' usable frames in a row back before moving
+*   on to the next:
+*
+*     OK --fault--> RESYNC --recover_ms[0]--> REINIT --recover_ms[1]-->
+*     POWER_CYCLE --recover_ms[2]--> FAILED --retry_ms--> POWER_CYCLE ...
+*
+*   RESYNC drops buffered bytes and the framer state, REINIT sets the UART
+*   up again and POWER_CYCLE takes the sensor's power (or RESET) away for
+*   'off_ms'. A fault in FAILED is never given up on, the power cycle just
+*   repeats every 'retry_ms'. Every step's time runs only while frames are
+*   expected (see pm_health_pause()), so a sleeping sensor is not a fault.
+*
+*   As with pm_power.h the state machine only decides; the PM driver
+*   carries the actions out.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _PM_HEALTH_H
+#define _PM_HEALTH_H
+
+#include <stdint.h>
+#include "pm_frame.h"
+
+#define PM_HEALTH_WINDOW        16      // Frames the checksum failure rate is taken over
+#define PM_HEALTH_NEVER         INT64_MAX
+
+#define PM_HEALTH_SILENCE_MS    5000    // Five missed frames in active mode
+#define PM_HEALTH_BAD_PCT       50      // A noisy line runs at 10-20 %
+#define PM_HEALTH_STUCK_FRAMES  300     // 5 min at a frame a second
+#define PM_HEALTH_OVERFLOWS     3
+#define PM_HEALTH_OVERFLOW_MS   10000
+#define PM_HEALTH_RESYNC_MS     5000
+#define PM_HEALTH_REINIT_MS     5000
+#define PM_HEALTH_CYCLE_MS      10000   // On top of the sensor's settle time
+#define PM_HEALTH_OFF_MS        1000
+#define PM_HEALTH_RETRY_MS      300000
+#define PM_HEALTH_GOOD_FRAMES   3
+
+
+/*
+* @brief Health states, in escalation order
+*/
+typedef enum
+{
+  PM_HEALTH_OK = 0,
+  PM_HEALTH_RESYNC,         // Resynced, waiting for good frames
+  PM_HEALTH_REINIT,         // UART set up again, waiting
+  PM_HEALTH_POWER_CYCLE,    // Power cycled, waiting
+  PM_HEALTH_FAILED,         // Nothing helped, power cycle again after retry_ms
+  PM_HEALTH_NUM_STATES
+} pm_health_state_t;
+
+/*
+* @brief What started a recovery
+*/
+typedef enum
+{
+  PM_FAULT_NONE = 0,
+  PM_FAULT_CHECKSUM,
+  PM_FAULT_STUCK,
+  PM_FAULT_SILENCE,
+  PM_FAULT_OVERFLOW,
+  PM_FAULT_NUM
+} pm_fault_t;
+
+/*
+* @brief What the driver has to do for a pm_health_step()
+*/
+typedef enum
+{
+  PM_HEALTH_NONE = 0,
+  PM_HEALTH_DO_RESYNC,      // Flush the UART and reset the framer
+  PM_HEALTH_DO_REINIT,      // Configure the UART again
+  PM_HEALTH_DO_POWER_OFF,   // SET or RESET low, or sleep command
+  PM_HEALTH_DO_POWER_ON     // ...and back, restarting the sleep schedule
+} pm_health_action_t;
+
+/*
+* @brief Health settings
+*/
+typedef struct
+{
+  uint32_t silence_ms;
+  uint8_t bad_pct;
+  uint16_t stuck_frames;
+  uint8_t overflows;
+  uint32_t overflow_ms;
+  uint32_t recover_ms[3];   // Time given to RESYNC, REINIT and POWER_CYCLE
+  uint32_t off_ms;          // Power off time of a power cycle
+  uint32_t retry_ms;        // Time in FAILED before the next power cycle
+  uint8_t good_frames;      // Usable frames in a row that end a recovery
+} pm_health_config_t;
+
+#define PM_HEALTH_CONFIG_DEFAULT() {                                                  \
+    .silence_ms = PM_HEALTH_SILENCE_MS,                                               \
+    .bad_pct = PM_HEALTH_BAD_PCT,                                                     \
+    .stuck_frames = PM_HEALTH_STUCK_FRAMES,                                           \
+    .overflows = PM_HEALTH_OVERFLOWS,                                                 \
+    .overflow_ms = PM_HEALTH_OVERFLOW_MS,                                             \
+    .recover_ms = { PM_HEALTH_RESYNC_MS, PM_HEALTH_REINIT_MS, PM_HEALTH_CYCLE_MS },   \
+    .off_ms = PM_HEALTH_OFF_MS,                                                       \
+    .retry_ms = PM_HEALTH_RETRY_MS,                                                   \
+    .good_frames = PM_HEALTH_GOOD_FRAMES                                              \
+}
+
+/*
+* @brief Health statistics
+*/
+typedef struct
+{
+  pm_health_state_t state;
+  pm_fault_t fault;                         // Cause of the current or last recovery
+  uint32_t faults[PM_FAULT_NUM];            // Recoveries started, by cause
+  uint32_t actions[PM_HEALTH_NUM_STATES];   // Steps taken, by the state they entered
+  uint32_t recoveries;                      // Recoveries that ended in good frames
+  uint32_t bad_frames;                      // Checksum failures seen
+  uint32_t last_recover_ms;                 // Fault detected to recovered, last...
+  uint32_t max_recover_ms;                  // ...and worst
+  uint64_t degraded_us;                     // Time not OK
+} pm_health_stats_t;
+
+/*
+* @brief Health state
+*/
+typedef struct
+{
+  pm_health_config_t config;
+  pm_health_state_t state;
+  pm_fault_t pending;       // Fault found while OK, acted on by the next step
+  int64_t since_us;         // When the current recovery started
+  int64_t deadline_us;      // Next step if still not recovered, or power on time
+  int64_t last_good_us;     // Last usable frame (or resume)
+  int64_t pause_us;         // When frames stopped being expected
+  uint8_t paused;
+  uint8_t powered_off;
+  uint8_t good_run;         // Usable frames in a row since the last step
+  uint32_t window_good;     // Checksum window
+  uint32_t window_bad;
+  uint8_t overflows;
+  int64_t overflow_us;      // Start of the overflow window
+  uint16_t same_run;        // Identical frames in a row
+  uint16_t last[PM_FIELD_NUM];
+  pm_health_stats_t stats;
+} pm_health_t;
+
+
+/*
+* @brief Starts the state machine in OK.
+*
+* @param health - state
+* @param config - settings
+* @param now_us - current time
+*
+* @return void
+*/
+void pm_health_init(pm_health_t *health, const pm_health_config_t *config, int64_t now_us);
+
+/*
+* @brief A valid frame came in.
+*
+* @param health - state
+* @param now_us - current time
+* @param fields - the frame, decoded by pm_frame_decode()
+*
+* @return void
+*/
+void pm_health_frame(pm_health_t *health, int64_t now_us, const uint16_t *fields);
+
+/*
+* @brief Frames failed their checksum. Noise between frames is not
+*        counted, a line with nothing but garbage on it shows up as silence.
+*
+* @param health - state
+* @param now_us - current time
+* @param count  - failures
+*
+* @return void
+*/
+void pm_health_bad(pm_health_t *health, int64_t now_us, uint32_t count);
+
+/*
+* @brief The UART FIFO or ring buffer overflowed.
+*
+* @param health - state
+* @param now_us - current time
+*
+* @return void
+*/
+void pm_health_overflow(pm_health_t *health, int64_t now_us);
+
+/*
+* @brief Says whether frames are expected. Silence and every step's time
+*        only count while they are; reports while paused are ignored.
+*
+* @param health - state
+* @param now_us - current time
+* @param paused - 1 while the sensor sleeps or settles
+*
+* @return void
+*/
+void pm_health_pause(pm_health_t *health, int64_t now_us, int paused);
+
+/*
+* @brief Checks for silence and moves a recovery on. Call until it returns
+*        PM_HEALTH_NONE and carry out every action it returns, in order.
+*
+* @param health - state
+* @param now_us - current time
+*
+* @return the next action due at now_us, or PM_HEALTH_NONE
+*/
+pm_health_action_t pm_health_step(pm_health_t *health, int64_t now_us);
+
+/*
+* @brief Time pm_health_step() next has something to do.
+*
+* @param health - state
+*
+* @return time in us, or PM_HEALTH_NEVER
+*/
+int64_t pm_health_next(const pm_health_t *health);
+
+/*
+* @brief Statistics, with degraded time counted up to now.
+*
+* @param health - state
+* @param now_us - current time
+* @param stats  - where to store the statistics
+*
+* @return void
+*/
+void pm_health_get_stats(const pm_health_t *health, int64_t now_us, pm_health_stats_t *stats);
+
+#endif
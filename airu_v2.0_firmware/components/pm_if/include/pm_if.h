@@ -1,7 +1,7 @@
 /*
 *	pm_if.h
 *	
-*	Last Modified: October 6, 2018
+*	Last Modified: October 17, 2026
 *	 Author: Trenton Taylor
 *
 */
@@ -12,27 +12,55 @@
 
 #include "freertos/queue.h"
 #include "esp_err.h"
+#include "pm_frame.h"
+#include "pm_power.h"
+#include "pm_health.h"
+#include "pm_ring.h"
 
 static const char *TAG_PM = "PM";
 
-#define PM_UART_CH   UART_NUM_2
-#define PM_RXD_PIN   16
-#define PM_TXD_PIN   17
+#define PM_NUM_CHANNELS 1   // PM sensors fitted, the first PM_NUM_CHANNELS of PM_CHANNELS
+#define PM_MAX_CHANNELS 3
+// UART, RX/TX pins and SET/RESET pins of each channel. Channel 0 is the PM
+// header of both the airu_v2.0 and wADC boards: SET on IO5 and RESET on
+// IO17, so its TX is not wired and the sensor is never sent commands.
+// Channel 1 is on the GPS header and needs GPS_ENABLED 0; channel 2 is the
+// console UART and needs CONFIG_CONSOLE_UART_NONE.
+#define PM_CHANNELS  { { UART_NUM_2, 16, PM_NO_PIN, 5, 17 }, \
+                       { UART_NUM_1, 9, 10, PM_NO_PIN, PM_NO_PIN }, \
+                       { UART_NUM_0, 3, 1, PM_NO_PIN, PM_NO_PIN } }
+#define PM_NO_PIN    -1
 #define BUF_SIZE     144 // NOTE: Rx_buffer_size should be greater than UART_FIFO_LEN (128 bytes)
-#define PM_PKT_LEN   24
-#define MAX_PKTS_IN_BUFFER 6
+#define PM_PKT_LEN   PM_FRAME_LEN
 #define MAX_NUM_PKT  5
 #define TIMEOUT      50
-#define PKT_PM1_HIGH 4
-#define PKT_PM1_LOW  5
-#define PKT_PM2_5_HIGH  6
-#define PKT_PM2_5_LOW   7
-#define PKT_PM10_HIGH   8
-#define PKT_PM10_LOW    9
-//#define PM_SET_PIN    X
-//#define PM_RESET_PIN  X
+#define PM_RXFIFO_FULL_THRESH PM_FRAME_LEN // Raise a UART_DATA event once a whole frame is in the FIFO
+#define PM_RX_TOUT_THRESH  4  // ...or after 4 idle symbol times, for a frame that arrived split
+#define PM_MAX_CONSUMERS 4 // Max number of sample rings the PM driver publishes to
+#define PM_BAUD            9600
+#define PM_FRAME_US        (PM_FRAME_LEN * 10 * 1000000 / PM_BAUD)  // A frame on the wire, start and stop bits included
+#define PM_GAP_HISTORY     4    // Frame gaps the listen window is predicted from
+#define PM_LISTEN_GUARD_MS 60   // Open the listen window this early
+#define PM_LISTEN_RESYNC   8    // Frames to listen through after a miss
+#define PM_POWER_PERIOD_S  120  // Measurement window every 2 min...
+#define PM_POWER_MEASURE_S 20   // ...of 20 s...
+#define PM_POWER_SETTLE_MS 30000  // ...after the 30 s fan spin-up (datasheet)
+#define PM_POWER_QUERY_MS  1000 // Passive mode read interval
+#define PM_RESET_PULSE_MS  10
 
 
+/*
+* @brief UART and pins of a PM channel
+*/
+typedef struct
+{
+  uint8_t uart;             // uart_port_t
+  int8_t rxd_pin;
+  int8_t txd_pin;           // PM_NO_PIN: commands can't be sent
+  int8_t set_pin;           // Sensor SET (sleep) input, or PM_NO_PIN
+  int8_t reset_pin;         // Sensor RESET input, or PM_NO_PIN
+} pm_channel_config_t;
+
 /*
 * @brief PM data struct
 *
@@ -40,55 +68,168 @@ static const char *TAG_PM = "PM";
 * represensted as PM1, PM2.5, PM10 in the documentaion.
 * PM sensor data packets are defined as follows:
 *
-* PM Data is transmitted over UART in 24 byte packets. The first two 
-* bytes are the packet header [0x42 0x4D] or [“BM”] in ASCII. Each piece 
-* of the packet is 2 bytes, with the Most Significant Byte transmitted 
-* first. The final two bytes are the packet checksum and represent a 16 
-* bit (2 byte) number. This number should equal the sum of the first 22 
-* bytes in the packet.
+* PM Data is transmitted over UART in 24 byte packets (32 on the PMS5003
+* and PMS7003). The first two bytes are the packet header [0x42 0x4D] or
+* [“BM”] in ASCII. Each piece of the packet is 2 bytes, with the Most
+* Significant Byte transmitted first. The final two bytes are the packet
+* checksum and represent a 16 bit (2 byte) number. This number should
+* equal the sum of all the bytes before it.
+*
+* pm1/pm2_5/pm10 are the CF=1 readings; 'fields' holds everything in the
+* frame, see pm_frame.h.
 *
 * Refer to PMS3003 documentation for more details.
 */
 typedef struct 
 {
   uint32_t sample_count;    // Number of valid data points recieved
+  int64_t time_us;          // When the most recent frame was decoded, us since boot
+  int64_t utc_us;           // The same time in UTC (us since 1970), 0 if not synced
   uint16_t pm1;             // Most recent PM1 samples
   uint16_t pm2_5;           // Most recent PM2.5 samples 
   uint16_t pm10;            // Most recent PM10 samples
+  uint16_t fields[PM_FIELD_NUM];  // Every field of the most recent frame, by pm_field_t
 } pm_data_t;
 
+/*
+* @brief PM acquisition statistics
+*
+* The UART interrupt thresholds are set so the driver raises one UART_DATA
+* event per frame, and each event drains everything buffered so split frames
+* are stitched rather than dropped. wakeups / frames is the number of task
+* wakeups per valid sample and busy_us / frames the CPU time per frame.
+*
+* UART2 cannot wake the chip from light sleep, so the PM driver holds a
+* POWER_NO_SLEEP lock only from PM_LISTEN_GUARD_MS before the first byte of
+* the next frame is due (predicted from the shortest of the last
+* PM_GAP_HISTORY gaps, less PM_FRAME_US on the wire) until it has been read,
+* and for as long as part of a frame sits in the framer. A frame that starts
+* while the chip is asleep shows up as a
+* resync; it is counted in listen_misses and the lock is then held for the
+* next PM_LISTEN_RESYNC frames.
+*
+* Every channel keeps its own statistics, so the cost of servicing N
+* sensors from the one task is busy_us summed over the channels.
+*
+* 'power' is the channel's sleep schedule, see pm_power.h and
+* PM_set_power(); its 'frames' are the frames that were published.
+*
+* 'health' is the channel's fault detection and recovery (pm_health.h):
+* faults by cause, recovery steps taken and how long the last and the
+* worst recovery took, fault detected to good frames again.
+*/
+typedef struct
+{
+  uint32_t wakeups;         // UART events handled by the PM driver
+  uint32_t data_events;     // ...of which were UART_DATA
+  uint32_t bytes;           // Bytes read from the UART
+  uint32_t busy_us;         // Time spent reading and decoding UART_DATA events
+  uint32_t listen_misses;   // Frames cut short because the chip was asleep
+  uint32_t overflows;       // UART FIFO or ring buffer overflows
+  uint32_t dropped_bytes;   // Bytes thrown away when flushing after an overflow
+  uint32_t dropped_samples; // Samples the sensor task had no room for
+  pm_frame_stats_t framer;  // Frame, checksum error and resync counters
+  pm_power_stats_t power;   // Time asleep, settling and measuring
+  pm_health_stats_t health; // Faults and recoveries
+} pm_stats_t;
 
-/* Global variables */
-static QueueHandle_t PM_event_queue;
-pm_data_t pm_data;
-uint8_t pm_buf[BUF_SIZE];
 
 /*
-* @brief
+* @brief Sets up the UART of each of the PM_NUM_CHANNELS channels and
+*        registers a sensor driver per channel, so vSensor_task services
+*        all of them through its queue set.
 *
-* @param
+* A channel whose sensor can be put to sleep (SET pin wired, or a
+* PMS5003/PMS7003 that takes commands over a wired TX) follows the
+* PM_set_power() schedule; any other runs its fan all the time and uses
+* every frame, as a sensor that has been running since power on.
 *
-* @return
+* @return ESP_OK on success, ESP_ERR_INVALID_STATE if a channel's UART is
+*         in use by the GPS or the console, or an error from the UART
+*         driver or sensor_register()
 *
 */
 esp_err_t PM_init();
 
 /*
-* @brief
+* @brief Sets the sleep schedule every channel starts with. Call before
+*        PM_init(); the default is PM_POWER_PERIOD_S, PM_POWER_MEASURE_S,
+*        PM_POWER_SETTLE_MS and, where the model has it, passive mode
+*        every PM_POWER_QUERY_MS.
+*
+* @param config - schedule, see pm_power.h; period_s 0 keeps the fan running
+*
+* @return void
+*
+*/
+void PM_set_power(const pm_power_config_t *config);
+
+/*
+* @brief Copies the most recent PM sample.
+*
+* Safe to call from any task; the copy is never torn even if vSensor_task is
+* decoding a new frame at the same time.
+*
+* @param channel - PM channel
+* @param data    - where to store the sample
+*
+* @return ESP_OK if a sample has been received, ESP_FAIL otherwise,
+*         ESP_ERR_INVALID_ARG if there is no such channel
+*
+*/
+esp_err_t PM_get_data(uint8_t channel, pm_data_t *data);
+
+/*
+* @brief Registers a consumer ring that every decoded sample is pushed to.
+*
+* Samples of all channels go to the same rings; pm_sample_t.channel tells
+* them apart.
+*
+* Each consumer must own its ring and be the only task reading it. Call
+* this once per consumer, typically during start-up.
+*
+* @param ring - initialised ring (see pm_ring.h)
+*
+* @return ESP_OK on success, ESP_ERR_NO_MEM if PM_MAX_CONSUMERS are already
+*         registered
+*
+*/
+esp_err_t PM_add_consumer(pm_ring_t *ring);
+
+/*
+* @brief Sets the temperature and humidity that go into every following PM
+*        sample of every channel, so each record carries the reading closest before its
+*        frame. Called by the temperature/humidity driver from vSensor_task.
+*
+* @param temp - temperature in 0.01 C, or PM_TEMP_NONE
+* @param hum  - relative humidity in 0.01 %, or PM_HUM_NONE
+*
+* @return void
+*
+*/
+void PM_set_env(int16_t temp, uint16_t hum);
+
+/*
+* @brief Copies the acquisition statistics of a channel.
 *
-* @param
+* @param channel - PM channel
+* @param stats   - where to store the statistics
 *
-* @return
+* @return ESP_OK, or ESP_ERR_INVALID_ARG if there is no such channel
 *
 */
-esp_err_t PM_get_data();
+esp_err_t PM_get_stats(uint8_t channel, pm_stats_t *stats);
 
 /*
-* @brief
+* @brief Resets every PM sensor: pulses its RESET pin if one is wired, then
+*        has vSensor_task drop any half read frame and start the channel's
+*        sleep schedule again from a fresh wake up (frames are dropped for
+*        the settle time).
 *
-* @param
+* Safe to call from any task.
 *
-* @return
+* @return ESP_OK, or ESP_FAIL if a channel's event queue is full and it
+*         was not reset
 *
 */
 esp_err_t PM_reset();
@@ -0,0 +1,264 @@
+/*
+*	pm_power.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Power state controller for a PMS sensor.
+*
+*   The fan wears out and draws most of the sensor's current, so instead of
+*   streaming a frame a second forever the sensor is woken for a measurement
+*   window every 'period_s' and put back to sleep after it:
+*
+*     SLEEP --wake--> SETTLE --settle_ms--> MEASURE --measure_s--> SLEEP
+*
+*   Frames that arrive while the fan is still spinning up (SETTLE) read low
+*   and are dropped. In passive mode ('query_ms' set, PMS5003/PMS7003 only)
+*   the sensor only sends a frame when asked, so MEASURE issues a read
+*   request every 'query_ms' and the UART carries nothing else.
+*
+*   The controller only decides; the PM driver carries the actions out
+*   (SET pin or sleep command, read command) and calls pm_power_step()
+*   whenever pm_power_next() comes due. With 'period_s' 0 the sensor stays
+*   in MEASURE after the first settle, as it always did.
+*
+*   pm_sim_t is the other end: a model of the sensor for host builds that
+*   obeys the SET pin and the commands and reads low while its fan settles.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _PM_POWER_H
+#define _PM_POWER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "pm_frame.h"
+
+#define PM_POWER_NEVER  INT64_MAX
+
+
+/*
+* @brief Power states
+*/
+typedef enum
+{
+  PM_POWER_SLEEP = 0,       // Fan off, no frames
+  PM_POWER_SETTLE,          // Fan spinning up, frames dropped
+  PM_POWER_MEASURE,         // Frames used
+  PM_POWER_NUM_STATES
+} pm_power_state_t;
+
+/*
+* @brief What the driver has to do for a pm_power_step()
+*/
+typedef enum
+{
+  PM_POWER_NONE = 0,
+  PM_POWER_WAKE,            // Start the fan: SET pin high or PM_CMD_SLEEP 1
+  PM_POWER_GOTO_SLEEP,      // Stop the fan: SET pin low or PM_CMD_SLEEP 0
+  PM_POWER_QUERY            // Passive mode: send PM_CMD_READ
+} pm_power_action_t;
+
+/*
+* @brief Controller settings
+*/
+typedef struct
+{
+  uint32_t period_s;        // Start of one measurement window to the next, 0 to never sleep
+  uint32_t measure_s;       // Time frames are used for in each window
+  uint32_t settle_ms;       // Fan spin-up after a wake up, frames dropped
+  uint32_t query_ms;        // Passive mode read interval, 0 for active mode
+} pm_power_config_t;
+
+/*
+* @brief Controller statistics. state_us over the whole run gives the
+*        fan's duty cycle: (SETTLE + MEASURE) / total.
+*/
+typedef struct
+{
+  uint64_t state_us[PM_POWER_NUM_STATES];   // Time spent in each state
+  uint32_t wakeups;
+  uint32_t queries;         // Read requests sent in passive mode
+  uint32_t frames;          // Frames used
+  uint32_t frames_dropped;  // Frames that came in while settling or asleep
+} pm_power_stats_t;
+
+/*
+* @brief Controller state
+*/
+typedef struct
+{
+  pm_power_config_t config;
+  pm_power_state_t state;
+  int64_t since_us;         // When 'state' was entered
+  int64_t window_us;        // Start of the current window
+  int64_t measure_end_us;
+  int64_t next_us;          // Next time pm_power_step() has something to do
+  pm_power_stats_t stats;
+} pm_power_t;
+
+
+/*
+* @brief Starts the controller with the sensor just woken up (as it is
+*        after power on or a wake command).
+*
+* @param pwr    - controller
+* @param config - settings; period_s is raised to fit settle_ms and
+*                 measure_s if it is too short
+* @param now_us - current time
+*
+* @return void
+*/
+void pm_power_init(pm_power_t *pwr, const pm_power_config_t *config, int64_t now_us);
+
+/*
+* @brief Moves the controller on. Call until it returns PM_POWER_NONE and
+*        carry out every action it returns, in order.
+*
+* @param pwr    - controller
+* @param now_us - current time
+*
+* @return the next action due at now_us, or PM_POWER_NONE
+*/
+pm_power_action_t pm_power_step(pm_power_t *pwr, int64_t now_us);
+
+/*
+* @brief Time pm_power_step() next has something to do.
+*
+* @param pwr - controller
+*
+* @return time in us, or PM_POWER_NEVER
+*/
+int64_t pm_power_next(const pm_power_t *pwr);
+
+/*
+* @brief Counts a decoded frame and says whether it should be used.
+*
+* @param pwr - controller
+*
+* @return 1 in MEASURE, 0 while settling or asleep
+*/
+int pm_power_accept(pm_power_t *pwr);
+
+/*
+* @brief Statistics, with the time in the current state counted up to now.
+*
+* @param pwr    - controller
+* @param now_us - current time
+* @param stats  - where to store the statistics
+*
+* @return void
+*/
+void pm_power_get_stats(const pm_power_t *pwr, int64_t now_us, pm_power_stats_t *stats);
+
+
+#ifndef ESP_PLATFORM
+
+/*
+* @brief Faults the simulated sensor can develop. Each lasts until the fan
+*        next starts, as a power cycle would clear it on the real sensor.
+*/
+typedef enum
+{
+  PM_SIM_OK = 0,
+  PM_SIM_HANG,              // Sends nothing and ignores commands
+  PM_SIM_STUCK,             // Sends the same frame over and over
+  PM_SIM_NOISE              // Every frame fails its checksum
+} pm_sim_fault_t;
+
+/*
+* @brief Simulated PMS sensor
+*/
+typedef struct
+{
+  int64_t now_us;           // Set by the caller, the model has no clock
+  uint16_t pm2_5;           // Reading once the fan has settled
+  uint32_t settle_ms;       // Readings ramp up over this time after a wake up
+  uint8_t set_pin;          // SET pin level, 1 = run
+  uint8_t reset_pin;        // RESET pin level, 1 = run
+  uint8_t cmd_sleep;        // Put to sleep by PM_CMD_SLEEP
+  uint8_t passive;
+  uint8_t query;            // A read request is waiting
+  uint8_t running;          // Fan on
+  int64_t fan_on_us;        // When the fan last started
+  int64_t next_us;          // Next active mode frame
+  uint8_t rx[PM_CMD_LEN];   // Command being received
+  uint8_t rx_fill;
+  uint32_t seq;
+  uint32_t frames;
+  uint32_t commands;
+  uint32_t wakeups;
+  uint64_t fan_us;          // Total fan run time, not counting the current run
+  pm_sim_fault_t fault;
+  int64_t fault_us;         // When 'fault' starts
+} pm_sim_t;
+
+
+/*
+* @brief Sets up a sensor in active mode with its fan running.
+*
+* @param sim       - simulated sensor
+* @param pm2_5     - PM2.5 it reads once settled, ug/m3
+* @param settle_ms - fan spin-up time
+* @param now_us    - current time
+*
+* @return void
+*/
+void pm_sim_init(pm_sim_t *sim, uint16_t pm2_5, uint32_t settle_ms, int64_t now_us);
+
+/*
+* @brief Sets the SET pin level. Set sim->now_us first.
+*/
+void pm_sim_set_pin(pm_sim_t *sim, int level);
+
+/*
+* @brief Sets the RESET pin level. Held low the sensor is off; it comes
+*        back in active mode and awake, as from power on. Set sim->now_us
+*        first.
+*/
+void pm_sim_reset_pin(pm_sim_t *sim, int level);
+
+/*
+* @brief Bytes the node sent. Set sim->now_us first.
+*/
+void pm_sim_rx(pm_sim_t *sim, const uint8_t *data, size_t len);
+
+/*
+* @brief Frame the sensor sends at sim->now_us, if any.
+*
+* @param sim   - simulated sensor
+* @param frame - PM_FRAME_LEN bytes
+*
+* @return PM_FRAME_LEN, or 0 if nothing is due
+*/
+size_t pm_sim_tx(pm_sim_t *sim, uint8_t *frame);
+
+/*
+* @brief Time of the next active mode frame, or PM_POWER_NEVER while asleep
+*        or in passive mode (frames then follow pm_sim_rx()).
+*/
+int64_t pm_sim_next(const pm_sim_t *sim);
+
+/*
+* @brief Total fan run time up to sim->now_us.
+*/
+uint64_t pm_sim_fan_us(const pm_sim_t *sim);
+
+/*
+* @brief Makes the sensor develop a fault.
+*
+* @param sim      - simulated sensor
+* @param fault    - what goes wrong
+* @param fault_us - when; a fan start before then doesn't clear it
+*
+* @return void
+*/
+void pm_sim_fault(pm_sim_t *sim, pm_sim_fault_t fault, int64_t fault_us);
+
+#endif
+
+#endif
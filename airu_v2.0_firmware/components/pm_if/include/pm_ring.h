@@ -0,0 +1,146 @@
+/*
+*	pm_ring.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Lock-free single-producer/single-consumer ring of decoded PM samples.
+*
+*   The PM driver is the only producer. Each consumer (uplink, logging,
+*   BLE, ...) owns its own ring and registers it with PM_add_consumer(), so
+*   every ring has exactly one reader and one writer and needs no mutex. The producer
+*   and consumer indices live on separate cache lines and are published with
+*   acquire/release ordering, so a consumer never sees a half written sample.
+*
+*   If a consumer falls behind, new samples for that consumer are dropped and
+*   counted rather than overwriting ones it may be reading.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _PM_RING_H
+#define _PM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PM_RING_SIZE    64  // Samples per ring, must be a power of two
+#define PM_RING_ALIGN   64  // Keeps producer and consumer indices on separate cache lines
+#define PM_TEMP_NONE    INT16_MIN   // No temperature/humidity reading yet
+#define PM_HUM_NONE     UINT16_MAX
+
+
+/*
+* @brief A single decoded PM sample
+*/
+typedef struct
+{
+  int64_t time_us;          // Time the frame was decoded, in microseconds since boot
+  int64_t utc_us;           // The same time in UTC (us since 1970), 0 if not synced
+  uint32_t seq;             // Running sample number of the channel, gaps mean dropped samples
+  uint8_t channel;          // PM channel (sensor) the sample came from
+  uint16_t pm1;
+  uint16_t pm2_5;
+  uint16_t pm10;
+  int16_t temp;             // Temperature in 0.01 C at the time of the frame, or PM_TEMP_NONE
+  uint16_t hum;             // Relative humidity in 0.01 %, or PM_HUM_NONE
+} pm_sample_t;
+
+/*
+* @brief SPSC ring
+*
+* 'head' is only written by the producer and 'tail' only by the consumer.
+* Each side keeps a private copy of the other side's index so it only has
+* to touch the shared cache line when the ring looks full (or empty).
+*/
+typedef struct
+{
+  struct
+  {
+    volatile uint32_t head;   // Next slot the producer writes
+    uint32_t tail_cache;      // Producer's last view of 'tail'
+    uint32_t dropped;         // Samples dropped because the ring was full
+  } prod __attribute__((aligned(PM_RING_ALIGN)));
+
+  struct
+  {
+    volatile uint32_t tail;   // Next slot the consumer reads
+    uint32_t head_cache;      // Consumer's last view of 'head'
+  } cons __attribute__((aligned(PM_RING_ALIGN)));
+
+  pm_sample_t slots[PM_RING_SIZE] __attribute__((aligned(PM_RING_ALIGN)));
+} pm_ring_t;
+
+
+/*
+* @brief Empties the ring and clears the drop counter. Must not be called
+*        while the producer or consumer is using the ring.
+*
+* @param ring - ring to initialise
+*
+* @return void
+*/
+void pm_ring_init(pm_ring_t *ring);
+
+/*
+* @brief Producer side. Copies one sample into the ring.
+*
+* @param ring   - ring to write
+* @param sample - sample to add
+*
+* @return 1 on success, 0 if the ring was full and the sample was dropped
+*/
+int pm_ring_push(pm_ring_t *ring, const pm_sample_t *sample);
+
+/*
+* @brief Consumer side. Returns a pointer to the oldest unread samples
+*        without copying them.
+*
+* The samples stay valid until they are handed back with pm_ring_release().
+* Only the contiguous run up to the end of the slot array is returned, so
+* call it again after releasing to get anything that wrapped around.
+*
+* @param ring  - ring to read
+* @param first - set to the oldest unread sample
+*
+* @return number of contiguous samples available at *first
+*/
+size_t pm_ring_peek(pm_ring_t *ring, const pm_sample_t **first);
+
+/*
+* @brief Consumer side. Hands samples returned by pm_ring_peek() back to
+*        the producer.
+*
+* @param ring  - ring to release
+* @param count - number of samples to release
+*
+* @return void
+*/
+void pm_ring_release(pm_ring_t *ring, size_t count);
+
+/*
+* @brief Consumer side. Copies up to 'max' of the oldest samples out of the
+*        ring in one batch.
+*
+* @param ring - ring to read
+* @param out  - destination array
+* @param max  - size of 'out'
+*
+* @return number of samples copied
+*/
+size_t pm_ring_pop(pm_ring_t *ring, pm_sample_t *out, size_t max);
+
+/*
+* @brief Number of samples dropped because this ring was full.
+*
+* @param ring - ring to query
+*
+* @return drop count
+*/
+uint32_t pm_ring_dropped(const pm_ring_t *ring);
+
+
+#endif
@@ -0,0 +1,203 @@
+/*
+*	pm_frame.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "pm_frame.h"
+
+#define PM_FRAME_LEN_FIELD  (PM_FRAME_LEN - 4)  // Value of bytes 2-3: frame length minus header and length field
+
+
+/* Global variables */
+
+// Offset of the big endian word holding each field, in pm_field_t order.
+// All three models send their fields back to back after the length.
+static const uint8_t pm_field_offsets[PM_FRAME_FIELDS] =
+{
+  4, 6, 8,                  // CF=1
+  10, 12, 14,               // Atmospheric
+#if PM_FRAME_FIELDS > 6
+  16, 18, 20, 22, 24, 26    // Counts
+#endif
+};
+
+
+/*
+* @brief Resets the framer. See pm_frame.h.
+*/
+void pm_framer_init(pm_framer_t *framer)
+{
+  memset(framer, 0, sizeof(*framer));
+}
+
+
+/*
+* @brief Validates header, length field and checksum of one frame.
+*/
+int pm_frame_valid(const uint8_t *frame)
+{
+  uint16_t checksum;
+  uint16_t sum;
+  uint16_t i;
+
+  if(frame[0] != PM_FRAME_START1 || frame[1] != PM_FRAME_START2)
+    return 0;
+
+  if(frame[2] != 0 || frame[3] != PM_FRAME_LEN_FIELD)
+    return 0;
+
+  checksum = ((uint16_t) frame[PM_FRAME_LEN-2]) << 8;
+  checksum |= (uint16_t) frame[PM_FRAME_LEN-1];
+
+  sum = 0;
+  for(i = 0; i < PM_FRAME_LEN-2; i++)
+  {
+    sum += frame[i];
+  }
+
+  return (sum == checksum);
+}
+
+
+/*
+* @brief Decodes every field. See pm_frame.h.
+*
+* Both loops have a fixed trip count and nothing branches on the frame's
+* contents, so every frame costs the same.
+*/
+void pm_frame_decode(const uint8_t *frame, uint16_t *fields)
+{
+  uint32_t i;
+
+  for(i = 0; i < PM_FRAME_FIELDS; i++)
+  {
+    fields[i] = (uint16_t) (frame[pm_field_offsets[i]] << 8 | frame[pm_field_offsets[i] + 1]);
+  }
+  for(; i < PM_FIELD_NUM; i++)
+  {
+    fields[i] = 0;
+  }
+}
+
+
+/*
+* @brief Builds a command. See pm_frame.h.
+*/
+size_t pm_frame_command(uint8_t *out, uint8_t cmd, uint16_t data)
+{
+  uint16_t sum = 0;
+  int i;
+
+  out[0] = PM_FRAME_START1;
+  out[1] = PM_FRAME_START2;
+  out[2] = cmd;
+  out[3] = data >> 8;
+  out[4] = data & 0xFF;
+  for(i = 0; i < 5; i++)
+  {
+    sum += out[i];
+  }
+  out[5] = sum >> 8;
+  out[6] = sum & 0xFF;
+
+  return PM_CMD_LEN;
+}
+
+
+/*
+* @brief Returns the next valid frame from the stream. See pm_frame.h.
+*/
+const uint8_t *pm_framer_next(pm_framer_t *framer, const uint8_t **buf, size_t *len)
+{
+  const uint8_t *start;
+  size_t take;
+
+  while(*len > 0)
+  {
+    if(framer->fill == 0)
+    {
+      // Hunt for the start of a header in the caller's buffer.
+      start = memchr(*buf, PM_FRAME_START1, *len);
+      if(start == NULL)
+      {
+        framer->stats.bytes_skipped += *len;
+        *buf += *len;
+        *len = 0;
+        return NULL;
+      }
+
+      framer->stats.bytes_skipped += (start - *buf);
+      *len -= (start - *buf);
+      *buf = start;
+
+      // Whole frame is in the caller's buffer, hand it out in place.
+      if(*len >= PM_FRAME_LEN)
+      {
+        if(pm_frame_valid(start))
+        {
+          *buf += PM_FRAME_LEN;
+          *len -= PM_FRAME_LEN;
+          framer->stats.frames++;
+          return start;
+        }
+
+        if(start[1] == PM_FRAME_START2)
+          framer->stats.checksum_errs++;
+        framer->stats.bytes_skipped++;
+        *buf += 1;
+        *len -= 1;
+        continue;
+      }
+
+      // Partial frame at the end of the read, keep it for next time.
+      memcpy(framer->stash, start, *len);
+      framer->fill = *len;
+      *buf += *len;
+      *len = 0;
+      return NULL;
+    }
+
+    // Finish a frame that was split across reads.
+    take = PM_FRAME_LEN - framer->fill;
+    if(take > *len)
+      take = *len;
+
+    memcpy(framer->stash + framer->fill, *buf, take);
+    framer->fill += take;
+    *buf += take;
+    *len -= take;
+
+    if(framer->fill < PM_FRAME_LEN)
+      return NULL;
+
+    if(pm_frame_valid(framer->stash))
+    {
+      framer->fill = 0;
+      framer->stats.frames++;
+      return framer->stash;
+    }
+
+    // Bad stitched frame, resync on the next 'B' already in the stash.
+    if(framer->stash[1] == PM_FRAME_START2)
+      framer->stats.checksum_errs++;
+
+    start = memchr(framer->stash + 1, PM_FRAME_START1, PM_FRAME_LEN - 1);
+    if(start == NULL)
+    {
+      framer->stats.bytes_skipped += PM_FRAME_LEN;
+      framer->fill = 0;
+    }
+    else
+    {
+      framer->stats.bytes_skipped += (start - framer->stash);
+      framer->fill = PM_FRAME_LEN - (start - framer->stash);
+      memmove(framer->stash, start, framer->fill);
+    }
+  }//while
+
+  return NULL;
+}
@@ -0,0 +1,276 @@
+/*
+*	pm_health.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "pm_health.h"
+
+
+/* Function prototypes */
+static void fault(pm_health_t *health, pm_fault_t cause);
+static void enter(pm_health_t *health, pm_health_state_t state, int64_t deadline_us);
+static void window_add(pm_health_t *health, uint32_t good, uint32_t bad);
+
+
+
+/*
+* @brief Starts the state machine. See pm_health.h.
+*/
+void pm_health_init(pm_health_t *health, const pm_health_config_t *config, int64_t now_us)
+{
+  memset(health, 0, sizeof(*health));
+  health->config = *config;
+  health->last_good_us = now_us;
+  health->overflow_us = now_us;
+  health->deadline_us = PM_HEALTH_NEVER;
+}
+
+
+/*
+* @brief A valid frame. See pm_health.h.
+*/
+void pm_health_frame(pm_health_t *health, int64_t now_us, const uint16_t *fields)
+{
+  uint32_t nonzero = 0;
+  uint32_t i;
+
+  if(health->paused || health->powered_off)
+    return;
+
+  for(i = 0; i < PM_FIELD_NUM; i++)
+    nonzero |= fields[i];
+
+  if(nonzero != 0 && memcmp(fields, health->last, sizeof(health->last)) == 0)
+  {
+    if(health->same_run < UINT16_MAX)
+      health->same_run++;
+  }
+  else
+  {
+    health->same_run = 0;
+    memcpy(health->last, fields, sizeof(health->last));
+  }
+
+  if(health->same_run >= health->config.stuck_frames)
+  {
+    health->good_run = 0;
+    fault(health, PM_FAULT_STUCK);
+    return;
+  }
+
+  health->last_good_us = now_us;
+  window_add(health, 1, 0);
+
+  if(health->state != PM_HEALTH_OK && ++health->good_run >= health->config.good_frames)
+  {
+    health->stats.recoveries++;
+    health->stats.last_recover_ms = (uint32_t) ((now_us - health->since_us) / 1000);
+    if(health->stats.last_recover_ms > health->stats.max_recover_ms)
+      health->stats.max_recover_ms = health->stats.last_recover_ms;
+    health->stats.degraded_us += now_us - health->since_us;
+    health->window_good = 0;
+    health->window_bad = 0;
+    enter(health, PM_HEALTH_OK, PM_HEALTH_NEVER);
+  }
+}
+
+
+/*
+* @brief Checksum failures. See pm_health.h.
+*/
+void pm_health_bad(pm_health_t *health, int64_t now_us, uint32_t count)
+{
+  if(health->paused || health->powered_off || count == 0)
+    return;
+
+  health->stats.bad_frames += count;
+  health->good_run = 0;
+  window_add(health, 0, count);
+}
+
+
+/*
+* @brief UART overflow. See pm_health.h.
+*/
+void pm_health_overflow(pm_health_t *health, int64_t now_us)
+{
+  if(health->paused || health->powered_off)
+    return;
+
+  if(now_us - health->overflow_us > (int64_t) health->config.overflow_ms * 1000)
+  {
+    health->overflow_us = now_us;
+    health->overflows = 0;
+  }
+
+  if(++health->overflows >= health->config.overflows)
+  {
+    health->overflows = 0;
+    fault(health, PM_FAULT_OVERFLOW);
+  }
+}
+
+
+/*
+* @brief Frames expected or not. See pm_health.h.
+*/
+void pm_health_pause(pm_health_t *health, int64_t now_us, int paused)
+{
+  int64_t shift;
+
+  paused = (paused != 0);
+  if(paused == health->paused)
+    return;
+
+  health->paused = paused;
+  if(paused)
+  {
+    health->pause_us = now_us;
+    return;
+  }
+
+  // Time asleep doesn't count against silence or a recovery step.
+  shift = now_us - health->pause_us;
+  health->last_good_us += shift;
+  health->overflow_us += shift;
+  if(health->deadline_us != PM_HEALTH_NEVER && !health->powered_off)
+    health->deadline_us += shift;
+}
+
+
+/*
+* @brief Moves the state machine on. See pm_health.h.
+*/
+pm_health_action_t pm_health_step(pm_health_t *health, int64_t now_us)
+{
+  const pm_health_config_t *config = &health->config;
+
+  // A power cycle always finishes, whatever the sleep schedule does.
+  if(health->powered_off)
+  {
+    if(now_us < health->deadline_us)
+      return PM_HEALTH_NONE;
+    health->powered_off = 0;
+    health->last_good_us = now_us;
+    health->deadline_us = now_us + (int64_t) config->recover_ms[2] * 1000;
+    return PM_HEALTH_DO_POWER_ON;
+  }
+
+  if(health->paused)
+    return PM_HEALTH_NONE;
+
+  if(health->state == PM_HEALTH_OK)
+  {
+    if(health->pending == PM_FAULT_NONE &&
+       now_us - health->last_good_us >= (int64_t) config->silence_ms * 1000)
+      fault(health, PM_FAULT_SILENCE);
+    if(health->pending == PM_FAULT_NONE)
+      return PM_HEALTH_NONE;
+
+    health->stats.fault = health->pending;
+    health->stats.faults[health->pending]++;
+    health->pending = PM_FAULT_NONE;
+    health->since_us = now_us;
+    enter(health, PM_HEALTH_RESYNC, now_us + (int64_t) config->recover_ms[0] * 1000);
+    return PM_HEALTH_DO_RESYNC;
+  }
+
+  if(now_us < health->deadline_us)
+    return PM_HEALTH_NONE;
+
+  switch(health->state)
+  {
+    case PM_HEALTH_RESYNC:
+      enter(health, PM_HEALTH_REINIT, now_us + (int64_t) config->recover_ms[1] * 1000);
+      return PM_HEALTH_DO_REINIT;
+
+    case PM_HEALTH_POWER_CYCLE:
+      enter(health, PM_HEALTH_FAILED, now_us + (int64_t) config->retry_ms * 1000);
+      return PM_HEALTH_NONE;
+
+    default:
+      // REINIT, or FAILED after retry_ms
+      enter(health, PM_HEALTH_POWER_CYCLE, now_us + (int64_t) config->off_ms * 1000);
+      health->powered_off = 1;
+      return PM_HEALTH_DO_POWER_OFF;
+  }
+}
+
+
+/*
+* @brief Time of the next step. See pm_health.h.
+*/
+int64_t pm_health_next(const pm_health_t *health)
+{
+  if(health->powered_off)
+    return health->deadline_us;
+  if(health->paused)
+    return PM_HEALTH_NEVER;
+  if(health->state != PM_HEALTH_OK)
+    return health->deadline_us;
+  if(health->pending != PM_FAULT_NONE)
+    return 0;
+
+  return health->last_good_us + (int64_t) health->config.silence_ms * 1000;
+}
+
+
+/*
+* @brief Copies the statistics. See pm_health.h.
+*/
+void pm_health_get_stats(const pm_health_t *health, int64_t now_us, pm_health_stats_t *stats)
+{
+  *stats = health->stats;
+  stats->state = health->state;
+  if(health->state != PM_HEALTH_OK)
+    stats->degraded_us += now_us - health->since_us;
+}
+
+
+/*
+* @brief Notes a fault. While OK it starts a recovery on the next step;
+*        during one the running step's deadline decides.
+*/
+static void fault(pm_health_t *health, pm_fault_t cause)
+{
+  if(health->state == PM_HEALTH_OK && health->pending == PM_FAULT_NONE)
+    health->pending = cause;
+}
+
+
+/*
+* @brief Switches state and counts the step.
+*/
+static void enter(pm_health_t *health, pm_health_state_t state, int64_t deadline_us)
+{
+  health->state = state;
+  health->deadline_us = deadline_us;
+  health->good_run = 0;
+  if(state != PM_HEALTH_OK)
+    health->stats.actions[state]++;
+}
+
+
+/*
+* @brief Adds to the checksum window and checks the failure rate once it
+*        holds PM_HEALTH_WINDOW frames.
+*/
+static void window_add(pm_health_t *health, uint32_t good, uint32_t bad)
+{
+  uint32_t total;
+
+  health->window_good += good;
+  health->window_bad += bad;
+  total = health->window_good + health->window_bad;
+  if(total < PM_HEALTH_WINDOW)
+    return;
+
+  if(health->window_bad * 100 > (uint32_t) health->config.bad_pct * total)
+    fault(health, PM_FAULT_CHECKSUM);
+  health->window_good = 0;
+  health->window_bad = 0;
+}
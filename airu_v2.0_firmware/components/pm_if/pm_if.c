@@ -1,71 +1,217 @@
 /*
 *	pm_if.c
 *	
-*	Last Modified: October 6, 2018
+*	Last Modified: October 17, 2026
 *	 Author: Trenton Taylor
 *
 */
 
-/*
-*   To do:
-*
-* -  add a timer that clears the packet buffer every so often and maybe when you get data.
-* -  finish reset function
-* -  finish get data function
-*
-*/
 #include <stdio.h>
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/uart.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
 #include "pm_if.h"
+#include "gps.h"
+#include "power.h"
+#include "sensor.h"
+#include "timesync.h"
+#include "trace.h"
+
+
+/*
+* @brief State of one PM channel. Everything but the sequence locked
+*        'data' is only touched from vSensor_task.
+*/
+typedef struct
+{
+  uint8_t channel;
+  uart_port_t uart;
+  QueueHandle_t events;
+  pm_framer_t framer;
+  pm_data_t data;
+  volatile uint32_t data_seq;       // Odd while vSensor_task is updating data
+  pm_stats_t stats;
+
+  // Listen window
+  power_lock_t listen_lock;
+  int64_t listen_at_us;
+  int64_t last_frame_us;
+  uint32_t gaps_us[PM_GAP_HISTORY];
+  uint32_t gap_idx;
+  uint32_t resync_left;
+
+  const pm_channel_config_t *config;
+
+  // Sleep schedule and fault recovery
+  pm_power_t power;
+  pm_health_t health;
+  int8_t set_pin;
+  int8_t reset_pin;
+
+  // Samples waiting for PM_decode()
+  sensor_sample_t out[MAX_NUM_PKT];
+  uint32_t out_read;
+  uint32_t out_count;
+
+  sensor_driver_t driver;
+  char name[12];                    // Power lock name, "pm_uartN"
+} pm_dev_t;
 
 
 /* Function prototypes */
 esp_err_t PM_init();
-esp_err_t PM_get_data();
+esp_err_t PM_get_data(uint8_t channel, pm_data_t *data);
+esp_err_t PM_add_consumer(pm_ring_t *ring);
+esp_err_t PM_get_stats(uint8_t channel, pm_stats_t *stats);
+void PM_set_env(int16_t temp, uint16_t hum);
+void PM_set_power(const pm_power_config_t *config);
 esp_err_t PM_reset();
-static void vPM_task(void *pvParameters);
-static esp_err_t get_packet_from_buffer();
-static esp_err_t get_data_from_packet(uint8_t *packet);
-static bool check_sum(uint8_t *buf);
+static esp_err_t channel_init(pm_dev_t *dev, uint8_t channel, const pm_channel_config_t *config);
+static esp_err_t get_data_from_packet(pm_dev_t *dev, const uint8_t *packet);
+static void publish_sample(pm_dev_t *dev);
+static void read_frames(pm_dev_t *dev);
+static esp_err_t PM_driver_init(void *ctx, void **events);
+static uint32_t PM_poll(void *ctx, int64_t now_us, int event);
+static int PM_decode(void *ctx, sensor_sample_t *sample);
+static void listen_update(pm_dev_t *dev, int64_t now_us, uint32_t frames, uint32_t resyncs);
+static uint32_t listen_wait(pm_dev_t *dev, int64_t now_us);
+static void listen_hold(pm_dev_t *dev);
+static void listen_drop(pm_dev_t *dev);
+static void uart_setup(pm_dev_t *dev);
+static void uart_drop(pm_dev_t *dev);
+static void power_start(pm_dev_t *dev, int64_t now_us, int restart);
+static void power_update(pm_dev_t *dev, int64_t now_us);
+static void send_command(pm_dev_t *dev, uint8_t cmd, uint16_t data);
+static int takes_commands(const pm_dev_t *dev);
+static uint32_t next_poll(pm_dev_t *dev, int64_t now_us);
+static void health_update(pm_dev_t *dev, int64_t now_us);
+static void power_off(pm_dev_t *dev);
+
+/* Global variables */
+static pm_dev_t pm_devs[PM_NUM_CHANNELS];
+static pm_ring_t *pm_consumers[PM_MAX_CONSUMERS];
+static volatile uint32_t pm_num_consumers;
+static int16_t pm_temp = PM_TEMP_NONE;    // Only used from vSensor_task
+static uint16_t pm_hum = PM_HUM_NONE;
+static pm_power_config_t pm_power_config =
+{
+  PM_POWER_PERIOD_S, PM_POWER_MEASURE_S, PM_POWER_SETTLE_MS, PM_POWER_QUERY_MS
+};
+static const pm_health_config_t pm_health_config = PM_HEALTH_CONFIG_DEFAULT();
+
+static const pm_channel_config_t pm_channels[PM_MAX_CHANNELS] = PM_CHANNELS;
+
+static const sensor_field_t pm_fields[6] =
+{
+  { "pm1", "ug/m3", 1 },
+  { "pm2_5", "ug/m3", 1 },
+  { "pm10", "ug/m3", 1 },
+  { "pm1_atm", "ug/m3", 1 },
+  { "pm2_5_atm", "ug/m3", 1 },
+  { "pm10_atm", "ug/m3", 1 }
+};
+static const sensor_schema_t pm_schema = { 6, pm_fields };
 
 
 
 /*
-* @brief
+* @brief Sets up every PM channel. See pm_if.h.
+*/
+esp_err_t PM_init()
+{
+  esp_err_t err;
+  uint8_t i;
+
+  esp_log_level_set(TAG_PM, ESP_LOG_INFO);
+
+  for(i = 0; i < PM_NUM_CHANNELS; i++)
+  {
+    err = channel_init(&pm_devs[i], i, &pm_channels[i]);
+    if(err != ESP_OK)
+    {
+      ESP_LOGE(TAG_PM, "channel %u (UART%u): %s", i, pm_channels[i].uart, esp_err_to_name(err));
+      return err;
+    }
+  }
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sets up the UART of one channel and registers its sensor driver.
 *
-* @param
+* @param dev     - channel state
+* @param channel - channel number
+* @param config  - UART and pins
 *
-* @return
+* @return ESP_OK on success, ESP_ERR_INVALID_STATE if the UART belongs to
+*         the GPS or the console, otherwise an error from the UART driver
+*         or sensor_register()
 *
 */
-esp_err_t PM_init()
+static esp_err_t channel_init(pm_dev_t *dev, uint8_t channel, const pm_channel_config_t *config)
 {
   esp_err_t err = ESP_OK;
-  esp_log_level_set(TAG_PM, ESP_LOG_INFO);
 
-  // configure parameters of the UART driver
-  uart_config_t uart_config = 
-  {
-    .baud_rate = 9600,
-    .data_bits = UART_DATA_8_BITS,
-    .parity = UART_PARITY_DISABLE,
-    .stop_bits = UART_STOP_BITS_1,
-    .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
-  };
-  err = uart_param_config(PM_UART_CH, &uart_config);
+  if(GPS_ENABLED && config->uart == GPS_UART_CH)
+    return ESP_ERR_INVALID_STATE;
+#ifndef CONFIG_CONSOLE_UART_NONE
+  if(config->uart == CONFIG_CONSOLE_UART_NUM)
+    return ESP_ERR_INVALID_STATE;
+#endif
 
-  // set UART pins
-  err = uart_set_pin(PM_UART_CH, PM_TXD_PIN, PM_RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  dev->channel = channel;
+  dev->uart = config->uart;
+  dev->config = config;
+  dev->set_pin = config->set_pin;
+  dev->reset_pin = config->reset_pin;
+  dev->resync_left = PM_LISTEN_RESYNC;
+  pm_framer_init(&dev->framer);
 
-  // install UART driver
-  err = uart_driver_install(PM_UART_CH, BUF_SIZE, 0, 20, &PM_event_queue, 0);
+  // install UART driver, with a TX buffer of 0 uart_write_bytes() waits
+  // for the few command bytes to go out
+  err = uart_driver_install(dev->uart, BUF_SIZE, 0, 20, &dev->events, 0);
+  if(err != ESP_OK)
+    return err;
+  uart_setup(dev);
 
-  // create a task to handler UART event from ISR for the PM sensor
-  xTaskCreate(vPM_task, "vPM_task", 2048, NULL, 12, NULL);
+  snprintf(dev->name, sizeof(dev->name), "pm_uart%u", dev->uart);
+  power_lock_create(&dev->listen_lock, POWER_NO_SLEEP, dev->name);
+
+  // Both inputs are active low; the sensor runs with them high.
+  if(dev->set_pin != PM_NO_PIN)
+  {
+    gpio_set_direction(dev->set_pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(dev->set_pin, 1);
+  }
+  if(dev->reset_pin != PM_NO_PIN)
+  {
+    gpio_set_direction(dev->reset_pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(dev->reset_pin, 1);
+  }
+
+  power_start(dev, esp_timer_get_time(), 0);
+  pm_health_init(&dev->health, &pm_health_config, esp_timer_get_time());
+
+  // UART events are handled by the shared sensor task instead of a task of
+  // our own; each channel is a driver of its own there.
+  dev->driver.name = "pms3003";
+  dev->driver.schema = &pm_schema;
+  // A timed poll from the start: passive mode sensors send nothing until
+  // asked, and a sensor that is silent from power on is a fault too.
+  dev->driver.period_ms = dev->power.config.query_ms ? dev->power.config.query_ms :
+                                                       pm_health_config.silence_ms;
+  dev->driver.init = PM_driver_init;
+  dev->driver.poll = PM_poll;
+  dev->driver.decode = PM_decode;
+  dev->driver.ctx = dev;
+  err = sensor_register(&dev->driver);
 
   return err;
 }
@@ -79,17 +225,30 @@ esp_err_t PM_init()
 * @return
 *
 */
-esp_err_t PM_get_data()
+esp_err_t PM_get_data(uint8_t channel, pm_data_t *data)
 {
+  pm_dev_t *dev;
+  uint32_t seq;
+
+  if(channel >= PM_NUM_CHANNELS)
+    return ESP_ERR_INVALID_ARG;
+  dev = &pm_devs[channel];
 
-	/* not done yet */
+  // Sequence lock: retry if vSensor_task was in the middle of an update.
+  do
+  {
+    seq = __atomic_load_n(&dev->data_seq, __ATOMIC_ACQUIRE);
+    *data = dev->data;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || seq != dev->data_seq);
 
-	get_packet_from_buffer();
-	pm_data.sample_count++;
+  if(data->sample_count == 0)
+    return ESP_FAIL;
 
-	return ESP_FAIL;
+  return ESP_OK;
 }
 
+
 /*
 * @brief
 *
@@ -98,12 +257,19 @@ esp_err_t PM_get_data()
 * @return
 *
 */
-esp_err_t PM_reset()
+esp_err_t PM_add_consumer(pm_ring_t *ring)
 {
+  uint32_t n = pm_num_consumers;
 
-	return ESP_FAIL;
-}
+  if(n >= PM_MAX_CONSUMERS)
+    return ESP_ERR_NO_MEM;
 
+  // Fill the slot before vSensor_task can see it.
+  pm_consumers[n] = ring;
+  __atomic_store_n(&pm_num_consumers, n + 1, __ATOMIC_RELEASE);
+
+  return ESP_OK;
+}
 
 /*
 * @brief
@@ -113,94 +279,17 @@ esp_err_t PM_reset()
 * @return
 *
 */
-static void vPM_task(void *pvParameters)
+esp_err_t PM_get_stats(uint8_t channel, pm_stats_t *stats)
 {
-    uart_event_t event;
-    uint8_t buf[BUF_SIZE];
-    uint16_t i_buf = 0;
-    int i;
+  if(channel >= PM_NUM_CHANNELS)
+    return ESP_ERR_INVALID_ARG;
 
+  *stats = pm_devs[channel].stats;
+  stats->framer = pm_devs[channel].framer.stats;
+  pm_power_get_stats(&pm_devs[channel].power, esp_timer_get_time(), &stats->power);
+  pm_health_get_stats(&pm_devs[channel].health, esp_timer_get_time(), &stats->health);
 
-    for(;;) 
-    {
-        //Waiting for UART event.
-        if(xQueueReceive(PM_event_queue, (void * )&event, (portTickType)portMAX_DELAY)) 
-        {
-            bzero(buf, BUF_SIZE);
-            ESP_LOGI(TAG_PM, "uart[%d] event:", PM_UART_CH);
-            switch(event.type) 
-            {
-                case UART_DATA:
-                    printf("____UART_DATA____\n");
-                    ESP_LOGI(TAG_PM, "[UART DATA]: %d", event.size);
-
-                    if(event.size == 24) 
-                    {
-                      uart_read_bytes(PM_UART_CH, buf, event.size, portMAX_DELAY); 
-                      memcpy(pm_buf + i_buf, buf, sizeof(uint8_t) * PM_PKT_LEN);
-                      if(i_buf == BUF_SIZE)
-                        i_buf = 0;
-                      else
-                        i_buf = (i_buf + PM_PKT_LEN); 
-                    }
-
-                    // get some data from the buffer
-                    //get_packet_from_buffer();
-                    PM_get_data();
-
-                    printf("buffer: \n");
-                    for(i = 0; i < BUF_SIZE; i++)
-                    {
-                      printf("%d", pm_buf[i]);
-                    }
-                    printf("\n");
-
-                    printf("------------------\n");
-                    printf("PM 1: %d\n", pm_data.pm1);
-                    printf("PM 2.5: %d\n", pm_data.pm2_5);
-                    printf("PM 10: %d\n", pm_data.pm10);
-                    printf("------------------\n");
-                    
-                    ESP_LOGI(TAG_PM, "[DATA EVT]:");
-                    uart_write_bytes(PM_UART_CH, (const char*) buf, event.size);
-                    break;
-
-                case UART_FIFO_OVF:
-                printf("____UART_FIFO_OVF____\n");
-                    ESP_LOGI(TAG_PM, "hw fifo overflow");
-                    uart_flush_input(PM_UART_CH);
-                    xQueueReset(PM_event_queue);
-                
-                case UART_BUFFER_FULL:
-                    printf("____UART_BUFFER_FULL____\n");
-                    ESP_LOGI(TAG_PM, "ring buffer full");
-                    uart_flush_input(PM_UART_CH);
-                    xQueueReset(PM_event_queue);
-                    break;
-            
-                case UART_BREAK:
-                    printf("____UART_BREAK____\n");
-                    ESP_LOGI(TAG_PM, "uart rx break");
-                    break;
-                
-                case UART_PARITY_ERR:
-                    printf("____UART_PARITY_ERR____\n");
-                    ESP_LOGI(TAG_PM, "uart parity error");
-                    break;
-                
-                case UART_FRAME_ERR:
-                    printf("____UART_FRAME_ERR____\n");
-                    ESP_LOGI(TAG_PM, "uart frame error");
-                    break;
-
-                default:
-                    ESP_LOGI(TAG_PM, "uart event type: %d", event.type);
-                    break;
-            }//case
-        }//if
-    }//for
-    
-    vTaskDelete(NULL);
+  return ESP_OK;
 }
 
 
@@ -212,107 +301,812 @@ static void vPM_task(void *pvParameters)
 * @return
 *
 */
-static esp_err_t get_packet_from_buffer()
+void PM_set_env(int16_t temp, uint16_t hum)
 {
-  uint8_t packet[PM_PKT_LEN];
-  uint16_t i;
+  pm_temp = temp;
+  pm_hum = hum;
+}
 
 
-  // Look for the first valid packet at the end of the buffer and if its not there
-  // then start moving to the front of the buffer looking for one.
-  for(i = BUF_SIZE - PM_PKT_LEN; i > 0; i--)
+/*
+* @brief Sets the sleep schedule. See pm_if.h.
+*/
+void PM_set_power(const pm_power_config_t *config)
+{
+  pm_power_config = *config;
+}
+
+
+/*
+* @brief Resets every channel. See pm_if.h.
+*/
+esp_err_t PM_reset()
+{
+  uart_event_t event;
+  esp_err_t err = ESP_OK;
+  uint8_t i;
+
+  for(i = 0; i < PM_NUM_CHANNELS; i++)
+  {
+    if(pm_devs[i].reset_pin != PM_NO_PIN)
+      gpio_set_level(pm_devs[i].reset_pin, 0);
+  }
+  vTaskDelay(PM_RESET_PULSE_MS / portTICK_PERIOD_MS);
+
+  // The channel state belongs to vSensor_task, so hand it the reset as an
+  // event no UART driver posts.
+  memset(&event, 0, sizeof(event));
+  event.type = UART_EVENT_MAX;
+  for(i = 0; i < PM_NUM_CHANNELS; i++)
   {
-  	if(pm_buf[i] == 'B' && pm_buf[i+1] == 'M')
-  	{
-  		memcpy(packet, pm_buf + i, sizeof(uint8_t) * PM_PKT_LEN);
-
-  		if(check_sum(packet))
-  		{
-  			// Store the data from the valid packet found in the global pm struct.
-  			//printf("Found valid packet at index: %d\n", i);
-  			get_data_from_packet(packet);
-  			pm_data.sample_count++;
-  			return ESP_OK;
-  		}
-  	}
-  }//for
-
-  return ESP_FAIL;
+    if(pm_devs[i].reset_pin != PM_NO_PIN)
+      gpio_set_level(pm_devs[i].reset_pin, 1);
+    if(pm_devs[i].events == NULL || xQueueSend(pm_devs[i].events, &event, 0) != pdTRUE)
+      err = ESP_FAIL;
+  }
+
+  return err;
 }
 
 
 /*
-* @brief
+* @brief Sensor driver init. The UART is already set up by PM_init(), so
+*        this only hands the scheduler the channel's UART event queue.
 *
-* @param
+* @param ctx    - channel state
+* @param events - set to the UART event queue
 *
-* @return
+* @return ESP_OK
+*
+*/
+static esp_err_t PM_driver_init(void *ctx, void **events)
+{
+  pm_dev_t *dev = ctx;
+
+  *events = dev->events;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sensor driver poll. Carries out any due sleep schedule step, then
+*        handles one UART event or opens the listen window when the next
+*        frame is due.
+*
+* @param ctx    - channel state
+* @param now_us - current time
+* @param event  - 1 if the UART event queue has an item
+*
+* @return ms until the listen window opens or the next schedule step, or
+*         SENSOR_NEXT_PERIOD to keep listening
 *
 */
-static esp_err_t get_data_from_packet(uint8_t *packet)
+static uint32_t PM_poll(void *ctx, int64_t now_us, int event)
 {
-  uint16_t tmp;
-  uint8_t tmp2;
+    pm_dev_t *dev = ctx;
+    uart_event_t uart_event;
+    uint32_t frames;
+    uint32_t resyncs;
+    uint32_t bad;
+
+    power_update(dev, now_us);
+    health_update(dev, now_us);
+
+    if(!event)
+    {
+        // The next frame is due, stay awake for it.
+        if(dev->power.state != PM_POWER_SLEEP && dev->power.config.query_ms == 0 &&
+           dev->listen_at_us <= now_us)
+            listen_hold(dev);
+        return next_poll(dev, now_us);
+    }
+
+    // The queue set can still hold entries for events dropped by xQueueReset().
+    if(!xQueueReceive(dev->events, (void * )&uart_event, 0))
+        return next_poll(dev, now_us);
+
+    dev->stats.wakeups++;
+    TRACE(TR_PM_EVENT, uart_event.type, uart_event.size, dev->channel);
+    switch(uart_event.type) 
+    {
+        case UART_DATA:
+            frames = dev->framer.stats.frames;
+            resyncs = dev->framer.stats.bytes_skipped + dev->framer.stats.checksum_errs;
+            bad = dev->framer.stats.checksum_errs;
+            read_frames(dev);
+            frames = dev->framer.stats.frames - frames;
+            resyncs = dev->framer.stats.bytes_skipped + dev->framer.stats.checksum_errs - resyncs;
+            bad = dev->framer.stats.checksum_errs - bad;
+            listen_update(dev, now_us, frames, resyncs);
+            pm_health_bad(&dev->health, now_us, bad);
+
+            TRACE(TR_PM_FRAMES, frames, resyncs, dev->channel);
+            if(frames > 0)
+                TRACE(TR_PM_DATA, dev->data.pm1, dev->data.pm2_5, dev->data.pm10);
+            break;
+
+        case UART_FIFO_OVF:
+            TRACE(TR_PM_FIFO_OVF, dev->channel, 0, 0);
+            dev->stats.overflows++;
+            uart_drop(dev);
+            pm_health_overflow(&dev->health, now_us);
+            break;
 
+        case UART_BUFFER_FULL:
+            TRACE(TR_PM_BUF_FULL, dev->channel, 0, 0);
+            dev->stats.overflows++;
+            uart_drop(dev);
+            pm_health_overflow(&dev->health, now_us);
+            break;
     
-  if(packet == NULL)
-    return ESP_FAIL;
+        case UART_BREAK:
+            TRACE(TR_PM_BREAK, dev->channel, 0, 0);
+            break;
+        
+        case UART_PARITY_ERR:
+            TRACE(TR_PM_PARITY, dev->channel, 0, 0);
+            break;
+        
+        case UART_FRAME_ERR:
+            TRACE(TR_PM_FRAME_ERR, dev->channel, 0, 0);
+            break;
+
+        case UART_EVENT_MAX:
+            // PM_reset()
+            uart_flush_input(dev->uart);
+            pm_framer_init(&dev->framer);
+            power_start(dev, now_us, 1);
+            break;
+
+        default:
+            break;
+    }//case
+
+    // Act on what the event showed straight away.
+    health_update(dev, now_us);
+
+    return next_poll(dev, now_us);
+}
+
+
+/*
+* @brief Sensor driver decode. Hands out the frames read by the last poll.
+*
+* @param ctx    - channel state
+* @param sample - where to store the sample
+*
+* @return 1 if a sample was copied, 0 if there are none left
+*
+*/
+static int PM_decode(void *ctx, sensor_sample_t *sample)
+{
+  pm_dev_t *dev = ctx;
 
-  // PM1 data
-  tmp = packet[PKT_PM1_HIGH];
-  tmp2 = packet[PKT_PM1_LOW];
-  tmp = tmp << sizeof(uint8_t);
-  tmp = tmp | tmp2;
-  pm_data.pm1 = tmp;
+  if(dev->out_count == 0)
+    return 0;
 
-  // PM2.5 data
-  tmp = packet[PKT_PM2_5_HIGH];
-  tmp2 = packet[PKT_PM2_5_LOW];
-  tmp = tmp << sizeof(uint8_t);
-  tmp = tmp | tmp2;
-  pm_data.pm2_5 = tmp;
+  *sample = dev->out[dev->out_read];
+  dev->out_read = (dev->out_read + 1) % MAX_NUM_PKT;
+  dev->out_count--;
 
-  // PM10 data
-  tmp = packet[PKT_PM10_HIGH];
-  tmp2 = packet[PKT_PM10_LOW];
-  tmp = tmp << sizeof(uint8_t);
-  tmp = tmp | tmp2;
-  pm_data.pm10 = tmp;
+  return 1;
+}
 
 
+/*
+* @brief Decodes a frame into the channel's pm_data_t.
+*
+* @param dev    - channel state
+* @param packet - valid frame
+*
+* @return ESP_OK, or ESP_FAIL if there is no frame
+*
+*/
+static esp_err_t get_data_from_packet(pm_dev_t *dev, const uint8_t *packet)
+{
+  if(packet == NULL)
+    return ESP_FAIL;
+
+  pm_frame_decode(packet, dev->data.fields);
+  dev->data.pm1 = dev->data.fields[PM_FIELD_PM1];
+  dev->data.pm2_5 = dev->data.fields[PM_FIELD_PM2_5];
+  dev->data.pm10 = dev->data.fields[PM_FIELD_PM10];
+
   return ESP_OK;
 }
 
 
 /*
-* @brief
+* @brief Drains everything the UART driver has buffered through the framer.
+*
+* Reading all buffered bytes rather than just event.size means a frame that
+* was split over two events is finished on the first wakeup, and the queued
+* second event finds nothing left to do.
 *
 * @param
 *
 * @return
 *
 */
-static bool check_sum(uint8_t *buf)
+static void read_frames(pm_dev_t *dev)
+{
+  uint8_t buf[BUF_SIZE];
+  const uint8_t *p;
+  const uint8_t *frame;
+  size_t len;
+  int64_t start;
+  int n;
+
+  start = esp_timer_get_time();
+  dev->stats.data_events++;
+
+  for(;;)
+  {
+    n = uart_read_bytes(dev->uart, buf, BUF_SIZE, 0);
+    if(n <= 0)
+      break;
+
+    dev->stats.bytes += n;
+    p = buf;
+    len = n;
+    while((frame = pm_framer_next(&dev->framer, &p, &len)) != NULL)
+    {
+      if(!pm_power_accept(&dev->power))
+        continue;
+
+      // Sequence lock around the update, see PM_get_data().
+      __atomic_store_n(&dev->data_seq, dev->data_seq + 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_RELEASE);
+      get_data_from_packet(dev, frame);
+      dev->data.sample_count++;
+      dev->data.time_us = esp_timer_get_time();
+      dev->data.utc_us = timesync_utc(dev->data.time_us);
+      __atomic_store_n(&dev->data_seq, dev->data_seq + 1, __ATOMIC_RELEASE);
+
+      pm_health_frame(&dev->health, dev->data.time_us, dev->data.fields);
+      publish_sample(dev);
+    }
+
+    if(n < BUF_SIZE)
+      break;
+  }
+
+  dev->stats.busy_us += (uint32_t) (esp_timer_get_time() - start);
+}
+
+
+/*
+* @brief Pushes the channel's latest sample to every registered consumer
+*        ring and to PM_decode().
+*
+* @param dev - channel state
+*
+* @return void
+*
+*/
+static void publish_sample(pm_dev_t *dev)
+{
+  pm_sample_t sample;
+  sensor_sample_t *out;
+  uint32_t n;
+  uint32_t i;
+
+  sample.time_us = dev->data.time_us;
+  sample.utc_us = dev->data.utc_us;
+  sample.seq = dev->data.sample_count;
+  sample.channel = dev->channel;
+  sample.pm1 = dev->data.pm1;
+  sample.pm2_5 = dev->data.pm2_5;
+  sample.pm10 = dev->data.pm10;
+  sample.temp = pm_temp;
+  sample.hum = pm_hum;
+
+  if(dev->out_count < MAX_NUM_PKT)
+  {
+    out = &dev->out[(dev->out_read + dev->out_count) % MAX_NUM_PKT];
+    out->time_us = sample.time_us;
+    out->utc_us = sample.utc_us;
+    out->count = 6;
+    out->values[0] = sample.pm1;
+    out->values[1] = sample.pm2_5;
+    out->values[2] = sample.pm10;
+    out->values[3] = dev->data.fields[PM_FIELD_PM1_ATM];
+    out->values[4] = dev->data.fields[PM_FIELD_PM2_5_ATM];
+    out->values[5] = dev->data.fields[PM_FIELD_PM10_ATM];
+    dev->out_count++;
+  }
+  else
+  {
+    dev->stats.dropped_samples++;
+  }
+
+  n = __atomic_load_n(&pm_num_consumers, __ATOMIC_ACQUIRE);
+  for(i = 0; i < n; i++)
+  {
+    pm_ring_push(pm_consumers[i], &sample);
+  }
+}
+
+
+/*
+* @brief Moves the listen window after a UART_DATA event and releases the
+*        listen lock until the next frame is due.
+*
+* @param dev     - channel state
+* @param now_us  - current time
+* @param frames  - frames decoded by this event
+* @param resyncs - bytes skipped plus checksum errors in this event
+*
+* @return void
+*
+*/
+static void listen_update(pm_dev_t *dev, int64_t now_us, uint32_t frames, uint32_t resyncs)
 {
-  uint16_t checksum;
-  uint16_t sum;
-  uint16_t i;
+  int64_t next_us;
+  int64_t at_us;
+  uint32_t gap;
+  uint32_t i;
 
-  if(buf[0] != 'B' && buf[1] != 'M')
+  // Nothing comes in passive mode until the next read request.
+  if(dev->power.config.query_ms > 0)
   {
-    return false;
+    if(frames > 0)
+      listen_drop(dev);
+    return;
   }
 
-  checksum = ((uint16_t) buf[PM_PKT_LEN-2]) << 8;
-  checksum += (uint16_t) buf[PM_PKT_LEN-1];
+  if(resyncs > 0 && (dev->listen_lock.depth == 0 ||
+                      now_us - dev->listen_lock.since_us < PM_FRAME_US))
+  {
+    // A frame started while the chip was asleep: the window was too late.
+    dev->stats.listen_misses++;
+    dev->resync_left = PM_LISTEN_RESYNC;
+    memset(dev->gaps_us, 0, sizeof(dev->gaps_us));
+    listen_hold(dev);
+  }
+
+  // Only the start of a frame came in, stay awake for the rest of it.
+  if(frames == 0)
+  {
+    listen_hold(dev);
+    return;
+  }
+
+  if(dev->last_frame_us > 0)
+  {
+    dev->gaps_us[dev->gap_idx] = (uint32_t) (now_us - dev->last_frame_us);
+    dev->gap_idx = (dev->gap_idx + 1) % PM_GAP_HISTORY;
+  }
+  dev->last_frame_us = now_us;
+
+  // The event can end with the start of the next frame already in.
+  if(dev->resync_left > 0 || dev->framer.fill > 0)
+  {
+    if(dev->resync_left > 0)
+      dev->resync_left--;
+    listen_hold(dev);
+    return;
+  }
 
-  sum = 0;
-  for(i = 0; i < PM_PKT_LEN-2 ; i++)
+  // The sensor speeds up when readings change, so go by the shortest gap.
+  gap = UINT32_MAX;
+  for(i = 0; i < PM_GAP_HISTORY; i++)
   {
-    sum += buf[i];
+    if(dev->gaps_us[i] == 0)
+      return;
+    if(dev->gaps_us[i] < gap)
+      gap = dev->gaps_us[i];
   }
 
-  return (sum == checksum);
+  if(gap / 1000 <= PM_LISTEN_GUARD_MS + PM_FRAME_US / 1000)
+    return;
+
+  // An event can be handled late but never early, so project the next
+  // frame from each of the last ones and go by the earliest.
+  next_us = now_us + gap;
+  at_us = now_us;
+  for(i = 1; i <= PM_GAP_HISTORY; i++)
+  {
+    at_us -= dev->gaps_us[(dev->gap_idx + PM_GAP_HISTORY - i) % PM_GAP_HISTORY];
+    if(at_us + (int64_t) (i + 1) * gap < next_us)
+      next_us = at_us + (int64_t) (i + 1) * gap;
+  }
+
+  // Events come at the end of a frame, so the next one starts a frame's
+  // time on the wire before that.
+  dev->listen_at_us = next_us - PM_FRAME_US - PM_LISTEN_GUARD_MS * 1000;
+  listen_drop(dev);
+}
+
+
+/*
+* @brief Time until the listen window opens.
+*
+* @param dev    - channel state
+* @param now_us - current time
+*
+* @return ms to wait, or SENSOR_NEXT_PERIOD while the lock is held or
+*         no frames are expected
+*
+*/
+static uint32_t listen_wait(pm_dev_t *dev, int64_t now_us)
+{
+  uint32_t ms = 1;
+
+  if(dev->listen_lock.depth > 0)
+    return SENSOR_NEXT_PERIOD;
+  if(dev->power.state == PM_POWER_SLEEP || dev->power.config.query_ms > 0)
+    return SENSOR_NEXT_PERIOD;
+
+  // Round up so the poll doesn't come before the window, but never 0.
+  if(dev->listen_at_us > now_us)
+    ms = (uint32_t) ((dev->listen_at_us - now_us + 999) / 1000);
+
+  TRACE(TR_PM_LISTEN, ms, dev->channel, 0);
+  return ms;
+}
+
+
+/*
+* @brief Takes the listen lock unless it is already held. Several events
+*        can ask for it before one releases it.
+*
+* @param dev - channel state
+*
+* @return void
+*
+*/
+static void listen_hold(pm_dev_t *dev)
+{
+  if(dev->listen_lock.depth == 0)
+    power_lock_acquire(&dev->listen_lock);
+}
+
+
+/*
+* @brief Releases the listen lock if it is held.
+*
+* @param dev - channel state
+*
+* @return void
+*
+*/
+static void listen_drop(pm_dev_t *dev)
+{
+  if(dev->listen_lock.depth > 0)
+    power_lock_release(&dev->listen_lock);
+}
+
+
+/*
+* @brief Starts the sleep schedule from a wake up: on power on, after
+*        PM_reset() and after a power cycle.
+*
+* A sensor that can't be slept has been running since power on, which may
+* be long before this boot, so its frames are used from the start.
+*
+* @param dev     - channel state
+* @param now_us  - current time
+* @param restart - 0 at power on, 1 to keep the statistics
+*
+* @return void
+*
+*/
+static void power_start(pm_dev_t *dev, int64_t now_us, int restart)
+{
+  pm_power_config_t config = pm_power_config;
+  pm_power_stats_t stats;
+
+  if(dev->set_pin == PM_NO_PIN && !takes_commands(dev))
+  {
+    config.period_s = 0;
+    config.settle_ms = 0;
+  }
+  if(!takes_commands(dev))
+    config.query_ms = 0;
+
+  // The statistics carry on over a restart.
+  if(restart)
+    pm_power_get_stats(&dev->power, now_us, &stats);
+  pm_power_init(&dev->power, &config, now_us);
+  if(restart)
+  {
+    stats.wakeups++;
+    dev->power.stats = stats;
+  }
+
+  if(takes_commands(dev))
+  {
+    send_command(dev, PM_CMD_SLEEP, 1);
+    send_command(dev, PM_CMD_MODE, config.query_ms == 0);
+  }
+  if(dev->set_pin != PM_NO_PIN)
+    gpio_set_level(dev->set_pin, 1);
+
+  // Listen until the frame timing is known.
+  dev->listen_at_us = 0;
+  dev->last_frame_us = 0;
+  dev->resync_left = PM_LISTEN_RESYNC;
+  memset(dev->gaps_us, 0, sizeof(dev->gaps_us));
+  if(config.query_ms == 0)
+    listen_hold(dev);
+  else
+    listen_drop(dev);
+
+  TRACE(TR_PM_POWER, dev->power.state, PM_POWER_WAKE, dev->channel);
+}
+
+
+/*
+* @brief Carries out the sleep schedule steps that are due.
+*
+* @param dev    - channel state
+* @param now_us - current time
+*
+* @return void
+*
+*/
+static void power_update(pm_dev_t *dev, int64_t now_us)
+{
+  pm_power_action_t action;
+
+  // The schedule waits for a power cycle to finish.
+  if(dev->health.powered_off)
+    return;
+
+  while((action = pm_power_step(&dev->power, now_us)) != PM_POWER_NONE)
+  {
+    TRACE(TR_PM_POWER, dev->power.state, action, dev->channel);
+
+    switch(action)
+    {
+      case PM_POWER_WAKE:
+        if(dev->set_pin != PM_NO_PIN)
+          gpio_set_level(dev->set_pin, 1);
+        else
+          send_command(dev, PM_CMD_SLEEP, 1);
+
+        // The frame timing starts over with the fan.
+        dev->listen_at_us = 0;
+        dev->last_frame_us = 0;
+        dev->resync_left = PM_LISTEN_RESYNC;
+        memset(dev->gaps_us, 0, sizeof(dev->gaps_us));
+        if(dev->power.config.query_ms == 0)
+          listen_hold(dev);
+        break;
+
+      case PM_POWER_GOTO_SLEEP:
+        if(dev->set_pin != PM_NO_PIN)
+          gpio_set_level(dev->set_pin, 0);
+        else
+          send_command(dev, PM_CMD_SLEEP, 0);
+        listen_drop(dev);
+        break;
+
+      case PM_POWER_QUERY:
+        send_command(dev, PM_CMD_READ, 0);
+        listen_hold(dev);
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+
+/*
+* @brief Sends a command to a sensor that takes them.
+*
+* @param dev  - channel state
+* @param cmd  - PM_CMD_xxx
+* @param data - command data
+*
+* @return void
+*
+*/
+static void send_command(pm_dev_t *dev, uint8_t cmd, uint16_t data)
+{
+  uint8_t buf[PM_CMD_LEN];
+
+  if(!takes_commands(dev))
+    return;
+
+  pm_frame_command(buf, cmd, data);
+  uart_write_bytes(dev->uart, (const char *) buf, sizeof(buf));
+}
+
+
+/*
+* @brief Whether commands can reach the sensor: the model takes them and
+*        the channel's TX is wired (on both boards the TX pin of the PM
+*        header is RESET instead).
+*
+* @param dev - channel state
+*
+* @return 1 if they can
+*
+*/
+static int takes_commands(const pm_dev_t *dev)
+{
+  return PM_FRAME_COMMANDS && dev->config->txd_pin != PM_NO_PIN;
+}
+
+
+/*
+* @brief Time until the channel next needs a poll: the listen window, the
+*        next sleep schedule step or the next health check, whichever
+*        comes first.
+*
+* @param dev    - channel state
+* @param now_us - current time
+*
+* @return ms to wait, or SENSOR_NEXT_PERIOD to wait for UART events
+*
+*/
+static uint32_t next_poll(pm_dev_t *dev, int64_t now_us)
+{
+  uint32_t ms = listen_wait(dev, now_us);
+  uint32_t step_ms = 1;
+  int64_t next_us;
+
+  next_us = pm_power_next(&dev->power);
+  if(pm_health_next(&dev->health) < next_us)
+    next_us = pm_health_next(&dev->health);
+  if(next_us == PM_POWER_NEVER)
+    return ms;
+
+  if(next_us > now_us)
+    step_ms = (uint32_t) ((next_us - now_us + 999) / 1000);
+  if(ms == SENSOR_NEXT_PERIOD || step_ms < ms)
+    return step_ms;
+
+  return ms;
 }
 
 
+/*
+* @brief Sets the UART up: line settings, pins and the RX interrupt
+*        thresholds. Done once the driver is installed and again by a
+*        health REINIT.
+*
+* @param dev - channel state
+*
+* @return void
+*
+*/
+static void uart_setup(pm_dev_t *dev)
+{
+  // configure parameters of the UART driver
+  uart_config_t uart_config =
+  {
+    .baud_rate = PM_BAUD,
+    .data_bits = UART_DATA_8_BITS,
+    .parity = UART_PARITY_DISABLE,
+    .stop_bits = UART_STOP_BITS_1,
+    .flow_ctrl = UART_HW_FLOWCTRL_DISABLE
+  };
+  uart_param_config(dev->uart, &uart_config);
+
+  // set UART pins
+  uart_set_pin(dev->uart, dev->config->txd_pin, dev->config->rxd_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+
+  // Only interrupt once per frame (FIFO holds a full frame) or when the line
+  // goes idle part way through one, instead of the driver's default of
+  // 120 bytes / 10 symbols.
+  uart_intr_config_t intr_config =
+  {
+    .intr_enable_mask = UART_RXFIFO_FULL_INT_ENA_M | UART_RXFIFO_TOUT_INT_ENA_M |
+                        UART_FRM_ERR_INT_ENA_M | UART_RXFIFO_OVF_INT_ENA_M |
+                        UART_BRK_DET_INT_ENA_M | UART_PARITY_ERR_INT_ENA_M,
+    .rxfifo_full_thresh = PM_RXFIFO_FULL_THRESH,
+    .rx_timeout_thresh = PM_RX_TOUT_THRESH,
+    .txfifo_empty_intr_thresh = 10
+  };
+  uart_intr_config(dev->uart, &intr_config);
+}
+
+
+/*
+* @brief Throws away everything buffered and queued for the UART and
+*        starts framing over. The framer's counters carry on.
+*
+* @param dev - channel state
+*
+* @return void
+*
+*/
+static void uart_drop(pm_dev_t *dev)
+{
+  pm_frame_stats_t stats = dev->framer.stats;
+  size_t len;
+
+  if(uart_get_buffered_data_len(dev->uart, &len) == ESP_OK)
+    dev->stats.dropped_bytes += len;
+  uart_flush_input(dev->uart);
+  xQueueReset(dev->events);
+  pm_framer_init(&dev->framer);
+  dev->framer.stats = stats;
+}
+
+
+/*
+* @brief Keeps the health state machine in step with the sleep schedule
+*        and carries out the recovery steps that are due.
+*
+* @param dev    - channel state
+* @param now_us - current time
+*
+* @return void
+*
+*/
+static void health_update(pm_dev_t *dev, int64_t now_us)
+{
+  pm_health_action_t action;
+
+  // Frames are only expected while measuring.
+  pm_health_pause(&dev->health, now_us, dev->power.state != PM_POWER_MEASURE);
+
+  while((action = pm_health_step(&dev->health, now_us)) != PM_HEALTH_NONE)
+  {
+    TRACE(TR_PM_HEALTH, dev->health.state, action, dev->channel);
+
+    switch(action)
+    {
+      case PM_HEALTH_DO_RESYNC:
+        ESP_LOGW(TAG_PM, "channel %u: fault %u, resyncing", dev->channel, dev->health.stats.fault);
+        uart_drop(dev);
+        dev->listen_at_us = 0;
+        dev->resync_left = PM_LISTEN_RESYNC;
+        if(dev->power.config.query_ms == 0)
+          listen_hold(dev);
+        break;
+
+      case PM_HEALTH_DO_REINIT:
+        ESP_LOGW(TAG_PM, "channel %u: setting the UART up again", dev->channel);
+        uart_setup(dev);
+        uart_drop(dev);
+        break;
+
+      case PM_HEALTH_DO_POWER_OFF:
+        ESP_LOGW(TAG_PM, "channel %u: power cycling the sensor", dev->channel);
+        power_off(dev);
+        listen_drop(dev);
+        break;
+
+      case PM_HEALTH_DO_POWER_ON:
+        if(dev->reset_pin != PM_NO_PIN)
+          gpio_set_level(dev->reset_pin, 1);
+        uart_drop(dev);
+        power_start(dev, now_us, 1);
+        pm_health_pause(&dev->health, now_us, dev->power.state != PM_POWER_MEASURE);
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+
+/*
+* @brief First half of a power cycle: RESET low if it is wired, else SET
+*        low, else the sleep command. A PMS3003 with neither pin can't be
+*        power cycled; power_start() then only sets the listen state and
+*        schedule up again.
+*
+* @param dev - channel state
+*
+* @return void
+*
+*/
+static void power_off(pm_dev_t *dev)
+{
+  if(dev->reset_pin != PM_NO_PIN)
+    gpio_set_level(dev->reset_pin, 0);
+  else if(dev->set_pin != PM_NO_PIN)
+    gpio_set_level(dev->set_pin, 0);
+  else
+    send_command(dev, PM_CMD_SLEEP, 0);
+}
@@ -0,0 +1,143 @@
+/*
+*	pm_power.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "pm_power.h"
+
+
+/* Function prototypes */
+static void enter(pm_power_t *pwr, pm_power_state_t state, int64_t now_us);
+
+
+
+/*
+* @brief Starts the controller. See pm_power.h.
+*/
+void pm_power_init(pm_power_t *pwr, const pm_power_config_t *config, int64_t now_us)
+{
+  uint32_t min_s;
+
+  memset(pwr, 0, sizeof(*pwr));
+  pwr->config = *config;
+
+  // A window has to hold the spin-up and the measurement.
+  min_s = (config->settle_ms + 999) / 1000 + config->measure_s;
+  if(pwr->config.period_s > 0 && pwr->config.period_s < min_s)
+    pwr->config.period_s = min_s;
+
+  pwr->state = PM_POWER_SETTLE;
+  pwr->since_us = now_us;
+  pwr->window_us = now_us;
+  pwr->measure_end_us = PM_POWER_NEVER;
+  pwr->next_us = now_us + (int64_t) config->settle_ms * 1000;
+  pwr->stats.wakeups = 1;
+}
+
+
+/*
+* @brief Moves the controller on. See pm_power.h.
+*/
+pm_power_action_t pm_power_step(pm_power_t *pwr, int64_t now_us)
+{
+  const pm_power_config_t *config = &pwr->config;
+
+  while(now_us >= pwr->next_us)
+  {
+    switch(pwr->state)
+    {
+      case PM_POWER_SLEEP:
+        // Windows stay on their grid however late the wake up is.
+        pwr->window_us = pwr->next_us;
+        pwr->next_us = now_us + (int64_t) config->settle_ms * 1000;
+        pwr->stats.wakeups++;
+        enter(pwr, PM_POWER_SETTLE, now_us);
+        return PM_POWER_WAKE;
+
+      case PM_POWER_SETTLE:
+        pwr->measure_end_us = (config->period_s > 0) ? now_us + (int64_t) config->measure_s * 1000000 :
+                                                       PM_POWER_NEVER;
+        pwr->next_us = (config->query_ms > 0) ? now_us : pwr->measure_end_us;
+        enter(pwr, PM_POWER_MEASURE, now_us);
+        break;
+
+      case PM_POWER_MEASURE:
+        if(now_us >= pwr->measure_end_us)
+        {
+          pwr->next_us = pwr->window_us + (int64_t) config->period_s * 1000000;
+          enter(pwr, PM_POWER_SLEEP, now_us);
+          return PM_POWER_GOTO_SLEEP;
+        }
+
+        // Reads stay on their grid too, the poll is always a little late.
+        pwr->next_us += (int64_t) config->query_ms * 1000;
+        if(pwr->next_us <= now_us)
+          pwr->next_us = now_us + (int64_t) config->query_ms * 1000;
+        if(pwr->next_us > pwr->measure_end_us)
+          pwr->next_us = pwr->measure_end_us;
+        pwr->stats.queries++;
+        return PM_POWER_QUERY;
+
+      default:
+        return PM_POWER_NONE;
+    }
+  }
+
+  return PM_POWER_NONE;
+}
+
+
+/*
+* @brief Time of the next step. See pm_power.h.
+*/
+int64_t pm_power_next(const pm_power_t *pwr)
+{
+  return pwr->next_us;
+}
+
+
+/*
+* @brief Counts a frame. See pm_power.h.
+*/
+int pm_power_accept(pm_power_t *pwr)
+{
+  if(pwr->state != PM_POWER_MEASURE)
+  {
+    pwr->stats.frames_dropped++;
+    return 0;
+  }
+
+  pwr->stats.frames++;
+  return 1;
+}
+
+
+/*
+* @brief Copies the statistics. See pm_power.h.
+*/
+void pm_power_get_stats(const pm_power_t *pwr, int64_t now_us, pm_power_stats_t *stats)
+{
+  *stats = pwr->stats;
+  stats->state_us[pwr->state] += now_us - pwr->since_us;
+}
+
+
+/*
+* @brief Switches state, adding up the time spent in the old one.
+*
+* @param pwr    - controller
+* @param state  - new state
+* @param now_us - current time
+*
+* @return void
+*/
+static void enter(pm_power_t *pwr, pm_power_state_t state, int64_t now_us)
+{
+  pwr->stats.state_us[pwr->state] += now_us - pwr->since_us;
+  pwr->state = state;
+  pwr->since_us = now_us;
+}
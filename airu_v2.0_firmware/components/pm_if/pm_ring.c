@@ -0,0 +1,118 @@
+/*
+*	pm_ring.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "pm_ring.h"
+
+#define RING_MASK (PM_RING_SIZE - 1)
+
+#if (PM_RING_SIZE & RING_MASK) != 0
+#error "PM_RING_SIZE must be a power of two"
+#endif
+
+// Indices are free running and only masked when a slot is accessed, so
+// head - tail is always the number of unread samples.
+#define LOAD_ACQUIRE(p)      __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+
+/*
+* @brief Empties the ring. See pm_ring.h.
+*/
+void pm_ring_init(pm_ring_t *ring)
+{
+  memset(ring, 0, sizeof(*ring));
+}
+
+
+/*
+* @brief Producer side push. See pm_ring.h.
+*/
+int pm_ring_push(pm_ring_t *ring, const pm_sample_t *sample)
+{
+  uint32_t head = ring->prod.head;
+
+  if(head - ring->prod.tail_cache == PM_RING_SIZE)
+  {
+    ring->prod.tail_cache = LOAD_ACQUIRE(&ring->cons.tail);
+    if(head - ring->prod.tail_cache == PM_RING_SIZE)
+    {
+      ring->prod.dropped++;
+      return 0;
+    }
+  }
+
+  ring->slots[head & RING_MASK] = *sample;
+
+  // Publish the slot only after it has been written.
+  STORE_RELEASE(&ring->prod.head, head + 1);
+  return 1;
+}
+
+
+/*
+* @brief Consumer side zero-copy read. See pm_ring.h.
+*/
+size_t pm_ring_peek(pm_ring_t *ring, const pm_sample_t **first)
+{
+  uint32_t tail = ring->cons.tail;
+  uint32_t avail;
+  uint32_t to_end;
+
+  if(ring->cons.head_cache == tail)
+    ring->cons.head_cache = LOAD_ACQUIRE(&ring->prod.head);
+
+  avail = ring->cons.head_cache - tail;
+  to_end = PM_RING_SIZE - (tail & RING_MASK);
+
+  *first = &ring->slots[tail & RING_MASK];
+  return (avail < to_end) ? avail : to_end;
+}
+
+
+/*
+* @brief Consumer side release. See pm_ring.h.
+*/
+void pm_ring_release(pm_ring_t *ring, size_t count)
+{
+  // Only give the slots back once we are done reading them.
+  STORE_RELEASE(&ring->cons.tail, ring->cons.tail + (uint32_t) count);
+}
+
+
+/*
+* @brief Consumer side batch copy. See pm_ring.h.
+*/
+size_t pm_ring_pop(pm_ring_t *ring, pm_sample_t *out, size_t max)
+{
+  const pm_sample_t *first;
+  size_t total = 0;
+  size_t n;
+
+  // At most two runs: up to the end of the slot array, then from the start.
+  while(total < max && (n = pm_ring_peek(ring, &first)) > 0)
+  {
+    if(n > max - total)
+      n = max - total;
+
+    memcpy(out + total, first, n * sizeof(pm_sample_t));
+    pm_ring_release(ring, n);
+    total += n;
+  }
+
+  return total;
+}
+
+
+/*
+* @brief Drop counter. See pm_ring.h.
+*/
+uint32_t pm_ring_dropped(const pm_ring_t *ring)
+{
+  return __atomic_load_n(&ring->prod.dropped, __ATOMIC_RELAXED);
+}
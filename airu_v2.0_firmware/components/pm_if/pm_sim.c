@@ -0,0 +1,270 @@
+/*
+*	pm_sim.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Model of a PMS sensor for host builds. While its fan runs it sends a
+*   frame a second in active mode, or one frame per PM_CMD_READ in passive
+*   mode; readings ramp up from 0 over 'settle_ms' after each wake up. The
+*   fan runs while the SET and RESET pins are high and no PM_CMD_SLEEP 0 is
+*   in force.
+*   pm_sim_fault() makes it hang, repeat itself or garble its frames until
+*   the fan is next started.
+*/
+#ifndef ESP_PLATFORM
+
+#include <string.h>
+#include "pm_power.h"
+
+#define SIM_FRAME_US  1000000   // Active mode frame interval
+
+
+/* Function prototypes */
+static void update_fan(pm_sim_t *sim);
+static int faulty(const pm_sim_t *sim, pm_sim_fault_t fault);
+static void command(pm_sim_t *sim, uint8_t cmd, uint16_t data);
+
+
+/*
+* @brief Sets up the simulated sensor. See pm_power.h.
+*/
+void pm_sim_init(pm_sim_t *sim, uint16_t pm2_5, uint32_t settle_ms, int64_t now_us)
+{
+  memset(sim, 0, sizeof(*sim));
+  sim->now_us = now_us;
+  sim->pm2_5 = pm2_5;
+  sim->settle_ms = settle_ms;
+  sim->set_pin = 1;
+  sim->reset_pin = 1;
+  update_fan(sim);
+}
+
+
+/*
+* @brief SET pin. See pm_power.h.
+*/
+void pm_sim_set_pin(pm_sim_t *sim, int level)
+{
+  sim->set_pin = (level != 0);
+  update_fan(sim);
+}
+
+
+/*
+* @brief RESET pin. See pm_power.h.
+*/
+void pm_sim_reset_pin(pm_sim_t *sim, int level)
+{
+  sim->reset_pin = (level != 0);
+  if(!sim->reset_pin)
+  {
+    sim->cmd_sleep = 0;
+    sim->passive = 0;
+    sim->rx_fill = 0;
+  }
+  update_fan(sim);
+}
+
+
+/*
+* @brief Receives command bytes. See pm_power.h.
+*/
+void pm_sim_rx(pm_sim_t *sim, const uint8_t *data, size_t len)
+{
+  uint16_t sum;
+  size_t i;
+  int k;
+
+  if(faulty(sim, PM_SIM_HANG))
+    return;
+
+  for(i = 0; i < len; i++)
+  {
+    if(sim->rx_fill == 0 && data[i] != PM_FRAME_START1)
+      continue;
+    if(sim->rx_fill == 1 && data[i] != PM_FRAME_START2)
+    {
+      sim->rx_fill = (data[i] == PM_FRAME_START1);
+      continue;
+    }
+
+    sim->rx[sim->rx_fill++] = data[i];
+    if(sim->rx_fill < PM_CMD_LEN)
+      continue;
+
+    sim->rx_fill = 0;
+    sum = 0;
+    for(k = 0; k < PM_CMD_LEN - 2; k++)
+      sum += sim->rx[k];
+    if(sum == ((uint16_t) sim->rx[5] << 8 | sim->rx[6]))
+      command(sim, sim->rx[2], (uint16_t) sim->rx[3] << 8 | sim->rx[4]);
+  }
+}
+
+
+/*
+* @brief Sends a frame if one is due. See pm_power.h.
+*/
+size_t pm_sim_tx(pm_sim_t *sim, uint8_t *frame)
+{
+  uint16_t values[3];
+  uint16_t sum = 0;
+  int64_t run_us;
+  uint32_t pm2_5;
+  int i;
+
+  if(!sim->running)
+    return 0;
+
+  if(sim->passive)
+  {
+    if(!sim->query)
+      return 0;
+    sim->query = 0;
+  }
+  else
+  {
+    if(sim->now_us < sim->next_us)
+      return 0;
+    sim->next_us += SIM_FRAME_US;
+    if(sim->next_us <= sim->now_us)
+      sim->next_us = sim->now_us + SIM_FRAME_US;
+  }
+
+  if(faulty(sim, PM_SIM_HANG))
+    return 0;
+
+  // Too little air is drawn through until the fan is up to speed.
+  pm2_5 = sim->pm2_5;
+  run_us = sim->now_us - sim->fan_on_us;
+  if(run_us < (int64_t) sim->settle_ms * 1000)
+    pm2_5 = (uint32_t) (pm2_5 * run_us / ((int64_t) sim->settle_ms * 1000));
+
+  values[0] = pm2_5 * 2 / 3;
+  values[1] = pm2_5;
+  values[2] = pm2_5 * 4 / 3 + sim->seq % 3;
+  if(faulty(sim, PM_SIM_STUCK))
+    values[0] = values[1] = values[2] = sim->pm2_5;
+
+  memset(frame, 0, PM_FRAME_LEN);
+  frame[0] = PM_FRAME_START1;
+  frame[1] = PM_FRAME_START2;
+  frame[3] = PM_FRAME_LEN - 4;
+  for(i = 0; i < 3; i++)
+  {
+    // CF=1 and atmospheric readings
+    frame[4 + 2*i] = frame[10 + 2*i] = values[i] >> 8;
+    frame[5 + 2*i] = frame[11 + 2*i] = values[i] & 0xFF;
+  }
+  for(i = 0; i < PM_FRAME_LEN - 2; i++)
+    sum += frame[i];
+  frame[PM_FRAME_LEN - 2] = sum >> 8;
+  frame[PM_FRAME_LEN - 1] = sum & 0xFF;
+  if(faulty(sim, PM_SIM_NOISE))
+    frame[PM_FRAME_LEN - 1] ^= 0x5A;
+
+  sim->seq++;
+  sim->frames++;
+  return PM_FRAME_LEN;
+}
+
+
+/*
+* @brief Next active mode frame. See pm_power.h.
+*/
+int64_t pm_sim_next(const pm_sim_t *sim)
+{
+  if(!sim->running || sim->passive)
+    return PM_POWER_NEVER;
+  return sim->next_us;
+}
+
+
+/*
+* @brief Fan run time. See pm_power.h.
+*/
+uint64_t pm_sim_fan_us(const pm_sim_t *sim)
+{
+  return sim->fan_us + (sim->running ? sim->now_us - sim->fan_on_us : 0);
+}
+
+
+/*
+* @brief Schedules a fault. See pm_power.h.
+*/
+void pm_sim_fault(pm_sim_t *sim, pm_sim_fault_t fault, int64_t fault_us)
+{
+  sim->fault = fault;
+  sim->fault_us = fault_us;
+}
+
+
+/*
+* @brief Starts or stops the fan to match the SET pin and sleep command.
+*        A fan start clears a fault that has started.
+*/
+static void update_fan(pm_sim_t *sim)
+{
+  uint8_t run = sim->set_pin && sim->reset_pin && !sim->cmd_sleep;
+
+  if(run && !sim->running)
+  {
+    sim->running = 1;
+    sim->fan_on_us = sim->now_us;
+    sim->next_us = sim->now_us + SIM_FRAME_US;
+    sim->wakeups++;
+    if(sim->fault != PM_SIM_OK && sim->now_us >= sim->fault_us)
+      sim->fault = PM_SIM_OK;
+  }
+  else if(!run && sim->running)
+  {
+    sim->running = 0;
+    sim->fan_us += sim->now_us - sim->fan_on_us;
+    sim->query = 0;
+  }
+}
+
+
+/*
+* @brief 1 if 'fault' is in force.
+*/
+static int faulty(const pm_sim_t *sim, pm_sim_fault_t fault)
+{
+  return sim->fault == fault && sim->now_us >= sim->fault_us;
+}
+
+
+/*
+* @brief Carries out one valid command.
+*/
+static void command(pm_sim_t *sim, uint8_t cmd, uint16_t data)
+{
+  sim->commands++;
+
+  switch(cmd)
+  {
+    case PM_CMD_READ:
+      if(sim->passive && sim->running)
+        sim->query = 1;
+      break;
+
+    case PM_CMD_MODE:
+      sim->passive = (data == 0);
+      sim->next_us = sim->now_us + SIM_FRAME_US;
+      break;
+
+    case PM_CMD_SLEEP:
+      sim->cmd_sleep = (data == 0);
+      update_fan(sim);
+      break;
+
+    default:
+      break;
+  }
+}
+
+#endif
@@ -0,0 +1,141 @@
+/*
+*	power.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Dynamic frequency scaling and automatic light sleep.
+*
+*   power_init() lets the CPU drop from POWER_MAX_FREQ_MHZ to
+*   POWER_MIN_FREQ_MHZ whenever nothing needs full speed, and enter light
+*   sleep from the idle task when every task is blocked. Subsystems that
+*   need full speed or must not sleep take a power lock only for as long as
+*   they need it:
+*
+*     PM      POWER_NO_SLEEP while a PMS3003 frame is due on the UART
+*     uplink  POWER_CPU_MAX  around each POST (TLS handshake included)
+*     sdlog   POWER_NO_SLEEP around card reads and writes
+*
+*   Every lock keeps its own count of acquisitions and total / longest hold
+*   time, so power_get_stats() shows which subsystem keeps the chip awake.
+*   vTrace_task logs them with power_log_stats() every POWER_LOG_S.
+*
+*   A lock is meant to be taken and released by one task. Nested acquires
+*   from that task are counted once. Without CONFIG_PM_ENABLE the locks only
+*   keep statistics.
+*/
+
+#ifndef _POWER_H
+#define _POWER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+static const char *TAG_POWER = "POWER";
+
+#define POWER_MAX_FREQ_MHZ    160
+#define POWER_MIN_FREQ_MHZ    80    // APB stays at 80 MHz so UART baud rates hold
+#define POWER_LIGHT_SLEEP     1     // 1: idle task may enter light sleep
+#define POWER_MAX_LOCKS       8
+#define POWER_LOG_S           600   // Lock statistics log interval
+
+
+/*
+* @brief What a lock keeps the chip from doing
+*/
+typedef enum
+{
+  POWER_CPU_MAX = 0,        // Dropping the CPU below POWER_MAX_FREQ_MHZ
+  POWER_APB_MAX,            // Dropping the APB clock below 80 MHz, never done at POWER_MIN_FREQ_MHZ 80
+  POWER_NO_SLEEP            // Entering light sleep
+} power_lock_type_t;
+
+/*
+* @brief Lock statistics
+*/
+typedef struct
+{
+  const char *name;
+  power_lock_type_t type;
+  uint32_t acquires;
+  uint64_t held_us;         // Total time held, including a hold in progress
+  uint32_t max_us;          // Longest single hold
+} power_stats_t;
+
+/*
+* @brief Power lock
+*/
+typedef struct
+{
+  void *handle;             // esp_pm_lock_handle_t with CONFIG_PM_ENABLE
+  uint32_t depth;
+  int64_t since_us;         // Time of the outermost acquire
+  power_stats_t stats;
+} power_lock_t;
+
+
+/*
+* @brief Enables frequency scaling and, if POWER_LIGHT_SLEEP, automatic
+*        light sleep.
+*
+* @param
+*
+* @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED without CONFIG_PM_ENABLE
+*/
+esp_err_t power_init();
+
+/*
+* @brief Creates a lock and adds it to the statistics. Call once per lock,
+*        typically from the subsystem's init function.
+*
+* @param lock - lock to create
+* @param type - what the lock prevents
+* @param name - name shown in the statistics
+*
+* @return ESP_OK on success, ESP_ERR_NO_MEM if POWER_MAX_LOCKS already exist
+*/
+esp_err_t power_lock_create(power_lock_t *lock, power_lock_type_t type, const char *name);
+
+/*
+* @brief Takes the lock. Does nothing if the lock was never created.
+*
+* @param lock - lock to take
+*
+* @return void
+*/
+void power_lock_acquire(power_lock_t *lock);
+
+/*
+* @brief Releases the lock and records the hold time.
+*
+* @param lock - lock to release
+*
+* @return void
+*/
+void power_lock_release(power_lock_t *lock);
+
+/*
+* @brief Copies the statistics of every lock.
+*
+* @param stats - output array
+* @param max   - size of the output array
+*
+* @return number of locks copied
+*/
+size_t power_get_stats(power_stats_t *stats, size_t max);
+
+/*
+* @brief Logs the statistics of every lock.
+*
+* @param
+*
+* @return void
+*/
+void power_log_stats();
+
+
+#endif
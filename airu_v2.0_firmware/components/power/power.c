@@ -0,0 +1,216 @@
+/*
+*	power.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "power.h"
+
+#ifdef CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+
+/* Function prototypes */
+esp_err_t power_init();
+esp_err_t power_lock_create(power_lock_t *lock, power_lock_type_t type, const char *name);
+void power_lock_acquire(power_lock_t *lock);
+void power_lock_release(power_lock_t *lock);
+size_t power_get_stats(power_stats_t *stats, size_t max);
+void power_log_stats();
+
+/* Global variables */
+static power_lock_t *power_locks[POWER_MAX_LOCKS];
+static uint32_t power_num_locks;
+static portMUX_TYPE power_mux = portMUX_INITIALIZER_UNLOCKED;
+
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t power_init()
+{
+#ifdef CONFIG_PM_ENABLE
+  esp_err_t err;
+
+  esp_pm_config_esp32_t config =
+  {
+    .max_cpu_freq = (POWER_MAX_FREQ_MHZ == 240) ? RTC_CPU_FREQ_240M : RTC_CPU_FREQ_160M,
+    .min_cpu_freq = RTC_CPU_FREQ_80M,
+#ifdef CONFIG_FREERTOS_USE_TICKLESS_IDLE
+    .light_sleep_enable = POWER_LIGHT_SLEEP
+#endif
+  };
+
+  err = esp_pm_configure(&config);
+  if(err != ESP_OK)
+  {
+    ESP_LOGW(TAG_POWER, "esp_pm_configure failed: %s", esp_err_to_name(err));
+    return err;
+  }
+
+  ESP_LOGI(TAG_POWER, "%d-%d MHz, light sleep %s", POWER_MIN_FREQ_MHZ, POWER_MAX_FREQ_MHZ,
+           config.light_sleep_enable ? "on" : "off");
+  return ESP_OK;
+#else
+  return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t power_lock_create(power_lock_t *lock, power_lock_type_t type, const char *name)
+{
+  esp_err_t err = ESP_OK;
+
+  lock->handle = NULL;
+  lock->depth = 0;
+  lock->since_us = 0;
+  lock->stats.name = name;
+  lock->stats.type = type;
+  lock->stats.acquires = 0;
+  lock->stats.held_us = 0;
+  lock->stats.max_us = 0;
+
+#ifdef CONFIG_PM_ENABLE
+  const esp_pm_lock_type_t types[] = { ESP_PM_CPU_FREQ_MAX, ESP_PM_APB_FREQ_MAX, ESP_PM_NO_LIGHT_SLEEP };
+
+  err = esp_pm_lock_create(types[type], 0, name, (esp_pm_lock_handle_t *) &lock->handle);
+  if(err != ESP_OK)
+    return err;
+#endif
+
+  portENTER_CRITICAL(&power_mux);
+  if(power_num_locks < POWER_MAX_LOCKS)
+    power_locks[power_num_locks++] = lock;
+  else
+    err = ESP_ERR_NO_MEM;
+  portEXIT_CRITICAL(&power_mux);
+
+  return err;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+void power_lock_acquire(power_lock_t *lock)
+{
+  if(lock->stats.name == NULL || lock->depth++ > 0)
+    return;
+
+#ifdef CONFIG_PM_ENABLE
+  if(lock->handle != NULL)
+    esp_pm_lock_acquire((esp_pm_lock_handle_t) lock->handle);
+#endif
+
+  lock->since_us = esp_timer_get_time();
+  lock->stats.acquires++;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+void power_lock_release(power_lock_t *lock)
+{
+  uint32_t held;
+
+  if(lock->stats.name == NULL || lock->depth == 0 || --lock->depth > 0)
+    return;
+
+  held = (uint32_t) (esp_timer_get_time() - lock->since_us);
+
+  // Read by power_get_stats() from other tasks, keep the pair consistent.
+  portENTER_CRITICAL(&power_mux);
+  lock->stats.held_us += held;
+  if(held > lock->stats.max_us)
+    lock->stats.max_us = held;
+  portEXIT_CRITICAL(&power_mux);
+
+#ifdef CONFIG_PM_ENABLE
+  if(lock->handle != NULL)
+    esp_pm_lock_release((esp_pm_lock_handle_t) lock->handle);
+#endif
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+size_t power_get_stats(power_stats_t *stats, size_t max)
+{
+  int64_t now = esp_timer_get_time();
+  size_t n;
+  size_t i;
+
+  portENTER_CRITICAL(&power_mux);
+  n = (power_num_locks < max) ? power_num_locks : max;
+  for(i = 0; i < n; i++)
+  {
+    stats[i] = power_locks[i]->stats;
+    if(power_locks[i]->depth > 0)
+      stats[i].held_us += now - power_locks[i]->since_us;
+  }
+  portEXIT_CRITICAL(&power_mux);
+
+  return n;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+void power_log_stats()
+{
+  power_stats_t stats[POWER_MAX_LOCKS];
+  int64_t uptime = esp_timer_get_time();
+  size_t n;
+  size_t i;
+
+  n = power_get_stats(stats, POWER_MAX_LOCKS);
+  for(i = 0; i < n; i++)
+  {
+    ESP_LOGI(TAG_POWER, "%-8s %u acquires, held %llu ms (%u%%), longest %u ms", stats[i].name,
+             stats[i].acquires, stats[i].held_us / 1000,
+             (unsigned) (uptime > 0 ? stats[i].held_us * 100 / uptime : 0), stats[i].max_us / 1000);
+  }
+}
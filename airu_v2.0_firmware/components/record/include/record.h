@@ -0,0 +1,183 @@
+/*
+*	record.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Binary block format for sensor samples, shared by the SD log, the uplink
+*   and anything else that stores or sends samples.
+*
+*   A block holds records from any mix of streams. Stream numbers below
+*   SENSOR_MAX_DRIVERS are the sensor task's drivers (sensor_sample_t.sensor);
+*   RECORD_STREAM_PM + n carries pm_sample_t (seq, PM1, PM2.5, PM10,
+*   temperature, humidity) of PM channel n, see record_from_pm(). Channel 0
+*   is the stream single-sensor nodes have always written.
+*
+*   Block layout (multi-byte header fields little endian):
+*
+*     [0-1]   'A' 'R'         magic
+*     [2]     version         RECORD_VERSION
+*     [3]     0               reserved
+*     [4-5]   count           records in the block
+*     [6-7]   length          bytes of records
+*     [8-15]  time_us         time of the first record, us since boot
+*     [16-23] utc_off_us      UTC minus time_us, from the first record that
+*                             had a UTC time; 0 if none did
+*     [24-]   records
+*     [-4]    CRC-32          of the records followed by the header
+*
+*   Each record is:
+*
+*     varint  stream << 1 | new, where 'new' is set on the stream's first
+*             record in the block or when its value count changes
+*     zigzag  ms since the previous record (since time_us for the first)
+*     if new:   varint count, then every value as a zigzag varint
+*     else:     every value as a zigzag varint delta from the stream's
+*               previous record
+*
+*   So the schema of every stream is in the block itself: a decoder that
+*   has never seen a stream can still read it, and one record costs a byte
+*   per value that didn't change. The CRC is over the records first so it
+*   can be brought up to date after every record by running it over the
+*   header only; a block is complete and valid after every
+*   record_block_add().
+*
+*   Times are rounded to ms; the encoder tracks the time the decoder will
+*   reconstruct, so rounding errors do not add up over a block.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _RECORD_H
+#define _RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sensor.h"
+#include "pm_ring.h"
+
+#define RECORD_VERSION      1
+#define RECORD_HDR_LEN      24
+#define RECORD_CRC_LEN      4
+#define RECORD_OVERHEAD     (RECORD_HDR_LEN + RECORD_CRC_LEN)
+#define RECORD_STREAM_PM    7     // PM channel 0, fixed: it is in blocks already written
+#define RECORD_PM_CHANNELS  3
+#define RECORD_MAX_STREAMS  (RECORD_STREAM_PM + RECORD_PM_CHANNELS)
+#define RECORD_MAX_VALUES   SENSOR_MAX_VALUES
+#define RECORD_MAX_LEN      (2 + 5 + 1 + 5 * RECORD_MAX_VALUES)   // Worst case encoded record
+#define RECORD_PM_VALUES    6
+
+
+/*
+* @brief Block being built
+*/
+typedef struct
+{
+  uint8_t *buf;
+  uint16_t cap;             // Size of buf
+  uint16_t len;             // Bytes used, header and CRC included
+  uint16_t count;           // Records in the block
+  uint32_t crc;             // Running CRC of the records
+  int64_t time_us;          // Time of the last record as the decoder sees it
+  uint16_t seen;            // Bit per stream that has a record in the block
+  uint8_t counts[RECORD_MAX_STREAMS];
+  int32_t prev[RECORD_MAX_STREAMS][RECORD_MAX_VALUES];
+} record_block_t;
+
+/*
+* @brief Block being read
+*/
+typedef struct
+{
+  const uint8_t *p;
+  const uint8_t *end;
+  uint16_t left;            // Records not read yet
+  int64_t time_us;
+  int64_t utc_off_us;
+  uint16_t seen;
+  uint8_t counts[RECORD_MAX_STREAMS];
+  int32_t prev[RECORD_MAX_STREAMS][RECORD_MAX_VALUES];
+} record_reader_t;
+
+
+/*
+* @brief Starts an empty block.
+*
+* @param block - block state, keeps a pointer to buf
+* @param buf   - where the block is built
+* @param cap   - size of buf, at least RECORD_OVERHEAD + RECORD_MAX_LEN
+*
+* @return void
+*/
+void record_block_init(record_block_t *block, uint8_t *buf, uint16_t cap);
+
+/*
+* @brief Appends a record. The block in buf[0..len) is valid afterwards.
+*
+* @param block  - block to add to
+* @param sample - record to add; sensor is the stream number
+*
+* @return 1 if it was added, 0 if the block is full (or the stream or value
+*         count is out of range)
+*/
+int record_block_add(record_block_t *block, const sensor_sample_t *sample);
+
+/*
+* @brief Checks a block's header and CRC and gets ready to read it.
+*
+* @param reader - reader state
+* @param buf    - block
+* @param len    - bytes available at buf, may be more than the block
+*
+* @return number of records in the block, or -1 if it is not a valid block
+*/
+int record_reader_init(record_reader_t *reader, const uint8_t *buf, size_t len);
+
+/*
+* @brief Reads the next record.
+*
+* @param reader - reader state
+* @param sample - filled in with the record
+*
+* @return 1 if a record was read, 0 at the end of the block, -1 if the
+*         block is malformed
+*/
+int record_reader_next(record_reader_t *reader, sensor_sample_t *sample);
+
+/*
+* @brief Packs a PM sample into a record on its channel's stream.
+*
+* @param pm     - PM sample
+* @param sample - filled in with the record
+*
+* @return void
+*/
+void record_from_pm(const pm_sample_t *pm, sensor_sample_t *sample);
+
+/*
+* @brief Unpacks a PM record from any channel's stream.
+*
+* @param sample - record
+* @param pm     - filled in with the PM sample
+*
+* @return 1 if it was a PM record, 0 otherwise
+*/
+int record_to_pm(const sensor_sample_t *sample, pm_sample_t *pm);
+
+/*
+* @brief CRC-32 (IEEE 802.3). Chains: passing the result of one call as
+*        'crc' continues the CRC over the next buffer.
+*
+* @param crc  - previous CRC, 0 to start
+* @param buf  - data
+* @param len  - length of data
+*
+* @return updated CRC
+*/
+uint32_t record_crc32(uint32_t crc, const void *buf, size_t len);
+
+
+#endif
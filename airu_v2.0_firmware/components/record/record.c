@@ -0,0 +1,380 @@
+/*
+*	record.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "record.h"
+
+#define HDR_MAGIC1    0
+#define HDR_MAGIC2    1
+#define HDR_VERSION   2
+#define HDR_COUNT     4
+#define HDR_LENGTH    6
+#define HDR_TIME      8
+#define HDR_UTC_OFF   16
+
+
+/* Function prototypes */
+static uint8_t *put_varint(uint8_t *p, uint32_t value);
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t *value);
+static uint32_t zigzag(int32_t value);
+static int32_t unzigzag(uint32_t value);
+static void put_le(uint8_t *p, uint64_t value, int bytes);
+static uint64_t get_le(const uint8_t *p, int bytes);
+
+
+/*
+* @brief Starts an empty block. See record.h.
+*/
+void record_block_init(record_block_t *block, uint8_t *buf, uint16_t cap)
+{
+  memset(block, 0, sizeof(*block));
+  block->buf = buf;
+  block->cap = cap;
+  block->len = RECORD_OVERHEAD;
+
+  memset(buf, 0, RECORD_HDR_LEN);
+  buf[HDR_MAGIC1] = 'A';
+  buf[HDR_MAGIC2] = 'R';
+  buf[HDR_VERSION] = RECORD_VERSION;
+  put_le(buf + RECORD_HDR_LEN, record_crc32(0, buf, RECORD_HDR_LEN), RECORD_CRC_LEN);
+}
+
+
+/*
+* @brief Appends a record. See record.h.
+*/
+int record_block_add(record_block_t *block, const sensor_sample_t *sample)
+{
+  uint8_t rec[RECORD_MAX_LEN];
+  uint8_t *p = rec;
+  uint8_t stream = sample->sensor;
+  uint8_t count = sample->count;
+  int32_t *prev;
+  int64_t delta_us;
+  int32_t delta_ms;
+  uint16_t n;
+  uint8_t fresh;
+  uint8_t i;
+
+  if(stream >= RECORD_MAX_STREAMS || count > RECORD_MAX_VALUES || block->count == UINT16_MAX)
+    return 0;
+  prev = block->prev[stream];
+
+  // Round to ms and track the time the decoder will reconstruct.
+  delta_us = (block->count == 0) ? 0 : sample->time_us - block->time_us;
+  delta_ms = (int32_t) ((delta_us >= 0) ? (delta_us + 500) / 1000 : (delta_us - 500) / 1000);
+
+  fresh = !(block->seen & (1u << stream)) || block->counts[stream] != count;
+  p = put_varint(p, (uint32_t) stream << 1 | fresh);
+  p = put_varint(p, zigzag(delta_ms));
+  if(fresh)
+  {
+    p = put_varint(p, count);
+    for(i = 0; i < count; i++)
+      p = put_varint(p, zigzag(sample->values[i]));
+  }
+  else
+  {
+    for(i = 0; i < count; i++)
+      p = put_varint(p, zigzag((int32_t) ((uint32_t) sample->values[i] - (uint32_t) prev[i])));
+  }
+
+  n = p - rec;
+  if(block->len + n > block->cap)
+    return 0;
+
+  memcpy(block->buf + block->len - RECORD_CRC_LEN, rec, n);
+  block->crc = record_crc32(block->crc, rec, n);
+  block->len += n;
+  block->count++;
+
+  if(block->count == 1)
+  {
+    block->time_us = sample->time_us;
+    put_le(block->buf + HDR_TIME, (uint64_t) sample->time_us, 8);
+  }
+  else
+  {
+    block->time_us += (int64_t) delta_ms * 1000;
+  }
+  if(sample->utc_us != 0 && get_le(block->buf + HDR_UTC_OFF, 8) == 0)
+    put_le(block->buf + HDR_UTC_OFF, (uint64_t) (sample->utc_us - sample->time_us), 8);
+
+  block->seen |= 1u << stream;
+  block->counts[stream] = count;
+  memcpy(prev, sample->values, count * sizeof(int32_t));
+
+  put_le(block->buf + HDR_COUNT, block->count, 2);
+  put_le(block->buf + HDR_LENGTH, block->len - RECORD_OVERHEAD, 2);
+  put_le(block->buf + block->len - RECORD_CRC_LEN,
+         record_crc32(block->crc, block->buf, RECORD_HDR_LEN), RECORD_CRC_LEN);
+
+  return 1;
+}
+
+
+/*
+* @brief Checks a block and gets ready to read it. See record.h.
+*/
+int record_reader_init(record_reader_t *reader, const uint8_t *buf, size_t len)
+{
+  size_t length;
+  uint32_t crc;
+
+  if(len < RECORD_OVERHEAD || buf[HDR_MAGIC1] != 'A' || buf[HDR_MAGIC2] != 'R' ||
+     buf[HDR_VERSION] != RECORD_VERSION)
+    return -1;
+
+  length = (size_t) get_le(buf + HDR_LENGTH, 2);
+  if(RECORD_OVERHEAD + length > len)
+    return -1;
+
+  crc = record_crc32(0, buf + RECORD_HDR_LEN, length);
+  crc = record_crc32(crc, buf, RECORD_HDR_LEN);
+  if(crc != (uint32_t) get_le(buf + RECORD_HDR_LEN + length, RECORD_CRC_LEN))
+    return -1;
+
+  memset(reader, 0, sizeof(*reader));
+  reader->p = buf + RECORD_HDR_LEN;
+  reader->end = reader->p + length;
+  reader->left = (uint16_t) get_le(buf + HDR_COUNT, 2);
+  reader->time_us = (int64_t) get_le(buf + HDR_TIME, 8);
+  reader->utc_off_us = (int64_t) get_le(buf + HDR_UTC_OFF, 8);
+
+  return reader->left;
+}
+
+
+/*
+* @brief Reads the next record. See record.h.
+*/
+int record_reader_next(record_reader_t *reader, sensor_sample_t *sample)
+{
+  const uint8_t *p = reader->p;
+  uint32_t tag;
+  uint32_t v;
+  uint8_t stream;
+  uint8_t count;
+  int32_t *prev;
+  uint8_t i;
+
+  if(reader->left == 0)
+    return 0;
+
+  if((p = get_varint(p, reader->end, &tag)) == NULL || (p = get_varint(p, reader->end, &v)) == NULL)
+    return -1;
+
+  stream = (uint8_t) (tag >> 1);
+  if(stream >= RECORD_MAX_STREAMS)
+    return -1;
+  prev = reader->prev[stream];
+  reader->time_us += (int64_t) unzigzag(v) * 1000;
+
+  if(tag & 1)
+  {
+    if((p = get_varint(p, reader->end, &v)) == NULL || v > RECORD_MAX_VALUES)
+      return -1;
+    count = (uint8_t) v;
+    for(i = 0; i < count; i++)
+    {
+      if((p = get_varint(p, reader->end, &v)) == NULL)
+        return -1;
+      prev[i] = unzigzag(v);
+    }
+    reader->seen |= 1u << stream;
+    reader->counts[stream] = count;
+  }
+  else
+  {
+    if(!(reader->seen & (1u << stream)))
+      return -1;
+    count = reader->counts[stream];
+    for(i = 0; i < count; i++)
+    {
+      if((p = get_varint(p, reader->end, &v)) == NULL)
+        return -1;
+      prev[i] = (int32_t) ((uint32_t) prev[i] + (uint32_t) unzigzag(v));
+    }
+  }
+
+  reader->p = p;
+  reader->left--;
+
+  sample->time_us = reader->time_us;
+  sample->utc_us = (reader->utc_off_us != 0) ? reader->time_us + reader->utc_off_us : 0;
+  sample->sensor = stream;
+  sample->count = count;
+  memcpy(sample->values, prev, count * sizeof(int32_t));
+
+  return 1;
+}
+
+
+/*
+* @brief Packs a PM sample. See record.h.
+*/
+void record_from_pm(const pm_sample_t *pm, sensor_sample_t *sample)
+{
+  sample->time_us = pm->time_us;
+  sample->utc_us = pm->utc_us;
+  sample->sensor = RECORD_STREAM_PM + pm->channel;
+  sample->count = RECORD_PM_VALUES;
+  sample->values[0] = (int32_t) pm->seq;
+  sample->values[1] = pm->pm1;
+  sample->values[2] = pm->pm2_5;
+  sample->values[3] = pm->pm10;
+  sample->values[4] = pm->temp;
+  sample->values[5] = pm->hum;
+}
+
+
+/*
+* @brief Unpacks a PM record. See record.h.
+*/
+int record_to_pm(const sensor_sample_t *sample, pm_sample_t *pm)
+{
+  if(sample->sensor < RECORD_STREAM_PM || sample->sensor >= RECORD_STREAM_PM + RECORD_PM_CHANNELS ||
+     sample->count != RECORD_PM_VALUES)
+    return 0;
+
+  pm->time_us = sample->time_us;
+  pm->utc_us = sample->utc_us;
+  pm->channel = sample->sensor - RECORD_STREAM_PM;
+  pm->seq = (uint32_t) sample->values[0];
+  pm->pm1 = (uint16_t) sample->values[1];
+  pm->pm2_5 = (uint16_t) sample->values[2];
+  pm->pm10 = (uint16_t) sample->values[3];
+  pm->temp = (int16_t) sample->values[4];
+  pm->hum = (uint16_t) sample->values[5];
+
+  return 1;
+}
+
+
+/*
+* @brief CRC-32, nibble table version to keep the table small. See record.h.
+*/
+uint32_t record_crc32(uint32_t crc, const void *buf, size_t len)
+{
+  static const uint32_t table[16] =
+  {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  const uint8_t *p = buf;
+
+  crc = ~crc;
+  while(len--)
+  {
+    crc ^= *p++;
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+    crc = (crc >> 4) ^ table[crc & 0x0F];
+  }
+
+  return ~crc;
+}
+
+
+/*
+* @brief Writes an unsigned LEB128 varint.
+*
+* @param p     - where to write, needs up to 5 bytes
+* @param value - value to write
+*
+* @return pointer past the last byte written
+*/
+static uint8_t *put_varint(uint8_t *p, uint32_t value)
+{
+  while(value >= 0x80)
+  {
+    *p++ = (uint8_t) (value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (uint8_t) value;
+
+  return p;
+}
+
+
+/*
+* @brief Reads an unsigned LEB128 varint.
+*
+* @param p     - where to read from
+* @param end   - end of the buffer
+* @param value - decoded value
+*
+* @return pointer past the varint, or NULL if it runs off the end
+*/
+static const uint8_t *get_varint(const uint8_t *p, const uint8_t *end, uint32_t *value)
+{
+  uint32_t result = 0;
+  int shift = 0;
+
+  while(p < end && shift < 35)
+  {
+    result |= (uint32_t) (*p & 0x7F) << shift;
+    if((*p++ & 0x80) == 0)
+    {
+      *value = result;
+      return p;
+    }
+    shift += 7;
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Maps a signed delta to an unsigned one so small negative numbers
+*        also get short varints (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...).
+*/
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+
+/*
+* @brief Inverse of zigzag().
+*/
+static int32_t unzigzag(uint32_t value)
+{
+  return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+
+/*
+* @brief Little endian store.
+*/
+static void put_le(uint8_t *p, uint64_t value, int bytes)
+{
+  int i;
+
+  for(i = 0; i < bytes; i++)
+  {
+    p[i] = (uint8_t) (value >> (8 * i));
+  }
+}
+
+
+/*
+* @brief Little endian load.
+*/
+static uint64_t get_le(const uint8_t *p, int bytes)
+{
+  uint64_t value = 0;
+  int i;
+
+  for(i = bytes - 1; i >= 0; i--)
+  {
+    value = (value << 8) | p[i];
+  }
+
+  return value;
+}
@@ -0,0 +1,218 @@
+/*
+*	sdlog.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Append-only store-and-forward log of PM samples on a raw block device
+*   (the microSD card).
+*
+*   Layout, in 512 byte sectors starting at 'base':
+*
+*     base + 0, base + 1   Checkpoints A and B, written alternately
+*     base + 2 ...         Ring of 'num_sectors' data sectors
+*
+*   Every data sector carries a header with its own sequence number and a
+*   CRC32 and holds one record block (see record.h) of as many
+*   PM records (any channel) as fit. Data sectors are never rewritten except
+*   when the ring wraps, so a power loss can at worst tear the sectors of the
+*   flush that was in progress; those fail their CRC and are ignored.
+*
+*   Appends go to a RAM write-ahead buffer of SDLOG_BLOCK_SECTORS sectors
+*   that is written out in one sector-aligned multi-sector write when it
+*   fills up or on sdlog_flush(). Each flush is followed by a checkpoint that
+*   records the next sector to write and the upload cursor. On mount the
+*   newer valid checkpoint is loaded and any data sectors written after it
+*   are rolled forward.
+*
+*   The upload cursor marks the oldest record not yet acknowledged by the
+*   uplink. sdlog_read() returns records from the cursor using reads of up to
+*   SDLOG_READ_SECTORS sectors at once, and sdlog_ack() moves it forward. If
+*   the ring wraps onto records that were never uploaded, the cursor is
+*   pushed forward and the loss is counted.
+*
+*   The block device is a pair of callbacks, see sdlog_sdmmc.c for the card
+*   and sdlog_file.c for a file-backed device on a host.
+*/
+
+#ifndef _SDLOG_H
+#define _SDLOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "pm_ring.h"
+#include "record.h"
+
+#define SDLOG_SECTOR_SIZE       512
+#define SDLOG_HDR_LEN           16
+#define SDLOG_BLOCK_LEN         (SDLOG_SECTOR_SIZE - SDLOG_HDR_LEN)
+#define SDLOG_RECS_PER_SECTOR   48  // Typical, only used for the pending and lost estimates
+#define SDLOG_BLOCK_SECTORS     8   // Write-ahead buffer size, flushed as one write
+#define SDLOG_READ_SECTORS      8   // Max sectors per read when replaying
+
+
+/*
+* @brief Block device callbacks, all counts and offsets in sectors
+*/
+typedef struct
+{
+  esp_err_t (*read)(void *ctx, uint32_t sector, void *buf, uint32_t count);
+  esp_err_t (*write)(void *ctx, uint32_t sector, const void *buf, uint32_t count);
+  void *ctx;
+} sdlog_bdev_t;
+
+/*
+* @brief Log statistics
+*/
+typedef struct
+{
+  uint32_t records_written;   // Records that reached the card
+  uint32_t sectors_written;
+  uint32_t writes;            // Block device write calls
+  uint32_t reads;             // Block device read calls
+  uint32_t records_lost;      // Unsent records overwritten by the ring wrapping
+  uint32_t bad_sectors;       // Sectors skipped on replay because of a bad CRC
+} sdlog_stats_t;
+
+/*
+* @brief Log state
+*/
+typedef struct
+{
+  sdlog_bdev_t bdev;
+  uint32_t base;              // First sector of the log area
+  uint32_t num_sectors;       // Data sectors in the ring
+
+  uint32_t head_seq;          // Sequence number of the next data sector to write
+  uint32_t ckpt_seq;          // Sequence number of the last checkpoint written
+  uint32_t cursor_seq;        // Upload cursor: data sector...
+  uint16_t cursor_idx;        // ...and record within it
+  uint32_t read_seq;          // Where the cursor moves to on sdlog_ack()
+  uint16_t read_idx;
+
+  uint16_t wfill;             // Records in the write-ahead buffer
+  uint16_t wsector;           // Sector of the write-ahead buffer being filled
+  uint16_t wcount[SDLOG_BLOCK_SECTORS];   // Records in each filled sector
+  record_block_t wblock;      // Block in sector 'wsector'
+  uint8_t wbuf[SDLOG_BLOCK_SECTORS * SDLOG_SECTOR_SIZE];
+  uint8_t rbuf[SDLOG_READ_SECTORS * SDLOG_SECTOR_SIZE];
+
+  sdlog_stats_t stats;
+} sdlog_t;
+
+
+/*
+* @brief Opens the log, recovering its position after a reset or power loss.
+*        An area with no valid checkpoint is treated as an empty log.
+*
+* @param log         - log state
+* @param bdev        - block device
+* @param base        - first sector of the log area
+* @param num_sectors - number of data sectors, must be at least
+*                      SDLOG_BLOCK_SECTORS
+*
+* @return ESP_OK on success, or the block device error
+*/
+esp_err_t sdlog_mount(sdlog_t *log, const sdlog_bdev_t *bdev, uint32_t base, uint32_t num_sectors);
+
+/*
+* @brief Adds a sample to the write-ahead buffer, flushing it if it is full.
+*        A sample that does not fit in the current sector's block closes it
+*        and starts the next sector.
+*
+* @param log    - log state
+* @param sample - sample to append
+*
+* @return ESP_OK on success, or the block device error
+*/
+esp_err_t sdlog_append(sdlog_t *log, const pm_sample_t *sample);
+
+/*
+* @brief Writes out the write-ahead buffer and a checkpoint. A partly filled
+*        last sector is written as is and not appended to later.
+*
+* @param log - log state
+*
+* @return ESP_OK on success, or the block device error
+*/
+esp_err_t sdlog_flush(sdlog_t *log);
+
+/*
+* @brief Reads records starting at the upload cursor without moving it.
+*        Only flushed records are returned.
+*
+* @param log - log state
+* @param out - output array
+* @param max - size of the output array
+*
+* @return number of records read, or -1 on a block device error
+*/
+int sdlog_read(sdlog_t *log, pm_sample_t *out, size_t max);
+
+/*
+* @brief Moves the upload cursor past everything the last sdlog_read()
+*        returned (and any bad sectors it skipped) and saves it in a
+*        checkpoint. Call it once the uplink has delivered those records.
+*
+* @param log - log state
+*
+* @return ESP_OK on success, or the block device error
+*/
+esp_err_t sdlog_ack(sdlog_t *log);
+
+/*
+* @brief Approximate number of flushed records not yet acknowledged.
+*
+* @param log - log state
+*
+* @return record count
+*/
+uint32_t sdlog_pending(const sdlog_t *log);
+
+
+#ifdef ESP_PLATFORM
+
+#define SDLOG_SD_BASE_SECTOR  8192  // Leave the first 4 MB of the card alone
+
+/*
+* @brief Brings up the microSD card on the SDMMC host (slot 1, 1-bit mode:
+*        CLK IO14, CMD IO15, D0 IO2) and mounts a log over the rest of it.
+*        The card is used raw, anything past SDLOG_SD_BASE_SECTOR is
+*        overwritten.
+*
+* @param log - log state
+*
+* @return ESP_OK on success, or the SDMMC driver error
+*/
+esp_err_t sdlog_sdmmc_mount(sdlog_t *log);
+
+#else
+
+/*
+* @brief Opens (creating if needed) a file to act as the block device.
+*
+* @param bdev        - filled in with the file callbacks
+* @param path        - image file
+* @param num_sectors - size to make the image, in sectors
+*
+* @return ESP_OK on success, ESP_FAIL if the file cannot be opened
+*/
+esp_err_t sdlog_file_open(sdlog_bdev_t *bdev, const char *path, uint32_t num_sectors);
+
+/*
+* @brief Closes a file opened with sdlog_file_open().
+*
+* @param bdev - block device
+*
+* @return void
+*/
+void sdlog_file_close(sdlog_bdev_t *bdev);
+
+#endif
+
+
+#endif
@@ -0,0 +1,432 @@
+/*
+*	sdlog.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "sdlog.h"
+
+#define DATA_MAGIC    0x33474C41  // "ALG3", record blocks
+#define CKPT_MAGIC    0x504B4341  // "ACKP"
+
+// Data sector header
+#define HDR_MAGIC     0
+#define HDR_SEQ       4
+#define HDR_COUNT     8
+#define HDR_CRC       12
+
+// Checkpoint sector
+#define CKPT_SEQ      4
+#define CKPT_HEAD     8
+#define CKPT_CURSOR   12
+#define CKPT_IDX      16
+#define CKPT_SECTORS  20
+#define CKPT_CRC      24
+
+#define DATA_START(log)   ((log)->base + 2)
+
+
+/* Function prototypes */
+static esp_err_t write_checkpoint(sdlog_t *log);
+static int read_checkpoint(sdlog_t *log, uint32_t which, uint8_t *buf);
+static int sector_valid(const uint8_t *sector, uint32_t seq);
+static void seal_sector(uint8_t *sector, uint32_t seq, uint16_t count);
+static void put32(uint8_t *p, uint32_t value);
+static uint32_t get32(const uint8_t *p);
+
+
+/*
+* @brief Opens the log and recovers its position. See sdlog.h.
+*/
+esp_err_t sdlog_mount(sdlog_t *log, const sdlog_bdev_t *bdev, uint32_t base, uint32_t num_sectors)
+{
+  uint8_t *buf = log->rbuf;
+  uint32_t seq_a = 0;
+  uint32_t seq_b = 0;
+  int valid_a;
+  int valid_b;
+  uint32_t i;
+  esp_err_t err;
+
+  if(num_sectors < SDLOG_BLOCK_SECTORS)
+    return ESP_ERR_INVALID_ARG;
+
+  memset(log, 0, sizeof(*log));
+  log->bdev = *bdev;
+  log->base = base;
+  log->num_sectors = num_sectors;
+
+  valid_a = read_checkpoint(log, 0, buf);
+  if(valid_a < 0)
+    return ESP_FAIL;
+  if(valid_a)
+    seq_a = get32(buf + CKPT_SEQ);
+
+  valid_b = read_checkpoint(log, 1, buf + SDLOG_SECTOR_SIZE);
+  if(valid_b < 0)
+    return ESP_FAIL;
+  if(valid_b)
+    seq_b = get32(buf + SDLOG_SECTOR_SIZE + CKPT_SEQ);
+
+  if(valid_a || valid_b)
+  {
+    // Take the newer checkpoint.
+    if(valid_b && (!valid_a || (int32_t) (seq_b - seq_a) > 0))
+      buf += SDLOG_SECTOR_SIZE;
+
+    log->ckpt_seq = get32(buf + CKPT_SEQ);
+    log->head_seq = get32(buf + CKPT_HEAD);
+    log->cursor_seq = get32(buf + CKPT_CURSOR);
+    log->cursor_idx = (uint16_t) get32(buf + CKPT_IDX);
+
+    // Roll forward over a flush that made it to the card but whose
+    // checkpoint did not. At most one flush can be in that state.
+    for(i = 0; i < SDLOG_BLOCK_SECTORS; i++)
+    {
+      err = log->bdev.read(log->bdev.ctx, DATA_START(log) + log->head_seq % num_sectors,
+                           log->rbuf, 1);
+      log->stats.reads++;
+      if(err != ESP_OK)
+        return err;
+      if(!sector_valid(log->rbuf, log->head_seq))
+        break;
+      log->head_seq++;
+    }
+  }
+  else
+  {
+    // New log. If an old one left valid sectors behind, start numbering past
+    // anything it could have written so none of them is mistaken for ours.
+    err = log->bdev.read(log->bdev.ctx, DATA_START(log), log->rbuf, 1);
+    log->stats.reads++;
+    if(err != ESP_OK)
+      return err;
+    if(get32(log->rbuf + HDR_MAGIC) == DATA_MAGIC)
+      log->head_seq = get32(log->rbuf + HDR_SEQ) + num_sectors;
+
+    log->cursor_seq = log->head_seq;
+  }
+
+  log->read_seq = log->cursor_seq;
+  log->read_idx = log->cursor_idx;
+  record_block_init(&log->wblock, log->wbuf + SDLOG_HDR_LEN, SDLOG_BLOCK_LEN);
+
+  return write_checkpoint(log);
+}
+
+
+/*
+* @brief Buffers a sample. See sdlog.h.
+*/
+esp_err_t sdlog_append(sdlog_t *log, const pm_sample_t *sample)
+{
+  sensor_sample_t rec;
+  esp_err_t err;
+
+  record_from_pm(sample, &rec);
+  if(!record_block_add(&log->wblock, &rec))
+  {
+    // This sector is full, go on to the next one.
+    log->wcount[log->wsector] = log->wblock.count;
+    log->wsector++;
+    if(log->wsector == SDLOG_BLOCK_SECTORS)
+    {
+      err = sdlog_flush(log);
+      if(err != ESP_OK)
+        return err;
+    }
+    else
+    {
+      record_block_init(&log->wblock, log->wbuf + log->wsector * SDLOG_SECTOR_SIZE + SDLOG_HDR_LEN,
+                        SDLOG_BLOCK_LEN);
+    }
+    record_block_add(&log->wblock, &rec);
+  }
+  log->wfill++;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Writes the write-ahead buffer and a checkpoint. See sdlog.h.
+*/
+esp_err_t sdlog_flush(sdlog_t *log)
+{
+  uint32_t sectors;
+  uint32_t pos;
+  uint32_t first;
+  uint32_t used;
+  uint32_t lost;
+  uint32_t i;
+  esp_err_t err;
+
+  if(log->wfill == 0)
+    return ESP_OK;
+
+  sectors = log->wsector;
+  if(sectors < SDLOG_BLOCK_SECTORS && log->wblock.count > 0)
+    log->wcount[sectors++] = log->wblock.count;
+  for(i = 0; i < sectors; i++)
+  {
+    seal_sector(log->wbuf + i * SDLOG_SECTOR_SIZE, log->head_seq + i, log->wcount[i]);
+  }
+
+  // If this flush laps the upload cursor, the records it overwrites are gone.
+  used = log->head_seq + sectors - log->cursor_seq;
+  if(used > log->num_sectors)
+  {
+    lost = used - log->num_sectors;
+    log->stats.records_lost += lost * SDLOG_RECS_PER_SECTOR - log->cursor_idx;
+    log->cursor_seq += lost;
+    log->cursor_idx = 0;
+    if((int32_t) (log->cursor_seq - log->read_seq) > 0)
+    {
+      log->read_seq = log->cursor_seq;
+      log->read_idx = 0;
+    }
+  }
+
+  // One write, or two if the block wraps around the end of the ring.
+  pos = log->head_seq % log->num_sectors;
+  first = log->num_sectors - pos;
+  if(first > sectors)
+    first = sectors;
+
+  err = log->bdev.write(log->bdev.ctx, DATA_START(log) + pos, log->wbuf, first);
+  log->stats.writes++;
+  if(err == ESP_OK && first < sectors)
+  {
+    err = log->bdev.write(log->bdev.ctx, DATA_START(log), log->wbuf + first * SDLOG_SECTOR_SIZE,
+                          sectors - first);
+    log->stats.writes++;
+  }
+  if(err != ESP_OK)
+    return err;
+
+  log->head_seq += sectors;
+  log->stats.sectors_written += sectors;
+  log->stats.records_written += log->wfill;
+  log->wfill = 0;
+  log->wsector = 0;
+  memset(log->wbuf, 0, sizeof(log->wbuf));
+  record_block_init(&log->wblock, log->wbuf + SDLOG_HDR_LEN, SDLOG_BLOCK_LEN);
+
+  return write_checkpoint(log);
+}
+
+
+/*
+* @brief Reads records from the upload cursor. See sdlog.h.
+*/
+int sdlog_read(sdlog_t *log, pm_sample_t *out, size_t max)
+{
+  uint32_t seq = log->cursor_seq;
+  uint16_t idx = log->cursor_idx;
+  uint32_t pos;
+  uint32_t chunk;
+  uint32_t s;
+  uint16_t count;
+  const uint8_t *sector;
+  record_reader_t reader;
+  sensor_sample_t rec;
+  uint16_t skip;
+  size_t n = 0;
+  esp_err_t err;
+
+  while(n < max && seq != log->head_seq)
+  {
+    pos = seq % log->num_sectors;
+    chunk = log->head_seq - seq;
+    if(chunk > SDLOG_READ_SECTORS)
+      chunk = SDLOG_READ_SECTORS;
+    if(chunk > log->num_sectors - pos)
+      chunk = log->num_sectors - pos;
+
+    err = log->bdev.read(log->bdev.ctx, DATA_START(log) + pos, log->rbuf, chunk);
+    log->stats.reads++;
+    if(err != ESP_OK)
+      return -1;
+
+    for(s = 0; s < chunk && n < max; s++)
+    {
+      sector = log->rbuf + s * SDLOG_SECTOR_SIZE;
+      if(!sector_valid(sector, seq) || record_reader_init(&reader, sector + SDLOG_HDR_LEN, SDLOG_BLOCK_LEN) < 0)
+      {
+        log->stats.bad_sectors++;
+        seq++;
+        idx = 0;
+        continue;
+      }
+
+      // Records are delta coded, so the ones already read are decoded again.
+      count = (uint16_t) get32(sector + HDR_COUNT);
+      for(skip = 0; skip < idx && record_reader_next(&reader, &rec) > 0; skip++)
+        ;
+      while(idx < count && n < max && record_reader_next(&reader, &rec) > 0)
+      {
+        if(record_to_pm(&rec, &out[n]))
+          n++;
+        idx++;
+      }
+      if(idx < count && n < max)
+        idx = count;
+
+      if(idx >= count)
+      {
+        seq++;
+        idx = 0;
+      }
+    }
+  }
+
+  log->read_seq = seq;
+  log->read_idx = idx;
+
+  return (int) n;
+}
+
+
+/*
+* @brief Moves the upload cursor. See sdlog.h.
+*/
+esp_err_t sdlog_ack(sdlog_t *log)
+{
+  if(log->read_seq == log->cursor_seq && log->read_idx == log->cursor_idx)
+    return ESP_OK;
+
+  log->cursor_seq = log->read_seq;
+  log->cursor_idx = log->read_idx;
+
+  return write_checkpoint(log);
+}
+
+
+/*
+* @brief Records waiting for upload. See sdlog.h.
+*/
+uint32_t sdlog_pending(const sdlog_t *log)
+{
+  return (log->head_seq - log->cursor_seq) * SDLOG_RECS_PER_SECTOR - log->cursor_idx;
+}
+
+
+/*
+* @brief Writes the next checkpoint, alternating between the two copies so
+*        a torn write always leaves the previous one intact.
+*
+* @param log - log state
+*
+* @return ESP_OK on success, or the block device error
+*/
+static esp_err_t write_checkpoint(sdlog_t *log)
+{
+  uint8_t buf[SDLOG_SECTOR_SIZE];
+  esp_err_t err;
+
+  log->ckpt_seq++;
+
+  memset(buf, 0, sizeof(buf));
+  put32(buf, CKPT_MAGIC);
+  put32(buf + CKPT_SEQ, log->ckpt_seq);
+  put32(buf + CKPT_HEAD, log->head_seq);
+  put32(buf + CKPT_CURSOR, log->cursor_seq);
+  put32(buf + CKPT_IDX, log->cursor_idx);
+  put32(buf + CKPT_SECTORS, log->num_sectors);
+  put32(buf + CKPT_CRC, record_crc32(0, buf, CKPT_CRC));
+
+  err = log->bdev.write(log->bdev.ctx, log->base + (log->ckpt_seq & 1), buf, 1);
+  log->stats.writes++;
+
+  return err;
+}
+
+
+/*
+* @brief Reads and checks one checkpoint copy.
+*
+* @param log   - log state
+* @param which - 0 for A, 1 for B
+* @param buf   - sector buffer
+*
+* @return 1 if valid, 0 if not, -1 on a block device error
+*/
+static int read_checkpoint(sdlog_t *log, uint32_t which, uint8_t *buf)
+{
+  if(log->bdev.read(log->bdev.ctx, log->base + which, buf, 1) != ESP_OK)
+    return -1;
+  log->stats.reads++;
+
+  return get32(buf) == CKPT_MAGIC &&
+         get32(buf + CKPT_SECTORS) == log->num_sectors &&
+         get32(buf + CKPT_CRC) == record_crc32(0, buf, CKPT_CRC);
+}
+
+
+/*
+* @brief Checks a data sector's magic, sequence number and CRC.
+*
+* @param sector - sector contents
+* @param seq    - expected sequence number
+*
+* @return 1 if valid, 0 otherwise
+*/
+static int sector_valid(const uint8_t *sector, uint32_t seq)
+{
+  uint32_t crc;
+
+  if(get32(sector + HDR_MAGIC) != DATA_MAGIC || get32(sector + HDR_SEQ) != seq)
+    return 0;
+
+  crc = record_crc32(0, sector, HDR_CRC);
+  crc = record_crc32(crc, sector + SDLOG_HDR_LEN, SDLOG_SECTOR_SIZE - SDLOG_HDR_LEN);
+
+  return crc == get32(sector + HDR_CRC);
+}
+
+
+/*
+* @brief Fills in a data sector header.
+*
+* @param sector - sector in the write-ahead buffer
+* @param seq    - sector sequence number
+* @param count  - records in the sector
+*
+* @return void
+*/
+static void seal_sector(uint8_t *sector, uint32_t seq, uint16_t count)
+{
+  uint32_t crc;
+
+  put32(sector + HDR_MAGIC, DATA_MAGIC);
+  put32(sector + HDR_SEQ, seq);
+  put32(sector + HDR_COUNT, count);
+
+  crc = record_crc32(0, sector, HDR_CRC);
+  crc = record_crc32(crc, sector + SDLOG_HDR_LEN, SDLOG_SECTOR_SIZE - SDLOG_HDR_LEN);
+  put32(sector + HDR_CRC, crc);
+}
+
+
+/*
+* @brief Little endian store.
+*/
+static void put32(uint8_t *p, uint32_t value)
+{
+  p[0] = (uint8_t) value;
+  p[1] = (uint8_t) (value >> 8);
+  p[2] = (uint8_t) (value >> 16);
+  p[3] = (uint8_t) (value >> 24);
+}
+
+
+/*
+* @brief Little endian load.
+*/
+static uint32_t get32(const uint8_t *p)
+{
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
@@ -0,0 +1,101 @@
+/*
+*	sdlog_file.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   File-backed block device for running the log on a host. Writes go
+*   straight through to the file so killing the process mid-flush behaves
+*   like pulling power on the card.
+*/
+#ifndef ESP_PLATFORM
+
+#include <stdio.h>
+#include "sdlog.h"
+
+
+/* Function prototypes */
+static esp_err_t file_read(void *ctx, uint32_t sector, void *buf, uint32_t count);
+static esp_err_t file_write(void *ctx, uint32_t sector, const void *buf, uint32_t count);
+
+
+/*
+* @brief Opens the image file. See sdlog.h.
+*/
+esp_err_t sdlog_file_open(sdlog_bdev_t *bdev, const char *path, uint32_t num_sectors)
+{
+  FILE *f;
+  long size;
+
+  f = fopen(path, "r+b");
+  if(f == NULL)
+    f = fopen(path, "w+b");
+  if(f == NULL)
+    return ESP_FAIL;
+
+  // Grow the image to full size, unwritten sectors read back as zeros.
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  if(size < (long) num_sectors * SDLOG_SECTOR_SIZE)
+  {
+    fseek(f, (long) num_sectors * SDLOG_SECTOR_SIZE - 1, SEEK_SET);
+    fputc(0, f);
+    fflush(f);
+  }
+
+  bdev->read = file_read;
+  bdev->write = file_write;
+  bdev->ctx = f;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Closes the image file. See sdlog.h.
+*/
+void sdlog_file_close(sdlog_bdev_t *bdev)
+{
+  if(bdev->ctx != NULL)
+    fclose((FILE *) bdev->ctx);
+  bdev->ctx = NULL;
+}
+
+
+/*
+* @brief Block device read callback.
+*/
+static esp_err_t file_read(void *ctx, uint32_t sector, void *buf, uint32_t count)
+{
+  FILE *f = ctx;
+
+  if(fseek(f, (long) sector * SDLOG_SECTOR_SIZE, SEEK_SET) != 0)
+    return ESP_FAIL;
+  if(fread(buf, SDLOG_SECTOR_SIZE, count, f) != count)
+    return ESP_FAIL;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Block device write callback.
+*/
+static esp_err_t file_write(void *ctx, uint32_t sector, const void *buf, uint32_t count)
+{
+  FILE *f = ctx;
+
+  if(fseek(f, (long) sector * SDLOG_SECTOR_SIZE, SEEK_SET) != 0)
+    return ESP_FAIL;
+  if(fwrite(buf, SDLOG_SECTOR_SIZE, count, f) != count)
+    return ESP_FAIL;
+  if(fflush(f) != 0)
+    return ESP_FAIL;
+
+  return ESP_OK;
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+*	sdlog_sdmmc.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   microSD block device for the log, using the SDMMC host directly so the
+*   log gets raw multi-sector reads and writes with no filesystem in between.
+*/
+#ifdef ESP_PLATFORM
+
+#include "driver/gpio.h"
+#include "driver/sdmmc_host.h"
+#include "sdmmc_cmd.h"
+#include "esp_log.h"
+#include "sdlog.h"
+#include "power.h"
+
+static const char *TAG_SDLOG = "SDLOG";
+
+#define SD_CMD_PIN  15
+#define SD_D0_PIN   2
+
+
+/* Function prototypes */
+static esp_err_t card_read(void *ctx, uint32_t sector, void *buf, uint32_t count);
+static esp_err_t card_write(void *ctx, uint32_t sector, const void *buf, uint32_t count);
+
+static sdmmc_card_t sd_card;
+static power_lock_t sd_lock;
+
+
+/*
+* @brief Initialises the card and mounts the log. See sdlog.h.
+*/
+esp_err_t sdlog_sdmmc_mount(sdlog_t *log)
+{
+  sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+  sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+  sdlog_bdev_t bdev;
+  esp_err_t err;
+
+  // 1-bit mode keeps GPIO12 (a strapping pin) out of it.
+  slot_config.width = 1;
+  host.flags = SDMMC_HOST_FLAG_1BIT;
+  gpio_set_pull_mode(SD_CMD_PIN, GPIO_PULLUP_ONLY);
+  gpio_set_pull_mode(SD_D0_PIN, GPIO_PULLUP_ONLY);
+
+  err = sdmmc_host_init();
+  if(err != ESP_OK)
+    return err;
+
+  err = sdmmc_host_init_slot(host.slot, &slot_config);
+  if(err == ESP_OK)
+    err = sdmmc_card_init(&host, &sd_card);
+  if(err != ESP_OK)
+  {
+    ESP_LOGW(TAG_SDLOG, "no SD card: %s", esp_err_to_name(err));
+    sdmmc_host_deinit();
+    return err;
+  }
+
+  if(sd_card.csd.capacity <= SDLOG_SD_BASE_SECTOR + SDLOG_BLOCK_SECTORS + 2)
+  {
+    ESP_LOGW(TAG_SDLOG, "SD card too small: %d sectors", sd_card.csd.capacity);
+    sdmmc_host_deinit();
+    return ESP_ERR_INVALID_SIZE;
+  }
+
+  // The task blocks on each transfer, and light sleep would gate the SDMMC
+  // clock under it. APB never drops below 80 MHz, so only sleep matters.
+  power_lock_create(&sd_lock, POWER_NO_SLEEP, "sdlog");
+
+  bdev.read = card_read;
+  bdev.write = card_write;
+  bdev.ctx = &sd_card;
+
+  ESP_LOGI(TAG_SDLOG, "card %s, %d sectors", sd_card.cid.name, sd_card.csd.capacity);
+
+  return sdlog_mount(log, &bdev, SDLOG_SD_BASE_SECTOR,
+                     sd_card.csd.capacity - SDLOG_SD_BASE_SECTOR - 2);
+}
+
+
+/*
+* @brief Block device read callback.
+*/
+static esp_err_t card_read(void *ctx, uint32_t sector, void *buf, uint32_t count)
+{
+  esp_err_t err;
+
+  power_lock_acquire(&sd_lock);
+  err = sdmmc_read_sectors((sdmmc_card_t *) ctx, buf, sector, count);
+  power_lock_release(&sd_lock);
+
+  return err;
+}
+
+
+/*
+* @brief Block device write callback.
+*/
+static esp_err_t card_write(void *ctx, uint32_t sector, const void *buf, uint32_t count)
+{
+  esp_err_t err;
+
+  power_lock_acquire(&sd_lock);
+  err = sdmmc_write_sectors((sdmmc_card_t *) ctx, buf, sector, count);
+  power_lock_release(&sd_lock);
+
+  return err;
+}
+
+#endif
@@ -0,0 +1,256 @@
+/*
+*	sensor.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Pluggable sensor drivers serviced by one scheduler task.
+*
+*   Each sensor registers a sensor_driver_t: init/poll/decode callbacks, a
+*   poll period and a schema describing the values in its samples. Instead
+*   of one FreeRTOS task per sensor, vSensor_task blocks on a queue set of
+*   every driver's event queue (e.g. a UART driver's event queue) with a
+*   timeout set to the next driver that is due, and polls drivers when they
+*   are due or when their queue has an event.
+*
+*   A poll does the driver's I/O and may ask to be polled again after a
+*   given delay, so a driver can start a conversion and come back for the
+*   result without blocking the task. After every poll the scheduler calls
+*   decode until it runs dry and hands each sample to the registered sinks.
+*
+*   The scheduler core (sensor_sched.c) takes times as arguments and has no
+*   ESP-IDF dependencies so it can be run on a host with mock drivers (see
+*   sensor_mock.c). sensor_task.c runs it on the node.
+*/
+
+#ifndef _SENSOR_H
+#define _SENSOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define SENSOR_MAX_DRIVERS  6
+#define SENSOR_MAX_VALUES   8     // Values per sample
+#define SENSOR_MAX_SINKS    4
+#define SENSOR_NEXT_PERIOD  0     // poll() return: keep the regular schedule
+#define SENSOR_NEVER        INT64_MAX
+#define SENSOR_TASK_STACK   3072
+#define SENSOR_TASK_PRIO    12
+
+
+/*
+* @brief One value in a sample. The physical value is raw / scale.
+*/
+typedef struct
+{
+  const char *name;
+  const char *unit;
+  uint32_t scale;
+} sensor_field_t;
+
+/*
+* @brief Values a driver's samples carry, in order
+*/
+typedef struct
+{
+  uint8_t count;
+  const sensor_field_t *fields;
+} sensor_schema_t;
+
+/*
+* @brief A decoded sample from any sensor
+*/
+typedef struct
+{
+  int64_t time_us;          // When the sample was taken, us since boot
+  int64_t utc_us;           // The same time in UTC (us since 1970), 0 if not synced
+  uint8_t sensor;           // Index the driver was registered under
+  uint8_t count;            // Values used, from the driver's schema
+  int32_t values[SENSOR_MAX_VALUES];
+} sensor_sample_t;
+
+/*
+* @brief Driver callbacks
+*
+* init   - sets the sensor up. May set *events to a FreeRTOS queue the
+*          scheduler should wait on; the driver reads one item from it in
+*          every poll with event set.
+* poll   - does the driver's I/O. 'event' is 1 when the poll was caused by
+*          an item on its event queue. Returns the number of ms until it
+*          wants to be polled again, or SENSOR_NEXT_PERIOD.
+* decode - copies the next finished sample out, returns 0 when there is none.
+*/
+typedef struct
+{
+  const char *name;
+  const sensor_schema_t *schema;
+  uint32_t period_ms;       // Time between polls, 0 to poll only on events
+  esp_err_t (*init)(void *ctx, void **events);
+  uint32_t (*poll)(void *ctx, int64_t now_us, int event);
+  int (*decode)(void *ctx, sensor_sample_t *sample);
+  void *ctx;
+} sensor_driver_t;
+
+/*
+* @brief Per driver statistics
+*/
+typedef struct
+{
+  uint32_t polls;           // All polls...
+  uint32_t events;          // ...of which were caused by an event
+  uint32_t samples;
+} sensor_driver_stats_t;
+
+/*
+* @brief Scheduler statistics. wakeups / samples is the number of task
+*        wakeups (and so context switches) per sample.
+*/
+typedef struct
+{
+  uint32_t wakeups;
+  uint32_t samples;
+  uint32_t busy_us;         // Time spent in driver callbacks and sinks
+  sensor_driver_stats_t drivers[SENSOR_MAX_DRIVERS];
+} sensor_stats_t;
+
+typedef void (*sensor_sink_t)(const sensor_sample_t *sample, void *arg);
+
+/*
+* @brief Scheduler state
+*/
+typedef struct
+{
+  const sensor_driver_t *drivers[SENSOR_MAX_DRIVERS];
+  void *events[SENSOR_MAX_DRIVERS];
+  int64_t next_us[SENSOR_MAX_DRIVERS];   // Next poll
+  int64_t grid_us[SENSOR_MAX_DRIVERS];   // Next regular poll, for periodic drivers
+  uint8_t count;
+  sensor_sink_t sinks[SENSOR_MAX_SINKS];
+  void *sink_args[SENSOR_MAX_SINKS];
+  uint8_t num_sinks;
+  int64_t (*utc)(int64_t time_us);       // Fills in utc_us if set
+  sensor_stats_t stats;
+} sensor_sched_t;
+
+
+/*
+* @brief Empties the scheduler.
+*
+* @param sched - scheduler
+*
+* @return void
+*/
+void sensor_sched_init(sensor_sched_t *sched);
+
+/*
+* @brief Initialises a driver and adds it to the scheduler. Periodic drivers
+*        are first polled right away.
+*
+* @param sched  - scheduler
+* @param driver - driver, must stay valid
+* @param now_us - current time
+*
+* @return ESP_OK, ESP_ERR_NO_MEM if SENSOR_MAX_DRIVERS are registered, or
+*         the error from the driver's init
+*/
+esp_err_t sensor_sched_add(sensor_sched_t *sched, const sensor_driver_t *driver, int64_t now_us);
+
+/*
+* @brief Adds a function every sample is passed to.
+*
+* @param sched - scheduler
+* @param sink  - sink function, called from the scheduler
+* @param arg   - passed to the sink
+*
+* @return ESP_OK, ESP_ERR_NO_MEM if SENSOR_MAX_SINKS are registered
+*/
+esp_err_t sensor_sched_add_sink(sensor_sched_t *sched, sensor_sink_t sink, void *arg);
+
+/*
+* @brief Polls every driver that is due.
+*
+* @param sched  - scheduler
+* @param now_us - current time
+*
+* @return time the next driver is due, SENSOR_NEVER if none is
+*/
+int64_t sensor_sched_run(sensor_sched_t *sched, int64_t now_us);
+
+/*
+* @brief Polls a driver because its event queue has an item.
+*
+* @param sched  - scheduler
+* @param sensor - driver index
+* @param now_us - current time
+*
+* @return void
+*/
+void sensor_sched_event(sensor_sched_t *sched, uint8_t sensor, int64_t now_us);
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Registers a driver with the scheduler task. Must be called before
+*        sensor_start().
+*
+* @param driver - driver, must stay valid
+*
+* @return ESP_OK, ESP_ERR_INVALID_STATE once the task has started, or the
+*         error from sensor_sched_add()
+*/
+esp_err_t sensor_register(const sensor_driver_t *driver);
+
+/*
+* @brief Adds a sink to the scheduler task. Must be called before
+*        sensor_start().
+*
+* @param sink - sink function, called from vSensor_task
+* @param arg  - passed to the sink
+*
+* @return ESP_OK on success
+*/
+esp_err_t sensor_add_sink(sensor_sink_t sink, void *arg);
+
+/*
+* @brief Starts vSensor_task. Does nothing if it is already running.
+*
+* @param
+*
+* @return ESP_OK on success
+*/
+esp_err_t sensor_start();
+
+/*
+* @brief Copies the scheduler statistics.
+*
+* @param stats - where to store them
+*
+* @return ESP_OK
+*/
+esp_err_t sensor_get_stats(sensor_stats_t *stats);
+
+#else
+
+/*
+* @brief Sets up a mock driver that produces a ramp of 'count' values.
+*        With conv_ms > 0 each poll starts a conversion and the value is
+*        collected conv_ms later, like a real I2C sensor.
+*
+* @param driver    - driver to fill in
+* @param name      - driver name
+* @param period_ms - poll period
+* @param conv_ms   - conversion time, 0 for none
+*
+* @return void
+*/
+void sensor_mock_init(sensor_driver_t *driver, const char *name, uint32_t period_ms, uint32_t conv_ms);
+
+#endif
+
+
+#endif
@@ -0,0 +1,63 @@
+/*
+*	sensor_i2c.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The I2C bus shared by the sensors on it (HDC1080, and the ADS1015 on
+*   the wADC board behind a level shifter). The read and write functions
+*   match the bus callbacks the drivers take.
+*/
+
+#ifndef _SENSOR_I2C_H
+#define _SENSOR_I2C_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define SENSOR_I2C_PORT     I2C_NUM_0
+#define SENSOR_I2C_SDA_PIN  26
+#define SENSOR_I2C_SCL_PIN  27
+#define SENSOR_I2C_FREQ_HZ  400000
+#define SENSOR_I2C_WAIT_MS  10
+
+
+/*
+* @brief Sets up the I2C master. Safe to call more than once.
+*
+* @param
+*
+* @return ESP_OK on success
+*/
+esp_err_t sensor_i2c_init();
+
+/*
+* @brief Write transaction.
+*
+* @param ctx  - unused
+* @param addr - 7 bit device address
+* @param data - bytes to write
+* @param len  - number of bytes
+*
+* @return ESP_OK, or ESP_FAIL if the device NACKed
+*/
+esp_err_t sensor_i2c_write(void *ctx, uint8_t addr, const uint8_t *data, size_t len);
+
+/*
+* @brief Read transaction.
+*
+* @param ctx  - unused
+* @param addr - 7 bit device address
+* @param data - where to store the bytes
+* @param len  - number of bytes, at least 1
+*
+* @return ESP_OK, or ESP_FAIL if the device NACKed
+*/
+esp_err_t sensor_i2c_read(void *ctx, uint8_t addr, uint8_t *data, size_t len);
+
+
+#endif
@@ -0,0 +1,105 @@
+/*
+*	sensor_i2c.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifdef ESP_PLATFORM
+
+#include "driver/i2c.h"
+#include "sensor_i2c.h"
+
+
+/* Global variables */
+static int sensor_i2c_ready;
+
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_i2c_init()
+{
+  esp_err_t err;
+
+  if(sensor_i2c_ready)
+    return ESP_OK;
+
+  i2c_config_t config =
+  {
+    .mode = I2C_MODE_MASTER,
+    .sda_io_num = SENSOR_I2C_SDA_PIN,
+    .sda_pullup_en = GPIO_PULLUP_ENABLE,
+    .scl_io_num = SENSOR_I2C_SCL_PIN,
+    .scl_pullup_en = GPIO_PULLUP_ENABLE,
+    .master.clk_speed = SENSOR_I2C_FREQ_HZ
+  };
+
+  err = i2c_param_config(SENSOR_I2C_PORT, &config);
+  if(err == ESP_OK)
+    err = i2c_driver_install(SENSOR_I2C_PORT, I2C_MODE_MASTER, 0, 0, 0);
+  if(err == ESP_OK)
+    sensor_i2c_ready = 1;
+
+  return err;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_i2c_write(void *ctx, uint8_t addr, const uint8_t *data, size_t len)
+{
+  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+  esp_err_t err;
+
+  i2c_master_start(cmd);
+  i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
+  i2c_master_write(cmd, (uint8_t *) data, len, true);
+  i2c_master_stop(cmd);
+  err = i2c_master_cmd_begin(SENSOR_I2C_PORT, cmd, SENSOR_I2C_WAIT_MS / portTICK_PERIOD_MS);
+  i2c_cmd_link_delete(cmd);
+
+  return err;
+}
+
+
+/*
+* @brief A NACK on the address byte comes back as ESP_FAIL, which is how
+*        some sensors say they are still converting.
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_i2c_read(void *ctx, uint8_t addr, uint8_t *data, size_t len)
+{
+  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+  esp_err_t err;
+
+  i2c_master_start(cmd);
+  i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_READ, true);
+  if(len > 1)
+    i2c_master_read(cmd, data, len - 1, I2C_MASTER_ACK);
+  i2c_master_read_byte(cmd, data + len - 1, I2C_MASTER_NACK);
+  i2c_master_stop(cmd);
+  err = i2c_master_cmd_begin(SENSOR_I2C_PORT, cmd, SENSOR_I2C_WAIT_MS / portTICK_PERIOD_MS);
+  i2c_cmd_link_delete(cmd);
+
+  return err;
+}
+
+#endif
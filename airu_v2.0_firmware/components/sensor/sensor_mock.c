@@ -0,0 +1,108 @@
+/*
+*	sensor_mock.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Mock driver for host builds of the scheduler. Each sample is a ramp:
+*   value i of sample n is n * (i + 1).
+*/
+#ifndef ESP_PLATFORM
+
+#include "sensor.h"
+
+#define MOCK_VALUES 2
+
+
+/* Function prototypes */
+static uint32_t mock_poll(void *ctx, int64_t now_us, int event);
+static int mock_decode(void *ctx, sensor_sample_t *sample);
+
+typedef struct
+{
+  uint32_t conv_ms;
+  uint32_t n;
+  uint8_t converting;       // A conversion is in progress
+  uint8_t ready;            // A finished sample is waiting...
+  int64_t ready_us;         // ...taken at this time
+} mock_t;
+
+static const sensor_field_t mock_fields[MOCK_VALUES] =
+{
+  { "a", "", 1 },
+  { "b", "", 1 }
+};
+static const sensor_schema_t mock_schema = { MOCK_VALUES, mock_fields };
+static mock_t mocks[SENSOR_MAX_DRIVERS];
+static uint32_t num_mocks;
+
+
+/*
+* @brief Sets up a mock driver. See sensor.h.
+*/
+void sensor_mock_init(sensor_driver_t *driver, const char *name, uint32_t period_ms, uint32_t conv_ms)
+{
+  mock_t *mock = &mocks[num_mocks++ % SENSOR_MAX_DRIVERS];
+
+  mock->conv_ms = conv_ms;
+  mock->n = 0;
+  mock->converting = 0;
+  mock->ready = 0;
+
+  driver->name = name;
+  driver->schema = &mock_schema;
+  driver->period_ms = period_ms;
+  driver->init = NULL;
+  driver->poll = mock_poll;
+  driver->decode = mock_decode;
+  driver->ctx = mock;
+}
+
+
+/*
+* @brief Starts a conversion, or collects the one that was started.
+*/
+static uint32_t mock_poll(void *ctx, int64_t now_us, int event)
+{
+  mock_t *mock = (mock_t *) ctx;
+
+  if(mock->conv_ms > 0 && !mock->converting)
+  {
+    mock->converting = 1;
+    return mock->conv_ms;
+  }
+
+  mock->converting = 0;
+  mock->ready = 1;
+  mock->ready_us = now_us;
+  return SENSOR_NEXT_PERIOD;
+}
+
+
+/*
+* @brief Hands out the finished sample.
+*/
+static int mock_decode(void *ctx, sensor_sample_t *sample)
+{
+  mock_t *mock = (mock_t *) ctx;
+  int i;
+
+  if(!mock->ready)
+    return 0;
+
+  mock->n++;
+  sample->time_us = mock->ready_us;
+  sample->count = MOCK_VALUES;
+  for(i = 0; i < MOCK_VALUES; i++)
+  {
+    sample->values[i] = mock->n * (i + 1);
+  }
+  mock->ready = 0;
+
+  return 1;
+}
+
+#endif
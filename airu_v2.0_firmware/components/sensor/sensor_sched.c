@@ -0,0 +1,157 @@
+/*
+*	sensor_sched.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "sensor.h"
+
+
+/* Function prototypes */
+static void poll_driver(sensor_sched_t *sched, uint8_t sensor, int64_t now_us, int event);
+
+
+/*
+* @brief Empties the scheduler. See sensor.h.
+*/
+void sensor_sched_init(sensor_sched_t *sched)
+{
+  memset(sched, 0, sizeof(*sched));
+}
+
+
+/*
+* @brief Adds a driver. See sensor.h.
+*/
+esp_err_t sensor_sched_add(sensor_sched_t *sched, const sensor_driver_t *driver, int64_t now_us)
+{
+  uint8_t n = sched->count;
+  esp_err_t err;
+
+  if(n >= SENSOR_MAX_DRIVERS)
+    return ESP_ERR_NO_MEM;
+
+  sched->events[n] = NULL;
+  if(driver->init != NULL)
+  {
+    err = driver->init(driver->ctx, &sched->events[n]);
+    if(err != ESP_OK)
+      return err;
+  }
+
+  sched->drivers[n] = driver;
+  sched->next_us[n] = (driver->period_ms > 0) ? now_us : SENSOR_NEVER;
+  sched->grid_us[n] = now_us;
+  sched->count++;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Adds a sink. See sensor.h.
+*/
+esp_err_t sensor_sched_add_sink(sensor_sched_t *sched, sensor_sink_t sink, void *arg)
+{
+  if(sched->num_sinks >= SENSOR_MAX_SINKS)
+    return ESP_ERR_NO_MEM;
+
+  sched->sinks[sched->num_sinks] = sink;
+  sched->sink_args[sched->num_sinks] = arg;
+  sched->num_sinks++;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Polls the drivers that are due. See sensor.h.
+*/
+int64_t sensor_sched_run(sensor_sched_t *sched, int64_t now_us)
+{
+  int64_t next = SENSOR_NEVER;
+  uint8_t i;
+
+  for(i = 0; i < sched->count; i++)
+  {
+    if(sched->next_us[i] <= now_us)
+      poll_driver(sched, i, now_us, 0);
+    if(sched->next_us[i] < next)
+      next = sched->next_us[i];
+  }
+
+  return next;
+}
+
+
+/*
+* @brief Polls a driver for an event. See sensor.h.
+*/
+void sensor_sched_event(sensor_sched_t *sched, uint8_t sensor, int64_t now_us)
+{
+  if(sensor < sched->count)
+    poll_driver(sched, sensor, now_us, 1);
+}
+
+
+/*
+* @brief Polls one driver, passes its samples to the sinks and works out
+*        when it is due next.
+*
+* @param sched  - scheduler
+* @param sensor - driver index
+* @param now_us - current time
+* @param event  - 1 if the poll was caused by an event
+*
+* @return void
+*/
+static void poll_driver(sensor_sched_t *sched, uint8_t sensor, int64_t now_us, int event)
+{
+  const sensor_driver_t *driver = sched->drivers[sensor];
+  sensor_driver_stats_t *stats = &sched->stats.drivers[sensor];
+  sensor_sample_t sample;
+  int64_t period_us = (int64_t) driver->period_ms * 1000;
+  uint32_t delay_ms;
+  uint8_t i;
+
+  stats->polls++;
+  if(event)
+    stats->events++;
+
+  delay_ms = driver->poll(driver->ctx, now_us, event);
+
+  if(delay_ms != SENSOR_NEXT_PERIOD)
+  {
+    sched->next_us[sensor] = now_us + (int64_t) delay_ms * 1000;
+  }
+  else if(period_us == 0)
+  {
+    sched->next_us[sensor] = SENSOR_NEVER;
+  }
+  else
+  {
+    // Stay on the period grid however long conversions take, but skip
+    // slots that have already gone by.
+    while(sched->grid_us[sensor] <= now_us)
+      sched->grid_us[sensor] += period_us;
+    sched->next_us[sensor] = sched->grid_us[sensor];
+  }
+
+  if(driver->decode == NULL)
+    return;
+
+  while(driver->decode(driver->ctx, &sample))
+  {
+    sample.sensor = sensor;
+    sample.utc_us = (sched->utc != NULL) ? sched->utc(sample.time_us) : 0;
+    stats->samples++;
+    sched->stats.samples++;
+    for(i = 0; i < sched->num_sinks; i++)
+    {
+      sched->sinks[i](&sample, sched->sink_args[i]);
+    }
+  }
+}
@@ -0,0 +1,207 @@
+/*
+*	sensor_task.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Runs the sensor scheduler on the node: one task that waits on a queue
+*   set of the drivers' event queues until the next driver is due.
+*/
+#ifdef ESP_PLATFORM
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "sensor.h"
+#include "timesync.h"
+
+static const char *TAG_SENSOR = "SENSOR";
+
+#define SENSOR_SET_LEN  20    // Items per event queue the queue set can hold
+
+
+/* Function prototypes */
+esp_err_t sensor_register(const sensor_driver_t *driver);
+esp_err_t sensor_add_sink(sensor_sink_t sink, void *arg);
+esp_err_t sensor_start();
+esp_err_t sensor_get_stats(sensor_stats_t *stats);
+static void vSensor_task(void *pvParameters);
+
+/* Global variables */
+static sensor_sched_t sensor_sched;
+static QueueSetHandle_t sensor_set;
+static TaskHandle_t sensor_task;
+static int sensor_ready;
+
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_register(const sensor_driver_t *driver)
+{
+  if(sensor_task != NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  if(!sensor_ready)
+  {
+    sensor_sched_init(&sensor_sched);
+    sensor_ready = 1;
+  }
+
+  return sensor_sched_add(&sensor_sched, driver, esp_timer_get_time());
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_add_sink(sensor_sink_t sink, void *arg)
+{
+  if(sensor_task != NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  if(!sensor_ready)
+  {
+    sensor_sched_init(&sensor_sched);
+    sensor_ready = 1;
+  }
+
+  return sensor_sched_add_sink(&sensor_sched, sink, arg);
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_start()
+{
+  uint8_t i;
+
+  if(sensor_task != NULL)
+    return ESP_OK;
+
+  if(!sensor_ready)
+  {
+    sensor_sched_init(&sensor_sched);
+    sensor_ready = 1;
+  }
+  sensor_sched.utc = timesync_utc;
+
+  sensor_set = xQueueCreateSet(SENSOR_SET_LEN * SENSOR_MAX_DRIVERS);
+  if(sensor_set == NULL)
+    return ESP_ERR_NO_MEM;
+
+  // Only an empty queue can join a set. A sensor that streams from power on
+  // has queued events by now; they are stale, and for a UART the bytes they
+  // announced are still buffered for the next one.
+  for(i = 0; i < sensor_sched.count; i++)
+  {
+    if(sensor_sched.events[i] == NULL)
+      continue;
+    if(xQueueAddToSet((QueueHandle_t) sensor_sched.events[i], sensor_set) != pdPASS)
+    {
+      xQueueReset((QueueHandle_t) sensor_sched.events[i]);
+      xQueueAddToSet((QueueHandle_t) sensor_sched.events[i], sensor_set);
+    }
+  }
+
+  if(xTaskCreate(vSensor_task, "vSensor_task", SENSOR_TASK_STACK, NULL, SENSOR_TASK_PRIO,
+                 &sensor_task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  ESP_LOGI(TAG_SENSOR, "%u drivers on one task", sensor_sched.count);
+  return ESP_OK;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t sensor_get_stats(sensor_stats_t *stats)
+{
+  *stats = sensor_sched.stats;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Polls drivers when they are due or when one of their event queues
+*        has an item.
+*
+* @param
+*
+* @return
+*
+*/
+static void vSensor_task(void *pvParameters)
+{
+  QueueSetMemberHandle_t member;
+  TickType_t wait;
+  int64_t next;
+  int64_t now;
+  int64_t start;
+  uint8_t i;
+
+  next = sensor_sched_run(&sensor_sched, esp_timer_get_time());
+
+  for(;;)
+  {
+    now = esp_timer_get_time();
+    if(next == SENSOR_NEVER)
+      wait = portMAX_DELAY;
+    else if(next <= now)
+      wait = 0;
+    else
+      wait = (TickType_t) ((next - now + portTICK_PERIOD_MS * 1000 - 1) / (portTICK_PERIOD_MS * 1000));
+
+    member = xQueueSelectFromSet(sensor_set, wait);
+    sensor_sched.stats.wakeups++;
+
+    start = esp_timer_get_time();
+    if(member != NULL)
+    {
+      for(i = 0; i < sensor_sched.count; i++)
+      {
+        if(sensor_sched.events[i] == member)
+        {
+          sensor_sched_event(&sensor_sched, i, start);
+          break;
+        }
+      }
+    }
+
+    next = sensor_sched_run(&sensor_sched, esp_timer_get_time());
+    sensor_sched.stats.busy_us += (uint32_t) (esp_timer_get_time() - start);
+  }
+
+  vTaskDelete(NULL);
+}
+
+#endif
@@ -0,0 +1,115 @@
+/*
+*	settings.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Node settings in NVS, see settings_store.h for what they are and how
+*   they are encoded.
+*
+*   settings_init() reads both slots once at boot and keeps the newest
+*   valid one in RAM, or the compiled in defaults if there is none.
+*   settings_get() copies that RAM copy under a sequence lock, so any task
+*   can read the settings as often as it likes without touching flash or
+*   blocking. settings_commit() checks new settings, writes them to the
+*   older slot with the next commit number and only then makes them the
+*   RAM copy; a commit that fails or is cut short by a power loss leaves
+*   the previous settings in force, in RAM and at the next boot.
+*
+*   Most settings are read by app_main() at boot, so a commit takes effect
+*   at the next start. The WiFi credentials are read at every connect.
+*/
+
+#ifndef _SETTINGS_H
+#define _SETTINGS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "settings_store.h"
+
+static const char *TAG_SETTINGS = "SETTINGS";
+
+#define SETTINGS_NAMESPACE      "airu"
+#define SETTINGS_SLOTS          2
+
+#define SETTINGS_DEFAULT_SSID       "airu"
+#define SETTINGS_DEFAULT_PASSWORD   "cleantheair"
+
+
+/*
+* @brief Where the settings in force came from
+*/
+typedef enum
+{
+  SETTINGS_FROM_DEFAULTS = 0,   // Nothing valid stored, or NVS unusable
+  SETTINGS_FROM_NVS
+} settings_source_t;
+
+/*
+* @brief Settings statistics
+*/
+typedef struct
+{
+  settings_source_t source;
+  uint32_t seq;                 // Commit number in force, 0 for the defaults
+  uint8_t slot;                 // Slot it is in
+  uint8_t bad_slots;            // Slots found corrupt at boot
+  uint32_t commits;             // Commits since boot...
+  uint32_t failures;            // ...and ones that were refused or failed
+  uint32_t load_us;             // Time settings_init() spent reading NVS
+  uint32_t last_commit_us;      // Time the last commit took...
+  uint32_t max_commit_us;       // ...and the longest
+} settings_stats_t;
+
+
+/*
+* @brief Sets NVS up and loads the settings. Does nothing if they are
+*        loaded already, so the host simulation can set them up before
+*        app_main().
+*
+* @return ESP_OK, or the NVS error (the defaults are then in force)
+*/
+esp_err_t settings_init();
+
+/*
+* @brief Copies the settings in force. Safe from any task, never blocks.
+*
+* @param settings - filled in with the settings
+*
+* @return void
+*/
+void settings_get(settings_t *settings);
+
+/*
+* @brief Stores new settings and puts them in force.
+*
+* @param settings - new settings
+*
+* @return ESP_OK, ESP_ERR_INVALID_ARG if a field is out of its limits (see
+*         settings_check()), ESP_ERR_INVALID_STATE before settings_init(),
+*         or the NVS error
+*/
+esp_err_t settings_commit(const settings_t *settings);
+
+/*
+* @brief The compiled in settings.
+*
+* @param settings - filled in with the defaults
+*
+* @return void
+*/
+void settings_defaults(settings_t *settings);
+
+/*
+* @brief Copies the statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void settings_get_stats(settings_stats_t *stats);
+
+#endif
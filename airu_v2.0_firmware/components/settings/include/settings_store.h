@@ -0,0 +1,178 @@
+/*
+*	settings_store.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Node settings and how they are stored.
+*
+*   Everything that used to need a re-flash to change in the field (WiFi
+*   credentials, uplink endpoint, sampling periods, which sensors run) is
+*   one settings_t. It is stored as a single blob:
+*
+*     [0]   magic       SETTINGS_MAGIC
+*     [4]   version     SETTINGS_VERSION of the firmware that wrote it
+*     [6]   len         payload bytes
+*     [8]   seq         commit number, 1 for the first commit
+*     [12]  payload     settings_t as laid out by that firmware
+*     [-4]  CRC-32      of everything before it
+*
+*   Fields are only ever appended to settings_t (and SETTINGS_VERSION
+*   bumped), so a blob from older firmware fills the start of the struct
+*   and the newer fields keep their defaults, and a blob from newer
+*   firmware is read up to what this one knows.
+*
+*   settings.c writes each commit to the older of two slots, so the newest
+*   valid blob is always either the new settings or the ones before them,
+*   whatever point a power loss interrupts the write at.
+*
+*   Every field also has a name (settings_fields[]) so the host simulation
+*   and provisioning can set them as text.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _SETTINGS_STORE_H
+#define _SETTINGS_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SETTINGS_MAGIC          0x53544553  // "SETS"
+#define SETTINGS_VERSION        1
+#define SETTINGS_HDR_LEN        12
+#define SETTINGS_CRC_LEN        4
+#define SETTINGS_BLOB_MAX       512         // Room for the fields later firmware appends
+
+#define SETTINGS_SSID_LEN       33          // 32 and the terminator, as in wifi_sta_config_t
+#define SETTINGS_PASSWORD_LEN   64          // 63 and the terminator, WPA2 passphrase
+#define SETTINGS_URL_LEN        128
+
+// settings_t.sensors
+#define SETTINGS_MICS           0x01
+#define SETTINGS_GPS            0x02
+
+
+/*
+* @brief Node settings. Append only, see above.
+*/
+typedef struct
+{
+  char ssid[SETTINGS_SSID_LEN];           // WiFi network
+  char password[SETTINGS_PASSWORD_LEN];   // "" for an open network
+  char url[SETTINGS_URL_LEN];             // Uplink endpoint
+  uint32_t flush_interval_s;              // Uplink batch age...
+  uint16_t flush_samples;                 // ...and size limits
+  uint32_t pm_period_s;                   // PM sleep schedule, see pm_power.h; 0 never sleeps
+  uint32_t pm_measure_s;
+  uint8_t sensors;                        // SETTINGS_MICS, SETTINGS_GPS
+  uint8_t duty;                           // 1: deep sleep duty cycle (duty.h) instead of running
+  uint32_t duty_period_s;
+  uint16_t duty_uplink_every;
+} settings_t;
+
+/*
+* @brief Field types
+*/
+typedef enum
+{
+  SETTINGS_STR = 0,
+  SETTINGS_U8,
+  SETTINGS_U16,
+  SETTINGS_U32
+} settings_type_t;
+
+/*
+* @brief A named field. Strings have to be min to max characters long.
+*/
+typedef struct
+{
+  const char *name;
+  settings_type_t type;
+  uint16_t offset;
+  uint16_t size;
+  uint32_t min;
+  uint32_t max;
+} settings_field_t;
+
+extern const settings_field_t settings_fields[];
+extern const size_t settings_num_fields;
+
+
+/*
+* @brief Checks every field against its limits and the fields against
+*        each other.
+*
+* @param settings - settings to check
+*
+* @return the first bad field, or NULL if they are fine
+*/
+const settings_field_t *settings_check(const settings_t *settings);
+
+/*
+* @brief Sets a field from text.
+*
+* @param settings - settings to change
+* @param name     - field name
+* @param value    - decimal number, or the string
+*
+* @return 0 on success, -1 if there is no such field or the value is out of
+*         its limits
+*/
+int settings_set(settings_t *settings, const char *name, const char *value);
+
+/*
+* @brief Sets fields from NAME=VALUE lines, as provisioning writes them.
+*        Nothing is changed unless every line is good.
+*
+* @param settings - settings to change
+* @param text     - lines separated by '\n' (a '\r' before it is ignored);
+*                   need not be terminated
+* @param len      - length of text
+*
+* @return number of fields set, or -1 if a line is not NAME=VALUE, names
+*         no field or has a value out of its limits
+*/
+int settings_parse(settings_t *settings, const char *text, size_t len);
+
+/*
+* @brief Formats a field as text.
+*
+* @param settings - settings
+* @param field    - from settings_fields[]
+* @param buf      - where to put the text
+* @param len      - size of buf
+*
+* @return length of the text, as snprintf()
+*/
+int settings_format(const settings_t *settings, const settings_field_t *field, char *buf, size_t len);
+
+/*
+* @brief Encodes settings for storage.
+*
+* @param settings - settings
+* @param seq      - commit number
+* @param blob     - SETTINGS_BLOB_MAX bytes
+*
+* @return bytes used
+*/
+size_t settings_encode(const settings_t *settings, uint32_t seq, uint8_t *blob);
+
+/*
+* @brief Decodes a stored blob over a copy of the defaults.
+*
+* @param blob     - stored bytes
+* @param len      - their length
+* @param defaults - values for fields the blob doesn't have
+* @param settings - where to put the result
+*
+* @return the blob's commit number, or 0 if it is not a valid blob (the
+*         result is then the defaults)
+*/
+uint32_t settings_decode(const uint8_t *blob, size_t len, const settings_t *defaults,
+                         settings_t *settings);
+
+#endif
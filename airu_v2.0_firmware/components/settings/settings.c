@@ -0,0 +1,244 @@
+/*
+*	settings.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Settings in NVS, see settings.h. Commits are serialised by a mutex;
+*   the RAM copy is replaced inside a critical section and readers use a
+*   sequence lock, as timesync.c does for the servo.
+*/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include "settings.h"
+#include "uplink.h"
+#include "pm_if.h"
+#include "duty.h"
+#include "mics.h"
+#include "gps.h"
+
+
+/* Function prototypes */
+static void publish(const settings_t *settings);
+
+/* Global variables */
+static const char *settings_keys[SETTINGS_SLOTS] = { "set0", "set1" };
+static settings_t settings_cur;             // The settings in force
+static volatile uint32_t settings_seq;      // Odd while settings_cur is being replaced
+static portMUX_TYPE settings_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t settings_lock;     // Commits, the NVS handle and the statistics
+static nvs_handle settings_nvs;
+static uint8_t settings_nvs_ok;
+static uint8_t settings_blob[SETTINGS_BLOB_MAX];
+static settings_stats_t settings_stats;
+
+
+
+/*
+* @brief Loads the newest valid slot. See settings.h.
+*/
+esp_err_t settings_init()
+{
+  settings_t defaults;
+  settings_t stored;
+  int64_t start = esp_timer_get_time();
+  uint32_t seq;
+  size_t len;
+  esp_err_t err;
+  uint8_t i;
+
+  if(settings_lock != NULL)
+    return ESP_OK;
+
+  settings_lock = xSemaphoreCreateMutex();
+  if(settings_lock == NULL)
+    return ESP_ERR_NO_MEM;
+
+  settings_defaults(&defaults);
+  publish(&defaults);
+
+  // A partition that is full or from another IDF version is started over.
+  err = nvs_flash_init();
+  if(err == ESP_ERR_NVS_NO_FREE_PAGES)
+  {
+    ESP_LOGW(TAG_SETTINGS, "NVS partition unusable, erasing it");
+    nvs_flash_erase();
+    err = nvs_flash_init();
+  }
+  if(err == ESP_OK)
+    err = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &settings_nvs);
+  if(err != ESP_OK)
+  {
+    ESP_LOGE(TAG_SETTINGS, "no NVS (%s), running on the defaults", esp_err_to_name(err));
+    return err;
+  }
+  settings_nvs_ok = 1;
+
+  for(i = 0; i < SETTINGS_SLOTS; i++)
+  {
+    len = sizeof(settings_blob);
+    err = nvs_get_blob(settings_nvs, settings_keys[i], settings_blob, &len);
+    if(err == ESP_ERR_NVS_NOT_FOUND)
+      continue;
+
+    seq = (err == ESP_OK) ? settings_decode(settings_blob, len, &defaults, &stored) : 0;
+    if(seq == 0)
+    {
+      ESP_LOGW(TAG_SETTINGS, "slot %u is corrupt", i);
+      settings_stats.bad_slots++;
+    }
+    else if(seq > settings_stats.seq)
+    {
+      publish(&stored);
+      settings_stats.source = SETTINGS_FROM_NVS;
+      settings_stats.seq = seq;
+      settings_stats.slot = i;
+    }
+  }
+  settings_stats.load_us = (uint32_t) (esp_timer_get_time() - start);
+
+  if(settings_stats.source == SETTINGS_FROM_NVS)
+    ESP_LOGI(TAG_SETTINGS, "commit %u from slot %u in %u us", settings_stats.seq, settings_stats.slot,
+             settings_stats.load_us);
+  else
+    ESP_LOGI(TAG_SETTINGS, "nothing stored, using the defaults");
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the settings in force. See settings.h.
+*/
+void settings_get(settings_t *settings)
+{
+  uint32_t seq;
+
+  // Sequence lock: retry if a commit was replacing them.
+  do
+  {
+    seq = __atomic_load_n(&settings_seq, __ATOMIC_ACQUIRE);
+    memcpy(settings, &settings_cur, sizeof(*settings));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || seq != settings_seq);
+}
+
+
+/*
+* @brief Writes the older slot, then switches over. See settings.h.
+*/
+esp_err_t settings_commit(const settings_t *settings)
+{
+  const settings_field_t *bad = settings_check(settings);
+  int64_t start = esp_timer_get_time();
+  uint8_t slot;
+  size_t len;
+  esp_err_t err;
+
+  if(settings_lock == NULL)
+    return ESP_ERR_INVALID_STATE;
+
+  xSemaphoreTake(settings_lock, portMAX_DELAY);
+
+  if(bad != NULL || !settings_nvs_ok)
+  {
+    if(bad != NULL)
+      ESP_LOGW(TAG_SETTINGS, "%s is out of range, not committed", bad->name);
+    settings_stats.failures++;
+    xSemaphoreGive(settings_lock);
+    return (bad != NULL) ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+  }
+
+  // The slot in force is only overwritten by the commit after this one.
+  slot = (settings_stats.seq == 0) ? 0 : (settings_stats.slot + 1) % SETTINGS_SLOTS;
+  len = settings_encode(settings, settings_stats.seq + 1, settings_blob);
+  err = nvs_set_blob(settings_nvs, settings_keys[slot], settings_blob, len);
+  if(err == ESP_OK)
+    err = nvs_commit(settings_nvs);
+  if(err != ESP_OK)
+  {
+    ESP_LOGE(TAG_SETTINGS, "commit to slot %u failed: %s", slot, esp_err_to_name(err));
+    settings_stats.failures++;
+    xSemaphoreGive(settings_lock);
+    return err;
+  }
+
+  publish(settings);
+  settings_stats.source = SETTINGS_FROM_NVS;
+  settings_stats.seq++;
+  settings_stats.slot = slot;
+  settings_stats.commits++;
+  settings_stats.last_commit_us = (uint32_t) (esp_timer_get_time() - start);
+  if(settings_stats.last_commit_us > settings_stats.max_commit_us)
+    settings_stats.max_commit_us = settings_stats.last_commit_us;
+  ESP_LOGI(TAG_SETTINGS, "commit %u to slot %u in %u us", settings_stats.seq, slot,
+           settings_stats.last_commit_us);
+
+  xSemaphoreGive(settings_lock);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief The compiled in settings. See settings.h.
+*/
+void settings_defaults(settings_t *settings)
+{
+  memset(settings, 0, sizeof(*settings));
+  strncpy(settings->ssid, SETTINGS_DEFAULT_SSID, sizeof(settings->ssid) - 1);
+  strncpy(settings->password, SETTINGS_DEFAULT_PASSWORD, sizeof(settings->password) - 1);
+  strncpy(settings->url, UPLINK_DEFAULT_URL, sizeof(settings->url) - 1);
+  settings->flush_interval_s = UPLINK_FLUSH_INTERVAL_S;
+  settings->flush_samples = UPLINK_FLUSH_SAMPLES;
+  settings->pm_period_s = PM_POWER_PERIOD_S;
+  settings->pm_measure_s = PM_POWER_MEASURE_S;
+  settings->sensors = (MICS_ENABLED ? SETTINGS_MICS : 0) | (GPS_ENABLED ? SETTINGS_GPS : 0);
+  settings->duty = DUTY_ENABLED;
+  settings->duty_period_s = DUTY_PERIOD_S;
+  settings->duty_uplink_every = DUTY_UPLINK_EVERY;
+}
+
+
+/*
+* @brief Copies the statistics out. See settings.h.
+*/
+void settings_get_stats(settings_stats_t *stats)
+{
+  if(settings_lock == NULL)
+  {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+
+  xSemaphoreTake(settings_lock, portMAX_DELAY);
+  *stats = settings_stats;
+  xSemaphoreGive(settings_lock);
+}
+
+
+/*
+* @brief Replaces the settings in force.
+*
+* @param settings - new settings
+*
+* @return void
+*/
+static void publish(const settings_t *settings)
+{
+  portENTER_CRITICAL(&settings_mux);
+  __atomic_store_n(&settings_seq, settings_seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(&settings_cur, settings, sizeof(settings_cur));
+  __atomic_store_n(&settings_seq, settings_seq + 1, __ATOMIC_RELEASE);
+  portEXIT_CRITICAL(&settings_mux);
+}
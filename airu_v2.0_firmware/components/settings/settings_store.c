@@ -0,0 +1,278 @@
+/*
+*	settings_store.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings_store.h"
+#include "record.h"
+
+#define FIELD(name, type, min, max) \
+  { #name, type, offsetof(settings_t, name), sizeof(((settings_t *) 0)->name), min, max }
+
+
+/* Function prototypes */
+static const settings_field_t *find(const char *name);
+static uint32_t get_uint(const settings_t *settings, const settings_field_t *field);
+static void put_le(uint8_t *p, uint32_t value, int bytes);
+static uint32_t get_le(const uint8_t *p, int bytes);
+
+/* Global variables */
+const settings_field_t settings_fields[] =
+{
+  FIELD(ssid,               SETTINGS_STR, 1, SETTINGS_SSID_LEN - 1),
+  FIELD(password,           SETTINGS_STR, 0, SETTINGS_PASSWORD_LEN - 1),
+  FIELD(url,                SETTINGS_STR, 8, SETTINGS_URL_LEN - 1),
+  FIELD(flush_interval_s,   SETTINGS_U32, 1, 86400),
+  FIELD(flush_samples,      SETTINGS_U16, 1, 1000),
+  FIELD(pm_period_s,        SETTINGS_U32, 0, 86400),
+  FIELD(pm_measure_s,       SETTINGS_U32, 1, 86400),
+  FIELD(sensors,            SETTINGS_U8,  0, SETTINGS_MICS | SETTINGS_GPS),
+  FIELD(duty,               SETTINGS_U8,  0, 1),
+  FIELD(duty_period_s,      SETTINGS_U32, 10, 86400),
+  FIELD(duty_uplink_every,  SETTINGS_U16, 1, 1440)
+};
+const size_t settings_num_fields = sizeof(settings_fields) / sizeof(settings_fields[0]);
+
+_Static_assert(SETTINGS_HDR_LEN + sizeof(settings_t) + SETTINGS_CRC_LEN <= SETTINGS_BLOB_MAX,
+               "settings_t has outgrown SETTINGS_BLOB_MAX");
+
+
+
+/*
+* @brief Checks the settings. See settings_store.h.
+*/
+const settings_field_t *settings_check(const settings_t *settings)
+{
+  const settings_field_t *field;
+  const char *str;
+  size_t len;
+  size_t i;
+
+  for(i = 0; i < settings_num_fields; i++)
+  {
+    field = &settings_fields[i];
+    if(field->type == SETTINGS_STR)
+    {
+      str = (const char *) settings + field->offset;
+      len = strnlen(str, field->size);
+      if(len < field->min || len > field->max)
+        return field;
+    }
+    else if(get_uint(settings, field) < field->min || get_uint(settings, field) > field->max)
+    {
+      return field;
+    }
+  }
+
+  // A measurement window longer than its period would never sleep.
+  if(settings->pm_period_s != 0 && settings->pm_measure_s > settings->pm_period_s)
+    return find("pm_measure_s");
+
+  return NULL;
+}
+
+
+/*
+* @brief Sets a field from text. See settings_store.h.
+*/
+int settings_set(settings_t *settings, const char *name, const char *value)
+{
+  const settings_field_t *field = find(name);
+  uint8_t *p = (uint8_t *) settings;
+  unsigned long n;
+  size_t len;
+  char *end;
+
+  if(field == NULL)
+    return -1;
+
+  if(field->type == SETTINGS_STR)
+  {
+    len = strlen(value);
+    if(len < field->min || len > field->max)
+      return -1;
+    memset(p + field->offset, 0, field->size);
+    memcpy(p + field->offset, value, len);
+    return 0;
+  }
+
+  n = strtoul(value, &end, 0);
+  if(end == value || *end != '\0' || n < field->min || n > field->max)
+    return -1;
+
+  switch(field->type)
+  {
+    case SETTINGS_U8:  p[field->offset] = (uint8_t) n; break;
+    case SETTINGS_U16: *(uint16_t *) (p + field->offset) = (uint16_t) n; break;
+    default:           *(uint32_t *) (p + field->offset) = (uint32_t) n; break;
+  }
+
+  return 0;
+}
+
+
+/*
+* @brief Sets fields from text. See settings_store.h.
+*/
+int settings_parse(settings_t *settings, const char *text, size_t len)
+{
+  settings_t copy = *settings;
+  char line[SETTINGS_URL_LEN + 32];
+  const char *end = text + len;
+  const char *nl;
+  char *eq;
+  size_t n;
+  int fields = 0;
+
+  while(text < end)
+  {
+    nl = memchr(text, '\n', end - text);
+    n = ((nl != NULL) ? nl : end) - text;
+    if(n > 0 && text[n - 1] == '\r')
+      n--;
+
+    if(n > 0)
+    {
+      if(n >= sizeof(line))
+        return -1;
+      memcpy(line, text, n);
+      line[n] = '\0';
+      eq = strchr(line, '=');
+      if(eq == NULL)
+        return -1;
+      *eq = '\0';
+      if(settings_set(&copy, line, eq + 1) != 0)
+        return -1;
+      fields++;
+    }
+
+    text = (nl != NULL) ? nl + 1 : end;
+  }
+
+  *settings = copy;
+  return fields;
+}
+
+
+/*
+* @brief Formats a field. See settings_store.h.
+*/
+int settings_format(const settings_t *settings, const settings_field_t *field, char *buf, size_t len)
+{
+  if(field->type == SETTINGS_STR)
+    return snprintf(buf, len, "%.*s", (int) field->size, (const char *) settings + field->offset);
+
+  return snprintf(buf, len, "%u", get_uint(settings, field));
+}
+
+
+/*
+* @brief Encodes a blob. See settings_store.h.
+*/
+size_t settings_encode(const settings_t *settings, uint32_t seq, uint8_t *blob)
+{
+  size_t len = SETTINGS_HDR_LEN + sizeof(settings_t);
+
+  put_le(blob, SETTINGS_MAGIC, 4);
+  put_le(blob + 4, SETTINGS_VERSION, 2);
+  put_le(blob + 6, sizeof(settings_t), 2);
+  put_le(blob + 8, seq, 4);
+  memcpy(blob + SETTINGS_HDR_LEN, settings, sizeof(settings_t));
+  put_le(blob + len, record_crc32(0, blob, len), 4);
+
+  return len + SETTINGS_CRC_LEN;
+}
+
+
+/*
+* @brief Decodes a blob. See settings_store.h.
+*/
+uint32_t settings_decode(const uint8_t *blob, size_t len, const settings_t *defaults,
+                         settings_t *settings)
+{
+  size_t payload;
+
+  *settings = *defaults;
+
+  if(len < SETTINGS_HDR_LEN + SETTINGS_CRC_LEN || get_le(blob, 4) != SETTINGS_MAGIC)
+    return 0;
+  payload = get_le(blob + 6, 2);
+  if(len != SETTINGS_HDR_LEN + payload + SETTINGS_CRC_LEN ||
+     get_le(blob + len - SETTINGS_CRC_LEN, 4) != record_crc32(0, blob, len - SETTINGS_CRC_LEN))
+    return 0;
+
+  memcpy(settings, blob + SETTINGS_HDR_LEN, (payload < sizeof(settings_t)) ? payload : sizeof(settings_t));
+  if(settings_check(settings) != NULL)
+  {
+    *settings = *defaults;
+    return 0;
+  }
+
+  return get_le(blob + 8, 4);
+}
+
+
+/*
+* @brief Field by name, or NULL.
+*/
+static const settings_field_t *find(const char *name)
+{
+  size_t i;
+
+  for(i = 0; i < settings_num_fields; i++)
+  {
+    if(strcmp(settings_fields[i].name, name) == 0)
+      return &settings_fields[i];
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Value of a numeric field.
+*/
+static uint32_t get_uint(const settings_t *settings, const settings_field_t *field)
+{
+  const uint8_t *p = (const uint8_t *) settings + field->offset;
+
+  switch(field->type)
+  {
+    case SETTINGS_U8:  return *p;
+    case SETTINGS_U16: return *(const uint16_t *) p;
+    default:           return *(const uint32_t *) p;
+  }
+}
+
+
+/*
+* @brief Writes a little endian integer.
+*/
+static void put_le(uint8_t *p, uint32_t value, int bytes)
+{
+  int i;
+
+  for(i = 0; i < bytes; i++)
+    p[i] = (uint8_t) (value >> (8 * i));
+}
+
+
+/*
+* @brief Reads a little endian integer.
+*/
+static uint32_t get_le(const uint8_t *p, int bytes)
+{
+  uint32_t value = 0;
+  int i;
+
+  for(i = 0; i < bytes; i++)
+    value |= (uint32_t) p[i] << (8 * i);
+
+  return value;
+}
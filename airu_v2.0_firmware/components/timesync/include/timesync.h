@@ -0,0 +1,269 @@
+/*
+*	timesync.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Time keeping without NTP.
+*
+*   esp_timer (microseconds since boot) is the monotonic clock every sample
+*   is stamped with. A servo keeps a linear map from esp_timer to UTC: an
+*   anchor point plus a frequency correction in ppb. It is fed measurements,
+*   each a pair of an esp_timer time and the UTC time it corresponds to, from
+*   the best source available:
+*
+*     TIMESYNC_PPS    L70 1PPS edge captured in a GPIO ISR, labelled with
+*                     the second from the RMC/ZDA that follows it (~10 us)
+*     TIMESYNC_NMEA   RMC/ZDA arrival time minus TIMESYNC_NMEA_DELAY_US,
+*                     when there is no PPS (tens of ms)
+*     TIMESYNC_SNTP   system time set by SNTP while WiFi is up
+*     TIMESYNC_RTC    system time kept by the RTC through deep sleep
+*
+*   NMEA arrival times are only ever late, so NMEA measurements are taken
+*   in windows of 8 and only the earliest is used.
+*
+*   A measurement from a worse source is ignored while a better one has
+*   updated the servo within TIMESYNC_HOLDOVER_US. Each update moves the
+*   anchor part of the way to the measurement and nudges the frequency (a
+*   PI loop, with lower gains for the noisier sources). Offsets over
+*   TIMESYNC_STEP_US are treated as spikes and ignored, unless
+*   TIMESYNC_SPIKES_MAX of them come in a row, in which case the clock
+*   steps. When GPS is the source the servo also sets the system time, so
+*   time() and the RTC stay right through deep sleep.
+*
+*   timesync_utc() turns an esp_timer time into UTC with a handful of
+*   integer operations under a sequence lock, so it can be used to stamp
+*   every sample.
+*
+*   The servo (timesync_servo.c) has no ESP-IDF dependencies; see
+*   timesync_sim() for a host simulation with a drifting oscillator and
+*   jittery measurements, which host/bench/pm_bench.c runs (-s timesync).
+*/
+
+#ifndef _TIMESYNC_H
+#define _TIMESYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define TIMESYNC_STEP_US        100000    // Larger offsets are spikes or steps
+#define TIMESYNC_SPIKES_MAX     3         // Spikes in a row before stepping
+#define TIMESYNC_HOLDOVER_US    10000000  // A better source keeps priority this long
+#define TIMESYNC_FREQ_MAX_PPB   500000    // Frequency correction limit
+#define TIMESYNC_NMEA_DELAY_US  100000    // RMC end to UART event at 9600 baud
+#define TIMESYNC_SNTP_POLL_MS   64000     // SNTP/RTC measurement interval
+#define TIMESYNC_SYS_MAX_US     1000      // Resets system time when further off
+#define TIMESYNC_UNIX_2020_S    1577836800
+
+
+/*
+* @brief Time sources, worst to best
+*/
+typedef enum
+{
+  TIMESYNC_NONE = 0,
+  TIMESYNC_RTC,
+  TIMESYNC_SNTP,
+  TIMESYNC_NMEA,
+  TIMESYNC_PPS,
+  TIMESYNC_NUM_SOURCES
+} timesync_source_t;
+
+/*
+* @brief A timestamp
+*/
+typedef struct
+{
+  int64_t mono_us;          // esp_timer, us since boot
+  int64_t utc_us;           // us since 1970, 0 if not synced
+  uint8_t source;           // timesync_source_t the servo is locked to
+} timesync_stamp_t;
+
+/*
+* @brief Servo statistics. offset_us is UTC minus the servo's estimate at
+*        the last update; jitter_us is a running average of its magnitude.
+*/
+typedef struct
+{
+  uint8_t source;
+  int64_t last_update_us;   // esp_timer time of the last update
+  int32_t offset_us;
+  uint32_t offset_max_us;   // Largest magnitude since the last step
+  uint32_t jitter_us;
+  int32_t freq_ppb;         // esp_timer rate error that is corrected for
+  uint32_t updates[TIMESYNC_NUM_SOURCES];
+  uint32_t ignored;         // Measurements from a worse source than the current one
+  uint32_t spikes;
+  uint32_t steps;
+} timesync_stats_t;
+
+/*
+* @brief Servo state
+*/
+typedef struct
+{
+  int64_t mono_us;          // Anchor: the servo says esp_timer mono_us is utc_us
+  int64_t utc_us;
+  int32_t freq_ppb;
+  uint8_t spikes_left;
+  uint8_t window_n;         // Measurements in the current window
+  int64_t window_mono_us;   // Earliest arrival in the window
+  int64_t window_utc_us;
+  timesync_stats_t stats;
+} timesync_servo_t;
+
+/*
+* @brief Simulated oscillator and sources for timesync_sim()
+*/
+typedef struct
+{
+  uint32_t seconds;         // Length of the run, one measurement per second
+  int32_t freq_ppb;         // esp_timer rate error at the start
+  int32_t wander_ppb;       // Random walk step of the rate error per second
+  int64_t offset_us;        // esp_timer at UTC 0 of the run
+  uint8_t source;           // TIMESYNC_PPS or TIMESYNC_NMEA
+  uint32_t jitter_us;       // Uniform measurement jitter
+  int32_t bias_us;          // Measurement bias, e.g. NMEA delay error
+  uint32_t spike_every;     // Every n-th measurement is off by spike_us, 0 for none
+  int32_t spike_us;
+  uint32_t settle_s;        // Ignored in the error figures
+  uint32_t seed;
+} timesync_sim_t;
+
+/*
+* @brief Result of timesync_sim()
+*/
+typedef struct
+{
+  uint32_t lock_s;          // First second the error stayed under 1 ms
+  int32_t max_err_us;       // Largest error magnitude after settle_s
+  uint32_t rms_err_us;
+  int32_t mean_err_us;
+  int32_t freq_err_ppb;     // Servo frequency minus the true one at the end
+  timesync_stats_t stats;
+} timesync_sim_report_t;
+
+
+/*
+* @brief Resets a servo to unsynced.
+*
+* @param servo - servo
+*
+* @return void
+*/
+void timesync_servo_init(timesync_servo_t *servo);
+
+/*
+* @brief Feeds the servo one measurement.
+*
+* @param servo   - servo
+* @param mono_us - esp_timer time of the measurement
+* @param utc_us  - UTC it corresponds to, us since 1970
+* @param source  - where it came from
+*
+* @return 1 if the servo was updated, 0 if the measurement was ignored
+*/
+int timesync_servo_update(timesync_servo_t *servo, int64_t mono_us, int64_t utc_us, uint8_t source);
+
+/*
+* @brief Maps an esp_timer time to UTC.
+*
+* @param servo   - servo
+* @param mono_us - esp_timer time
+*
+* @return us since 1970, 0 if the servo has never been updated
+*/
+int64_t timesync_servo_utc(const timesync_servo_t *servo, int64_t mono_us);
+
+/*
+* @brief UTC from a calendar date and time of day.
+*
+* @param year   - e.g. 2026
+* @param month  - 1-12
+* @param day    - 1-31
+* @param day_ms - ms since midnight
+*
+* @return us since 1970
+*/
+int64_t timesync_civil_to_us(uint16_t year, uint8_t month, uint8_t day, uint32_t day_ms);
+
+/*
+* @brief Runs the servo against a simulated oscillator on a host.
+*
+* @param sim    - oscillator and measurement model
+* @param report - filled in with the error figures and servo statistics
+*
+* @return void
+*/
+void timesync_sim(const timesync_sim_t *sim, timesync_sim_report_t *report);
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Seeds the servo from the system time if the RTC kept it through
+*        deep sleep and starts the SNTP/RTC measurement timer.
+*
+* @param
+*
+* @return ESP_OK, or the esp_timer error
+*/
+esp_err_t timesync_init();
+
+/*
+* @brief Feeds a GPS time. Called by the GPS driver for every RMC/ZDA with
+*        a valid date and time.
+*
+* @param sentence_us - esp_timer time the sentence was read
+* @param pps_us      - esp_timer time of the last PPS edge, 0 if none
+* @param year, month, day, day_ms - UTC from the sentence
+*
+* @return void
+*/
+void timesync_gps(int64_t sentence_us, int64_t pps_us,
+                  uint16_t year, uint8_t month, uint8_t day, uint32_t day_ms);
+
+/*
+* @brief Starts SNTP. Called once the station has an IP; GPS time still
+*        wins while it is available.
+*
+* @param
+*
+* @return void
+*/
+void timesync_sntp_start();
+
+/*
+* @brief Current time.
+*
+* @param stamp - filled in with esp_timer and UTC
+*
+* @return void
+*/
+void timesync_now(timesync_stamp_t *stamp);
+
+/*
+* @brief Maps an esp_timer time to UTC. Safe from any task.
+*
+* @param mono_us - esp_timer time
+*
+* @return us since 1970, 0 if not synced
+*/
+int64_t timesync_utc(int64_t mono_us);
+
+/*
+* @brief Copies the servo statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void timesync_get_stats(timesync_stats_t *stats);
+
+#endif
+
+#endif
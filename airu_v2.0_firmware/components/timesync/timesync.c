@@ -0,0 +1,250 @@
+/*
+*	timesync.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Time keeping on the node, see timesync.h. GPS measurements come from
+*   the sensor task, SNTP/RTC ones from an esp_timer callback; both update
+*   the servo inside a critical section and readers use a sequence lock.
+*/
+#ifdef ESP_PLATFORM
+
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "apps/sntp/sntp.h"
+#include "timesync.h"
+
+static const char *TAG_TIME = "TIME";
+
+
+/* Function prototypes */
+static void update(int64_t mono_us, int64_t utc_us, uint8_t source);
+static void system_sample(void *arg);
+static int64_t system_utc_us();
+
+/* Global variables */
+static timesync_servo_t ts_servo;
+static volatile uint32_t ts_seq;            // Odd while the servo is being updated
+static portMUX_TYPE ts_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t ts_timer;
+static int64_t ts_last_pps_us;              // Only used from vSensor_task
+static uint8_t ts_sntp_running;
+
+
+
+/*
+* @brief Seeds the servo and starts the SNTP/RTC timer. See timesync.h.
+*/
+esp_err_t timesync_init()
+{
+  const esp_timer_create_args_t timer_args =
+  {
+    .callback = system_sample,
+    .arg = NULL,
+    .dispatch_method = ESP_TIMER_TASK,
+    .name = "timesync"
+  };
+  esp_err_t err;
+
+  timesync_servo_init(&ts_servo);
+
+  // The RTC keeps system time through deep sleep and soft resets.
+  system_sample(NULL);
+
+  err = esp_timer_create(&timer_args, &ts_timer);
+  if(err == ESP_OK)
+    err = esp_timer_start_periodic(ts_timer, (uint64_t) TIMESYNC_SNTP_POLL_MS * 1000);
+
+  return err;
+}
+
+
+/*
+* @brief Feeds a GPS time. See timesync.h.
+*/
+void timesync_gps(int64_t sentence_us, int64_t pps_us,
+                  uint16_t year, uint8_t month, uint8_t day, uint32_t day_ms)
+{
+  int64_t utc_us;
+
+  if(year < 2020 || month == 0 || day == 0)
+    return;
+
+  // SNTP would fight the GPS over the system time.
+  if(ts_sntp_running)
+  {
+    sntp_stop();
+    ts_sntp_running = 0;
+  }
+
+  // The PPS edge marks the start of the second the next RMC/ZDA names.
+  if(pps_us != 0 && pps_us != ts_last_pps_us && sentence_us - pps_us > 0 && sentence_us - pps_us < 1000000)
+  {
+    ts_last_pps_us = pps_us;
+    utc_us = timesync_civil_to_us(year, month, day, day_ms - day_ms % 1000);
+    update(pps_us, utc_us, TIMESYNC_PPS);
+  }
+  else
+  {
+    utc_us = timesync_civil_to_us(year, month, day, day_ms);
+    update(sentence_us - TIMESYNC_NMEA_DELAY_US, utc_us, TIMESYNC_NMEA);
+  }
+}
+
+
+/*
+* @brief Starts SNTP. See timesync.h.
+*/
+void timesync_sntp_start()
+{
+  if(ts_sntp_running)
+    return;
+
+  // GPS time is better; don't let SNTP set the clock under it.
+  if(ts_servo.stats.source >= TIMESYNC_NMEA &&
+     esp_timer_get_time() - ts_servo.stats.last_update_us < TIMESYNC_HOLDOVER_US)
+    return;
+
+  sntp_setoperatingmode(SNTP_OPMODE_POLL);
+  sntp_setservername(0, "pool.ntp.org");
+  sntp_init();
+  ts_sntp_running = 1;
+}
+
+
+/*
+* @brief Current time. See timesync.h.
+*/
+void timesync_now(timesync_stamp_t *stamp)
+{
+  stamp->mono_us = esp_timer_get_time();
+  stamp->utc_us = timesync_utc(stamp->mono_us);
+  stamp->source = ts_servo.stats.source;
+}
+
+
+/*
+* @brief Maps an esp_timer time to UTC. See timesync.h.
+*/
+int64_t timesync_utc(int64_t mono_us)
+{
+  int64_t utc_us;
+  uint32_t seq;
+
+  // Sequence lock: retry if the servo was in the middle of an update.
+  do
+  {
+    seq = __atomic_load_n(&ts_seq, __ATOMIC_ACQUIRE);
+    utc_us = timesync_servo_utc(&ts_servo, mono_us);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || seq != ts_seq);
+
+  return utc_us;
+}
+
+
+/*
+* @brief Copies the servo statistics out. See timesync.h.
+*/
+void timesync_get_stats(timesync_stats_t *stats)
+{
+  uint32_t seq;
+
+  do
+  {
+    seq = __atomic_load_n(&ts_seq, __ATOMIC_ACQUIRE);
+    *stats = ts_servo.stats;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while((seq & 1) || seq != ts_seq);
+}
+
+
+/*
+* @brief Feeds the servo and, for GPS sources, keeps the system time on it.
+*
+* @param mono_us - esp_timer time of the measurement
+* @param utc_us  - UTC it corresponds to
+* @param source  - where it came from
+*
+* @return void
+*
+*/
+static void update(int64_t mono_us, int64_t utc_us, uint8_t source)
+{
+  struct timeval tv;
+  int64_t now_us;
+  int64_t diff;
+  int stepped;
+  int updated;
+
+  portENTER_CRITICAL(&ts_mux);
+  __atomic_store_n(&ts_seq, ts_seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  stepped = ts_servo.stats.steps;
+  updated = timesync_servo_update(&ts_servo, mono_us, utc_us, source);
+  stepped = (ts_servo.stats.steps != stepped);
+  __atomic_store_n(&ts_seq, ts_seq + 1, __ATOMIC_RELEASE);
+  portEXIT_CRITICAL(&ts_mux);
+
+  if(stepped)
+    ESP_LOGI(TAG_TIME, "stepped to %lld s from source %d", utc_us / 1000000, source);
+
+  if(!updated || source < TIMESYNC_NMEA)
+    return;
+
+  now_us = timesync_utc(esp_timer_get_time());
+  diff = now_us - system_utc_us();
+  if(diff > TIMESYNC_SYS_MAX_US || diff < -TIMESYNC_SYS_MAX_US)
+  {
+    tv.tv_sec = now_us / 1000000;
+    tv.tv_usec = now_us % 1000000;
+    settimeofday(&tv, NULL);
+  }
+}
+
+
+/*
+* @brief esp_timer callback: turns the system time (set by SNTP, or kept by
+*        the RTC) into a measurement.
+*
+* @param arg - unused
+*
+* @return void
+*
+*/
+static void system_sample(void *arg)
+{
+  int64_t mono_us = esp_timer_get_time();
+  int64_t utc_us = system_utc_us();
+
+  if(utc_us / 1000000 < TIMESYNC_UNIX_2020_S)
+    return;
+
+  update(mono_us, utc_us, ts_sntp_running ? TIMESYNC_SNTP : TIMESYNC_RTC);
+}
+
+
+/*
+* @brief System time.
+*
+* @param
+*
+* @return us since 1970
+*
+*/
+static int64_t system_utc_us()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return (int64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+*	timesync_servo.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "timesync.h"
+
+// Loop gains per source as shifts: the anchor moves offset >> kp and the
+// frequency by (offset / interval) >> ki. Noisier sources get lower gains.
+static const uint8_t kp_shift[TIMESYNC_NUM_SOURCES] = { 0, 0, 0, 2, 1 };
+static const uint8_t ki_shift[TIMESYNC_NUM_SOURCES] = { 0, 2, 2, 8, 3 };
+
+// Measurements per update. NMEA arrival is only ever late, so the earliest
+// of a window (the largest utc - mono) is the best estimate.
+static const uint8_t window[TIMESYNC_NUM_SOURCES] = { 1, 1, 1, 8, 1 };
+
+
+/* Function prototypes */
+static void step(timesync_servo_t *servo, int64_t mono_us, int64_t utc_us);
+
+
+/*
+* @brief Resets a servo. See timesync.h.
+*/
+void timesync_servo_init(timesync_servo_t *servo)
+{
+  memset(servo, 0, sizeof(*servo));
+  servo->spikes_left = TIMESYNC_SPIKES_MAX;
+}
+
+
+/*
+* @brief Feeds the servo one measurement. See timesync.h.
+*/
+int timesync_servo_update(timesync_servo_t *servo, int64_t mono_us, int64_t utc_us, uint8_t source)
+{
+  timesync_stats_t *stats = &servo->stats;
+  int64_t dt_us = mono_us - servo->mono_us;
+  int64_t offset;
+  int64_t mag;
+  int64_t freq;
+
+  if(source == TIMESYNC_NONE || source >= TIMESYNC_NUM_SOURCES)
+    return 0;
+
+  if(stats->source == TIMESYNC_NONE)
+  {
+    step(servo, mono_us, utc_us);
+    stats->source = source;
+    stats->updates[source]++;
+    return 1;
+  }
+
+  if(source < stats->source && mono_us - stats->last_update_us < TIMESYNC_HOLDOVER_US)
+  {
+    stats->ignored++;
+    return 0;
+  }
+
+  if(window[source] > 1)
+  {
+    if(servo->window_n == 0 || utc_us - mono_us > servo->window_utc_us - servo->window_mono_us)
+    {
+      servo->window_mono_us = mono_us;
+      servo->window_utc_us = utc_us;
+    }
+    if(++servo->window_n < window[source])
+      return 0;
+    servo->window_n = 0;
+    mono_us = servo->window_mono_us;
+    utc_us = servo->window_utc_us;
+    dt_us = mono_us - servo->mono_us;
+  }
+
+  if(dt_us <= 0)
+    return 0;
+
+  offset = utc_us - timesync_servo_utc(servo, mono_us);
+  mag = (offset < 0) ? -offset : offset;
+
+  if(mag > TIMESYNC_STEP_US)
+  {
+    if(servo->spikes_left > 0)
+    {
+      servo->spikes_left--;
+      stats->spikes++;
+      return 0;
+    }
+    step(servo, mono_us, utc_us);
+    stats->source = source;
+    stats->updates[source]++;
+    return 1;
+  }
+  servo->spikes_left = TIMESYNC_SPIKES_MAX;
+
+  // Frequency first, from the offset built up since the last update.
+  freq = servo->freq_ppb + ((offset * 1000000000 / dt_us) >> ki_shift[source]);
+  if(freq > TIMESYNC_FREQ_MAX_PPB)
+    freq = TIMESYNC_FREQ_MAX_PPB;
+  else if(freq < -TIMESYNC_FREQ_MAX_PPB)
+    freq = -TIMESYNC_FREQ_MAX_PPB;
+
+  servo->utc_us = utc_us - offset + (offset >> kp_shift[source]);
+  servo->mono_us = mono_us;
+  servo->freq_ppb = (int32_t) freq;
+
+  stats->source = source;
+  stats->last_update_us = mono_us;
+  stats->offset_us = (int32_t) offset;
+  if(mag > stats->offset_max_us)
+    stats->offset_max_us = (uint32_t) mag;
+  stats->jitter_us = (uint32_t) ((int64_t) stats->jitter_us + ((mag - (int64_t) stats->jitter_us) >> 3));
+  stats->freq_ppb = servo->freq_ppb;
+  stats->updates[source]++;
+
+  return 1;
+}
+
+
+/*
+* @brief Maps an esp_timer time to UTC. See timesync.h.
+*/
+int64_t timesync_servo_utc(const timesync_servo_t *servo, int64_t mono_us)
+{
+  int64_t d = mono_us - servo->mono_us;
+
+  if(servo->stats.source == TIMESYNC_NONE)
+    return 0;
+
+  return servo->utc_us + d + d * servo->freq_ppb / 1000000000;
+}
+
+
+/*
+* @brief UTC from a calendar date. See timesync.h.
+*/
+int64_t timesync_civil_to_us(uint16_t year, uint8_t month, uint8_t day, uint32_t day_ms)
+{
+  // Days since 1970-01-01 in the proleptic Gregorian calendar, with the
+  // year starting in March so the leap day comes last.
+  int32_t y = (int32_t) year - (month <= 2);
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  int32_t yoe = y - era * 400;
+  int32_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  int64_t days = (int64_t) era * 146097 + doe - 719468;
+
+  return (days * 86400000 + day_ms) * 1000;
+}
+
+
+/*
+* @brief Jumps the anchor to a measurement.
+*
+* @param servo   - servo
+* @param mono_us - esp_timer time of the measurement
+* @param utc_us  - UTC it corresponds to
+*
+* @return void
+*
+*/
+static void step(timesync_servo_t *servo, int64_t mono_us, int64_t utc_us)
+{
+  timesync_stats_t *stats = &servo->stats;
+
+  servo->mono_us = mono_us;
+  servo->utc_us = utc_us;
+  servo->spikes_left = TIMESYNC_SPIKES_MAX;
+
+  stats->last_update_us = mono_us;
+  stats->offset_us = 0;
+  stats->offset_max_us = 0;
+  stats->jitter_us = 0;
+  stats->steps++;
+}
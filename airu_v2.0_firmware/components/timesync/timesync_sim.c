@@ -0,0 +1,119 @@
+/*
+*	timesync_sim.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Servo simulation for a host. An esp_timer with a wandering rate error
+*   is advanced one UTC second at a time and the servo is fed the second
+*   with the source's jitter, bias and spikes on top. The error is the
+*   servo's UTC for the true esp_timer time at the second minus the second.
+*/
+#ifndef ESP_PLATFORM
+
+#include <string.h>
+#include "timesync.h"
+
+#define SIM_EPOCH_US  ((int64_t) 1790000000 * 1000000)  // Any UTC will do
+
+
+/* Function prototypes */
+static uint32_t next_rand(uint32_t *state);
+
+
+/*
+* @brief Runs the simulation. See timesync.h.
+*/
+void timesync_sim(const timesync_sim_t *sim, timesync_sim_report_t *report)
+{
+  timesync_servo_t servo;
+  uint32_t rng = sim->seed ? sim->seed : 1;
+  int64_t mono_ns = sim->offset_us * 1000;
+  int64_t rate_ppb = sim->freq_ppb;
+  int64_t utc_us;
+  int64_t mono_us;
+  int64_t meas_us;
+  int64_t err;
+  int64_t sum = 0;
+  uint64_t sum_sq = 0;
+  uint32_t n = 0;
+  uint32_t k;
+  int32_t wander;
+
+  memset(report, 0, sizeof(*report));
+  timesync_servo_init(&servo);
+
+  for(k = 0; k < sim->seconds; k++)
+  {
+    utc_us = SIM_EPOCH_US + (int64_t) k * 1000000;
+    mono_us = mono_ns / 1000;
+
+    // Error before this second's update, i.e. after a full second of holdover.
+    if(k > 0)
+    {
+      err = timesync_servo_utc(&servo, mono_us) - utc_us;
+      if(err >= 1000 || err <= -1000)
+        report->lock_s = k + 1;
+      if(k >= sim->settle_s)
+      {
+        if(err > report->max_err_us || -err > report->max_err_us)
+          report->max_err_us = (int32_t) (err < 0 ? -err : err);
+        sum += err;
+        sum_sq += (uint64_t) (err * err);
+        n++;
+      }
+    }
+
+    meas_us = mono_us + sim->bias_us;
+    if(sim->jitter_us > 0)
+      meas_us += next_rand(&rng) % sim->jitter_us;
+    if(sim->spike_every > 0 && k % sim->spike_every == sim->spike_every - 1)
+      meas_us += sim->spike_us;
+    timesync_servo_update(&servo, meas_us, utc_us, sim->source);
+
+    // One true second later, at this second's rate error.
+    mono_ns += 1000000000 + rate_ppb;
+    if(sim->wander_ppb > 0)
+    {
+      wander = (int32_t) (next_rand(&rng) % (2 * sim->wander_ppb + 1)) - sim->wander_ppb;
+      rate_ppb += wander;
+    }
+  }
+
+  if(n > 0)
+  {
+    report->mean_err_us = (int32_t) (sum / n);
+    report->rms_err_us = 0;
+    while((uint64_t) report->rms_err_us * report->rms_err_us < sum_sq / n)
+      report->rms_err_us++;
+  }
+  // esp_timer runs 1 + rate fast, so the servo should apply about -rate.
+  report->freq_err_ppb = (int32_t) (servo.freq_ppb + rate_ppb);
+  report->stats = servo.stats;
+}
+
+
+/*
+* @brief xorshift32
+*
+* @param state - generator state, not 0
+*
+* @return next value
+*
+*/
+static uint32_t next_rand(uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+
+  return x;
+}
+
+#endif
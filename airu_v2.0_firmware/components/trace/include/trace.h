@@ -0,0 +1,174 @@
+/*
+*	trace.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Deferred binary trace.
+*
+*   TRACE(id, a, b, c) stores a 24 byte entry (time, trace point id and up
+*   to three arguments) in a RAM ring instead of formatting and printing a
+*   line. Nothing is formatted on the hot path and nothing waits on the
+*   UART0 TX FIFO. The trace points and their format strings are listed in
+*   trace_ids.h.
+*
+*   Each core has its own ring. A writer masks interrupts on its own core
+*   for the few stores it takes, so trace() can be called from tasks and
+*   ISRs without a lock. The rings overwrite their oldest entries when full;
+*   every slot carries the index it was written with, so the reader can
+*   tell which entries were overwritten (or were being written) while it
+*   copied them and counts them as lost.
+*
+*   vTrace_task runs at the lowest priority, drains the rings every
+*   TRACE_DRAIN_MS and expands the entries with trace_format() through
+*   ESP_LOGI, so the log level silences them. Since the ring and the
+*   formatter have no ESP-IDF dependencies, the same code decodes a RAM
+*   dump of the rings on a host (host/trace_decode.c).
+*/
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "trace_ids.h"
+
+static const char *TAG_TRACE = "TRACE";
+
+#define TRACE_ENABLED     1
+#define TRACE_RING_SIZE   128   // Entries per core, must be a power of two
+#define TRACE_DRAIN_MS    1000
+#define TRACE_PRINT       1     // 0: drain and count only, for measurements
+#define TRACE_TASK_STACK  2560
+#define TRACE_TASK_PRIO   1
+
+#define TRACE_ENUM(id, fmt)   id,
+
+/*
+* @brief Trace point ids
+*/
+typedef enum
+{
+  TRACE_IDS(TRACE_ENUM)
+  TRACE_NUM_IDS
+} trace_id_t;
+
+/*
+* @brief One trace entry
+*/
+typedef struct
+{
+  volatile uint32_t stamp;  // Ring index + 1 once written, 0 while being written
+  uint32_t time_us;         // Low 32 bits of esp_timer
+  uint16_t id;
+  uint8_t core;             // Filled in when the entry is read
+  uint8_t reserved;
+  uint32_t args[3];
+} trace_entry_t;
+
+/*
+* @brief Single writer ring
+*/
+typedef struct
+{
+  volatile uint32_t head;   // Next index to write
+  uint32_t tail;            // Next index to read, reader only
+  uint32_t lost;            // Entries overwritten before they were read
+  trace_entry_t slots[TRACE_RING_SIZE];
+} trace_ring_t;
+
+/*
+* @brief Trace statistics
+*/
+typedef struct
+{
+  uint32_t entries;         // Entries read from the rings
+  uint32_t lost;
+  uint32_t busy_us;         // Time vTrace_task spent expanding and printing
+} trace_stats_t;
+
+
+/*
+* @brief Empties a ring.
+*
+* @param ring - ring
+*
+* @return void
+*/
+void trace_ring_init(trace_ring_t *ring);
+
+/*
+* @brief Writes an entry. Only one writer at a time per ring.
+*
+* @param ring    - ring
+* @param time_us - timestamp
+* @param id      - trace point
+* @param a, b, c - arguments
+*
+* @return void
+*/
+void trace_ring_put(trace_ring_t *ring, uint32_t time_us, uint16_t id, uint32_t a, uint32_t b, uint32_t c);
+
+/*
+* @brief Copies out the entries written since the last drain. Can run
+*        alongside the writer.
+*
+* @param ring - ring
+* @param out  - output array
+* @param max  - size of the output array
+*
+* @return number of entries copied
+*/
+size_t trace_ring_drain(trace_ring_t *ring, trace_entry_t *out, size_t max);
+
+/*
+* @brief Expands an entry into text.
+*
+* @param entry - entry
+* @param buf   - output buffer
+* @param len   - size of buf
+*
+* @return length of the text, as snprintf()
+*/
+int trace_format(const trace_entry_t *entry, char *buf, size_t len);
+
+
+#ifdef ESP_PLATFORM
+
+/*
+* @brief Starts vTrace_task.
+*
+* @param
+*
+* @return ESP_OK, ESP_ERR_NO_MEM if the task can't be created
+*/
+esp_err_t trace_init();
+
+/*
+* @brief Writes an entry to this core's ring. Safe from tasks and ISRs.
+*
+* @param id      - trace point
+* @param a, b, c - arguments
+*
+* @return void
+*/
+void trace(uint16_t id, uint32_t a, uint32_t b, uint32_t c);
+
+/*
+* @brief Copies the trace statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void trace_get_stats(trace_stats_t *stats);
+
+#define TRACE(id, a, b, c)  do { if(TRACE_ENABLED) trace((id), (a), (b), (c)); } while(0)
+
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+/*
+*	trace_ids.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Trace points and their format strings. Each takes up to three 32 bit
+*   arguments; the format string is only used when an entry is expanded,
+*   so it costs nothing on the node until then. Add new points at the end
+*   so ids in old dumps keep their meaning.
+*/
+
+#ifndef _TRACE_IDS_H
+#define _TRACE_IDS_H
+
+#define TRACE_IDS(X) \
+  X(TR_SYNC,          "sync: esp_timer %u ms") \
+  X(TR_PM_EVENT,      "pm: uart event type %u, %u bytes, ch %u") \
+  X(TR_PM_FRAMES,     "pm: %u frames, %u resync bytes/errors, ch %u") \
+  X(TR_PM_DATA,       "pm: PM1 %u, PM2.5 %u, PM10 %u ug/m3") \
+  X(TR_PM_FIFO_OVF,   "pm: hw fifo overflow, ch %u") \
+  X(TR_PM_BUF_FULL,   "pm: ring buffer full, ch %u") \
+  X(TR_PM_BREAK,      "pm: uart rx break, ch %u") \
+  X(TR_PM_PARITY,     "pm: uart parity error, ch %u") \
+  X(TR_PM_FRAME_ERR,  "pm: uart frame error, ch %u") \
+  X(TR_PM_LISTEN,     "pm: listen window in %u ms, ch %u") \
+  X(TR_PM_POWER,      "pm: power state %u, action %u, ch %u") \
+  X(TR_PM_HEALTH,     "pm: health state %u, action %u, ch %u")
+
+#endif
@@ -0,0 +1,103 @@
+/*
+*	trace.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+
+#define TRACE_MASK  (TRACE_RING_SIZE - 1)
+#define TRACE_FMT(id, fmt)  fmt,
+
+static const char *const trace_fmts[TRACE_NUM_IDS] = { TRACE_IDS(TRACE_FMT) };
+
+
+/*
+* @brief Empties a ring. See trace.h.
+*/
+void trace_ring_init(trace_ring_t *ring)
+{
+  memset(ring, 0, sizeof(*ring));
+}
+
+
+/*
+* @brief Writes an entry. See trace.h.
+*/
+void trace_ring_put(trace_ring_t *ring, uint32_t time_us, uint16_t id, uint32_t a, uint32_t b, uint32_t c)
+{
+  uint32_t idx = ring->head;
+  trace_entry_t *e = &ring->slots[idx & TRACE_MASK];
+
+  // Mark the slot as being written before touching its contents.
+  __atomic_store_n(&e->stamp, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e->time_us = time_us;
+  e->id = id;
+  e->args[0] = a;
+  e->args[1] = b;
+  e->args[2] = c;
+  __atomic_store_n(&e->stamp, idx + 1, __ATOMIC_RELEASE);
+  __atomic_store_n(&ring->head, idx + 1, __ATOMIC_RELEASE);
+}
+
+
+/*
+* @brief Copies out new entries. See trace.h.
+*/
+size_t trace_ring_drain(trace_ring_t *ring, trace_entry_t *out, size_t max)
+{
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  const trace_entry_t *e;
+  uint32_t stamp;
+  size_t n = 0;
+
+  // Anything more than a ring behind has been overwritten.
+  if(head - ring->tail > TRACE_RING_SIZE)
+  {
+    ring->lost += head - ring->tail - TRACE_RING_SIZE;
+    ring->tail = head - TRACE_RING_SIZE;
+  }
+
+  while(ring->tail != head && n < max)
+  {
+    e = &ring->slots[ring->tail & TRACE_MASK];
+    stamp = __atomic_load_n(&e->stamp, __ATOMIC_ACQUIRE);
+    out[n] = *e;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    // The writer lapped us while we were copying.
+    if(stamp != ring->tail + 1 || e->stamp != stamp)
+      ring->lost++;
+    else
+      n++;
+    ring->tail++;
+  }
+
+  return n;
+}
+
+
+/*
+* @brief Expands an entry. See trace.h.
+*/
+int trace_format(const trace_entry_t *entry, char *buf, size_t len)
+{
+  int n;
+
+  n = snprintf(buf, len, "%10u.%03u %u ", (unsigned) (entry->time_us / 1000),
+               (unsigned) (entry->time_us % 1000), entry->core);
+  if(n < 0 || (size_t) n >= len)
+    return n;
+
+  if(entry->id >= TRACE_NUM_IDS)
+    return n + snprintf(buf + n, len - n, "unknown trace id %u (%u, %u, %u)", entry->id,
+                        (unsigned) entry->args[0], (unsigned) entry->args[1], (unsigned) entry->args[2]);
+
+  return n + snprintf(buf + n, len - n, trace_fmts[entry->id],
+                      (unsigned) entry->args[0], (unsigned) entry->args[1], (unsigned) entry->args[2]);
+}
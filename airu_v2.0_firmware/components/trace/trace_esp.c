@@ -0,0 +1,152 @@
+/*
+*	trace_esp.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Per-core trace rings and the task that expands them, see trace.h.
+*/
+#ifdef ESP_PLATFORM
+
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "trace.h"
+#include "power.h"
+
+#define TRACE_BATCH   16    // Entries copied out at a time
+
+
+/* Function prototypes */
+static void vTrace_task(void *pvParameters);
+
+/* Global variables */
+static trace_ring_t trace_rings[portNUM_PROCESSORS];
+static trace_stats_t trace_stats;
+static TaskHandle_t trace_task;
+
+
+
+/*
+* @brief Starts the trace task. See trace.h.
+*/
+esp_err_t trace_init()
+{
+  if(trace_task != NULL)
+    return ESP_OK;
+
+  if(xTaskCreate(vTrace_task, "vTrace_task", TRACE_TASK_STACK, NULL, TRACE_TASK_PRIO,
+                 &trace_task) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Writes an entry to this core's ring. See trace.h.
+*/
+void IRAM_ATTR trace(uint16_t id, uint32_t a, uint32_t b, uint32_t c)
+{
+  uint32_t state;
+  uint32_t core;
+
+  // Nothing else on this core can get in; the other core has its own ring.
+  state = portENTER_CRITICAL_NESTED();
+  core = xPortGetCoreID();
+  trace_ring_put(&trace_rings[core], (uint32_t) esp_timer_get_time(), id, a, b, c);
+  portEXIT_CRITICAL_NESTED(state);
+}
+
+
+/*
+* @brief Copies the trace statistics out. See trace.h.
+*/
+void trace_get_stats(trace_stats_t *stats)
+{
+  uint8_t i;
+
+  *stats = trace_stats;
+  stats->lost = 0;
+  for(i = 0; i < portNUM_PROCESSORS; i++)
+  {
+    stats->lost += trace_rings[i].lost;
+  }
+}
+
+
+/*
+* @brief Drains the rings every TRACE_DRAIN_MS and logs the entries, led
+*        by a TR_SYNC line with the full esp_timer time when there are
+*        any. Nothing is logged for a quiet second. Also logs the power
+*        lock statistics every POWER_LOG_S.
+*
+* @param
+*
+* @return
+*
+*/
+static void vTrace_task(void *pvParameters)
+{
+  trace_entry_t batch[TRACE_BATCH];
+  trace_entry_t sync;
+  char line[128];
+  int64_t start;
+  size_t n;
+  size_t i;
+  uint32_t drains = 0;
+  uint8_t core;
+  int synced;
+
+  for(;;)
+  {
+    vTaskDelay(TRACE_DRAIN_MS / portTICK_PERIOD_MS);
+
+    start = esp_timer_get_time();
+    memset(&sync, 0, sizeof(sync));
+    sync.time_us = (uint32_t) start;
+    sync.id = TR_SYNC;
+    sync.core = xPortGetCoreID();
+    sync.args[0] = (uint32_t) (start / 1000);
+    synced = 0;
+
+    for(core = 0; core < portNUM_PROCESSORS; core++)
+    {
+      while((n = trace_ring_drain(&trace_rings[core], batch, TRACE_BATCH)) > 0)
+      {
+        trace_stats.entries += n;
+        // The entries only hold the low 32 bits of the time.
+        if(!synced && TRACE_PRINT)
+        {
+          trace_format(&sync, line, sizeof(line));
+          ESP_LOGI(TAG_TRACE, "%s", line);
+          synced = 1;
+        }
+        for(i = 0; i < n && TRACE_PRINT; i++)
+        {
+          batch[i].core = core;
+          trace_format(&batch[i], line, sizeof(line));
+          ESP_LOGI(TAG_TRACE, "%s", line);
+        }
+      }
+    }
+
+    trace_stats.busy_us += (uint32_t) (esp_timer_get_time() - start);
+
+    if(++drains >= POWER_LOG_S * 1000 / TRACE_DRAIN_MS)
+    {
+      power_log_stats();
+      drains = 0;
+    }
+  }
+
+  vTaskDelete(NULL);
+}
+
+#endif
@@ -0,0 +1,50 @@
+/*
+*	backoff.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include "backoff.h"
+
+
+/*
+* @brief Sets up a backoff policy. See backoff.h.
+*/
+void backoff_init(backoff_t *backoff, uint32_t base_ms, uint32_t max_ms)
+{
+  backoff->base_ms = base_ms;
+  backoff->max_ms = (max_ms < base_ms) ? base_ms : max_ms;
+  backoff_reset(backoff);
+}
+
+
+/*
+* @brief Records a failure and returns the jittered delay. See backoff.h.
+*/
+uint32_t backoff_fail(backoff_t *backoff, uint32_t random)
+{
+  uint32_t delay = backoff->current_ms;
+  uint32_t half = delay / 2;
+
+  backoff->failures++;
+
+  if(backoff->current_ms > backoff->max_ms / 2)
+    backoff->current_ms = backoff->max_ms;
+  else
+    backoff->current_ms *= 2;
+
+  // Somewhere in [delay/2, delay].
+  return half + ((half > 0) ? (random % (half + 1)) : 0);
+}
+
+
+/*
+* @brief Records a success. See backoff.h.
+*/
+void backoff_reset(backoff_t *backoff)
+{
+  backoff->current_ms = backoff->base_ms;
+  backoff->failures = 0;
+}
@@ -0,0 +1,68 @@
+/*
+*	backoff.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Exponential backoff with jitter for retrying network operations.
+*
+*   Each failure doubles the delay up to a cap, and the actual delay is picked
+*   at random between half and all of it so a fleet of nodes that lost the
+*   same AP or server does not retry in lock step.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host.
+*/
+
+#ifndef _BACKOFF_H
+#define _BACKOFF_H
+
+#include <stdint.h>
+
+
+/*
+* @brief Backoff state
+*/
+typedef struct
+{
+  uint32_t base_ms;       // Delay after the first failure
+  uint32_t max_ms;        // Cap on the delay
+  uint32_t current_ms;    // Un-jittered delay for the next failure
+  uint32_t failures;      // Consecutive failures
+} backoff_t;
+
+
+/*
+* @brief Sets up a backoff policy.
+*
+* @param backoff - state to initialise
+* @param base_ms - delay after the first failure
+* @param max_ms  - maximum delay
+*
+* @return void
+*/
+void backoff_init(backoff_t *backoff, uint32_t base_ms, uint32_t max_ms);
+
+/*
+* @brief Records a failure and returns how long to wait before retrying.
+*
+* @param backoff - backoff state
+* @param random  - any random 32 bit value, used for the jitter
+*
+* @return delay in milliseconds
+*/
+uint32_t backoff_fail(backoff_t *backoff, uint32_t random);
+
+/*
+* @brief Records a success, the next failure starts again from base_ms.
+*
+* @param backoff - backoff state
+*
+* @return void
+*/
+void backoff_reset(backoff_t *backoff);
+
+
+#endif
@@ -0,0 +1,117 @@
+/*
+*	uplink.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Batched telemetry uplink.
+*
+*   The uplink task registers its own sample ring with the PM driver, packs
+*   samples into binary batches (see uplink_batch.h) and POSTs a batch when it
+*   has been open for flush_interval_s or holds flush_samples samples. All
+*   requests go through one HTTP client so the connection is kept alive
+*   between batches. Sealed batches wait in a RAM spill queue while WiFi is
+*   down or the server is failing; failed sends are retried with exponential
+*   backoff and jitter. When the spill queue is full the oldest batch is moved
+*   to the SD card backlog if there is one (see sdlog.h), otherwise it is
+*   dropped. After reconnecting the backlog is replayed first, oldest data
+*   first.
+*/
+
+#ifndef _UPLINK_H
+#define _UPLINK_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "pm_ring.h"
+#include "sdlog.h"
+
+static const char *TAG_UPLINK = "UPLINK";
+
+#define UPLINK_DEFAULT_URL        "http://192.168.4.2:8080/airu/batch"
+#define UPLINK_FLUSH_INTERVAL_S   300   // Send a batch at least every 5 minutes
+#define UPLINK_FLUSH_SAMPLES      150   // ...or once it holds this many samples
+#define UPLINK_SPILL_BATCHES      8     // Sealed batches kept in RAM while offline
+#define UPLINK_RETRY_BASE_MS      2000
+#define UPLINK_RETRY_MAX_MS       300000
+#define UPLINK_POLL_MS            1000  // How often the task drains the sample ring
+#define UPLINK_TIMEOUT_MS         10000
+#define UPLINK_REPLAY_SAMPLES     128   // Samples per batch when replaying the SD backlog
+
+
+/*
+* @brief Uplink settings
+*/
+typedef struct
+{
+  const char *url;              // Endpoint batches are POSTed to
+  uint32_t flush_interval_s;    // Max time a batch stays open
+  uint16_t flush_samples;       // Max samples per batch
+  sdlog_t *backlog;             // Mounted SD log for overflow, or NULL
+} uplink_config_t;
+
+#define UPLINK_CONFIG_DEFAULT() {                 \
+    .url = UPLINK_DEFAULT_URL,                    \
+    .flush_interval_s = UPLINK_FLUSH_INTERVAL_S,  \
+    .flush_samples = UPLINK_FLUSH_SAMPLES,        \
+    .backlog = NULL                               \
+}
+
+/*
+* @brief Uplink statistics
+*
+* bytes_sent / samples_sent is the payload cost per sample and requests
+* over uptime gives requests per hour.
+*/
+typedef struct
+{
+  uint32_t samples_sent;
+  uint32_t bytes_sent;          // Payload bytes acknowledged by the server
+  uint32_t requests;            // POSTs attempted
+  uint32_t failures;            // POSTs that failed or got a non-2xx status
+  uint32_t batches_dropped;     // Batches lost because the spill queue was full
+  uint32_t batches_to_sd;       // Batches moved from the spill queue to the SD backlog
+  uint32_t samples_dropped;     // Samples lost because the uplink ring was full
+  uint16_t spilled;             // Batches currently waiting to be sent
+} uplink_stats_t;
+
+
+/*
+* @brief Starts the uplink task.
+*
+* @param config - settings, or NULL for the UPLINK_* defaults. The url string
+*                 must stay valid.
+*
+* @return ESP_OK on success
+*/
+esp_err_t uplink_init(const uplink_config_t *config);
+
+/*
+* @brief Copies the uplink statistics.
+*
+* @param stats - where to store the statistics
+*
+* @return ESP_OK
+*/
+esp_err_t uplink_get_stats(uplink_stats_t *stats);
+
+/*
+* @brief Sends samples straight away from the calling task, for the deep
+*        sleep duty cycle where the uplink task is not started. Samples are
+*        packed into as many batches as needed. If a later batch fails the
+*        earlier ones have already been delivered and are sent again if the
+*        caller retries.
+*
+* @param config  - settings used if the client is not open yet, or NULL
+* @param samples - samples to send
+* @param n       - number of samples
+*
+* @return ESP_OK if every batch was accepted
+*/
+esp_err_t uplink_send_samples(const uplink_config_t *config, const pm_sample_t *samples, size_t n);
+
+
+#endif
@@ -0,0 +1,390 @@
+/*
+*	uplink.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_http_client.h"
+#include "internet_if.h"
+#include "pm_if.h"
+#include "power.h"
+#include "backoff.h"
+#include "uplink_batch.h"
+#include "uplink.h"
+
+
+/* Function prototypes */
+esp_err_t uplink_init(const uplink_config_t *config);
+esp_err_t uplink_get_stats(uplink_stats_t *stats);
+esp_err_t uplink_send_samples(const uplink_config_t *config, const pm_sample_t *samples, size_t n);
+static esp_err_t open_client(const uplink_config_t *config);
+static void vUplink_task(void *pvParameters);
+static void seal_batch();
+static esp_err_t send_batch(const uplink_batch_t *batch);
+static esp_err_t send_backlog();
+
+/* Global variables */
+static uplink_config_t uplink_config;
+static uplink_stats_t uplink_stats;
+static pm_ring_t uplink_ring;
+static esp_http_client_handle_t uplink_client;
+static backoff_t uplink_backoff;
+static power_lock_t uplink_lock;
+
+// Spill queue. spill_count sealed batches start at spill_head; the slot
+// right after them is the batch currently being filled.
+static uplink_batch_t spill[UPLINK_SPILL_BATCHES];
+static uint16_t spill_head;
+static uint16_t spill_count;
+static int64_t batch_opened_us;
+
+// Scratch space for replaying the SD backlog
+static pm_sample_t replay[UPLINK_REPLAY_SAMPLES];
+static uplink_batch_t replay_batch;
+
+#define BUILDING  (&spill[(spill_head + spill_count) % UPLINK_SPILL_BATCHES])
+
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t uplink_init(const uplink_config_t *config)
+{
+  esp_err_t err;
+
+  err = open_client(config);
+  if(err != ESP_OK)
+    return err;
+
+  backoff_init(&uplink_backoff, UPLINK_RETRY_BASE_MS, UPLINK_RETRY_MAX_MS);
+  uplink_batch_init(BUILDING);
+
+  pm_ring_init(&uplink_ring);
+  err = PM_add_consumer(&uplink_ring);
+  if(err != ESP_OK)
+    return err;
+
+  xTaskCreate(vUplink_task, "vUplink_task", 4096, NULL, 5, NULL);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t uplink_get_stats(uplink_stats_t *stats)
+{
+  *stats = uplink_stats;
+  stats->samples_dropped = pm_ring_dropped(&uplink_ring);
+  stats->spilled = spill_count;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*
+*/
+esp_err_t uplink_send_samples(const uplink_config_t *config, const pm_sample_t *samples, size_t n)
+{
+  esp_err_t err;
+  size_t i = 0;
+
+  if(uplink_client == NULL)
+  {
+    err = open_client(config);
+    if(err != ESP_OK)
+      return err;
+  }
+
+  while(i < n)
+  {
+    uplink_batch_init(&replay_batch);
+    while(i < n && uplink_batch_add(&replay_batch, &samples[i]))
+    {
+      i++;
+    }
+
+    err = send_batch(&replay_batch);
+    if(err != ESP_OK)
+      return err;
+  }
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Stores the settings and creates the HTTP client all requests go
+*        through.
+*
+* @param config - settings, or NULL for the defaults
+*
+* @return ESP_OK on success
+*
+*/
+static esp_err_t open_client(const uplink_config_t *config)
+{
+  uplink_config_t defaults = UPLINK_CONFIG_DEFAULT();
+
+  uplink_config = (config != NULL) ? *config : defaults;
+
+  esp_http_client_config_t http_config =
+  {
+    .url = uplink_config.url,
+    .method = HTTP_METHOD_POST,
+    .timeout_ms = UPLINK_TIMEOUT_MS
+  };
+
+  uplink_client = esp_http_client_init(&http_config);
+  if(uplink_client == NULL)
+    return ESP_FAIL;
+  esp_http_client_set_header(uplink_client, "Content-Type", "application/octet-stream");
+
+  power_lock_create(&uplink_lock, POWER_CPU_MAX, "uplink");
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Batches samples from the uplink ring and sends sealed batches when
+*        WiFi is up and the backoff delay has passed.
+*
+* @param
+*
+* @return
+*
+*/
+static void vUplink_task(void *pvParameters)
+{
+  const pm_sample_t *first;
+  esp_err_t err;
+  bool from_sd;
+  int64_t next_try_us = 0;
+  int64_t now;
+  size_t n;
+  size_t i;
+
+  for(;;)
+  {
+    while((n = pm_ring_peek(&uplink_ring, &first)) > 0)
+    {
+      for(i = 0; i < n; i++)
+      {
+        if(BUILDING->count == 0)
+          batch_opened_us = first[i].time_us;
+
+        if(!uplink_batch_add(BUILDING, &first[i]))
+        {
+          seal_batch();
+          batch_opened_us = first[i].time_us;
+          uplink_batch_add(BUILDING, &first[i]);
+        }
+
+        if(BUILDING->count >= uplink_config.flush_samples)
+          seal_batch();
+      }
+      pm_ring_release(&uplink_ring, n);
+    }
+
+    now = esp_timer_get_time();
+    if(BUILDING->count > 0 &&
+       now - batch_opened_us >= (int64_t) uplink_config.flush_interval_s * 1000000)
+      seal_batch();
+
+    // Send everything that is waiting, oldest first (SD backlog, then RAM),
+    // while it keeps working.
+    while(now >= next_try_us && wifi_wait_connected(0) == ESP_OK)
+    {
+      from_sd = (uplink_config.backlog != NULL && sdlog_pending(uplink_config.backlog) > 0);
+      if(from_sd)
+        err = send_backlog();
+      else if(spill_count > 0)
+        err = send_batch(&spill[spill_head]);
+      else
+        break;
+
+      if(err != ESP_OK)
+      {
+        next_try_us = now + (int64_t) backoff_fail(&uplink_backoff, esp_random()) * 1000;
+        break;
+      }
+
+      backoff_reset(&uplink_backoff);
+      if(!from_sd)
+      {
+        spill_head = (spill_head + 1) % UPLINK_SPILL_BATCHES;
+        spill_count--;
+      }
+      now = esp_timer_get_time();
+    }
+
+    vTaskDelay(UPLINK_POLL_MS / portTICK_PERIOD_MS);
+  }
+
+  vTaskDelete(NULL);
+}
+
+
+/*
+* @brief Closes the batch being built and starts a new one. If the spill
+*        queue is full the oldest sealed batch goes to the SD backlog, or is
+*        dropped if there is no card.
+*
+* @param
+*
+* @return
+*
+*/
+static void seal_batch()
+{
+  uplink_batch_t *oldest;
+  int n;
+  int i;
+
+  spill_count++;
+  if(spill_count == UPLINK_SPILL_BATCHES)
+  {
+    oldest = &spill[spill_head];
+    n = (uplink_config.backlog != NULL) ?
+        uplink_batch_decode(oldest->buf, oldest->len, replay, UPLINK_REPLAY_SAMPLES) : -1;
+
+    if(n > 0)
+    {
+      for(i = 0; i < n; i++)
+      {
+        sdlog_append(uplink_config.backlog, &replay[i]);
+      }
+      sdlog_flush(uplink_config.backlog);
+      uplink_stats.batches_to_sd++;
+    }
+    else
+    {
+      ESP_LOGW(TAG_UPLINK, "spill queue full, dropping oldest batch");
+      uplink_stats.batches_dropped++;
+    }
+
+    spill_head = (spill_head + 1) % UPLINK_SPILL_BATCHES;
+    spill_count--;
+  }
+
+  uplink_batch_init(BUILDING);
+}
+
+
+/*
+* @brief POSTs one batch over the persistent connection.
+*
+* @param batch - sealed batch
+*
+* @return ESP_OK if the server accepted it
+*
+*/
+static esp_err_t send_batch(const uplink_batch_t *batch)
+{
+  esp_err_t err;
+  int status;
+
+  uplink_stats.requests++;
+
+  // Full speed for the request, and the TLS handshake if the connection
+  // has to be opened again.
+  power_lock_acquire(&uplink_lock);
+  esp_http_client_set_post_field(uplink_client, (const char *) batch->buf, batch->len);
+  err = esp_http_client_perform(uplink_client);
+  if(err == ESP_OK)
+  {
+    status = esp_http_client_get_status_code(uplink_client);
+    if(status < 200 || status > 299)
+    {
+      ESP_LOGW(TAG_UPLINK, "server returned %d", status);
+      err = ESP_FAIL;
+    }
+  }
+  else
+  {
+    // Drop the connection so the next attempt starts clean.
+    ESP_LOGW(TAG_UPLINK, "post failed: %s", esp_err_to_name(err));
+    esp_http_client_close(uplink_client);
+  }
+  power_lock_release(&uplink_lock);
+
+  if(err != ESP_OK)
+  {
+    uplink_stats.failures++;
+    return err;
+  }
+
+  uplink_stats.samples_sent += batch->count;
+  uplink_stats.bytes_sent += batch->len;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sends the oldest part of the SD backlog as one batch and moves the
+*        log's upload cursor past it once the server has accepted it.
+*
+* @param
+*
+* @return ESP_OK if the server accepted it
+*
+*/
+static esp_err_t send_backlog()
+{
+  esp_err_t err;
+  int n;
+  int i;
+
+  n = sdlog_read(uplink_config.backlog, replay, UPLINK_REPLAY_SAMPLES);
+  if(n < 0)
+    return ESP_FAIL;
+
+  uplink_batch_init(&replay_batch);
+  for(i = 0; i < n; i++)
+  {
+    if(!uplink_batch_add(&replay_batch, &replay[i]))
+      break;
+  }
+
+  // Only whole reads can be acknowledged, so if the batch filled up early
+  // send what fits and re-read the rest next time.
+  if(i < n)
+    n = sdlog_read(uplink_config.backlog, replay, i);
+
+  if(n > 0)
+  {
+    err = send_batch(&replay_batch);
+    if(err != ESP_OK)
+      return err;
+  }
+
+  return sdlog_ack(uplink_config.backlog);
+}
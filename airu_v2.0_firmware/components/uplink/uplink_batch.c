@@ -0,0 +1,63 @@
+/*
+*	uplink_batch.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include "uplink_batch.h"
+
+
+/*
+* @brief Empties a batch. See uplink_batch.h.
+*/
+void uplink_batch_init(uplink_batch_t *batch)
+{
+  record_block_init(&batch->block, batch->buf, UPLINK_BATCH_MAX);
+  batch->len = batch->block.len;
+  batch->count = 0;
+}
+
+
+/*
+* @brief Appends one sample. See uplink_batch.h.
+*/
+int uplink_batch_add(uplink_batch_t *batch, const pm_sample_t *sample)
+{
+  sensor_sample_t rec;
+
+  record_from_pm(sample, &rec);
+  if(!record_block_add(&batch->block, &rec))
+    return 0;
+
+  batch->len = batch->block.len;
+  batch->count = batch->block.count;
+
+  return 1;
+}
+
+
+/*
+* @brief Decodes a batch. See uplink_batch.h.
+*/
+int uplink_batch_decode(const uint8_t *buf, size_t len, pm_sample_t *samples, size_t max)
+{
+  record_reader_t reader;
+  sensor_sample_t rec;
+  size_t n = 0;
+  int ret;
+
+  if(record_reader_init(&reader, buf, len) < 0)
+    return -1;
+
+  while((ret = record_reader_next(&reader, &rec)) > 0)
+  {
+    if(n == max)
+      return -1;
+    if(record_to_pm(&rec, &samples[n]))
+      n++;
+  }
+
+  return (ret < 0) ? -1 : (int) n;
+}
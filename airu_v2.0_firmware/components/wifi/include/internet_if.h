@@ -1,7 +1,7 @@
 /*
 *	internet_if.h
 *	
-*	Last Modified: August 1, 2018
+*	Last Modified: October 17, 2026
 *	 Author: Trenton Taylor
 *
 */
@@ -12,6 +12,8 @@
 
 #include "esp_err.h"
 #include "esp_event.h"
+#include "freertos/FreeRTOS.h"
+#include "wifi_conn.h"
 
 
 #define EXAMPLE_ESP_WIFI_MODE_AP   CONFIG_ESP_WIFI_MODE_AP //TRUE:AP FALSE:STA
@@ -34,6 +36,25 @@ volatile char ip_address[15];
 */
 void wifi_init_sta();
 
+/*
+* @brief Brings up the WiFi stack (event loop, TCP/IP adapter, driver) on
+*        first use and connects as a station.
+*
+* @param
+*
+* @return
+*/
+void wifi_start_sta();
+
+/*
+* @brief Connects again with the credentials stored now, e.g. after
+*        provisioning. A new SSID drops the cached AP (wifi_conn.h).
+*        Brings the station up if it is not yet.
+*
+* @return void
+*/
+void wifi_reconnect();
+
 /*
 * @brief
 *
@@ -52,6 +73,25 @@ void wifi_init_softap();
 */
 void wifi_stop();
 
+/*
+* @brief Waits until the station is connected and has an IP.
+*
+* @param wait - ticks to wait, 0 to just check
+*
+* @return ESP_OK if connected, ESP_ERR_TIMEOUT otherwise
+*/
+esp_err_t wifi_wait_connected(TickType_t wait);
+
+/*
+* @brief Connection statistics: attempts, fast and scan connects, drops,
+*        connect time percentiles and attempts per hour (see wifi_conn.h).
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void wifi_get_stats(wifi_conn_stats_t *stats);
+
 
 
 #endif
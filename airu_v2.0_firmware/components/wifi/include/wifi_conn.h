@@ -0,0 +1,245 @@
+/*
+*	wifi_conn.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Station connection policy.
+*
+*   A cold connect scans every channel for the SSID and then runs DHCP,
+*   which is most of the radio time of a duty cycle. After each connection
+*   the AP's BSSID and channel and the DHCP lease are cached (in RTC memory
+*   by internet_if.c, so the cache survives deep sleep), and the next
+*   attempt is a directed connect to that AP on that channel, reusing the
+*   address if the lease is younger than 'lease_s':
+*
+*     start --cache--> FAST --fails--> SCAN --fails--> WAIT --backoff--> FAST or SCAN
+*           --none--------------------^
+*
+*   A failed fast connect falls back to a scan straight away, keeping the
+*   cache unless the scan finds another AP; failed scans back off
+*   exponentially with jitter (backoff.h) rather than retrying on every
+*   disconnect, and the retry is fast again. A connection that drops after
+*   holding for 'stable_ms' is retried fast at once with the backoff
+*   started over; one that drops sooner is backed off from, so an AP that
+*   keeps dropping us is not hammered. An attempt that has neither an IP nor a disconnect after
+*   'attempt_ms' (DHCP that never answers, or a reused address that is
+*   taken) is aborted and backed off from, whichever kind it was, and the
+*   cached address is not reused again.
+*
+*   A reused address has no lease behind it, so once 'lease_s' has passed
+*   since the DHCP that gave it the policy asks for DHCP again.
+*
+*   As with pm_power.h the policy only decides; internet_if.c carries the
+*   actions out from the system event handler.
+*
+*   This file has no ESP-IDF dependencies so it can be built on a host;
+*   host/test/wifi_conn_check.c drives it through scripted events.
+*/
+
+#ifndef _WIFI_CONN_H
+#define _WIFI_CONN_H
+
+#include <stdint.h>
+#include "backoff.h"
+
+#define WIFI_CONN_NEVER         INT64_MAX
+#define WIFI_CONN_SAMPLES       32        // Connect times kept for the percentiles
+
+#define WIFI_CONN_ATTEMPT_MS    10000
+#define WIFI_CONN_RETRY_BASE_MS 2000
+#define WIFI_CONN_RETRY_MAX_MS  300000    // 5 min
+#define WIFI_CONN_STABLE_MS     60000
+#define WIFI_CONN_LEASE_S       1800      // Well inside the usual 1 h or longer lease
+
+
+/*
+* @brief Policy states
+*/
+typedef enum
+{
+  WIFI_CONN_IDLE = 0,       // Stopped
+  WIFI_CONN_FAST,           // Directed connect to the cached AP
+  WIFI_CONN_SCAN,           // Full scan and DHCP
+  WIFI_CONN_WAIT,           // Backing off
+  WIFI_CONN_UP,             // Connected with an IP
+  WIFI_CONN_NUM_STATES
+} wifi_conn_state_t;
+
+/*
+* @brief What the driver has to do
+*/
+typedef enum
+{
+  WIFI_CONN_NONE = 0,
+  WIFI_CONN_DO_FAST,        // Connect to the cache's BSSID and channel, static IP if 'use_ip'
+  WIFI_CONN_DO_SCAN,        // Connect with a scan and DHCP
+  WIFI_CONN_DO_DHCP,        // Connected on a reused address, start DHCP
+  WIFI_CONN_DO_ABORT        // Attempt timed out, disconnect; the policy is backing off
+} wifi_conn_action_t;
+
+/*
+* @brief Policy settings
+*/
+typedef struct
+{
+  uint32_t attempt_ms;      // Longest an attempt may take
+  uint32_t retry_base_ms;   // Backoff after the first failed scan...
+  uint32_t retry_max_ms;    // ...doubling up to this
+  uint32_t stable_ms;       // Connection time that resets the backoff
+  uint32_t lease_s;         // Age up to which a DHCP address is reused, 0 never
+} wifi_conn_config_t;
+
+#define WIFI_CONN_CONFIG_DEFAULT() {          \
+    .attempt_ms = WIFI_CONN_ATTEMPT_MS,       \
+    .retry_base_ms = WIFI_CONN_RETRY_BASE_MS, \
+    .retry_max_ms = WIFI_CONN_RETRY_MAX_MS,   \
+    .stable_ms = WIFI_CONN_STABLE_MS,         \
+    .lease_s = WIFI_CONN_LEASE_S              \
+}
+
+/*
+* @brief What is remembered of the last connection
+*/
+typedef struct
+{
+  uint8_t valid;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint32_t ip;              // Network byte order, 0 if none
+  uint32_t netmask;
+  uint32_t gw;
+  int64_t lease_utc_s;      // When DHCP gave 'ip'
+} wifi_conn_cache_t;
+
+/*
+* @brief Policy statistics
+*/
+typedef struct
+{
+  wifi_conn_state_t state;
+  uint32_t attempts;        // Connects started...
+  uint32_t fast_attempts;   // ...of them directed
+  uint32_t fast_ok;         // Connections made by a directed connect...
+  uint32_t scan_ok;         // ...and by a scan
+  uint32_t ip_reused;       // Connections on a cached address
+  uint32_t failures;        // Attempts that ended without an IP
+  uint32_t timeouts;        // ...of them after attempt_ms
+  uint32_t drops;           // Connections lost
+  uint32_t connect_p50_ms;  // Attempt start to IP over the last
+  uint32_t connect_p90_ms;  // WIFI_CONN_SAMPLES connections
+  uint32_t connect_max_ms;
+  uint32_t attempts_per_h;  // Since wifi_conn_init()
+} wifi_conn_stats_t;
+
+/*
+* @brief Policy state
+*/
+typedef struct
+{
+  wifi_conn_config_t config;
+  wifi_conn_cache_t *cache; // Owned by the caller
+  wifi_conn_state_t state;
+  uint8_t use_ip;           // The current fast attempt reuses the cached address
+  uint8_t static_ip;        // Connected on a reused address
+  int64_t init_us;
+  int64_t attempt_us;       // Start of the current attempt
+  int64_t up_us;            // When the connection came up
+  int64_t next_us;          // Attempt deadline or end of the backoff
+  backoff_t backoff;
+  uint32_t samples[WIFI_CONN_SAMPLES];
+  uint32_t num_samples;
+  wifi_conn_stats_t stats;
+} wifi_conn_t;
+
+
+/*
+* @brief Sets the policy up, stopped.
+*
+* @param conn   - state
+* @param config - settings
+* @param cache  - last connection, kept up to date by the policy
+* @param now_us - current time
+*
+* @return void
+*/
+void wifi_conn_init(wifi_conn_t *conn, const wifi_conn_config_t *config, wifi_conn_cache_t *cache,
+                    int64_t now_us);
+
+/*
+* @brief The station started: first attempt.
+*
+* @param conn    - state
+* @param now_us  - current time
+* @param utc_s   - wall clock, for the lease age; 0 if not known
+*
+* @return WIFI_CONN_DO_FAST or WIFI_CONN_DO_SCAN
+*/
+wifi_conn_action_t wifi_conn_start(wifi_conn_t *conn, int64_t now_us, int64_t utc_s);
+
+/*
+* @brief The station stopped; nothing more is attempted.
+*/
+void wifi_conn_stop(wifi_conn_t *conn);
+
+/*
+* @brief Associated with an AP. Its BSSID and channel go into the cache.
+*/
+void wifi_conn_associated(wifi_conn_t *conn, const uint8_t *bssid, uint8_t channel);
+
+/*
+* @brief Got an IP.
+*
+* @param conn    - state
+* @param now_us  - current time
+* @param utc_s   - wall clock, 0 if not known
+* @param ip      - address, netmask and gateway, network byte order
+* @param netmask
+* @param gw
+*
+* @return void
+*/
+void wifi_conn_up(wifi_conn_t *conn, int64_t now_us, int64_t utc_s, uint32_t ip, uint32_t netmask,
+                  uint32_t gw);
+
+/*
+* @brief Disconnected, or an attempt failed.
+*
+* @param conn   - state
+* @param now_us - current time
+* @param utc_s  - wall clock, 0 if not known
+* @param random - any random 32 bit value, for the backoff jitter
+*
+* @return the next attempt if it starts now, else WIFI_CONN_NONE
+*/
+wifi_conn_action_t wifi_conn_down(wifi_conn_t *conn, int64_t now_us, int64_t utc_s, uint32_t random);
+
+/*
+* @brief Times attempts out, ends the backoff and renews reused addresses.
+*        Call whenever wifi_conn_next() comes due.
+*
+* @param conn   - state
+* @param now_us - current time
+* @param utc_s  - wall clock, 0 if not known
+* @param random - any random 32 bit value, for the backoff jitter
+*
+* @return the action due, or WIFI_CONN_NONE
+*/
+wifi_conn_action_t wifi_conn_step(wifi_conn_t *conn, int64_t now_us, int64_t utc_s, uint32_t random);
+
+/*
+* @brief Time wifi_conn_step() next has something to do.
+*
+* @return time in us, or WIFI_CONN_NEVER
+*/
+int64_t wifi_conn_next(const wifi_conn_t *conn);
+
+/*
+* @brief Statistics, with the percentiles and rates worked out.
+*/
+void wifi_conn_get_stats(const wifi_conn_t *conn, int64_t now_us, wifi_conn_stats_t *stats);
+
+#endif
@@ -1,7 +1,7 @@
 /*
 * internet_if.c
 * 
-* Last Modified: August 1, 2018
+* Last Modified: October 17, 2026
 *  Author: Trenton Taylor
 *
 */
@@ -9,10 +9,18 @@
 #include "internet_if.h"
 
 #include <string.h>
+#include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_wifi.h"
 #include "esp_event_loop.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "timesync.h"
+#include "wifi_conn.h"
+#include "settings.h"
 
 //#include "lwip/err.h"
 //#include "lwip/sys.h"
@@ -29,6 +37,22 @@ static EventGroupHandle_t wifi_event_group;
    to the AP with an IP? */
 const int WIFI_CONNECTED_BIT = BIT0;
 
+/* Function prototypes */
+static void wifi_setup();
+static void conn_do(wifi_conn_action_t action);
+static void conn_arm(int64_t now_us);
+static void conn_timer_cb(void *arg);
+static int64_t utc_s(int64_t now_us);
+
+/* Global variables */
+static wifi_config_t sta_config;                      // From settings, under conn_lock
+static const wifi_conn_config_t conn_config = WIFI_CONN_CONFIG_DEFAULT();
+static RTC_DATA_ATTR wifi_conn_cache_t conn_cache;    // Survives deep sleep
+static wifi_conn_t conn;                              // Under conn_lock
+static SemaphoreHandle_t conn_lock;
+static esp_timer_handle_t conn_timer;
+static volatile int sta_running;
+
 
 
 
@@ -41,17 +65,32 @@ const int WIFI_CONNECTED_BIT = BIT0;
 */
 static esp_err_t event_handler(void *ctx, system_event_t *event)
 {
+  int64_t now = esp_timer_get_time();
+  tcpip_adapter_ip_info_t *ip_info;
+  int restart_sta = 0;
+
+  xSemaphoreTake(conn_lock, portMAX_DELAY);
   switch(event->event_id) 
   {
     case SYSTEM_EVENT_STA_START:
-      esp_wifi_connect();
+      conn_do(wifi_conn_start(&conn, now, utc_s(now)));
+      break;
+
+    case SYSTEM_EVENT_STA_STOP:
+      wifi_conn_stop(&conn);
+      break;
+
+    case SYSTEM_EVENT_STA_CONNECTED:
+      wifi_conn_associated(&conn, event->event_info.connected.bssid, event->event_info.connected.channel);
       break;
 
     case SYSTEM_EVENT_STA_GOT_IP:
-      ESP_LOGI(TAG, "got ip:%s",
-               ip4addr_ntoa(&event->event_info.got_ip.ip_info.ip));
+      ip_info = &event->event_info.got_ip.ip_info;
+      ESP_LOGI(TAG, "got ip:%s", ip4addr_ntoa(&ip_info->ip));
+      wifi_conn_up(&conn, now, utc_s(now), ip_info->ip.addr, ip_info->netmask.addr, ip_info->gw.addr);
       xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
       strcpy(ip_address, &event->event_info.got_ip.ip_info.ip);
+      timesync_sntp_start();
       break;
 
     case SYSTEM_EVENT_AP_STACONNECTED:
@@ -67,20 +106,27 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
       break;
 
     case SYSTEM_EVENT_STA_DISCONNECTED:
-      esp_wifi_connect();
+      // No reconnect storm: the policy retries fast once, then backs off.
       xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+      if(sta_running)
+        conn_do(wifi_conn_down(&conn, now, utc_s(now), esp_random()));
       break;
 
     case SYSTEM_EVENT_AP_STOP:
       ESP_LOGI(TAG, "AP mode stopped.");
       xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
-      wifi_init_sta();
+      restart_sta = 1;
       break;
 
     default:
         break;
 
     }//switch
+    xSemaphoreGive(conn_lock);
+
+    // wifi_init_sta() takes conn_lock itself.
+    if(restart_sta)
+      wifi_init_sta();
 
     return ESP_OK;
 }
@@ -95,22 +141,23 @@ static esp_err_t event_handler(void *ctx, system_event_t *event)
 */
 void wifi_init_sta()
 {
-  wifi_config_t wifi_config = 
-  {
-      .sta = 
-      {
-          .ssid = "airu",
-          .password = "cleantheair"
-      },
-  };
+    settings_t settings;
+
+    // Credentials as stored now, so provisioning takes effect at the next connect.
+    settings_get(&settings);
+    xSemaphoreTake(conn_lock, portMAX_DELAY);
+    memset(&sta_config, 0, sizeof(sta_config));
+    memcpy(sta_config.sta.ssid, settings.ssid, sizeof(sta_config.sta.ssid));
+    memcpy(sta_config.sta.password, settings.password, sizeof(sta_config.sta.password));
+    xSemaphoreGive(conn_lock);
 
+    sta_running = 1;
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA) );
-    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_config) );
+    ESP_ERROR_CHECK(esp_wifi_set_config(ESP_IF_WIFI_STA, &sta_config) );
     ESP_ERROR_CHECK(esp_wifi_start() );
 
     ESP_LOGI(TAG, "wifi_init_sta finished.");
-    ESP_LOGI(TAG, "connect to ap SSID:%s password:%s",
-             "airu", "cleantheair");
+    ESP_LOGI(TAG, "connect to ap SSID:%s", settings.ssid);
 }
 
 
@@ -121,15 +168,52 @@ void wifi_init_sta()
 *
 * @return
 */
-void wifi_init_softap()
+void wifi_start_sta()
+{
+  wifi_setup();
+  wifi_init_sta();
+}
+
+
+/*
+* @brief Restarts the station on the stored credentials. See internet_if.h.
+*/
+void wifi_reconnect()
 {
-    wifi_event_group = xEventGroupCreate();
+  settings_t settings;
 
-    tcpip_adapter_init();
-    ESP_ERROR_CHECK(esp_event_loop_init(event_handler, NULL));
+  if(wifi_event_group == NULL)
+  {
+    wifi_start_sta();
+    return;
+  }
+
+  // Stopped first, so the disconnect the stop posts is not taken for a
+  // failed attempt with the new credentials.
+  settings_get(&settings);
+  xSemaphoreTake(conn_lock, portMAX_DELAY);
+  wifi_conn_stop(&conn);
+  if(strncmp((const char *) sta_config.sta.ssid, settings.ssid, sizeof(sta_config.sta.ssid)) != 0)
+    memset(&conn_cache, 0, sizeof(conn_cache));
+  xSemaphoreGive(conn_lock);
+
+  wifi_stop();
+  xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+  wifi_init_sta();
+}
+
+
+/*
+* @brief
+*
+* @param
+*
+* @return
+*/
+void wifi_init_softap()
+{
+    wifi_setup();
 
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
     wifi_config_t wifi_config = 
     {
         .ap = 
@@ -156,6 +240,33 @@ void wifi_init_softap()
 }
 
 
+/*
+* @brief One-time setup shared by the station and the AP: the event group,
+*        conn_lock, the connection policy and its timer, the event loop and
+*        the WiFi driver. Does nothing after the first call.
+*
+* @return void
+*/
+static void wifi_setup()
+{
+  const esp_timer_create_args_t timer_args = { .callback = conn_timer_cb, .name = "wifi_conn" };
+
+  if(wifi_event_group != NULL)
+    return;
+
+  wifi_event_group = xEventGroupCreate();
+  conn_lock = xSemaphoreCreateMutex();
+  wifi_conn_init(&conn, &conn_config, &conn_cache, esp_timer_get_time());
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &conn_timer));
+
+  tcpip_adapter_init();
+  ESP_ERROR_CHECK(esp_event_loop_init(event_handler, NULL));
+
+  wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+  ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+}
+
+
 /*
 * @brief
 *
@@ -165,10 +276,167 @@ void wifi_init_softap()
 */
 void wifi_stop()
 {
+  sta_running = 0;
+  if(conn_timer != NULL)
+    esp_timer_stop(conn_timer);
   esp_wifi_stop();
 }
 
 
+/*
+* @brief
+*
+* @param
+*
+* @return
+*/
+esp_err_t wifi_wait_connected(TickType_t wait)
+{
+  EventBits_t bits;
+
+  if(wifi_event_group == NULL)
+  {
+    if(wait > 0)
+      vTaskDelay(wait);
+    return ESP_ERR_TIMEOUT;
+  }
+
+  bits = xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE, wait);
+  if((bits & WIFI_CONNECTED_BIT) == 0)
+    return ESP_ERR_TIMEOUT;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the connection statistics out.
+*
+* @param stats - filled in with the statistics
+*
+* @return void
+*/
+void wifi_get_stats(wifi_conn_stats_t *stats)
+{
+  if(wifi_event_group == NULL)
+  {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+
+  xSemaphoreTake(conn_lock, portMAX_DELAY);
+  wifi_conn_get_stats(&conn, esp_timer_get_time(), stats);
+  xSemaphoreGive(conn_lock);
+}
+
+
+/*
+* @brief Carries out a policy action and sets the timer for its next step.
+*        Called with conn_lock held.
+*
+* @param action - from the policy
+*
+* @return void
+*/
+static void conn_do(wifi_conn_action_t action)
+{
+  tcpip_adapter_ip_info_t ip_info;
+
+  switch(action)
+  {
+    case WIFI_CONN_DO_FAST:
+      ESP_LOGI(TAG, "fast connect to "MACSTR" on channel %u%s", MAC2STR(conn_cache.bssid),
+               conn_cache.channel, conn.use_ip ? " with the cached address" : "");
+      sta_config.sta.bssid_set = 1;
+      memcpy(sta_config.sta.bssid, conn_cache.bssid, sizeof(sta_config.sta.bssid));
+      sta_config.sta.channel = conn_cache.channel;
+      esp_wifi_set_config(ESP_IF_WIFI_STA, &sta_config);
+      if(conn.use_ip)
+      {
+        ip_info.ip.addr = conn_cache.ip;
+        ip_info.netmask.addr = conn_cache.netmask;
+        ip_info.gw.addr = conn_cache.gw;
+        tcpip_adapter_dhcpc_stop(TCPIP_ADAPTER_IF_STA);
+        tcpip_adapter_set_ip_info(TCPIP_ADAPTER_IF_STA, &ip_info);
+      }
+      else
+      {
+        tcpip_adapter_dhcpc_start(TCPIP_ADAPTER_IF_STA);
+      }
+      esp_wifi_connect();
+      break;
+
+    case WIFI_CONN_DO_SCAN:
+      ESP_LOGI(TAG, "connecting with a scan");
+      sta_config.sta.bssid_set = 0;
+      sta_config.sta.channel = 0;
+      esp_wifi_set_config(ESP_IF_WIFI_STA, &sta_config);
+      tcpip_adapter_dhcpc_start(TCPIP_ADAPTER_IF_STA);
+      esp_wifi_connect();
+      break;
+
+    case WIFI_CONN_DO_DHCP:
+      tcpip_adapter_dhcpc_start(TCPIP_ADAPTER_IF_STA);
+      break;
+
+    case WIFI_CONN_DO_ABORT:
+      ESP_LOGW(TAG, "no IP after %u ms, retrying in %lld ms", conn_config.attempt_ms,
+               (wifi_conn_next(&conn) - esp_timer_get_time()) / 1000);
+      esp_wifi_disconnect();
+      break;
+
+    default:
+      if(conn.state == WIFI_CONN_WAIT)
+        ESP_LOGI(TAG, "retrying in %lld ms", (wifi_conn_next(&conn) - esp_timer_get_time()) / 1000);
+      break;
+  }
+
+  conn_arm(esp_timer_get_time());
+}
+
+
+/*
+* @brief Sets the timer for the policy's next step.
+*
+* @param now_us - current time
+*
+* @return void
+*/
+static void conn_arm(int64_t now_us)
+{
+  int64_t next_us = wifi_conn_next(&conn);
 
+  esp_timer_stop(conn_timer);
+  if(next_us == WIFI_CONN_NEVER)
+    return;
 
+  esp_timer_start_once(conn_timer, (next_us > now_us) ? next_us - now_us : 1);
+}
 
+
+/*
+* @brief An attempt timed out, a backoff ended or a reused address is due
+*        for DHCP.
+*
+* @param arg - not used
+*
+* @return void
+*/
+static void conn_timer_cb(void *arg)
+{
+  int64_t now = esp_timer_get_time();
+
+  xSemaphoreTake(conn_lock, portMAX_DELAY);
+  if(sta_running)
+    conn_do(wifi_conn_step(&conn, now, utc_s(now), esp_random()));
+  xSemaphoreGive(conn_lock);
+}
+
+
+/*
+* @brief Wall clock in seconds for the lease age, 0 if not known.
+*/
+static int64_t utc_s(int64_t now_us)
+{
+  return timesync_utc(now_us) / 1000000;
+}
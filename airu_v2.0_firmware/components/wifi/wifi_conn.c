@@ -0,0 +1,292 @@
+/*
+*	wifi_conn.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#include <string.h>
+#include "wifi_conn.h"
+
+
+/* Function prototypes */
+static wifi_conn_action_t attempt(wifi_conn_t *conn, int64_t now_us, int64_t utc_s);
+static wifi_conn_action_t scan(wifi_conn_t *conn, int64_t now_us);
+static wifi_conn_action_t retry_later(wifi_conn_t *conn, int64_t now_us, uint32_t random);
+static uint32_t lease_age_s(const wifi_conn_t *conn, int64_t utc_s);
+
+
+
+/*
+* @brief Sets the policy up. See wifi_conn.h.
+*/
+void wifi_conn_init(wifi_conn_t *conn, const wifi_conn_config_t *config, wifi_conn_cache_t *cache,
+                    int64_t now_us)
+{
+  memset(conn, 0, sizeof(*conn));
+  conn->config = *config;
+  conn->cache = cache;
+  conn->init_us = now_us;
+  conn->next_us = WIFI_CONN_NEVER;
+  backoff_init(&conn->backoff, config->retry_base_ms, config->retry_max_ms);
+}
+
+
+/*
+* @brief First attempt. See wifi_conn.h.
+*/
+wifi_conn_action_t wifi_conn_start(wifi_conn_t *conn, int64_t now_us, int64_t utc_s)
+{
+  backoff_reset(&conn->backoff);
+  return attempt(conn, now_us, utc_s);
+}
+
+
+/*
+* @brief Stops. See wifi_conn.h.
+*/
+void wifi_conn_stop(wifi_conn_t *conn)
+{
+  conn->state = WIFI_CONN_IDLE;
+  conn->static_ip = 0;
+  conn->next_us = WIFI_CONN_NEVER;
+}
+
+
+/*
+* @brief Notes the AP. See wifi_conn.h.
+*/
+void wifi_conn_associated(wifi_conn_t *conn, const uint8_t *bssid, uint8_t channel)
+{
+  // A different AP of the same network leaves the cached address to DHCP.
+  if(memcmp(conn->cache->bssid, bssid, sizeof(conn->cache->bssid)) != 0)
+    conn->cache->ip = 0;
+
+  memcpy(conn->cache->bssid, bssid, sizeof(conn->cache->bssid));
+  conn->cache->channel = channel;
+}
+
+
+/*
+* @brief Connected. See wifi_conn.h.
+*/
+void wifi_conn_up(wifi_conn_t *conn, int64_t now_us, int64_t utc_s, uint32_t ip, uint32_t netmask,
+                  uint32_t gw)
+{
+  wifi_conn_cache_t *cache = conn->cache;
+  uint32_t ms;
+
+  if(conn->state == WIFI_CONN_IDLE || conn->state == WIFI_CONN_WAIT)
+    return;
+
+  if(conn->state != WIFI_CONN_UP)
+  {
+    ms = (uint32_t) ((now_us - conn->attempt_us) / 1000);
+    conn->samples[conn->num_samples++ % WIFI_CONN_SAMPLES] = ms;
+    if(conn->state == WIFI_CONN_FAST)
+      conn->stats.fast_ok++;
+    else
+      conn->stats.scan_ok++;
+
+    conn->state = WIFI_CONN_UP;
+    conn->up_us = now_us;
+    conn->static_ip = conn->use_ip;
+  }
+  else
+  {
+    // DHCP after a reused address
+    conn->static_ip = 0;
+  }
+
+  cache->valid = 1;
+  if(conn->static_ip)
+  {
+    conn->stats.ip_reused++;
+    conn->next_us = now_us + ((int64_t) conn->config.lease_s - lease_age_s(conn, utc_s)) * 1000000;
+    return;
+  }
+
+  cache->ip = ip;
+  cache->netmask = netmask;
+  cache->gw = gw;
+  cache->lease_utc_s = utc_s;
+  conn->next_us = WIFI_CONN_NEVER;
+}
+
+
+/*
+* @brief Disconnected. See wifi_conn.h.
+*/
+wifi_conn_action_t wifi_conn_down(wifi_conn_t *conn, int64_t now_us, int64_t utc_s, uint32_t random)
+{
+  switch(conn->state)
+  {
+    case WIFI_CONN_UP:
+      conn->stats.drops++;
+      conn->static_ip = 0;
+      if(now_us - conn->up_us < (int64_t) conn->config.stable_ms * 1000)
+        return retry_later(conn, now_us, random);
+      backoff_reset(&conn->backoff);
+      return attempt(conn, now_us, utc_s);
+
+    case WIFI_CONN_FAST:
+      // Gone, or moved to another channel: look for the network. The cache
+      // stays for the next attempt unless the scan finds another AP.
+      conn->stats.failures++;
+      return scan(conn, now_us);
+
+    case WIFI_CONN_SCAN:
+      conn->stats.failures++;
+      return retry_later(conn, now_us, random);
+
+    default:
+      // Stopped, or what is left of an aborted attempt.
+      return WIFI_CONN_NONE;
+  }
+}
+
+
+/*
+* @brief Timed steps. See wifi_conn.h.
+*/
+wifi_conn_action_t wifi_conn_step(wifi_conn_t *conn, int64_t now_us, int64_t utc_s, uint32_t random)
+{
+  if(now_us < conn->next_us)
+    return WIFI_CONN_NONE;
+
+  switch(conn->state)
+  {
+    case WIFI_CONN_FAST:
+    case WIFI_CONN_SCAN:
+      conn->stats.failures++;
+      conn->stats.timeouts++;
+      // Associated but no IP: the cached address may be taken.
+      if(conn->use_ip)
+        conn->cache->ip = 0;
+      retry_later(conn, now_us, random);
+      return WIFI_CONN_DO_ABORT;
+
+    case WIFI_CONN_WAIT:
+      return attempt(conn, now_us, utc_s);
+
+    case WIFI_CONN_UP:
+      conn->static_ip = 0;
+      conn->next_us = WIFI_CONN_NEVER;
+      return WIFI_CONN_DO_DHCP;
+
+    default:
+      conn->next_us = WIFI_CONN_NEVER;
+      return WIFI_CONN_NONE;
+  }
+}
+
+
+/*
+* @brief Next step. See wifi_conn.h.
+*/
+int64_t wifi_conn_next(const wifi_conn_t *conn)
+{
+  return conn->next_us;
+}
+
+
+/*
+* @brief Copies the statistics. See wifi_conn.h.
+*/
+void wifi_conn_get_stats(const wifi_conn_t *conn, int64_t now_us, wifi_conn_stats_t *stats)
+{
+  uint32_t sorted[WIFI_CONN_SAMPLES];
+  uint32_t n = conn->num_samples;
+  uint32_t v;
+  uint32_t i;
+  uint32_t j;
+
+  *stats = conn->stats;
+  stats->state = conn->state;
+
+  if(n > WIFI_CONN_SAMPLES)
+    n = WIFI_CONN_SAMPLES;
+  memcpy(sorted, conn->samples, n * sizeof(sorted[0]));
+  for(i = 1; i < n; i++)
+  {
+    v = sorted[i];
+    for(j = i; j > 0 && sorted[j - 1] > v; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = v;
+  }
+  if(n > 0)
+  {
+    stats->connect_p50_ms = sorted[n / 2];
+    stats->connect_p90_ms = sorted[(n * 9) / 10];
+    stats->connect_max_ms = sorted[n - 1];
+  }
+
+  if(now_us > conn->init_us)
+    stats->attempts_per_h = (uint32_t) ((uint64_t) conn->stats.attempts * 3600000000ULL /
+                                        (uint64_t) (now_us - conn->init_us));
+}
+
+
+/*
+* @brief Starts an attempt: directed if the cache has an AP, reusing its
+*        address if the lease is young enough.
+*/
+static wifi_conn_action_t attempt(wifi_conn_t *conn, int64_t now_us, int64_t utc_s)
+{
+  wifi_conn_cache_t *cache = conn->cache;
+
+  if(!cache->valid)
+    return scan(conn, now_us);
+
+  conn->attempt_us = now_us;
+  conn->next_us = now_us + (int64_t) conn->config.attempt_ms * 1000;
+  conn->stats.attempts++;
+  conn->stats.fast_attempts++;
+  conn->state = WIFI_CONN_FAST;
+  conn->use_ip = (cache->ip != 0 && lease_age_s(conn, utc_s) < conn->config.lease_s);
+  return WIFI_CONN_DO_FAST;
+}
+
+
+/*
+* @brief Starts an attempt with a scan and DHCP.
+*/
+static wifi_conn_action_t scan(wifi_conn_t *conn, int64_t now_us)
+{
+  conn->attempt_us = now_us;
+  conn->next_us = now_us + (int64_t) conn->config.attempt_ms * 1000;
+  conn->stats.attempts++;
+  conn->state = WIFI_CONN_SCAN;
+  conn->use_ip = 0;
+  return WIFI_CONN_DO_SCAN;
+}
+
+
+/*
+* @brief Backs off before the next attempt.
+*
+* @return WIFI_CONN_NONE
+*/
+static wifi_conn_action_t retry_later(wifi_conn_t *conn, int64_t now_us, uint32_t random)
+{
+  conn->state = WIFI_CONN_WAIT;
+  conn->next_us = now_us + (int64_t) backoff_fail(&conn->backoff, random) * 1000;
+
+  return WIFI_CONN_NONE;
+}
+
+
+/*
+* @brief Age of the cached lease, or UINT32_MAX if it or the time is not
+*        known.
+*/
+static uint32_t lease_age_s(const wifi_conn_t *conn, int64_t utc_s)
+{
+  int64_t age = utc_s - conn->cache->lease_utc_s;
+
+  if(utc_s <= 0 || conn->cache->lease_utc_s <= 0 || age < 0 || age >= UINT32_MAX)
+    return UINT32_MAX;
+
+  return (uint32_t) age;
+}
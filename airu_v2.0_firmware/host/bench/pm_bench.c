@@ -0,0 +1,2691 @@
+/*
+*	pm_bench.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   PMS3003 pipeline benchmark. Every scenario is a byte stream, synthetic
+*   (clean, noise, dropped, split, corrupt) or a recorded capture (-c), run
+*   through two benches:
+*
+*   frame  - framing, checksum, decode and the sample ring in a tight loop
+*            on one thread: frames/s and cycles per frame (TSC cycles on
+*            x86, 0 elsewhere).
+*   decode - the frames of the clean stream through pm_frame_decode() and
+*            through the decoder pm_if had before it ("legacy"): frames/s
+*            and cycles per frame of the decode alone.
+*   replay - the real pm_if driver on the host simulation, fed one burst a
+*            second through the UART stand-in at 'rate' times real time:
+*            frames decoded, host ns per frame in read_frames(), latency
+*            from the UART event to the sample reaching a sink, and peak
+*            vSensor_task stack and heap. Each of the PM_NUM_CHANNELS
+*            channels gets the same stream and the counts are summed, so
+*            a build with more channels shows what the one sensor task
+*            costs per extra sensor. Each run is a fresh process since the
+*            driver can only be set up once.
+*   recover - fault injection into pm_health.h on a simulated clock: a
+*            sensor sending a frame a second develops a fault a minute in
+*            that only a given recovery step clears (see bench_faults).
+*            Time from the fault to the first recovery step, to good
+*            frames again, and the steps taken. Exact, not timed.
+*            Then the real pm_if driver on the host simulation with the
+*            PMS model on channel 0 wired as PM_CHANNELS has it (the
+*            default board: SET and RESET on GPIOs, no TX), fan on all the
+*            time, for each model fault that only a power cycle clears
+*            (see bench_board_faults): recoveries, recovery steps entered
+*            and time from detection to good frames. A fresh process per
+*            fault, like replay.
+*   settings - the settings store (settings.h) with its NVS on an image
+*            file: ns per settings_get() from the RAM copy and per
+*            settings_decode() of a slot as at boot, and BENCH_COMMITS
+*            commits through the image's write, fsync and rename, with
+*            the commit number read back from the image afterwards.
+*   ble    - the BLE data service (ble_data.h) on the host simulation: a
+*            day of samples from a PM sensor and an HDC1080 (one a second
+*            each) goes into the history, then a phone offering each of
+*            bench_mtus subscribes and takes it over the simulated link.
+*            Records received against records in the history, blocks that
+*            did not decode, time from subscribing to the end of the
+*            history and kB/s. Simulated time, so the numbers only move
+*            when the service or the link model does. A fresh process per
+*            MTU, like replay.
+*   record - a day of PM samples, one a second, packed into uplink batches
+*            (uplink_batch.h, record.h) and decoded again: bytes per
+*            sample including every header and CRC, against the text the
+*            PM driver used to printf for each frame; ns per sample to
+*            encode and decode; and samples that didn't come back as they
+*            went in.
+*   sdlog  - the same day through the SD backlog (sdlog.h) on a RAM card,
+*            appended and flushed as the uplink spills batches and read
+*            back and acknowledged as it replays them: card bytes and
+*            write calls per day, ns per sample each way, and samples that
+*            didn't come back. Power loss is host/test/sdlog_powerloss.c.
+*   listen - the PM driver on the host simulation with light sleep on
+*            (power_init()): the chip counts as asleep whenever no power
+*            lock is held, and UART bytes that arrive then are lost. The
+*            PMS model on channel 0, fan on, for BENCH_LISTEN_S: frames
+*            the model sent and the driver decoded, listen misses, bytes
+*            lost asleep, and the share of the time the listen lock kept
+*            the chip awake. Every frame has to come through.
+*   trace  - the deferred trace (trace.h): ns per trace_ring_put() into a
+*            ring nobody reads, per entry copied out by trace_ring_drain()
+*            in vTrace_task's batches, and per trace_format() of the
+*            entries as vTrace_task and host/trace_decode.c expand them.
+*            The concurrent case is host/test/trace_stress.c.
+*   timesync - the time servo (timesync.h) in timesync_sim(): an hour of
+*            one measurement a second from an esp_timer with a wandering
+*            rate error, for each of bench_timesyncs. The largest and rms
+*            error of the servo's UTC after it settled, the second it
+*            locked to 1 ms, the spikes put in against those the servo
+*            rejected, and clock steps. Exact, not timed.
+*   nmea   - the GPS parser (nmea.h) on an 8 MB capture from make_nmea(),
+*            a few hours of what the L70 sends with the position wandering
+*            and one sentence in BENCH_NMEA_BAD corrupted, fed in UART
+*            FIFO sized chunks: sentences parsed and checksum errors
+*            against those generated, RMCs whose fix didn't match what
+*            was generated, sentences/s, and the 99th percentile and worst
+*            host ns a sentence took from its first byte to nmea_next()
+*            returning it. Each sentence's time is its best of
+*            BENCH_RECORD_REPS passes, so the worst case is the parser's
+*            and not a host interrupt's.
+*   mics   - the MiCS-4514 filter and calibration (mics.h) on
+*            BENCH_MICS_CODES noisy 12 bit codes: conversions/s through
+*            mics_boxcar_add() with mics_cal_apply() on each output, as the
+*            driver takes them, and ns per mics_cal_apply() over every
+*            16 bit code. Accuracy is host/test/mics_check.c.
+*   duty   - the deep sleep duty cycle (duty.h) in duty_sim(): a day of
+*            one minute cycles with the default current model, for each of
+*            bench_duties. Per cycle energy and average current, awake
+*            time per cycle, and the oldest record an uplink sent, which
+*            is the latency of a reading; records sent against cycles, and
+*            records overwritten before they were sent. Exact, not timed.
+*
+*   Results go to stdout as JSON Lines. With -b the results are compared to
+*   a baseline from an earlier run and the exit status is 1 if any metric
+*   got worse by more than its tolerance (see bench_metrics). Frame counts
+*   are exact; the timing tolerances are wide enough for a shared 1 vCPU
+*   host, where the same pass varies by half between runs; -t below 1
+*   tightens them on a quiet machine.
+*
+*   Usage: pm_bench [options]
+*     -n FRAMES     frames per synthetic stream (200)
+*     -r RATES      comma separated replay rates (100); past a few hundred
+*                   the host's own scheduling starts to show up as UART drops
+*     -c FILE       add a recorded capture, played 24 bytes a second
+*     -s NAMES      comma separated scenarios to run, "decode" for the decode
+*                   bench, "recover" for the recover bench, "settings" for
+*                   the settings bench, "ble" for the BLE bench, "record"
+*                   for the record bench, "sdlog" for the SD backlog bench,
+*                   "listen" for the listen window bench, "trace" for the
+*                   trace bench, "timesync" for the time servo bench, "nmea"
+*                   for the GPS parser bench, "mics" for the MiCS filter
+*                   bench, "duty" for the duty cycle bench (all)
+*     -b FILE       baseline to compare against
+*     -t FACTOR     multiply every tolerance (1)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "pm_if.h"
+#include "sensor.h"
+#include "settings.h"
+#include "ble_data.h"
+#include "uplink_batch.h"
+#include "uplink.h"
+#include "sdlog.h"
+#include "power.h"
+#include "trace.h"
+#include "timesync.h"
+#include "nmea.h"
+#include "mics.h"
+#include "duty.h"
+#include "nvs.h"
+#include "sim.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()      __rdtsc()
+#else
+#define BENCH_CYCLES()      0
+#endif
+
+#define BENCH_MAX_SCENARIOS 16
+#define BENCH_MAX_RATES     8
+#define BENCH_MAX_FRAMES    4096
+#define BENCH_MAX_RESULTS   (BENCH_MAX_SCENARIOS * (BENCH_MAX_RATES + 1) + 2 + 16)
+#define BENCH_REPS          20            // Frame bench timed runs...
+#define BENCH_REP_NS        10000000      // ...of at least this long each
+#define BENCH_PERIOD_MS     1000          // PMS3003 sends about one frame a second
+#define BENCH_TAIL_MS       3000          // Replay runs on this long after the last burst
+#define BENCH_KEY_LEN       80
+#define BENCH_TICK_MS       10            // Recover bench clock step...
+#define BENCH_FAULT_S       60            // ...fault starts...
+#define BENCH_RECOVER_S     1200          // ...and the run ends
+#define BENCH_BOARD_RATE    100           // Board recover bench clock speed-up
+#define BENCH_COMMITS       50            // Settings bench commits
+#define BENCH_BLE_SCALE     5             // BLE bench clock speed-up...
+#define BENCH_BLE_HISTORY_S 86400         // ...history it fills...
+#define BENCH_BLE_WAIT_S    60            // ...and how long the phone gets for it
+#define BENCH_RECORD_SAMPLES 86400        // Record bench: a day at one a second
+#define BENCH_RECORD_REPS   5
+#define BENCH_SDLOG_SECTORS 4096          // SD bench ring, enough for the day without wrapping
+#define BENCH_LISTEN_RATE   10            // Listen bench clock speed-up...
+#define BENCH_LISTEN_S      300           // ...and run
+#define BENCH_TRACE_ENTRIES 1000000       // Trace bench entries per pass
+#define BENCH_TRACE_BATCH   16            // vTrace_task's drain batch
+#define BENCH_TIMESYNC_S    3600          // Time servo bench run
+#define BENCH_TIMESYNC_SETTLE_S 300       // ...of which the error figures leave out
+#define BENCH_NMEA_BYTES    (8 << 20)     // NMEA bench capture...
+#define BENCH_NMEA_CHUNK    120           // ...read as the UART hands it over at FIFO full
+#define BENCH_NMEA_BAD      1000          // One sentence in this many has a bad checksum
+#define BENCH_MICS_CODES    (1 << 22)     // MiCS bench conversions per pass
+#define BENCH_DUTY_CYCLES   1440          // Duty bench: a day of one minute cycles
+
+
+/*
+* @brief Metrics, in the order they are printed
+*/
+typedef enum
+{
+  M_FRAMES,
+  M_EXPECTED,
+  M_CHECKSUM_ERRS,
+  M_BYTES_SKIPPED,
+  M_FRAMES_PER_S,
+  M_CYCLES_PER_FRAME,
+  M_UART_DROPPED,
+  M_READ_NS_PER_FRAME,
+  M_LAT_P50_US,
+  M_LAT_P99_US,
+  M_LAT_MAX_US,
+  M_STACK_PEAK,
+  M_HEAP_PEAK,
+  M_DETECT_MS,
+  M_RECOVER_MS,
+  M_STEPS,
+  M_RECOVERIES,
+  M_RECOVER_S,
+  M_NS_PER_OP,
+  M_COMMITS,
+  M_SEQ,
+  M_COMMIT_P50_US,
+  M_COMMIT_MAX_US,
+  M_RECORDS,
+  M_BAD_BLOCKS,
+  M_HISTORY_H,
+  M_NOTIFICATIONS,
+  M_RESENDS,
+  M_BACKLOG_MS,
+  M_KBYTES_PER_S,
+  M_BYTES_PER_SAMPLE,
+  M_TEXT_BYTES,
+  M_ENCODE_NS,
+  M_DECODE_NS,
+  M_MISMATCHES,
+  M_CARD_WRITES,
+  M_APPEND_NS,
+  M_REPLAY_NS,
+  M_LOST,
+  M_LISTEN_MISSES,
+  M_BYTES_ASLEEP,
+  M_AWAKE_PCT,
+  M_PUT_NS,
+  M_DRAIN_NS,
+  M_FORMAT_NS,
+  M_LOCK_S,
+  M_MAX_ERR_US,
+  M_RMS_ERR_US,
+  M_FREQ_ERR_PPB,
+  M_SPIKES,
+  M_SPIKES_REJECTED,
+  M_CLOCK_STEPS,
+  M_SENTENCES,
+  M_MBYTES,
+  M_SENTENCES_PER_S,
+  M_SENTENCE_P99_NS,
+  M_SENTENCE_MAX_NS,
+  M_SAMPLES_PER_S,
+  M_CAL_NS,
+  M_ENERGY_UJ,
+  M_AVG_UA,
+  M_AWAKE_MS,
+  M_DATA_AGE_S,
+  M_NUM
+} bench_metric_t;
+
+/*
+* @brief How a metric is printed and gated. A metric regresses when it
+*        moves the wrong way by more than pct % plus 'slack'.
+*/
+typedef struct
+{
+  const char *name;
+  uint8_t decimals;
+  uint32_t benches;         // Mask of BENCH_FRAME ... BENCH_DUTY
+  int8_t worse;             // 1: higher is worse, -1: lower is worse, 0: not gated
+  double pct;
+  double slack;
+} bench_metric_info_t;
+
+#define BENCH_FRAME   1
+#define BENCH_REPLAY  2
+#define BENCH_DECODE  4
+#define BENCH_RECOVER 8
+#define BENCH_READ    16          // Settings reads
+#define BENCH_COMMIT  32          // Settings commits
+#define BENCH_BLE     64
+#define BENCH_BOARD   128         // Recover on the simulated board
+#define BENCH_RECORD  256
+#define BENCH_SDLOG   512
+#define BENCH_LISTEN  1024        // Listen window with light sleep
+#define BENCH_TRACE   2048
+#define BENCH_TIMESYNC 4096
+#define BENCH_NMEA    8192
+#define BENCH_MICS    16384
+#define BENCH_DUTY    32768
+
+static const bench_metric_info_t bench_metrics[M_NUM] =
+{
+  [M_FRAMES]            = { "frames",            0, 1031, -1,  0, 0 },
+  [M_EXPECTED]          = { "expected",          0, 42051, 0,  0, 0 },
+  [M_CHECKSUM_ERRS]     = { "checksum_errs",     0, 8195, 0,  0, 0 },
+  [M_BYTES_SKIPPED]     = { "bytes_skipped",     0, 3,   0,   0, 0 },
+  [M_FRAMES_PER_S]      = { "frames_per_s",      0, 5,  -1,  45, 0 },
+  [M_CYCLES_PER_FRAME]  = { "cycles_per_frame",  1, 5,   1,  75, 20 },
+  [M_UART_DROPPED]      = { "uart_dropped",      0, 2,   1,   0, 0 },
+  [M_READ_NS_PER_FRAME] = { "read_ns_per_frame", 0, 2,   1, 100, 1000 },
+  [M_LAT_P50_US]        = { "lat_p50_us",        1, 2,   1, 100, 20 },
+  [M_LAT_P99_US]        = { "lat_p99_us",        1, 2,   0,   0, 0 },     // Two host preemptions in 200 frames
+  [M_LAT_MAX_US]        = { "lat_max_us",        1, 2,   0,   0, 0 },
+  [M_STACK_PEAK]        = { "stack_peak",        0, 2,   1,  10, 256 },
+  [M_HEAP_PEAK]         = { "heap_peak",         0, 2,   1,  10, 256 },
+  [M_DETECT_MS]         = { "detect_ms",         0, 8,   1,   0, 0 },
+  [M_RECOVER_MS]        = { "recover_ms",        0, 8,   1,   0, 0 },     // -1: never
+  [M_STEPS]             = { "steps",             0, 136, 1,   0, 0 },
+  [M_RECOVERIES]        = { "recoveries",        0, 128, -1,  0, 0 },
+  [M_RECOVER_S]         = { "recover_s",         1, 128, 1,   0, 1 },     // Host scheduling at x100
+  [M_NS_PER_OP]         = { "ns_per_op",         1, 16,  1, 100, 50 },
+  [M_COMMITS]           = { "commits",           0, 32, -1,   0, 0 },
+  [M_SEQ]               = { "seq",               0, 32, -1,   0, 0 },
+  [M_COMMIT_P50_US]     = { "commit_p50_us",     0, 32,  1, 300, 2000 },  // fsync() on a shared disk
+  [M_COMMIT_MAX_US]     = { "commit_max_us",     0, 32,  0,   0, 0 },
+  [M_RECORDS]           = { "records",           0, 32832, -1, 0, 0 },
+  [M_BAD_BLOCKS]        = { "bad_blocks",        0, 64,  1,   0, 0 },
+  [M_HISTORY_H]         = { "history_h",         1, 64, -1,   0, 0.05 },  // Printed rounded
+  [M_NOTIFICATIONS]     = { "notifications",     0, 64,  0,   0, 0 },
+  [M_RESENDS]           = { "resends",           0, 64,  0,   0, 0 },
+  [M_BACKLOG_MS]        = { "backlog_ms",        0, 64,  1,  25, 100 },   // Host scheduling shows at x5
+  [M_KBYTES_PER_S]      = { "kbytes_per_s",      1, 64, -1,  25, 0 },
+  [M_BYTES_PER_SAMPLE]  = { "bytes_per_sample",  2, 768, 1,   0, 0.01 },  // Printed rounded
+  [M_TEXT_BYTES]        = { "printf_bytes_per_sample", 1, 256, 0, 0, 0 },
+  [M_ENCODE_NS]         = { "encode_ns",         1, 256, 1, 100, 50 },
+  [M_DECODE_NS]         = { "decode_ns",         1, 256, 1, 100, 50 },
+  [M_MISMATCHES]        = { "mismatches",        0, 8960, 1,  0, 0 },
+  [M_CARD_WRITES]       = { "card_writes",       0, 512, 1,   0, 0 },
+  [M_APPEND_NS]         = { "append_ns",         1, 512, 1, 100, 50 },
+  [M_REPLAY_NS]         = { "replay_ns",         1, 512, 1, 100, 50 },
+  [M_LOST]              = { "lost",              0, 33792, 1, 0, 0 },
+  [M_LISTEN_MISSES]     = { "listen_misses",     0, 1024, 1,  0, 0 },
+  [M_BYTES_ASLEEP]      = { "bytes_asleep",      0, 1024, 1,  0, 0 },
+  [M_AWAKE_PCT]         = { "awake_pct",         2, 1024, 1, 25, 1 },    // Host scheduling at x10
+  [M_PUT_NS]            = { "put_ns",            1, 2048, 1, 100, 5 },
+  [M_DRAIN_NS]          = { "drain_ns",          1, 2048, 1, 100, 5 },
+  [M_FORMAT_NS]         = { "format_ns",         1, 2048, 1, 100, 50 },
+  [M_LOCK_S]            = { "lock_s",            0, 4096, 1,   0, 0 },
+  [M_MAX_ERR_US]        = { "max_err_us",        0, 4096, 1,   0, 0 },
+  [M_RMS_ERR_US]        = { "rms_err_us",        0, 4096, 1,   0, 0 },
+  [M_FREQ_ERR_PPB]      = { "freq_err_ppb",      0, 4096, 0,   0, 0 },
+  [M_SPIKES]            = { "spikes",            0, 4096, 0,   0, 0 },
+  [M_SPIKES_REJECTED]   = { "spikes_rejected",   0, 4096, -1,  0, 0 },
+  [M_CLOCK_STEPS]       = { "clock_steps",       0, 4096, 1,   0, 0 },
+  [M_SENTENCES]         = { "sentences",         0, 8192, -1,  0, 0 },
+  [M_MBYTES]            = { "mbytes",            1, 8192, 0,   0, 0 },
+  [M_SENTENCES_PER_S]   = { "sentences_per_s",   0, 8192, -1, 45, 0 },
+  [M_SENTENCE_P99_NS]   = { "sentence_p99_ns",   0, 8192, 1, 100, 100 },
+  [M_SENTENCE_MAX_NS]   = { "sentence_max_ns",   0, 8192, 1, 200, 1000 },  // One slow sentence of 136k
+  [M_SAMPLES_PER_S]     = { "samples_per_s",     0, 16384, -1, 45, 0 },
+  [M_CAL_NS]            = { "cal_ns",            2, 16384, 1, 100, 2 },
+  [M_ENERGY_UJ]         = { "energy_uj_per_cycle", 0, 32768, 1, 0, 0 },
+  [M_AVG_UA]            = { "avg_ua",            0, 32768, 1,  0, 0 },
+  [M_AWAKE_MS]          = { "awake_ms_per_cycle", 0, 32768, 1, 0, 0 },
+  [M_DATA_AGE_S]        = { "max_data_age_s",    0, 32768, 1,  0, 0 }
+};
+
+/*
+* @brief A sensor fault for the recover bench
+*/
+typedef enum
+{
+  SENSOR_GARBAGE,           // Every frame fails its checksum
+  SENSOR_OVERFLOW,          // The UART overflows instead of a frame
+  SENSOR_SILENT,            // Nothing at all
+  SENSOR_STUCK              // The same frame over and over
+} bench_sensor_t;
+
+/*
+* @brief A recover bench scenario: what the sensor does from BENCH_FAULT_S
+*        on and the first recovery step that stops it
+*/
+typedef struct
+{
+  const char *name;
+  bench_sensor_t sensor;
+  pm_health_state_t cured_by;   // PM_HEALTH_FAILED: nothing does
+} bench_fault_t;
+
+static const bench_fault_t bench_faults[] =
+{
+  { "garbage",  SENSOR_GARBAGE,  PM_HEALTH_RESYNC },        // Lost byte sync
+  { "overflow", SENSOR_OVERFLOW, PM_HEALTH_RESYNC },        // Task starved for a while
+  { "wedged",   SENSOR_SILENT,   PM_HEALTH_REINIT },        // UART peripheral lost its setup
+  { "hung",     SENSOR_SILENT,   PM_HEALTH_POWER_CYCLE },   // Sensor firmware hung
+  { "stuck",    SENSOR_STUCK,    PM_HEALTH_POWER_CYCLE },
+  { "dead",     SENSOR_SILENT,   PM_HEALTH_FAILED }
+};
+
+/*
+* @brief A board recover bench scenario: a PMS model fault (see
+*        sim_pms_fault()) by name
+*/
+typedef struct
+{
+  const char *name;
+  int fault;
+} bench_board_fault_t;
+
+static const bench_board_fault_t bench_board_faults[] =
+{
+  { "hang",  1 },
+  { "stuck", 2 }
+};
+
+/*
+* @brief A time servo bench scenario
+*/
+typedef struct
+{
+  const char *name;
+  uint8_t source;
+  int32_t freq_ppb;         // esp_timer rate error at the start
+  uint32_t jitter_us;
+  uint32_t spike_every;     // Every n-th measurement is off by spike_us
+  int32_t spike_us;
+} bench_timesync_t;
+
+static const bench_timesync_t bench_timesyncs[] =
+{
+  { "pps",        TIMESYNC_PPS,  20000, 10,    0,  0 },
+  { "pps_spikes", TIMESYNC_PPS,  40000, 30,    97, 300000 },    // A 1PPS edge from a glitch
+  { "nmea",       TIMESYNC_NMEA, 20000, 30000, 0,  0 }          // Arrival jitter of RMC at 9600 baud
+};
+
+/*
+* @brief A duty cycle bench scenario: a schedule and what goes wrong
+*/
+typedef struct
+{
+  const char *name;
+  uint8_t sensor_switched;
+  uint16_t uplink_every;
+  uint32_t frame_error_every;
+  uint32_t uplink_fail_every;
+} bench_duty_t;
+
+static const bench_duty_t bench_duties[] =
+{
+  { "always_on", 0, DUTY_UPLINK_EVERY, 0, 0 },    // Sensor on through the sleep, no warm up
+  { "switched",  1, DUTY_UPLINK_EVERY, 0, 0 },
+  { "lossy",     1, DUTY_UPLINK_EVERY, 4, 3 },    // Every 4th frame bad, every 3rd uplink fails
+  { "sparse",    1, 90, 0, 0 }                    // RTC memory fills first and brings the uplinks forward
+};
+
+/*
+* @brief What make_nmea() wrote: one RMC a second from 00:00:00
+*/
+typedef struct
+{
+  uint8_t *data;
+  size_t len;
+  uint32_t sentences;       // Generated...
+  uint32_t bad;             // ...of which with a bad checksum
+  uint32_t seconds;
+  int32_t *lat;             // Per second, 1e-7 degrees
+  int32_t *lon;
+} bench_nmea_t;
+
+/*
+* @brief A byte stream and how it is played
+*/
+typedef struct
+{
+  char name[32];
+  uint8_t *data;
+  size_t len;
+  uint32_t burst;           // Bytes per replay period
+  int32_t expected;         // Intact frames in the stream, -1 if unknown
+} bench_stream_t;
+
+/*
+* @brief One line of results
+*/
+typedef struct
+{
+  char key[BENCH_KEY_LEN];  // Everything before the metrics, identifies the line
+  uint32_t bench;
+  double v[M_NUM];
+} bench_result_t;
+
+/*
+* @brief What a replay child sends back
+*/
+typedef struct
+{
+  uint32_t frames;
+  uint32_t checksum_errs;
+  uint32_t bytes_skipped;
+  uint32_t uart_dropped;
+  double read_ns_per_frame;
+  double lat_p50_us;
+  double lat_p99_us;
+  double lat_max_us;
+  uint32_t stack_peak;
+  uint32_t heap_peak;
+} bench_replay_t;
+
+/*
+* @brief What a board recover child sends back
+*/
+typedef struct
+{
+  uint32_t recoveries;
+  uint32_t steps;
+  uint32_t recover_ms;
+} bench_board_t;
+
+/*
+* @brief What a listen child sends back
+*/
+typedef struct
+{
+  uint32_t sent;            // Frames the PMS model sent...
+  uint32_t frames;          // ...and the driver decoded
+  uint32_t listen_misses;
+  uint32_t bytes_asleep;
+  double awake_pct;         // Listen lock held, of the whole run
+} bench_listen_t;
+
+/*
+* @brief What a BLE child sends back
+*/
+typedef struct
+{
+  uint16_t mtu;             // Negotiated
+  uint32_t records;         // Received...
+  uint32_t stored;          // ...of those in the history
+  uint32_t bad_blocks;
+  uint32_t history_s;
+  uint32_t notifications;
+  uint32_t resends;
+  uint32_t bytes;
+  double backlog_ms;        // Subscribed to the end of the history, at the phone
+} bench_ble_t;
+
+
+/* Function prototypes */
+static void usage(const char *prog);
+static uint32_t rnd();
+static size_t put_frame(uint8_t *out, uint32_t seq);
+static void make_synthetic(const char *name, uint32_t frames);
+static int add_capture(const char *path);
+static int selected(const char *list, const char *name);
+static pm_frame_stats_t frame_pass(const bench_stream_t *stream);
+static void bench_frame(const bench_stream_t *stream, bench_result_t *res);
+static void legacy_decode(const uint8_t *packet, uint16_t *fields);
+static void bench_decode(const bench_stream_t *stream, const char *name,
+                         void (*decode)(const uint8_t *, uint16_t *), bench_result_t *res);
+static int bench_replay(const bench_stream_t *stream, uint32_t rate, bench_result_t *res);
+static void replay_child(const bench_stream_t *stream, uint32_t rate, int fd);
+static void replay_sink(const sensor_sample_t *sample, void *arg);
+static int cmp_u32(const void *a, const void *b);
+static void bench_recover(const bench_fault_t *fault, bench_result_t *res);
+static int bench_board(const bench_board_fault_t *fault, bench_result_t *res);
+static void board_child(const bench_board_fault_t *fault, int fd);
+static size_t bench_settings(bench_result_t *res);
+static int bench_ble(uint16_t mtu, bench_result_t *res);
+static void ble_child(uint16_t mtu, int fd);
+static void bench_record(bench_result_t *res);
+static esp_err_t card_read(void *ctx, uint32_t sector, void *buf, uint32_t count);
+static esp_err_t card_write(void *ctx, uint32_t sector, const void *buf, uint32_t count);
+static void bench_sdlog(bench_result_t *res);
+static int bench_listen(bench_result_t *res);
+static void listen_child(int fd);
+static void bench_trace(bench_result_t *res);
+static void bench_timesync(const bench_timesync_t *scenario, bench_result_t *res);
+static void make_nmea(bench_nmea_t *gen, size_t size);
+static size_t put_sentence(char *out, const char *body, int bad);
+static void bench_nmea(bench_result_t *res);
+static void bench_mics(bench_result_t *res);
+static void bench_duty(const bench_duty_t *scenario, bench_result_t *res);
+static void print_result(const bench_result_t *res);
+static int compare(const char *path, const bench_result_t *results, size_t count, double factor);
+
+/* Global variables */
+static bench_stream_t bench_streams[BENCH_MAX_SCENARIOS];
+static size_t bench_num_streams;
+static uint32_t bench_seed;
+static volatile uint16_t bench_sink;    // Keeps the decode bench from being optimised away
+
+// Replay child state
+static const pm_channel_config_t pm_channels[PM_MAX_CHANNELS] = PM_CHANNELS;
+static uint32_t replay_rate;
+static uint32_t replay_lat_ns[BENCH_MAX_FRAMES];
+static volatile uint32_t replay_count;
+static const uint16_t bench_mtus[] = { 185, 517 };   // What phones offer: iOS, Android
+
+
+
+int main(int argc, char **argv)
+{
+  static bench_result_t results[BENCH_MAX_RESULTS];
+  uint32_t rates[BENCH_MAX_RATES] = { 100 };
+  size_t num_rates = 1;
+  size_t count = 0;
+  uint32_t frames = 200;
+  const char *only = NULL;
+  const char *baseline = NULL;
+  const char *captures[BENCH_MAX_SCENARIOS];
+  size_t num_captures = 0;
+  double factor = 1.0;
+  char *p;
+  size_t n;
+  size_t i;
+  size_t j;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:r:c:s:b:t:")) != -1)
+  {
+    switch(opt)
+    {
+      case 'n':
+        frames = strtoul(optarg, NULL, 0);
+        if(frames == 0 || frames > BENCH_MAX_FRAMES - 16)
+          frames = BENCH_MAX_FRAMES - 16;
+        break;
+
+      case 'r':
+        num_rates = 0;
+        for(p = optarg; *p != '\0' && num_rates < BENCH_MAX_RATES; p += (*p == ','))
+        {
+          rates[num_rates] = strtoul(p, &p, 10);
+          if(rates[num_rates] > 0)
+            num_rates++;
+        }
+        break;
+
+      case 'c':
+        if(num_captures < BENCH_MAX_SCENARIOS)
+          captures[num_captures++] = optarg;
+        break;
+
+      case 's': only = optarg; break;
+      case 'b': baseline = optarg; break;
+      case 't': factor = strtod(optarg, NULL); break;
+      default: usage(argv[0]); return 2;
+    }
+  }
+
+  make_synthetic("clean", frames);
+  make_synthetic("noise", frames);
+  make_synthetic("dropped", frames);
+  make_synthetic("split", frames);
+  make_synthetic("corrupt", frames);
+  for(i = 0; i < num_captures; i++)
+  {
+    if(add_capture(captures[i]) != 0)
+    {
+      fprintf(stderr, "cannot read %s\n", captures[i]);
+      return 2;
+    }
+  }
+
+  for(i = 0; i < bench_num_streams; i++)
+  {
+    if(!selected(only, bench_streams[i].name))
+      continue;
+
+    bench_frame(&bench_streams[i], &results[count]);
+    print_result(&results[count++]);
+
+    for(j = 0; j < num_rates; j++)
+    {
+      if(bench_replay(&bench_streams[i], rates[j], &results[count]) != 0)
+      {
+        fprintf(stderr, "replay of %s at x%u failed\n", bench_streams[i].name, rates[j]);
+        return 2;
+      }
+      print_result(&results[count++]);
+    }
+  }
+
+  if(selected(only, "decode"))
+  {
+    bench_decode(&bench_streams[0], "legacy", legacy_decode, &results[count]);
+    print_result(&results[count++]);
+    bench_decode(&bench_streams[0], "table", pm_frame_decode, &results[count]);
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "recover"))
+  {
+    for(i = 0; i < sizeof(bench_faults) / sizeof(bench_faults[0]); i++)
+    {
+      bench_recover(&bench_faults[i], &results[count]);
+      print_result(&results[count++]);
+    }
+    for(i = 0; i < sizeof(bench_board_faults) / sizeof(bench_board_faults[0]); i++)
+    {
+      if(bench_board(&bench_board_faults[i], &results[count]) != 0)
+      {
+        fprintf(stderr, "board recover bench of %s failed\n", bench_board_faults[i].name);
+        return 2;
+      }
+      print_result(&results[count++]);
+    }
+  }
+
+  if(selected(only, "settings"))
+  {
+    n = bench_settings(&results[count]);
+    for(i = 0; i < n; i++)
+      print_result(&results[count++]);
+  }
+
+  if(selected(only, "ble"))
+  {
+    for(i = 0; i < sizeof(bench_mtus) / sizeof(bench_mtus[0]); i++)
+    {
+      if(bench_ble(bench_mtus[i], &results[count]) != 0)
+      {
+        fprintf(stderr, "BLE bench at MTU %u failed\n", bench_mtus[i]);
+        return 2;
+      }
+      print_result(&results[count++]);
+    }
+  }
+
+  if(selected(only, "record"))
+  {
+    bench_record(&results[count]);
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "sdlog"))
+  {
+    bench_sdlog(&results[count]);
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "listen"))
+  {
+    if(bench_listen(&results[count]) != 0)
+    {
+      fprintf(stderr, "listen bench failed\n");
+      return 2;
+    }
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "trace"))
+  {
+    bench_trace(&results[count]);
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "timesync"))
+  {
+    for(i = 0; i < sizeof(bench_timesyncs) / sizeof(bench_timesyncs[0]); i++)
+    {
+      bench_timesync(&bench_timesyncs[i], &results[count]);
+      print_result(&results[count++]);
+    }
+  }
+
+  if(selected(only, "nmea"))
+  {
+    bench_nmea(&results[count]);
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "mics"))
+  {
+    bench_mics(&results[count]);
+    print_result(&results[count++]);
+  }
+
+  if(selected(only, "duty"))
+  {
+    for(i = 0; i < sizeof(bench_duties) / sizeof(bench_duties[0]); i++)
+    {
+      bench_duty(&bench_duties[i], &results[count]);
+      print_result(&results[count++]);
+    }
+  }
+
+  if(baseline != NULL)
+    return compare(baseline, results, count, factor);
+
+  return 0;
+}
+
+
+/*
+* @brief Prints the options.
+*/
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-n frames] [-r rate,...] [-c capture]... [-s scenario,...]\n"
+                  "          [-b baseline.json] [-t factor]\n", prog);
+}
+
+
+/*
+* @brief Small deterministic generator so every run sees the same streams.
+*/
+static uint32_t rnd()
+{
+  bench_seed = bench_seed * 1664525 + 1013904223;
+  return bench_seed >> 8;
+}
+
+
+/*
+* @brief Writes one valid frame of the PM_MODEL sensor with slowly moving
+*        readings.
+*
+* @return PM_FRAME_LEN
+*/
+static size_t put_frame(uint8_t *out, uint32_t seq)
+{
+  uint16_t values[3];
+  uint16_t sum = 0;
+  size_t i;
+
+  values[0] = 8 + (seq % 7) + rnd() % 3;
+  values[1] = values[0] + 4 + rnd() % 5;
+  values[2] = values[1] + 6 + rnd() % 9;
+
+  memset(out, 0, PM_FRAME_LEN);
+  out[0] = PM_FRAME_START1;
+  out[1] = PM_FRAME_START2;
+  out[3] = PM_FRAME_LEN - 4;
+  for(i = 0; i < 3; i++)
+  {
+    // CF=1 and atmospheric readings
+    out[4 + 2*i] = out[10 + 2*i] = values[i] >> 8;
+    out[5 + 2*i] = out[11 + 2*i] = values[i] & 0xFF;
+  }
+  for(i = 0; i < PM_FRAME_LEN - 2; i++)
+  {
+    sum += out[i];
+  }
+  out[PM_FRAME_LEN - 2] = sum >> 8;
+  out[PM_FRAME_LEN - 1] = sum & 0xFF;
+
+  return PM_FRAME_LEN;
+}
+
+
+/*
+* @brief Builds one of the synthetic streams.
+*
+* clean   - frames back to back, one per burst
+* noise   - each burst is a frame with 16 noise bytes around it, a quarter
+*           of them 'B' or 'M' to start false headers
+* dropped - one frame in eight loses a byte, which also shifts every later
+*           frame across burst boundaries
+* split   - 12 bytes of line noise first, so every frame arrives in two
+*           bursts
+* corrupt - one frame in eight has a bit flipped
+*/
+static void make_synthetic(const char *name, uint32_t frames)
+{
+  bench_stream_t *s = &bench_streams[bench_num_streams];
+  uint8_t frame[PM_FRAME_LEN];
+  uint8_t *out;
+  uint32_t lead;
+  uint32_t i;
+  uint32_t k;
+
+  out = malloc((size_t) frames * (PM_FRAME_LEN + 16) + 16);
+  if(out == NULL)
+    return;
+
+  bench_seed = 1;
+  memset(s, 0, sizeof(*s));
+  strncpy(s->name, name, sizeof(s->name) - 1);
+  s->data = out;
+  s->burst = PM_FRAME_LEN;
+  s->expected = frames;
+
+  if(strcmp(name, "split") == 0)
+  {
+    for(k = 0; k < PM_FRAME_LEN / 2; k++)
+      *out++ = rnd();
+  }
+
+  for(i = 0; i < frames; i++)
+  {
+    put_frame(frame, i);
+
+    if(strcmp(name, "noise") == 0)
+    {
+      s->burst = PM_FRAME_LEN + 16;
+      lead = rnd() % 17;
+      for(k = 0; k < 16; k++)
+      {
+        if(k == lead)
+        {
+          memcpy(out, frame, PM_FRAME_LEN);
+          out += PM_FRAME_LEN;
+        }
+        *out++ = (rnd() % 4 == 0) ? ((rnd() & 1) ? PM_FRAME_START1 : PM_FRAME_START2) : rnd();
+      }
+      if(lead == 16)
+      {
+        memcpy(out, frame, PM_FRAME_LEN);
+        out += PM_FRAME_LEN;
+      }
+    }
+    else if(strcmp(name, "dropped") == 0 && i % 8 == 3)
+    {
+      k = rnd() % PM_FRAME_LEN;
+      memcpy(out, frame, k);
+      memcpy(out + k, frame + k + 1, PM_FRAME_LEN - k - 1);
+      out += PM_FRAME_LEN - 1;
+      s->expected--;
+    }
+    else if(strcmp(name, "corrupt") == 0 && i % 8 == 3)
+    {
+      // Anywhere past the header, so the framer sees a bad checksum or length
+      frame[2 + rnd() % (PM_FRAME_LEN - 2)] ^= 1 << (rnd() % 8);
+      memcpy(out, frame, PM_FRAME_LEN);
+      out += PM_FRAME_LEN;
+      s->expected--;
+    }
+    else
+    {
+      memcpy(out, frame, PM_FRAME_LEN);
+      out += PM_FRAME_LEN;
+    }
+  }
+
+  s->len = out - s->data;
+  bench_num_streams++;
+}
+
+
+/*
+* @brief Adds a recorded capture as a scenario named after the file.
+*
+* @return 0 on success
+*/
+static int add_capture(const char *path)
+{
+  bench_stream_t *s;
+  const char *base;
+  long size;
+  FILE *f;
+
+  if(bench_num_streams >= BENCH_MAX_SCENARIOS)
+    return -1;
+
+  f = fopen(path, "rb");
+  if(f == NULL)
+    return -1;
+
+  s = &bench_streams[bench_num_streams];
+  memset(s, 0, sizeof(*s));
+  if(fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+  {
+    s->data = malloc(size);
+    if(s->data != NULL && fread(s->data, 1, size, f) == (size_t) size)
+      s->len = size;
+  }
+  fclose(f);
+
+  // The replay keeps every latency, so long captures are cut short.
+  if(s->len == 0)
+    return -1;
+  if(s->len > (size_t) (BENCH_MAX_FRAMES - 16) * PM_FRAME_LEN)
+    s->len = (size_t) (BENCH_MAX_FRAMES - 16) * PM_FRAME_LEN;
+
+  base = strrchr(path, '/');
+  strncpy(s->name, (base != NULL) ? base + 1 : path, sizeof(s->name) - 1);
+  s->burst = PM_FRAME_LEN;
+  s->expected = -1;
+  bench_num_streams++;
+
+  return 0;
+}
+
+
+/*
+* @brief 1 if 'name' is in the comma separated list, or there is no list.
+*/
+static int selected(const char *list, const char *name)
+{
+  size_t len = strlen(name);
+  const char *p;
+
+  if(list == NULL)
+    return 1;
+
+  for(p = list; (p = strstr(p, name)) != NULL; p += len)
+  {
+    if((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+/*
+* @brief One pass of the frame bench: the stream in UART buffer sized reads
+*        through the framer, decoded the way pm_if does it and through a
+*        sample ring.
+*
+* @return framer statistics of the pass
+*/
+static pm_frame_stats_t frame_pass(const bench_stream_t *stream)
+{
+  static pm_ring_t ring;
+  static pm_sample_t sample;
+  static int64_t time_us;
+  static int ready;
+  pm_framer_t framer;
+  pm_sample_t out;
+  const uint8_t *frame;
+  const uint8_t *p;
+  uint16_t fields[PM_FIELD_NUM];
+  size_t off;
+  size_t len;
+
+  if(!ready)
+  {
+    pm_ring_init(&ring);
+    ready = 1;
+  }
+
+  pm_framer_init(&framer);
+  for(off = 0; off < stream->len; off += BUF_SIZE)
+  {
+    p = stream->data + off;
+    len = (stream->len - off < BUF_SIZE) ? stream->len - off : BUF_SIZE;
+
+    while((frame = pm_framer_next(&framer, &p, &len)) != NULL)
+    {
+      sample.time_us = time_us;
+      sample.seq++;
+      pm_frame_decode(frame, fields);
+      sample.pm1 = fields[PM_FIELD_PM1];
+      sample.pm2_5 = fields[PM_FIELD_PM2_5];
+      sample.pm10 = fields[PM_FIELD_PM10];
+      pm_ring_push(&ring, &sample);
+      pm_ring_pop(&ring, &out, 1);
+      bench_sink += out.pm2_5;
+      time_us += BENCH_PERIOD_MS * 1000;
+    }
+  }
+
+  return framer.stats;
+}
+
+
+/*
+* @brief Frame bench: BENCH_REPS timed runs of whole passes, reporting the
+*        fastest, which is the one the host disturbed least.
+*/
+static void bench_frame(const bench_stream_t *stream, bench_result_t *res)
+{
+  pm_frame_stats_t stats;
+  struct timespec t0;
+  struct timespec t1;
+  uint64_t c0;
+  uint64_t frames;
+  double best_ns = 0;
+  double best_cycles = 0;
+  double ns;
+  int rep;
+
+  stats = frame_pass(stream);
+
+  for(rep = 0; rep < BENCH_REPS && stats.frames > 0; rep++)
+  {
+    frames = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = BENCH_CYCLES();
+    do
+    {
+      frames += frame_pass(stream).frames;
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    } while(ns < BENCH_REP_NS);
+
+    if(rep == 0 || ns / frames < best_ns)
+    {
+      best_ns = ns / frames;
+      best_cycles = (double) (BENCH_CYCLES() - c0) / frames;
+    }
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"frame\",\"scenario\":\"%s\",", stream->name);
+  res->bench = BENCH_FRAME;
+  res->v[M_FRAMES] = stats.frames;
+  res->v[M_EXPECTED] = stream->expected;
+  res->v[M_CHECKSUM_ERRS] = stats.checksum_errs;
+  res->v[M_BYTES_SKIPPED] = stats.bytes_skipped;
+  if(best_ns > 0)
+  {
+    res->v[M_FRAMES_PER_S] = 1e9 / best_ns;
+    res->v[M_CYCLES_PER_FRAME] = best_cycles;
+  }
+}
+
+
+/*
+* @brief pm_if's decoder before pm_frame_decode(), for the decode bench to
+*        compare against: PM1/PM2.5/PM10 CF=1 only, with the high byte
+*        shifted by sizeof(uint8_t) bits instead of 8.
+*/
+static void legacy_decode(const uint8_t *packet, uint16_t *fields)
+{
+  uint16_t tmp;
+  uint8_t tmp2;
+
+  tmp = packet[4];
+  tmp2 = packet[5];
+  tmp = tmp << sizeof(uint8_t);
+  tmp = tmp | tmp2;
+  fields[PM_FIELD_PM1] = tmp;
+
+  tmp = packet[6];
+  tmp2 = packet[7];
+  tmp = tmp << sizeof(uint8_t);
+  tmp = tmp | tmp2;
+  fields[PM_FIELD_PM2_5] = tmp;
+
+  tmp = packet[8];
+  tmp2 = packet[9];
+  tmp = tmp << sizeof(uint8_t);
+  tmp = tmp | tmp2;
+  fields[PM_FIELD_PM10] = tmp;
+}
+
+
+/*
+* @brief Decode bench: the valid frames of a stream through one decoder,
+*        BENCH_REPS timed runs, reporting the fastest.
+*/
+static void bench_decode(const bench_stream_t *stream, const char *name,
+                         void (*decode)(const uint8_t *, uint16_t *), bench_result_t *res)
+{
+  static uint8_t frames[BENCH_MAX_FRAMES][PM_FRAME_LEN];
+  uint16_t fields[PM_FIELD_NUM];
+  pm_framer_t framer;
+  const uint8_t *frame;
+  const uint8_t *p = stream->data;
+  size_t len = stream->len;
+  struct timespec t0;
+  struct timespec t1;
+  uint64_t c0;
+  uint64_t decoded;
+  uint32_t n = 0;
+  uint32_t i;
+  double best_ns = 0;
+  double best_cycles = 0;
+  double ns;
+  int rep;
+
+  pm_framer_init(&framer);
+  while(n < BENCH_MAX_FRAMES && (frame = pm_framer_next(&framer, &p, &len)) != NULL)
+  {
+    memcpy(frames[n++], frame, PM_FRAME_LEN);
+  }
+
+  for(rep = 0; rep < BENCH_REPS && n > 0; rep++)
+  {
+    decoded = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = BENCH_CYCLES();
+    do
+    {
+      for(i = 0; i < n; i++)
+      {
+        decode(frames[i], fields);
+        bench_sink += fields[PM_FIELD_PM2_5];
+      }
+      decoded += n;
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    } while(ns < BENCH_REP_NS);
+
+    if(rep == 0 || ns / decoded < best_ns)
+    {
+      best_ns = ns / decoded;
+      best_cycles = (double) (BENCH_CYCLES() - c0) / decoded;
+    }
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"decode\",\"decoder\":\"%s\",", name);
+  res->bench = BENCH_DECODE;
+  res->v[M_FRAMES] = n;
+  if(best_ns > 0)
+  {
+    res->v[M_FRAMES_PER_S] = 1e9 / best_ns;
+    res->v[M_CYCLES_PER_FRAME] = best_cycles;
+  }
+}
+
+
+/*
+* @brief Replay bench: runs replay_child() in a new process and collects
+*        its results.
+*
+* @return 0 on success
+*/
+static int bench_replay(const bench_stream_t *stream, uint32_t rate, bench_result_t *res)
+{
+  bench_replay_t r;
+  pid_t pid;
+  int fds[2];
+  int status;
+  ssize_t n;
+
+  if(pipe(fds) != 0)
+    return -1;
+
+  fflush(stdout);
+  pid = fork();
+  if(pid < 0)
+    return -1;
+  if(pid == 0)
+  {
+    close(fds[0]);
+    replay_child(stream, rate, fds[1]);
+    _exit(1);
+  }
+
+  close(fds[1]);
+  n = read(fds[0], &r, sizeof(r));
+  close(fds[0]);
+  if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+     n != sizeof(r))
+    return -1;
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"replay\",\"scenario\":\"%s\",\"rate\":%u,",
+           stream->name, rate);
+  res->bench = BENCH_REPLAY;
+  res->v[M_FRAMES] = r.frames;
+  res->v[M_EXPECTED] = (stream->expected < 0) ? -1 : stream->expected * PM_NUM_CHANNELS;
+  res->v[M_CHECKSUM_ERRS] = r.checksum_errs;
+  res->v[M_BYTES_SKIPPED] = r.bytes_skipped;
+  res->v[M_UART_DROPPED] = r.uart_dropped;
+  res->v[M_READ_NS_PER_FRAME] = r.read_ns_per_frame;
+  res->v[M_LAT_P50_US] = r.lat_p50_us;
+  res->v[M_LAT_P99_US] = r.lat_p99_us;
+  res->v[M_LAT_MAX_US] = r.lat_max_us;
+  res->v[M_STACK_PEAK] = r.stack_peak;
+  res->v[M_HEAP_PEAK] = r.heap_peak;
+
+  return 0;
+}
+
+
+/*
+* @brief One replay run: brings up the PM driver and the sensor task like
+*        app_main() does, plays the stream and writes a bench_replay_t to
+*        'fd'.
+*/
+static void replay_child(const bench_stream_t *stream, uint32_t rate, int fd)
+{
+  sim_uart_stats_t uart;
+  bench_replay_t r;
+  pm_stats_t pm;
+  uint32_t free_at_start;
+  uint32_t bursts;
+  uint32_t n;
+  uint8_t ch;
+
+  replay_rate = rate;
+  sim_log_level(ESP_LOG_WARN);
+  sim_clock_init(rate, 0, 0);
+  free_at_start = esp_get_free_heap_size();
+
+  bursts = (stream->len + stream->burst - 1) / stream->burst;
+  for(ch = 0; ch < PM_NUM_CHANNELS; ch++)
+  {
+    if(sim_uart_feed_file(pm_channels[ch].uart, stream->data, stream->len, BENCH_PERIOD_MS,
+                          stream->burst, 0) != ESP_OK)
+      return;
+  }
+  if(PM_init() != ESP_OK ||
+     sensor_add_sink(replay_sink, NULL) != ESP_OK ||
+     sensor_start() != ESP_OK)
+    return;
+
+  sim_sleep_until((int64_t) bursts * BENCH_PERIOD_MS * 1000 + BENCH_TAIL_MS * 1000);
+
+  n = replay_count;
+  if(n > BENCH_MAX_FRAMES)
+    n = BENCH_MAX_FRAMES;
+  qsort(replay_lat_ns, n, sizeof(replay_lat_ns[0]), cmp_u32);
+
+  memset(&r, 0, sizeof(r));
+  for(ch = 0; ch < PM_NUM_CHANNELS; ch++)
+  {
+    PM_get_stats(ch, &pm);
+    sim_uart_get_stats(pm_channels[ch].uart, &uart);
+    r.frames += pm.framer.frames;
+    r.checksum_errs += pm.framer.checksum_errs;
+    r.bytes_skipped += pm.framer.bytes_skipped;
+    r.uart_dropped += uart.bytes_dropped;
+    r.read_ns_per_frame += (double) pm.busy_us * 1000 / rate;
+  }
+  if(r.frames > 0)
+    r.read_ns_per_frame /= r.frames;
+  if(n > 0)
+  {
+    r.lat_p50_us = replay_lat_ns[n / 2] / 1000.0;
+    r.lat_p99_us = replay_lat_ns[(n * 99) / 100] / 1000.0;
+    r.lat_max_us = replay_lat_ns[n - 1] / 1000.0;
+  }
+  r.stack_peak = sim_task_stack_peak("vSensor_task");
+  r.heap_peak = free_at_start - esp_get_minimum_free_heap_size();
+
+  if(write(fd, &r, sizeof(r)) == sizeof(r))
+    _exit(0);
+}
+
+
+/*
+* @brief Times each PM sample from the UART event that finished its frame.
+*        The simulated clock runs replay_rate times faster than the host, so
+*        the difference is scaled back to host time.
+*/
+static void replay_sink(const sensor_sample_t *sample, void *arg)
+{
+  sim_uart_stats_t uart;
+  int64_t us;
+  uint32_t n = replay_count;
+
+  if(sample->sensor >= PM_NUM_CHANNELS || n >= BENCH_MAX_FRAMES)
+    return;
+
+  // PM channel n is sensor n, PM_init() registers them in order.
+  sim_uart_get_stats(pm_channels[sample->sensor].uart, &uart);
+  us = esp_timer_get_time() - uart.last_rx_us;
+  replay_lat_ns[n] = (uint32_t) (us * 1000 / replay_rate);
+  replay_count = n + 1;
+}
+
+
+static int cmp_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a;
+  uint32_t y = *(const uint32_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+
+/*
+* @brief Recover bench: drives a pm_health_t the way pm_if does, with a
+*        sensor that sends a frame a second, is silent while it settles
+*        after a power cycle, and goes wrong at BENCH_FAULT_S until the
+*        fault's cure is applied.
+*/
+static void bench_recover(const bench_fault_t *fault, bench_result_t *res)
+{
+  const pm_health_config_t config = PM_HEALTH_CONFIG_DEFAULT();
+  const int64_t fault_us = (int64_t) BENCH_FAULT_S * 1000000;
+  pm_health_t health;
+  pm_health_action_t action;
+  uint16_t fields[PM_FIELD_NUM];
+  int64_t now_us;
+  int64_t frame_us = 0;
+  int64_t settle_us = 0;
+  int64_t detect_us = -1;
+  int64_t recover_us = -1;
+  uint32_t steps = 0;
+  uint32_t seq = 0;
+  uint32_t i;
+  int cured = 0;
+  int off = 0;
+
+  pm_health_init(&health, &config, 0);
+
+  for(now_us = 0; now_us < (int64_t) BENCH_RECOVER_S * 1000000; now_us += BENCH_TICK_MS * 1000)
+  {
+    pm_health_pause(&health, now_us, now_us < settle_us);
+
+    if(!off && now_us >= settle_us && now_us >= frame_us)
+    {
+      frame_us = now_us + BENCH_PERIOD_MS * 1000;
+      seq++;
+      for(i = 0; i < PM_FIELD_NUM; i++)
+        fields[i] = 10 + (seq + i) % 5;
+
+      if(now_us < fault_us || cured)
+        pm_health_frame(&health, now_us, fields);
+      else if(fault->sensor == SENSOR_GARBAGE)
+        pm_health_bad(&health, now_us, 1);
+      else if(fault->sensor == SENSOR_OVERFLOW)
+        pm_health_overflow(&health, now_us);
+      else if(fault->sensor == SENSOR_STUCK)
+      {
+        for(i = 0; i < PM_FIELD_NUM; i++)
+          fields[i] = 42;
+        pm_health_frame(&health, now_us, fields);
+      }
+    }
+
+    while((action = pm_health_step(&health, now_us)) != PM_HEALTH_NONE)
+    {
+      steps++;
+      if(detect_us < 0)
+        detect_us = now_us - fault_us;
+
+      if(action == PM_HEALTH_DO_POWER_OFF)
+        off = 1;
+      else if(action == PM_HEALTH_DO_POWER_ON)
+      {
+        // Up again with the fan spinning up, like pm_power after a wake up
+        off = 0;
+        settle_us = now_us + PM_POWER_SETTLE_MS * 1000LL;
+        frame_us = now_us;
+        pm_health_pause(&health, now_us, 1);
+      }
+
+      if(health.state == fault->cured_by && action != PM_HEALTH_DO_POWER_OFF)
+        cured = 1;
+    }
+
+    if(recover_us < 0 && detect_us >= 0 && health.state == PM_HEALTH_OK)
+      recover_us = now_us - fault_us;
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"recover\",\"fault\":\"%s\",", fault->name);
+  res->bench = BENCH_RECOVER;
+  res->v[M_DETECT_MS] = (detect_us < 0) ? -1 : detect_us / 1000;
+  res->v[M_RECOVER_MS] = (recover_us < 0) ? -1 : recover_us / 1000;
+  res->v[M_STEPS] = steps;
+}
+
+
+/*
+* @brief Board recover bench: runs board_child() in a new process and
+*        collects its results.
+*
+* @return 0 on success
+*/
+static int bench_board(const bench_board_fault_t *fault, bench_result_t *res)
+{
+  bench_board_t r;
+  pid_t pid;
+  int fds[2];
+  int status;
+  ssize_t n;
+
+  if(pipe(fds) != 0)
+    return -1;
+
+  fflush(stdout);
+  pid = fork();
+  if(pid < 0)
+    return -1;
+  if(pid == 0)
+  {
+    close(fds[0]);
+    board_child(fault, fds[1]);
+    _exit(1);
+  }
+
+  close(fds[1]);
+  n = read(fds[0], &r, sizeof(r));
+  close(fds[0]);
+  if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+     n != sizeof(r))
+    return -1;
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"recover\",\"board\":\"default\",\"fault\":\"%s\",",
+           fault->name);
+  res->bench = BENCH_BOARD;
+  res->v[M_RECOVERIES] = r.recoveries;
+  res->v[M_STEPS] = r.steps;
+  res->v[M_RECOVER_S] = r.recover_ms / 1000.0;
+
+  return 0;
+}
+
+
+/*
+* @brief One board recover run: the PMS model on channel 0's UART and
+*        pins, the PM driver and the sensor task brought up like
+*        app_main() does with the fan kept on, and the fault at
+*        BENCH_FAULT_S. Writes a bench_board_t to 'fd' once the channel is
+*        healthy again after a recovery, or at BENCH_RECOVER_S.
+*/
+static void board_child(const bench_board_fault_t *fault, int fd)
+{
+  const pm_power_config_t always_on = { 0, 0, PM_POWER_SETTLE_MS, PM_POWER_QUERY_MS };
+  bench_board_t r;
+  pm_stats_t pm;
+  int i;
+
+  sim_log_level(ESP_LOG_ERROR);
+  sim_clock_init(BENCH_BOARD_RATE, 0, 0);
+
+  if(sim_pms_attach(pm_channels[0].uart, pm_channels[0].set_pin, pm_channels[0].reset_pin, 12) != ESP_OK)
+    return;
+  sim_pms_fault(fault->fault, (int64_t) BENCH_FAULT_S * 1000000);
+  PM_set_power(&always_on);
+  if(PM_init() != ESP_OK || sensor_start() != ESP_OK)
+    return;
+
+  do
+  {
+    sim_sleep_until(esp_timer_get_time() + 1000000);
+    PM_get_stats(0, &pm);
+  } while((pm.health.recoveries == 0 || pm.health.state != PM_HEALTH_OK) &&
+          esp_timer_get_time() < (int64_t) BENCH_RECOVER_S * 1000000);
+
+  memset(&r, 0, sizeof(r));
+  r.recoveries = pm.health.recoveries;
+  for(i = PM_HEALTH_RESYNC; i < PM_HEALTH_NUM_STATES; i++)
+    r.steps += pm.health.actions[i];
+  r.recover_ms = pm.health.last_recover_ms;
+
+  if(write(fd, &r, sizeof(r)) == sizeof(r))
+    _exit(0);
+}
+
+
+/*
+* @brief Settings bench: reads from the RAM copy and decodes of a slot,
+*        BENCH_REPS timed runs each reporting the fastest, then
+*        BENCH_COMMITS commits to an image file in P_tmpdir, which is then
+*        read back as at the next boot.
+*
+* @return results filled in
+*/
+static size_t bench_settings(bench_result_t *res)
+{
+  static const char *ops[] = { "get", "decode" };
+  static uint8_t blob[SETTINGS_BLOB_MAX];
+  uint32_t lat_us[BENCH_COMMITS];
+  settings_t settings;
+  settings_t decoded;
+  settings_stats_t stats;
+  nvs_handle nvs;
+  struct timespec t0;
+  struct timespec t1;
+  char path[256];
+  char key[8];
+  uint64_t calls;
+  uint32_t commits = 0;
+  uint32_t seq = 0;
+  uint32_t s;
+  size_t len;
+  double best_ns;
+  double ns;
+  int rep;
+  int op;
+  int i;
+
+  snprintf(path, sizeof(path), "%s/pm_bench_nvs_%d.img", P_tmpdir, (int) getpid());
+  unlink(path);
+  esp_log_level_set(TAG_SETTINGS, ESP_LOG_WARN);
+  if(sim_nvs_open(path) != ESP_OK || settings_init() != ESP_OK)
+    return 0;
+  settings_get(&settings);
+  len = settings_encode(&settings, 1, blob);
+
+  for(op = 0; op < 2; op++)
+  {
+    best_ns = 0;
+    for(rep = 0; rep < BENCH_REPS; rep++)
+    {
+      calls = 0;
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      do
+      {
+        for(i = 0; i < 1000; i++)
+        {
+          if(op == 0)
+            settings_get(&decoded);
+          else
+            settings_decode(blob, len, &settings, &decoded);
+          bench_sink += decoded.flush_samples;
+        }
+        calls += 1000;
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+      } while(ns < BENCH_REP_NS);
+
+      if(rep == 0 || ns / calls < best_ns)
+        best_ns = ns / calls;
+    }
+
+    memset(&res[op], 0, sizeof(res[op]));
+    snprintf(res[op].key, sizeof(res[op].key), "\"bench\":\"settings\",\"op\":\"%s\",", ops[op]);
+    res[op].bench = BENCH_READ;
+    res[op].v[M_NS_PER_OP] = best_ns;
+  }
+
+  for(i = 0; i < BENCH_COMMITS; i++)
+  {
+    settings.flush_samples = 1 + i;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if(settings_commit(&settings) == ESP_OK)
+      commits++;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    lat_us[i] = (uint32_t) ((t1.tv_sec - t0.tv_sec) * 1000000 + (t1.tv_nsec - t0.tv_nsec) / 1000);
+  }
+  qsort(lat_us, BENCH_COMMITS, sizeof(lat_us[0]), cmp_u32);
+  settings_get_stats(&stats);
+
+  // What the next boot would find: the image, not the RAM copy.
+  if(sim_nvs_open(path) == ESP_OK && nvs_open(SETTINGS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK)
+  {
+    for(i = 0; i < SETTINGS_SLOTS; i++)
+    {
+      snprintf(key, sizeof(key), "set%d", i);
+      len = sizeof(blob);
+      if(nvs_get_blob(nvs, key, blob, &len) == ESP_OK &&
+         (s = settings_decode(blob, len, &settings, &decoded)) > seq &&
+         decoded.flush_samples == s)
+        seq = s;
+    }
+    nvs_close(nvs);
+  }
+  unlink(path);
+
+  memset(&res[2], 0, sizeof(res[2]));
+  snprintf(res[2].key, sizeof(res[2].key), "\"bench\":\"settings\",\"op\":\"commit\",");
+  res[2].bench = BENCH_COMMIT;
+  res[2].v[M_COMMITS] = commits;
+  res[2].v[M_SEQ] = (stats.seq == seq) ? seq : 0;
+  res[2].v[M_COMMIT_P50_US] = lat_us[BENCH_COMMITS / 2];
+  res[2].v[M_COMMIT_MAX_US] = lat_us[BENCH_COMMITS - 1];
+
+  return 3;
+}
+
+
+/*
+* @brief BLE bench: runs ble_child() in a new process and collects its
+*        results.
+*
+* @return 0 on success
+*/
+static int bench_ble(uint16_t mtu, bench_result_t *res)
+{
+  bench_ble_t r;
+  pid_t pid;
+  int fds[2];
+  int status;
+  ssize_t n;
+
+  if(pipe(fds) != 0)
+    return -1;
+
+  fflush(stdout);
+  pid = fork();
+  if(pid < 0)
+    return -1;
+  if(pid == 0)
+  {
+    close(fds[0]);
+    ble_child(mtu, fds[1]);
+    _exit(1);
+  }
+
+  close(fds[1]);
+  n = read(fds[0], &r, sizeof(r));
+  close(fds[0]);
+  if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+     n != sizeof(r))
+    return -1;
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"ble\",\"mtu\":%u,", r.mtu);
+  res->bench = BENCH_BLE;
+  res->v[M_RECORDS] = r.records;
+  res->v[M_EXPECTED] = r.stored;
+  res->v[M_BAD_BLOCKS] = r.bad_blocks;
+  res->v[M_HISTORY_H] = r.history_s / 3600.0;
+  res->v[M_NOTIFICATIONS] = r.notifications;
+  res->v[M_RESENDS] = r.resends;
+  res->v[M_BACKLOG_MS] = r.backlog_ms;
+  res->v[M_KBYTES_PER_S] = (r.backlog_ms > 0) ? r.bytes / 1.024 / r.backlog_ms : 0;
+
+  return 0;
+}
+
+
+/*
+* @brief One BLE run: fills the history straight through the sink with
+*        BENCH_BLE_HISTORY_S of samples, brings the service up with a phone
+*        waiting for it and writes a bench_ble_t to 'fd' once the phone has
+*        the history.
+*/
+static void ble_child(uint16_t mtu, int fd)
+{
+  sensor_sample_t sample;
+  ble_data_stats_t data;
+  sim_ble_phone_stats_t phone;
+  bench_ble_t r;
+  int32_t pm25 = 12;
+  uint32_t t;
+  int64_t end_us;
+
+  sim_log_level(ESP_LOG_WARN);
+  sim_clock_init(BENCH_BLE_SCALE, 0, 0);
+  if(ble_data_init() != ESP_OK)
+    return;
+
+  // PM as the PMS3003 driver reports it, a slowly wandering PM2.5; the
+  // HDC1080's temperature and humidity in hundredths.
+  for(t = 0; t < BENCH_BLE_HISTORY_S; t++)
+  {
+    memset(&sample, 0, sizeof(sample));
+    sample.time_us = (int64_t) t * 1000000;
+    sample.sensor = 0;
+    sample.count = 6;
+    pm25 += (int32_t) (rnd() % 5) - 2;
+    if(pm25 < 1)
+      pm25 = 1;
+    sample.values[0] = t;
+    sample.values[1] = pm25 * 2 / 3;
+    sample.values[2] = pm25;
+    sample.values[3] = pm25 * 4 / 3;
+    sample.values[4] = 2150 + (int32_t) (rnd() % 40);
+    sample.values[5] = 3800 + (int32_t) (rnd() % 80);
+    ble_data_add(&sample);
+
+    sample.sensor = 1;
+    sample.count = 2;
+    sample.values[0] = 2200 + (int32_t) (t / 600 % 200);
+    sample.values[1] = 4000 - (int32_t) (t / 900 % 300);
+    ble_data_add(&sample);
+  }
+
+  if(sim_ble_subscriber(0, mtu) != ESP_OK || ble_data_start() != ESP_OK)
+    return;
+  end_us = esp_timer_get_time() + (int64_t) BENCH_BLE_WAIT_S * 1000000;
+  do
+  {
+    sim_sleep_until(esp_timer_get_time() + 100000);
+    sim_ble_phone_get_stats(&phone);
+  } while(phone.backlog_us == 0 && esp_timer_get_time() < end_us);
+  ble_data_get_stats(&data);
+
+  memset(&r, 0, sizeof(r));
+  r.mtu = phone.mtu;
+  r.records = phone.records;
+  r.stored = data.records_stored;
+  r.bad_blocks = phone.bad_blocks;
+  r.history_s = data.history_s;
+  r.notifications = phone.notifications;
+  r.resends = data.resends;
+  r.bytes = phone.rx_bytes;
+  if(phone.backlog_us > 0)
+    r.backlog_ms = (phone.backlog_us - phone.written_us) / 1e3;
+
+  if(write(fd, &r, sizeof(r)) == sizeof(r))
+    _exit(0);
+}
+
+
+/*
+* @brief Record bench: packs BENCH_RECORD_SAMPLES PM samples into uplink
+*        batches and decodes them again, best of BENCH_RECORD_REPS timed
+*        passes each way.
+*/
+static void bench_record(bench_result_t *res)
+{
+  static pm_sample_t in[BENCH_RECORD_SAMPLES];
+  static pm_sample_t out[BENCH_RECORD_SAMPLES];
+  static uint8_t store[BENCH_RECORD_SAMPLES * 16];
+  static uint16_t lens[BENCH_RECORD_SAMPLES];
+  static uplink_batch_t batch;
+  struct timespec t0;
+  struct timespec t1;
+  char text[128];
+  uint64_t text_bytes = 0;
+  size_t stored;
+  size_t batches;
+  size_t decoded;
+  uint32_t mismatches = 0;
+  int32_t pm25 = 12;
+  double best_enc = 0;
+  double best_dec = 0;
+  double ns;
+  size_t off;
+  size_t i;
+  int rep;
+  int n;
+
+  // A frame about a second apart, PM wandering slowly and the HDC1080's
+  // temperature and humidity with their last digit or two of noise.
+  memset(in, 0, sizeof(in));
+  for(i = 0; i < BENCH_RECORD_SAMPLES; i++)
+  {
+    pm25 += (int32_t) (rnd() % 5) - 2;
+    if(pm25 < 1)
+      pm25 = 1;
+    in[i].time_us = (int64_t) i * 1000000 + (int64_t) (rnd() % 2000);
+    in[i].utc_us = in[i].time_us + 1790000000000000LL;
+    in[i].seq = i;
+    in[i].pm1 = pm25 * 2 / 3;
+    in[i].pm2_5 = pm25;
+    in[i].pm10 = pm25 * 4 / 3;
+    in[i].temp = 2150 + (int16_t) (rnd() % 40);
+    in[i].hum = 3800 + (uint16_t) (rnd() % 80);
+
+    // What the PM driver printed for every frame before there was a format.
+    text_bytes += snprintf(text, sizeof(text),
+                           "------------------\nPM 1: %d\nPM 2.5: %d\nPM 10: %d\n------------------\n",
+                           in[i].pm1, in[i].pm2_5, in[i].pm10);
+  }
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    stored = 0;
+    batches = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    uplink_batch_init(&batch);
+    for(i = 0; i < BENCH_RECORD_SAMPLES; i++)
+    {
+      if(!uplink_batch_add(&batch, &in[i]))
+      {
+        memcpy(store + stored, batch.buf, batch.len);
+        stored += batch.len;
+        lens[batches++] = batch.len;
+        uplink_batch_init(&batch);
+        uplink_batch_add(&batch, &in[i]);
+      }
+    }
+    memcpy(store + stored, batch.buf, batch.len);
+    stored += batch.len;
+    lens[batches++] = batch.len;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_RECORD_SAMPLES;
+    if(rep == 0 || ns < best_enc)
+      best_enc = ns;
+  }
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    decoded = 0;
+    off = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < batches; i++)
+    {
+      n = uplink_batch_decode(store + off, lens[i], out + decoded, BENCH_RECORD_SAMPLES - decoded);
+      if(n > 0)
+        decoded += n;
+      off += lens[i];
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_RECORD_SAMPLES;
+    if(rep == 0 || ns < best_dec)
+      best_dec = ns;
+  }
+
+  // Times come back to the ms, everything else exactly.
+  mismatches = BENCH_RECORD_SAMPLES - decoded;
+  for(i = 0; i < decoded; i++)
+  {
+    if(llabs(out[i].time_us - in[i].time_us) > 500 || llabs(out[i].utc_us - in[i].utc_us) > 500 ||
+       out[i].seq != in[i].seq || out[i].channel != in[i].channel || out[i].pm1 != in[i].pm1 ||
+       out[i].pm2_5 != in[i].pm2_5 || out[i].pm10 != in[i].pm10 || out[i].temp != in[i].temp ||
+       out[i].hum != in[i].hum)
+      mismatches++;
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"record\",");
+  res->bench = BENCH_RECORD;
+  res->v[M_BYTES_PER_SAMPLE] = (double) stored / BENCH_RECORD_SAMPLES;
+  res->v[M_TEXT_BYTES] = (double) text_bytes / BENCH_RECORD_SAMPLES;
+  res->v[M_ENCODE_NS] = best_enc;
+  res->v[M_DECODE_NS] = best_dec;
+  res->v[M_MISMATCHES] = mismatches;
+}
+
+
+/*
+* @brief RAM card read callback for the SD backlog bench.
+*/
+static esp_err_t card_read(void *ctx, uint32_t sector, void *buf, uint32_t count)
+{
+  memcpy(buf, (uint8_t *) ctx + sector * SDLOG_SECTOR_SIZE, count * SDLOG_SECTOR_SIZE);
+  return ESP_OK;
+}
+
+
+/*
+* @brief RAM card write callback for the SD backlog bench.
+*/
+static esp_err_t card_write(void *ctx, uint32_t sector, const void *buf, uint32_t count)
+{
+  memcpy((uint8_t *) ctx + sector * SDLOG_SECTOR_SIZE, buf, count * SDLOG_SECTOR_SIZE);
+  return ESP_OK;
+}
+
+
+/*
+* @brief SD backlog bench: BENCH_RECORD_SAMPLES PM samples appended with a
+*        flush every UPLINK_FLUSH_SAMPLES, as the uplink spills them, then
+*        read back UPLINK_REPLAY_SAMPLES at a time with an ack after each,
+*        as it replays them. Best of BENCH_RECORD_REPS passes on a blank
+*        RAM card each way; the card is RAM so only the log's own work is
+*        timed.
+*/
+static void bench_sdlog(bench_result_t *res)
+{
+  static pm_sample_t in[BENCH_RECORD_SAMPLES];
+  static pm_sample_t out[BENCH_RECORD_SAMPLES];
+  static uint8_t card[(2 + BENCH_SDLOG_SECTORS) * SDLOG_SECTOR_SIZE];
+  static sdlog_t log;
+  sdlog_bdev_t bdev = { card_read, card_write, card };
+  struct timespec t0;
+  struct timespec t1;
+  uint32_t sectors = 0;
+  uint32_t writes = 0;
+  uint32_t mismatches;
+  int32_t pm25 = 12;
+  double best_app = 0;
+  double best_rep = 0;
+  double ns;
+  size_t decoded = 0;
+  size_t i;
+  int rep;
+  int n;
+
+  // Its own seed, so the bytes on the card don't depend on the benches
+  // run before it.
+  bench_seed = 1;
+  memset(in, 0, sizeof(in));
+  for(i = 0; i < BENCH_RECORD_SAMPLES; i++)
+  {
+    pm25 += (int32_t) (rnd() % 5) - 2;
+    if(pm25 < 1)
+      pm25 = 1;
+    in[i].time_us = (int64_t) i * 1000000 + (int64_t) (rnd() % 2000);
+    in[i].utc_us = in[i].time_us + 1790000000000000LL;
+    in[i].seq = i;
+    in[i].pm1 = pm25 * 2 / 3;
+    in[i].pm2_5 = pm25;
+    in[i].pm10 = pm25 * 4 / 3;
+    in[i].temp = 2150 + (int16_t) (rnd() % 40);
+    in[i].hum = 3800 + (uint16_t) (rnd() % 80);
+  }
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    memset(card, 0, sizeof(card));
+    sdlog_mount(&log, &bdev, 0, BENCH_SDLOG_SECTORS);
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < BENCH_RECORD_SAMPLES; i++)
+    {
+      sdlog_append(&log, &in[i]);
+      if((i + 1) % UPLINK_FLUSH_SAMPLES == 0)
+        sdlog_flush(&log);
+    }
+    sdlog_flush(&log);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_RECORD_SAMPLES;
+    if(rep == 0 || ns < best_app)
+      best_app = ns;
+    sectors = log.stats.sectors_written;
+    writes = log.stats.writes;
+
+    decoded = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    while(decoded < BENCH_RECORD_SAMPLES)
+    {
+      n = sdlog_read(&log, out + decoded, UPLINK_REPLAY_SAMPLES);
+      if(n <= 0)
+        break;
+      sdlog_ack(&log);
+      decoded += n;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_RECORD_SAMPLES;
+    if(rep == 0 || ns < best_rep)
+      best_rep = ns;
+  }
+
+  // Times come back to the ms, everything else exactly.
+  mismatches = BENCH_RECORD_SAMPLES - decoded;
+  for(i = 0; i < decoded; i++)
+  {
+    if(llabs(out[i].time_us - in[i].time_us) > 500 || llabs(out[i].utc_us - in[i].utc_us) > 500 ||
+       out[i].seq != in[i].seq || out[i].channel != in[i].channel || out[i].pm1 != in[i].pm1 ||
+       out[i].pm2_5 != in[i].pm2_5 || out[i].pm10 != in[i].pm10 || out[i].temp != in[i].temp ||
+       out[i].hum != in[i].hum)
+      mismatches++;
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"sdlog\",");
+  res->bench = BENCH_SDLOG;
+  res->v[M_BYTES_PER_SAMPLE] = (double) sectors * SDLOG_SECTOR_SIZE / BENCH_RECORD_SAMPLES;
+  res->v[M_CARD_WRITES] = writes;
+  res->v[M_APPEND_NS] = best_app;
+  res->v[M_REPLAY_NS] = best_rep;
+  res->v[M_MISMATCHES] = mismatches;
+}
+
+
+/*
+* @brief Listen bench: runs listen_child() in a new process and collects
+*        its results.
+*
+* @return 0 on success
+*/
+static int bench_listen(bench_result_t *res)
+{
+  bench_listen_t r;
+  pid_t pid;
+  int fds[2];
+  int status;
+  ssize_t n;
+
+  if(pipe(fds) != 0)
+    return -1;
+
+  fflush(stdout);
+  pid = fork();
+  if(pid < 0)
+    return -1;
+  if(pid == 0)
+  {
+    close(fds[0]);
+    listen_child(fds[1]);
+    _exit(1);
+  }
+
+  close(fds[1]);
+  n = read(fds[0], &r, sizeof(r));
+  close(fds[0]);
+  if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+     n != sizeof(r))
+    return -1;
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"listen\",\"rate\":%u,", BENCH_LISTEN_RATE);
+  res->bench = BENCH_LISTEN;
+  res->v[M_EXPECTED] = r.sent;
+  res->v[M_FRAMES] = r.frames;
+  res->v[M_LOST] = (r.sent > r.frames) ? r.sent - r.frames : 0;
+  res->v[M_LISTEN_MISSES] = r.listen_misses;
+  res->v[M_BYTES_ASLEEP] = r.bytes_asleep;
+  res->v[M_AWAKE_PCT] = r.awake_pct;
+
+  return 0;
+}
+
+
+/*
+* @brief One listen run: light sleep on, the PMS model on channel 0's UART
+*        and pins, the PM driver and the sensor task brought up like
+*        app_main() does with the fan kept on, for BENCH_LISTEN_S. The
+*        counts are taken just after a frame has gone through, so none is
+*        on the wire. Writes a bench_listen_t to 'fd'.
+*/
+static void listen_child(int fd)
+{
+  const pm_power_config_t always_on = { 0, 0, PM_POWER_SETTLE_MS, PM_POWER_QUERY_MS };
+  power_stats_t locks[POWER_MAX_LOCKS];
+  bench_listen_t r;
+  sim_pms_stats_t pms;
+  sim_uart_stats_t uart;
+  pm_stats_t pm;
+  uint64_t held_us = 0;
+  uint32_t sent;
+  size_t n;
+  size_t i;
+
+  sim_log_level(ESP_LOG_ERROR);
+  sim_clock_init(BENCH_LISTEN_RATE, 0, 0);
+
+  if(power_init() != ESP_OK)
+    return;
+  if(sim_pms_attach(pm_channels[0].uart, pm_channels[0].set_pin, pm_channels[0].reset_pin, 12) != ESP_OK)
+    return;
+  PM_set_power(&always_on);
+  if(PM_init() != ESP_OK || sensor_start() != ESP_OK)
+    return;
+
+  sim_sleep_until((int64_t) BENCH_LISTEN_S * 1000000);
+  sim_pms_get_stats(&pms);
+  sent = pms.frames;
+  do
+  {
+    sim_sleep_until(esp_timer_get_time() + 10000);
+    sim_pms_get_stats(&pms);
+  } while(pms.frames == sent);
+  sim_sleep_until(esp_timer_get_time() + PM_FRAME_US + 100000);
+
+  sim_pms_get_stats(&pms);
+  PM_get_stats(0, &pm);
+  sim_uart_get_stats(pm_channels[0].uart, &uart);
+  n = power_get_stats(locks, POWER_MAX_LOCKS);
+  for(i = 0; i < n; i++)
+  {
+    if(locks[i].type == POWER_NO_SLEEP)
+      held_us += locks[i].held_us;
+  }
+
+  memset(&r, 0, sizeof(r));
+  r.sent = pms.frames;
+  r.frames = pm.framer.frames;
+  r.listen_misses = pm.listen_misses;
+  r.bytes_asleep = uart.bytes_asleep;
+  r.awake_pct = 100.0 * held_us / esp_timer_get_time();
+
+  if(write(fd, &r, sizeof(r)) == sizeof(r))
+    _exit(0);
+}
+
+
+/*
+* @brief Trace bench: best of BENCH_RECORD_REPS timed passes of
+*        BENCH_TRACE_ENTRIES entries each through trace_ring_put(),
+*        trace_ring_drain() and trace_format().
+*/
+static void bench_trace(bench_result_t *res)
+{
+  static trace_ring_t ring;
+  static trace_entry_t batch[TRACE_RING_SIZE];
+  struct timespec t0;
+  struct timespec t1;
+  char line[128];
+  double best_put = 0;
+  double best_drain = 0;
+  double best_format = 0;
+  double ns;
+  uint64_t drain_ns;
+  uint32_t drained;
+  uint32_t i;
+  uint32_t k;
+  size_t n;
+  int rep;
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    trace_ring_init(&ring);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < BENCH_TRACE_ENTRIES; i++)
+      trace_ring_put(&ring, i, TR_PM_FRAMES, i, i >> 3, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / BENCH_TRACE_ENTRIES;
+    if(rep == 0 || ns < best_put)
+      best_put = ns;
+  }
+
+  // A ring's worth at a time, only the drain timed.
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    trace_ring_init(&ring);
+    drain_ns = 0;
+    drained = 0;
+    for(i = 0; i < BENCH_TRACE_ENTRIES; i += TRACE_RING_SIZE)
+    {
+      for(k = 0; k < TRACE_RING_SIZE; k++)
+        trace_ring_put(&ring, i + k, TR_PM_FRAMES, i, k, 0);
+      clock_gettime(CLOCK_MONOTONIC, &t0);
+      while((n = trace_ring_drain(&ring, batch, BENCH_TRACE_BATCH)) > 0)
+        drained += n;
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      drain_ns += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+    }
+    ns = (double) drain_ns / drained;
+    if(rep == 0 || ns < best_drain)
+      best_drain = ns;
+  }
+
+  // Every trace point in turn, as the PM driver's traces mostly are.
+  for(k = 0; k < TRACE_RING_SIZE; k++)
+  {
+    memset(&batch[k], 0, sizeof(batch[k]));
+    batch[k].time_us = k * 1000003u;
+    batch[k].id = k % TRACE_NUM_IDS;
+    batch[k].args[0] = k * 7;
+    batch[k].args[1] = k;
+    batch[k].args[2] = 1;
+  }
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < BENCH_TRACE_ENTRIES / 4; i++)
+      bench_sink += trace_format(&batch[i % TRACE_RING_SIZE], line, sizeof(line));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (BENCH_TRACE_ENTRIES / 4);
+    if(rep == 0 || ns < best_format)
+      best_format = ns;
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"trace\",");
+  res->bench = BENCH_TRACE;
+  res->v[M_PUT_NS] = best_put;
+  res->v[M_DRAIN_NS] = best_drain;
+  res->v[M_FORMAT_NS] = best_format;
+}
+
+
+/*
+* @brief Time servo bench: an hour of timesync_sim() with the rate error
+*        wandering a little every second and esp_timer well off UTC.
+*/
+static void bench_timesync(const bench_timesync_t *scenario, bench_result_t *res)
+{
+  timesync_sim_t sim;
+  timesync_sim_report_t report;
+
+  memset(&sim, 0, sizeof(sim));
+  sim.seconds = BENCH_TIMESYNC_S;
+  sim.freq_ppb = scenario->freq_ppb;
+  sim.wander_ppb = 2;
+  sim.offset_us = 12345678;
+  sim.source = scenario->source;
+  sim.jitter_us = scenario->jitter_us;
+  sim.spike_every = scenario->spike_every;
+  sim.spike_us = scenario->spike_us;
+  sim.settle_s = BENCH_TIMESYNC_SETTLE_S;
+  sim.seed = 1;
+  timesync_sim(&sim, &report);
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"timesync\",\"scenario\":\"%s\",", scenario->name);
+  res->bench = BENCH_TIMESYNC;
+  res->v[M_LOCK_S] = report.lock_s;
+  res->v[M_MAX_ERR_US] = report.max_err_us;
+  res->v[M_RMS_ERR_US] = report.rms_err_us;
+  res->v[M_FREQ_ERR_PPB] = report.freq_err_ppb;
+  res->v[M_SPIKES] = (scenario->spike_every > 0) ? BENCH_TIMESYNC_S / scenario->spike_every : 0;
+  res->v[M_SPIKES_REJECTED] = report.stats.spikes;
+  res->v[M_CLOCK_STEPS] = report.stats.steps;
+}
+
+
+/*
+* @brief Generates an NMEA capture of about 'size' bytes: every second the
+*        GGA, GSA, three GSV, RMC, VTG and ZDA the L70 sends with ZDA on,
+*        from a receiver wandering around Salt Lake City. Every
+*        BENCH_NMEA_BAD-th sentence has a digit of its time flipped after
+*        the checksum was worked out.
+*
+* @param gen  - filled in with the capture and what went into it; free
+*               gen->data, gen->lat and gen->lon
+* @param size - bytes wanted
+*
+* @return void
+*/
+static void make_nmea(bench_nmea_t *gen, size_t size)
+{
+  char body[NMEA_MAX_LEN];
+  char hms[16];
+  uint32_t max_s = size / 256 + 1;
+  int32_t lat_min = 450000;             // 40 45.0000 N, minutes * 10^4
+  int32_t lon_min = 530000;             // 111 53.0000 W
+  uint32_t sats;
+  uint32_t t;
+  uint32_t k;
+  size_t n = 0;
+  int i;
+
+  memset(gen, 0, sizeof(*gen));
+  gen->data = malloc(size + 512);
+  gen->lat = malloc(max_s * sizeof(gen->lat[0]));
+  gen->lon = malloc(max_s * sizeof(gen->lon[0]));
+  bench_seed = 12;
+
+  for(t = 0; n < size && t < max_s && t < 86400; t++)
+  {
+    lat_min += (int32_t) (rnd() % 41) - 20;
+    lon_min += (int32_t) (rnd() % 41) - 20;
+    gen->lat[t] = (int32_t) ((40 + lat_min / 600000.0) * 1e7 + 0.5);
+    gen->lon[t] = -(int32_t) ((111 + lon_min / 600000.0) * 1e7 + 0.5);
+    sats = 6 + rnd() % 7;
+    snprintf(hms, sizeof(hms), "%02u%02u%02u.000", t / 3600, t / 60 % 60, t % 60);
+
+    for(i = 0; i < 8; i++)
+    {
+      switch(i)
+      {
+        case 0:
+          snprintf(body, sizeof(body), "GPGGA,%s,40%02d.%04d,N,111%02d.%04d,W,1,%02u,%u.%02u,%u.%u,M,-17.0,M,,",
+                   hms, lat_min / 10000, lat_min % 10000, lon_min / 10000, lon_min % 10000, sats,
+                   1 + rnd() % 2, rnd() % 100, 1280 + rnd() % 40, rnd() % 10);
+          break;
+        case 1:
+          snprintf(body, sizeof(body), "GPGSA,A,3,14,22,31,32,01,03,11,%02u,,,,,1.%02u,1.%02u,0.%02u",
+                   sats + 10, rnd() % 100, rnd() % 100, rnd() % 100);
+          break;
+        case 2:
+        case 3:
+        case 4:
+          k = i - 1;
+          snprintf(body, sizeof(body), "GPGSV,3,%u,12,%02u,%02u,%03u,%02u,%02u,%02u,%03u,%02u,%02u,%02u,%03u,%02u,"
+                   "%02u,%02u,%03u,%02u", k, 4 * k - 3, rnd() % 90, rnd() % 360, 20 + rnd() % 30,
+                   4 * k - 2, rnd() % 90, rnd() % 360, 20 + rnd() % 30, 4 * k - 1, rnd() % 90,
+                   rnd() % 360, 20 + rnd() % 30, 4 * k, rnd() % 90, rnd() % 360, 20 + rnd() % 30);
+          break;
+        case 5:
+          snprintf(body, sizeof(body), "GPRMC,%s,A,40%02d.%04d,N,111%02d.%04d,W,0.%02u,%u.%02u,%02u1026,,,A",
+                   hms, lat_min / 10000, lat_min % 10000, lon_min / 10000, lon_min % 10000, rnd() % 100,
+                   rnd() % 360, rnd() % 100, 17 + t / 86400);
+          break;
+        case 6:
+          snprintf(body, sizeof(body), "GPVTG,%u.%02u,T,,M,0.%02u,N,0.%02u,K,A",
+                   rnd() % 360, rnd() % 100, rnd() % 100, rnd() % 100);
+          break;
+        default:
+          snprintf(body, sizeof(body), "GPZDA,%s,17,10,2026,00,00", hms);
+          break;
+      }
+
+      gen->sentences++;
+      if(gen->sentences % BENCH_NMEA_BAD == 0)
+        gen->bad++;
+      n += put_sentence((char *) gen->data + n, body, gen->sentences % BENCH_NMEA_BAD == 0);
+    }
+  }
+
+  gen->len = n;
+  gen->seconds = t;
+}
+
+
+/*
+* @brief Writes "$BODY*CS\r\n". A bad sentence gets the first digit of its
+*        time changed after the checksum is worked out.
+*
+* @return bytes written
+*/
+static size_t put_sentence(char *out, const char *body, int bad)
+{
+  uint8_t sum = 0;
+  size_t len;
+  size_t i;
+
+  for(i = 0; body[i] != '\0'; i++)
+    sum ^= (uint8_t) body[i];
+
+  len = sprintf(out, "$%s*%02X\r\n", body, sum);
+  if(bad)
+    out[7] ^= 1;                        // "$GPxxx,h": '0' <-> '1', ...
+
+  return len;
+}
+
+
+/*
+* @brief NMEA bench: parses the capture in BENCH_NMEA_CHUNK byte reads, as
+*        gps.c does on every UART event. The throughput passes time whole
+*        passes; the latency passes time every nmea_next() call and add up
+*        the calls that went into each sentence, keeping each sentence's
+*        best.
+*/
+static void bench_nmea(bench_result_t *res)
+{
+  static nmea_parser_t parser;
+  bench_nmea_t gen;
+  struct timespec t0;
+  struct timespec t1;
+  const uint8_t *p;
+  uint32_t *lat_ns;
+  uint32_t sentences = 0;
+  uint32_t mismatches = 0;
+  uint32_t n;
+  uint32_t sec;
+  uint64_t acc_ns;
+  double best_s = 0;
+  double elapsed;
+  nmea_type_t type;
+  size_t off;
+  size_t len;
+  int rep;
+
+  make_nmea(&gen, BENCH_NMEA_BYTES);
+  lat_ns = malloc(gen.sentences * sizeof(lat_ns[0]));
+  memset(lat_ns, 0xFF, gen.sentences * sizeof(lat_ns[0]));
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    nmea_init(&parser);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(off = 0; off < gen.len; off += BENCH_NMEA_CHUNK)
+    {
+      p = gen.data + off;
+      len = (gen.len - off < BENCH_NMEA_CHUNK) ? gen.len - off : BENCH_NMEA_CHUNK;
+      while(nmea_next(&parser, &p, &len, 0) != NMEA_NONE)
+        ;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    if(rep == 0 || elapsed < best_s)
+      best_s = elapsed;
+    sentences = parser.stats.sentences;
+  }
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    nmea_init(&parser);
+    mismatches = 0;
+    acc_ns = 0;
+    n = 0;
+    for(off = 0; off < gen.len; off += BENCH_NMEA_CHUNK)
+    {
+      p = gen.data + off;
+      len = (gen.len - off < BENCH_NMEA_CHUNK) ? gen.len - off : BENCH_NMEA_CHUNK;
+      for(;;)
+      {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        type = nmea_next(&parser, &p, &len, 0);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        acc_ns += (t1.tv_sec - t0.tv_sec) * 1000000000LL + (t1.tv_nsec - t0.tv_nsec);
+        if(type == NMEA_NONE)
+          break;
+
+        if(n < gen.sentences && acc_ns < lat_ns[n])
+          lat_ns[n] = (uint32_t) acc_ns;
+        n++;
+        acc_ns = 0;
+
+        if(type == NMEA_RMC)
+        {
+          sec = parser.fix.utc_ms / 1000;
+          if(parser.fix.utc_ms % 1000 != 0 || sec >= gen.seconds ||
+             parser.fix.lat < gen.lat[sec] - 1 || parser.fix.lat > gen.lat[sec] + 1 ||
+             parser.fix.lon < gen.lon[sec] - 1 || parser.fix.lon > gen.lon[sec] + 1 ||
+             parser.fix.day != 17 || parser.fix.month != 10 || parser.fix.year != 2026)
+            mismatches++;
+        }
+      }
+    }
+
+  }
+  qsort(lat_ns, sentences, sizeof(lat_ns[0]), cmp_u32);
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"nmea\",");
+  res->bench = BENCH_NMEA;
+  res->v[M_MBYTES] = gen.len / 1048576.0;
+  res->v[M_SENTENCES] = sentences;
+  res->v[M_EXPECTED] = gen.sentences - gen.bad;
+  res->v[M_CHECKSUM_ERRS] = parser.stats.checksum_errs;
+  res->v[M_MISMATCHES] = mismatches;
+  res->v[M_SENTENCES_PER_S] = sentences / best_s;
+  res->v[M_SENTENCE_P99_NS] = (sentences > 0) ? lat_ns[(sentences * 99) / 100] : 0;
+  res->v[M_SENTENCE_MAX_NS] = (sentences > 0) ? lat_ns[sentences - 1] : 0;
+
+  free(lat_ns);
+  free(gen.data);
+  free(gen.lat);
+  free(gen.lon);
+}
+
+
+/*
+* @brief MiCS-4514 filter and calibration throughput.
+*
+* @param res - result
+*/
+static void bench_mics(bench_result_t *res)
+{
+  static int16_t codes[BENCH_MICS_CODES];
+  const mics_cal_config_t config = MICS_CAL_CONFIG_DEFAULT();
+  static mics_cal_t cal;
+  mics_boxcar_t f;
+  struct timespec t0;
+  struct timespec t1;
+  uint16_t out;
+  uint32_t sum;
+  uint32_t code;
+  uint32_t i;
+  double best_samples = 0;
+  double best_cal = 0;
+  double ns;
+  int rep;
+
+  // A slow swing over most of the range with a few codes of noise.
+  bench_seed = 1;
+  for(i = 0; i < BENCH_MICS_CODES; i++)
+    codes[i] = (int16_t) (1024 + (int32_t) ((i >> 4) % 1600) - 800 + (int32_t) (rnd() % 5) - 2);
+  mics_cal_init(&cal, &config);
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    mics_boxcar_init(&f, MICS_OVERSAMPLE_LOG2);
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < BENCH_MICS_CODES; i++)
+    {
+      if(mics_boxcar_add(&f, codes[i], &out))
+        sum += mics_cal_apply(&cal, out);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    bench_sink += sum;
+    ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    if(rep == 0 || BENCH_MICS_CODES / ns * 1e9 > best_samples)
+      best_samples = BENCH_MICS_CODES / ns * 1e9;
+  }
+
+  for(rep = 0; rep < BENCH_RECORD_REPS; rep++)
+  {
+    sum = 0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for(i = 0; i < 64; i++)
+    {
+      for(code = 0; code <= UINT16_MAX; code++)
+        sum += mics_cal_apply(&cal, code);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    bench_sink += sum;
+    ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / (64.0 * (UINT16_MAX + 1));
+    if(rep == 0 || ns < best_cal)
+      best_cal = ns;
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"mics\",");
+  res->bench = BENCH_MICS;
+  res->v[M_SAMPLES_PER_S] = best_samples;
+  res->v[M_CAL_NS] = best_cal;
+}
+
+/*
+* @brief A day of duty cycles on the simulated clock.
+*
+* @param scenario - schedule and faults
+* @param res      - result
+*/
+static void bench_duty(const bench_duty_t *scenario, bench_result_t *res)
+{
+  static duty_state_t state;
+  duty_config_t config = DUTY_CONFIG_DEFAULT();
+  const duty_power_t power = DUTY_POWER_DEFAULT();
+  duty_sim_t sim;
+  duty_report_t report;
+  uint64_t energy_uj = 0;
+  uint64_t awake_us = 0;
+  uint64_t period_us = 0;
+  uint32_t sent = 0;
+  uint32_t max_age_s = 0;
+  uint32_t i;
+
+  config.sensor_switched = scenario->sensor_switched;
+  config.uplink_every = scenario->uplink_every;
+
+  memset(&sim, 0, sizeof(sim));
+  sim.frame_interval_ms = BENCH_PERIOD_MS;
+  sim.frame_error_every = scenario->frame_error_every;
+  sim.wifi_connect_ms = 3000;
+  sim.post_ms = 500;
+  sim.uplink_fail_every = scenario->uplink_fail_every;
+  sim.pm2_5 = 12;
+
+  // Power on: the RTC state is not valid yet.
+  memset(&state, 0, sizeof(state));
+  for(i = 0; i < BENCH_DUTY_CYCLES; i++)
+  {
+    duty_sim(&state, &config, &power, &sim, &report);
+    energy_uj += report.energy_uj;
+    awake_us += report.awake_us;
+    period_us += (uint64_t) report.awake_us + report.sleep_us;
+    sent += report.records_sent;
+    if(report.data_age_s > max_age_s)
+      max_age_s = report.data_age_s;
+  }
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->key, sizeof(res->key), "\"bench\":\"duty\",\"scenario\":\"%s\",", scenario->name);
+  res->bench = BENCH_DUTY;
+  res->v[M_EXPECTED] = BENCH_DUTY_CYCLES;
+  res->v[M_RECORDS] = sent;
+  res->v[M_LOST] = state.records_lost;
+  // Whole units, so they compare exactly with what was printed.
+  res->v[M_ENERGY_UJ] = energy_uj / BENCH_DUTY_CYCLES;
+  res->v[M_AVG_UA] = energy_uj * 1000 / power.supply_mv * 1000000 / period_us;
+  res->v[M_AWAKE_MS] = awake_us / BENCH_DUTY_CYCLES / 1000;
+  res->v[M_DATA_AGE_S] = max_age_s;
+}
+
+
+
+
+/*
+* @brief Prints a result as one JSON object.
+*/
+static void print_result(const bench_result_t *res)
+{
+  const char *sep = "";
+  int i;
+
+  printf("{%s", res->key);
+  for(i = 0; i < M_NUM; i++)
+  {
+    if(bench_metrics[i].benches & res->bench)
+    {
+      printf("%s\"%s\":%.*f", sep, bench_metrics[i].name, bench_metrics[i].decimals, res->v[i]);
+      sep = ",";
+    }
+  }
+  printf("}\n");
+  fflush(stdout);
+}
+
+
+/*
+* @brief Compares results to a baseline written by an earlier run. Lines
+*        and metrics missing on either side are skipped.
+*
+* @return 0 if nothing regressed, 1 if something did, 2 if the baseline
+*         cannot be read
+*/
+static int compare(const char *path, const bench_result_t *results, size_t count, double factor)
+{
+  char line[1024];
+  char name[40];
+  const bench_metric_info_t *m;
+  const char *p;
+  double base;
+  double limit;
+  double now;
+  size_t matched = 0;
+  size_t i;
+  int regressions = 0;
+  int k;
+  FILE *f;
+
+  f = fopen(path, "r");
+  if(f == NULL)
+  {
+    fprintf(stderr, "cannot read %s\n", path);
+    return 2;
+  }
+
+  while(fgets(line, sizeof(line), f) != NULL)
+  {
+    for(i = 0; i < count; i++)
+    {
+      if(line[0] == '{' && strncmp(line + 1, results[i].key, strlen(results[i].key)) == 0)
+        break;
+    }
+    if(i == count)
+      continue;
+    matched++;
+
+    for(k = 0; k < M_NUM; k++)
+    {
+      m = &bench_metrics[k];
+      if(m->worse == 0 || !(m->benches & results[i].bench))
+        continue;
+
+      snprintf(name, sizeof(name), "\"%s\":", m->name);
+      p = strstr(line, name);
+      if(p == NULL)
+        continue;
+
+      base = strtod(p + strlen(name), NULL);
+      now = results[i].v[k];
+      if(m->worse > 0)
+      {
+        limit = base * (1 + m->pct * factor / 100) + m->slack * factor;
+        if(now <= limit)
+          continue;
+      }
+      else
+      {
+        limit = base * (1 - m->pct * factor / 100) - m->slack * factor;
+        if(now >= limit)
+          continue;
+      }
+
+      fprintf(stderr, "REGRESSION {%.*s} %s %.*f, baseline %.*f (limit %.*f)\n",
+              (int) strlen(results[i].key) - 1, results[i].key, m->name,
+              m->decimals, now, m->decimals, base, m->decimals, limit);
+      regressions++;
+    }
+  }
+  fclose(f);
+
+  fprintf(stderr, "%zu of %zu results compared to %s, %d regressions\n", matched, count, path, regressions);
+
+  return (regressions > 0) ? 1 : 0;
+}
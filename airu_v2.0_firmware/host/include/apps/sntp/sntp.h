@@ -0,0 +1,27 @@
+/*
+*	sntp.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the lwIP SNTP client. Once started it steps the
+*   simulated system clock to host UTC after one round trip, see sim.h.
+*/
+
+#ifndef _SIM_SNTP_H
+#define _SIM_SNTP_H
+
+#include <stdint.h>
+
+#define SNTP_OPMODE_POLL        0
+#define SNTP_OPMODE_LISTENONLY  1
+
+void sntp_setoperatingmode(uint8_t operating_mode);
+void sntp_setservername(uint8_t idx, const char *server);
+void sntp_init();
+void sntp_stop();
+
+#endif
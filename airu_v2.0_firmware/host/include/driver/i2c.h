@@ -0,0 +1,80 @@
+/*
+*	i2c.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the I2C master driver. Command links are replayed
+*   against the device models attached with sim_i2c_attach(), see sim.h;
+*   addresses with no model NACK.
+*/
+
+#ifndef _SIM_I2C_H
+#define _SIM_I2C_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+typedef enum
+{
+  I2C_NUM_0,
+  I2C_NUM_1,
+  I2C_NUM_MAX
+} i2c_port_t;
+
+typedef enum
+{
+  I2C_MODE_SLAVE,
+  I2C_MODE_MASTER
+} i2c_mode_t;
+
+typedef enum
+{
+  I2C_MASTER_WRITE,
+  I2C_MASTER_READ
+} i2c_rw_t;
+
+typedef enum
+{
+  I2C_MASTER_ACK,
+  I2C_MASTER_NACK,
+  I2C_MASTER_LAST_NACK
+} i2c_ack_type_t;
+
+typedef struct
+{
+  i2c_mode_t mode;
+  int sda_io_num;
+  gpio_pullup_t sda_pullup_en;
+  int scl_io_num;
+  gpio_pullup_t scl_pullup_en;
+  struct
+  {
+    uint32_t clk_speed;
+  } master;
+} i2c_config_t;
+
+typedef struct sim_i2c_cmd *i2c_cmd_handle_t;
+
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf);
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags);
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num);
+i2c_cmd_handle_t i2c_cmd_link_create();
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en);
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, bool ack_en);
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack);
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack);
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle);
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait);
+
+#endif
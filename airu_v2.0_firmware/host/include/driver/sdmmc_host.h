@@ -0,0 +1,51 @@
+/*
+*	sdmmc_host.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the SDMMC host driver. The "card" is an image file,
+*   see sim.h.
+*/
+
+#ifndef _SIM_SDMMC_HOST_H
+#define _SIM_SDMMC_HOST_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdmmc_types.h"
+
+#define SDMMC_HOST_SLOT_0         0
+#define SDMMC_HOST_SLOT_1         1
+#define SDMMC_HOST_FLAG_1BIT      (1 << 0)
+#define SDMMC_HOST_FLAG_4BIT      (1 << 1)
+#define SDMMC_FREQ_DEFAULT        20000
+#define SDMMC_SLOT_WIDTH_DEFAULT  0
+
+#define SDMMC_HOST_DEFAULT() {                                    \
+    .flags = SDMMC_HOST_FLAG_4BIT | SDMMC_HOST_FLAG_1BIT,         \
+    .slot = SDMMC_HOST_SLOT_1,                                    \
+    .max_freq_khz = SDMMC_FREQ_DEFAULT                            \
+  }
+
+#define SDMMC_SLOT_CONFIG_DEFAULT() {                             \
+    .gpio_cd = -1,                                                \
+    .gpio_wp = -1,                                                \
+    .width = SDMMC_SLOT_WIDTH_DEFAULT                             \
+  }
+
+typedef struct
+{
+  int gpio_cd;
+  int gpio_wp;
+  uint8_t width;
+} sdmmc_slot_config_t;
+
+esp_err_t sdmmc_host_init();
+esp_err_t sdmmc_host_init_slot(int slot, const sdmmc_slot_config_t *slot_config);
+esp_err_t sdmmc_host_deinit();
+
+#endif
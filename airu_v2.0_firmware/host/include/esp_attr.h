@@ -0,0 +1,22 @@
+/*
+*	esp_attr.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the placement attributes. RTC slow memory is a named
+*   section that sim_sleep.c saves across a simulated deep sleep.
+*/
+
+#ifndef _SIM_ESP_ATTR_H
+#define _SIM_ESP_ATTR_H
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR     __attribute__((section("sim_rtc_data")))
+#define RTC_RODATA_ATTR   __attribute__((section("sim_rtc_data")))
+
+#endif
@@ -0,0 +1,61 @@
+/*
+*	esp_bt.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the Bluetooth controller. Initialising it takes heap
+*   and esp_bt_controller_mem_release() hands the controller's reserved
+*   DRAM to the heap, see sim_ble.c. No radio is modelled.
+*/
+
+#ifndef _SIM_ESP_BT_H
+#define _SIM_ESP_BT_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+typedef enum
+{
+  ESP_BT_MODE_IDLE = 0x00,
+  ESP_BT_MODE_BLE = 0x01,
+  ESP_BT_MODE_CLASSIC_BT = 0x02,
+  ESP_BT_MODE_BTDM = 0x03
+} esp_bt_mode_t;
+
+typedef enum
+{
+  ESP_BT_CONTROLLER_STATUS_IDLE = 0,
+  ESP_BT_CONTROLLER_STATUS_INITED,
+  ESP_BT_CONTROLLER_STATUS_ENABLED,
+  ESP_BT_CONTROLLER_STATUS_NUM
+} esp_bt_controller_status_t;
+
+typedef struct
+{
+  uint16_t controller_task_stack_size;
+  uint8_t controller_task_prio;
+  uint8_t mode;
+  uint8_t ble_max_conn;
+} esp_bt_controller_config_t;
+
+#define BT_CONTROLLER_INIT_CONFIG_DEFAULT() { \
+    .controller_task_stack_size = 3584,       \
+    .controller_task_prio = 23,               \
+    .mode = ESP_BT_MODE_BLE,                  \
+    .ble_max_conn = CONFIG_BT_ACL_CONNECTIONS \
+}
+
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg);
+esp_err_t esp_bt_controller_deinit();
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode);
+esp_err_t esp_bt_controller_disable();
+esp_bt_controller_status_t esp_bt_controller_get_status();
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode);
+
+#endif
@@ -0,0 +1,44 @@
+/*
+*	esp_bt_defs.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the Bluetooth definitions the firmware uses, see
+*   sim_ble.c.
+*/
+
+#ifndef _SIM_ESP_BT_DEFS_H
+#define _SIM_ESP_BT_DEFS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ESP_BD_ADDR_LEN     6
+#define ESP_UUID_LEN_16     2
+#define ESP_UUID_LEN_32     4
+#define ESP_UUID_LEN_128    16
+
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+typedef enum
+{
+  ESP_BT_STATUS_SUCCESS = 0,
+  ESP_BT_STATUS_FAIL
+} esp_bt_status_t;
+
+typedef struct
+{
+  uint16_t len;
+  union
+  {
+    uint16_t uuid16;
+    uint32_t uuid32;
+    uint8_t uuid128[ESP_UUID_LEN_128];
+  } uuid;
+} esp_bt_uuid_t;
+
+#endif
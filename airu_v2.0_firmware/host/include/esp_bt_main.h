@@ -0,0 +1,31 @@
+/*
+*	esp_bt_main.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for bringing Bluedroid up and down, see sim_ble.c.
+*/
+
+#ifndef _SIM_ESP_BT_MAIN_H
+#define _SIM_ESP_BT_MAIN_H
+
+#include "esp_err.h"
+
+typedef enum
+{
+  ESP_BLUEDROID_STATUS_UNINITIALIZED = 0,
+  ESP_BLUEDROID_STATUS_INITIALIZED,
+  ESP_BLUEDROID_STATUS_ENABLED
+} esp_bluedroid_status_t;
+
+esp_bluedroid_status_t esp_bluedroid_get_status();
+esp_err_t esp_bluedroid_init();
+esp_err_t esp_bluedroid_deinit();
+esp_err_t esp_bluedroid_enable();
+esp_err_t esp_bluedroid_disable();
+
+#endif
@@ -0,0 +1,111 @@
+/*
+*	esp_event.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the legacy (v3.x) system event types.
+*/
+
+#ifndef _SIM_ESP_EVENT_H
+#define _SIM_ESP_EVENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "tcpip_adapter.h"
+
+typedef enum
+{
+  SYSTEM_EVENT_WIFI_READY = 0,
+  SYSTEM_EVENT_SCAN_DONE,
+  SYSTEM_EVENT_STA_START,
+  SYSTEM_EVENT_STA_STOP,
+  SYSTEM_EVENT_STA_CONNECTED,
+  SYSTEM_EVENT_STA_DISCONNECTED,
+  SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+  SYSTEM_EVENT_STA_GOT_IP,
+  SYSTEM_EVENT_STA_LOST_IP,
+  SYSTEM_EVENT_STA_WPS_ER_SUCCESS,
+  SYSTEM_EVENT_STA_WPS_ER_FAILED,
+  SYSTEM_EVENT_STA_WPS_ER_TIMEOUT,
+  SYSTEM_EVENT_STA_WPS_ER_PIN,
+  SYSTEM_EVENT_AP_START,
+  SYSTEM_EVENT_AP_STOP,
+  SYSTEM_EVENT_AP_STACONNECTED,
+  SYSTEM_EVENT_AP_STADISCONNECTED,
+  SYSTEM_EVENT_AP_STAIPASSIGNED,
+  SYSTEM_EVENT_AP_PROBEREQRECVED,
+  SYSTEM_EVENT_GOT_IP6,
+  SYSTEM_EVENT_ETH_START,
+  SYSTEM_EVENT_ETH_STOP,
+  SYSTEM_EVENT_ETH_CONNECTED,
+  SYSTEM_EVENT_ETH_DISCONNECTED,
+  SYSTEM_EVENT_ETH_GOT_IP,
+  SYSTEM_EVENT_MAX
+} system_event_id_t;
+
+typedef struct
+{
+  uint8_t ssid[32];
+  uint8_t ssid_len;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t authmode;
+} system_event_sta_connected_t;
+
+typedef struct
+{
+  uint8_t ssid[32];
+  uint8_t ssid_len;
+  uint8_t bssid[6];
+  uint8_t reason;
+} system_event_sta_disconnected_t;
+
+typedef struct
+{
+  tcpip_adapter_ip_info_t ip_info;
+  bool ip_changed;
+} system_event_sta_got_ip_t;
+
+typedef struct
+{
+  uint8_t mac[6];
+  uint8_t aid;
+} system_event_ap_staconnected_t;
+
+typedef system_event_ap_staconnected_t system_event_ap_stadisconnected_t;
+
+typedef union
+{
+  system_event_sta_connected_t connected;
+  system_event_sta_disconnected_t disconnected;
+  system_event_sta_got_ip_t got_ip;
+  system_event_ap_staconnected_t sta_connected;
+  system_event_ap_stadisconnected_t sta_disconnected;
+} system_event_info_t;
+
+typedef struct
+{
+  system_event_id_t event_id;
+  system_event_info_t event_info;
+} system_event_t;
+
+typedef esp_err_t (*system_event_handler_t)(system_event_t *event);
+
+#define MACSTR        "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a)    (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+/*
+* @brief Queues an event for the event loop task.
+*
+* @param event - event, copied
+*
+* @return ESP_OK, or ESP_FAIL if the loop is not running or its queue is full
+*/
+esp_err_t esp_event_send(system_event_t *event);
+
+#endif
@@ -0,0 +1,21 @@
+/*
+*	esp_event_loop.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_ESP_EVENT_LOOP_H
+#define _SIM_ESP_EVENT_LOOP_H
+
+#include "esp_event.h"
+
+typedef esp_err_t (*system_event_cb_t)(void *ctx, system_event_t *event);
+
+/*
+* @brief Starts the event loop task, which passes every event to 'cb'.
+*/
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx);
+
+#endif
@@ -0,0 +1,139 @@
+/*
+*	esp_gap_ble_api.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for BLE GAP: advertising and connection parameters, see
+*   sim_ble.c. Events come on the BTC task as in Bluedroid.
+*/
+
+#ifndef _SIM_ESP_GAP_BLE_API_H
+#define _SIM_ESP_GAP_BLE_API_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_bt_defs.h"
+
+#define ESP_BLE_ADV_FLAG_LIMIT_DISC         (0x01 << 0)
+#define ESP_BLE_ADV_FLAG_GEN_DISC           (0x01 << 1)
+#define ESP_BLE_ADV_FLAG_BREDR_NOT_SPT      (0x01 << 2)
+
+typedef enum
+{
+  ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT = 0,
+  ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT,
+  ESP_GAP_BLE_ADV_START_COMPLETE_EVT = 6,
+  ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT = 17,
+  ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20
+} esp_gap_ble_cb_event_t;
+
+typedef enum
+{
+  ADV_TYPE_IND = 0x00,
+  ADV_TYPE_DIRECT_IND_HIGH = 0x01,
+  ADV_TYPE_SCAN_IND = 0x02,
+  ADV_TYPE_NONCONN_IND = 0x03
+} esp_ble_adv_type_t;
+
+typedef enum
+{
+  BLE_ADDR_TYPE_PUBLIC = 0x00,
+  BLE_ADDR_TYPE_RANDOM = 0x01
+} esp_ble_addr_type_t;
+
+typedef enum
+{
+  ADV_CHNL_37 = 0x01,
+  ADV_CHNL_38 = 0x02,
+  ADV_CHNL_39 = 0x04,
+  ADV_CHNL_ALL = 0x07
+} esp_ble_adv_channel_t;
+
+typedef enum
+{
+  ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY = 0x00
+} esp_ble_adv_filter_t;
+
+typedef struct
+{
+  uint16_t adv_int_min;     // 0.625 ms units
+  uint16_t adv_int_max;
+  esp_ble_adv_type_t adv_type;
+  esp_ble_addr_type_t own_addr_type;
+  esp_bd_addr_t peer_addr;
+  esp_ble_addr_type_t peer_addr_type;
+  esp_ble_adv_channel_t channel_map;
+  esp_ble_adv_filter_t adv_filter_policy;
+} esp_ble_adv_params_t;
+
+typedef struct
+{
+  bool set_scan_rsp;
+  bool include_name;
+  bool include_txpower;
+  int min_interval;
+  int max_interval;
+  int appearance;
+  uint16_t manufacturer_len;
+  uint8_t *p_manufacturer_data;
+  uint16_t service_data_len;
+  uint8_t *p_service_data;
+  uint16_t service_uuid_len;
+  uint8_t *p_service_uuid;
+  uint8_t flag;
+} esp_ble_adv_data_t;
+
+typedef struct
+{
+  esp_bd_addr_t bda;
+  uint16_t min_int;         // 1.25 ms units
+  uint16_t max_int;
+  uint16_t latency;
+  uint16_t timeout;         // 10 ms units
+} esp_ble_conn_update_params_t;
+
+typedef union
+{
+  struct ble_adv_data_cmpl_evt_param
+  {
+    esp_bt_status_t status;
+  } adv_data_cmpl;
+  struct ble_scan_rsp_data_cmpl_evt_param
+  {
+    esp_bt_status_t status;
+  } scan_rsp_data_cmpl;
+  struct ble_adv_start_cmpl_evt_param
+  {
+    esp_bt_status_t status;
+  } adv_start_cmpl;
+  struct ble_adv_stop_cmpl_evt_param
+  {
+    esp_bt_status_t status;
+  } adv_stop_cmpl;
+  struct ble_update_conn_params_evt_param
+  {
+    esp_bt_status_t status;
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t conn_int;
+    uint16_t timeout;
+  } update_conn_params;
+} esp_ble_gap_cb_param_t;
+
+typedef void (*esp_gap_ble_cb_t)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback);
+esp_err_t esp_ble_gap_config_adv_data(esp_ble_adv_data_t *adv_data);
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params);
+esp_err_t esp_ble_gap_stop_advertising();
+esp_err_t esp_ble_gap_set_device_name(const char *name);
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params);
+
+#endif
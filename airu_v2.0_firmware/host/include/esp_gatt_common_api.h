@@ -0,0 +1,26 @@
+/*
+*	esp_gatt_common_api.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the GATT settings shared by server and client, see
+*   sim_ble.c.
+*/
+
+#ifndef _SIM_ESP_GATT_COMMON_API_H
+#define _SIM_ESP_GATT_COMMON_API_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_gatt_defs.h"
+
+/*
+* @brief Largest MTU this side accepts in an MTU exchange.
+*/
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu);
+
+#endif
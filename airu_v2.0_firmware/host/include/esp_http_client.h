@@ -0,0 +1,56 @@
+/*
+*	esp_http_client.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the HTTP client. Requests never leave the process:
+*   each perform takes a configurable round trip of simulated time, can be
+*   made to fail, and the POST bodies can be written to a file for checking,
+*   see sim.h.
+*/
+
+#ifndef _SIM_ESP_HTTP_CLIENT_H
+#define _SIM_ESP_HTTP_CLIENT_H
+
+#include "esp_err.h"
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum
+{
+  HTTP_METHOD_GET,
+  HTTP_METHOD_POST,
+  HTTP_METHOD_PUT,
+  HTTP_METHOD_PATCH,
+  HTTP_METHOD_DELETE,
+  HTTP_METHOD_MAX
+} esp_http_client_method_t;
+
+typedef struct
+{
+  const char *url;
+  const char *host;
+  int port;
+  const char *path;
+  esp_http_client_method_t method;
+  int timeout_ms;
+  int buffer_size;
+} esp_http_client_config_t;
+
+#define ESP_ERR_HTTP_BASE     0x7000
+#define ESP_ERR_HTTP_CONNECT  (ESP_ERR_HTTP_BASE + 3)
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len);
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url);
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client);
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+#endif
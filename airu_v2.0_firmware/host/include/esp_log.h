@@ -0,0 +1,59 @@
+/*
+*	esp_log.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the ESP-IDF logging macros. Lines go to stdout in the
+*   same "I (ms) TAG: text" format as on the node, with the simulated time.
+*/
+
+#ifndef _SIM_ESP_LOG_H
+#define _SIM_ESP_LOG_H
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+typedef enum
+{
+  ESP_LOG_NONE,
+  ESP_LOG_ERROR,
+  ESP_LOG_WARN,
+  ESP_LOG_INFO,
+  ESP_LOG_DEBUG,
+  ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+
+/*
+* @brief Sets the level for one tag, "*" for all of them.
+*
+* @param tag   - log tag
+* @param level - most verbose level printed
+*
+* @return void
+*/
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+/*
+* @brief Prints one line if the tag's level allows it.
+*
+* @param level - message level
+* @param tag   - log tag
+* @param fmt   - printf format
+*
+* @return void
+*/
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, fmt, ...) esp_log_write(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) esp_log_write(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) esp_log_write(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) esp_log_write(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) esp_log_write(ESP_LOG_VERBOSE, tag, fmt, ##__VA_ARGS__)
+
+#endif
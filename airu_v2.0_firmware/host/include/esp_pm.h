@@ -0,0 +1,52 @@
+/*
+*	esp_pm.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for power management. Locks only count how long they are
+*   held; the host does not change frequency or sleep.
+*/
+
+#ifndef _SIM_ESP_PM_H
+#define _SIM_ESP_PM_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef enum
+{
+  RTC_CPU_FREQ_XTAL,
+  RTC_CPU_FREQ_80M,
+  RTC_CPU_FREQ_160M,
+  RTC_CPU_FREQ_240M,
+  RTC_CPU_FREQ_2M
+} rtc_cpu_freq_t;
+
+typedef struct
+{
+  rtc_cpu_freq_t max_cpu_freq;
+  rtc_cpu_freq_t min_cpu_freq;
+  bool light_sleep_enable;
+} esp_pm_config_esp32_t;
+
+typedef enum
+{
+  ESP_PM_CPU_FREQ_MAX,
+  ESP_PM_APB_FREQ_MAX,
+  ESP_PM_NO_LIGHT_SLEEP
+} esp_pm_lock_type_t;
+
+typedef struct esp_pm_lock *esp_pm_lock_handle_t;
+
+esp_err_t esp_pm_configure(const void *config);
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char *name,
+                             esp_pm_lock_handle_t *out_handle);
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle);
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle);
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t handle);
+
+#endif
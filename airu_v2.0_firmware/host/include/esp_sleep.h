@@ -0,0 +1,31 @@
+/*
+*	esp_sleep.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for deep sleep. esp_deep_sleep_start() saves RTC_DATA_ATTR
+*   memory, advances the simulated clock by the wake up time and restarts
+*   the program, see sim_sleep.c.
+*/
+
+#ifndef _SIM_ESP_SLEEP_H
+#define _SIM_ESP_SLEEP_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+  ESP_SLEEP_WAKEUP_UNDEFINED,
+  ESP_SLEEP_WAKEUP_TIMER = 4
+} esp_sleep_wakeup_cause_t;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+void esp_deep_sleep_start() __attribute__((noreturn));
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause();
+
+#endif
@@ -0,0 +1,21 @@
+/*
+*	esp_system.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_ESP_SYSTEM_H
+#define _SIM_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_attr.h"
+
+uint32_t esp_random();
+void esp_restart();
+uint32_t esp_get_free_heap_size();
+uint32_t esp_get_minimum_free_heap_size();
+
+#endif
@@ -0,0 +1,111 @@
+/*
+*	esp_wifi.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the WiFi driver. Connecting takes a configurable
+*   amount of simulated time and then either delivers STA_CONNECTED and
+*   STA_GOT_IP or STA_DISCONNECTED, see sim.h. A connect to the AP's BSSID
+*   and channel skips the scan and a static address skips DHCP, each
+*   saving part of that time. No radio traffic is modelled.
+*/
+
+#ifndef _SIM_ESP_WIFI_H
+#define _SIM_ESP_WIFI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+#define ESP_ERR_WIFI_NOT_INIT     (ESP_ERR_WIFI_BASE + 1)
+#define ESP_ERR_WIFI_NOT_STARTED  (ESP_ERR_WIFI_BASE + 2)
+#define ESP_ERR_WIFI_CONN         (ESP_ERR_WIFI_BASE + 7)
+
+#define WIFI_REASON_BEACON_TIMEOUT  200
+#define WIFI_REASON_NO_AP_FOUND   201
+
+typedef enum
+{
+  WIFI_MODE_NULL,
+  WIFI_MODE_STA,
+  WIFI_MODE_AP,
+  WIFI_MODE_APSTA
+} wifi_mode_t;
+
+typedef enum
+{
+  ESP_IF_WIFI_STA,
+  ESP_IF_WIFI_AP
+} esp_interface_t;
+
+typedef enum
+{
+  WIFI_AUTH_OPEN,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK,
+  WIFI_AUTH_WPA_WPA2_PSK,
+  WIFI_AUTH_WPA2_ENTERPRISE
+} wifi_auth_mode_t;
+
+typedef enum
+{
+  WIFI_PS_NONE,
+  WIFI_PS_MIN_MODEM,
+  WIFI_PS_MAX_MODEM
+} wifi_ps_type_t;
+
+typedef struct
+{
+  uint8_t ssid[32];
+  uint8_t password[64];
+  uint8_t ssid_len;
+  uint8_t channel;
+  wifi_auth_mode_t authmode;
+  uint8_t ssid_hidden;
+  uint8_t max_connection;
+  uint16_t beacon_interval;
+} wifi_ap_config_t;
+
+typedef struct
+{
+  uint8_t ssid[32];
+  uint8_t password[64];
+  bool bssid_set;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint16_t listen_interval;
+} wifi_sta_config_t;
+
+typedef union
+{
+  wifi_ap_config_t ap;
+  wifi_sta_config_t sta;
+} wifi_config_t;
+
+typedef struct
+{
+  int static_rx_buf_num;
+  int dynamic_rx_buf_num;
+} wifi_init_config_t;
+
+#define WIFI_INIT_CONFIG_DEFAULT() { .static_rx_buf_num = 10, .dynamic_rx_buf_num = 32 }
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config);
+esp_err_t esp_wifi_deinit();
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode);
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode);
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_get_config(esp_interface_t interface, wifi_config_t *conf);
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_start();
+esp_err_t esp_wifi_stop();
+esp_err_t esp_wifi_connect();
+esp_err_t esp_wifi_disconnect();
+
+#endif
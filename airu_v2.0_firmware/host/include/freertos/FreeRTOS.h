@@ -0,0 +1,69 @@
+/*
+*	FreeRTOS.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the parts of FreeRTOS (ESP-IDF SMP port) the firmware
+*   uses. Tasks are POSIX threads and all blocking times are in simulated
+*   ticks, see sim_freertos.c.
+*
+*   Critical sections are one process-wide recursive lock. It is coarser
+*   than a spinlock per portMUX_TYPE, but the code under them never blocks,
+*   and "ISRs" (the UART and GPIO feeder threads) take the same lock.
+*/
+
+#ifndef _SIM_FREERTOS_H
+#define _SIM_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+#define pdPASS              pdTRUE
+#define pdFAIL              pdFALSE
+
+#define configTICK_RATE_HZ  CONFIG_FREERTOS_HZ
+#define portMAX_DELAY       ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS  ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS    portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms)   ((TickType_t) (((uint64_t) (ms) * configTICK_RATE_HZ) / 1000))
+#define portNUM_PROCESSORS  2
+#define tskNO_AFFINITY      0x7FFFFFFF
+
+#define configASSERT(x)     do { if(!(x)) sim_assert_failed(__FILE__, __LINE__); } while(0)
+
+typedef struct
+{
+  uint32_t owner;
+  uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED  { 0, 0 }
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+uint32_t sim_enter_critical_nested();
+void sim_exit_critical_nested(uint32_t state);
+BaseType_t xPortGetCoreID();
+void sim_assert_failed(const char *file, int line) __attribute__((noreturn));
+
+#define portENTER_CRITICAL(mux)           vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)            vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)       vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)        vPortExitCritical(mux)
+#define portENTER_CRITICAL_NESTED()       sim_enter_critical_nested()
+#define portEXIT_CRITICAL_NESTED(state)   sim_exit_critical_nested(state)
+#define portYIELD_FROM_ISR()              do { } while(0)
+
+#endif
@@ -0,0 +1,16 @@
+/*
+*	err.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_LWIP_ERR_H
+#define _SIM_LWIP_ERR_H
+
+typedef signed char err_t;
+
+#define ERR_OK  0
+
+#endif
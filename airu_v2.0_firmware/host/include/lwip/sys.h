@@ -0,0 +1,14 @@
+/*
+*	sys.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_LWIP_SYS_H
+#define _SIM_LWIP_SYS_H
+
+#include "lwip/err.h"
+
+#endif
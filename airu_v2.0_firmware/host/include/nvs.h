@@ -0,0 +1,38 @@
+/*
+*	nvs.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host stand-in for the NVS key/value API, blobs only. Values live in RAM
+*   and go to the image file given to sim_nvs_open() at nvs_commit(), see
+*   sim_nvs.c.
+*/
+
+#ifndef _SIM_NVS_H
+#define _SIM_NVS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "nvs_flash.h"
+
+typedef uint32_t nvs_handle;
+
+typedef enum
+{
+  NVS_READONLY,
+  NVS_READWRITE
+} nvs_open_mode;
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle);
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key);
+esp_err_t nvs_commit(nvs_handle handle);
+void nvs_close(nvs_handle handle);
+
+#endif
@@ -0,0 +1,20 @@
+/*
+*	sdmmc_cmd.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_SDMMC_CMD_H
+#define _SIM_SDMMC_CMD_H
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdmmc_types.h"
+
+esp_err_t sdmmc_card_init(const sdmmc_host_t *host, sdmmc_card_t *out_card);
+esp_err_t sdmmc_read_sectors(sdmmc_card_t *card, void *dst, size_t start_sector, size_t sector_count);
+esp_err_t sdmmc_write_sectors(sdmmc_card_t *card, const void *src, size_t start_sector, size_t sector_count);
+
+#endif
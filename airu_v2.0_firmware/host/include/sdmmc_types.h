@@ -0,0 +1,52 @@
+/*
+*	sdmmc_types.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_SDMMC_TYPES_H
+#define _SIM_SDMMC_TYPES_H
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t flags;
+  int slot;
+  int max_freq_khz;
+} sdmmc_host_t;
+
+typedef struct
+{
+  int csd_ver;
+  int mmc_ver;
+  int capacity;             // Sectors
+  int sector_size;
+  int read_block_len;
+  int card_command_class;
+  int tr_speed;
+} sdmmc_csd_t;
+
+typedef struct
+{
+  int mfg_id;
+  int oem_id;
+  char name[8];
+  int revision;
+  int serial;
+  int date;
+} sdmmc_cid_t;
+
+typedef struct
+{
+  sdmmc_host_t host;
+  uint32_t ocr;
+  sdmmc_cid_t cid;
+  sdmmc_csd_t csd;
+  uint16_t rca;
+  uint32_t max_freq_khz;
+} sdmmc_card_t;
+
+#endif
@@ -0,0 +1,456 @@
+/*
+*	sim.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host (Linux) simulation of the node. The firmware sources are built
+*   unchanged, with ESP_PLATFORM defined, against the stand-in headers in
+*   this directory; this file is the control side the stand-ins share with
+*   sim_main.c.
+*
+*   Time: esp_timer_get_time() runs 'scale' times faster than the host's
+*   monotonic clock and every FreeRTOS tick count, esp_timer period, UART
+*   byte time and simulated delay is in that time, so the firmware sees a
+*   consistent clock at any speed-up. CPU time spent in the firmware is
+*   not scaled, which is the point: at x100 a handler that takes 1 ms of
+*   host time looks like 100 ms on the simulated clock.
+*
+*   Tasks are POSIX threads named after the task, so perf and valgrind
+*   output reads like a FreeRTOS task list. Priorities are not modelled.
+*/
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+#include "esp_err.h"
+
+#define SIM_UART_NUM        3
+#define SIM_I2C_MAX_DEVS    4
+
+
+/*
+* @brief UART stand-in statistics
+*/
+typedef struct
+{
+  uint32_t bytes_in;        // Bytes that reached the driver's ring buffer
+  uint32_t bytes_dropped;   // Bytes lost because the ring buffer was full
+  uint32_t bytes_asleep;    // Bytes lost because the chip was in light sleep
+  uint32_t events;          // Events posted
+  uint32_t events_dropped;  // Events lost because the event queue was full
+  uint32_t bytes_out;       // uart_write_bytes()
+  int64_t last_rx_us;       // When the last chunk was delivered
+} sim_uart_stats_t;
+
+/*
+* @brief PMS model statistics
+*/
+typedef struct
+{
+  uint32_t frames;          // Frames sent
+  uint32_t commands;        // Valid commands received
+  uint32_t wakeups;         // Fan starts, including power on
+  uint64_t fan_us;          // Fan run time
+} sim_pms_stats_t;
+
+/*
+* @brief HTTP stand-in statistics
+*/
+typedef struct
+{
+  uint32_t requests;
+  uint32_t failures;        // Not connected or failed on purpose
+  uint32_t bytes;           // POST bodies of successful requests
+} sim_http_stats_t;
+
+/*
+* @brief NVS stand-in statistics
+*/
+typedef struct
+{
+  uint32_t reads;           // nvs_get_blob() that found the key
+  uint32_t writes;          // nvs_set_blob()
+  uint32_t commits;         // Image writes
+  uint32_t bytes_written;   // Image bytes written
+} sim_nvs_stats_t;
+
+/*
+* @brief Simulated phone statistics, times in esp_timer us
+*/
+typedef struct
+{
+  uint8_t done;             // Heard the outcome or lost the link
+  int status;               // Last status notified (ble_prov_status_t), -1 for none
+  uint16_t mtu;             // Negotiated
+  uint32_t writes;          // ATT write, prepared write and execute requests
+  uint32_t bytes;           // Value bytes written
+  uint32_t notifications;
+  uint32_t rx_bytes;        // Notified value bytes
+  uint32_t records;         // Records in the notified blocks (ble_data.h)...
+  uint32_t bad_blocks;      // ...and blocks that did not decode
+  int64_t connect_us;       // Connected
+  int64_t written_us;       // Last write answered
+  int64_t status_us;        // Last notification
+  int64_t backlog_us;       // First empty block: the node's history is all in
+} sim_ble_phone_stats_t;
+
+/*
+* @brief An I2C device model, callbacks as in hdc1080_bus_t
+*/
+typedef struct
+{
+  esp_err_t (*write)(void *ctx, uint8_t addr, const uint8_t *data, size_t len);
+  esp_err_t (*read)(void *ctx, uint8_t addr, uint8_t *data, size_t len);
+  void *ctx;
+  int64_t *now_us;          // Set to the simulated time before every call, or NULL
+} sim_i2c_dev_t;
+
+
+/* sim_clock.c */
+
+/*
+* @brief Starts the simulated clock. esp_timer_get_time() starts at 0.
+*
+* @param scale       - simulated us per host us, at least 1
+* @param utc_us      - what gettimeofday() returns at time 0; 0 for a
+*                      clock that was never set
+* @param true_utc_us - what SNTP sets the clock to at time 0
+*
+* @return void
+*/
+void sim_clock_init(uint32_t scale, int64_t utc_us, int64_t true_utc_us);
+
+/*
+* @brief Speed-up the clock was started with.
+*/
+uint32_t sim_clock_scale();
+
+/*
+* @brief UTC the node's clock shows at time 0, after any settimeofday().
+*/
+int64_t sim_clock_utc_base();
+
+/*
+* @brief True UTC at time 0.
+*/
+int64_t sim_clock_true_utc_base();
+
+/*
+* @brief Converts a simulated time to an absolute CLOCK_MONOTONIC time, for
+*        timed waits.
+*
+* @param sim_us - simulated time
+* @param ts     - host deadline
+*
+* @return void
+*/
+void sim_clock_deadline(int64_t sim_us, struct timespec *ts);
+
+/*
+* @brief Sleeps the calling thread until a simulated time.
+*
+* @param sim_us - simulated time
+*
+* @return void
+*/
+void sim_sleep_until(int64_t sim_us);
+
+/*
+* @brief Steps the clock to true UTC one round trip after SNTP starts.
+*/
+void sim_sntp_sync();
+
+
+/* sim_freertos.c */
+
+/*
+* @brief Most stack a task has used, read from its painted stack like
+*        uxTaskGetStackHighWaterMark(). This is host stack, which runs
+*        larger than the ESP32's for the same code.
+*
+* @param name - task name
+*
+* @return bytes, 0 if there is no task by that name
+*/
+size_t sim_task_stack_peak(const char *name);
+
+/* sim_uart.c */
+
+/*
+* @brief Replays a capture file into a UART once its driver is installed.
+*        Bytes arrive at the configured baud rate; with 'period_ms' set,
+*        'burst' bytes (0 for the whole file) start every period, like a
+*        sensor that sends one frame a second.
+*
+* @param port      - UART number
+* @param data      - capture, must stay valid
+* @param len       - capture length
+* @param period_ms - burst period, 0 for back to back
+* @param burst     - bytes per burst, 0 for the whole capture
+* @param loop      - start over at the end of the capture
+*
+* @return ESP_OK, or ESP_ERR_INVALID_ARG for a bad port
+*/
+esp_err_t sim_uart_feed_file(int port, const uint8_t *data, size_t len,
+                             uint32_t period_ms, uint32_t burst, int loop);
+
+/*
+* @brief Opens a pty whose slave side is the far end of a UART: bytes
+*        written to it are received, uart_write_bytes() output can be read
+*        from it. Prints the slave path.
+*
+* @param port - UART number
+*
+* @return ESP_OK, or ESP_FAIL if no pty could be opened
+*/
+esp_err_t sim_uart_feed_pty(int port);
+
+/*
+* @brief Connects a device model to the far end of a UART in place of a
+*        feed. The model sends with sim_uart_send().
+*
+* @param port - UART number
+* @param rx   - called with each uart_write_bytes(), from the writing task
+* @param ctx  - passed to 'rx'
+*
+* @return ESP_OK, or ESP_ERR_INVALID_ARG for a bad port
+*/
+esp_err_t sim_uart_attach(int port, void (*rx)(void *ctx, const uint8_t *data, size_t len), void *ctx);
+
+/*
+* @brief Sends bytes from a device model at the baud rate, returning once
+*        the last of them has been received.
+*
+* @param port - UART number
+* @param data - bytes
+* @param len  - byte count
+*
+* @return ESP_OK, ESP_ERR_INVALID_STATE if the driver is not installed
+*         yet (the bytes are lost), or ESP_ERR_INVALID_ARG for a bad port
+*/
+esp_err_t sim_uart_send(int port, const uint8_t *data, size_t len);
+
+/*
+* @brief Copies a UART's statistics out.
+*/
+void sim_uart_get_stats(int port, sim_uart_stats_t *stats);
+
+
+/* sim_periph.c */
+
+/*
+* @brief Puts a device model on the I2C bus.
+*
+* @param addr - 7 bit address
+* @param dev  - model, copied
+*
+* @return ESP_OK, or ESP_ERR_NO_MEM if SIM_I2C_MAX_DEVS are attached
+*/
+esp_err_t sim_i2c_attach(uint8_t addr, const sim_i2c_dev_t *dev);
+
+/*
+* @brief Backs the SD card with an image file, created sparse if needed.
+*        Without one sdmmc_card_init() fails as with no card inserted.
+*
+* @param path    - image file
+* @param sectors - card size in 512 byte sectors
+*
+* @return ESP_OK, or ESP_FAIL if the file cannot be opened
+*/
+esp_err_t sim_sd_open(const char *path, uint32_t sectors);
+
+/*
+* @brief Sets the most verbose log level printed for every tag.
+*/
+void sim_log_level(int level);
+
+/*
+* @brief Adds memory to the heap, as esp_bt_controller_mem_release() does.
+*
+* @param bytes - memory given to the heap
+*
+* @return void
+*/
+void sim_heap_release(size_t bytes);
+
+/*
+* @brief When the chip last came out of light sleep. With light sleep on
+*        (esp_pm_configure()) the chip counts as asleep whenever no power
+*        management lock is held: the idle task only sleeps once every
+*        task is blocked, but nothing else can be relied on to keep it
+*        awake. UART RX is off in light sleep, so the UART stand-in loses
+*        the bytes of a chunk that arrived before this.
+*
+* @return time the first lock now held was taken, -1 if asleep, or 0 if
+*         light sleep is off
+*/
+int64_t sim_pm_awake_since();
+
+
+/* sim_models.c */
+
+/*
+* @brief Puts a simulated HDC1080 on the I2C bus.
+*
+* @param temp_c - temperature it reads, degrees C
+* @param hum    - relative humidity it reads, %
+*
+* @return ESP_OK on success
+*/
+esp_err_t sim_hdc1080_attach(float temp_c, float hum);
+
+/*
+* @brief Puts a simulated PMS sensor (pm_sim_t) on a UART, with its SET
+*        and RESET inputs on GPIOs. It wakes with its fan running and reads
+*        low until the fan has settled.
+*
+* @param port      - UART number
+* @param set_pin   - GPIO driving SET, or -1 if not wired
+* @param reset_pin - GPIO driving RESET, or -1 if not wired
+* @param pm2_5     - PM2.5 it reads once settled, ug/m3
+*
+* @return ESP_OK, or ESP_ERR_NO_MEM if the model thread cannot start
+*/
+esp_err_t sim_pms_attach(int port, int set_pin, int reset_pin, uint16_t pm2_5);
+
+/*
+* @brief Copies the PMS model's statistics out.
+*/
+void sim_pms_get_stats(sim_pms_stats_t *stats);
+
+/*
+* @brief Makes the PMS model hang (1), repeat one frame (2) or garble its
+*        frames (3) from 'at_us' on, until its fan next starts.
+*/
+void sim_pms_fault(int fault, int64_t at_us);
+
+
+/* sim_wifi.c */
+
+/*
+* @brief WiFi and HTTP behaviour.
+*
+* @param connect_ms - time from esp_wifi_connect() to an IP, or -1 for no
+*                     access point in range
+* @param rtt_ms     - time each HTTP request takes
+* @param fail_pct   - percentage of HTTP requests that fail
+* @param posts      - file to append each POST body to (as a 4 byte little
+*                     endian length and the body), or NULL
+*
+* @return void
+*/
+void sim_wifi_config(int32_t connect_ms, uint32_t rtt_ms, uint32_t fail_pct, FILE *posts);
+
+/*
+* @brief Takes the access point away for a while: the station is dropped
+*        and every connect attempt fails until it is back.
+*
+* @param start_us - esp_timer time it goes
+* @param len_us   - how long for
+*
+* @return void
+*/
+void sim_wifi_outage(int64_t start_us, int64_t len_us);
+
+/*
+* @brief Gives the access point credentials: a station configured with
+*        others fails to connect as if there were no access point. Without
+*        this any credentials connect.
+*
+* @param ssid     - network name
+* @param password - passphrase, "" for an open network
+*
+* @return void
+*/
+void sim_wifi_ap(const char *ssid, const char *password);
+
+/*
+* @brief Copies the HTTP statistics out.
+*/
+void sim_http_get_stats(sim_http_stats_t *stats);
+
+
+/* sim_ble.c */
+
+/*
+* @brief A phone that provisions the node over BLE (ble_prov.h): from
+*        'start_us' on it waits for the node to advertise, connects,
+*        subscribes to the status and writes the credentials, then listens
+*        until the status is final or the link goes.
+*
+* @param start_us - esp_timer time it starts scanning
+* @param ssid     - network name to write
+* @param password - passphrase to write
+*
+* @return ESP_OK, ESP_ERR_INVALID_ARG if the credentials are too long, or
+*         ESP_ERR_NO_MEM if the phone task cannot start
+*/
+esp_err_t sim_ble_phone(int64_t start_us, const char *ssid, const char *password);
+
+/*
+* @brief A phone that takes the node's sensor data (ble_data.h) instead:
+*        from 'start_us' on it waits for the node to advertise, connects,
+*        offers 'mtu', subscribes to the records and decodes every block
+*        notified until the run ends. Only one phone per run.
+*
+* @param start_us - esp_timer time it starts scanning
+* @param mtu      - MTU it offers, ESP_GATT_DEF_BLE_MTU_SIZE to
+*                   ESP_GATT_MAX_MTU_SIZE
+*
+* @return ESP_OK, ESP_ERR_INVALID_ARG for a bad MTU, or ESP_ERR_NO_MEM if
+*         the phone task cannot start
+*/
+esp_err_t sim_ble_subscriber(int64_t start_us, uint16_t mtu);
+
+/*
+* @brief Copies the phone's statistics out.
+*/
+void sim_ble_phone_get_stats(sim_ble_phone_stats_t *stats);
+
+
+/* sim_nvs.c */
+
+/*
+* @brief Backs NVS with an image file, read now and replaced at every
+*        nvs_commit(). Call before nvs_flash_init(); without an image NVS
+*        starts empty and is lost when the program exits.
+*
+* @param path - image file, created at the first commit if needed
+*
+* @return ESP_OK, or ESP_FAIL if the file is not an NVS image
+*/
+esp_err_t sim_nvs_open(const char *path);
+
+void sim_nvs_get_stats(sim_nvs_stats_t *stats);
+
+
+/* sim_sleep.c */
+
+/*
+* @brief Picks up after a simulated deep sleep: restores RTC_DATA_ATTR
+*        memory and the clock readings to start sim_clock_init() with.
+*        Call before anything else.
+*
+* @param argv        - arguments to restart with on the next deep sleep
+* @param rtc_path    - where to keep RTC memory while asleep
+* @param utc_us      - set to the node's UTC at wake up if resuming
+* @param true_utc_us - set to true UTC at wake up if resuming
+*
+* @return simulated time already spent in earlier boots and sleeps, us
+*/
+int64_t sim_sleep_resume(char **argv, const char *rtc_path, int64_t *utc_us, int64_t *true_utc_us);
+
+/*
+* @brief Simulated time spent before this boot, us.
+*/
+int64_t sim_sleep_elapsed();
+
+#endif
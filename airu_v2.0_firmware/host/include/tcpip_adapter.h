@@ -0,0 +1,49 @@
+/*
+*	tcpip_adapter.h
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+#ifndef _SIM_TCPIP_ADAPTER_H
+#define _SIM_TCPIP_ADAPTER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct
+{
+  uint32_t addr;            // Network byte order
+} ip4_addr_t;
+
+typedef struct
+{
+  ip4_addr_t ip;
+  ip4_addr_t netmask;
+  ip4_addr_t gw;
+} tcpip_adapter_ip_info_t;
+
+typedef enum
+{
+  TCPIP_ADAPTER_IF_STA = 0,
+  TCPIP_ADAPTER_IF_AP,
+  TCPIP_ADAPTER_IF_MAX
+} tcpip_adapter_if_t;
+
+void tcpip_adapter_init();
+
+/*
+* @brief DHCP client on or off. With it off the station uses the address
+*        set with tcpip_adapter_set_ip_info() and connects that much faster.
+*/
+esp_err_t tcpip_adapter_dhcpc_start(tcpip_adapter_if_t tcpip_if);
+esp_err_t tcpip_adapter_dhcpc_stop(tcpip_adapter_if_t tcpip_if);
+esp_err_t tcpip_adapter_set_ip_info(tcpip_adapter_if_t tcpip_if, const tcpip_adapter_ip_info_t *ip_info);
+
+/*
+* @brief Dotted quad of an address, in a static buffer.
+*/
+char *ip4addr_ntoa(const ip4_addr_t *addr);
+
+#endif
@@ -0,0 +1,1264 @@
+/*
+*	sim_ble.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Bluetooth stand-ins: controller, Bluedroid, GAP and GATT server, and a
+*   phone that provisions the node or takes its data through them. See
+*   sim.h.
+*
+*   Memory: CONFIG_BT_RESERVE_DRAM is kept out of the heap (sim_periph.c)
+*   until esp_bt_controller_mem_release() gives it back, the BR/EDR part
+*   (SIM_BT_DRAM_CLASSIC) and the BLE part separately. The controller and
+*   Bluedroid each take a block of heap while initialised, sized after
+*   what IDF v3.1 takes with one BLE connection, and Bluedroid's BTC queue.
+*
+*   Bluedroid calls the application's handlers from its BTC task; here too.
+*   The GATT server keeps the values of attributes the stack answers for
+*   and posts a write event for every write, as Bluedroid does. The link is
+*   modelled as one request per connection interval, the interval being the
+*   one the node asked for once it has asked.
+*
+*   Notifications go through a TX queue that one connection event per
+*   interval drains, SIM_BLE_EVENT_PDUS link layer packets of
+*   SIM_BLE_PDU_LEN bytes (no data length extension) each; a notification
+*   takes its value plus the L2CAP and ATT headers. As in Bluedroid, the
+*   link reports congestion once SIM_BLE_TX_QUEUE notifications are queued,
+*   a notification sent while congested is dropped with a CONGESTED CONF
+*   event, and the link reports it is clear again at SIM_BLE_TX_LOW.
+*   Notifications still queued when the node drops the link are delivered
+*   first.
+*/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_gatt_common_api.h"
+#include "ble_prov.h"
+#include "ble_data.h"
+#include "record.h"
+#include "sim.h"
+
+#define SIM_BT_DRAM_CLASSIC     (CONFIG_BT_RESERVE_DRAM * 7 / 16)
+#define SIM_BT_DRAM_BLE         (CONFIG_BT_RESERVE_DRAM - SIM_BT_DRAM_CLASSIC)
+#define SIM_BT_CONTROLLER_HEAP  (10 * 1024)
+#define SIM_BLUEDROID_HEAP      (24 * 1024)
+#define SIM_BLE_MAX_ATTRS       16
+#define SIM_BLE_MAX_VALUE       512     // Longest attribute value ATT allows
+#define SIM_BLE_HANDLE_BASE     40
+#define SIM_BLE_GATTS_IF_BASE   3
+#define SIM_BLE_INTERVAL_MS     50      // Until the node asks for another
+#define SIM_BLE_PHONE_MTU       185     // What a phone offers
+#define SIM_BLE_RSP_MS          5000    // ATT transaction timeout is 30 s; 5 is plenty here
+#define SIM_BLE_ADV_POLL_MS     100
+#define SIM_BLE_TX_QUEUE        8       // Notifications queued when the link congests...
+#define SIM_BLE_TX_LOW          4       // ...and when it clears
+#define SIM_BLE_EVENT_PDUS      6       // Packets per connection event
+#define SIM_BLE_PDU_LEN         27
+#define SIM_BLE_NOTIFY_HDR      7       // L2CAP 4, ATT 3
+#define BTC_QUEUE_LEN           16
+#define BTC_TASK_PRIO           19
+#define PHONE_QUEUE_LEN         16
+#define PHONE_TASK_STACK        4096
+#define PHONE_TASK_PRIO         5
+
+
+// What the BTC task delivers. The write value and the handles are copied
+// in, their pointers in 'param' are set on delivery.
+typedef struct
+{
+  enum { BTC_GATTS, BTC_GAP, BTC_STOP } kind;
+  int event;
+  esp_gatt_if_t gatts_if;
+  union
+  {
+    esp_ble_gatts_cb_param_t gatts;
+    esp_ble_gap_cb_param_t gap;
+  } param;
+  uint16_t handles[SIM_BLE_MAX_ATTRS];
+  uint8_t value[SIM_BLE_MAX_VALUE];
+} btc_item_t;
+
+// What the phone hears
+typedef struct
+{
+  enum { PHONE_RSP, PHONE_NOTIFY, PHONE_DISCONNECT } kind;
+  esp_gatt_status_t status;
+  uint16_t len;
+  uint8_t value[SIM_BLE_MAX_VALUE];
+} phone_msg_t;
+
+// A notification on its way
+typedef struct
+{
+  uint16_t len;
+  uint8_t value[SIM_BLE_MAX_VALUE];
+} sim_tx_t;
+
+typedef struct
+{
+  uint16_t uuid;            // 16 bit UUIDs only
+  uint16_t handle;
+  uint8_t auto_rsp;
+  uint16_t perm;
+  uint16_t max_len;
+  uint16_t len;
+  uint8_t value[SIM_BLE_MAX_VALUE];
+} sim_attr_t;
+
+
+/* Function prototypes */
+static void vBtc_task(void *pvParameters);
+static void btc_post(btc_item_t *item);
+static void gatts_post(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param);
+static void gap_post(esp_gap_ble_cb_event_t event, esp_bt_status_t status);
+static sim_attr_t *attr_find(uint16_t handle);
+static sim_attr_t *attr_find_uuid(uint16_t uuid);
+static void link_start();
+static void link_stop(int deliver);
+static void link_event(void *arg);
+static void phone_tell(int kind, esp_gatt_status_t status, const uint8_t *value, uint16_t len);
+static esp_err_t phone_start(int64_t start_us);
+static void vPhone_task(void *pvParameters);
+static int phone_request(int event, uint16_t handle, uint16_t offset, int is_prep,
+                         const uint8_t *value, uint16_t len, uint8_t exec_flag);
+static int phone_wait(int rsp, TickType_t ticks);
+static void phone_notified(const phone_msg_t *msg);
+static void phone_interval();
+
+/* Global variables */
+static pthread_mutex_t ble_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t btc_cond = PTHREAD_COND_INITIALIZER;
+static esp_bt_controller_status_t ctrl_status = ESP_BT_CONTROLLER_STATUS_IDLE;
+static uint8_t ctrl_released;             // ESP_BT_MODE_ bits given to the heap
+static void *ctrl_heap;
+static esp_bluedroid_status_t bd_status = ESP_BLUEDROID_STATUS_UNINITIALIZED;
+static void *bd_heap;
+static QueueHandle_t btc_queue;
+static TaskHandle_t btc_task;
+static int btc_running;
+static esp_gatts_cb_t gatts_cb;
+static esp_gap_ble_cb_t gap_cb;
+static uint16_t local_mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+static esp_gatt_if_t app_if = ESP_GATT_IF_NONE;
+static sim_attr_t attrs[SIM_BLE_MAX_ATTRS];
+static uint8_t num_attrs;
+static int advertising;
+static int connected;
+static uint16_t conn_mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+static uint32_t conn_interval_us = SIM_BLE_INTERVAL_MS * 1000;
+static uint32_t trans_id;
+static esp_timer_handle_t link_timer;
+static sim_tx_t tx_queue[SIM_BLE_TX_QUEUE];
+static uint8_t tx_head;
+static uint8_t tx_count;
+static uint8_t tx_pdus;                   // Packets of the head notification still to go
+static int link_congested;
+
+static const esp_bd_addr_t phone_bda = { 0x5c, 0xf9, 0x38, 0x00, 0x00, 0x02 };
+static QueueHandle_t phone_queue;
+static int64_t phone_start_us;
+static int phone_subscribe;               // Takes the data instead of provisioning
+static uint16_t phone_mtu = SIM_BLE_PHONE_MTU;
+static char phone_cred[BLE_PROV_CRED_MAX];
+static size_t phone_cred_len;
+static sim_ble_phone_stats_t phone_stats;
+
+
+
+/*
+* @brief Sets up the phone. See sim.h.
+*/
+esp_err_t sim_ble_phone(int64_t start_us, const char *ssid, const char *password)
+{
+  int len = snprintf(phone_cred, sizeof(phone_cred), "ssid=%s\npassword=%s", ssid, password);
+
+  if(len < 0 || len >= (int) sizeof(phone_cred))
+    return ESP_ERR_INVALID_ARG;
+  phone_cred_len = len;
+
+  return phone_start(start_us);
+}
+
+
+/*
+* @brief Sets up the subscribing phone. See sim.h.
+*/
+esp_err_t sim_ble_subscriber(int64_t start_us, uint16_t mtu)
+{
+  if(mtu < ESP_GATT_DEF_BLE_MTU_SIZE || mtu > ESP_GATT_MAX_MTU_SIZE)
+    return ESP_ERR_INVALID_ARG;
+  phone_mtu = mtu;
+  phone_subscribe = 1;
+
+  return phone_start(start_us);
+}
+
+
+/*
+* @brief Copies the phone's statistics out. See sim.h.
+*/
+void sim_ble_phone_get_stats(sim_ble_phone_stats_t *stats)
+{
+  pthread_mutex_lock(&ble_lock);
+  *stats = phone_stats;
+  pthread_mutex_unlock(&ble_lock);
+}
+
+
+/*
+* @brief Takes heap for the controller. Fails once its BLE memory is
+*        released, as it is gone until reset.
+*/
+esp_err_t esp_bt_controller_init(esp_bt_controller_config_t *cfg)
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(ctrl_status != ESP_BT_CONTROLLER_STATUS_IDLE || (ctrl_released & ESP_BT_MODE_BLE))
+    err = ESP_ERR_INVALID_STATE;
+  else if((ctrl_heap = malloc(SIM_BT_CONTROLLER_HEAP)) == NULL)
+    err = ESP_ERR_NO_MEM;
+  else
+    ctrl_status = ESP_BT_CONTROLLER_STATUS_INITED;
+  pthread_mutex_unlock(&ble_lock);
+
+  return err;
+}
+
+
+esp_err_t esp_bt_controller_deinit()
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(ctrl_status != ESP_BT_CONTROLLER_STATUS_INITED)
+    err = ESP_ERR_INVALID_STATE;
+  else
+  {
+    free(ctrl_heap);
+    ctrl_heap = NULL;
+    ctrl_status = ESP_BT_CONTROLLER_STATUS_IDLE;
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  return err;
+}
+
+
+esp_err_t esp_bt_controller_enable(esp_bt_mode_t mode)
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(ctrl_status != ESP_BT_CONTROLLER_STATUS_INITED)
+    err = ESP_ERR_INVALID_STATE;
+  else if(mode != ESP_BT_MODE_BLE)
+    err = ESP_ERR_INVALID_ARG;      // No BR/EDR with CONFIG_CLASSIC_BT_ENABLED off
+  else
+    ctrl_status = ESP_BT_CONTROLLER_STATUS_ENABLED;
+  pthread_mutex_unlock(&ble_lock);
+
+  return err;
+}
+
+
+esp_err_t esp_bt_controller_disable()
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(ctrl_status != ESP_BT_CONTROLLER_STATUS_ENABLED)
+    err = ESP_ERR_INVALID_STATE;
+  else
+    ctrl_status = ESP_BT_CONTROLLER_STATUS_INITED;
+  pthread_mutex_unlock(&ble_lock);
+
+  return err;
+}
+
+
+esp_bt_controller_status_t esp_bt_controller_get_status()
+{
+  return ctrl_status;
+}
+
+
+/*
+* @brief Gives the reserved DRAM of a mode to the heap, once. Only while
+*        the controller is idle.
+*/
+esp_err_t esp_bt_controller_mem_release(esp_bt_mode_t mode)
+{
+  size_t bytes = 0;
+
+  pthread_mutex_lock(&ble_lock);
+  if(ctrl_status != ESP_BT_CONTROLLER_STATUS_IDLE)
+  {
+    pthread_mutex_unlock(&ble_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+  if((mode & ESP_BT_MODE_CLASSIC_BT) && !(ctrl_released & ESP_BT_MODE_CLASSIC_BT))
+    bytes += SIM_BT_DRAM_CLASSIC;
+  if((mode & ESP_BT_MODE_BLE) && !(ctrl_released & ESP_BT_MODE_BLE))
+    bytes += SIM_BT_DRAM_BLE;
+  ctrl_released |= mode;
+  pthread_mutex_unlock(&ble_lock);
+
+  sim_heap_release(bytes);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Takes heap for the host stack and its BTC queue.
+*/
+esp_err_t esp_bluedroid_init()
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(ctrl_status != ESP_BT_CONTROLLER_STATUS_ENABLED || bd_status != ESP_BLUEDROID_STATUS_UNINITIALIZED)
+    err = ESP_ERR_INVALID_STATE;
+  else if((bd_heap = malloc(SIM_BLUEDROID_HEAP)) == NULL ||
+          (btc_queue = xQueueCreate(BTC_QUEUE_LEN, sizeof(btc_item_t))) == NULL)
+  {
+    free(bd_heap);
+    bd_heap = NULL;
+    err = ESP_ERR_NO_MEM;
+  }
+  else
+    bd_status = ESP_BLUEDROID_STATUS_INITIALIZED;
+  pthread_mutex_unlock(&ble_lock);
+
+  return err;
+}
+
+
+esp_err_t esp_bluedroid_deinit()
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(bd_status != ESP_BLUEDROID_STATUS_INITIALIZED)
+    err = ESP_ERR_INVALID_STATE;
+  else
+  {
+    vQueueDelete(btc_queue);
+    btc_queue = NULL;
+    free(bd_heap);
+    bd_heap = NULL;
+    gatts_cb = NULL;
+    gap_cb = NULL;
+    num_attrs = 0;
+    bd_status = ESP_BLUEDROID_STATUS_UNINITIALIZED;
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  return err;
+}
+
+
+/*
+* @brief Starts the BTC task.
+*/
+esp_err_t esp_bluedroid_enable()
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&ble_lock);
+  if(bd_status != ESP_BLUEDROID_STATUS_INITIALIZED)
+    err = ESP_ERR_INVALID_STATE;
+  else
+  {
+    xQueueReset(btc_queue);
+    btc_running = 1;
+    bd_status = ESP_BLUEDROID_STATUS_ENABLED;
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  if(err == ESP_OK &&
+     xTaskCreatePinnedToCore(vBtc_task, "btcT", CONFIG_BTC_TASK_STACK_SIZE, NULL, BTC_TASK_PRIO,
+                             &btc_task, 0) != pdPASS)
+  {
+    pthread_mutex_lock(&ble_lock);
+    btc_running = 0;
+    bd_status = ESP_BLUEDROID_STATUS_INITIALIZED;
+    pthread_mutex_unlock(&ble_lock);
+    err = ESP_ERR_NO_MEM;
+  }
+
+  return err;
+}
+
+
+/*
+* @brief Drops the link and advertising and stops the BTC task once it
+*        has finished the event in hand. Events still queued are lost.
+*/
+esp_err_t esp_bluedroid_disable()
+{
+  btc_item_t stop = { .kind = BTC_STOP };
+  int was_connected;
+
+  pthread_mutex_lock(&ble_lock);
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+  {
+    pthread_mutex_unlock(&ble_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+  bd_status = ESP_BLUEDROID_STATUS_INITIALIZED;
+  was_connected = connected;
+  advertising = 0;
+  app_if = ESP_GATT_IF_NONE;
+  pthread_mutex_unlock(&ble_lock);
+
+  if(was_connected)
+  {
+    link_stop(1);
+    phone_tell(PHONE_DISCONNECT, ESP_GATT_OK, NULL, 0);
+  }
+
+  xQueueReset(btc_queue);
+  xQueueSend(btc_queue, &stop, portMAX_DELAY);
+  if(xTaskGetCurrentTaskHandle() != btc_task)
+  {
+    pthread_mutex_lock(&ble_lock);
+    while(btc_running)
+      pthread_cond_wait(&btc_cond, &ble_lock);
+    pthread_mutex_unlock(&ble_lock);
+  }
+
+  return ESP_OK;
+}
+
+
+esp_bluedroid_status_t esp_bluedroid_get_status()
+{
+  return bd_status;
+}
+
+
+esp_err_t esp_ble_gatts_register_callback(esp_gatts_cb_t callback)
+{
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  gatts_cb = callback;
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gap_register_callback(esp_gap_ble_cb_t callback)
+{
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  gap_cb = callback;
+  return ESP_OK;
+}
+
+
+/*
+* @brief One application, whose interface is its id plus a constant.
+*/
+esp_err_t esp_ble_gatts_app_register(uint16_t app_id)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+  if(app_if != ESP_GATT_IF_NONE)
+    return ESP_FAIL;
+
+  app_if = SIM_BLE_GATTS_IF_BASE + app_id;
+  param.reg.status = ESP_GATT_OK;
+  param.reg.app_id = app_id;
+  gatts_post(ESP_GATTS_REG_EVT, &param);
+
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gatts_app_unregister(esp_gatt_if_t gatts_if)
+{
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED || gatts_if != app_if)
+    return ESP_ERR_INVALID_STATE;
+
+  app_if = ESP_GATT_IF_NONE;
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gatt_set_local_mtu(uint16_t mtu)
+{
+  if(mtu < ESP_GATT_DEF_BLE_MTU_SIZE || mtu > ESP_GATT_MAX_MTU_SIZE)
+    return ESP_ERR_INVALID_ARG;
+
+  local_mtu = mtu;
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the table in and gives its attributes consecutive handles.
+*        Only 16 bit UUIDs are kept.
+*/
+esp_err_t esp_ble_gatts_create_attr_tab(const esp_gatts_attr_db_t *gatts_attr_db, esp_gatt_if_t gatts_if,
+                                        uint8_t max_nb_attr, uint8_t srvc_inst_id)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+  btc_item_t item;
+  const esp_attr_desc_t *desc;
+  uint8_t i;
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED || gatts_if != app_if)
+    return ESP_ERR_INVALID_STATE;
+
+  param.add_attr_tab.status = ESP_GATT_OK;
+  if(max_nb_attr > SIM_BLE_MAX_ATTRS)
+    param.add_attr_tab.status = ESP_GATT_NO_RESOURCES;
+
+  pthread_mutex_lock(&ble_lock);
+  for(i = 0; param.add_attr_tab.status == ESP_GATT_OK && i < max_nb_attr; i++)
+  {
+    desc = &gatts_attr_db[i].att_desc;
+    if(desc->length > SIM_BLE_MAX_VALUE || desc->max_length > SIM_BLE_MAX_VALUE)
+    {
+      param.add_attr_tab.status = ESP_GATT_INVALID_ATTR_LEN;
+      break;
+    }
+    memset(&attrs[i], 0, sizeof(attrs[i]));
+    attrs[i].uuid = (desc->uuid_length == ESP_UUID_LEN_16) ? (desc->uuid_p[0] | desc->uuid_p[1] << 8) : 0;
+    attrs[i].handle = SIM_BLE_HANDLE_BASE + i;
+    attrs[i].auto_rsp = gatts_attr_db[i].attr_control.auto_rsp;
+    attrs[i].perm = desc->perm;
+    attrs[i].max_len = desc->max_length;
+    attrs[i].len = desc->length;
+    if(desc->value != NULL)
+      memcpy(attrs[i].value, desc->value, desc->length);
+  }
+  num_attrs = (param.add_attr_tab.status == ESP_GATT_OK) ? max_nb_attr : 0;
+  pthread_mutex_unlock(&ble_lock);
+
+  memset(&item, 0, sizeof(item));
+  item.kind = BTC_GATTS;
+  item.event = ESP_GATTS_CREAT_ATTR_TAB_EVT;
+  item.gatts_if = gatts_if;
+  item.param.gatts = param;
+  item.param.gatts.add_attr_tab.svc_uuid.len = ESP_UUID_LEN_16;
+  item.param.gatts.add_attr_tab.num_handle = num_attrs;
+  for(i = 0; i < num_attrs; i++)
+    item.handles[i] = attrs[i].handle;
+  btc_post(&item);
+
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gatts_start_service(uint16_t service_handle)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  param.start.status = (attr_find(service_handle) != NULL) ? ESP_GATT_OK : ESP_GATT_INVALID_HANDLE;
+  param.start.service_handle = service_handle;
+  gatts_post(ESP_GATTS_START_EVT, &param);
+
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gatts_set_attr_value(uint16_t attr_handle, uint16_t length, const uint8_t *value)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+  sim_attr_t *attr;
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  pthread_mutex_lock(&ble_lock);
+  attr = attr_find(attr_handle);
+  if(attr == NULL)
+    param.set_attr_val.status = ESP_GATT_INVALID_HANDLE;
+  else if(length > attr->max_len)
+    param.set_attr_val.status = ESP_GATT_INVALID_ATTR_LEN;
+  else
+  {
+    memcpy(attr->value, value, length);
+    attr->len = length;
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  param.set_attr_val.srvc_handle = SIM_BLE_HANDLE_BASE;
+  param.set_attr_val.attr_handle = attr_handle;
+  gatts_post(ESP_GATTS_SET_ATTR_VAL_EVT, &param);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Queues the value for the phone. Notifications and indications are
+*        both confirmed with a CONF event once queued, as Bluedroid does;
+*        one sent on a congested link is dropped and the event says so.
+*/
+esp_err_t esp_ble_gatts_send_indicate(esp_gatt_if_t gatts_if, uint16_t conn_id, uint16_t attr_handle,
+                                      uint16_t value_len, uint8_t *value, bool need_confirm)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+  sim_tx_t *tx;
+  int congested = 0;
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED || gatts_if != app_if)
+    return ESP_ERR_INVALID_STATE;
+  if(!connected || attr_find(attr_handle) == NULL || value_len + 3 > conn_mtu)
+    return ESP_FAIL;
+
+  param.conf.status = ESP_GATT_OK;
+  pthread_mutex_lock(&ble_lock);
+  if(link_congested)
+    param.conf.status = ESP_GATT_CONGESTED;
+  else
+  {
+    tx = &tx_queue[(tx_head + tx_count) % SIM_BLE_TX_QUEUE];
+    tx->len = value_len;
+    memcpy(tx->value, value, value_len);
+    tx_count++;
+    congested = link_congested = (tx_count == SIM_BLE_TX_QUEUE);
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  param.conf.conn_id = conn_id;
+  param.conf.handle = attr_handle;
+  param.conf.len = value_len;
+  gatts_post(ESP_GATTS_CONF_EVT, &param);
+
+  if(congested)
+  {
+    memset(&param, 0, sizeof(param));
+    param.congest.conn_id = conn_id;
+    param.congest.congested = true;
+    gatts_post(ESP_GATTS_CONGEST_EVT, &param);
+  }
+
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gatts_send_response(esp_gatt_if_t gatts_if, uint16_t conn_id, uint32_t trans_id,
+                                      esp_gatt_status_t status, esp_gatt_rsp_t *rsp)
+{
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED || gatts_if != app_if)
+    return ESP_ERR_INVALID_STATE;
+  if(!connected)
+    return ESP_FAIL;
+
+  phone_tell(PHONE_RSP, status, NULL, 0);
+  return ESP_OK;
+}
+
+
+/*
+* @brief Drops the link from the node's side.
+*/
+esp_err_t esp_ble_gatts_close(esp_gatt_if_t gatts_if, uint16_t conn_id)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+  int was_connected;
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED || gatts_if != app_if)
+    return ESP_ERR_INVALID_STATE;
+
+  pthread_mutex_lock(&ble_lock);
+  was_connected = connected;
+  pthread_mutex_unlock(&ble_lock);
+
+  if(was_connected)
+  {
+    link_stop(1);
+    phone_tell(PHONE_DISCONNECT, ESP_GATT_OK, NULL, 0);
+    param.disconnect.conn_id = conn_id;
+    memcpy(param.disconnect.remote_bda, phone_bda, sizeof(esp_bd_addr_t));
+    param.disconnect.reason = 0x16;   // Terminated by the local host
+    gatts_post(ESP_GATTS_DISCONNECT_EVT, &param);
+  }
+
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gap_set_device_name(const char *name)
+{
+  return (bd_status == ESP_BLUEDROID_STATUS_ENABLED) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+
+esp_err_t esp_ble_gap_config_adv_data(esp_ble_adv_data_t *adv_data)
+{
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  gap_post(adv_data->set_scan_rsp ? ESP_GAP_BLE_SCAN_RSP_DATA_SET_COMPLETE_EVT :
+                                    ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT, ESP_BT_STATUS_SUCCESS);
+  return ESP_OK;
+}
+
+
+/*
+* @brief Connectable advertising can't start while connected (one
+*        connection, CONFIG_BT_ACL_CONNECTIONS).
+*/
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params)
+{
+  esp_bt_status_t status = ESP_BT_STATUS_SUCCESS;
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  pthread_mutex_lock(&ble_lock);
+  if(connected)
+    status = ESP_BT_STATUS_FAIL;
+  else
+    advertising = 1;
+  pthread_mutex_unlock(&ble_lock);
+
+  gap_post(ESP_GAP_BLE_ADV_START_COMPLETE_EVT, status);
+  return ESP_OK;
+}
+
+
+esp_err_t esp_ble_gap_stop_advertising()
+{
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+
+  advertising = 0;
+  gap_post(ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT, ESP_BT_STATUS_SUCCESS);
+  return ESP_OK;
+}
+
+
+/*
+* @brief The phone takes the longest interval the node allows.
+*/
+esp_err_t esp_ble_gap_update_conn_params(esp_ble_conn_update_params_t *params)
+{
+  btc_item_t item;
+
+  if(bd_status != ESP_BLUEDROID_STATUS_ENABLED)
+    return ESP_ERR_INVALID_STATE;
+  if(!connected)
+    return ESP_FAIL;
+
+  conn_interval_us = params->max_int * 1250;
+  link_start();
+
+  memset(&item, 0, sizeof(item));
+  item.kind = BTC_GAP;
+  item.event = ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT;
+  item.param.gap.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+  memcpy(item.param.gap.update_conn_params.bda, params->bda, sizeof(esp_bd_addr_t));
+  item.param.gap.update_conn_params.min_int = params->min_int;
+  item.param.gap.update_conn_params.max_int = params->max_int;
+  item.param.gap.update_conn_params.latency = params->latency;
+  item.param.gap.update_conn_params.conn_int = params->max_int;
+  item.param.gap.update_conn_params.timeout = params->timeout;
+  btc_post(&item);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief The BTC task: hands each event to the application's handler.
+*/
+static void vBtc_task(void *pvParameters)
+{
+  static btc_item_t item;     // One BTC task at a time
+
+  while(xQueueReceive(btc_queue, &item, portMAX_DELAY) == pdPASS && item.kind != BTC_STOP)
+  {
+    if(item.kind == BTC_GAP && gap_cb != NULL)
+      gap_cb(item.event, &item.param.gap);
+    else if(item.kind == BTC_GATTS && gatts_cb != NULL)
+    {
+      if(item.event == ESP_GATTS_WRITE_EVT)
+        item.param.gatts.write.value = item.value;
+      else if(item.event == ESP_GATTS_CREAT_ATTR_TAB_EVT)
+        item.param.gatts.add_attr_tab.handles = item.handles;
+      gatts_cb(item.event, item.gatts_if, &item.param.gatts);
+    }
+  }
+
+  pthread_mutex_lock(&ble_lock);
+  btc_running = 0;
+  pthread_cond_broadcast(&btc_cond);
+  pthread_mutex_unlock(&ble_lock);
+  vTaskDelete(NULL);
+}
+
+
+/*
+* @brief Queues an event for the BTC task, unless Bluedroid is down.
+*/
+static void btc_post(btc_item_t *item)
+{
+  if(bd_status == ESP_BLUEDROID_STATUS_ENABLED && btc_queue != NULL)
+    xQueueSend(btc_queue, item, 0);
+}
+
+
+static void gatts_post(esp_gatts_cb_event_t event, const esp_ble_gatts_cb_param_t *param)
+{
+  btc_item_t item;
+
+  memset(&item, 0, sizeof(item));
+  item.kind = BTC_GATTS;
+  item.event = event;
+  item.gatts_if = app_if;
+  item.param.gatts = *param;
+  btc_post(&item);
+}
+
+
+static void gap_post(esp_gap_ble_cb_event_t event, esp_bt_status_t status)
+{
+  btc_item_t item;
+
+  memset(&item, 0, sizeof(item));
+  item.kind = BTC_GAP;
+  item.event = event;
+  item.param.gap.adv_start_cmpl.status = status;    // Every completion starts with its status
+  btc_post(&item);
+}
+
+
+/*
+* @brief Attribute with a handle, or NULL.
+*/
+static sim_attr_t *attr_find(uint16_t handle)
+{
+  if(handle < SIM_BLE_HANDLE_BASE || handle >= SIM_BLE_HANDLE_BASE + num_attrs)
+    return NULL;
+
+  return &attrs[handle - SIM_BLE_HANDLE_BASE];
+}
+
+
+/*
+* @brief First attribute with a 16 bit UUID, or NULL. This is the phone's
+*        service discovery.
+*/
+static sim_attr_t *attr_find_uuid(uint16_t uuid)
+{
+  uint8_t i;
+
+  for(i = 0; i < num_attrs; i++)
+  {
+    if(attrs[i].uuid == uuid)
+      return &attrs[i];
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Starts the connection events at the current interval.
+*/
+static void link_start()
+{
+  const esp_timer_create_args_t args = { .callback = link_event, .name = "sim_ble_link" };
+
+  if(link_timer == NULL && esp_timer_create(&args, &link_timer) != ESP_OK)
+    return;
+  esp_timer_stop(link_timer);
+  esp_timer_start_periodic(link_timer, conn_interval_us);
+}
+
+
+/*
+* @brief Ends the connection, delivering what is queued first if the node
+*        is the one ending it.
+*/
+static void link_stop(int deliver)
+{
+  if(link_timer != NULL)
+    esp_timer_stop(link_timer);
+
+  pthread_mutex_lock(&ble_lock);
+  for(; tx_count > 0; tx_count--)
+  {
+    if(deliver)
+      phone_tell(PHONE_NOTIFY, ESP_GATT_OK, tx_queue[tx_head].value, tx_queue[tx_head].len);
+    tx_head = (tx_head + 1) % SIM_BLE_TX_QUEUE;
+  }
+  tx_pdus = 0;
+  link_congested = 0;
+  connected = 0;
+  pthread_mutex_unlock(&ble_lock);
+}
+
+
+/*
+* @brief One connection event: moves up to SIM_BLE_EVENT_PDUS packets of
+*        queued notifications and reports the link clear once the queue is
+*        down to SIM_BLE_TX_LOW.
+*/
+static void link_event(void *arg)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+  sim_tx_t *tx;
+  uint8_t pdus = SIM_BLE_EVENT_PDUS;
+  uint8_t n;
+  int cleared = 0;
+
+  pthread_mutex_lock(&ble_lock);
+  while(connected && pdus > 0 && tx_count > 0)
+  {
+    tx = &tx_queue[tx_head];
+    if(tx_pdus == 0)
+      tx_pdus = (tx->len + SIM_BLE_NOTIFY_HDR + SIM_BLE_PDU_LEN - 1) / SIM_BLE_PDU_LEN;
+    n = (tx_pdus < pdus) ? tx_pdus : pdus;
+    tx_pdus -= n;
+    pdus -= n;
+    if(tx_pdus == 0)
+    {
+      phone_tell(PHONE_NOTIFY, ESP_GATT_OK, tx->value, tx->len);
+      tx_head = (tx_head + 1) % SIM_BLE_TX_QUEUE;
+      tx_count--;
+    }
+  }
+  if(connected && link_congested && tx_count <= SIM_BLE_TX_LOW)
+  {
+    link_congested = 0;
+    cleared = 1;
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  if(cleared)
+  {
+    param.congest.congested = false;
+    gatts_post(ESP_GATTS_CONGEST_EVT, &param);
+  }
+}
+
+
+/*
+* @brief Passes something to the phone, if there is one.
+*/
+static void phone_tell(int kind, esp_gatt_status_t status, const uint8_t *value, uint16_t len)
+{
+  static phone_msg_t msg;     // Too big for some callers' stacks
+  static pthread_mutex_t msg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+  if(phone_queue == NULL)
+    return;
+
+  pthread_mutex_lock(&msg_lock);
+  msg.kind = kind;
+  msg.status = status;
+  msg.len = len;
+  if(len > 0)
+    memcpy(msg.value, value, len);
+  xQueueSend(phone_queue, &msg, 0);
+  pthread_mutex_unlock(&msg_lock);
+}
+
+
+/*
+* @brief Creates the phone's queue and task.
+*/
+static esp_err_t phone_start(int64_t start_us)
+{
+  phone_start_us = start_us;
+
+  phone_queue = xQueueCreate(PHONE_QUEUE_LEN, sizeof(phone_msg_t));
+  if(phone_queue == NULL ||
+     xTaskCreate(vPhone_task, "sim_phone", PHONE_TASK_STACK, NULL, PHONE_TASK_PRIO, NULL) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief The phone: waits for the node to advertise, connects and
+*        subscribes. A provisioning phone writes the credentials, as a long
+*        write if they don't fit the MTU, then listens until the status is
+*        final; a subscriber listens for as long as the link lasts.
+*/
+static void vPhone_task(void *pvParameters)
+{
+  esp_ble_gatts_cb_param_t param = { 0 };
+  uint16_t service = phone_subscribe ? BLE_DATA_RECORDS_UUID : BLE_PROV_CREDENTIALS_UUID;
+  uint16_t cred_handle;
+  uint16_t cccd_handle;
+  uint16_t chunk;
+  uint16_t off;
+  int status;
+  int ok;
+
+  sim_sleep_until(phone_start_us);
+
+  // Scanning, until the node advertises or has let its memory go.
+  for(;;)
+  {
+    pthread_mutex_lock(&ble_lock);
+    ok = advertising && attr_find_uuid(service) != NULL;
+    if(ok)
+    {
+      advertising = 0;
+      connected = 1;
+      conn_mtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+      conn_interval_us = SIM_BLE_INTERVAL_MS * 1000;
+    }
+    status = (ctrl_released & ESP_BT_MODE_BLE) != 0;
+    pthread_mutex_unlock(&ble_lock);
+    if(ok || status)
+      break;
+    vTaskDelay(pdMS_TO_TICKS(SIM_BLE_ADV_POLL_MS));
+  }
+  if(!ok)
+  {
+    vTaskDelete(NULL);
+    return;
+  }
+  xQueueReset(phone_queue);
+
+  pthread_mutex_lock(&ble_lock);
+  phone_stats.connect_us = esp_timer_get_time();
+  phone_stats.status = -1;
+  cred_handle = attr_find_uuid(service)->handle;
+  cccd_handle = attr_find_uuid(ESP_GATT_UUID_CHAR_CLIENT_CONFIG)->handle;
+  pthread_mutex_unlock(&ble_lock);
+
+  param.connect.conn_id = 0;
+  memcpy(param.connect.remote_bda, phone_bda, sizeof(esp_bd_addr_t));
+  gatts_post(ESP_GATTS_CONNECT_EVT, &param);
+  link_start();
+  phone_interval();
+
+  // MTU exchange
+  conn_mtu = (local_mtu < phone_mtu) ? local_mtu : phone_mtu;
+  memset(&param, 0, sizeof(param));
+  param.mtu.mtu = conn_mtu;
+  gatts_post(ESP_GATTS_MTU_EVT, &param);
+  pthread_mutex_lock(&ble_lock);
+  phone_stats.mtu = conn_mtu;
+  pthread_mutex_unlock(&ble_lock);
+  phone_interval();
+
+  ok = phone_request(ESP_GATTS_WRITE_EVT, cccd_handle, 0, 0, (const uint8_t *) "\x01\x00", 2, 0) == ESP_GATT_OK;
+
+  if(phone_subscribe)
+  {
+    pthread_mutex_lock(&ble_lock);
+    phone_stats.written_us = esp_timer_get_time();
+    pthread_mutex_unlock(&ble_lock);
+    if(ok)
+      phone_wait(0, portMAX_DELAY);
+    ok = 0;
+  }
+
+  // A write request carries MTU - 3 bytes, a prepared write MTU - 5.
+  if(!phone_subscribe && ok && phone_cred_len + 3 <= conn_mtu)
+    ok = phone_request(ESP_GATTS_WRITE_EVT, cred_handle, 0, 0, (const uint8_t *) phone_cred,
+                       phone_cred_len, 0) == ESP_GATT_OK;
+  else if(!phone_subscribe)
+  {
+    for(off = 0; ok && off < phone_cred_len; off += chunk)
+    {
+      chunk = (phone_cred_len - off < (size_t) conn_mtu - 5) ? phone_cred_len - off : conn_mtu - 5;
+      ok = phone_request(ESP_GATTS_WRITE_EVT, cred_handle, off, 1, (const uint8_t *) phone_cred + off,
+                         chunk, 0) == ESP_GATT_OK;
+    }
+    if(ok)
+      ok = phone_request(ESP_GATTS_EXEC_WRITE_EVT, cred_handle, 0, 0, NULL, 0,
+                         ESP_GATT_PREP_WRITE_EXEC) == ESP_GATT_OK;
+  }
+
+  // Listens for the outcome, then goes.
+  if(!phone_subscribe)
+  {
+    pthread_mutex_lock(&ble_lock);
+    phone_stats.written_us = esp_timer_get_time();
+    pthread_mutex_unlock(&ble_lock);
+    if(ok)
+      phone_wait(0, pdMS_TO_TICKS(BLE_PROV_CONNECT_MS + BLE_PROV_NOTIFY_MS));
+  }
+
+  pthread_mutex_lock(&ble_lock);
+  phone_stats.done = 1;
+  ok = connected;
+  pthread_mutex_unlock(&ble_lock);
+  if(ok)
+  {
+    link_stop(0);
+    memset(&param, 0, sizeof(param));
+    memcpy(param.disconnect.remote_bda, phone_bda, sizeof(esp_bd_addr_t));
+    param.disconnect.reason = 0x13;   // Terminated by the remote user
+    gatts_post(ESP_GATTS_DISCONNECT_EVT, &param);
+  }
+
+  vTaskDelete(NULL);
+}
+
+
+/*
+* @brief One ATT request: a write (prepared or not) or an execute. Writes
+*        to attributes the stack answers for are stored and answered here.
+*
+* @return the response's status, or -1 if there was none
+*/
+static int phone_request(int event, uint16_t handle, uint16_t offset, int is_prep,
+                         const uint8_t *value, uint16_t len, uint8_t exec_flag)
+{
+  btc_item_t item;
+  sim_attr_t *attr;
+  int status = -1;
+
+  memset(&item, 0, sizeof(item));
+  item.kind = BTC_GATTS;
+  item.event = event;
+  item.gatts_if = app_if;
+
+  pthread_mutex_lock(&ble_lock);
+  phone_stats.writes++;
+  phone_stats.bytes += len;
+  trans_id++;
+  if(event == ESP_GATTS_EXEC_WRITE_EVT)
+  {
+    item.param.gatts.exec_write.trans_id = trans_id;
+    item.param.gatts.exec_write.exec_write_flag = exec_flag;
+    memcpy(item.param.gatts.exec_write.bda, phone_bda, sizeof(esp_bd_addr_t));
+  }
+  else
+  {
+    item.param.gatts.write.trans_id = trans_id;
+    item.param.gatts.write.handle = handle;
+    item.param.gatts.write.offset = offset;
+    item.param.gatts.write.is_prep = is_prep;
+    item.param.gatts.write.need_rsp = 1;
+    item.param.gatts.write.len = len;
+    memcpy(item.param.gatts.write.bda, phone_bda, sizeof(esp_bd_addr_t));
+    memcpy(item.value, value, len);
+
+    attr = attr_find(handle);
+    if(attr != NULL && attr->auto_rsp)
+    {
+      item.param.gatts.write.need_rsp = 0;
+      if(!(attr->perm & ESP_GATT_PERM_WRITE))
+        status = ESP_GATT_WRITE_NOT_PERMIT;
+      else if(offset + len > attr->max_len)
+        status = ESP_GATT_INVALID_ATTR_LEN;
+      else
+      {
+        memcpy(attr->value + offset, value, len);
+        attr->len = offset + len;
+        status = ESP_GATT_OK;
+      }
+    }
+  }
+  pthread_mutex_unlock(&ble_lock);
+
+  if(status != ESP_GATT_WRITE_NOT_PERMIT && status != ESP_GATT_INVALID_ATTR_LEN)
+    btc_post(&item);
+  if(status < 0)
+    status = phone_wait(1, pdMS_TO_TICKS(SIM_BLE_RSP_MS));
+  phone_interval();
+
+  return status;
+}
+
+
+/*
+* @brief Takes what the node sends until a response (rsp 1) or a final
+*        status (rsp 0), keeping the statistics. A subscriber's
+*        notifications are never final.
+*
+* @return the response's status or the final status, -1 if the wait ran
+*         out or the link went
+*/
+static int phone_wait(int rsp, TickType_t ticks)
+{
+  static phone_msg_t msg;     // Only the phone task waits
+
+  while(xQueueReceive(phone_queue, &msg, ticks) == pdPASS)
+  {
+    if(msg.kind == PHONE_DISCONNECT)
+      return -1;
+    if(msg.kind == PHONE_RSP)
+    {
+      if(rsp)
+        return msg.status;
+      continue;
+    }
+
+    phone_notified(&msg);
+    if(!rsp && !phone_subscribe && msg.value[0] != BLE_PROV_WAITING && msg.value[0] != BLE_PROV_CONNECTING)
+      return msg.value[0];
+  }
+
+  return -1;
+}
+
+
+/*
+* @brief Counts a notification: a provisioning status, or a block of
+*        records that is decoded in full.
+*/
+static void phone_notified(const phone_msg_t *msg)
+{
+  record_reader_t reader;
+  sensor_sample_t sample;
+  int64_t now = esp_timer_get_time();
+  int count = 0;
+  int ret = 0;
+
+  if(phone_subscribe)
+  {
+    count = record_reader_init(&reader, msg->value, msg->len);
+    while(count >= 0 && (ret = record_reader_next(&reader, &sample)) == 1)
+      ;
+  }
+
+  pthread_mutex_lock(&ble_lock);
+  phone_stats.notifications++;
+  phone_stats.rx_bytes += msg->len;
+  phone_stats.status_us = now;
+  if(!phone_subscribe)
+    phone_stats.status = msg->value[0];
+  else if(count < 0 || ret < 0)
+    phone_stats.bad_blocks++;
+  else if(count == 0 && phone_stats.backlog_us == 0)
+    phone_stats.backlog_us = now;
+  else
+    phone_stats.records += count;
+  pthread_mutex_unlock(&ble_lock);
+}
+
+
+/*
+* @brief Waits out the connection event.
+*/
+static void phone_interval()
+{
+  sim_sleep_until(esp_timer_get_time() + conn_interval_us);
+}
@@ -0,0 +1,381 @@
+/*
+*	sim_clock.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Simulated clock, esp_timer and the node's system time, see sim.h.
+*
+*   gettimeofday()/settimeofday() are wrapped at link time (-Wl,--wrap) so
+*   timesync.c steps the simulated RTC instead of the host's clock.
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "esp_timer.h"
+#include "sim.h"
+
+#define SNTP_RTT_US   30000
+
+
+struct esp_timer
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  const char *name;
+  int64_t due_us;           // 0 when not armed
+  uint64_t period_us;       // 0 for a one shot timer
+  struct esp_timer *next;
+};
+
+/* Function prototypes */
+static void *timer_thread(void *arg);
+static void sntp_fire(void *arg);
+
+/* Global variables */
+static struct timespec clock_real0;
+static uint32_t clock_scale = 1;
+static int64_t clock_utc_base;              // Node UTC at time 0
+static int64_t clock_true_utc_base;         // True UTC at time 0
+static pthread_mutex_t clock_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct esp_timer *timer_list;
+static pthread_mutex_t timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t timer_cond;
+static pthread_t timer_task;
+static int timer_running;
+static esp_timer_handle_t sntp_timer;
+
+
+
+/*
+* @brief Starts the clock. See sim.h.
+*/
+void sim_clock_init(uint32_t scale, int64_t utc_us, int64_t true_utc_us)
+{
+  pthread_condattr_t attr;
+
+  clock_gettime(CLOCK_MONOTONIC, &clock_real0);
+  clock_scale = (scale > 0) ? scale : 1;
+  clock_utc_base = utc_us;
+  clock_true_utc_base = true_utc_us;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&timer_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+
+/*
+* @brief Speed-up. See sim.h.
+*/
+uint32_t sim_clock_scale()
+{
+  return clock_scale;
+}
+
+
+/*
+* @brief Node UTC at time 0. See sim.h.
+*/
+int64_t sim_clock_utc_base()
+{
+  int64_t base;
+
+  pthread_mutex_lock(&clock_lock);
+  base = clock_utc_base;
+  pthread_mutex_unlock(&clock_lock);
+
+  return base;
+}
+
+
+/*
+* @brief True UTC at time 0. See sim.h.
+*/
+int64_t sim_clock_true_utc_base()
+{
+  return clock_true_utc_base;
+}
+
+
+/*
+* @brief Simulated time to a host deadline. See sim.h.
+*/
+void sim_clock_deadline(int64_t sim_us, struct timespec *ts)
+{
+  int64_t ns;
+
+  if(sim_us < 0)
+    sim_us = 0;
+
+  ns = sim_us * 1000 / clock_scale + clock_real0.tv_nsec;
+  ts->tv_sec = clock_real0.tv_sec + ns / 1000000000;
+  ts->tv_nsec = ns % 1000000000;
+}
+
+
+/*
+* @brief Sleeps until a simulated time. See sim.h.
+*/
+void sim_sleep_until(int64_t sim_us)
+{
+  struct timespec ts;
+
+  sim_clock_deadline(sim_us, &ts);
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+    ;
+}
+
+
+/*
+* @brief Schedules the SNTP step. See sim.h.
+*/
+void sim_sntp_sync()
+{
+  const esp_timer_create_args_t args = { .callback = sntp_fire, .name = "sntp" };
+
+  if(sntp_timer == NULL)
+    esp_timer_create(&args, &sntp_timer);
+  esp_timer_stop(sntp_timer);
+  esp_timer_start_once(sntp_timer, SNTP_RTT_US);
+}
+
+
+/*
+* @brief Sets the node's clock to true UTC, like an SNTP reply would.
+*/
+static void sntp_fire(void *arg)
+{
+  pthread_mutex_lock(&clock_lock);
+  clock_utc_base = clock_true_utc_base;
+  pthread_mutex_unlock(&clock_lock);
+}
+
+
+/*
+* @brief Simulated time since boot, us.
+*/
+int64_t esp_timer_get_time()
+{
+  struct timespec now;
+  int64_t ns;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ns = (int64_t) (now.tv_sec - clock_real0.tv_sec) * 1000000000 + (now.tv_nsec - clock_real0.tv_nsec);
+
+  return ns * clock_scale / 1000;
+}
+
+
+/*
+* @brief The node's system time.
+*/
+int __wrap_gettimeofday(struct timeval *tv, void *tz)
+{
+  int64_t us = sim_clock_utc_base() + esp_timer_get_time();
+
+  if(tv != NULL)
+  {
+    tv->tv_sec = us / 1000000;
+    tv->tv_usec = us % 1000000;
+  }
+
+  return 0;
+}
+
+
+/*
+* @brief Steps the node's system time.
+*/
+int __wrap_settimeofday(const struct timeval *tv, const void *tz)
+{
+  if(tv == NULL)
+    return 0;
+
+  pthread_mutex_lock(&clock_lock);
+  clock_utc_base = (int64_t) tv->tv_sec * 1000000 + tv->tv_usec - esp_timer_get_time();
+  pthread_mutex_unlock(&clock_lock);
+
+  return 0;
+}
+
+
+/*
+* @brief Creates a timer, starting the dispatch thread on first use.
+*/
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out_handle)
+{
+  struct esp_timer *timer;
+
+  timer = calloc(1, sizeof(*timer));
+  if(timer == NULL)
+    return ESP_ERR_NO_MEM;
+  timer->callback = args->callback;
+  timer->arg = args->arg;
+  timer->name = args->name;
+
+  pthread_mutex_lock(&timer_lock);
+  if(!timer_running)
+  {
+    if(pthread_create(&timer_task, NULL, timer_thread, NULL) != 0)
+    {
+      pthread_mutex_unlock(&timer_lock);
+      free(timer);
+      return ESP_ERR_NO_MEM;
+    }
+    pthread_setname_np(timer_task, "esp_timer");
+    timer_running = 1;
+  }
+  timer->next = timer_list;
+  timer_list = timer;
+  pthread_mutex_unlock(&timer_lock);
+
+  *out_handle = timer;
+  return ESP_OK;
+}
+
+
+/*
+* @brief Arms a timer.
+*/
+static esp_err_t start(esp_timer_handle_t timer, uint64_t timeout_us, uint64_t period_us)
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&timer_lock);
+  if(timer->due_us != 0)
+  {
+    err = ESP_ERR_INVALID_STATE;
+  }
+  else
+  {
+    timer->due_us = esp_timer_get_time() + (int64_t) timeout_us;
+    if(timer->due_us == 0)
+      timer->due_us = 1;
+    timer->period_us = period_us;
+    pthread_cond_signal(&timer_cond);
+  }
+  pthread_mutex_unlock(&timer_lock);
+
+  return err;
+}
+
+
+/*
+* @brief Arms a one shot timer.
+*/
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+  return start(timer, timeout_us, 0);
+}
+
+
+/*
+* @brief Arms a periodic timer; the first call is one period from now.
+*/
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+  return start(timer, period, period);
+}
+
+
+/*
+* @brief Disarms a timer.
+*/
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&timer_lock);
+  if(timer->due_us == 0)
+    err = ESP_ERR_INVALID_STATE;
+  timer->due_us = 0;
+  pthread_mutex_unlock(&timer_lock);
+
+  return err;
+}
+
+
+/*
+* @brief Frees a disarmed timer.
+*/
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+  struct esp_timer **p;
+
+  pthread_mutex_lock(&timer_lock);
+  if(timer->due_us != 0)
+  {
+    pthread_mutex_unlock(&timer_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+  for(p = &timer_list; *p != NULL; p = &(*p)->next)
+  {
+    if(*p == timer)
+    {
+      *p = timer->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&timer_lock);
+
+  free(timer);
+  return ESP_OK;
+}
+
+
+/*
+* @brief Runs callbacks as their timers come due, one at a time.
+*/
+static void *timer_thread(void *arg)
+{
+  struct esp_timer *timer;
+  struct esp_timer *due;
+  struct timespec ts;
+  esp_timer_cb_t callback;
+  void *cb_arg;
+  int64_t now;
+
+  pthread_mutex_lock(&timer_lock);
+  for(;;)
+  {
+    due = NULL;
+    for(timer = timer_list; timer != NULL; timer = timer->next)
+    {
+      if(timer->due_us != 0 && (due == NULL || timer->due_us < due->due_us))
+        due = timer;
+    }
+
+    if(due == NULL)
+    {
+      pthread_cond_wait(&timer_cond, &timer_lock);
+      continue;
+    }
+
+    now = esp_timer_get_time();
+    if(due->due_us > now)
+    {
+      sim_clock_deadline(due->due_us, &ts);
+      pthread_cond_timedwait(&timer_cond, &timer_lock, &ts);
+      continue;
+    }
+
+    callback = due->callback;
+    cb_arg = due->arg;
+    due->due_us = (due->period_us != 0) ? due->due_us + (int64_t) due->period_us : 0;
+
+    pthread_mutex_unlock(&timer_lock);
+    callback(cb_arg);
+    pthread_mutex_lock(&timer_lock);
+  }
+
+  return NULL;
+}
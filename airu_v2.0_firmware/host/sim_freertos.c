@@ -0,0 +1,767 @@
+/*
+*	sim_freertos.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   FreeRTOS tasks, queues, queue sets and event groups on POSIX threads.
+*
+*   Queue and event group state is guarded by one mutex, 'rtos_lock', and
+*   every object has a condition variable that is broadcast on any change.
+*   Block times are simulated ticks, turned into host deadlines by
+*   sim_clock_deadline(). Critical sections use a separate recursive lock so
+*   code under one can still send to a queue, as on the node.
+*
+*   Task stacks are mapped here and painted, as FreeRTOS does, so the most
+*   stack each task has used can be read back with sim_task_stack_peak().
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+#define TASK_STACK_MIN    65536   // glibc printf alone needs more than most ESP task stacks
+#define TASK_STACK_SCALE  4       // 64 bit pointers and a fatter C library
+#define TASK_STACK_PAINT  0xa5      // tskSTACK_FILL_BYTE
+
+
+typedef struct sim_task
+{
+  pthread_t thread;
+  TaskFunction_t code;
+  void *arg;
+  char name[16];
+  BaseType_t core;
+  uint8_t *stack;           // Lowest usable address, a guard page sits below
+  size_t stack_size;
+  uint8_t *stack_top;       // Frame of task_entry(), where the task's own use starts
+  struct sim_task *next;
+} sim_task_t;
+
+typedef struct sim_queue
+{
+  uint8_t *items;
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t head;
+  UBaseType_t count;
+  pthread_cond_t cond;
+  struct sim_queue *set;    // Queue set this queue is a member of
+} sim_queue_t;
+
+typedef struct
+{
+  EventBits_t bits;
+  pthread_cond_t cond;
+} sim_group_t;
+
+
+/* Function prototypes */
+static void *task_entry(void *arg);
+static void cond_init(pthread_cond_t *cond);
+static int wait(pthread_cond_t *cond, TickType_t ticks, const struct timespec *deadline);
+static void deadline(TickType_t ticks, struct timespec *ts);
+static BaseType_t send(sim_queue_t *q, const void *item, TickType_t ticks, int overwrite);
+
+/* Global variables */
+static pthread_mutex_t rtos_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t crit_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread sim_task_t *rtos_self;
+static uint32_t rtos_task_count;
+static sim_task_t *rtos_tasks;      // Every task ever created, for the stack statistics
+
+
+
+/*
+* @brief Starts a task on its own thread.
+*/
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char *pcName,
+                                   uint32_t usStackDepth, void *pvParameters,
+                                   UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask,
+                                   BaseType_t xCoreID)
+{
+  pthread_attr_t attr;
+  sim_task_t *task;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t stack;
+  uint8_t *map;
+  int err;
+
+  task = calloc(1, sizeof(*task));
+  if(task == NULL)
+    return pdFAIL;
+
+  task->code = pvTaskCode;
+  task->arg = pvParameters;
+  strncpy(task->name, pcName, sizeof(task->name) - 1);
+
+  stack = (size_t) usStackDepth * TASK_STACK_SCALE;
+  if(stack < TASK_STACK_MIN)
+    stack = TASK_STACK_MIN;
+  stack = (stack + page - 1) & ~(page - 1);
+
+  map = mmap(NULL, stack + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(map == MAP_FAILED)
+  {
+    free(task);
+    return pdFAIL;
+  }
+  mprotect(map, page, PROT_NONE);
+  task->stack = map + page;
+  task->stack_size = stack;
+  memset(task->stack, TASK_STACK_PAINT, stack);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setstack(&attr, task->stack, stack);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  pthread_mutex_lock(&rtos_lock);
+  task->core = (xCoreID == tskNO_AFFINITY) ? (BaseType_t) (rtos_task_count % portNUM_PROCESSORS) : xCoreID;
+  err = pthread_create(&task->thread, &attr, task_entry, task);
+  if(err == 0)
+  {
+    rtos_task_count++;
+    task->next = rtos_tasks;
+    rtos_tasks = task;
+  }
+  pthread_mutex_unlock(&rtos_lock);
+  pthread_attr_destroy(&attr);
+
+  if(err != 0)
+  {
+    munmap(map, stack + page);
+    free(task);
+    return pdFAIL;
+  }
+  pthread_setname_np(task->thread, task->name);
+
+  if(pvCreatedTask != NULL)
+    *pvCreatedTask = task;
+
+  return pdPASS;
+}
+
+
+/*
+* @brief Starts a task with no core affinity.
+*/
+BaseType_t xTaskCreate(TaskFunction_t pvTaskCode, const char *pcName, uint32_t usStackDepth,
+                       void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pvCreatedTask)
+{
+  return xTaskCreatePinnedToCore(pvTaskCode, pcName, usStackDepth, pvParameters, uxPriority,
+                                 pvCreatedTask, tskNO_AFFINITY);
+}
+
+
+/*
+* @brief Thread entry, a task that returns is deleted.
+*/
+static void *task_entry(void *arg)
+{
+  rtos_self = (sim_task_t *) arg;
+  rtos_self->stack_top = __builtin_frame_address(0);
+  rtos_self->code(rtos_self->arg);
+  vTaskDelete(NULL);
+
+  return NULL;
+}
+
+
+/*
+* @brief Deletes the calling task. Deleting another task is not supported.
+*        The stack and task record are kept for sim_task_stack_peak().
+*/
+void vTaskDelete(TaskHandle_t xTask)
+{
+  configASSERT(xTask == NULL || xTask == rtos_self);
+
+  rtos_self = NULL;
+  pthread_exit(NULL);
+}
+
+
+/*
+* @brief Stack used below task_entry() by the first task with that name.
+*        See sim.h.
+*/
+size_t sim_task_stack_peak(const char *name)
+{
+  sim_task_t *task;
+  uint8_t *p;
+
+  pthread_mutex_lock(&rtos_lock);
+  for(task = rtos_tasks; task != NULL; task = task->next)
+  {
+    if(strcmp(task->name, name) == 0)
+      break;
+  }
+  pthread_mutex_unlock(&rtos_lock);
+
+  if(task == NULL || task->stack_top == NULL)
+    return 0;
+
+  // Stacks grow down: the lowest byte that lost its paint is the peak.
+  for(p = task->stack; p < task->stack_top && *p == TASK_STACK_PAINT; p++)
+    ;
+
+  return task->stack_top - p;
+}
+
+
+/*
+* @brief Blocks for a number of ticks.
+*/
+void vTaskDelay(TickType_t xTicksToDelay)
+{
+  sim_sleep_until(esp_timer_get_time() + (int64_t) xTicksToDelay * portTICK_PERIOD_MS * 1000);
+}
+
+
+/*
+* @brief Ticks since boot.
+*/
+TickType_t xTaskGetTickCount()
+{
+  return (TickType_t) (esp_timer_get_time() / (portTICK_PERIOD_MS * 1000));
+}
+
+
+/*
+* @brief The calling task, NULL on a thread that is not a task.
+*/
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  return rtos_self;
+}
+
+
+/*
+* @brief A task's name.
+*/
+char *pcTaskGetTaskName(TaskHandle_t xTaskToQuery)
+{
+  sim_task_t *task = (xTaskToQuery != NULL) ? (sim_task_t *) xTaskToQuery : rtos_self;
+
+  return (task != NULL) ? task->name : "";
+}
+
+
+/*
+* @brief Core the calling task was assigned to; threads that are not tasks
+*        (the stand-in "ISRs") run on core 0.
+*/
+BaseType_t xPortGetCoreID()
+{
+  return (rtos_self != NULL) ? rtos_self->core : 0;
+}
+
+
+/*
+* @brief Critical sections, all on the one recursive lock. See FreeRTOS.h.
+*/
+void vPortEnterCritical(portMUX_TYPE *mux)
+{
+  pthread_mutex_lock(&crit_lock);
+}
+
+
+void vPortExitCritical(portMUX_TYPE *mux)
+{
+  pthread_mutex_unlock(&crit_lock);
+}
+
+
+uint32_t sim_enter_critical_nested()
+{
+  pthread_mutex_lock(&crit_lock);
+  return 0;
+}
+
+
+void sim_exit_critical_nested(uint32_t state)
+{
+  pthread_mutex_unlock(&crit_lock);
+}
+
+
+/*
+* @brief configASSERT() failure.
+*/
+void sim_assert_failed(const char *file, int line)
+{
+  fprintf(stderr, "assert failed: %s:%d\n", file, line);
+  abort();
+}
+
+
+/*
+* @brief Initialises a condition variable on CLOCK_MONOTONIC.
+*/
+static void cond_init(pthread_cond_t *cond)
+{
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+
+/*
+* @brief Host deadline 'ticks' from now.
+*/
+static void deadline(TickType_t ticks, struct timespec *ts)
+{
+  if(ticks != portMAX_DELAY && ticks != 0)
+    sim_clock_deadline(esp_timer_get_time() + (int64_t) ticks * portTICK_PERIOD_MS * 1000, ts);
+}
+
+
+/*
+* @brief Waits on a condition with rtos_lock held.
+*
+* @return 0 once the deadline has passed (or right away for 0 ticks), 1
+*         otherwise
+*/
+static int wait(pthread_cond_t *cond, TickType_t ticks, const struct timespec *deadline)
+{
+  if(ticks == 0)
+    return 0;
+  if(ticks == portMAX_DELAY)
+    return pthread_cond_wait(cond, &rtos_lock) == 0;
+
+  return pthread_cond_timedwait(cond, &rtos_lock, deadline) == 0;
+}
+
+
+/*
+* @brief Creates a queue.
+*/
+QueueHandle_t xQueueCreate(UBaseType_t uxQueueLength, UBaseType_t uxItemSize)
+{
+  sim_queue_t *q;
+
+  q = calloc(1, sizeof(*q));
+  if(q == NULL)
+    return NULL;
+
+  if(uxItemSize > 0)
+  {
+    q->items = malloc((size_t) uxQueueLength * uxItemSize);
+    if(q->items == NULL)
+    {
+      free(q);
+      return NULL;
+    }
+  }
+  q->length = uxQueueLength;
+  q->item_size = uxItemSize;
+  cond_init(&q->cond);
+
+  return q;
+}
+
+
+/*
+* @brief Frees a queue.
+*/
+void vQueueDelete(QueueHandle_t xQueue)
+{
+  sim_queue_t *q = (sim_queue_t *) xQueue;
+
+  pthread_cond_destroy(&q->cond);
+  free(q->items);
+  free(q);
+}
+
+
+/*
+* @brief Copies an item in, then posts the queue to its set if it has one.
+*/
+static BaseType_t send(sim_queue_t *q, const void *item, TickType_t ticks, int overwrite)
+{
+  struct timespec ts;
+  sim_queue_t *set;
+  UBaseType_t tail;
+
+  deadline(ticks, &ts);
+
+  pthread_mutex_lock(&rtos_lock);
+  while(q->count == q->length && !overwrite)
+  {
+    if(!wait(&q->cond, ticks, &ts) && q->count == q->length)
+    {
+      pthread_mutex_unlock(&rtos_lock);
+      return pdFAIL;
+    }
+  }
+
+  if(q->count == q->length)
+  {
+    // xQueueOverwrite() on a full (length 1) queue
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+  }
+  tail = (q->head + q->count) % q->length;
+  if(q->item_size > 0)
+    memcpy(q->items + (size_t) tail * q->item_size, item, q->item_size);
+  q->count++;
+  pthread_cond_broadcast(&q->cond);
+
+  set = q->set;
+  if(set != NULL)
+  {
+    // FreeRTOS asserts the set is big enough for every member's items.
+    configASSERT(set->count < set->length);
+    tail = (set->head + set->count) % set->length;
+    memcpy(set->items + (size_t) tail * set->item_size, &q, sizeof(q));
+    set->count++;
+    pthread_cond_broadcast(&set->cond);
+  }
+  pthread_mutex_unlock(&rtos_lock);
+
+  return pdPASS;
+}
+
+
+/*
+* @brief Sends an item to the back of a queue.
+*/
+BaseType_t xQueueSend(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+  return send((sim_queue_t *) xQueue, pvItemToQueue, xTicksToWait, 0);
+}
+
+
+/*
+* @brief Same as xQueueSend().
+*/
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void *pvItemToQueue, TickType_t xTicksToWait)
+{
+  return send((sim_queue_t *) xQueue, pvItemToQueue, xTicksToWait, 0);
+}
+
+
+/*
+* @brief Sends to a length 1 queue, replacing the item in it.
+*/
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void *pvItemToQueue)
+{
+  return send((sim_queue_t *) xQueue, pvItemToQueue, 0, 1);
+}
+
+
+/*
+* @brief Sends without blocking. The waiting task is woken directly, so
+*        there is never a higher priority task to yield to.
+*/
+BaseType_t xQueueSendFromISR(QueueHandle_t xQueue, const void *pvItemToQueue,
+                             BaseType_t *pxHigherPriorityTaskWoken)
+{
+  if(pxHigherPriorityTaskWoken != NULL)
+    *pxHigherPriorityTaskWoken = pdFALSE;
+
+  return send((sim_queue_t *) xQueue, pvItemToQueue, 0, 0);
+}
+
+
+/*
+* @brief Copies the oldest item out, removing it unless peeking.
+*/
+static BaseType_t receive(sim_queue_t *q, void *buf, TickType_t ticks, int peek)
+{
+  struct timespec ts;
+
+  deadline(ticks, &ts);
+
+  pthread_mutex_lock(&rtos_lock);
+  while(q->count == 0)
+  {
+    if(!wait(&q->cond, ticks, &ts) && q->count == 0)
+    {
+      pthread_mutex_unlock(&rtos_lock);
+      return pdFAIL;
+    }
+  }
+
+  if(q->item_size > 0 && buf != NULL)
+    memcpy(buf, q->items + (size_t) q->head * q->item_size, q->item_size);
+  if(!peek)
+  {
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_broadcast(&q->cond);
+  }
+  pthread_mutex_unlock(&rtos_lock);
+
+  return pdPASS;
+}
+
+
+/*
+* @brief Takes the oldest item.
+*/
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+  return receive((sim_queue_t *) xQueue, pvBuffer, xTicksToWait, 0);
+}
+
+
+/*
+* @brief Copies the oldest item without taking it.
+*/
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void *pvBuffer, TickType_t xTicksToWait)
+{
+  return receive((sim_queue_t *) xQueue, pvBuffer, xTicksToWait, 1);
+}
+
+
+/*
+* @brief Empties a queue. Its entries in a queue set stay behind.
+*/
+BaseType_t xQueueReset(QueueHandle_t xQueue)
+{
+  sim_queue_t *q = (sim_queue_t *) xQueue;
+
+  pthread_mutex_lock(&rtos_lock);
+  q->head = 0;
+  q->count = 0;
+  pthread_cond_broadcast(&q->cond);
+  pthread_mutex_unlock(&rtos_lock);
+
+  return pdPASS;
+}
+
+
+/*
+* @brief Items in a queue.
+*/
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue)
+{
+  sim_queue_t *q = (sim_queue_t *) xQueue;
+  UBaseType_t count;
+
+  pthread_mutex_lock(&rtos_lock);
+  count = q->count;
+  pthread_mutex_unlock(&rtos_lock);
+
+  return count;
+}
+
+
+/*
+* @brief Free slots in a queue.
+*/
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue)
+{
+  sim_queue_t *q = (sim_queue_t *) xQueue;
+  UBaseType_t spaces;
+
+  pthread_mutex_lock(&rtos_lock);
+  spaces = q->length - q->count;
+  pthread_mutex_unlock(&rtos_lock);
+
+  return spaces;
+}
+
+
+/*
+* @brief Binary semaphore, created empty.
+*/
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+  return xQueueCreate(1, 0);
+}
+
+
+/*
+* @brief Mutex, created given. Priority inheritance is not modelled.
+*/
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  SemaphoreHandle_t sem = xQueueCreate(1, 0);
+
+  if(sem != NULL)
+    xQueueSend(sem, NULL, 0);
+
+  return sem;
+}
+
+
+/*
+* @brief A queue set is a queue of member handles.
+*/
+QueueSetHandle_t xQueueCreateSet(UBaseType_t uxEventQueueLength)
+{
+  return xQueueCreate(uxEventQueueLength, sizeof(sim_queue_t *));
+}
+
+
+/*
+* @brief Adds an empty queue to a set.
+*/
+BaseType_t xQueueAddToSet(QueueSetMemberHandle_t xQueueOrSemaphore, QueueSetHandle_t xQueueSet)
+{
+  sim_queue_t *q = (sim_queue_t *) xQueueOrSemaphore;
+  BaseType_t ret = pdFAIL;
+
+  pthread_mutex_lock(&rtos_lock);
+  if(q->set == NULL && q->count == 0)
+  {
+    q->set = (sim_queue_t *) xQueueSet;
+    ret = pdPASS;
+  }
+  pthread_mutex_unlock(&rtos_lock);
+
+  return ret;
+}
+
+
+/*
+* @brief Removes an empty queue from its set.
+*/
+BaseType_t xQueueRemoveFromSet(QueueSetMemberHandle_t xQueueOrSemaphore, QueueSetHandle_t xQueueSet)
+{
+  sim_queue_t *q = (sim_queue_t *) xQueueOrSemaphore;
+  BaseType_t ret = pdFAIL;
+
+  pthread_mutex_lock(&rtos_lock);
+  if(q->set == (sim_queue_t *) xQueueSet && q->count == 0)
+  {
+    q->set = NULL;
+    ret = pdPASS;
+  }
+  pthread_mutex_unlock(&rtos_lock);
+
+  return ret;
+}
+
+
+/*
+* @brief Waits for a member of the set to receive an item.
+*/
+QueueSetMemberHandle_t xQueueSelectFromSet(QueueSetHandle_t xQueueSet, TickType_t xBlockTimeTicks)
+{
+  sim_queue_t *member;
+
+  if(xQueueReceive(xQueueSet, &member, xBlockTimeTicks) != pdPASS)
+    return NULL;
+
+  return member;
+}
+
+
+/*
+* @brief Creates an event group with no bits set.
+*/
+EventGroupHandle_t xEventGroupCreate()
+{
+  sim_group_t *group;
+
+  group = calloc(1, sizeof(*group));
+  if(group == NULL)
+    return NULL;
+  cond_init(&group->cond);
+
+  return group;
+}
+
+
+/*
+* @brief Sets bits, waking waiters.
+*/
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet)
+{
+  sim_group_t *group = (sim_group_t *) xEventGroup;
+  EventBits_t bits;
+
+  pthread_mutex_lock(&rtos_lock);
+  group->bits |= uxBitsToSet;
+  bits = group->bits;
+  pthread_cond_broadcast(&group->cond);
+  pthread_mutex_unlock(&rtos_lock);
+
+  return bits;
+}
+
+
+/*
+* @brief Clears bits.
+*
+* @return the bits before clearing
+*/
+EventBits_t xEventGroupClearBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToClear)
+{
+  sim_group_t *group = (sim_group_t *) xEventGroup;
+  EventBits_t bits;
+
+  pthread_mutex_lock(&rtos_lock);
+  bits = group->bits;
+  group->bits &= ~uxBitsToClear;
+  pthread_mutex_unlock(&rtos_lock);
+
+  return bits;
+}
+
+
+/*
+* @brief Current bits.
+*/
+EventBits_t xEventGroupGetBits(EventGroupHandle_t xEventGroup)
+{
+  return xEventGroupClearBits(xEventGroup, 0);
+}
+
+
+/*
+* @brief Waits for any or all of a set of bits.
+*
+* @return the bits when the wait ended, before any clearing
+*/
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+                                const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits,
+                                TickType_t xTicksToWait)
+{
+  sim_group_t *group = (sim_group_t *) xEventGroup;
+  struct timespec ts;
+  EventBits_t bits;
+  int timed_out = 0;
+  int done;
+
+  deadline(xTicksToWait, &ts);
+
+  pthread_mutex_lock(&rtos_lock);
+  for(;;)
+  {
+    bits = group->bits;
+    done = xWaitForAllBits ? (bits & uxBitsToWaitFor) == uxBitsToWaitFor : (bits & uxBitsToWaitFor) != 0;
+    if(done)
+    {
+      if(xClearOnExit)
+        group->bits &= ~uxBitsToWaitFor;
+      break;
+    }
+    if(timed_out)
+      break;
+    timed_out = !wait(&group->cond, xTicksToWait, &ts);
+  }
+  pthread_mutex_unlock(&rtos_lock);
+
+  return bits;
+}
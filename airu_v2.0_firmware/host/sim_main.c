@@ -0,0 +1,703 @@
+/*
+*	sim_main.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Host entry point: sets up the stand-ins from the command line, runs the
+*   firmware's app_main() on a "main" task like the ESP-IDF startup code,
+*   lets it run for the requested simulated time and prints a report built
+*   from the firmware's own statistics.
+*
+*   Usage: airu_sim [options]
+*     -x SCALE              simulated time per host time (10)
+*     -d SECONDS            simulated run time (60)
+*     -u N:FILE[:MS[:LEN]]  replay FILE into UART N, LEN bytes every MS ms
+*     -u N:pty              connect UART N to a new pty
+*     -p CH[:UG]            simulated PMS sensor on PM channel CH's UART and
+*                           SET pin, reading UG ug/m3 PM2.5 (12)
+*     -F SECONDS:FAULT      the -p sensor hangs, gets stuck or garbles its
+*                           frames (hang, stuck, noise) SECONDS into the run,
+*                           until its fan next starts
+*     -l                    loop the capture files
+*     -s FILE               SD card image, created if needed
+*     -w MS                 WiFi connect time, -1 for no access point (2000)
+*     -A SECONDS:LEN        the access point goes away SECONDS into the run
+*                           for LEN seconds
+*     -r MS                 HTTP round trip time (50)
+*     -f PCT                HTTP requests that fail, % (0)
+*     -o FILE               write POST bodies to FILE and check them at the end
+*     -T SECONDS            RTC time at power on, 0 for never set (host time)
+*     -N FILE               NVS image, created at the first commit
+*     -S NAME=VALUE         commit a setting (settings_store.h) before boot
+*     -W SSID:PASSWORD      the access point only takes these credentials
+*     -B SECONDS:SSID:PASSWORD
+*                           a phone provisions these credentials over BLE
+*                           from SECONDS into the run (ble_prov.h)
+*     -D SECONDS[:MTU]      a phone subscribes to the sensor data over BLE
+*                           from SECONDS into the run, offering MTU (185);
+*                           the node has to be provisioned (ble_data.h)
+*     -q                    warnings and the report only
+*     -h                    prints these options
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "pm_if.h"
+#include "sensor.h"
+#include "gps.h"
+#include "uplink.h"
+#include "internet_if.h"
+#include "settings.h"
+#include "ble_prov.h"
+#include "ble_data.h"
+#include "uplink_batch.h"
+#include "timesync.h"
+#include "trace.h"
+#include "sim.h"
+
+#define SIM_SD_SECTORS      32768     // 16 MB
+#define SIM_MAIN_STACK      3584      // CONFIG_MAIN_TASK_STACK_SIZE
+#define SIM_MAIN_PRIO       1
+#define SIM_TEMP_C          22.5f
+#define SIM_HUM             40.0f
+#define SIM_RTC_FILE        "airu_sim_rtc.bin"
+
+void app_main();
+
+
+typedef struct
+{
+  uint32_t samples[SENSOR_MAX_DRIVERS];
+  uint32_t pm_n;            // PM samples timed from their last UART byte
+  int64_t pm_sum_us;
+  int64_t pm_max_us;
+} sim_latency_t;
+
+
+/* Function prototypes */
+static void usage(const char *prog, FILE *out);
+static int add_feed(const char *spec, int loop);
+static int add_pms(const char *spec);
+static int add_fault(const char *spec);
+static int add_setting(settings_t *settings, const char *spec);
+static int add_ap(const char *spec);
+static int add_phone(const char *spec);
+static int add_subscriber(const char *spec);
+static uint8_t *load(const char *path, size_t *len);
+static void vMain_task(void *pvParameters);
+static void latency_sink(const sensor_sample_t *sample, void *arg);
+static void report(int64_t run_us, double host_s);
+static void check_posts(const char *path);
+
+/* Global variables */
+static sim_latency_t sim_latency;
+static int sim_subscribed;            // The phone is a -D subscriber
+
+
+
+int main(int argc, char **argv)
+{
+  struct timespec t0;
+  struct timespec t1;
+  const char *sd_path = NULL;
+  const char *posts_path = NULL;
+  FILE *posts = NULL;
+  uint32_t scale = 10;
+  int64_t run_us = 60 * 1000000LL;
+  int64_t utc_us;
+  int64_t true_utc_us;
+  int64_t elapsed_us;
+  const char *fault = NULL;
+  const char *outage = NULL;
+  const char *nvs_path = NULL;
+  const char *ap = NULL;
+  const char *phone = NULL;
+  const char *subscriber = NULL;
+  settings_t settings;
+  int set = 0;
+  double outage_s;
+  char *end;
+  int32_t connect_ms = 2000;
+  uint32_t rtt_ms = 50;
+  uint32_t fail_pct = 0;
+  int loop = 0;
+  int opt;
+  struct timeval tv;
+
+  // Host time for both clocks; -T can put the RTC somewhere else.
+  gettimeofday(&tv, NULL);
+  true_utc_us = (int64_t) tv.tv_sec * 1000000 + tv.tv_usec;
+  utc_us = true_utc_us;
+
+  // First pass for the flags that apply to every feed.
+  while((opt = getopt(argc, argv, "x:d:u:ls:w:A:r:f:o:T:N:S:W:B:D:qp:F:h")) != -1)
+  {
+    switch(opt)
+    {
+      case 'x': scale = strtoul(optarg, NULL, 0); break;
+      case 'd': run_us = (int64_t) (strtod(optarg, NULL) * 1e6); break;
+      case 'l': loop = 1; break;
+      case 's': sd_path = optarg; break;
+      case 'w': connect_ms = strtol(optarg, NULL, 0); break;
+      case 'A': outage = optarg; break;
+      case 'r': rtt_ms = strtoul(optarg, NULL, 0); break;
+      case 'f': fail_pct = strtoul(optarg, NULL, 0); break;
+      case 'o': posts_path = optarg; break;
+      case 'T': utc_us = (int64_t) (strtod(optarg, NULL) * 1e6); break;
+      case 'N': nvs_path = optarg; break;
+      case 'S': break;
+      case 'W': ap = optarg; break;
+      case 'B': phone = optarg; break;
+      case 'D': subscriber = optarg; break;
+      case 'q': sim_log_level(ESP_LOG_WARN); break;
+      case 'u': break;
+      case 'p': break;
+      case 'F': fault = optarg; break;
+      case 'h': usage(argv[0], stdout); return 0;
+      default: usage(argv[0], stderr); return 2;
+    }
+  }
+
+  elapsed_us = sim_sleep_resume(argv, SIM_RTC_FILE, &utc_us, &true_utc_us);
+  if(elapsed_us >= run_us)
+    return 0;
+  sim_clock_init(scale, utc_us, true_utc_us);
+
+  if(nvs_path != NULL && sim_nvs_open(nvs_path) != ESP_OK)
+  {
+    fprintf(stderr, "%s is not an NVS image\n", nvs_path);
+    return 1;
+  }
+  settings_init();
+  settings_get(&settings);
+
+  optind = 1;
+  while((opt = getopt(argc, argv, "x:d:u:ls:w:A:r:f:o:T:N:S:W:B:D:qp:F:h")) != -1)
+  {
+    if(opt == 'u' && add_feed(optarg, loop) != 0)
+      return 1;
+    if(opt == 'p' && add_pms(optarg) != 0)
+      return 1;
+    if(opt == 'S' && elapsed_us == 0)
+    {
+      if(add_setting(&settings, optarg) != 0)
+        return 1;
+      set = 1;
+    }
+  }
+  // Only at power on, not again after every simulated deep sleep.
+  if(set && settings_commit(&settings) != ESP_OK)
+    return 1;
+  if(fault != NULL && add_fault(fault) != 0)
+    return 1;
+
+  if(sd_path != NULL && sim_sd_open(sd_path, SIM_SD_SECTORS) != ESP_OK)
+  {
+    fprintf(stderr, "cannot open %s\n", sd_path);
+    return 1;
+  }
+  if(posts_path != NULL)
+  {
+    posts = fopen(posts_path, elapsed_us > 0 ? "ab" : "wb");
+    if(posts == NULL)
+    {
+      fprintf(stderr, "cannot open %s\n", posts_path);
+      return 1;
+    }
+  }
+  sim_wifi_config(connect_ms, rtt_ms, fail_pct, posts);
+  if(outage != NULL)
+  {
+    outage_s = strtod(outage, &end);
+    if(*end != ':')
+    {
+      fprintf(stderr, "bad outage: %s\n", outage);
+      return 1;
+    }
+    sim_wifi_outage((int64_t) (outage_s * 1e6), (int64_t) (strtod(end + 1, NULL) * 1e6));
+  }
+  if(ap != NULL && add_ap(ap) != 0)
+    return 1;
+  if(phone != NULL && add_phone(phone) != 0)
+    return 1;
+  if(subscriber != NULL && add_subscriber(subscriber) != 0)
+    return 1;
+  sim_hdc1080_attach(SIM_TEMP_C, SIM_HUM);
+
+  // Sinks have to be in before app_main() starts the sensor task.
+  sensor_add_sink(latency_sink, &sim_latency);
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  if(xTaskCreate(vMain_task, "main", SIM_MAIN_STACK, NULL, SIM_MAIN_PRIO, NULL) != pdPASS)
+    return 1;
+
+  sim_sleep_until(run_us - elapsed_us);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  if(posts != NULL)
+    fflush(posts);
+  report(run_us - elapsed_us, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+  if(posts_path != NULL)
+    check_posts(posts_path);
+
+  fflush(stdout);
+  _exit(0);
+}
+
+
+/*
+* @brief Prints the options, to stdout for -h and stderr after a bad one.
+*/
+static void usage(const char *prog, FILE *out)
+{
+  fprintf(out,
+          "usage: %s [-x scale] [-d seconds] [-u N:file[:ms[:len]] | -u N:pty]... [-l] [-p ch[:ug]]\n"
+          "          [-F seconds:hang|stuck|noise] [-s sd.img] [-w connect_ms] [-A seconds:len]\n"
+          "          [-r rtt_ms] [-f fail_pct] [-o posts.bin]\n"
+          "          [-T rtc_seconds] [-N nvs.img] [-S name=value]... [-W ssid:password]\n"
+          "          [-B seconds:ssid:password] [-D seconds[:mtu]] [-q] [-h]\n", prog);
+}
+
+
+/*
+* @brief Sets up one -u feed.
+*
+* @return 0 on success
+*/
+static int add_feed(const char *spec, int loop)
+{
+  char path[256];
+  const char *p;
+  uint32_t period_ms = 0;
+  uint32_t burst = 0;
+  uint8_t *data;
+  size_t len;
+  int port;
+
+  port = strtol(spec, (char **) &p, 10);
+  if(*p++ != ':' || port < 0 || port >= SIM_UART_NUM)
+  {
+    fprintf(stderr, "bad feed: %s\n", spec);
+    return -1;
+  }
+
+  if(strcmp(p, "pty") == 0)
+    return (sim_uart_feed_pty(port) == ESP_OK) ? 0 : -1;
+
+  len = strcspn(p, ":");
+  if(len >= sizeof(path))
+    return -1;
+  memcpy(path, p, len);
+  path[len] = '\0';
+  if(p[len] == ':')
+    sscanf(p + len + 1, "%u:%u", &period_ms, &burst);
+
+  data = load(path, &len);
+  if(data == NULL)
+  {
+    fprintf(stderr, "cannot read %s\n", path);
+    return -1;
+  }
+
+  return (sim_uart_feed_file(port, data, len, period_ms, burst, loop) == ESP_OK) ? 0 : -1;
+}
+
+
+/*
+* @brief Sets up the -p sensor model.
+*
+* @return 0 on success
+*/
+static int add_pms(const char *spec)
+{
+  static const pm_channel_config_t channels[PM_MAX_CHANNELS] = PM_CHANNELS;
+  unsigned ch = PM_MAX_CHANNELS;
+  unsigned ug = 12;
+
+  if(sscanf(spec, "%u:%u", &ch, &ug) < 1 || ch >= PM_NUM_CHANNELS || ug > UINT16_MAX)
+  {
+    fprintf(stderr, "bad PMS model: %s\n", spec);
+    return -1;
+  }
+
+  return (sim_pms_attach(channels[ch].uart, channels[ch].set_pin, channels[ch].reset_pin, ug) == ESP_OK) ? 0 : -1;
+}
+
+
+/*
+* @brief Sets up the -F fault of the -p sensor.
+*
+* @return 0 on success
+*/
+static int add_fault(const char *spec)
+{
+  static const char *faults[] = { "hang", "stuck", "noise" };
+  const char *p;
+  double s;
+  int i;
+
+  s = strtod(spec, (char **) &p);
+  for(i = 0; i < 3 && *p == ':'; i++)
+  {
+    if(strcmp(p + 1, faults[i]) == 0)
+    {
+      sim_pms_fault(i + 1, (int64_t) (s * 1e6));
+      return 0;
+    }
+  }
+
+  fprintf(stderr, "bad fault: %s\n", spec);
+  return -1;
+}
+
+
+/*
+* @brief Applies a -S setting.
+*
+* @return 0 on success
+*/
+static int add_setting(settings_t *settings, const char *spec)
+{
+  char name[32];
+  const char *eq = strchr(spec, '=');
+
+  if(eq != NULL && (size_t) (eq - spec) < sizeof(name))
+  {
+    memcpy(name, spec, eq - spec);
+    name[eq - spec] = '\0';
+    if(settings_set(settings, name, eq + 1) == 0)
+      return 0;
+  }
+
+  fprintf(stderr, "bad setting: %s\n", spec);
+  return -1;
+}
+
+
+/*
+* @brief Sets up -W.
+*
+* @return 0 on success
+*/
+static int add_ap(const char *spec)
+{
+  char ssid[SETTINGS_SSID_LEN];
+  const char *colon = strchr(spec, ':');
+
+  if(colon == NULL || colon - spec >= (int) sizeof(ssid) || strlen(colon + 1) >= SETTINGS_PASSWORD_LEN)
+  {
+    fprintf(stderr, "bad access point: %s\n", spec);
+    return -1;
+  }
+  memcpy(ssid, spec, colon - spec);
+  ssid[colon - spec] = '\0';
+  sim_wifi_ap(ssid, colon + 1);
+
+  return 0;
+}
+
+
+/*
+* @brief Sets up -B.
+*
+* @return 0 on success
+*/
+static int add_phone(const char *spec)
+{
+  char ssid[SETTINGS_SSID_LEN];
+  const char *colon;
+  char *end;
+  double start_s = strtod(spec, &end);
+
+  colon = (*end == ':') ? strchr(end + 1, ':') : NULL;
+  if(colon == NULL || colon - (end + 1) >= (int) sizeof(ssid))
+  {
+    fprintf(stderr, "bad phone: %s\n", spec);
+    return -1;
+  }
+  memcpy(ssid, end + 1, colon - (end + 1));
+  ssid[colon - (end + 1)] = '\0';
+  if(sim_ble_phone((int64_t) (start_s * 1e6), ssid, colon + 1) != ESP_OK)
+  {
+    fprintf(stderr, "bad phone: %s\n", spec);
+    return -1;
+  }
+
+  return 0;
+}
+
+
+/*
+* @brief Sets up -D.
+*
+* @return 0 on success
+*/
+static int add_subscriber(const char *spec)
+{
+  char *end;
+  double start_s = strtod(spec, &end);
+  unsigned long mtu = (*end == ':') ? strtoul(end + 1, NULL, 0) : 185;
+
+  if((*end != '\0' && *end != ':') || mtu > UINT16_MAX ||
+     sim_ble_subscriber((int64_t) (start_s * 1e6), (uint16_t) mtu) != ESP_OK)
+  {
+    fprintf(stderr, "bad subscriber: %s\n", spec);
+    return -1;
+  }
+  sim_subscribed = 1;
+
+  return 0;
+}
+
+
+/*
+* @brief Reads a whole file.
+*/
+static uint8_t *load(const char *path, size_t *len)
+{
+  uint8_t *data = NULL;
+  long size;
+  FILE *f;
+
+  f = fopen(path, "rb");
+  if(f == NULL)
+    return NULL;
+
+  if(fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+  {
+    data = malloc(size);
+    if(data != NULL && fread(data, 1, size, f) != (size_t) size)
+    {
+      free(data);
+      data = NULL;
+    }
+    *len = size;
+  }
+  fclose(f);
+
+  return data;
+}
+
+
+/*
+* @brief What the ESP-IDF startup code does with app_main().
+*/
+static void vMain_task(void *pvParameters)
+{
+  app_main();
+  vTaskDelete(NULL);
+}
+
+
+/*
+* @brief Counts samples and times PM samples from the end of their frame.
+*        PM_init() registers first, so PM channel n is sensor n.
+*/
+static void latency_sink(const sensor_sample_t *sample, void *arg)
+{
+  static const pm_channel_config_t channels[PM_MAX_CHANNELS] = PM_CHANNELS;
+  sim_latency_t *lat = (sim_latency_t *) arg;
+  sim_uart_stats_t uart;
+  int64_t us;
+
+  if(sample->sensor < SENSOR_MAX_DRIVERS)
+    lat->samples[sample->sensor]++;
+  if(sample->sensor >= PM_NUM_CHANNELS)
+    return;
+
+  sim_uart_get_stats(channels[sample->sensor].uart, &uart);
+  us = esp_timer_get_time() - uart.last_rx_us;
+  lat->pm_n++;
+  lat->pm_sum_us += us;
+  if(us > lat->pm_max_us)
+    lat->pm_max_us = us;
+}
+
+
+/*
+* @brief Prints the firmware's statistics and what the run cost the host.
+*/
+static void report(int64_t run_us, double host_s)
+{
+  sim_uart_stats_t uart;
+  sim_http_stats_t http;
+  sim_pms_stats_t pms;
+  pm_stats_t pm;
+  sensor_stats_t sensor;
+  uplink_stats_t uplink;
+  gps_stats_t gps;
+  trace_stats_t trace;
+  timesync_stats_t ts;
+  wifi_conn_stats_t wifi;
+  settings_stats_t settings;
+  sim_nvs_stats_t nvs;
+  ble_prov_stats_t ble;
+  ble_data_stats_t data;
+  sim_ble_phone_stats_t phone;
+  struct rusage ru;
+  double cpu_s;
+  int port;
+  uint8_t ch;
+
+  getrusage(RUSAGE_SELF, &ru);
+  cpu_s = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+
+  sensor_get_stats(&sensor);
+  uplink_get_stats(&uplink);
+  gps_get_stats(&gps);
+  trace_get_stats(&trace);
+  timesync_get_stats(&ts);
+  sim_http_get_stats(&http);
+  wifi_get_stats(&wifi);
+  settings_get_stats(&settings);
+  sim_nvs_get_stats(&nvs);
+  ble_prov_get_stats(&ble);
+  ble_data_get_stats(&data);
+  sim_ble_phone_get_stats(&phone);
+
+  printf("\n--- %.1f s simulated in %.2f s (x%u), %.3f s CPU, max RSS %ld kB\n",
+         run_us / 1e6, host_s, sim_clock_scale(), cpu_s, ru.ru_maxrss);
+
+  for(port = 0; port < SIM_UART_NUM; port++)
+  {
+    sim_uart_get_stats(port, &uart);
+    if(uart.bytes_in + uart.bytes_dropped == 0)
+      continue;
+    printf("uart%d:    %u bytes, %u dropped, %u lost asleep, %u events, %u events dropped\n",
+           port, uart.bytes_in, uart.bytes_dropped, uart.bytes_asleep, uart.events, uart.events_dropped);
+  }
+
+  for(ch = 0; ch < PM_NUM_CHANNELS; ch++)
+  {
+    PM_get_stats(ch, &pm);
+    printf("pm%u:      %u frames, %u checksum errors, %u bytes skipped, %u wakeups (%u data), "
+           "%u us busy (%.1f us/frame), %u listen misses, %u overflows, %u bytes and %u samples dropped\n",
+           ch, pm.framer.frames, pm.framer.checksum_errs, pm.framer.bytes_skipped, pm.wakeups,
+           pm.data_events, pm.busy_us, pm.framer.frames ? (double) pm.busy_us / pm.framer.frames : 0.0,
+           pm.listen_misses, pm.overflows, pm.dropped_bytes, pm.dropped_samples);
+    if(pm.power.wakeups > 1 || pm.power.queries > 0 || pm.power.frames_dropped > 0)
+      printf("pm%u:      asleep %.1f s, settling %.1f s, measuring %.1f s, %u wakeups, %u queries, "
+             "%u frames used, %u dropped\n",
+             ch, pm.power.state_us[PM_POWER_SLEEP] / 1e6, pm.power.state_us[PM_POWER_SETTLE] / 1e6,
+             pm.power.state_us[PM_POWER_MEASURE] / 1e6, pm.power.wakeups, pm.power.queries,
+             pm.power.frames, pm.power.frames_dropped);
+    if(pm.health.state != PM_HEALTH_OK || pm.health.recoveries > 0)
+      printf("pm%u:      health state %u, faults %u checksum %u stuck %u silence %u overflow, "
+             "steps %u resync %u reinit %u power cycle, %u recoveries, last %u ms, worst %u ms, "
+             "degraded %.1f s\n",
+             ch, pm.health.state, pm.health.faults[PM_FAULT_CHECKSUM], pm.health.faults[PM_FAULT_STUCK],
+             pm.health.faults[PM_FAULT_SILENCE], pm.health.faults[PM_FAULT_OVERFLOW],
+             pm.health.actions[PM_HEALTH_RESYNC], pm.health.actions[PM_HEALTH_REINIT],
+             pm.health.actions[PM_HEALTH_POWER_CYCLE], pm.health.recoveries,
+             pm.health.last_recover_ms, pm.health.max_recover_ms, pm.health.degraded_us / 1e6);
+  }
+  sim_pms_get_stats(&pms);
+  if(pms.frames + pms.commands > 0)
+    printf("pms:      %u frames, %u commands, %u fan starts, fan on %.1f s (%.0f%%)\n",
+           pms.frames, pms.commands, pms.wakeups, pms.fan_us / 1e6, 100.0 * pms.fan_us / run_us);
+  if(sim_latency.pm_n > 0)
+    printf("latency:  frame end to sink avg %.0f us, max %lld us (simulated)\n",
+           (double) sim_latency.pm_sum_us / sim_latency.pm_n, (long long) sim_latency.pm_max_us);
+  printf("sensor:   %u samples, %u wakeups, %u us busy\n", sensor.samples, sensor.wakeups, sensor.busy_us);
+  if(gps.bytes > 0)
+    printf("gps:      %u bytes, %u sentences, %u checksum errors, %u us busy, worst poll %u us\n",
+           gps.bytes, gps.nmea.sentences, gps.nmea.checksum_errs, gps.busy_us, gps.worst_us);
+  printf("time:     source %u, offset %d us, jitter %u us, %u steps\n",
+         ts.source, ts.offset_us, ts.jitter_us, ts.steps);
+  printf("uplink:   %u samples in %u bytes, %u/%u requests failed, %u samples dropped\n",
+         uplink.samples_sent, uplink.bytes_sent, uplink.failures, uplink.requests, uplink.samples_dropped);
+  if(wifi.attempts > 0)
+    printf("wifi:     %u attempts (%u fast, %u/h), %u fast and %u scan connects, %u on a cached address, "
+           "%u failed (%u timed out), %u drops, connect p50 %u ms, p90 %u ms, max %u ms\n",
+           wifi.attempts, wifi.fast_attempts, wifi.attempts_per_h, wifi.fast_ok, wifi.scan_ok,
+           wifi.ip_reused, wifi.failures, wifi.timeouts, wifi.drops, wifi.connect_p50_ms,
+           wifi.connect_p90_ms, wifi.connect_max_ms);
+  printf("http:     %u requests, %u failed, %u bytes\n", http.requests, http.failures, http.bytes);
+  printf("settings: %s, commit %u in slot %u, %u bad slots, loaded in %u us, %u commits (%u failed), "
+         "last %u us, max %u us; nvs %u reads, %u writes, %u image writes of %u bytes\n",
+         settings.source == SETTINGS_FROM_NVS ? "nvs" : "defaults", settings.seq, settings.slot,
+         settings.bad_slots, settings.load_us, settings.commits, settings.failures,
+         settings.last_commit_us, settings.max_commit_us, nvs.reads, nvs.writes, nvs.commits,
+         nvs.bytes_written);
+  if(ble.running || ble.released)
+    printf("ble:      %s, status %u, %u connects, %u writes (%u refused), %u failed connects, mtu %u, "
+           "connected %u ms and client told %u ms after the write, took %u bytes, gave back %u bytes\n",
+           ble.running ? "running" : "released", ble.status, ble.connects, ble.writes, ble.bad_writes,
+           ble.failures, ble.mtu, ble.connect_ms, ble.latency_ms, ble.heap_used, ble.heap_recovered);
+  if(data.running)
+    printf("ble:      data, %u connects, %u subscriptions (%u refused), mtu %u, %u means in %u bytes "
+           "over %.1f h; %u notifications with %u records in %u bytes, %u congested, %u resends, "
+           "%u live dropped; history %u records, %u bytes in %u ms; took %u bytes\n",
+           data.connects, data.subscriptions, data.mtu_refused, data.mtu, data.records_stored,
+           data.history_bytes, data.history_s / 3600.0, data.notifications, data.records, data.bytes,
+           data.congested, data.resends, data.live_dropped, data.backlog_records, data.backlog_bytes,
+           data.backlog_ms, data.heap_used);
+  if(phone.connect_us > 0 && sim_subscribed)
+    printf("phone:    %s, mtu %u, %u notifications with %u records in %u bytes, %u bad blocks, "
+           "history in %.0f ms (%.1f kB/s)\n",
+           phone.done ? "gone" : "subscribed", phone.mtu, phone.notifications, phone.records,
+           phone.rx_bytes, phone.bad_blocks,
+           phone.backlog_us > 0 ? (phone.backlog_us - phone.written_us) / 1e3 : 0.0,
+           phone.backlog_us > phone.written_us ?
+             data.backlog_bytes / 1.024 / ((phone.backlog_us - phone.written_us) / 1e3) : 0.0);
+  else if(phone.connect_us > 0)
+    printf("phone:    %s, status %d, mtu %u, %u requests with %u bytes in %.0f ms, %u notifications, "
+           "outcome %.0f ms after the write\n",
+           phone.done ? "done" : "waiting", phone.status, phone.mtu, phone.writes, phone.bytes,
+           (phone.written_us - phone.connect_us) / 1e3, phone.notifications,
+           phone.status_us > phone.written_us ? (phone.status_us - phone.written_us) / 1e3 : 0.0);
+  printf("trace:    %u entries, %u lost, %u us busy\n", trace.entries, trace.lost, trace.busy_us);
+}
+
+
+/*
+* @brief Decodes every POST body written with -o, as the server would.
+*/
+static void check_posts(const char *path)
+{
+  static pm_sample_t samples[UPLINK_BATCH_MAX];
+  static uint8_t body[UPLINK_BATCH_MAX];
+  uint8_t hdr[4];
+  uint32_t len;
+  uint32_t posts = 0;
+  uint32_t bad = 0;
+  uint32_t total = 0;
+  int n;
+  FILE *f;
+
+  f = fopen(path, "rb");
+  if(f == NULL)
+    return;
+
+  while(fread(hdr, 1, sizeof(hdr), f) == sizeof(hdr))
+  {
+    len = hdr[0] | (hdr[1] << 8) | (hdr[2] << 16) | ((uint32_t) hdr[3] << 24);
+    if(len > sizeof(body) || fread(body, 1, len, f) != len)
+    {
+      bad++;
+      break;
+    }
+    posts++;
+    n = uplink_batch_decode(body, len, samples, UPLINK_BATCH_MAX);
+    if(n < 0)
+      bad++;
+    else
+      total += n;
+  }
+  fclose(f);
+
+  printf("posts:    %u decoded, %u bad, %u samples\n", posts, bad, total);
+}
@@ -0,0 +1,169 @@
+/*
+*	sim_models.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Puts the firmware's own sensor models on the stand-in buses. This file
+*   is built without ESP_PLATFORM so the models' host-only declarations are
+*   visible.
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "hdc1080.h"
+#include "pm_power.h"
+#include "sim.h"
+
+#define SIM_PMS_SETTLE_MS  30000  // Datasheet: stable 30 s after wake up
+#define SIM_PMS_PIN_US     10000  // How often the model looks at its SET pin
+
+
+/* Function prototypes */
+static void *pms_thread(void *arg);
+static void pms_rx(void *ctx, const uint8_t *data, size_t len);
+
+/* Global variables */
+static hdc1080_sim_t sim_hdc;
+static pm_sim_t sim_pms;
+static pthread_mutex_t sim_pms_lock = PTHREAD_MUTEX_INITIALIZER;
+static int sim_pms_port;
+static int sim_pms_pin;
+static int sim_pms_reset;
+
+
+
+/*
+* @brief Attaches the HDC1080 register model. See sim.h.
+*/
+esp_err_t sim_hdc1080_attach(float temp_c, float hum)
+{
+  hdc1080_bus_t bus;
+  sim_i2c_dev_t dev;
+
+  hdc1080_sim_init(&sim_hdc, &bus);
+  sim_hdc.temp_raw = (uint16_t) ((temp_c + 40.0f) / 165.0f * 65536.0f);
+  sim_hdc.hum_raw = (uint16_t) (hum / 100.0f * 65536.0f);
+
+  dev.write = bus.write;
+  dev.read = bus.read;
+  dev.ctx = bus.ctx;
+  dev.now_us = &sim_hdc.now_us;
+
+  return sim_i2c_attach(HDC1080_ADDR, &dev);
+}
+
+
+/*
+* @brief Attaches the PMS model. See sim.h.
+*/
+esp_err_t sim_pms_attach(int port, int set_pin, int reset_pin, uint16_t pm2_5)
+{
+  pthread_t thread;
+  esp_err_t err;
+
+  pm_sim_init(&sim_pms, pm2_5, SIM_PMS_SETTLE_MS, esp_timer_get_time());
+  sim_pms_port = port;
+  sim_pms_pin = set_pin;
+  sim_pms_reset = reset_pin;
+
+  // The sensor pulls both inputs up, they read high until driven.
+  if(set_pin >= 0)
+    gpio_set_level(set_pin, 1);
+  if(reset_pin >= 0)
+    gpio_set_level(reset_pin, 1);
+
+  err = sim_uart_attach(port, pms_rx, &sim_pms);
+  if(err != ESP_OK)
+    return err;
+
+  if(pthread_create(&thread, NULL, pms_thread, &sim_pms) != 0)
+    return ESP_ERR_NO_MEM;
+  pthread_setname_np(thread, "pms_model");
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the PMS model's statistics out. See sim.h.
+*/
+void sim_pms_get_stats(sim_pms_stats_t *stats)
+{
+  pthread_mutex_lock(&sim_pms_lock);
+  sim_pms.now_us = esp_timer_get_time();
+  stats->frames = sim_pms.frames;
+  stats->commands = sim_pms.commands;
+  stats->wakeups = sim_pms.wakeups;
+  stats->fan_us = pm_sim_fan_us(&sim_pms);
+  pthread_mutex_unlock(&sim_pms_lock);
+}
+
+
+/*
+* @brief Schedules a PMS model fault. See sim.h.
+*/
+void sim_pms_fault(int fault, int64_t at_us)
+{
+  pthread_mutex_lock(&sim_pms_lock);
+  pm_sim_fault(&sim_pms, (pm_sim_fault_t) fault, at_us);
+  pthread_mutex_unlock(&sim_pms_lock);
+}
+
+
+/*
+* @brief The sensor: follows the SET and RESET pins and sends whatever frame is due,
+*        at the line rate.
+*/
+static void *pms_thread(void *arg)
+{
+  pm_sim_t *sim = (pm_sim_t *) arg;
+  uint8_t frame[PM_FRAME_LEN];
+  int64_t now_us;
+  int64_t next_us;
+  size_t len;
+
+  for(;;)
+  {
+    now_us = esp_timer_get_time();
+
+    pthread_mutex_lock(&sim_pms_lock);
+    sim->now_us = now_us;
+    if(sim_pms_pin >= 0 && gpio_get_level(sim_pms_pin) != sim->set_pin)
+      pm_sim_set_pin(sim, gpio_get_level(sim_pms_pin));
+    if(sim_pms_reset >= 0 && gpio_get_level(sim_pms_reset) != sim->reset_pin)
+      pm_sim_reset_pin(sim, gpio_get_level(sim_pms_reset));
+    len = pm_sim_tx(sim, frame);
+    next_us = pm_sim_next(sim);
+    pthread_mutex_unlock(&sim_pms_lock);
+
+    // Nothing is received before the driver is installed, as on the node.
+    if(len > 0)
+      sim_uart_send(sim_pms_port, frame, len);
+
+    if(next_us > now_us + SIM_PMS_PIN_US)
+      next_us = now_us + SIM_PMS_PIN_US;
+    sim_sleep_until(next_us);
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Commands from the node.
+*/
+static void pms_rx(void *ctx, const uint8_t *data, size_t len)
+{
+  pm_sim_t *sim = (pm_sim_t *) ctx;
+
+  pthread_mutex_lock(&sim_pms_lock);
+  sim->now_us = esp_timer_get_time();
+  pm_sim_rx(sim, data, len);
+  pthread_mutex_unlock(&sim_pms_lock);
+}
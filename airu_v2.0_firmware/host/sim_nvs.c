@@ -0,0 +1,351 @@
+/*
+*	sim_nvs.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   NVS stand-in. Blobs are kept in a table in RAM under their namespace
+*   and key, with the size limits of IDF v3.1 NVS. nvs_commit() writes the
+*   whole table to the image file from sim_nvs_open() the way an atomic
+*   update has to be done on a host: to a temporary file, fsync() and
+*   rename() over the old image. Without an image NVS lasts until the
+*   program exits, which includes a simulated deep sleep.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "nvs.h"
+#include "sim.h"
+
+#define NVS_MAX_ENTRIES   32
+#define NVS_MAX_HANDLES   8
+#define NVS_NAME_LEN      16        // 15 characters and the terminator
+#define NVS_BLOB_MAX      1984      // Largest blob that fits in one NVS page
+#define NVS_MAGIC         0x53564e53  // "SNVS"
+
+
+typedef struct
+{
+  char ns[NVS_NAME_LEN];
+  char key[NVS_NAME_LEN];
+  uint32_t len;
+} nvs_record_t;
+
+typedef struct
+{
+  nvs_record_t rec;
+  uint8_t data[NVS_BLOB_MAX];
+} nvs_entry_t;
+
+typedef struct
+{
+  char ns[NVS_NAME_LEN];    // "" if free
+  nvs_open_mode mode;
+} nvs_open_t;
+
+
+/* Function prototypes */
+static nvs_open_t *lookup(nvs_handle handle);
+static nvs_entry_t *find(const char *ns, const char *key);
+static esp_err_t save();
+
+/* Global variables */
+static pthread_mutex_t nvs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static nvs_entry_t nvs_entries[NVS_MAX_ENTRIES];
+static size_t nvs_num_entries;
+static nvs_open_t nvs_handles[NVS_MAX_HANDLES];
+static const char *nvs_path;
+static int nvs_ready;
+static sim_nvs_stats_t nvs_stats;
+
+
+
+/*
+* @brief Backs NVS with an image file. See sim.h.
+*/
+esp_err_t sim_nvs_open(const char *path)
+{
+  nvs_record_t rec;
+  uint32_t header[2];
+  FILE *f;
+  uint32_t i;
+
+  nvs_path = path;
+  nvs_num_entries = 0;
+
+  f = fopen(path, "rb");
+  if(f == NULL)
+    return ESP_OK;
+
+  if(fread(header, sizeof(header), 1, f) != 1 || header[0] != NVS_MAGIC || header[1] > NVS_MAX_ENTRIES)
+  {
+    fclose(f);
+    return ESP_FAIL;
+  }
+
+  for(i = 0; i < header[1]; i++)
+  {
+    if(fread(&rec, sizeof(rec), 1, f) != 1 || rec.len > NVS_BLOB_MAX ||
+       fread(nvs_entries[i].data, 1, rec.len, f) != rec.len)
+    {
+      fclose(f);
+      nvs_num_entries = 0;
+      return ESP_FAIL;
+    }
+    nvs_entries[i].rec = rec;
+  }
+  nvs_num_entries = header[1];
+  fclose(f);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies the statistics out. See sim.h.
+*/
+void sim_nvs_get_stats(sim_nvs_stats_t *stats)
+{
+  pthread_mutex_lock(&nvs_mutex);
+  *stats = nvs_stats;
+  pthread_mutex_unlock(&nvs_mutex);
+}
+
+
+esp_err_t nvs_flash_init()
+{
+  nvs_ready = 1;
+  return ESP_OK;
+}
+
+
+/*
+* @brief Erases every namespace, in the image as well.
+*/
+esp_err_t nvs_flash_erase()
+{
+  esp_err_t err;
+
+  pthread_mutex_lock(&nvs_mutex);
+  nvs_num_entries = 0;
+  err = save();
+  pthread_mutex_unlock(&nvs_mutex);
+
+  return err;
+}
+
+
+esp_err_t nvs_open(const char *name, nvs_open_mode open_mode, nvs_handle *out_handle)
+{
+  int i;
+
+  if(!nvs_ready)
+    return ESP_ERR_NVS_NOT_INITIALIZED;
+  if(strlen(name) >= NVS_NAME_LEN)
+    return ESP_ERR_NVS_KEY_TOO_LONG;
+
+  pthread_mutex_lock(&nvs_mutex);
+  for(i = 0; i < NVS_MAX_HANDLES && nvs_handles[i].ns[0] != '\0'; i++)
+    ;
+  if(i < NVS_MAX_HANDLES)
+  {
+    strcpy(nvs_handles[i].ns, name);
+    nvs_handles[i].mode = open_mode;
+    *out_handle = i + 1;
+  }
+  pthread_mutex_unlock(&nvs_mutex);
+
+  return (i < NVS_MAX_HANDLES) ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+
+esp_err_t nvs_set_blob(nvs_handle handle, const char *key, const void *value, size_t length)
+{
+  nvs_open_t *h;
+  nvs_entry_t *e;
+  esp_err_t err = ESP_OK;
+
+  if(strlen(key) >= NVS_NAME_LEN)
+    return ESP_ERR_NVS_KEY_TOO_LONG;
+  if(length > NVS_BLOB_MAX)
+    return ESP_ERR_NVS_VALUE_TOO_LONG;
+
+  pthread_mutex_lock(&nvs_mutex);
+  h = lookup(handle);
+  if(h == NULL)
+    err = ESP_ERR_NVS_INVALID_HANDLE;
+  else if(h->mode == NVS_READONLY)
+    err = ESP_ERR_NVS_READ_ONLY;
+  else if((e = find(h->ns, key)) == NULL && nvs_num_entries == NVS_MAX_ENTRIES)
+    err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+  else
+  {
+    if(e == NULL)
+    {
+      e = &nvs_entries[nvs_num_entries++];
+      strcpy(e->rec.ns, h->ns);
+      strcpy(e->rec.key, key);
+    }
+    memcpy(e->data, value, length);
+    e->rec.len = length;
+    nvs_stats.writes++;
+  }
+  pthread_mutex_unlock(&nvs_mutex);
+
+  return err;
+}
+
+
+/*
+* @brief As in IDF: with out_value NULL only the length is returned, and
+*        a buffer that is too small is an error.
+*/
+esp_err_t nvs_get_blob(nvs_handle handle, const char *key, void *out_value, size_t *length)
+{
+  nvs_open_t *h;
+  nvs_entry_t *e = NULL;
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&nvs_mutex);
+  h = lookup(handle);
+  if(h == NULL)
+    err = ESP_ERR_NVS_INVALID_HANDLE;
+  else if((e = find(h->ns, key)) == NULL)
+    err = ESP_ERR_NVS_NOT_FOUND;
+  else if(out_value != NULL && *length < e->rec.len)
+    err = ESP_ERR_NVS_INVALID_LENGTH;
+  else
+  {
+    if(out_value != NULL)
+      memcpy(out_value, e->data, e->rec.len);
+    *length = e->rec.len;
+    nvs_stats.reads++;
+  }
+  pthread_mutex_unlock(&nvs_mutex);
+
+  return err;
+}
+
+
+esp_err_t nvs_erase_key(nvs_handle handle, const char *key)
+{
+  nvs_open_t *h;
+  nvs_entry_t *e = NULL;
+  esp_err_t err = ESP_OK;
+
+  pthread_mutex_lock(&nvs_mutex);
+  h = lookup(handle);
+  if(h == NULL)
+    err = ESP_ERR_NVS_INVALID_HANDLE;
+  else if(h->mode == NVS_READONLY)
+    err = ESP_ERR_NVS_READ_ONLY;
+  else if((e = find(h->ns, key)) == NULL)
+    err = ESP_ERR_NVS_NOT_FOUND;
+  else
+    *e = nvs_entries[--nvs_num_entries];
+  pthread_mutex_unlock(&nvs_mutex);
+
+  return err;
+}
+
+
+/*
+* @brief Writes the image.
+*/
+esp_err_t nvs_commit(nvs_handle handle)
+{
+  esp_err_t err;
+
+  pthread_mutex_lock(&nvs_mutex);
+  err = (lookup(handle) != NULL) ? save() : ESP_ERR_NVS_INVALID_HANDLE;
+  pthread_mutex_unlock(&nvs_mutex);
+
+  return err;
+}
+
+
+void nvs_close(nvs_handle handle)
+{
+  nvs_open_t *h;
+
+  pthread_mutex_lock(&nvs_mutex);
+  h = lookup(handle);
+  if(h != NULL)
+    h->ns[0] = '\0';
+  pthread_mutex_unlock(&nvs_mutex);
+}
+
+
+/*
+* @brief Open handle, or NULL. Called with nvs_mutex held.
+*/
+static nvs_open_t *lookup(nvs_handle handle)
+{
+  if(handle == 0 || handle > NVS_MAX_HANDLES || nvs_handles[handle - 1].ns[0] == '\0')
+    return NULL;
+
+  return &nvs_handles[handle - 1];
+}
+
+
+/*
+* @brief Entry of a key, or NULL. Called with nvs_mutex held.
+*/
+static nvs_entry_t *find(const char *ns, const char *key)
+{
+  size_t i;
+
+  for(i = 0; i < nvs_num_entries; i++)
+  {
+    if(strcmp(nvs_entries[i].rec.ns, ns) == 0 && strcmp(nvs_entries[i].rec.key, key) == 0)
+      return &nvs_entries[i];
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Replaces the image with the table. Called with nvs_mutex held.
+*/
+static esp_err_t save()
+{
+  char tmp[256];
+  uint32_t header[2] = { NVS_MAGIC, (uint32_t) nvs_num_entries };
+  size_t bytes = sizeof(header);
+  int ok;
+  size_t i;
+  FILE *f;
+
+  nvs_stats.commits++;
+  if(nvs_path == NULL)
+    return ESP_OK;
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp", nvs_path);
+  f = fopen(tmp, "wb");
+  if(f == NULL)
+    return ESP_FAIL;
+
+  ok = (fwrite(header, sizeof(header), 1, f) == 1);
+  for(i = 0; ok && i < nvs_num_entries; i++)
+  {
+    ok = (fwrite(&nvs_entries[i].rec, sizeof(nvs_record_t), 1, f) == 1 &&
+          fwrite(nvs_entries[i].data, 1, nvs_entries[i].rec.len, f) == nvs_entries[i].rec.len);
+    bytes += sizeof(nvs_record_t) + nvs_entries[i].rec.len;
+  }
+  ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+  ok = (fclose(f) == 0) && ok;
+  if(!ok || rename(tmp, nvs_path) != 0)
+  {
+    unlink(tmp);
+    return ESP_FAIL;
+  }
+  nvs_stats.bytes_written += bytes;
+
+  return ESP_OK;
+}
@@ -0,0 +1,817 @@
+/*
+*	sim_periph.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The smaller stand-ins: logging, error names, GPIO, I2C, the SD card,
+*   power management and esp_system. See the headers in include/.
+*
+*   The heap figures count what the firmware and the stand-ins allocate
+*   (malloc and friends are wrapped at link time, see the Makefile), against
+*   the free heap an ESP32 has after boot with WiFi running, less the DRAM
+*   reserved for the Bluetooth controller until it is released (sim_ble.c).
+*/
+
+#include <pthread.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_pm.h"
+#include "nvs.h"
+#include "driver/gpio.h"
+#include "driver/i2c.h"
+#include "driver/sdmmc_host.h"
+#include "sdmmc_cmd.h"
+#include "sim.h"
+
+#define LOG_MAX_TAGS      16
+#define I2C_MAX_OPS       16
+#define I2C_MAX_XFER      32
+#define I2C_BITS_PER_BYTE 9     // 8 data bits and the ACK
+#define SD_SECTOR_SIZE    512
+#define SIM_HEAP_SIZE     (180 * 1024)
+#ifdef CONFIG_BT_ENABLED
+#define SIM_BT_RESERVED   CONFIG_BT_RESERVE_DRAM
+#else
+#define SIM_BT_RESERVED   0
+#endif
+
+
+typedef enum
+{
+  I2C_OP_START,
+  I2C_OP_WRITE,
+  I2C_OP_READ,
+  I2C_OP_STOP
+} i2c_op_type_t;
+
+typedef struct
+{
+  i2c_op_type_t type;
+  uint8_t *data;            // Read destination
+  uint8_t bytes[I2C_MAX_XFER];
+  size_t len;
+} i2c_op_t;
+
+struct sim_i2c_cmd
+{
+  i2c_op_t ops[I2C_MAX_OPS];
+  uint8_t count;
+};
+
+struct esp_pm_lock
+{
+  const char *name;
+  uint32_t count;
+};
+
+
+/* Function prototypes */
+static esp_err_t i2c_xfer(uint8_t addr_rw, const uint8_t *wbuf, size_t wlen, i2c_op_t *ops, uint8_t nops);
+
+/* Global variables */
+static struct
+{
+  const char *tag;
+  esp_log_level_t level;
+} log_tags[LOG_MAX_TAGS];
+static uint8_t log_num_tags;
+static esp_log_level_t log_default = CONFIG_LOG_DEFAULT_LEVEL;
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t gpio_levels[GPIO_NUM_MAX];
+
+static int pm_light_sleep;                  // esp_pm_configure() turned light sleep on
+static uint32_t pm_awake;                   // Locks held, each keeps the chip out of light sleep
+static int64_t pm_awake_us;                 // When the first of them was taken
+static pthread_mutex_t pm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct
+{
+  uint8_t addr;
+  sim_i2c_dev_t dev;
+} i2c_devs[SIM_I2C_MAX_DEVS];
+static uint8_t i2c_num_devs;
+static uint32_t i2c_clk_hz = 100000;
+static pthread_mutex_t i2c_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int sd_fd = -1;
+static uint32_t sd_sectors;
+
+
+
+/*
+* @brief Sets the default log level. See sim.h.
+*/
+void sim_log_level(int level)
+{
+  log_default = (esp_log_level_t) level;
+}
+
+
+/*
+* @brief Sets a tag's log level. A level set here wins over sim_log_level()
+*        only if it is less verbose.
+*/
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+  uint8_t i;
+
+  pthread_mutex_lock(&log_lock);
+  if(strcmp(tag, "*") == 0)
+  {
+    log_default = level;
+    log_num_tags = 0;
+  }
+  else
+  {
+    for(i = 0; i < log_num_tags && strcmp(log_tags[i].tag, tag) != 0; i++)
+      ;
+    if(i < LOG_MAX_TAGS)
+    {
+      log_tags[i].tag = tag;
+      log_tags[i].level = level;
+      if(i == log_num_tags)
+        log_num_tags++;
+    }
+  }
+  pthread_mutex_unlock(&log_lock);
+}
+
+
+/*
+* @brief Prints a log line in the ESP-IDF format.
+*/
+void esp_log_write(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+  static const char letters[] = "NEWIDV";
+  esp_log_level_t limit = log_default;
+  va_list args;
+  uint8_t i;
+
+  pthread_mutex_lock(&log_lock);
+  for(i = 0; i < log_num_tags; i++)
+  {
+    if(strcmp(log_tags[i].tag, tag) == 0)
+    {
+      if(log_tags[i].level < limit)
+        limit = log_tags[i].level;
+      break;
+    }
+  }
+
+  if(level <= limit)
+  {
+    printf("%c (%u) %s: ", letters[level], (unsigned) (esp_timer_get_time() / 1000), tag);
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+    putchar('\n');
+  }
+  pthread_mutex_unlock(&log_lock);
+}
+
+
+/*
+* @brief Names of the error codes the firmware can see.
+*/
+const char *esp_err_to_name(esp_err_t code)
+{
+  switch(code)
+  {
+    case ESP_OK:                    return "ESP_OK";
+    case ESP_FAIL:                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:       return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:   return "ESP_ERR_INVALID_VERSION";
+    case ESP_ERR_INVALID_MAC:       return "ESP_ERR_INVALID_MAC";
+    case ESP_ERR_NVS_NOT_INITIALIZED: return "ESP_ERR_NVS_NOT_INITIALIZED";
+    case ESP_ERR_NVS_NOT_FOUND:     return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_READ_ONLY:     return "ESP_ERR_NVS_READ_ONLY";
+    case ESP_ERR_NVS_NOT_ENOUGH_SPACE: return "ESP_ERR_NVS_NOT_ENOUGH_SPACE";
+    case ESP_ERR_NVS_INVALID_NAME:  return "ESP_ERR_NVS_INVALID_NAME";
+    case ESP_ERR_NVS_INVALID_HANDLE: return "ESP_ERR_NVS_INVALID_HANDLE";
+    case ESP_ERR_NVS_KEY_TOO_LONG:  return "ESP_ERR_NVS_KEY_TOO_LONG";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    case ESP_ERR_NVS_NO_FREE_PAGES: return "ESP_ERR_NVS_NO_FREE_PAGES";
+    case ESP_ERR_NVS_VALUE_TOO_LONG: return "ESP_ERR_NVS_VALUE_TOO_LONG";
+    default:                        return "UNKNOWN ERROR";
+  }
+}
+
+
+/*
+* @brief GPIO stand-ins. Levels are remembered, nothing else happens.
+*/
+esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+  return (gpio_num >= 0 && gpio_num < GPIO_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+  if(gpio_num < 0 || gpio_num >= GPIO_NUM_MAX)
+    return ESP_ERR_INVALID_ARG;
+
+  gpio_levels[gpio_num] = level;
+  return ESP_OK;
+}
+
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+  return (gpio_num >= 0 && gpio_num < GPIO_NUM_MAX) ? (int) gpio_levels[gpio_num] : 0;
+}
+
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio_num, gpio_pull_mode_t pull)
+{
+  return gpio_set_direction(gpio_num, GPIO_MODE_INPUT);
+}
+
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type)
+{
+  return gpio_set_direction(gpio_num, GPIO_MODE_INPUT);
+}
+
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+  return ESP_OK;
+}
+
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+  return gpio_set_direction(gpio_num, GPIO_MODE_INPUT);
+}
+
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+  return gpio_set_direction(gpio_num, GPIO_MODE_INPUT);
+}
+
+
+esp_err_t gpio_hold_en(gpio_num_t gpio_num)
+{
+  return gpio_set_direction(gpio_num, GPIO_MODE_OUTPUT);
+}
+
+
+esp_err_t gpio_hold_dis(gpio_num_t gpio_num)
+{
+  return gpio_set_direction(gpio_num, GPIO_MODE_OUTPUT);
+}
+
+
+void gpio_deep_sleep_hold_en(void)
+{
+}
+
+
+void gpio_deep_sleep_hold_dis(void)
+{
+}
+
+
+/*
+* @brief Puts a device model on the bus. See sim.h.
+*/
+esp_err_t sim_i2c_attach(uint8_t addr, const sim_i2c_dev_t *dev)
+{
+  if(i2c_num_devs == SIM_I2C_MAX_DEVS)
+    return ESP_ERR_NO_MEM;
+
+  i2c_devs[i2c_num_devs].addr = addr;
+  i2c_devs[i2c_num_devs].dev = *dev;
+  i2c_num_devs++;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Takes the bus speed, used for transfer times.
+*/
+esp_err_t i2c_param_config(i2c_port_t i2c_num, const i2c_config_t *i2c_conf)
+{
+  if(i2c_num >= I2C_NUM_MAX || i2c_conf->mode != I2C_MODE_MASTER)
+    return ESP_ERR_INVALID_ARG;
+
+  if(i2c_conf->master.clk_speed > 0)
+    i2c_clk_hz = i2c_conf->master.clk_speed;
+
+  return ESP_OK;
+}
+
+
+esp_err_t i2c_driver_install(i2c_port_t i2c_num, i2c_mode_t mode, size_t slv_rx_buf_len,
+                             size_t slv_tx_buf_len, int intr_alloc_flags)
+{
+  return (i2c_num < I2C_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+esp_err_t i2c_driver_delete(i2c_port_t i2c_num)
+{
+  return ESP_OK;
+}
+
+
+/*
+* @brief Command links record the operations for i2c_master_cmd_begin().
+*/
+i2c_cmd_handle_t i2c_cmd_link_create()
+{
+  return calloc(1, sizeof(struct sim_i2c_cmd));
+}
+
+
+void i2c_cmd_link_delete(i2c_cmd_handle_t cmd_handle)
+{
+  free(cmd_handle);
+}
+
+
+/*
+* @brief Appends an operation to a command link.
+*/
+static esp_err_t add_op(i2c_cmd_handle_t cmd, i2c_op_type_t type, const uint8_t *bytes,
+                        uint8_t *data, size_t len)
+{
+  i2c_op_t *op;
+
+  if(cmd->count == I2C_MAX_OPS || len > I2C_MAX_XFER)
+    return ESP_ERR_NO_MEM;
+
+  op = &cmd->ops[cmd->count++];
+  op->type = type;
+  op->data = data;
+  op->len = len;
+  if(bytes != NULL)
+    memcpy(op->bytes, bytes, len);
+
+  return ESP_OK;
+}
+
+
+esp_err_t i2c_master_start(i2c_cmd_handle_t cmd_handle)
+{
+  return add_op(cmd_handle, I2C_OP_START, NULL, NULL, 0);
+}
+
+
+esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd_handle, uint8_t data, bool ack_en)
+{
+  return add_op(cmd_handle, I2C_OP_WRITE, &data, NULL, 1);
+}
+
+
+esp_err_t i2c_master_write(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, bool ack_en)
+{
+  return add_op(cmd_handle, I2C_OP_WRITE, data, NULL, data_len);
+}
+
+
+esp_err_t i2c_master_read_byte(i2c_cmd_handle_t cmd_handle, uint8_t *data, i2c_ack_type_t ack)
+{
+  return add_op(cmd_handle, I2C_OP_READ, NULL, data, 1);
+}
+
+
+esp_err_t i2c_master_read(i2c_cmd_handle_t cmd_handle, uint8_t *data, size_t data_len, i2c_ack_type_t ack)
+{
+  return add_op(cmd_handle, I2C_OP_READ, NULL, data, data_len);
+}
+
+
+esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd_handle)
+{
+  return add_op(cmd_handle, I2C_OP_STOP, NULL, NULL, 0);
+}
+
+
+/*
+* @brief Runs a command link: each START ... STOP (or repeated START) is one
+*        transaction whose first byte is the address. Takes the bus time
+*        the transfer would take.
+*/
+esp_err_t i2c_master_cmd_begin(i2c_port_t i2c_num, i2c_cmd_handle_t cmd_handle, TickType_t ticks_to_wait)
+{
+  uint8_t wbuf[I2C_MAX_OPS * I2C_MAX_XFER];
+  size_t wlen = 0;
+  size_t bytes = 0;
+  int64_t start;
+  esp_err_t err = ESP_OK;
+  uint8_t first = 0;
+  uint8_t i;
+  uint8_t j;
+
+  start = esp_timer_get_time();
+
+  pthread_mutex_lock(&i2c_lock);
+  i = 0;
+  while(i < cmd_handle->count && err == ESP_OK)
+  {
+    if(cmd_handle->ops[i].type != I2C_OP_START)
+    {
+      i++;
+      continue;
+    }
+
+    // Gather the bytes written up to the end of this transaction.
+    first = i + 1;
+    wlen = 0;
+    for(j = first; j < cmd_handle->count; j++)
+    {
+      if(cmd_handle->ops[j].type == I2C_OP_START || cmd_handle->ops[j].type == I2C_OP_STOP)
+        break;
+      if(cmd_handle->ops[j].type == I2C_OP_WRITE)
+      {
+        memcpy(wbuf + wlen, cmd_handle->ops[j].bytes, cmd_handle->ops[j].len);
+        wlen += cmd_handle->ops[j].len;
+      }
+      bytes += cmd_handle->ops[j].len;
+    }
+
+    if(j == first || cmd_handle->ops[first].type != I2C_OP_WRITE)
+      err = ESP_ERR_INVALID_ARG;
+    else
+      err = i2c_xfer(wbuf[0], wbuf + 1, wlen - 1, &cmd_handle->ops[first], j - first);
+    i = j;
+  }
+  pthread_mutex_unlock(&i2c_lock);
+
+  sim_sleep_until(start + (int64_t) bytes * I2C_BITS_PER_BYTE * 1000000 / i2c_clk_hz);
+
+  return err;
+}
+
+
+/*
+* @brief One transaction against the device model at the address.
+*
+* @param addr_rw - address byte
+* @param wbuf    - bytes written after the address
+* @param wlen    - number of bytes written
+* @param ops     - the transaction's operations, reads are scattered to them
+* @param nops    - number of operations
+*
+* @return ESP_OK, or ESP_FAIL for a NACK
+*/
+static esp_err_t i2c_xfer(uint8_t addr_rw, const uint8_t *wbuf, size_t wlen, i2c_op_t *ops, uint8_t nops)
+{
+  uint8_t rbuf[I2C_MAX_OPS * I2C_MAX_XFER];
+  sim_i2c_dev_t *dev = NULL;
+  uint8_t addr = addr_rw >> 1;
+  size_t rlen = 0;
+  size_t off = 0;
+  esp_err_t err;
+  uint8_t i;
+
+  for(i = 0; i < i2c_num_devs; i++)
+  {
+    if(i2c_devs[i].addr == addr)
+      dev = &i2c_devs[i].dev;
+  }
+  if(dev == NULL)
+    return ESP_FAIL;
+
+  if(dev->now_us != NULL)
+    *dev->now_us = esp_timer_get_time();
+
+  if((addr_rw & 1) == I2C_MASTER_WRITE)
+    return dev->write(dev->ctx, addr, wbuf, wlen);
+
+  for(i = 0; i < nops; i++)
+  {
+    if(ops[i].type == I2C_OP_READ)
+      rlen += ops[i].len;
+  }
+
+  err = dev->read(dev->ctx, addr, rbuf, rlen);
+  if(err != ESP_OK)
+    return err;
+
+  for(i = 0; i < nops; i++)
+  {
+    if(ops[i].type == I2C_OP_READ)
+    {
+      memcpy(ops[i].data, rbuf + off, ops[i].len);
+      off += ops[i].len;
+    }
+  }
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Opens the SD card image. See sim.h.
+*/
+esp_err_t sim_sd_open(const char *path, uint32_t sectors)
+{
+  sd_fd = open(path, O_RDWR | O_CREAT, 0644);
+  if(sd_fd < 0)
+    return ESP_FAIL;
+
+  if(ftruncate(sd_fd, (off_t) sectors * SD_SECTOR_SIZE) != 0)
+  {
+    close(sd_fd);
+    sd_fd = -1;
+    return ESP_FAIL;
+  }
+  sd_sectors = sectors;
+
+  return ESP_OK;
+}
+
+
+esp_err_t sdmmc_host_init()
+{
+  return ESP_OK;
+}
+
+
+esp_err_t sdmmc_host_init_slot(int slot, const sdmmc_slot_config_t *slot_config)
+{
+  return ESP_OK;
+}
+
+
+esp_err_t sdmmc_host_deinit()
+{
+  return ESP_OK;
+}
+
+
+/*
+* @brief "Inserted" only if there is an image.
+*/
+esp_err_t sdmmc_card_init(const sdmmc_host_t *host, sdmmc_card_t *out_card)
+{
+  if(sd_fd < 0)
+    return ESP_ERR_TIMEOUT;
+
+  memset(out_card, 0, sizeof(*out_card));
+  out_card->host = *host;
+  strcpy(out_card->cid.name, "SIM");
+  out_card->csd.capacity = sd_sectors;
+  out_card->csd.sector_size = SD_SECTOR_SIZE;
+
+  return ESP_OK;
+}
+
+
+esp_err_t sdmmc_read_sectors(sdmmc_card_t *card, void *dst, size_t start_sector, size_t sector_count)
+{
+  size_t len = sector_count * SD_SECTOR_SIZE;
+
+  if(start_sector + sector_count > sd_sectors)
+    return ESP_ERR_INVALID_SIZE;
+  if(pread(sd_fd, dst, len, (off_t) start_sector * SD_SECTOR_SIZE) != (ssize_t) len)
+    return ESP_FAIL;
+
+  return ESP_OK;
+}
+
+
+esp_err_t sdmmc_write_sectors(sdmmc_card_t *card, const void *src, size_t start_sector, size_t sector_count)
+{
+  size_t len = sector_count * SD_SECTOR_SIZE;
+
+  if(start_sector + sector_count > sd_sectors)
+    return ESP_ERR_INVALID_SIZE;
+  if(pwrite(sd_fd, src, len, (off_t) start_sector * SD_SECTOR_SIZE) != (ssize_t) len)
+    return ESP_FAIL;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Power management stand-ins. Locks count their holders, and while
+*        light sleep is on a chip with no lock held counts as asleep (see
+*        sim_pm_awake_since()). As in ESP-IDF every lock type keeps the chip
+*        out of light sleep.
+*/
+esp_err_t esp_pm_configure(const void *config)
+{
+  pthread_mutex_lock(&pm_lock);
+  pm_light_sleep = ((const esp_pm_config_esp32_t *) config)->light_sleep_enable;
+  pthread_mutex_unlock(&pm_lock);
+  return ESP_OK;
+}
+
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lock_type, int arg, const char *name,
+                             esp_pm_lock_handle_t *out_handle)
+{
+  struct esp_pm_lock *lock;
+
+  lock = calloc(1, sizeof(*lock));
+  if(lock == NULL)
+    return ESP_ERR_NO_MEM;
+  lock->name = name;
+
+  *out_handle = lock;
+  return ESP_OK;
+}
+
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle)
+{
+  pthread_mutex_lock(&pm_lock);
+  if(handle->count++ == 0 && pm_awake++ == 0)
+    pm_awake_us = esp_timer_get_time();
+  pthread_mutex_unlock(&pm_lock);
+  return ESP_OK;
+}
+
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle)
+{
+  pthread_mutex_lock(&pm_lock);
+  if(handle->count == 0)
+  {
+    pthread_mutex_unlock(&pm_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if(--handle->count == 0)
+    pm_awake--;
+  pthread_mutex_unlock(&pm_lock);
+  return ESP_OK;
+}
+
+
+esp_err_t esp_pm_lock_delete(esp_pm_lock_handle_t handle)
+{
+  free(handle);
+  return ESP_OK;
+}
+
+
+/*
+* @brief When the chip last came out of light sleep. See sim.h.
+*/
+int64_t sim_pm_awake_since()
+{
+  int64_t since = 0;
+
+  pthread_mutex_lock(&pm_lock);
+  if(pm_light_sleep)
+    since = (pm_awake > 0) ? pm_awake_us : -1;
+  pthread_mutex_unlock(&pm_lock);
+
+  return since;
+}
+
+
+/*
+* @brief esp_system stand-ins.
+*/
+uint32_t esp_random()
+{
+  uint32_t r = 0;
+
+  while(getrandom(&r, sizeof(r), 0) != sizeof(r))
+    ;
+
+  return r;
+}
+
+
+void esp_restart()
+{
+  fflush(stdout);
+  exit(0);
+}
+
+
+/*
+* @brief Heap accounting, see the top of the file.
+*/
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static size_t heap_size = SIM_HEAP_SIZE - SIM_BT_RESERVED;
+static size_t heap_used;
+static size_t heap_peak;
+
+
+static void heap_add(void *ptr)
+{
+  size_t used;
+  size_t peak;
+
+  if(ptr == NULL)
+    return;
+
+  used = __atomic_add_fetch(&heap_used, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+  peak = __atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+  while(used > peak && !__atomic_compare_exchange_n(&heap_peak, &peak, used, 1,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+
+static void heap_sub(void *ptr)
+{
+  if(ptr != NULL)
+    __atomic_sub_fetch(&heap_used, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+
+void *__wrap_malloc(size_t size)
+{
+  void *ptr = __real_malloc(size);
+
+  heap_add(ptr);
+  return ptr;
+}
+
+
+void *__wrap_calloc(size_t n, size_t size)
+{
+  void *ptr = __real_calloc(n, size);
+
+  heap_add(ptr);
+  return ptr;
+}
+
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  size_t old = (ptr != NULL) ? malloc_usable_size(ptr) : 0;
+  void *p = __real_realloc(ptr, size);
+
+  if(p == NULL && size > 0)
+    return NULL;
+
+  __atomic_sub_fetch(&heap_used, old, __ATOMIC_RELAXED);
+  heap_add(p);
+  return p;
+}
+
+
+void __wrap_free(void *ptr)
+{
+  heap_sub(ptr);
+  __real_free(ptr);
+}
+
+
+/*
+* @brief Adds memory to the heap. See sim.h.
+*/
+void sim_heap_release(size_t bytes)
+{
+  __atomic_add_fetch(&heap_size, bytes, __ATOMIC_RELAXED);
+}
+
+
+uint32_t esp_get_free_heap_size()
+{
+  size_t size = __atomic_load_n(&heap_size, __ATOMIC_RELAXED);
+  size_t used = __atomic_load_n(&heap_used, __ATOMIC_RELAXED);
+
+  return (used < size) ? size - used : 0;
+}
+
+
+/*
+* @brief Lowest free heap, against the heap as it is now.
+*/
+uint32_t esp_get_minimum_free_heap_size()
+{
+  size_t size = __atomic_load_n(&heap_size, __ATOMIC_RELAXED);
+  size_t peak = __atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+
+  return (peak < size) ? size - peak : 0;
+}
@@ -0,0 +1,142 @@
+/*
+*	sim_sleep.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Deep sleep stand-in. Like the chip, the program starts over on wake up
+*   with only RTC memory kept: esp_deep_sleep_start() writes the
+*   RTC_DATA_ATTR section (see esp_attr.h) and the clock readings to a file
+*   and execs the program again, and sim_sleep_resume() loads them back.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+#define RESUME_ENV    "AIRU_SIM_RESUME"
+#define RTC_MAGIC     0x43545253    // "SRTC"
+
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t size;            // Bytes of RTC memory that follow
+  int64_t elapsed_us;       // Simulated time of all boots and sleeps so far
+  int64_t utc_us;           // Node UTC at wake up
+  int64_t true_utc_us;      // True UTC at wake up
+} rtc_image_t;
+
+extern uint8_t __start_sim_rtc_data[] __attribute__((weak));
+extern uint8_t __stop_sim_rtc_data[] __attribute__((weak));
+
+/* Global variables */
+static char **sleep_argv;
+static const char *sleep_path;
+static int64_t sleep_elapsed_us;
+static uint64_t sleep_wake_us;
+static int sleep_resumed;
+
+
+
+/*
+* @brief Restores RTC memory after a simulated deep sleep. See sim.h.
+*/
+int64_t sim_sleep_resume(char **argv, const char *rtc_path, int64_t *utc_us, int64_t *true_utc_us)
+{
+  size_t size = __stop_sim_rtc_data - __start_sim_rtc_data;
+  rtc_image_t image;
+  FILE *f;
+
+  sleep_argv = argv;
+  sleep_path = rtc_path;
+
+  if(getenv(RESUME_ENV) == NULL)
+    return 0;
+  unsetenv(RESUME_ENV);
+
+  f = fopen(rtc_path, "rb");
+  if(f == NULL)
+    return 0;
+  if(fread(&image, sizeof(image), 1, f) == 1 && image.magic == RTC_MAGIC && image.size == size &&
+     fread(__start_sim_rtc_data, 1, size, f) == size)
+  {
+    sleep_elapsed_us = image.elapsed_us;
+    *utc_us = image.utc_us;
+    *true_utc_us = image.true_utc_us;
+    sleep_resumed = 1;
+  }
+  fclose(f);
+
+  return sleep_elapsed_us;
+}
+
+
+/*
+* @brief Simulated time before this boot. See sim.h.
+*/
+int64_t sim_sleep_elapsed()
+{
+  return sleep_elapsed_us;
+}
+
+
+/*
+* @brief Sets how long the next deep sleep lasts.
+*/
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us)
+{
+  sleep_wake_us = time_in_us;
+  return ESP_OK;
+}
+
+
+/*
+* @brief TIMER after a simulated deep sleep, otherwise a power on.
+*/
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause()
+{
+  return sleep_resumed ? ESP_SLEEP_WAKEUP_TIMER : ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+
+/*
+* @brief Saves RTC memory and restarts the program as the wake up.
+*/
+void esp_deep_sleep_start()
+{
+  size_t size = __stop_sim_rtc_data - __start_sim_rtc_data;
+  rtc_image_t image;
+  int64_t now = esp_timer_get_time();
+  FILE *f;
+
+  image.magic = RTC_MAGIC;
+  image.size = size;
+  image.elapsed_us = sleep_elapsed_us + now + (int64_t) sleep_wake_us;
+  image.utc_us = sim_clock_utc_base() + now + (int64_t) sleep_wake_us;
+  image.true_utc_us = sim_clock_true_utc_base() + now + (int64_t) sleep_wake_us;
+
+  f = fopen(sleep_path, "wb");
+  if(f == NULL || fwrite(&image, sizeof(image), 1, f) != 1 ||
+     fwrite(__start_sim_rtc_data, 1, size, f) != size)
+  {
+    fprintf(stderr, "deep sleep: cannot write %s\n", sleep_path);
+    exit(1);
+  }
+  fclose(f);
+
+  printf("deep sleep for %u ms\n", (unsigned) (sleep_wake_us / 1000));
+  fflush(stdout);
+
+  setenv(RESUME_ENV, "1", 1);
+  execv("/proc/self/exe", sleep_argv);
+  perror("execv");
+  exit(1);
+}
@@ -0,0 +1,564 @@
+/*
+*	sim_uart.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   UART driver stand-in, see driver/uart.h and sim.h.
+*
+*   A feeder thread per port plays the part of the UART interrupt: it waits
+*   until the simulated time the hardware would raise RXFIFO_FULL or
+*   RXFIFO_TOUT, copies that chunk into the driver's ring buffer and posts
+*   the event, exactly as uart_rx_intr_handler_default() does. A chunk that
+*   does not fit in the ring buffer is dropped and posted as
+*   UART_BUFFER_FULL. Bytes that arrive while the chip is in light sleep
+*   (sim_pm_awake_since()) never reach the FIFO.
+*
+*   A device model can take a feeder's place with sim_uart_attach(): it
+*   gets uart_write_bytes() output and sends with sim_uart_send(), which
+*   times the chunks the same way from the model's own thread.
+*/
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "sim.h"
+
+#define UART_DEFAULT_FULL_THRESH  120
+#define UART_DEFAULT_TOUT_THRESH  10
+#define UART_BITS_PER_BYTE        10    // 8N1
+
+
+typedef struct
+{
+  // Driver
+  int installed;
+  uint32_t baud;
+  uint8_t *ring;
+  size_t ring_size;
+  size_t head;
+  size_t count;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  QueueHandle_t events;
+  uint8_t full_thresh;
+  uint8_t tout_thresh;
+
+  // Far end
+  const uint8_t *data;
+  size_t len;
+  uint32_t period_ms;
+  uint32_t burst;
+  int loop;
+  int pty;                  // Master side, -1 if none
+  int pty_slave;
+  pthread_t feeder;
+  void (*model_rx)(void *ctx, const uint8_t *data, size_t len);
+  void *model_ctx;
+
+  sim_uart_stats_t stats;
+} sim_uart_t;
+
+
+/* Function prototypes */
+static void *file_feeder(void *arg);
+static void *pty_feeder(void *arg);
+static void deliver(sim_uart_t *uart, const uint8_t *data, size_t len);
+static int64_t play(sim_uart_t *uart, const uint8_t *data, size_t len, int64_t start_us);
+
+/* Global variables */
+static sim_uart_t uarts[SIM_UART_NUM] =
+{
+  { .pty = -1, .baud = 115200, .lock = PTHREAD_MUTEX_INITIALIZER },
+  { .pty = -1, .baud = 115200, .lock = PTHREAD_MUTEX_INITIALIZER },
+  { .pty = -1, .baud = 115200, .lock = PTHREAD_MUTEX_INITIALIZER }
+};
+
+
+
+/*
+* @brief Queues a capture for a port. See sim.h.
+*/
+esp_err_t sim_uart_feed_file(int port, const uint8_t *data, size_t len,
+                             uint32_t period_ms, uint32_t burst, int loop)
+{
+  if(port < 0 || port >= SIM_UART_NUM || len == 0)
+    return ESP_ERR_INVALID_ARG;
+
+  uarts[port].data = data;
+  uarts[port].len = len;
+  uarts[port].period_ms = period_ms;
+  uarts[port].burst = burst;
+  uarts[port].loop = loop;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Connects a port to a new pty. See sim.h.
+*/
+esp_err_t sim_uart_feed_pty(int port)
+{
+  struct termios tio;
+  sim_uart_t *uart;
+  const char *name;
+
+  if(port < 0 || port >= SIM_UART_NUM)
+    return ESP_ERR_INVALID_ARG;
+  uart = &uarts[port];
+
+  uart->pty = posix_openpt(O_RDWR | O_NOCTTY);
+  if(uart->pty < 0 || grantpt(uart->pty) != 0 || unlockpt(uart->pty) != 0)
+    return ESP_FAIL;
+  name = ptsname(uart->pty);
+
+  // Keep the slave open so the master never sees a hangup, and raw so
+  // binary frames get through untouched.
+  uart->pty_slave = open(name, O_RDWR | O_NOCTTY);
+  if(uart->pty_slave < 0)
+    return ESP_FAIL;
+  tcgetattr(uart->pty_slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(uart->pty_slave, TCSANOW, &tio);
+
+  printf("uart%d: %s\n", port, name);
+  fflush(stdout);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Connects a device model. See sim.h.
+*/
+esp_err_t sim_uart_attach(int port, void (*rx)(void *ctx, const uint8_t *data, size_t len), void *ctx)
+{
+  if(port < 0 || port >= SIM_UART_NUM)
+    return ESP_ERR_INVALID_ARG;
+
+  uarts[port].model_rx = rx;
+  uarts[port].model_ctx = ctx;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Sends bytes from a device model. See sim.h.
+*/
+esp_err_t sim_uart_send(int port, const uint8_t *data, size_t len)
+{
+  if(port < 0 || port >= SIM_UART_NUM)
+    return ESP_ERR_INVALID_ARG;
+  if(!uarts[port].installed)
+    return ESP_ERR_INVALID_STATE;
+
+  play(&uarts[port], data, len, esp_timer_get_time());
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Copies a port's statistics out. See sim.h.
+*/
+void sim_uart_get_stats(int port, sim_uart_stats_t *stats)
+{
+  sim_uart_t *uart = &uarts[port];
+
+  pthread_mutex_lock(&uart->lock);
+  *stats = uart->stats;
+  pthread_mutex_unlock(&uart->lock);
+}
+
+
+/*
+* @brief Remembers the baud rate, used for byte timing.
+*/
+esp_err_t uart_param_config(uart_port_t uart_num, const uart_config_t *uart_config)
+{
+  if(uart_num >= UART_NUM_MAX || uart_config->baud_rate <= 0)
+    return ESP_ERR_INVALID_ARG;
+
+  uarts[uart_num].baud = uart_config->baud_rate;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Pins mean nothing on the host.
+*/
+esp_err_t uart_set_pin(uart_port_t uart_num, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num)
+{
+  return (uart_num < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+
+/*
+* @brief Allocates the ring buffer and event queue and starts the feeder.
+*/
+esp_err_t uart_driver_install(uart_port_t uart_num, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+  pthread_condattr_t attr;
+  sim_uart_t *uart;
+  char name[16];
+  int err = 0;
+
+  if(uart_num >= UART_NUM_MAX || rx_buffer_size <= UART_FIFO_LEN)
+    return ESP_ERR_INVALID_ARG;
+  uart = &uarts[uart_num];
+  if(uart->installed)
+    return ESP_FAIL;
+
+  uart->ring = malloc(rx_buffer_size);
+  if(uart->ring == NULL)
+    return ESP_ERR_NO_MEM;
+  uart->ring_size = rx_buffer_size;
+  uart->head = 0;
+  uart->count = 0;
+  uart->full_thresh = UART_DEFAULT_FULL_THRESH;
+  uart->tout_thresh = UART_DEFAULT_TOUT_THRESH;
+
+  uart->events = NULL;
+  if(queue_size > 0 && uart_queue != NULL)
+  {
+    uart->events = xQueueCreate(queue_size, sizeof(uart_event_t));
+    if(uart->events == NULL)
+      return ESP_ERR_NO_MEM;
+    *uart_queue = uart->events;
+  }
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&uart->cond, &attr);
+  pthread_condattr_destroy(&attr);
+  uart->installed = 1;
+
+  snprintf(name, sizeof(name), "uart%d_isr", uart_num);
+  if(uart->pty >= 0)
+    err = pthread_create(&uart->feeder, NULL, pty_feeder, uart);
+  else if(uart->data != NULL)
+    err = pthread_create(&uart->feeder, NULL, file_feeder, uart);
+  else
+    return ESP_OK;
+  if(err != 0)
+    return ESP_ERR_NO_MEM;
+  pthread_setname_np(uart->feeder, name);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Not supported, the feeder has no way to stop.
+*/
+esp_err_t uart_driver_delete(uart_port_t uart_num)
+{
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+
+/*
+* @brief Takes the RX thresholds, which set the chunk size and idle time.
+*/
+esp_err_t uart_intr_config(uart_port_t uart_num, const uart_intr_config_t *intr_conf)
+{
+  sim_uart_t *uart;
+
+  if(uart_num >= UART_NUM_MAX)
+    return ESP_ERR_INVALID_ARG;
+  uart = &uarts[uart_num];
+
+  pthread_mutex_lock(&uart->lock);
+  if(intr_conf->intr_enable_mask & UART_RXFIFO_FULL_INT_ENA_M)
+    uart->full_thresh = (intr_conf->rxfifo_full_thresh > 0) ? intr_conf->rxfifo_full_thresh : 1;
+  else
+    uart->full_thresh = UART_FIFO_LEN;
+  if(intr_conf->intr_enable_mask & UART_RXFIFO_TOUT_INT_ENA_M)
+    uart->tout_thresh = intr_conf->rx_timeout_thresh;
+  pthread_mutex_unlock(&uart->lock);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Reads up to 'length' bytes, waiting for that many until the
+*        timeout, then returning what there is.
+*/
+int uart_read_bytes(uart_port_t uart_num, uint8_t *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+  struct timespec ts;
+  sim_uart_t *uart;
+  size_t n;
+  size_t first;
+
+  if(uart_num >= UART_NUM_MAX || !uarts[uart_num].installed)
+    return -1;
+  uart = &uarts[uart_num];
+
+  if(ticks_to_wait != 0 && ticks_to_wait != portMAX_DELAY)
+    sim_clock_deadline(esp_timer_get_time() + (int64_t) ticks_to_wait * portTICK_PERIOD_MS * 1000, &ts);
+
+  pthread_mutex_lock(&uart->lock);
+  while(uart->count < length && ticks_to_wait != 0)
+  {
+    if(ticks_to_wait == portMAX_DELAY)
+      pthread_cond_wait(&uart->cond, &uart->lock);
+    else if(pthread_cond_timedwait(&uart->cond, &uart->lock, &ts) != 0)
+      break;
+  }
+
+  n = (uart->count < length) ? uart->count : length;
+  first = uart->ring_size - uart->head;
+  if(first > n)
+    first = n;
+  memcpy(buf, uart->ring + uart->head, first);
+  memcpy(buf + first, uart->ring, n - first);
+  uart->head = (uart->head + n) % uart->ring_size;
+  uart->count -= n;
+  pthread_mutex_unlock(&uart->lock);
+
+  return (int) n;
+}
+
+
+/*
+* @brief Sends bytes to the pty, if there is one.
+*/
+int uart_write_bytes(uart_port_t uart_num, const char *src, size_t size)
+{
+  sim_uart_t *uart;
+
+  if(uart_num >= UART_NUM_MAX || !uarts[uart_num].installed)
+    return -1;
+  uart = &uarts[uart_num];
+
+  if(uart->pty >= 0 && write(uart->pty, src, size) < 0)
+    return -1;
+  if(uart->model_rx != NULL)
+    uart->model_rx(uart->model_ctx, (const uint8_t *) src, size);
+
+  pthread_mutex_lock(&uart->lock);
+  uart->stats.bytes_out += size;
+  pthread_mutex_unlock(&uart->lock);
+
+  return (int) size;
+}
+
+
+/*
+* @brief Bytes in the ring buffer.
+*/
+esp_err_t uart_get_buffered_data_len(uart_port_t uart_num, size_t *size)
+{
+  if(uart_num >= UART_NUM_MAX || !uarts[uart_num].installed)
+    return ESP_FAIL;
+
+  pthread_mutex_lock(&uarts[uart_num].lock);
+  *size = uarts[uart_num].count;
+  pthread_mutex_unlock(&uarts[uart_num].lock);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Empties the ring buffer.
+*/
+esp_err_t uart_flush_input(uart_port_t uart_num)
+{
+  if(uart_num >= UART_NUM_MAX || !uarts[uart_num].installed)
+    return ESP_FAIL;
+
+  pthread_mutex_lock(&uarts[uart_num].lock);
+  uarts[uart_num].head = 0;
+  uarts[uart_num].count = 0;
+  pthread_mutex_unlock(&uarts[uart_num].lock);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief What the RX interrupt does with one chunk.
+*/
+static void deliver(sim_uart_t *uart, const uint8_t *data, size_t len)
+{
+  uart_event_t event;
+  size_t tail;
+  size_t first;
+
+  pthread_mutex_lock(&uart->lock);
+  if(uart->count + len > uart->ring_size)
+  {
+    event.type = UART_BUFFER_FULL;
+    uart->stats.bytes_dropped += len;
+  }
+  else
+  {
+    event.type = UART_DATA;
+    tail = (uart->head + uart->count) % uart->ring_size;
+    first = uart->ring_size - tail;
+    if(first > len)
+      first = len;
+    memcpy(uart->ring + tail, data, first);
+    memcpy(uart->ring, data + first, len - first);
+    uart->count += len;
+    uart->stats.bytes_in += len;
+    pthread_cond_broadcast(&uart->cond);
+  }
+  event.size = len;
+  uart->stats.last_rx_us = esp_timer_get_time();
+  pthread_mutex_unlock(&uart->lock);
+
+  if(uart->events == NULL)
+    return;
+
+  if(xQueueSendFromISR(uart->events, &event, NULL) == pdPASS)
+  {
+    pthread_mutex_lock(&uart->lock);
+    uart->stats.events++;
+    pthread_mutex_unlock(&uart->lock);
+  }
+  else
+  {
+    pthread_mutex_lock(&uart->lock);
+    uart->stats.events_dropped++;
+    pthread_mutex_unlock(&uart->lock);
+  }
+}
+
+
+/*
+* @brief Plays a capture at the line rate. See sim_uart_feed_file().
+*/
+static void *file_feeder(void *arg)
+{
+  sim_uart_t *uart = (sim_uart_t *) arg;
+  int64_t start_us;
+  int64_t done_us;
+  size_t pos = 0;
+  size_t burst;
+
+  start_us = esp_timer_get_time();
+
+  for(;;)
+  {
+    if(pos == uart->len)
+    {
+      if(!uart->loop)
+        break;
+      pos = 0;
+    }
+
+    burst = uart->len - pos;
+    if(uart->burst > 0 && uart->burst < burst)
+      burst = uart->burst;
+
+    done_us = play(uart, uart->data + pos, burst, start_us);
+    pos += burst;
+
+    if(uart->period_ms > 0)
+      start_us += (int64_t) uart->period_ms * 1000;
+    else
+      start_us = done_us;
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Delivers bytes that start arriving at 'start_us' at the line rate,
+*        one interrupt's chunk at a time.
+*
+* @return when the last chunk was delivered
+*/
+static int64_t play(sim_uart_t *uart, const uint8_t *data, size_t len, int64_t start_us)
+{
+  int64_t byte_ns;
+  int64_t done_us = start_us;
+  int64_t awake_us;
+  size_t off;
+  size_t lost;
+  size_t n;
+
+  byte_ns = (int64_t) UART_BITS_PER_BYTE * 1000000000 / uart->baud;
+
+  for(off = 0; off < len; off += n)
+  {
+    n = len - off;
+    if(n > uart->full_thresh)
+      n = uart->full_thresh;
+
+    // RXFIFO_FULL fires on the last byte of a full chunk; a short one
+    // waits for the line to go idle.
+    done_us = start_us + (int64_t) (off + n) * byte_ns / 1000;
+    if(n < uart->full_thresh)
+      done_us += (int64_t) uart->tout_thresh * byte_ns / 1000;
+
+    sim_sleep_until(done_us);
+
+    // Every byte that came in before the chip last woke up is lost, all of
+    // them if it is still asleep.
+    awake_us = sim_pm_awake_since();
+    for(lost = 0; lost < n; lost++)
+    {
+      if(awake_us >= 0 && start_us + (int64_t) (off + lost + 1) * byte_ns / 1000 > awake_us)
+        break;
+    }
+    if(lost > 0)
+    {
+      pthread_mutex_lock(&uart->lock);
+      uart->stats.bytes_asleep += lost;
+      pthread_mutex_unlock(&uart->lock);
+    }
+    if(lost < n)
+      deliver(uart, data + off + lost, n - lost);
+  }
+
+  return done_us;
+}
+
+
+/*
+* @brief Passes whatever arrives on the pty on as soon as it arrives.
+*/
+static void *pty_feeder(void *arg)
+{
+  sim_uart_t *uart = (sim_uart_t *) arg;
+  uint8_t buf[UART_FIFO_LEN];
+  ssize_t n;
+  ssize_t off;
+  ssize_t chunk;
+
+  for(;;)
+  {
+    n = read(uart->pty, buf, uart->full_thresh);
+    if(n <= 0)
+      break;
+
+    for(off = 0; off < n; off += chunk)
+    {
+      chunk = n - off;
+      if(chunk > uart->full_thresh)
+        chunk = uart->full_thresh;
+      deliver(uart, buf + off, chunk);
+    }
+  }
+
+  return NULL;
+}
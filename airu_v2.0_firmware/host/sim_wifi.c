@@ -0,0 +1,597 @@
+/*
+*	sim_wifi.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   WiFi, system event loop, SNTP and HTTP client stand-ins, see sim.h.
+*
+*   The event loop is a task reading a queue of system_event_t, as in
+*   ESP-IDF v3. Connection attempts finish on an esp_timer after the
+*   configured connect time: half of it is the scan, which a connect to the
+*   AP's BSSID and channel skips, and a quarter DHCP, which a static
+*   address skips. Attempts fail while the AP is away or with credentials
+*   it doesn't take, after SIM_SCAN_FAIL_MS, or SIM_DIRECT_FAIL_MS for a
+*   directed one. HTTP
+*   requests block the caller for the round trip time and only succeed
+*   while the station has an IP.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_event_loop.h"
+#include "esp_wifi.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_http_client.h"
+#include "apps/sntp/sntp.h"
+#include "sim.h"
+
+#define EVENT_QUEUE_LEN     32
+#define EVENT_TASK_STACK    2048
+#define EVENT_TASK_PRIO     20
+#define SIM_IP              0x0204a8c0    // 192.168.4.2
+#define SIM_NETMASK         0x00ffffff
+#define SIM_GW              0x0104a8c0
+#define SIM_CHANNEL         6
+#define SIM_SCAN_FAIL_MS    3000
+#define SIM_DIRECT_FAIL_MS  1000
+
+
+struct esp_http_client
+{
+  const char *data;
+  int len;
+  int status;
+};
+
+
+/* Function prototypes */
+static void vEvent_task(void *pvParameters);
+static void post(system_event_id_t id);
+static void connect_done(void *arg);
+static void outage_start(void *arg);
+static int ap_up(int64_t now_us);
+static int ap_takes(const wifi_sta_config_t *sta);
+
+/* Global variables */
+static QueueHandle_t event_queue;
+static system_event_cb_t event_cb;
+static void *event_ctx;
+
+static int32_t wifi_connect_ms = 2000;
+static wifi_mode_t wifi_mode;
+static int wifi_started;
+static volatile int wifi_has_ip;
+static esp_timer_handle_t wifi_timer;
+static wifi_sta_config_t wifi_sta;
+static int wifi_dhcp = 1;
+static tcpip_adapter_ip_info_t wifi_static_ip;
+static const uint8_t wifi_bssid[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 };
+static int64_t wifi_outage_us = -1;
+static int64_t wifi_outage_end_us = -1;
+static esp_timer_handle_t wifi_outage_timer;
+static char wifi_ap_ssid[33];       // "" takes any credentials
+static char wifi_ap_password[64];
+
+static uint32_t http_rtt_ms = 50;
+static uint32_t http_fail_pct;
+static FILE *http_posts;
+static sim_http_stats_t http_stats;
+static pthread_mutex_t http_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*
+* @brief Sets the WiFi and HTTP behaviour. See sim.h.
+*/
+void sim_wifi_config(int32_t connect_ms, uint32_t rtt_ms, uint32_t fail_pct, FILE *posts)
+{
+  wifi_connect_ms = connect_ms;
+  http_rtt_ms = rtt_ms;
+  http_fail_pct = fail_pct;
+  http_posts = posts;
+}
+
+
+/*
+* @brief Schedules an AP outage. See sim.h.
+*/
+void sim_wifi_outage(int64_t start_us, int64_t len_us)
+{
+  const esp_timer_create_args_t args = { .callback = outage_start, .name = "wifi_outage" };
+
+  wifi_outage_us = start_us;
+  wifi_outage_end_us = start_us + len_us;
+  if(esp_timer_create(&args, &wifi_outage_timer) == ESP_OK)
+    esp_timer_start_once(wifi_outage_timer, (start_us > esp_timer_get_time()) ? start_us - esp_timer_get_time() : 1);
+}
+
+
+/*
+* @brief Sets the AP's credentials. See sim.h.
+*/
+void sim_wifi_ap(const char *ssid, const char *password)
+{
+  strncpy(wifi_ap_ssid, ssid, sizeof(wifi_ap_ssid) - 1);
+  strncpy(wifi_ap_password, password, sizeof(wifi_ap_password) - 1);
+}
+
+
+/*
+* @brief Copies the HTTP statistics out. See sim.h.
+*/
+void sim_http_get_stats(sim_http_stats_t *stats)
+{
+  pthread_mutex_lock(&http_lock);
+  *stats = http_stats;
+  pthread_mutex_unlock(&http_lock);
+}
+
+
+/*
+* @brief Nothing to bring up on the host.
+*/
+void tcpip_adapter_init()
+{
+}
+
+
+/*
+* @brief DHCP client on or off, see tcpip_adapter.h. Starting it on a
+*        station connected with a static address renews the address at once.
+*/
+esp_err_t tcpip_adapter_dhcpc_start(tcpip_adapter_if_t tcpip_if)
+{
+  int was = wifi_dhcp;
+
+  wifi_dhcp = 1;
+  if(!was && wifi_has_ip)
+    post(SYSTEM_EVENT_STA_GOT_IP);
+
+  return ESP_OK;
+}
+
+
+esp_err_t tcpip_adapter_dhcpc_stop(tcpip_adapter_if_t tcpip_if)
+{
+  wifi_dhcp = 0;
+  return ESP_OK;
+}
+
+
+esp_err_t tcpip_adapter_set_ip_info(tcpip_adapter_if_t tcpip_if, const tcpip_adapter_ip_info_t *ip_info)
+{
+  wifi_static_ip = *ip_info;
+  return ESP_OK;
+}
+
+
+/*
+* @brief Dotted quad of an address, in a static buffer.
+*/
+char *ip4addr_ntoa(const ip4_addr_t *addr)
+{
+  static char str[16];
+  const uint8_t *b = (const uint8_t *) &addr->addr;
+
+  snprintf(str, sizeof(str), "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+  return str;
+}
+
+
+/*
+* @brief Starts the event loop task. See esp_event_loop.h.
+*/
+esp_err_t esp_event_loop_init(system_event_cb_t cb, void *ctx)
+{
+  if(event_queue != NULL)
+    return ESP_FAIL;
+
+  event_cb = cb;
+  event_ctx = ctx;
+  event_queue = xQueueCreate(EVENT_QUEUE_LEN, sizeof(system_event_t));
+  if(event_queue == NULL)
+    return ESP_ERR_NO_MEM;
+
+  if(xTaskCreate(vEvent_task, "eventTask", EVENT_TASK_STACK, NULL, EVENT_TASK_PRIO, NULL) != pdPASS)
+    return ESP_ERR_NO_MEM;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Queues an event. See esp_event.h.
+*/
+esp_err_t esp_event_send(system_event_t *event)
+{
+  if(event_queue == NULL || xQueueSend(event_queue, event, 0) != pdPASS)
+    return ESP_FAIL;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Passes events to the application's handler one at a time.
+*/
+static void vEvent_task(void *pvParameters)
+{
+  system_event_t event;
+
+  for(;;)
+  {
+    if(xQueueReceive(event_queue, &event, portMAX_DELAY) == pdPASS && event_cb != NULL)
+      event_cb(event_ctx, &event);
+  }
+}
+
+
+/*
+* @brief Posts an event with the info the stand-in knows about.
+*/
+static void post(system_event_id_t id)
+{
+  system_event_t event;
+
+  memset(&event, 0, sizeof(event));
+  event.event_id = id;
+
+  switch(id)
+  {
+    case SYSTEM_EVENT_STA_CONNECTED:
+      memcpy(event.event_info.connected.ssid, "sim", 3);
+      event.event_info.connected.ssid_len = 3;
+      memcpy(event.event_info.connected.bssid, wifi_bssid, sizeof(wifi_bssid));
+      event.event_info.connected.channel = SIM_CHANNEL;
+      break;
+
+    case SYSTEM_EVENT_STA_DISCONNECTED:
+      event.event_info.disconnected.reason = wifi_has_ip ? WIFI_REASON_BEACON_TIMEOUT :
+                                                           WIFI_REASON_NO_AP_FOUND;
+      break;
+
+    case SYSTEM_EVENT_STA_GOT_IP:
+      if(wifi_dhcp)
+      {
+        event.event_info.got_ip.ip_info.ip.addr = SIM_IP;
+        event.event_info.got_ip.ip_info.netmask.addr = SIM_NETMASK;
+        event.event_info.got_ip.ip_info.gw.addr = SIM_GW;
+      }
+      else
+      {
+        event.event_info.got_ip.ip_info = wifi_static_ip;
+      }
+      event.event_info.got_ip.ip_changed = true;
+      break;
+
+    default:
+      break;
+  }
+
+  esp_event_send(&event);
+}
+
+
+/*
+* @brief Sets up the connect timer.
+*/
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+  const esp_timer_create_args_t args = { .callback = connect_done, .name = "wifi" };
+
+  if(wifi_timer != NULL)
+    return ESP_OK;
+
+  return esp_timer_create(&args, &wifi_timer);
+}
+
+
+esp_err_t esp_wifi_deinit()
+{
+  return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+  if(wifi_timer == NULL)
+    return ESP_ERR_WIFI_NOT_INIT;
+
+  wifi_mode = mode;
+  return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode)
+{
+  *mode = wifi_mode;
+  return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_set_config(esp_interface_t interface, wifi_config_t *conf)
+{
+  if(wifi_timer == NULL)
+    return ESP_ERR_WIFI_NOT_INIT;
+
+  if(interface == ESP_IF_WIFI_STA)
+    wifi_sta = conf->sta;
+  return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_get_config(esp_interface_t interface, wifi_config_t *conf)
+{
+  memset(conf, 0, sizeof(*conf));
+  return ESP_OK;
+}
+
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+  return ESP_OK;
+}
+
+
+/*
+* @brief Starts the interfaces for the mode, posting their START events.
+*/
+esp_err_t esp_wifi_start()
+{
+  if(wifi_timer == NULL)
+    return ESP_ERR_WIFI_NOT_INIT;
+  if(wifi_started)
+    return ESP_OK;
+
+  wifi_started = 1;
+  if(wifi_mode == WIFI_MODE_STA || wifi_mode == WIFI_MODE_APSTA)
+    post(SYSTEM_EVENT_STA_START);
+  if(wifi_mode == WIFI_MODE_AP || wifi_mode == WIFI_MODE_APSTA)
+    post(SYSTEM_EVENT_AP_START);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Drops any connection and stops the interfaces.
+*/
+esp_err_t esp_wifi_stop()
+{
+  if(!wifi_started)
+    return ESP_ERR_WIFI_NOT_STARTED;
+
+  esp_timer_stop(wifi_timer);
+  wifi_started = 0;
+  if(wifi_mode == WIFI_MODE_STA || wifi_mode == WIFI_MODE_APSTA)
+  {
+    if(wifi_has_ip)
+      post(SYSTEM_EVENT_STA_DISCONNECTED);
+    wifi_has_ip = 0;
+    post(SYSTEM_EVENT_STA_STOP);
+  }
+  if(wifi_mode == WIFI_MODE_AP || wifi_mode == WIFI_MODE_APSTA)
+    post(SYSTEM_EVENT_AP_STOP);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Starts a connection attempt that finishes after the connect time,
+*        less the scan for a directed connect and DHCP for a static address.
+*/
+esp_err_t esp_wifi_connect()
+{
+  int directed = wifi_sta.bssid_set && wifi_sta.channel == SIM_CHANNEL &&
+                 memcmp(wifi_sta.bssid, wifi_bssid, sizeof(wifi_bssid)) == 0;
+  int32_t ms;
+
+  if(!wifi_started)
+    return ESP_ERR_WIFI_NOT_STARTED;
+  if(wifi_mode == WIFI_MODE_AP)
+    return ESP_ERR_WIFI_CONN;
+
+  if(!ap_up(esp_timer_get_time()) || !ap_takes(&wifi_sta))
+    ms = directed ? SIM_DIRECT_FAIL_MS : SIM_SCAN_FAIL_MS;
+  else
+    ms = wifi_connect_ms - (directed ? wifi_connect_ms / 2 : 0) - (wifi_dhcp ? 0 : wifi_connect_ms / 4);
+
+  esp_timer_stop(wifi_timer);
+  esp_timer_start_once(wifi_timer, (uint64_t) ms * 1000);
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Drops the connection.
+*/
+esp_err_t esp_wifi_disconnect()
+{
+  esp_timer_stop(wifi_timer);
+  if(wifi_has_ip)
+  {
+    wifi_has_ip = 0;
+    post(SYSTEM_EVENT_STA_DISCONNECTED);
+  }
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief End of a connection attempt.
+*/
+static void connect_done(void *arg)
+{
+  if(!wifi_started)
+    return;
+
+  if(!ap_up(esp_timer_get_time()) || !ap_takes(&wifi_sta))
+  {
+    post(SYSTEM_EVENT_STA_DISCONNECTED);
+    return;
+  }
+
+  post(SYSTEM_EVENT_STA_CONNECTED);
+  post(SYSTEM_EVENT_STA_GOT_IP);
+  wifi_has_ip = 1;
+}
+
+
+/*
+* @brief The AP goes: a connected station loses it.
+*/
+static void outage_start(void *arg)
+{
+  if(wifi_started && wifi_has_ip)
+  {
+    post(SYSTEM_EVENT_STA_DISCONNECTED);
+    wifi_has_ip = 0;
+  }
+}
+
+
+/*
+* @brief 1 if there is an AP to connect to at 'now_us'.
+*/
+static int ap_up(int64_t now_us)
+{
+  return wifi_connect_ms >= 0 && (now_us < wifi_outage_us || now_us >= wifi_outage_end_us);
+}
+
+
+/*
+* @brief 1 if the AP takes a station's credentials.
+*/
+static int ap_takes(const wifi_sta_config_t *sta)
+{
+  return wifi_ap_ssid[0] == '\0' ||
+         (strncmp((const char *) sta->ssid, wifi_ap_ssid, sizeof(sta->ssid)) == 0 &&
+          strncmp((const char *) sta->password, wifi_ap_password, sizeof(sta->password)) == 0);
+}
+
+
+/*
+* @brief SNTP stand-ins, see sntp.h.
+*/
+void sntp_setoperatingmode(uint8_t operating_mode)
+{
+}
+
+
+void sntp_setservername(uint8_t idx, const char *server)
+{
+}
+
+
+void sntp_init()
+{
+  sim_sntp_sync();
+}
+
+
+void sntp_stop()
+{
+}
+
+
+/*
+* @brief Creates a client. The URL is not used.
+*/
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+  return calloc(1, sizeof(struct esp_http_client));
+}
+
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+  return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url)
+{
+  return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
+{
+  client->data = data;
+  client->len = len;
+
+  return ESP_OK;
+}
+
+
+/*
+* @brief Takes the round trip time, then succeeds with a 200 if there is an
+*        IP and the request was not picked to fail.
+*/
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+  uint8_t hdr[4];
+  esp_err_t err = ESP_OK;
+
+  sim_sleep_until(esp_timer_get_time() + (int64_t) http_rtt_ms * 1000);
+
+  if(!wifi_has_ip || (http_fail_pct > 0 && esp_random() % 100 < http_fail_pct))
+    err = ESP_ERR_HTTP_CONNECT;
+
+  pthread_mutex_lock(&http_lock);
+  http_stats.requests++;
+  if(err == ESP_OK)
+  {
+    client->status = 200;
+    http_stats.bytes += client->len;
+    if(http_posts != NULL)
+    {
+      hdr[0] = client->len;
+      hdr[1] = client->len >> 8;
+      hdr[2] = client->len >> 16;
+      hdr[3] = client->len >> 24;
+      fwrite(hdr, 1, sizeof(hdr), http_posts);
+      fwrite(client->data, 1, client->len, http_posts);
+    }
+  }
+  else
+  {
+    client->status = 0;
+    http_stats.failures++;
+  }
+  pthread_mutex_unlock(&http_lock);
+
+  return err;
+}
+
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+  return client->status;
+}
+
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+  return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+  free(client);
+  return ESP_OK;
+}
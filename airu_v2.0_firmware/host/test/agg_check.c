@@ -0,0 +1,368 @@
+/*
+*	agg_check.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The streaming window statistics (aggregate.c) against the same figures
+*   worked out from the raw samples. Three checks:
+*
+*   windows    - an hour of samples about one a second, with a gap of two
+*                empty windows and a window with a single sample, into
+*                CHECK_WINDOW_S windows: agg_add() returns a summary at the
+*                first sample past the end of every window that had
+*                samples and at no other, the window's start stays on the
+*                grid of the first sample, and count, mean (rounded), min
+*                and max of every channel are exact.
+*   ewma       - the EWMA against one in double with weight
+*                1/2^AGG_EWMA_SHIFT, seeded with the first value and carried
+*                across windows: every summary within CHECK_EWMA_MAX of it.
+*   percentile - p50, p90 and p99 of CHECK_WINDOWS windows of each of
+*                check_dists against the sorted samples (the value at rank
+*                ceil(n * pct / 100)): exact below 16 and within 1/16 of the
+*                true value above, which is half a bin, the "about 6%" of
+*                aggregate.h. p0 and p100 the same, and every percentile
+*                between the window's min and max.
+*
+*   Prints a JSON line per check and distribution. Fails with exit status
+*   1 if any is off.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "aggregate.h"
+
+#define CHECK_WINDOW_S      60
+#define CHECK_RUN_S         3700
+#define CHECK_WINDOWS       200       // Percentile check windows per distribution
+#define CHECK_EWMA_MAX      1.0       // Q8 truncation, and rounding to a whole value
+#define CHECK_MAX_SAMPLES   CHECK_WINDOW_S
+
+
+/*
+* @brief A value distribution for the percentile check
+*/
+typedef struct
+{
+  const char *name;
+  uint16_t (*value)();
+} check_dist_t;
+
+
+/* Function prototypes */
+static int check_windows();
+static int check_ewma();
+static int check_percentile(const check_dist_t *dist);
+static void sample_values(uint32_t sec, uint16_t *v);
+static uint16_t exact_percentile(const uint16_t *sorted, uint32_t n, uint8_t pct);
+static int cmp_u16(const void *a, const void *b);
+static uint16_t dist_small();
+static uint16_t dist_uniform();
+static uint16_t dist_skewed();
+static uint16_t dist_bimodal();
+static uint16_t dist_full();
+static uint32_t rnd();
+
+/* Global variables */
+static const check_dist_t check_dists[] =
+{
+  { "small",   dist_small },      // Clean air: all in the exact bins
+  { "uniform", dist_uniform },
+  { "skewed",  dist_skewed },     // Mostly low with rare smoke spikes
+  { "bimodal", dist_bimodal },
+  { "full",    dist_full }        // The whole 16 bit range
+};
+static uint32_t check_seed = 1;
+
+
+
+int main(int argc, char **argv)
+{
+  int failed = 0;
+  size_t i;
+
+  failed |= check_windows();
+  failed |= check_ewma();
+  for(i = 0; i < sizeof(check_dists) / sizeof(check_dists[0]); i++)
+    failed |= check_percentile(&check_dists[i]);
+
+  return failed;
+}
+
+
+/*
+* @brief Window boundaries, counts, mean, min and max.
+*/
+static int check_windows()
+{
+  const int64_t t0_us = 123456789;
+  const int64_t period_us = (int64_t) CHECK_WINDOW_S * 1000000;
+  static uint16_t values[CHECK_MAX_SAMPLES][AGG_MAX_CHANNELS];
+  agg_window_t w;
+  agg_summary_t s;
+  int64_t t;
+  int64_t start_us = t0_us;
+  uint64_t sum;
+  uint32_t summaries = 0;
+  uint32_t want = 0;
+  uint32_t n = 0;
+  uint32_t bad = 0;
+  uint32_t sec;
+  uint32_t k;
+  uint16_t v[AGG_MAX_CHANNELS];
+  uint16_t min;
+  uint16_t max;
+  uint8_t c;
+  int closed;
+  int ok;
+
+  agg_init(&w, CHECK_WINDOW_S, AGG_MAX_CHANNELS);
+
+  for(sec = 0; sec < CHECK_RUN_S; sec++)
+  {
+    // Nothing for 150 s, and later one sample in 100 s.
+    if((sec >= 1000 && sec < 1150) || (sec > 2000 && sec < 2100 && sec != 2050))
+      continue;
+
+    // Up to 6 ms late, never past the next second.
+    t = t0_us + (int64_t) sec * 1000000 + (sec % 7) * 1000;
+    sample_values(sec, v);
+
+    closed = agg_add(&w, t, v, &s);
+    if(t - start_us >= period_us)
+    {
+      if(n > 0)
+      {
+        want++;
+        if(!closed || s.start_us != start_us || s.count != n || s.period_s != CHECK_WINDOW_S ||
+           s.num_channels != AGG_MAX_CHANNELS)
+          bad++;
+
+        for(c = 0; closed && c < AGG_MAX_CHANNELS; c++)
+        {
+          sum = 0;
+          min = UINT16_MAX;
+          max = 0;
+          for(k = 0; k < n; k++)
+          {
+            sum += values[k][c];
+            if(values[k][c] < min)
+              min = values[k][c];
+            if(values[k][c] > max)
+              max = values[k][c];
+          }
+          if(s.ch[c].mean != (sum + n / 2) / n || s.ch[c].min != min || s.ch[c].max != max)
+            bad++;
+        }
+      }
+      else if(closed)
+      {
+        bad++;
+      }
+      summaries += closed;
+
+      start_us += (t - start_us) / period_us * period_us;
+      n = 0;
+    }
+    else if(closed)
+    {
+      bad++;
+      summaries++;
+    }
+
+    if(n < CHECK_MAX_SAMPLES)
+      memcpy(values[n], v, sizeof(v));
+    n++;
+  }
+
+  ok = bad == 0 && summaries == want && want > 0;
+  printf("{\"test\":\"agg_check\",\"check\":\"windows\",\"summaries\":%u,\"expected\":%u,\"bad\":%u,\"ok\":%d}\n",
+         summaries, want, bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief EWMA across windows against the exact one.
+*/
+static int check_ewma()
+{
+  agg_window_t w;
+  agg_summary_t s;
+  double ref[AGG_MAX_CHANNELS];
+  double err;
+  double max_err = 0;
+  uint32_t summaries = 0;
+  uint32_t sec;
+  uint16_t v[AGG_MAX_CHANNELS];
+  uint8_t c;
+  int ok;
+
+  agg_init(&w, CHECK_WINDOW_S, AGG_MAX_CHANNELS);
+
+  for(sec = 0; sec < CHECK_RUN_S; sec++)
+  {
+    sample_values(sec, v);
+
+    // The summary is of the window before this sample, so is the EWMA.
+    if(agg_add(&w, (int64_t) sec * 1000000, v, &s))
+    {
+      summaries++;
+      for(c = 0; c < AGG_MAX_CHANNELS; c++)
+      {
+        err = fabs(s.ch[c].ewma - ref[c]);
+        if(err > max_err)
+          max_err = err;
+      }
+    }
+
+    for(c = 0; c < AGG_MAX_CHANNELS; c++)
+    {
+      if(sec == 0)
+        ref[c] = v[c];
+      else
+        ref[c] += (v[c] - ref[c]) / (1 << AGG_EWMA_SHIFT);
+    }
+  }
+
+  ok = summaries > 0 && max_err <= CHECK_EWMA_MAX;
+  printf("{\"test\":\"agg_check\",\"check\":\"ewma\",\"summaries\":%u,\"max_err\":%.3f,\"ok\":%d}\n",
+         summaries, max_err, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Histogram percentiles against the exact ones.
+*/
+static int check_percentile(const check_dist_t *dist)
+{
+  static const uint8_t pcts[] = { 50, 90, 99, 0, 100 };   // Errors printed for the first three
+  const uint32_t n = CHECK_MAX_SAMPLES;
+  static uint16_t values[CHECK_MAX_SAMPLES];
+  agg_window_t w;
+  agg_summary_t s;
+  uint16_t got;
+  uint16_t want;
+  double err;
+  double max_err[5] = { 0 };
+  uint32_t bad = 0;
+  uint32_t k;
+  uint32_t i;
+  int ok;
+
+  for(k = 0; k < CHECK_WINDOWS; k++)
+  {
+    agg_init(&w, CHECK_WINDOW_S, 1);
+    for(i = 0; i < n; i++)
+    {
+      values[i] = dist->value();
+      agg_add(&w, (int64_t) i * 1000000, &values[i], &s);
+    }
+    qsort(values, n, sizeof(values[0]), cmp_u16);
+
+    for(i = 0; i < sizeof(pcts); i++)
+    {
+      got = agg_percentile(&w, 0, pcts[i]);
+      want = exact_percentile(values, n, pcts[i]);
+      err = (want > 0) ? fabs((double) got - want) / want : got;
+      if(err > max_err[i])
+        max_err[i] = err;
+      if((want < 16 && got != want) || fabs((double) got - want) > want / 16.0 ||
+         got < values[0] || got > values[n - 1])
+        bad++;
+    }
+  }
+
+  ok = bad == 0;
+  printf("{\"test\":\"agg_check\",\"check\":\"percentile\",\"dist\":\"%s\",\"windows\":%u,"
+         "\"p50_max_err_pct\":%.2f,\"p90_max_err_pct\":%.2f,\"p99_max_err_pct\":%.2f,\"bad\":%u,\"ok\":%d}\n",
+         dist->name, CHECK_WINDOWS, max_err[0] * 100, max_err[1] * 100, max_err[2] * 100, bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Values of the three channels at a second: low and sawtooth, a
+*        wider swing, and high up in the range.
+*/
+static void sample_values(uint32_t sec, uint16_t *v)
+{
+  v[0] = (uint16_t) (sec % 50);
+  v[1] = (uint16_t) (1000 + (sec * 37) % 3000);
+  v[2] = (uint16_t) (65535 - (sec * 11) % 40000);
+}
+
+
+/*
+* @brief The value at a percentile of sorted samples, by the rank
+*        agg_percentile() uses.
+*/
+static uint16_t exact_percentile(const uint16_t *sorted, uint32_t n, uint8_t pct)
+{
+  uint32_t rank = (n * pct + 99) / 100;
+
+  return sorted[(rank > 0) ? rank - 1 : 0];
+}
+
+
+static int cmp_u16(const void *a, const void *b)
+{
+  return (int) *(const uint16_t *) a - (int) *(const uint16_t *) b;
+}
+
+
+static uint16_t dist_small()
+{
+  return rnd() % 16;
+}
+
+
+static uint16_t dist_uniform()
+{
+  return rnd() % 1000;
+}
+
+
+/*
+* @brief 1 in 20 a spike up to 50 times the usual 5-35.
+*/
+static uint16_t dist_skewed()
+{
+  uint16_t v = 5 + rnd() % 31;
+
+  return (rnd() % 20 == 0) ? v * (1 + rnd() % 50) : v;
+}
+
+
+static uint16_t dist_bimodal()
+{
+  return (rnd() % 2) ? 10 + rnd() % 10 : 400 + rnd() % 100;
+}
+
+
+static uint16_t dist_full()
+{
+  return rnd() & 0xFFFF;
+}
+
+
+/*
+* @brief xorshift32
+*/
+static uint32_t rnd()
+{
+  check_seed ^= check_seed << 13;
+  check_seed ^= check_seed >> 17;
+  check_seed ^= check_seed << 5;
+
+  return check_seed;
+}
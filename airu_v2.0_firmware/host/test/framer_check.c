@@ -0,0 +1,488 @@
+/*
+*	framer_check.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   pm_frame.h's framer against streams built byte by byte, each with the
+*   exact frames, checksum_errs, bytes_skipped and trailing stash it must
+*   give (see cases below): clean frames, leading garbage, a bad checksum,
+*   a bad length field, a dropped byte, lone and false headers, a header
+*   inside a corrupted frame, header bytes inside a good frame's payload,
+*   a run of 'B's and a frame cut off at the end.
+*
+*   Every stream is fed whole, in chunks of every size from 1 byte up, and
+*   in CHECK_SPLITS random chunkings, so both the in-place path and the
+*   stitched path are covered. Every feeding has to give the same frames
+*   and counts, and fed whole every frame has to come back in place (no
+*   copy).
+*
+*   Captures given on the command line have no expected counts; their
+*   whole-buffer result is what every chunking must match.
+*
+*   Any difference fails the run with exit status 1.
+*
+*   Usage: framer_check [CAPTURE...]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pm_frame.h"
+
+#define CHECK_MAX_LEN     1024
+#define CHECK_MAX_FRAMES  32
+#define CHECK_SPLITS      1000
+
+
+/*
+* @brief A stream and what the framer has to make of it
+*/
+typedef struct
+{
+  const char *name;
+  uint8_t *data;
+  size_t len;
+  uint8_t frames[CHECK_MAX_FRAMES][PM_FRAME_LEN];   // Expected, in order
+  uint32_t num_frames;
+  uint32_t checksum_errs;
+  uint32_t bytes_skipped;
+  uint16_t fill;            // Left in the stash at the end
+} check_case_t;
+
+/*
+* @brief What one feeding gave
+*/
+typedef struct
+{
+  uint8_t frames[CHECK_MAX_FRAMES][PM_FRAME_LEN];
+  uint32_t num_frames;
+  uint32_t copies;          // Frames handed out of the stash
+  pm_frame_stats_t stats;
+  uint16_t fill;
+} check_result_t;
+
+
+/* Function prototypes */
+static uint32_t rnd();
+static void seal(uint8_t *frame);
+static void put_frame(uint8_t *out, uint32_t seq);
+static void add(check_case_t *c, const void *bytes, size_t len);
+static void add_frame(check_case_t *c, const uint8_t *frame);
+static void make_case(check_case_t *c, const char *name);
+static void feed(const uint8_t *data, size_t len, const size_t *chunks, size_t num_chunks,
+                 check_result_t *res);
+static int same(const check_result_t *a, const check_result_t *b);
+static int run(check_case_t *c, int exact);
+static int run_capture(const char *path);
+
+/* Global variables */
+static const char *check_cases[] =
+{
+  "clean", "garbage_lead", "bad_checksum", "bad_length", "dropped_byte", "lone_b",
+  "false_header", "inner_header", "payload_bm", "b_run", "trailing"
+};
+static uint32_t check_seed = 1;
+static size_t check_chunks[CHECK_MAX_LEN * 4];
+
+
+
+int main(int argc, char **argv)
+{
+  static uint8_t data[CHECK_MAX_LEN];
+  static check_case_t c;
+  int failed = 0;
+  size_t i;
+
+  for(i = 0; i < sizeof(check_cases) / sizeof(check_cases[0]); i++)
+  {
+    memset(&c, 0, sizeof(c));
+    c.data = data;
+    make_case(&c, check_cases[i]);
+    failed |= run(&c, 1);
+  }
+
+  for(i = 1; i < (size_t) argc; i++)
+    failed |= run_capture(argv[i]);
+
+  return failed;
+}
+
+
+/*
+* @brief xorshift32
+*/
+static uint32_t rnd()
+{
+  check_seed ^= check_seed << 13;
+  check_seed ^= check_seed >> 17;
+  check_seed ^= check_seed << 5;
+  return check_seed;
+}
+
+
+/*
+* @brief Sets a frame's checksum.
+*/
+static void seal(uint8_t *frame)
+{
+  uint16_t sum = 0;
+  size_t i;
+
+  for(i = 0; i < PM_FRAME_LEN - 2; i++)
+    sum += frame[i];
+  frame[PM_FRAME_LEN - 2] = sum >> 8;
+  frame[PM_FRAME_LEN - 1] = sum & 0xFF;
+}
+
+
+/*
+* @brief Writes a valid frame with no 'B' past its header, so resyncs in
+*        the cases skip exactly the bytes worked out for them.
+*/
+static void put_frame(uint8_t *out, uint32_t seq)
+{
+  uint8_t v = 10 + seq % 20;
+  size_t i;
+
+  do
+  {
+    memset(out, 0, PM_FRAME_LEN);
+    out[0] = PM_FRAME_START1;
+    out[1] = PM_FRAME_START2;
+    out[3] = PM_FRAME_LEN - 4;
+    for(i = 4; i < PM_FRAME_LEN - 2; i += 2)
+      out[i + 1] = v + i;
+    seal(out);
+    v++;
+  } while(memchr(out + 1, PM_FRAME_START1, PM_FRAME_LEN - 1) != NULL);
+}
+
+
+/*
+* @brief Appends bytes to a case's stream.
+*/
+static void add(check_case_t *c, const void *bytes, size_t len)
+{
+  memcpy(c->data + c->len, bytes, len);
+  c->len += len;
+}
+
+
+/*
+* @brief Appends a frame the framer has to hand out.
+*/
+static void add_frame(check_case_t *c, const uint8_t *frame)
+{
+  add(c, frame, PM_FRAME_LEN);
+  memcpy(c->frames[c->num_frames++], frame, PM_FRAME_LEN);
+}
+
+
+/*
+* @brief Builds a case's stream and its expected counts.
+*/
+static void make_case(check_case_t *c, const char *name)
+{
+  uint8_t f[PM_FRAME_LEN];
+  uint8_t junk[32];
+  uint32_t i;
+
+  c->name = name;
+  memset(junk, 0x11, sizeof(junk));
+
+  if(strcmp(name, "clean") == 0)
+  {
+    for(i = 0; i < 8; i++)
+    {
+      put_frame(f, i);
+      add_frame(c, f);
+    }
+  }
+  else if(strcmp(name, "garbage_lead") == 0)
+  {
+    // Skipped by the header hunt, no header in it.
+    add(c, junk, 13);
+    c->bytes_skipped = 13;
+    for(i = 0; i < 4; i++)
+    {
+      put_frame(f, i);
+      add_frame(c, f);
+    }
+  }
+  else if(strcmp(name, "bad_checksum") == 0 || strcmp(name, "bad_length") == 0)
+  {
+    // One bad frame with a good header: one error, and the resync skips
+    // the whole of it to the next header.
+    for(i = 0; i < 4; i++)
+    {
+      put_frame(f, i);
+      if(i == 1 && strcmp(name, "bad_checksum") == 0)
+        f[PM_FRAME_LEN - 1] ^= 1;
+      else if(i == 1)
+        f[3] = PM_FRAME_LEN - 8;
+      if(i == 1)
+        add(c, f, PM_FRAME_LEN);
+      else
+        add_frame(c, f);
+    }
+    c->checksum_errs = 1;
+    c->bytes_skipped = PM_FRAME_LEN;
+  }
+  else if(strcmp(name, "dropped_byte") == 0)
+  {
+    // The short frame runs into the next header: one error and its 23
+    // bytes skipped.
+    for(i = 0; i < 4; i++)
+    {
+      put_frame(f, i);
+      if(i == 1)
+      {
+        add(c, f, 10);
+        add(c, f + 11, PM_FRAME_LEN - 11);
+      }
+      else
+        add_frame(c, f);
+    }
+    c->checksum_errs = 1;
+    c->bytes_skipped = PM_FRAME_LEN - 1;
+  }
+  else if(strcmp(name, "lone_b") == 0)
+  {
+    // A 'B' with no 'M' after it is not a bad frame, just skipped.
+    put_frame(f, 0);
+    add_frame(c, f);
+    add(c, "B\x11", 2);
+    put_frame(f, 1);
+    add_frame(c, f);
+    c->bytes_skipped = 2;
+  }
+  else if(strcmp(name, "false_header") == 0)
+  {
+    // "BM" in line noise counts as a bad frame.
+    put_frame(f, 0);
+    add_frame(c, f);
+    add(c, "BM", 2);
+    add(c, junk, 5);
+    put_frame(f, 1);
+    add_frame(c, f);
+    c->checksum_errs = 1;
+    c->bytes_skipped = 7;
+  }
+  else if(strcmp(name, "inner_header") == 0)
+  {
+    // A bad frame with "BM" in its payload: the resync stops there and
+    // finds a second bad frame, but still skips exactly the bad one.
+    put_frame(f, 0);
+    add_frame(c, f);
+    put_frame(f, 1);
+    f[6] = PM_FRAME_START1;
+    f[7] = PM_FRAME_START2;
+    add(c, f, PM_FRAME_LEN);
+    put_frame(f, 2);
+    add_frame(c, f);
+    c->checksum_errs = 2;
+    c->bytes_skipped = PM_FRAME_LEN;
+  }
+  else if(strcmp(name, "payload_bm") == 0)
+  {
+    // Header bytes inside a good frame are never looked at.
+    put_frame(f, 0);
+    f[6] = PM_FRAME_START1;
+    f[7] = PM_FRAME_START2;
+    seal(f);
+    add_frame(c, f);
+    put_frame(f, 1);
+    add_frame(c, f);
+  }
+  else if(strcmp(name, "b_run") == 0)
+  {
+    // Every 'B' starts a window that fails, none with an 'M'.
+    memset(junk, PM_FRAME_START1, sizeof(junk));
+    add(c, junk, 30);
+    put_frame(f, 0);
+    add_frame(c, f);
+    c->bytes_skipped = 30;
+  }
+  else if(strcmp(name, "trailing") == 0)
+  {
+    // The start of a frame is kept for the next read, not skipped.
+    for(i = 0; i < 4; i++)
+    {
+      put_frame(f, i);
+      if(i < 3)
+        add_frame(c, f);
+      else
+        add(c, f, 10);
+    }
+    c->fill = 10;
+  }
+}
+
+
+/*
+* @brief Feeds a stream to a fresh framer in the given chunks, as
+*        read_frames() does with each uart_read_bytes().
+*/
+static void feed(const uint8_t *data, size_t len, const size_t *chunks, size_t num_chunks,
+                 check_result_t *res)
+{
+  pm_framer_t framer;
+  const uint8_t *frame;
+  const uint8_t *buf;
+  size_t left;
+  size_t off = 0;
+  size_t i;
+
+  memset(res, 0, sizeof(*res));
+  pm_framer_init(&framer);
+
+  for(i = 0; i < num_chunks && off < len; i++)
+  {
+    buf = data + off;
+    left = (chunks[i] < len - off) ? chunks[i] : len - off;
+    off += left;
+    while((frame = pm_framer_next(&framer, &buf, &left)) != NULL)
+    {
+      if(frame < data || frame >= data + len)
+        res->copies++;
+      if(res->num_frames < CHECK_MAX_FRAMES)
+        memcpy(res->frames[res->num_frames], frame, PM_FRAME_LEN);
+      res->num_frames++;
+    }
+  }
+
+  res->stats = framer.stats;
+  res->fill = framer.fill;
+}
+
+
+/*
+* @brief 1 if two feedings gave the same frames and counts.
+*/
+static int same(const check_result_t *a, const check_result_t *b)
+{
+  uint32_t n = (a->num_frames < CHECK_MAX_FRAMES) ? a->num_frames : CHECK_MAX_FRAMES;
+
+  return a->num_frames == b->num_frames && a->fill == b->fill &&
+         a->stats.frames == b->stats.frames && a->stats.checksum_errs == b->stats.checksum_errs &&
+         a->stats.bytes_skipped == b->stats.bytes_skipped &&
+         memcmp(a->frames, b->frames, (size_t) n * PM_FRAME_LEN) == 0;
+}
+
+
+/*
+* @brief Runs one stream through every chunking and prints its counts.
+*
+* @param c     - the stream, and with 'exact' what it has to give
+* @param exact - 0 for a capture: the whole-buffer result is the reference
+*
+* @return 0 if every feeding gave the reference result, 1 if not
+*/
+static int run(check_case_t *c, int exact)
+{
+  static check_result_t want;
+  static check_result_t got;
+  size_t feedings = 0;
+  size_t mismatches = 0;
+  size_t size;
+  size_t n;
+  size_t off;
+  uint32_t split;
+  int ok;
+
+  // Whole, in place.
+  check_chunks[0] = c->len;
+  feed(c->data, c->len, check_chunks, 1, &got);
+  feedings++;
+  if(exact)
+  {
+    memset(&want, 0, sizeof(want));
+    memcpy(want.frames, c->frames, sizeof(c->frames));
+    want.num_frames = c->num_frames;
+    want.stats.frames = c->num_frames;
+    want.stats.checksum_errs = c->checksum_errs;
+    want.stats.bytes_skipped = c->bytes_skipped;
+    want.fill = c->fill;
+    if(!same(&got, &want))
+      mismatches++;
+  }
+  else
+  {
+    want = got;
+  }
+  if(got.copies != 0)
+    mismatches++;
+
+  // Every chunk size, up to the length or a few frames for a capture.
+  for(size = 1; size < c->len && size <= CHECK_MAX_LEN; size++, feedings++)
+  {
+    for(n = 0; n < sizeof(check_chunks) / sizeof(check_chunks[0]); n++)
+      check_chunks[n] = size;
+    feed(c->data, c->len, check_chunks, (c->len + size - 1) / size, &got);
+    mismatches += !same(&got, &want);
+  }
+
+  // Random chunkings, mostly short reads.
+  for(split = 0; split < CHECK_SPLITS; split++, feedings++)
+  {
+    for(n = 0, off = 0; off < c->len && n < sizeof(check_chunks) / sizeof(check_chunks[0]); n++)
+    {
+      check_chunks[n] = 1 + rnd() % ((rnd() & 1) ? PM_FRAME_LEN : 4 * PM_FRAME_LEN);
+      off += check_chunks[n];
+    }
+    if(off < c->len)
+      continue;
+    feed(c->data, c->len, check_chunks, n, &got);
+    mismatches += !same(&got, &want);
+  }
+
+  ok = mismatches == 0;
+  printf("{\"test\":\"framer_check\",\"stream\":\"%s\",\"bytes\":%zu,\"frames\":%u,\"checksum_errs\":%u,"
+         "\"bytes_skipped\":%u,\"stash\":%u,\"feedings\":%zu,\"mismatches\":%zu,\"ok\":%d}\n",
+         c->name, c->len, want.stats.frames, want.stats.checksum_errs, want.stats.bytes_skipped,
+         want.fill, feedings, mismatches, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Checks a recorded capture: every chunking against the whole
+*        buffer.
+*
+* @return 0 if every feeding matched, 1 if not or the file can't be read
+*/
+static int run_capture(const char *path)
+{
+  static check_case_t c;
+  long size;
+  FILE *f;
+  int failed = 1;
+
+  memset(&c, 0, sizeof(c));
+  c.name = path;
+
+  f = fopen(path, "rb");
+  if(f == NULL)
+  {
+    fprintf(stderr, "cannot read %s\n", path);
+    return 1;
+  }
+  if(fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0)
+  {
+    c.data = malloc(size);
+    if(c.data != NULL && fread(c.data, 1, size, f) == (size_t) size)
+    {
+      c.len = size;
+      failed = run(&c, 0);
+    }
+    free(c.data);
+  }
+  fclose(f);
+
+  return failed;
+}
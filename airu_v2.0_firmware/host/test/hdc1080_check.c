@@ -0,0 +1,261 @@
+/*
+*	hdc1080_check.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The HDC1080 driver (hdc1080.c) against the register model of
+*   hdc1080_sim.c, built without ESP_PLATFORM. Four checks:
+*
+*   decode  - hdc1080_temp() and hdc1080_hum() on known register values:
+*             the ends of the range and the datasheet's halfway points
+*             exactly, and every 257th code against the datasheet formulas
+*             to within one LSB of the result.
+*   init    - the IDs are read and combined 14 bit mode is written.
+*   retry   - reads while the model is converting are NACKed: the driver
+*             asks to be polled again after HDC1080_RETRY_MS, counts the
+*             NACKs, gives up after HDC1080_MAX_RETRIES, and takes the
+*             result of a conversion it retried into once it is done.
+*   sched   - the driver under the sensor scheduler for CHECK_RUN_S with
+*             the model's registers changing every reading: two polls per
+*             reading, no NACKs, each sample the values of its own
+*             conversion and timed in its middle.
+*
+*   Prints a JSON line per check. Fails with exit status 1 if any is off.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hdc1080.h"
+
+#define CHECK_RUN_S     60
+#define CHECK_T0_US     1000000   // The driver takes time 0 as no conversion
+
+
+/* Function prototypes */
+static int check_decode();
+static int check_init();
+static int check_retry();
+static int check_sched();
+static void sink(const sensor_sample_t *sample, void *arg);
+
+/* Global variables */
+static hdc1080_sim_t check_sim;
+static uint32_t check_samples;
+static uint32_t check_bad;        // Samples with the wrong values or time
+static int64_t check_started_us;  // Start of the conversion in progress
+
+
+
+int main(int argc, char **argv)
+{
+  int failed = 0;
+
+  failed |= check_decode();
+  failed |= check_init();
+  failed |= check_retry();
+  failed |= check_sched();
+
+  return failed;
+}
+
+
+/*
+* @brief Register values to 0.01 C and 0.01 %RH.
+*/
+static int check_decode()
+{
+  static const struct
+  {
+    uint16_t raw;
+    int16_t temp;
+    uint16_t hum;
+  } known[] =
+  {
+    { 0x0000, -4000, 0 },
+    { 0x4000, 125, 2500 },     // 165 / 4 - 40 C
+    { 0x8000, 4250, 5000 },
+    { 0xFFFF, 12499, 9999 }    // Just under 125 C and 100 %
+  };
+  double want;
+  uint32_t bad = 0;
+  uint32_t raw;
+  size_t i;
+  int ok;
+
+  for(i = 0; i < sizeof(known) / sizeof(known[0]); i++)
+  {
+    if(hdc1080_temp(known[i].raw) != known[i].temp || hdc1080_hum(known[i].raw) != known[i].hum)
+      bad++;
+  }
+
+  for(raw = 0; raw <= 0xFFFF; raw += 257)
+  {
+    want = raw / 65536.0 * 16500 - 4000;
+    if(hdc1080_temp(raw) > want || hdc1080_temp(raw) < want - 1)
+      bad++;
+    want = raw / 65536.0 * 10000;
+    if(hdc1080_hum(raw) > want || hdc1080_hum(raw) < want - 1)
+      bad++;
+  }
+
+  ok = bad == 0;
+  printf("{\"test\":\"hdc1080_check\",\"check\":\"decode\",\"bad\":%u,\"ok\":%d}\n", bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief IDs and configuration.
+*/
+static int check_init()
+{
+  hdc1080_bus_t bus;
+  hdc1080_t dev;
+  esp_err_t err;
+  int ok;
+
+  hdc1080_sim_init(&check_sim, &bus);
+  check_sim.config = 0;
+  err = hdc1080_init(&dev, &bus);
+
+  ok = err == ESP_OK && check_sim.config == HDC1080_CFG_MODE && check_sim.reads == 2;
+  printf("{\"test\":\"hdc1080_check\",\"check\":\"init\",\"err\":%d,\"config\":%u,\"reads\":%u,\"ok\":%d}\n",
+         err, check_sim.config, check_sim.reads, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Polls the driver before the model is done converting.
+*/
+static int check_retry()
+{
+  sensor_driver_t driver;
+  sensor_sample_t sample;
+  hdc1080_reading_t reading;
+  hdc1080_bus_t bus;
+  hdc1080_t dev;
+  int64_t t = CHECK_T0_US;
+  uint32_t delay[5];
+  esp_err_t err[HDC1080_MAX_RETRIES];
+  int got;
+  int i;
+  int ok;
+
+  hdc1080_sim_init(&check_sim, &bus);
+  hdc1080_init(&dev, &bus);
+  hdc1080_driver(&dev, &driver, HDC1080_PERIOD_MS);
+  check_sim.temp_raw = 0x6666;
+  check_sim.hum_raw = 0x8000;
+
+  // Collected too early every time: NACKed until the driver gives up.
+  check_sim.now_us = t;
+  hdc1080_start(&dev, t);
+  for(i = 0; i < HDC1080_MAX_RETRIES; i++)
+  {
+    check_sim.now_us = t + (i + 1) * HDC1080_RETRY_MS * 1000;
+    err[i] = hdc1080_collect(&dev, check_sim.now_us, &reading);
+  }
+  ok = err[0] == ESP_ERR_TIMEOUT && err[HDC1080_MAX_RETRIES - 2] == ESP_ERR_TIMEOUT &&
+       err[HDC1080_MAX_RETRIES - 1] == ESP_FAIL && dev.stats.nacks == HDC1080_MAX_RETRIES &&
+       dev.stats.errors == 1 && dev.started_us == 0;
+
+  // Through the driver, polled back 5 ms early: two NACKs, then the result.
+  t += 1000000;
+  check_sim.now_us = t;
+  delay[0] = driver.poll(driver.ctx, t, 0);
+  check_sim.now_us = t + (HDC1080_CONV_MS - 5) * 1000;
+  delay[1] = driver.poll(driver.ctx, check_sim.now_us, 0);
+  check_sim.now_us += delay[1] * 1000;
+  delay[2] = driver.poll(driver.ctx, check_sim.now_us, 0);
+  check_sim.now_us += delay[2] * 1000;
+  delay[3] = driver.poll(driver.ctx, check_sim.now_us, 0);
+  got = driver.decode(driver.ctx, &sample);
+
+  ok = ok && delay[0] == HDC1080_CONV_MS && delay[1] == HDC1080_RETRY_MS && delay[2] == HDC1080_RETRY_MS &&
+       delay[3] == SENSOR_NEXT_PERIOD && got == 1 && dev.stats.nacks == HDC1080_MAX_RETRIES + 2 &&
+       dev.stats.readings == 1 && sample.time_us == t + (check_sim.now_us - t) / 2 &&
+       sample.values[0] == hdc1080_temp(0x6666) && sample.values[1] == hdc1080_hum(0x8000) &&
+       driver.decode(driver.ctx, &sample) == 0;
+
+  printf("{\"test\":\"hdc1080_check\",\"check\":\"retry\",\"nacks\":%u,\"errors\":%u,\"readings\":%u,"
+         "\"temp\":%d,\"hum\":%d,\"ok\":%d}\n",
+         dev.stats.nacks, dev.stats.errors, dev.stats.readings, got ? sample.values[0] : 0,
+         got ? sample.values[1] : 0, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief The driver on the scheduler, as vSensor_task runs it.
+*/
+static int check_sched()
+{
+  const int64_t end_us = CHECK_T0_US + (int64_t) CHECK_RUN_S * 1000000;
+  sensor_driver_t driver;
+  sensor_sched_t sched;
+  hdc1080_bus_t bus;
+  hdc1080_t dev;
+  int64_t next;
+  uint32_t readings = 0;
+  int ok;
+
+  hdc1080_sim_init(&check_sim, &bus);
+  hdc1080_init(&dev, &bus);
+  hdc1080_driver(&dev, &driver, HDC1080_PERIOD_MS);
+  sensor_sched_init(&sched);
+  sensor_sched_add_sink(&sched, sink, NULL);
+  sensor_sched_add(&sched, &driver, CHECK_T0_US);
+  check_samples = 0;
+  check_bad = 0;
+
+  next = CHECK_T0_US;
+  while(next < end_us)
+  {
+    // New register values for every conversion, set before it starts.
+    if(dev.started_us == 0)
+    {
+      check_sim.temp_raw = (uint16_t) (0x3000 + readings * 97);
+      check_sim.hum_raw = (uint16_t) (0xA000 - readings * 131);
+      check_started_us = next;
+      readings++;
+    }
+    check_sim.now_us = next;
+    next = sensor_sched_run(&sched, next);
+  }
+
+  ok = check_bad == 0 && check_samples == CHECK_RUN_S && dev.stats.readings == CHECK_RUN_S &&
+       sched.stats.drivers[0].polls == 2 * CHECK_RUN_S && dev.stats.nacks == 0 && dev.stats.errors == 0;
+
+  printf("{\"test\":\"hdc1080_check\",\"check\":\"sched\",\"seconds\":%u,\"samples\":%u,\"polls\":%u,"
+         "\"polls_per_reading\":%.2f,\"nacks\":%u,\"bad\":%u,\"ok\":%d}\n",
+         CHECK_RUN_S, check_samples, sched.stats.drivers[0].polls,
+         (check_samples > 0) ? (double) sched.stats.drivers[0].polls / check_samples : 0.0,
+         dev.stats.nacks, check_bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Checks a sample carries the registers its conversion was started
+*        with and the middle of that conversion as its time.
+*/
+static void sink(const sensor_sample_t *sample, void *arg)
+{
+  uint32_t n = check_samples++;
+
+  if(sample->count != 2 ||
+     sample->values[0] != hdc1080_temp((uint16_t) (0x3000 + n * 97)) ||
+     sample->values[1] != hdc1080_hum((uint16_t) (0xA000 - n * 131)) ||
+     sample->time_us != check_started_us + HDC1080_CONV_MS * 1000 / 2)
+    check_bad++;
+}
@@ -0,0 +1,346 @@
+/*
+*	mics_check.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The MiCS-4514 filter and calibration (mics_filter.c) on synthetic
+*   waveforms. The ADS1015 is modelled as the true voltage plus noise,
+*   quantised to 12 bits. Four checks:
+*
+*   boxcar - constant codes come out exactly (code << 4), negative codes
+*            count as 0, mics_boxcar_block() matches mics_boxcar_add(),
+*            and on a slow sine, a ramp and steps with +-2 codes of noise
+*            every output is within CHECK_BOX_MAX_LSB (16 bit LSBs) of the
+*            mean of the true voltage over its 64 conversions.
+*   lut    - mics_cal_apply() against Rs = RL * v / (Vc - v) worked out in
+*            double for every 16 bit code up to full scale, with the default
+*            calibration and with an offset and gain: every code within
+*            CHECK_LUT_MAX_OHM (the table is in whole ohms) plus
+*            CHECK_LUT_MAX_PPM of Rs.
+*   chain  - the waveforms through both: every resistance between the ones
+*            at the mean true voltage -+ CHECK_BOX_MAX_LSB, with the lut
+*            allowance on each side. Also prints the largest error against
+*            Rs at the mean over outputs above CHECK_CHAIN_MIN_OHM.
+*
+*   Prints a JSON line per check. Fails with exit status 1 if any is off.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "mics.h"
+
+#define CHECK_OUTPUTS        2000      // Filter outputs per waveform
+#define CHECK_NOISE_CODES    2         // Uniform noise on every conversion, +-
+#define CHECK_BOX_MAX_LSB    16.0      // 16 bit LSBs, one code: the noise left after 64, and truncation
+#define CHECK_LUT_MAX_OHM    2.0       // Table rounding and interpolation truncation
+#define CHECK_LUT_MAX_PPM    1000.0    // Chord against the curve over a segment
+#define CHECK_CHAIN_MIN_OHM  1000.0    // Only reported: below it the ohms are mostly rounding
+#define CHECK_FULL_SCALE     32768.0   // 16 bit code of MICS_FSR_MV
+
+
+/*
+* @brief A test waveform: the true voltage in mV at conversion i
+*/
+typedef struct
+{
+  const char *name;
+  double (*mv)(uint32_t i);
+} check_wave_t;
+
+
+/* Function prototypes */
+static int check_boxcar();
+static int check_lut(const char *name, const mics_cal_config_t *config);
+static int check_chain();
+static double rs_exact(const mics_cal_config_t *config, double v_mv);
+static int16_t adc(double mv);
+static double wave_sine(uint32_t i);
+static double wave_ramp(uint32_t i);
+static double wave_steps(uint32_t i);
+static uint32_t rnd();
+
+/* Global variables */
+static const check_wave_t check_waves[] =
+{
+  { "sine",  wave_sine },
+  { "ramp",  wave_ramp },
+  { "steps", wave_steps }
+};
+static uint32_t check_seed = 1;
+
+
+
+int main(int argc, char **argv)
+{
+  const mics_cal_config_t def = MICS_CAL_CONFIG_DEFAULT();
+  mics_cal_config_t trimmed = def;
+  int failed = 0;
+
+  trimmed.offset_uv = 3500;
+  trimmed.gain_ppm = -2500;
+
+  failed |= check_boxcar();
+  failed |= check_lut("default", &def);
+  failed |= check_lut("trimmed", &trimmed);
+  failed |= check_chain();
+
+  return failed;
+}
+
+
+/*
+* @brief Decimator outputs against the true mean.
+*/
+static int check_boxcar()
+{
+  static int16_t codes[CHECK_OUTPUTS << MICS_OVERSAMPLE_LOG2];
+  static uint16_t block_out[CHECK_OUTPUTS];
+  const uint32_t per = 1 << MICS_OVERSAMPLE_LOG2;
+  mics_boxcar_t f;
+  mics_boxcar_t g;
+  uint16_t out;
+  uint32_t bad = 0;
+  uint32_t n;
+  uint32_t i;
+  uint32_t k;
+  size_t w;
+  double mean;
+  double err;
+  double max_err = 0;
+  double sum_sq = 0;
+  uint32_t count = 0;
+  int ok;
+
+  // Constants, including both ends and a negative code.
+  for(k = 0; k < 5; k++)
+  {
+    int16_t c = (k == 0) ? -5 : (k == 1) ? 0 : (k == 2) ? 1 : (k == 3) ? 1234 : 2047;
+
+    mics_boxcar_init(&f, MICS_OVERSAMPLE_LOG2);
+    for(i = 0; i < per; i++)
+    {
+      if(mics_boxcar_add(&f, c, &out) != (i == per - 1))
+        bad++;
+    }
+    if(out != ((c > 0) ? c : 0) << (MICS_OUT_BITS - MICS_CODE_BITS))
+      bad++;
+  }
+
+  for(w = 0; w < sizeof(check_waves) / sizeof(check_waves[0]); w++)
+  {
+    for(i = 0; i < (CHECK_OUTPUTS << MICS_OVERSAMPLE_LOG2); i++)
+      codes[i] = adc(check_waves[w].mv(i));
+
+    mics_boxcar_init(&f, MICS_OVERSAMPLE_LOG2);
+    mics_boxcar_init(&g, MICS_OVERSAMPLE_LOG2);
+    n = mics_boxcar_block(&g, codes, CHECK_OUTPUTS << MICS_OVERSAMPLE_LOG2, block_out, CHECK_OUTPUTS);
+    if(n != CHECK_OUTPUTS)
+      bad++;
+
+    for(k = 0; k < CHECK_OUTPUTS; k++)
+    {
+      mean = 0;
+      for(i = 0; i < per; i++)
+      {
+        mean += check_waves[w].mv(k * per + i);
+        if(mics_boxcar_add(&f, codes[k * per + i], &out) != (i == per - 1))
+          bad++;
+      }
+      mean /= per;
+
+      if(k < n && out != block_out[k])
+        bad++;
+
+      err = out - mean * CHECK_FULL_SCALE / MICS_FSR_MV;
+      if(fabs(err) > max_err)
+        max_err = fabs(err);
+      sum_sq += err * err;
+      count++;
+    }
+  }
+
+  ok = bad == 0 && max_err <= CHECK_BOX_MAX_LSB;
+  printf("{\"test\":\"mics_check\",\"check\":\"boxcar\",\"outputs\":%u,\"max_err_lsb\":%.2f,\"rms_err_lsb\":%.2f,"
+         "\"bad\":%u,\"ok\":%d}\n", count, max_err, sqrt(sum_sq / count), bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Lookup table against the exact resistance for every code.
+*/
+static int check_lut(const char *name, const mics_cal_config_t *config)
+{
+  static mics_cal_t cal;
+  double want;
+  double err;
+  double max_ppm = 0;
+  double max_ohm = 0;
+  uint32_t bad = 0;
+  uint32_t code;
+  int ok;
+
+  mics_cal_init(&cal, config);
+
+  // The filter's outputs stop at full scale, and with the ADC's range
+  // under the supply so does the table.
+  for(code = 0; code < CHECK_FULL_SCALE; code++)
+  {
+    want = rs_exact(config, code * (double) MICS_FSR_MV / CHECK_FULL_SCALE);
+    err = fabs(mics_cal_apply(&cal, code) - want);
+    if(err > max_ohm)
+      max_ohm = err;
+    if(want >= CHECK_CHAIN_MIN_OHM && err / want * 1e6 > max_ppm)
+      max_ppm = err / want * 1e6;
+    if(err > CHECK_LUT_MAX_OHM + want * CHECK_LUT_MAX_PPM / 1e6)
+      bad++;
+  }
+
+  ok = bad == 0;
+  printf("{\"test\":\"mics_check\",\"check\":\"lut\",\"cal\":\"%s\",\"max_err_ppm\":%.1f,\"max_err_ohm\":%.2f,"
+         "\"bad\":%u,\"ok\":%d}\n", name, max_ppm, max_ohm, bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Waveform to resistance, both stages.
+*/
+static int check_chain()
+{
+  const mics_cal_config_t config = MICS_CAL_CONFIG_DEFAULT();
+  const uint32_t per = 1 << MICS_OVERSAMPLE_LOG2;
+  static mics_cal_t cal;
+  mics_boxcar_t f;
+  const double lsb_mv = MICS_FSR_MV / CHECK_FULL_SCALE;
+  uint16_t out;
+  uint32_t got;
+  double mean;
+  double want;
+  double lo;
+  double hi;
+  double max_ppm = 0;
+  uint32_t count = 0;
+  uint32_t bad = 0;
+  uint32_t i;
+  uint32_t k;
+  size_t w;
+  int ok;
+
+  mics_cal_init(&cal, &config);
+
+  for(w = 0; w < sizeof(check_waves) / sizeof(check_waves[0]); w++)
+  {
+    mics_boxcar_init(&f, MICS_OVERSAMPLE_LOG2);
+    for(k = 0; k < CHECK_OUTPUTS; k++)
+    {
+      mean = 0;
+      for(i = 0; i < per; i++)
+      {
+        mean += check_waves[w].mv(k * per + i);
+        mics_boxcar_add(&f, adc(check_waves[w].mv(k * per + i)), &out);
+      }
+      mean /= per;
+
+      got = mics_cal_apply(&cal, out);
+      want = rs_exact(&config, mean);
+      lo = rs_exact(&config, mean - CHECK_BOX_MAX_LSB * lsb_mv);
+      hi = rs_exact(&config, mean + CHECK_BOX_MAX_LSB * lsb_mv);
+      if(got < lo * (1 - CHECK_LUT_MAX_PPM / 1e6) - CHECK_LUT_MAX_OHM ||
+         got > hi * (1 + CHECK_LUT_MAX_PPM / 1e6) + CHECK_LUT_MAX_OHM)
+        bad++;
+      if(want >= CHECK_CHAIN_MIN_OHM && fabs(got - want) / want * 1e6 > max_ppm)
+        max_ppm = fabs(got - want) / want * 1e6;
+      count++;
+    }
+  }
+
+  ok = bad == 0;
+  printf("{\"test\":\"mics_check\",\"check\":\"chain\",\"outputs\":%u,\"max_err_ppm\":%.1f,\"bad\":%u,"
+         "\"ok\":%d}\n", count, max_ppm, bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Sensing resistance for a measured voltage, as mics_cal_init()
+*        defines it but in double.
+*
+* @return ohms, 0 at or below the offset
+*/
+static double rs_exact(const mics_cal_config_t *config, double v_mv)
+{
+  double v = (v_mv - config->offset_uv / 1000.0) * (1 + config->gain_ppm / 1e6);
+
+  if(v <= 0)
+    return 0;
+
+  return config->rl_ohm * v / (config->vc_mv - v);
+}
+
+
+/*
+* @brief The ADS1015 at +-4.096 V: a 12 bit code with noise.
+*/
+static int16_t adc(double mv)
+{
+  double code = mv * 2048 / MICS_FSR_MV + (int32_t) (rnd() % (2 * CHECK_NOISE_CODES + 1)) - CHECK_NOISE_CODES;
+
+  code = floor(code + 0.5);
+  if(code > 2047)
+    code = 2047;
+  if(code < -2048)
+    code = -2048;
+
+  return (int16_t) code;
+}
+
+
+/*
+* @brief 0.2-3.8 V, one period every 100 outputs.
+*/
+static double wave_sine(uint32_t i)
+{
+  return 2000 + 1800 * sin(2 * M_PI * i / (100 << MICS_OVERSAMPLE_LOG2));
+}
+
+
+/*
+* @brief 0-4 V once over the run, up to just under full scale.
+*/
+static double wave_ramp(uint32_t i)
+{
+  return 4000.0 * i / (CHECK_OUTPUTS << MICS_OVERSAMPLE_LOG2);
+}
+
+
+/*
+* @brief A level that jumps every 37 outputs, so steps land inside the
+*        filter's windows.
+*/
+static double wave_steps(uint32_t i)
+{
+  return 300 + (i / (37 << MICS_OVERSAMPLE_LOG2)) % 7 * 500;
+}
+
+
+/*
+* @brief xorshift32
+*/
+static uint32_t rnd()
+{
+  check_seed ^= check_seed << 13;
+  check_seed ^= check_seed >> 17;
+  check_seed ^= check_seed << 5;
+
+  return check_seed;
+}
@@ -0,0 +1,292 @@
+/*
+*	record_fuzz.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   record.h against random input, in two passes:
+*
+*   roundtrip - blocks of random capacity filled with random records until
+*               full: any mix of streams, value counts that change now and
+*               then (a new schema mid-block), values anywhere in the int32
+*               range as well as small steps, time steps backwards as well
+*               as forwards, and UTC only on some records. Every block is
+*               read back and each record compared with what went in: the
+*               values exactly, the time to the ms rounding the encoder
+*               promises, and the UTC from the block's offset.
+*   crc       - blocks built the same way have every single bit flipped in
+*               turn, header, records and CRC alike, and are cut short at
+*               every length; record_reader_init() has to refuse all of
+*               them.
+*
+*   Deterministic for a given seed. Any mismatch or accepted damage fails
+*   the run with exit status 1.
+*
+*   Usage: record_fuzz [RECORDS [SEED]]   (default 1000000, 1)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "record.h"
+
+#define FUZZ_RECORDS    1000000
+#define FUZZ_MAX_CAP    2048
+#define FUZZ_MAX_BLOCK  (FUZZ_MAX_CAP / 2)  // Records a block can hold at most, 2 bytes each
+#define FUZZ_CRC_BLOCKS 24
+
+
+/* Function prototypes */
+static uint32_t rnd();
+static void make_record(sensor_sample_t *s, int64_t *time_us, uint8_t *counts);
+static uint16_t fill_block(record_block_t *block, uint8_t *buf, sensor_sample_t *in);
+static uint32_t check_block(const uint8_t *buf, size_t len, const sensor_sample_t *in, uint16_t n);
+static int roundtrip(uint32_t records);
+static int crc(void);
+
+/* Global variables */
+static uint32_t fuzz_seed = 1;
+
+
+
+int main(int argc, char **argv)
+{
+  uint32_t records = FUZZ_RECORDS;
+  int failed = 0;
+
+  if(argc > 1)
+    records = strtoul(argv[1], NULL, 0);
+  if(argc > 2)
+    fuzz_seed = strtoul(argv[2], NULL, 0);
+  if(records == 0)
+    records = FUZZ_RECORDS;
+  if(fuzz_seed == 0)
+    fuzz_seed = 1;
+
+  failed |= roundtrip(records);
+  failed |= crc();
+
+  return failed;
+}
+
+
+/*
+* @brief xorshift32
+*/
+static uint32_t rnd()
+{
+  fuzz_seed ^= fuzz_seed << 13;
+  fuzz_seed ^= fuzz_seed >> 17;
+  fuzz_seed ^= fuzz_seed << 5;
+  return fuzz_seed;
+}
+
+
+/*
+* @brief Makes the next random record.
+*
+* @param s       - filled in with the record
+* @param time_us - time of the previous record, moved on to this one's
+* @param counts  - value count of each stream so far, changed now and then
+*
+* @return void
+*/
+static void make_record(sensor_sample_t *s, int64_t *time_us, uint8_t *counts)
+{
+  uint32_t r = rnd();
+  uint8_t i;
+
+  memset(s, 0, sizeof(*s));
+  s->sensor = rnd() % RECORD_MAX_STREAMS;
+  if(r % 16 == 0)
+    counts[s->sensor] = rnd() % (RECORD_MAX_VALUES + 1);
+  s->count = counts[s->sensor];
+
+  // Mostly about a second on, sometimes far ahead or back.
+  if(r % 64 == 1)
+    *time_us -= rnd() % 100000000;
+  else if(r % 64 == 2)
+    *time_us += rnd() % 1000000000;
+  else
+    *time_us += 900000 + rnd() % 200000;
+  s->time_us = *time_us;
+  s->utc_us = (r % 4 == 3) ? *time_us + 1700000000000000LL : 0;
+
+  for(i = 0; i < s->count; i++)
+  {
+    switch(rnd() % 4)
+    {
+      case 0:  s->values[i] = (int32_t) rnd(); break;
+      case 1:  s->values[i] = (rnd() & 1) ? INT32_MAX : INT32_MIN; break;
+      default: s->values[i] = (int32_t) (rnd() % 64) - 32; break;
+    }
+  }
+}
+
+
+/*
+* @brief Fills a block of random capacity with random records until one
+*        doesn't fit.
+*
+* @param block - block state
+* @param buf   - FUZZ_MAX_CAP bytes
+* @param in    - the records that went in
+*
+* @return number of records in the block
+*/
+static uint16_t fill_block(record_block_t *block, uint8_t *buf, sensor_sample_t *in)
+{
+  uint8_t counts[RECORD_MAX_STREAMS];
+  int64_t time_us = (int64_t) (rnd() % 1000000) * 1000000;
+  uint16_t cap = RECORD_OVERHEAD + RECORD_MAX_LEN + rnd() % (FUZZ_MAX_CAP - RECORD_OVERHEAD - RECORD_MAX_LEN + 1);
+  uint16_t n = 0;
+  int i;
+
+  for(i = 0; i < RECORD_MAX_STREAMS; i++)
+    counts[i] = rnd() % (RECORD_MAX_VALUES + 1);
+
+  record_block_init(block, buf, cap);
+  for(;;)
+  {
+    make_record(&in[n], &time_us, counts);
+    if(!record_block_add(block, &in[n]))
+      break;
+    n++;
+  }
+
+  return n;
+}
+
+
+/*
+* @brief Reads a block back and compares it with what went in.
+*
+* @return number of mismatched records, 1 for every record if the block is
+*         refused
+*/
+static uint32_t check_block(const uint8_t *buf, size_t len, const sensor_sample_t *in, uint16_t n)
+{
+  record_reader_t reader;
+  sensor_sample_t out;
+  int64_t want_us = in[0].time_us;
+  int64_t delta_us;
+  int64_t utc_off = 0;
+  uint32_t bad = 0;
+  uint16_t i;
+
+  if(record_reader_init(&reader, buf, len) != n)
+    return (n > 0) ? n : 1;
+
+  // The block keeps the offset of the first record that had a UTC time.
+  for(i = 0; i < n && utc_off == 0; i++)
+  {
+    if(in[i].utc_us != 0)
+      utc_off = in[i].utc_us - in[i].time_us;
+  }
+
+  for(i = 0; i < n; i++)
+  {
+    // The time the encoder tracks: every step rounded to the ms.
+    delta_us = in[i].time_us - want_us;
+    if(i > 0)
+      want_us += ((delta_us >= 0) ? (delta_us + 500) / 1000 : (delta_us - 500) / 1000) * 1000;
+
+    if(record_reader_next(&reader, &out) != 1 ||
+       out.sensor != in[i].sensor || out.count != in[i].count ||
+       memcmp(out.values, in[i].values, in[i].count * sizeof(int32_t)) != 0 ||
+       out.time_us != want_us || llabs(out.time_us - in[i].time_us) > 500 ||
+       out.utc_us != (utc_off != 0 ? out.time_us + utc_off : 0))
+      bad++;
+  }
+  if(record_reader_next(&reader, &out) != 0)
+    bad++;
+
+  return bad;
+}
+
+
+/*
+* @brief Round trip pass.
+*
+* @return 0 if every record came back, 1 if not
+*/
+static int roundtrip(uint32_t records)
+{
+  static uint8_t buf[FUZZ_MAX_CAP];
+  static sensor_sample_t in[FUZZ_MAX_BLOCK + 1];
+  record_block_t block;
+  uint32_t total = 0;
+  uint32_t blocks = 0;
+  uint32_t bad = 0;
+  uint64_t bytes = 0;
+  uint16_t n;
+
+  while(total < records)
+  {
+    n = fill_block(&block, buf, in);
+    bad += check_block(buf, block.len, in, n);
+    total += n;
+    bytes += block.len;
+    blocks++;
+  }
+
+  printf("{\"test\":\"record_fuzz\",\"pass\":\"roundtrip\",\"records\":%u,\"blocks\":%u,"
+         "\"bytes_per_record\":%.2f,\"mismatches\":%u,\"ok\":%d}\n",
+         total, blocks, (double) bytes / total, bad, bad == 0);
+
+  return (bad == 0) ? 0 : 1;
+}
+
+
+/*
+* @brief Bit flip and truncation pass.
+*
+* @return 0 if no damaged block was accepted, 1 if one was
+*/
+static int crc(void)
+{
+  static uint8_t buf[FUZZ_MAX_CAP];
+  static sensor_sample_t in[FUZZ_MAX_BLOCK + 1];
+  record_block_t block;
+  record_reader_t reader;
+  uint32_t flips = 0;
+  uint32_t cuts = 0;
+  uint32_t accepted = 0;
+  uint32_t bad = 0;
+  uint32_t b;
+  size_t bit;
+  size_t len;
+  uint16_t n;
+
+  for(b = 0; b < FUZZ_CRC_BLOCKS; b++)
+  {
+    n = fill_block(&block, buf, in);
+    bad += check_block(buf, block.len, in, n);
+
+    for(bit = 0; bit < (size_t) block.len * 8; bit++)
+    {
+      buf[bit / 8] ^= 1 << (bit % 8);
+      // The whole buffer is offered, so a length flipped larger is
+      // checked against whatever follows the block.
+      if(record_reader_init(&reader, buf, sizeof(buf)) >= 0)
+        accepted++;
+      buf[bit / 8] ^= 1 << (bit % 8);
+      flips++;
+    }
+
+    for(len = 0; len < block.len; len++, cuts++)
+    {
+      if(record_reader_init(&reader, buf, len) >= 0)
+        accepted++;
+    }
+  }
+
+  printf("{\"test\":\"record_fuzz\",\"pass\":\"crc\",\"blocks\":%u,\"bit_flips\":%u,\"truncations\":%u,"
+         "\"accepted\":%u,\"mismatches\":%u,\"ok\":%d}\n",
+         FUZZ_CRC_BLOCKS, flips, cuts, accepted, bad, accepted == 0 && bad == 0);
+
+  return (accepted == 0 && bad == 0) ? 0 : 1;
+}
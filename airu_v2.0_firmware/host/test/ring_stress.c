@@ -0,0 +1,332 @@
+/*
+*	ring_stress.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   pm_ring.h under two real threads: a producer pushing as fast as it can
+*   and a consumer reading it back, so the acquire/release publishing is
+*   exercised on the host's cores and not just in the sensor task's
+*   timing. Every sample carries its sequence number and a checksum over
+*   all of its other fields; the consumer checks both on every sample it
+*   reads.
+*
+*   Two passes of COUNT samples each:
+*
+*   lossless - the producer retries a full ring, so the consumer must see
+*              every sequence number exactly once, in order ('dropped' is
+*              then the pushes that found the ring full).
+*   lossy    - the producer drops on a full ring, as the PM driver does;
+*              sequence numbers must still only go up, and the gaps must
+*              add up to pm_ring_dropped().
+*
+*   The consumer alternates pm_ring_pop() and pm_ring_peek()/release() so
+*   both read paths are covered. In the lossy pass it never yields, as a
+*   reader on the other core doesn't, so its reads overlap the producer's
+*   pushes; in the lossless pass it gives way on an empty ring, which the
+*   producer is waiting on anyway. Any torn read, gap, repeat or miscount
+*   fails the run with exit status 1.
+*
+*   Each pass also prints samples/s through the ring, the host's cores and
+*   the reads that returned samples while the producer moved on
+*   ('overlaps'). On a single core host those are only the reads the
+*   scheduler preempted, and the lossy pass then gets about a ring's worth
+*   of samples per time slice; with two cores it gets most of them.
+*
+*   Usage: ring_stress [COUNT]   (default 4000000)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "pm_ring.h"
+
+#define STRESS_COUNT  4000000
+#define STRESS_BATCH  16          // pm_ring_pop() batch
+#define STRESS_CHANNELS 3
+
+
+/*
+* @brief One pass
+*/
+typedef struct
+{
+  pm_ring_t *ring;
+  uint32_t count;
+  int lossy;
+  uint32_t pushed;          // Producer: samples that went in
+  uint32_t received;        // Consumer: samples read...
+  uint32_t gaps;            // ...sequence numbers skipped...
+  uint32_t torn;            // ...checksum failures...
+  uint32_t out_of_order;    // ...and repeats or steps back
+  uint32_t overlaps;        // Reads that returned samples while the producer moved on
+} stress_t;
+
+
+/* Function prototypes */
+static void fill(pm_sample_t *s, uint32_t seq);
+static uint16_t checksum(const pm_sample_t *s);
+static void *producer(void *arg);
+static void *consumer(void *arg);
+static void check(stress_t *st, const pm_sample_t *s, uint32_t *next);
+static int run(const char *name, uint32_t count, int lossy);
+static uint32_t produced(const pm_ring_t *ring);
+static double now_s();
+
+/* Global variables */
+static pm_ring_t stress_ring;
+static volatile int stress_done;  // Producer finished, set after its last push
+
+
+
+int main(int argc, char **argv)
+{
+  uint32_t count = STRESS_COUNT;
+  int failed = 0;
+
+  if(argc > 1)
+    count = strtoul(argv[1], NULL, 0);
+  if(count == 0)
+    count = STRESS_COUNT;
+
+  failed |= run("lossless", count, 0);
+  failed |= run("lossy", count, 1);
+
+  return failed;
+}
+
+
+/*
+* @brief Runs one pass and prints its counts.
+*
+* @return 0 if the pass was clean, 1 if not
+*/
+static int run(const char *name, uint32_t count, int lossy)
+{
+  stress_t st;
+  pthread_t prod;
+  pthread_t cons;
+  uint32_t dropped;
+  double t0;
+  double t1;
+  int ok;
+
+  memset(&st, 0, sizeof(st));
+  st.ring = &stress_ring;
+  st.count = count;
+  st.lossy = lossy;
+  pm_ring_init(&stress_ring);
+  stress_done = 0;
+
+  t0 = now_s();
+  if(pthread_create(&cons, NULL, consumer, &st) != 0 ||
+     pthread_create(&prod, NULL, producer, &st) != 0)
+  {
+    fprintf(stderr, "cannot start threads\n");
+    return 1;
+  }
+  pthread_join(prod, NULL);
+  pthread_join(cons, NULL);
+  t1 = now_s();
+
+  dropped = pm_ring_dropped(&stress_ring);
+  // A lossless push that is retried still counts a drop each time it
+  // finds the ring full.
+  ok = st.torn == 0 && st.out_of_order == 0 && st.received == st.pushed;
+  if(lossy)
+    ok = ok && st.pushed + dropped == count && st.gaps == dropped;
+  else
+    ok = ok && st.pushed == count && st.gaps == 0;
+
+  printf("{\"test\":\"ring_stress\",\"pass\":\"%s\",\"samples\":%u,\"samples_per_s\":%.0f,\"cpus\":%ld,"
+         "\"received\":%u,\"dropped\":%u,\"gaps\":%u,\"overlaps\":%u,\"torn\":%u,\"out_of_order\":%u,"
+         "\"ok\":%d}\n",
+         name, count, count / (t1 - t0), sysconf(_SC_NPROCESSORS_ONLN), st.received, dropped, st.gaps,
+         st.overlaps, st.torn, st.out_of_order, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Fills every field from the sequence number, the checksum last.
+*/
+static void fill(pm_sample_t *s, uint32_t seq)
+{
+  memset(s, 0, sizeof(*s));
+  s->seq = seq;
+  s->time_us = (int64_t) seq * 1000003;
+  s->utc_us = ~s->time_us;
+  s->channel = seq % STRESS_CHANNELS;
+  s->pm1 = (uint16_t) (seq * 7);
+  s->pm2_5 = (uint16_t) (seq >> 16);
+  s->pm10 = (uint16_t) (seq ^ 0xA5A5);
+  s->temp = (int16_t) (seq * 31);
+  s->hum = checksum(s);
+}
+
+
+/*
+* @brief Fletcher-16 over every field but 'hum'.
+*/
+static uint16_t checksum(const pm_sample_t *s)
+{
+  const uint32_t words[] =
+  {
+    (uint32_t) s->time_us, (uint32_t) (s->time_us >> 32),
+    (uint32_t) s->utc_us, (uint32_t) (s->utc_us >> 32),
+    s->seq, s->channel, s->pm1, s->pm2_5, s->pm10, (uint16_t) s->temp
+  };
+  uint32_t a = 1;
+  uint32_t b = 0;
+  size_t i;
+  int k;
+
+  for(i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+  {
+    for(k = 0; k < 32; k += 8)
+    {
+      a = (a + ((words[i] >> k) & 0xFF)) % 255;
+      b = (b + a) % 255;
+    }
+  }
+
+  return (uint16_t) ((b << 8) | a);
+}
+
+
+/*
+* @brief Pushes 'count' samples, retrying a full ring unless the pass is
+*        lossy.
+*/
+static void *producer(void *arg)
+{
+  stress_t *st = (stress_t *) arg;
+  pm_sample_t s;
+  uint32_t seq;
+
+  for(seq = 0; seq < st->count; seq++)
+  {
+    fill(&s, seq);
+    if(st->lossy)
+      st->pushed += pm_ring_push(st->ring, &s);
+    else
+    {
+      while(!pm_ring_push(st->ring, &s))
+        sched_yield();
+      st->pushed++;
+    }
+  }
+
+  __atomic_store_n(&stress_done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+
+/*
+* @brief Reads until the producer is done and the ring is empty, through
+*        pm_ring_pop() and pm_ring_peek()/release() in turn. Spins in a
+*        lossy pass, so it overlaps the producer on a second core.
+*/
+static void *consumer(void *arg)
+{
+  stress_t *st = (stress_t *) arg;
+  pm_sample_t batch[STRESS_BATCH];
+  const pm_sample_t *first;
+  uint32_t next = 0;
+  uint32_t turn = 0;
+  uint32_t before;
+  size_t n;
+  size_t i;
+  int done;
+
+  for(;;)
+  {
+    // Read 'done' first: anything pushed before it was set is then seen
+    // by the reads below.
+    done = __atomic_load_n(&stress_done, __ATOMIC_ACQUIRE);
+    before = produced(st->ring);
+
+    if(turn++ & 1)
+    {
+      n = pm_ring_pop(st->ring, batch, STRESS_BATCH);
+      for(i = 0; i < n; i++)
+        check(st, &batch[i], &next);
+    }
+    else
+    {
+      n = pm_ring_peek(st->ring, &first);
+      for(i = 0; i < n; i++)
+        check(st, &first[i], &next);
+      pm_ring_release(st->ring, n);
+    }
+
+    if(n > 0 && produced(st->ring) != before)
+      st->overlaps++;
+    if(n == 0 && done)
+      break;
+    // A lossless producer only retries once this gives way on one core.
+    if(n == 0 && !st->lossy)
+      sched_yield();
+  }
+
+  // Samples dropped after the last one read are gaps too.
+  st->gaps += st->count - next;
+
+  return NULL;
+}
+
+
+/*
+* @brief Checks one sample against the sequence number expected next.
+*/
+static void check(stress_t *st, const pm_sample_t *s, uint32_t *next)
+{
+  pm_sample_t want;
+
+  st->received++;
+  if(s->seq < *next)
+  {
+    st->out_of_order++;
+    return;
+  }
+
+  st->gaps += s->seq - *next;
+  *next = s->seq + 1;
+
+  // Field by field, the padding is not copied reliably.
+  fill(&want, s->seq);
+  if(s->hum != checksum(s) || s->hum != want.hum || s->time_us != want.time_us ||
+     s->utc_us != want.utc_us || s->channel != want.channel || s->pm1 != want.pm1 ||
+     s->pm2_5 != want.pm2_5 || s->pm10 != want.pm10 || s->temp != want.temp)
+    st->torn++;
+}
+
+
+/*
+* @brief Samples the producer has pushed or dropped so far.
+*/
+static uint32_t produced(const pm_ring_t *ring)
+{
+  return __atomic_load_n(&ring->prod.head, __ATOMIC_ACQUIRE) +
+         __atomic_load_n(&ring->prod.dropped, __ATOMIC_RELAXED);
+}
+
+
+/*
+* @brief Monotonic time in seconds.
+*/
+static double now_s()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
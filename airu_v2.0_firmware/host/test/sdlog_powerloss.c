@@ -0,0 +1,458 @@
+/*
+*	sdlog_powerloss.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   sdlog.h on the file-backed device (sdlog_file.c) with the power pulled
+*   during every write call in turn. A run is a fixed workload: bursts of
+*   appends with flushes now and then, and read + ack whenever the upload
+*   side would, enough to wrap the ring a few times. The run is repeated
+*   with the power going at write call 0, 1, 2 ... and PL_TEARS different
+*   tears each: the first k sectors of the write land, the next only its
+*   first m bytes, and nothing after. That covers multi-sector data writes
+*   cut short at or inside a sector, and torn checkpoints.
+*
+*   After each crash the image is opened again and mounted, and the test
+*   checks:
+*
+*   - the head is one past the last data sector that landed whole, so
+*     sectors written after the last good checkpoint were rolled forward
+*   - sdlog_read() returns exactly the records from the last ack that
+*     landed to the last record that landed, in order and unchanged
+*   - the log carries on: more appends, a flush and another mount give
+*     those records followed by the new ones
+*
+*   Records that were only in the write-ahead buffer are lost with the
+*   power, as they would be on the node; nothing that reached the card is.
+*   Any miscount fails the run with exit status 1.
+*
+*   Usage: sdlog_powerloss [IMAGE]   (default /tmp/sdlog_powerloss.img)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdlog.h"
+
+#define PL_PATH       "/tmp/sdlog_powerloss.img"
+#define PL_SECTORS    64          // Data sectors, wrapped about four times a run
+#define PL_OPS        150         // Workload steps per run
+#define PL_BURST      150         // Most appends in one step
+#define PL_TEARS      2           // Tears tried at each write call
+#define PL_RESUME     150         // Appends after the crash
+#define PL_READ_MAX   8192
+#define PL_CHANNELS   3
+
+// sdlog.c's data sector header
+#define PL_HDR_SEQ    4
+#define PL_HDR_COUNT  8
+
+
+/*
+* @brief Block device that forwards to the image until the power goes
+*/
+typedef struct
+{
+  sdlog_bdev_t file;
+  uint32_t writes;          // Write calls so far
+  uint32_t crash_at;        // Write call the power goes in, UINT32_MAX for never
+  uint32_t tear_sector;     // Sectors of that write that land, modulo its count...
+  uint32_t tear_bytes;      // ...and bytes of the next one
+  uint8_t dead;
+  uint8_t torn_ckpt;        // The crash was in a checkpoint...
+  uint8_t ckpt_landed;      // ...that still landed whole
+  uint32_t on_card;         // Records in data sectors that landed whole
+  uint32_t head;            // One past the last of those sectors
+  uint32_t unchecked;       // Of those sectors, the ones after the last checkpoint
+} tear_dev_t;
+
+/*
+* @brief One run
+*/
+typedef struct
+{
+  uint32_t appended;        // Next sample sequence number
+  uint32_t acked;           // Samples behind the upload cursor
+  uint32_t acking;          // Samples the ack in progress would move it over
+  uint32_t mismatches;
+  uint32_t lost;
+} run_t;
+
+
+/* Function prototypes */
+static uint32_t rnd(uint32_t *state);
+static void fill(pm_sample_t *s, uint32_t seq);
+static int same(const pm_sample_t *a, const pm_sample_t *b);
+static esp_err_t tear_read(void *ctx, uint32_t sector, void *buf, uint32_t count);
+static esp_err_t tear_write(void *ctx, uint32_t sector, const void *buf, uint32_t count);
+static void landed(tear_dev_t *dev, uint32_t sector, const uint8_t *buf, uint32_t count);
+static void check(run_t *run, const pm_sample_t *got, int n, uint32_t seq, uint32_t count);
+static void workload(sdlog_t *log, tear_dev_t *dev, run_t *run);
+static int crash(uint32_t crash_at, uint32_t tear, tear_dev_t *dev, run_t *run);
+static int verify(tear_dev_t *dev, run_t *run);
+
+/* Global variables */
+static const char *pl_path = PL_PATH;
+static sdlog_t pl_log;
+static pm_sample_t pl_buf[PL_READ_MAX];
+
+
+
+int main(int argc, char **argv)
+{
+  tear_dev_t dev;
+  run_t run;
+  uint32_t writes;
+  uint32_t crashes = 0;
+  uint32_t torn_data = 0;
+  uint32_t torn_ckpt = 0;
+  uint32_t rolled = 0;
+  uint32_t head_errors = 0;
+  uint32_t mismatches = 0;
+  uint32_t lost = 0;
+  uint32_t records_lost;
+  uint32_t c;
+  uint32_t t;
+  int ok;
+
+  if(argc > 1)
+    pl_path = argv[1];
+
+  // Once without a crash, for the number of write calls.
+  if(crash(UINT32_MAX, 0, &dev, &run) != 0)
+  {
+    fprintf(stderr, "cannot open %s\n", pl_path);
+    return 1;
+  }
+  writes = dev.writes;
+  records_lost = pl_log.stats.records_lost;
+  mismatches += run.mismatches;
+
+  for(c = 0; c < writes; c++)
+  {
+    for(t = 0; t < PL_TEARS; t++)
+    {
+      if(crash(c, c * PL_TEARS + t + 1, &dev, &run) != 0)
+      {
+        fprintf(stderr, "cannot open %s\n", pl_path);
+        return 1;
+      }
+
+      if(dev.torn_ckpt)
+        torn_ckpt++;
+      else
+        torn_data++;
+      rolled += dev.unchecked;
+      head_errors += verify(&dev, &run);
+      mismatches += run.mismatches;
+      lost += run.lost;
+      crashes++;
+    }
+  }
+  remove(pl_path);
+
+  ok = crashes == writes * PL_TEARS && head_errors == 0 && mismatches == 0 && lost == 0 &&
+       records_lost == 0 && rolled > 0;
+
+  printf("{\"test\":\"sdlog_powerloss\",\"writes\":%u,\"crashes\":%u,\"torn_data\":%u,\"torn_checkpoint\":%u,"
+         "\"rolled_forward\":%u,\"head_errors\":%u,\"lost\":%u,\"mismatches\":%u,\"ok\":%d}\n",
+         writes, crashes, torn_data, torn_ckpt, rolled, head_errors, lost, mismatches, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief xorshift32
+*/
+static uint32_t rnd(uint32_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+
+/*
+* @brief Fills every field from the sequence number. Times are whole ms, so
+*        they come back exactly.
+*/
+static void fill(pm_sample_t *s, uint32_t seq)
+{
+  memset(s, 0, sizeof(*s));
+  s->seq = seq;
+  s->time_us = (int64_t) seq * 1000000;
+  s->channel = seq % PL_CHANNELS;
+  s->pm1 = (uint16_t) (seq * 7);
+  s->pm2_5 = (uint16_t) (seq >> 3);
+  s->pm10 = (uint16_t) (seq ^ 0xA5A5);
+  s->temp = (int16_t) (seq * 31);
+  s->hum = (uint16_t) (seq * 13);
+}
+
+
+/*
+* @brief Compares two samples field by field.
+*/
+static int same(const pm_sample_t *a, const pm_sample_t *b)
+{
+  return a->seq == b->seq && a->time_us == b->time_us && a->utc_us == b->utc_us &&
+         a->channel == b->channel && a->pm1 == b->pm1 && a->pm2_5 == b->pm2_5 &&
+         a->pm10 == b->pm10 && a->temp == b->temp && a->hum == b->hum;
+}
+
+
+/*
+* @brief Block device read callback, reads still work after a crash.
+*/
+static esp_err_t tear_read(void *ctx, uint32_t sector, void *buf, uint32_t count)
+{
+  tear_dev_t *dev = ctx;
+
+  return dev->file.read(dev->file.ctx, sector, buf, count);
+}
+
+
+/*
+* @brief Block device write callback. On write call 'crash_at' the first
+*        tear_sector % count sectors land, then tear_bytes of the next one
+*        over what was there, and the device is dead from then on.
+*/
+static esp_err_t tear_write(void *ctx, uint32_t sector, const void *buf, uint32_t count)
+{
+  tear_dev_t *dev = ctx;
+  const uint8_t *p = buf;
+  uint8_t torn[SDLOG_SECTOR_SIZE];
+  uint32_t k;
+
+  if(dev->dead)
+    return ESP_FAIL;
+
+  if(dev->writes++ != dev->crash_at)
+  {
+    if(dev->file.write(dev->file.ctx, sector, buf, count) != ESP_OK)
+      return ESP_FAIL;
+    landed(dev, sector, p, count);
+    return ESP_OK;
+  }
+
+  dev->dead = 1;
+  dev->torn_ckpt = sector < 2;
+  k = dev->tear_sector % count;
+  if(k > 0)
+  {
+    if(dev->file.write(dev->file.ctx, sector, buf, k) != ESP_OK)
+      return ESP_FAIL;
+    landed(dev, sector, p, k);
+  }
+
+  p += k * SDLOG_SECTOR_SIZE;
+  if(dev->file.read(dev->file.ctx, sector + k, torn, 1) != ESP_OK)
+    return ESP_FAIL;
+  memcpy(torn, p, dev->tear_bytes);
+  if(dev->file.write(dev->file.ctx, sector + k, torn, 1) != ESP_OK)
+    return ESP_FAIL;
+
+  // The part that didn't make it may have been the same as what was there.
+  if(memcmp(torn, p, SDLOG_SECTOR_SIZE) == 0)
+  {
+    landed(dev, sector + k, p, 1);
+    dev->ckpt_landed = dev->torn_ckpt;
+  }
+
+  return ESP_FAIL;
+}
+
+
+/*
+* @brief Accounts for sectors that reached the image whole.
+*/
+static void landed(tear_dev_t *dev, uint32_t sector, const uint8_t *buf, uint32_t count)
+{
+  const uint8_t *p;
+  uint32_t i;
+
+  for(i = 0; i < count; i++, sector++)
+  {
+    p = buf + i * SDLOG_SECTOR_SIZE;
+    if(sector < 2)
+    {
+      dev->unchecked = 0;
+      continue;
+    }
+
+    dev->on_card += p[PL_HDR_COUNT] | (p[PL_HDR_COUNT + 1] << 8);
+    dev->head = ((uint32_t) p[PL_HDR_SEQ] | ((uint32_t) p[PL_HDR_SEQ + 1] << 8) |
+                 ((uint32_t) p[PL_HDR_SEQ + 2] << 16) | ((uint32_t) p[PL_HDR_SEQ + 3] << 24)) + 1;
+    dev->unchecked++;
+  }
+}
+
+
+/*
+* @brief Checks that 'got' holds exactly 'count' samples from 'seq' on.
+*/
+static void check(run_t *run, const pm_sample_t *got, int n, uint32_t seq, uint32_t count)
+{
+  pm_sample_t want;
+  uint32_t i;
+
+  if(n < 0)
+  {
+    run->lost += count;
+    return;
+  }
+
+  for(i = 0; i < count || i < (uint32_t) n; i++)
+  {
+    fill(&want, seq + i);
+    if(i >= (uint32_t) n)
+      run->lost++;
+    else if(i >= count || !same(&got[i], &want))
+      run->mismatches++;
+  }
+}
+
+
+/*
+* @brief The workload, up to the first write that fails.
+*/
+static void workload(sdlog_t *log, tear_dev_t *dev, run_t *run)
+{
+  pm_sample_t s;
+  uint32_t state = 12345;
+  uint32_t op;
+  uint32_t burst;
+  uint32_t i;
+  int n;
+
+  for(op = 0; op < PL_OPS; op++)
+  {
+    burst = 1 + rnd(&state) % PL_BURST;
+    for(i = 0; i < burst; i++)
+    {
+      fill(&s, run->appended++);
+      if(sdlog_append(log, &s) != ESP_OK)
+        return;
+    }
+
+    if(rnd(&state) % 3 == 0 && sdlog_flush(log) != ESP_OK)
+      return;
+
+    // Upload whenever the link is up, and before the ring could lap the
+    // cursor: the test is about power loss, not overruns.
+    if(rnd(&state) % 2 == 0 || log->head_seq - log->cursor_seq > PL_SECTORS - 5 * SDLOG_BLOCK_SECTORS)
+    {
+      n = sdlog_read(log, pl_buf, PL_READ_MAX);
+      check(run, pl_buf, n, run->acked, dev->on_card - run->acked);
+      if(n < 0)
+        return;
+
+      run->acking = n;
+      if(sdlog_ack(log) != ESP_OK)
+        return;
+      run->acked += n;
+      run->acking = 0;
+    }
+  }
+}
+
+
+/*
+* @brief Runs the workload on a fresh image with the power going on write
+*        call 'crash_at'. 'tear' picks where in that write.
+*
+* @return 0, or 1 if the image cannot be opened
+*/
+static int crash(uint32_t crash_at, uint32_t tear, tear_dev_t *dev, run_t *run)
+{
+  sdlog_bdev_t bdev = { tear_read, tear_write, dev };
+  uint32_t state = tear * 2654435761u + 1;
+
+  memset(dev, 0, sizeof(*dev));
+  memset(run, 0, sizeof(*run));
+  dev->crash_at = crash_at;
+  dev->tear_sector = rnd(&state);
+  dev->tear_bytes = rnd(&state) % SDLOG_SECTOR_SIZE;
+
+  remove(pl_path);
+  if(sdlog_file_open(&dev->file, pl_path, 2 + PL_SECTORS) != ESP_OK)
+    return 1;
+
+  if(sdlog_mount(&pl_log, &bdev, 0, PL_SECTORS) == ESP_OK)
+    workload(&pl_log, dev, run);
+
+  // The write-ahead buffer goes with the power.
+  sdlog_file_close(&dev->file);
+
+  return 0;
+}
+
+
+/*
+* @brief Mounts the image after a crash and checks what comes back, then
+*        that the log goes on from there.
+*
+* @return 1 if the head was not where the landed sectors put it, else 0
+*/
+static int verify(tear_dev_t *dev, run_t *run)
+{
+  sdlog_bdev_t bdev;
+  pm_sample_t s;
+  uint32_t start;
+  uint32_t resume;
+  uint32_t i;
+  int head_error = 0;
+  int n;
+
+  // An ack whose checkpoint landed whole counts, even though it failed.
+  start = run->acked + (dev->ckpt_landed ? run->acking : 0);
+
+  if(sdlog_file_open(&bdev, pl_path, 2 + PL_SECTORS) != ESP_OK ||
+     sdlog_mount(&pl_log, &bdev, 0, PL_SECTORS) != ESP_OK)
+  {
+    run->lost += dev->on_card - start;
+    return 1;
+  }
+  if(pl_log.head_seq != dev->head)
+    head_error = 1;
+
+  n = sdlog_read(&pl_log, pl_buf, PL_READ_MAX);
+  check(run, pl_buf, n, start, dev->on_card - start);
+
+  // Carry on after the samples that were lost with the power.
+  resume = run->appended;
+  for(i = 0; i < PL_RESUME; i++)
+  {
+    fill(&s, resume + i);
+    sdlog_append(&pl_log, &s);
+  }
+  sdlog_flush(&pl_log);
+  sdlog_file_close(&bdev);
+
+  if(sdlog_file_open(&bdev, pl_path, 2 + PL_SECTORS) != ESP_OK ||
+     sdlog_mount(&pl_log, &bdev, 0, PL_SECTORS) != ESP_OK)
+  {
+    run->lost += dev->on_card - start + PL_RESUME;
+    return head_error;
+  }
+
+  n = sdlog_read(&pl_log, pl_buf, PL_READ_MAX);
+  if(n >= (int) (dev->on_card - start))
+  {
+    check(run, pl_buf, dev->on_card - start, start, dev->on_card - start);
+    check(run, pl_buf + dev->on_card - start, n - (dev->on_card - start), resume, PL_RESUME);
+  }
+  else
+  {
+    check(run, pl_buf, n, start, dev->on_card - start + PL_RESUME);
+  }
+  sdlog_file_close(&bdev);
+
+  return head_error;
+}
@@ -0,0 +1,316 @@
+/*
+*	sensor_sched_check.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The sensor scheduler (sensor_sched.c) with the mock drivers of
+*   sensor_mock.c, built without ESP_PLATFORM. A loop stands in for
+*   vSensor_task: it sleeps until the time sensor_sched_run() returns or
+*   the next event, takes one event per wakeup and counts the wakeups.
+*   Times are exact; the task's rounding up to a tick is not modelled.
+*
+*   Four drivers run for CHECK_RUN_S: three periodic ones, two of which
+*   start a conversion and come back for it, and one polled only on
+*   events, as the GPS UART is. Two scenarios:
+*
+*   steady - the task wakes when asked. Every sample must come at its
+*            slot on the period grid (plus the conversion time), or at its
+*            event, the polls must be one per sample (two with a
+*            conversion), and the wakeups must be the distinct times in
+*            those schedules: wakeups per sample below one wherever
+*            drivers share a slot.
+*   late   - the task is held up for CHECK_STALL_MS. Slots that went by
+*            in the stall must be skipped, not made up, and the drivers
+*            must be back on their grid after it.
+*
+*   Prints a JSON line per driver and scenario and one per scenario with
+*   the wakeups and wakeups per sample. Fails with exit status 1 on any
+*   sample off its schedule, bad value or miscount.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sensor.h"
+
+#define CHECK_RUN_S        60
+#define CHECK_EVENT_AT_MS  350       // Event driver: first event...
+#define CHECK_EVENT_MS     700       // ...and the time between them
+#define CHECK_STALL_AT_MS  10000     // late: the task is held up from...
+#define CHECK_STALL_MS     2500      // ...for
+#define CHECK_MAX_SAMPLES  256
+#define CHECK_MAX_WAKES    1024
+
+
+/*
+* @brief A mock driver's settings
+*/
+typedef struct
+{
+  const char *name;
+  uint32_t period_ms;       // 0: polled on events only
+  uint32_t conv_ms;
+} check_driver_t;
+
+/*
+* @brief Samples a driver delivered
+*/
+typedef struct
+{
+  uint32_t count;
+  uint32_t bad_values;
+  int64_t time_us[CHECK_MAX_SAMPLES];
+} check_log_t;
+
+
+/* Function prototypes */
+static int scenario(const char *name, int64_t stall_at_us, int64_t stall_us);
+static void sink(const sensor_sample_t *sample, void *arg);
+static uint32_t expect(const check_driver_t *d, int64_t stall_at_us, int64_t stall_us, int64_t *times);
+static uint32_t add_wake(int64_t *set, uint32_t n, int64_t t);
+
+/* Global variables */
+static const check_driver_t check_drivers[] =
+{
+  { "fast", 1000, 0 },
+  { "conv", 2000, 15 },
+  { "slow", 5000, 100 },
+  { "event", 0, 0 }
+};
+#define CHECK_DRIVERS  (sizeof(check_drivers) / sizeof(check_drivers[0]))
+
+static check_log_t check_log[CHECK_DRIVERS];
+
+
+
+int main(int argc, char **argv)
+{
+  int failed = 0;
+
+  failed |= scenario("steady", 0, 0);
+  failed |= scenario("late", (int64_t) CHECK_STALL_AT_MS * 1000, (int64_t) CHECK_STALL_MS * 1000);
+
+  return failed;
+}
+
+
+/*
+* @brief Runs the drivers through one scenario and checks them.
+*
+* @param name        - scenario name
+* @param stall_at_us - when the task is held up, 0 for never
+* @param stall_us    - for how long
+*
+* @return 0 if it was clean, 1 if not
+*/
+static int scenario(const char *name, int64_t stall_at_us, int64_t stall_us)
+{
+  static sensor_driver_t drivers[CHECK_DRIVERS];
+  static int64_t want[CHECK_MAX_SAMPLES];
+  static int64_t wakes[CHECK_MAX_WAKES];
+  const int64_t end_us = (int64_t) CHECK_RUN_S * 1000000;
+  const check_driver_t *d;
+  sensor_driver_stats_t *ds;
+  sensor_sched_t sched;
+  int64_t event_us = (int64_t) CHECK_EVENT_AT_MS * 1000;
+  int64_t next;
+  int64_t now;
+  uint32_t num_wakes = 0;
+  uint32_t samples = 0;
+  uint32_t num_want;
+  uint32_t queued = 0;
+  uint32_t off;
+  uint32_t i;
+  uint32_t k;
+  int ok;
+  int all_ok = 1;
+
+  memset(check_log, 0, sizeof(check_log));
+  sensor_sched_init(&sched);
+  sensor_sched_add_sink(&sched, sink, NULL);
+  for(i = 0; i < CHECK_DRIVERS; i++)
+  {
+    sensor_mock_init(&drivers[i], check_drivers[i].name, check_drivers[i].period_ms, check_drivers[i].conv_ms);
+    sensor_sched_add(&sched, &drivers[i], 0);
+  }
+
+  // vSensor_task: one run before the loop, then a run every wakeup.
+  next = sensor_sched_run(&sched, 0);
+  for(;;)
+  {
+    now = (event_us < next) ? event_us : next;
+    if(stall_us > 0 && now >= stall_at_us && now < stall_at_us + stall_us)
+      now = stall_at_us + stall_us;
+    if(now >= end_us)
+      break;
+
+    sched.stats.wakeups++;
+    if(event_us <= now)
+    {
+      sensor_sched_event(&sched, CHECK_DRIVERS - 1, now);
+      event_us += (int64_t) CHECK_EVENT_MS * 1000;
+    }
+    next = sensor_sched_run(&sched, now);
+  }
+
+  // Each driver against its own schedule; the wakeups against all of them.
+  for(i = 0; i < CHECK_DRIVERS; i++)
+  {
+    d = &check_drivers[i];
+    ds = &sched.stats.drivers[i];
+    num_want = expect(d, stall_at_us, stall_us, want);
+    samples += num_want;
+
+    off = 0;
+    for(k = 0; k < check_log[i].count; k++)
+    {
+      if(k >= num_want || check_log[i].time_us[k] != want[k])
+        off++;
+    }
+    for(k = 0; k < num_want; k++)
+    {
+      num_wakes = add_wake(wakes, num_wakes, want[k]);
+      if(d->conv_ms > 0)
+        num_wakes = add_wake(wakes, num_wakes, want[k] - (int64_t) d->conv_ms * 1000);
+      if(d->period_ms == 0 && stall_us > 0 && want[k] == stall_at_us + stall_us)
+        queued++;
+    }
+
+    ok = check_log[i].count == num_want && off == 0 && check_log[i].bad_values == 0 &&
+         ds->samples == num_want && ds->polls == num_want * ((d->conv_ms > 0) ? 2 : 1) &&
+         ds->events == ((d->period_ms == 0) ? num_want : 0);
+    all_ok &= ok;
+
+    printf("{\"test\":\"sensor_sched_check\",\"scenario\":\"%s\",\"driver\":\"%s\",\"period_ms\":%u,"
+           "\"conv_ms\":%u,\"polls\":%u,\"events\":%u,\"samples\":%u,\"expected\":%u,\"off_schedule\":%u,"
+           "\"bad_values\":%u,\"ok\":%d}\n",
+           name, d->name, d->period_ms, d->conv_ms, ds->polls, ds->events, check_log[i].count, num_want,
+           off, check_log[i].bad_values, ok);
+  }
+
+  // Nothing wakes the task in a stall; its end does, and then once more
+  // for every further event that queued up in it.
+  if(stall_us > 0)
+  {
+    off = 0;
+    for(k = 0; k < num_wakes; k++)
+    {
+      if(wakes[k] >= stall_at_us && wakes[k] < stall_at_us + stall_us)
+        off++;
+      else
+        wakes[k - off] = wakes[k];
+    }
+    num_wakes = add_wake(wakes, num_wakes - off, stall_at_us + stall_us);
+    if(queued > 1)
+      num_wakes += queued - 1;
+  }
+
+  ok = sched.stats.samples == samples && sched.stats.wakeups == num_wakes;
+  all_ok &= ok;
+
+  printf("{\"test\":\"sensor_sched_check\",\"scenario\":\"%s\",\"seconds\":%u,\"samples\":%u,\"wakeups\":%u,"
+         "\"expected_wakeups\":%u,\"wakeups_per_sample\":%.3f,\"ok\":%d}\n",
+         name, CHECK_RUN_S, sched.stats.samples, sched.stats.wakeups, num_wakes,
+         (sched.stats.samples > 0) ? (double) sched.stats.wakeups / sched.stats.samples : 0.0, all_ok);
+
+  return all_ok ? 0 : 1;
+}
+
+
+/*
+* @brief Logs a sample and checks it is the mock's next ramp value.
+*/
+static void sink(const sensor_sample_t *sample, void *arg)
+{
+  check_log_t *log = &check_log[sample->sensor];
+  uint32_t n = log->count + 1;
+
+  if(sample->count != 2 || sample->values[0] != (int32_t) n || sample->values[1] != (int32_t) (2 * n))
+    log->bad_values++;
+  if(log->count < CHECK_MAX_SAMPLES)
+    log->time_us[log->count] = sample->time_us;
+  log->count++;
+}
+
+
+/*
+* @brief Works out when a driver's samples are due: every grid slot (plus
+*        the conversion) or event before the end of the run. A slot that
+*        falls in the stall is taken once, at its end; the rest of the
+*        slots in the stall are skipped.
+*
+* @param d           - driver
+* @param stall_at_us - when the task is held up, 0 for never
+* @param stall_us    - for how long
+* @param times       - CHECK_MAX_SAMPLES, where to put the sample times
+*
+* @return number of samples
+*/
+static uint32_t expect(const check_driver_t *d, int64_t stall_at_us, int64_t stall_us, int64_t *times)
+{
+  const int64_t end_us = (int64_t) CHECK_RUN_S * 1000000;
+  const int64_t stall_end_us = stall_at_us + stall_us;
+  int64_t step_us = (int64_t) ((d->period_ms > 0) ? d->period_ms : CHECK_EVENT_MS) * 1000;
+  int64_t conv_us = (int64_t) d->conv_ms * 1000;
+  int64_t slot = (d->period_ms > 0) ? 0 : (int64_t) CHECK_EVENT_AT_MS * 1000;
+  int64_t poll;
+  int64_t t;
+  uint32_t n = 0;
+
+  while(slot < end_us && n < CHECK_MAX_SAMPLES)
+  {
+    poll = slot;
+    if(stall_us > 0 && poll >= stall_at_us && poll < stall_end_us)
+    {
+      poll = stall_end_us;
+      // Events queue up and are all taken, the grid skips what went by.
+      if(d->period_ms > 0)
+      {
+        while(slot < stall_end_us)
+          slot += step_us;
+        slot -= step_us;
+      }
+    }
+
+    // A conversion started before the stall is collected at its end.
+    t = poll + conv_us;
+    if(stall_us > 0 && t >= stall_at_us && t < stall_end_us)
+      t = stall_end_us;
+    if(t >= end_us)
+      break;
+
+    times[n++] = t;
+    slot += step_us;
+  }
+
+  return n;
+}
+
+
+/*
+* @brief Adds a wakeup time to a sorted set. Time 0 is the run before
+*        the loop, not a wakeup.
+*
+* @return the new size of the set
+*/
+static uint32_t add_wake(int64_t *set, uint32_t n, int64_t t)
+{
+  uint32_t i = n;
+
+  if(t <= 0 || n >= CHECK_MAX_WAKES)
+    return n;
+
+  while(i > 0 && set[i - 1] > t)
+    i--;
+  if(i > 0 && set[i - 1] == t)
+    return n;
+
+  memmove(&set[i + 1], &set[i], (n - i) * sizeof(set[0]));
+  set[i] = t;
+
+  return n + 1;
+}
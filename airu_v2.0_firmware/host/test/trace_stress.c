@@ -0,0 +1,166 @@
+/*
+*	trace_stress.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   trace.h's ring under two real threads: a writer calling
+*   trace_ring_put() as fast as it can and a reader calling
+*   trace_ring_drain() in a loop that never yields, as vTrace_task does on
+*   the other core. The ring is TRACE_RING_SIZE entries and the writer
+*   never waits, so it laps the reader all the time and the slots the
+*   reader copies are being overwritten under it.
+*
+*   Every entry carries its sequence number as the time and arguments
+*   derived from it. An entry the reader accepts must match its sequence
+*   number in every field ('torn' otherwise), sequence numbers must only
+*   go up, and the entries read plus those counted lost must add up to
+*   the entries written.
+*
+*   Also prints entries/s through the ring, the reader's share of them and
+*   the drains that ran while the writer was putting ('overlaps'; on a
+*   single core host only those the scheduler preempted). Fails with exit
+*   status 1 on any torn, out of order or miscounted entry.
+*
+*   Usage: trace_stress [COUNT]   (default 20000000)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "trace.h"
+
+#define STRESS_COUNT  20000000
+#define STRESS_BATCH  16          // Entries per trace_ring_drain(), as vTrace_task
+
+
+/* Function prototypes */
+static void *writer(void *arg);
+static void *reader(void *arg);
+static double now_s();
+
+/* Global variables */
+static trace_ring_t stress_ring;
+static uint32_t stress_count;
+static volatile int stress_done;  // Writer finished, set after its last put
+static uint32_t stress_read;
+static uint32_t stress_torn;
+static uint32_t stress_out_of_order;
+static uint32_t stress_overlaps;  // Drains that returned entries while the writer moved on
+
+
+
+int main(int argc, char **argv)
+{
+  pthread_t w;
+  pthread_t r;
+  double t0;
+  double t1;
+  int ok;
+
+  stress_count = STRESS_COUNT;
+  if(argc > 1)
+    stress_count = strtoul(argv[1], NULL, 0);
+  if(stress_count == 0)
+    stress_count = STRESS_COUNT;
+
+  trace_ring_init(&stress_ring);
+  t0 = now_s();
+  if(pthread_create(&r, NULL, reader, NULL) != 0 ||
+     pthread_create(&w, NULL, writer, NULL) != 0)
+  {
+    fprintf(stderr, "cannot start threads\n");
+    return 1;
+  }
+  pthread_join(w, NULL);
+  pthread_join(r, NULL);
+  t1 = now_s();
+
+  ok = stress_torn == 0 && stress_out_of_order == 0 && stress_read > 0 &&
+       stress_read + stress_ring.lost == stress_count;
+
+  printf("{\"test\":\"trace_stress\",\"entries\":%u,\"entries_per_s\":%.0f,\"read\":%u,\"lost\":%u,"
+         "\"overlaps\":%u,\"torn\":%u,\"out_of_order\":%u,\"ok\":%d}\n",
+         stress_count, stress_count / (t1 - t0), stress_read, stress_ring.lost,
+         stress_overlaps, stress_torn, stress_out_of_order, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Puts 'stress_count' entries without ever waiting for the reader.
+*/
+static void *writer(void *arg)
+{
+  uint32_t seq;
+
+  for(seq = 0; seq < stress_count; seq++)
+    trace_ring_put(&stress_ring, seq, seq % TRACE_NUM_IDS, ~seq, seq * 2654435761u, seq ^ 0x5A5A5A5A);
+
+  __atomic_store_n(&stress_done, 1, __ATOMIC_RELEASE);
+  return NULL;
+}
+
+
+/*
+* @brief Drains until the writer is done and the ring is empty, checking
+*        every entry it gets. Spins, so it overlaps the writer on a
+*        second core.
+*/
+static void *reader(void *arg)
+{
+  trace_entry_t batch[STRESS_BATCH];
+  const trace_entry_t *e;
+  uint32_t next = 0;
+  uint32_t head;
+  size_t n;
+  size_t i;
+  int done;
+
+  for(;;)
+  {
+    // Read 'done' first: anything put before it was set is then seen by
+    // the drain below.
+    done = __atomic_load_n(&stress_done, __ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&stress_ring.head, __ATOMIC_ACQUIRE);
+    n = trace_ring_drain(&stress_ring, batch, STRESS_BATCH);
+    if(n > 0 && __atomic_load_n(&stress_ring.head, __ATOMIC_ACQUIRE) != head)
+      stress_overlaps++;
+
+    for(i = 0; i < n; i++)
+    {
+      e = &batch[i];
+      stress_read++;
+      if(e->time_us < next)
+        stress_out_of_order++;
+      next = e->time_us + 1;
+
+      if(e->id != e->time_us % TRACE_NUM_IDS || e->args[0] != ~e->time_us ||
+         e->args[1] != e->time_us * 2654435761u || e->args[2] != (e->time_us ^ 0x5A5A5A5A))
+        stress_torn++;
+    }
+
+    if(n == 0 && done && stress_ring.tail == __atomic_load_n(&stress_ring.head, __ATOMIC_ACQUIRE))
+      break;
+  }
+
+  return NULL;
+}
+
+
+/*
+* @brief Monotonic time in seconds.
+*/
+static double now_s()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
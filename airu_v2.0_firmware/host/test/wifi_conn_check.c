@@ -0,0 +1,500 @@
+/*
+*	wifi_conn_check.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   The station connection policy (wifi_conn.c) driven through scripted
+*   system events, as internet_if.c's event handler drives it: station
+*   start, association, got IP and disconnect, and wifi_conn_step()
+*   whenever wifi_conn_next() comes due. Three checks:
+*
+*   script     - each of check_scripts from a given cache: after every
+*                event the action the policy asks for, its state and when
+*                it next wants a step, then its counters and what is left
+*                in the cache. Covers a cold connect, a directed connect
+*                reusing the cached address and renewing it by DHCP once
+*                'lease_s' has passed since the cached lease, an expired
+*                lease and one of unknown age (no wall clock yet), the fast to scan fallback (same AP and another
+*                one), failed scans backing off, an attempt timing out on
+*                a reused address, and drops before and after 'stable_ms'.
+*                The jitter is 0 here, so every wait is half its backoff.
+*   backoff    - scans that keep failing with random jitter: every wait
+*                between half and all of a delay that doubles from
+*                'retry_base_ms' up to 'retry_max_ms'.
+*   percentile - CHECK_CONNECTS connections of known lengths, each after
+*                the last held for 'stable_ms': connect_p50_ms,
+*                connect_p90_ms and connect_max_ms of the last
+*                WIFI_CONN_SAMPLES against the sorted lengths, and
+*                attempts_per_h.
+*
+*   Prints a JSON line per script and check. Fails with exit status 1 if
+*   any is off.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "wifi_conn.h"
+
+#define CHECK_UTC0_S      1790000000    // Wall clock at time 0
+#define CHECK_IP_OLD      0x0A01A8C0    // 192.168.1.10, the cached address
+#define CHECK_IP_DHCP     0x0B01A8C0    // 192.168.1.11, what DHCP gives
+#define CHECK_NETMASK     0x00FFFFFF
+#define CHECK_GW          0x0101A8C0
+#define CHECK_FRESH_S     600           // Age of a fresh cached lease
+#define CHECK_DUE         -1            // Step: at wifi_conn_next()
+#define CHECK_ANY         -2            // Due: not checked
+#define CHECK_NEVER       -3            // Due: WIFI_CONN_NEVER
+#define CHECK_CONNECTS    40
+#define CHECK_FAILURES    12
+
+
+/*
+* @brief A system event, or a call of wifi_conn_step()
+*/
+typedef enum
+{
+  EV_START,
+  EV_ASSOC,                 // With AP 'ap'
+  EV_UP,                    // Got CHECK_IP_DHCP, or the reused address
+  EV_DOWN,
+  EV_STEP
+} check_event_t;
+
+/*
+* @brief Cache contents a script starts from
+*/
+typedef enum
+{
+  CACHE_NONE,
+  CACHE_FRESH,              // AP 0 on channel 6, CHECK_IP_OLD leased CHECK_FRESH_S ago
+  CACHE_STALE               // ...leased 'lease_s' ago
+} check_cache_t;
+
+/*
+* @brief One event and what the policy must do about it
+*/
+typedef struct
+{
+  int32_t after_ms;         // Since the previous event, or CHECK_DUE
+  check_event_t event;
+  uint8_t ap;               // EV_ASSOC: which AP
+  wifi_conn_action_t action;
+  wifi_conn_state_t state;
+  int32_t due_ms;           // wifi_conn_next() after it, from now; or CHECK_ANY, CHECK_NEVER
+} check_step_t;
+
+/*
+* @brief A script, and the counters and cache it has to leave
+*/
+typedef struct
+{
+  const char *name;
+  check_cache_t cache;
+  uint8_t no_clock;         // Wall clock unknown: utc 0
+  const check_step_t *steps;
+  size_t num_steps;
+  wifi_conn_stats_t want;   // Counters only
+  uint32_t want_ip;         // Cached address at the end
+  uint8_t want_ap;
+} check_script_t;
+
+
+/* Function prototypes */
+static int check_script(const check_script_t *script);
+static int check_backoff();
+static int check_percentile();
+static void init(wifi_conn_t *conn, wifi_conn_cache_t *cache, check_cache_t kind);
+static int64_t utc(int64_t now_us);
+static uint32_t rnd();
+
+/* Global variables */
+static const wifi_conn_config_t check_config = WIFI_CONN_CONFIG_DEFAULT();
+static const uint8_t check_bssids[2][6] =
+{
+  { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 },
+  { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x02 }
+};
+static const uint8_t check_channels[2] = { 6, 11 };
+static uint32_t check_seed = 1;
+
+// Directed connects are given up after attempt_ms, the first backoff is
+// half of retry_base_ms with no jitter, the next one all of it.
+#define ATTEMPT   WIFI_CONN_ATTEMPT_MS
+#define WAIT1     (WIFI_CONN_RETRY_BASE_MS / 2)
+#define WAIT2     WIFI_CONN_RETRY_BASE_MS
+#define RENEW_MS  ((WIFI_CONN_LEASE_S - CHECK_FRESH_S) * 1000)
+
+static const check_step_t script_cold[] =
+{
+  { 0,    EV_START, 0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 1500, EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_SCAN, ATTEMPT - 1500 },
+  { 1000, EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+// The cached address is reused, then renewed by DHCP when its lease is
+// 'lease_s' old.
+static const check_step_t script_reuse[] =
+{
+  { 0,         EV_START, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 200,       EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_FAST, ATTEMPT - 200 },
+  { 800,       EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   RENEW_MS - 1000 },
+  { 60000,     EV_STEP,  0, WIFI_CONN_NONE,    WIFI_CONN_UP,   RENEW_MS - 61000 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_DHCP, WIFI_CONN_UP,   CHECK_NEVER },
+  { 1500,      EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+// A lease 'lease_s' old is not reused: the directed connect runs DHCP.
+static const check_step_t script_expired[] =
+{
+  { 0,    EV_START, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 200,  EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_FAST, ATTEMPT - 200 },
+  { 1800, EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+static const check_step_t script_fallback[] =
+{
+  { 0,    EV_START, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 3000, EV_DOWN,  0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 2000, EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_SCAN, ATTEMPT - 2000 },
+  { 1000, EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+// Without the wall clock the lease's age is unknown: not reused.
+static const check_step_t script_no_clock[] =
+{
+  { 0,    EV_START, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 200,  EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_FAST, ATTEMPT - 200 },
+  { 1800, EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+// The scan finds another AP of the network: its address is not reused.
+static const check_step_t script_moved[] =
+{
+  { 0,    EV_START, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 3000, EV_DOWN,  0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 2000, EV_ASSOC, 1, WIFI_CONN_NONE,    WIFI_CONN_SCAN, ATTEMPT - 2000 },
+  { 1000, EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+static const check_step_t script_no_ap[] =
+{
+  { 0,         EV_START, 0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 4000,      EV_DOWN,  0, WIFI_CONN_NONE,    WIFI_CONN_WAIT, WAIT1 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 4000,      EV_DOWN,  0, WIFI_CONN_NONE,    WIFI_CONN_WAIT, WAIT2 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 3000,      EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_SCAN, ATTEMPT - 3000 },
+  { 500,       EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+// Failed fast and scan: the retry after the backoff is directed again.
+static const check_step_t script_retry_fast[] =
+{
+  { 0,         EV_START, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 3000,      EV_DOWN,  0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 4000,      EV_DOWN,  0, WIFI_CONN_NONE,    WIFI_CONN_WAIT, WAIT1 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 200,       EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_FAST, ATTEMPT - 200 },
+  { 300,       EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_ANY }
+};
+
+// Associated on the reused address but no traffic: aborted at attempt_ms,
+// the address is dropped from the cache and the retry runs DHCP.
+static const check_step_t script_timeout[] =
+{
+  { 0,         EV_START, 0, WIFI_CONN_DO_FAST,  WIFI_CONN_FAST, ATTEMPT },
+  { 200,       EV_ASSOC, 0, WIFI_CONN_NONE,     WIFI_CONN_FAST, ATTEMPT - 200 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_ABORT, WIFI_CONN_WAIT, WAIT1 },
+  { 50,        EV_DOWN,  0, WIFI_CONN_NONE,     WIFI_CONN_WAIT, WAIT1 - 50 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_FAST,  WIFI_CONN_FAST, ATTEMPT },
+  { 200,       EV_ASSOC, 0, WIFI_CONN_NONE,     WIFI_CONN_FAST, ATTEMPT - 200 },
+  { 1800,      EV_UP,    0, WIFI_CONN_NONE,     WIFI_CONN_UP,   CHECK_NEVER }
+};
+
+// A drop inside stable_ms is backed off from, one after it is retried at
+// once with the backoff started over.
+static const check_step_t script_drops[] =
+{
+  { 0,         EV_START, 0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 3000,      EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_SCAN, ATTEMPT - 3000 },
+  { 1000,      EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_NEVER },
+  { 5000,      EV_DOWN,  0, WIFI_CONN_NONE,    WIFI_CONN_WAIT, WAIT1 },
+  { CHECK_DUE, EV_STEP,  0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 200,       EV_ASSOC, 0, WIFI_CONN_NONE,    WIFI_CONN_FAST, ATTEMPT - 200 },
+  { 300,       EV_UP,    0, WIFI_CONN_NONE,    WIFI_CONN_UP,   CHECK_ANY },
+  { WIFI_CONN_STABLE_MS, EV_DOWN, 0, WIFI_CONN_DO_FAST, WIFI_CONN_FAST, ATTEMPT },
+  { 3000,      EV_DOWN,  0, WIFI_CONN_DO_SCAN, WIFI_CONN_SCAN, ATTEMPT },
+  { 4000,      EV_DOWN,  0, WIFI_CONN_NONE,    WIFI_CONN_WAIT, WAIT1 }
+};
+
+#define SCRIPT(s)  s, sizeof(s) / sizeof(s[0])
+
+static const check_script_t check_scripts[] =
+{
+  { "cold", CACHE_NONE, 0, SCRIPT(script_cold),
+    { .attempts = 1, .scan_ok = 1 }, CHECK_IP_DHCP, 0 },
+  { "reuse", CACHE_FRESH, 0, SCRIPT(script_reuse),
+    { .attempts = 1, .fast_attempts = 1, .fast_ok = 1, .ip_reused = 1 }, CHECK_IP_DHCP, 0 },
+  { "expired", CACHE_STALE, 0, SCRIPT(script_expired),
+    { .attempts = 1, .fast_attempts = 1, .fast_ok = 1 }, CHECK_IP_DHCP, 0 },
+  { "no_clock", CACHE_FRESH, 1, SCRIPT(script_no_clock),
+    { .attempts = 1, .fast_attempts = 1, .fast_ok = 1 }, CHECK_IP_DHCP, 0 },
+  { "fallback", CACHE_FRESH, 0, SCRIPT(script_fallback),
+    { .attempts = 2, .fast_attempts = 1, .scan_ok = 1, .failures = 1 }, CHECK_IP_DHCP, 0 },
+  { "moved", CACHE_FRESH, 0, SCRIPT(script_moved),
+    { .attempts = 2, .fast_attempts = 1, .scan_ok = 1, .failures = 1 }, CHECK_IP_DHCP, 1 },
+  { "no_ap", CACHE_NONE, 0, SCRIPT(script_no_ap),
+    { .attempts = 3, .scan_ok = 1, .failures = 2 }, CHECK_IP_DHCP, 0 },
+  { "retry_fast", CACHE_FRESH, 0, SCRIPT(script_retry_fast),
+    { .attempts = 3, .fast_attempts = 2, .fast_ok = 1, .ip_reused = 1, .failures = 2 }, CHECK_IP_OLD, 0 },
+  { "timeout", CACHE_FRESH, 0, SCRIPT(script_timeout),
+    { .attempts = 2, .fast_attempts = 2, .fast_ok = 1, .failures = 1, .timeouts = 1 }, CHECK_IP_DHCP, 0 },
+  { "drops", CACHE_NONE, 0, SCRIPT(script_drops),
+    { .attempts = 4, .fast_attempts = 2, .fast_ok = 1, .scan_ok = 1, .ip_reused = 1, .failures = 2,
+      .drops = 2 }, CHECK_IP_DHCP, 0 }
+};
+
+
+
+int main(int argc, char **argv)
+{
+  int failed = 0;
+  size_t i;
+
+  for(i = 0; i < sizeof(check_scripts) / sizeof(check_scripts[0]); i++)
+    failed |= check_script(&check_scripts[i]);
+  failed |= check_backoff();
+  failed |= check_percentile();
+
+  return failed;
+}
+
+
+/*
+* @brief Runs a script and checks every step and the end state.
+*/
+static int check_script(const check_script_t *script)
+{
+  const check_step_t *step;
+  const wifi_conn_stats_t *want = &script->want;
+  wifi_conn_t conn;
+  wifi_conn_cache_t cache;
+  wifi_conn_stats_t stats;
+  wifi_conn_action_t action;
+  int64_t now = 0;
+  int64_t wall;
+  int64_t due;
+  uint32_t off = 0;
+  size_t i;
+  int ok;
+
+  init(&conn, &cache, script->cache);
+
+  for(i = 0; i < script->num_steps; i++)
+  {
+    step = &script->steps[i];
+    if(step->after_ms == CHECK_DUE)
+      now = wifi_conn_next(&conn);
+    else
+      now += (int64_t) step->after_ms * 1000;
+
+    wall = script->no_clock ? 0 : utc(now);
+    action = WIFI_CONN_NONE;
+    switch(step->event)
+    {
+      case EV_START: action = wifi_conn_start(&conn, now, wall); break;
+      case EV_ASSOC: wifi_conn_associated(&conn, check_bssids[step->ap], check_channels[step->ap]); break;
+      case EV_UP:    wifi_conn_up(&conn, now, wall, CHECK_IP_DHCP, CHECK_NETMASK, CHECK_GW); break;
+      case EV_DOWN:  action = wifi_conn_down(&conn, now, wall, 0); break;
+      case EV_STEP:  action = wifi_conn_step(&conn, now, wall, 0); break;
+    }
+
+    due = wifi_conn_next(&conn);
+    if(action != step->action || conn.state != step->state ||
+       (step->due_ms == CHECK_NEVER && due != WIFI_CONN_NEVER) ||
+       (step->due_ms >= 0 && due != now + (int64_t) step->due_ms * 1000))
+    {
+      fprintf(stderr, "%s: step %zu: action %d state %d due %lld ms, want %d %d %d\n", script->name, i,
+              action, conn.state, (due == WIFI_CONN_NEVER) ? -1LL : (long long) (due - now) / 1000,
+              step->action, step->state, step->due_ms);
+      off++;
+    }
+  }
+
+  wifi_conn_get_stats(&conn, now, &stats);
+  ok = off == 0 && stats.attempts == want->attempts && stats.fast_attempts == want->fast_attempts &&
+       stats.fast_ok == want->fast_ok && stats.scan_ok == want->scan_ok && stats.ip_reused == want->ip_reused &&
+       stats.failures == want->failures && stats.timeouts == want->timeouts && stats.drops == want->drops &&
+       cache.valid && cache.ip == script->want_ip &&
+       memcmp(cache.bssid, check_bssids[script->want_ap], sizeof(cache.bssid)) == 0 &&
+       cache.channel == check_channels[script->want_ap];
+
+  printf("{\"test\":\"wifi_conn_check\",\"script\":\"%s\",\"steps\":%zu,\"off\":%u,\"attempts\":%u,"
+         "\"fast_attempts\":%u,\"fast_ok\":%u,\"scan_ok\":%u,\"ip_reused\":%u,\"failures\":%u,\"timeouts\":%u,"
+         "\"drops\":%u,\"ok\":%d}\n",
+         script->name, script->num_steps, off, stats.attempts, stats.fast_attempts, stats.fast_ok,
+         stats.scan_ok, stats.ip_reused, stats.failures, stats.timeouts, stats.drops, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Scans that keep failing, with jitter.
+*/
+static int check_backoff()
+{
+  wifi_conn_t conn;
+  wifi_conn_cache_t cache;
+  wifi_conn_action_t action;
+  uint32_t delay_ms = check_config.retry_base_ms;
+  uint32_t wait_ms;
+  uint32_t max_wait_ms = 0;
+  uint32_t bad = 0;
+  int64_t now = 0;
+  int k;
+  int ok;
+
+  init(&conn, &cache, CACHE_NONE);
+  if(wifi_conn_start(&conn, now, utc(now)) != WIFI_CONN_DO_SCAN)
+    bad++;
+
+  for(k = 0; k < CHECK_FAILURES; k++)
+  {
+    now += 4000000;
+    if(wifi_conn_down(&conn, now, utc(now), rnd()) != WIFI_CONN_NONE || conn.state != WIFI_CONN_WAIT)
+      bad++;
+
+    wait_ms = (uint32_t) ((wifi_conn_next(&conn) - now) / 1000);
+    if(wait_ms < delay_ms / 2 || wait_ms > delay_ms)
+      bad++;
+    if(wait_ms > max_wait_ms)
+      max_wait_ms = wait_ms;
+    delay_ms = (delay_ms > check_config.retry_max_ms / 2) ? check_config.retry_max_ms : delay_ms * 2;
+
+    // Nothing before the wait is over.
+    if(wifi_conn_step(&conn, wifi_conn_next(&conn) - 1, 0, rnd()) != WIFI_CONN_NONE)
+      bad++;
+    now = wifi_conn_next(&conn);
+    action = wifi_conn_step(&conn, now, utc(now), rnd());
+    if(action != WIFI_CONN_DO_SCAN || conn.state != WIFI_CONN_SCAN)
+      bad++;
+  }
+
+  // The delay reached the cap and stayed there.
+  ok = bad == 0 && delay_ms == check_config.retry_max_ms && max_wait_ms > check_config.retry_max_ms / 2;
+  printf("{\"test\":\"wifi_conn_check\",\"check\":\"backoff\",\"failures\":%d,\"max_wait_ms\":%u,\"bad\":%u,"
+         "\"ok\":%d}\n", CHECK_FAILURES, max_wait_ms, bad, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Connect time percentiles over the last WIFI_CONN_SAMPLES.
+*/
+static int check_percentile()
+{
+  wifi_conn_t conn;
+  wifi_conn_cache_t cache;
+  wifi_conn_stats_t stats;
+  uint32_t lengths[CHECK_CONNECTS];
+  uint32_t sorted[WIFI_CONN_SAMPLES];
+  uint32_t v;
+  uint32_t bad = 0;
+  int64_t now = 0;
+  int i;
+  int j;
+  int ok;
+
+  // 500 ms to 4.4 s in a shuffled order.
+  for(i = 0; i < CHECK_CONNECTS; i++)
+    lengths[i] = 500 + (uint32_t) ((i * 17) % CHECK_CONNECTS) * 100;
+
+  init(&conn, &cache, CACHE_NONE);
+  for(i = 0; i < CHECK_CONNECTS; i++)
+  {
+    if(i == 0)
+      wifi_conn_start(&conn, now, utc(now));
+    else
+    {
+      now += (int64_t) check_config.stable_ms * 1000;
+      if(wifi_conn_down(&conn, now, utc(now), rnd()) != WIFI_CONN_DO_FAST)
+        bad++;
+    }
+    wifi_conn_associated(&conn, check_bssids[0], check_channels[0]);
+    now += (int64_t) lengths[i] * 1000;
+    wifi_conn_up(&conn, now, utc(now), CHECK_IP_DHCP, CHECK_NETMASK, CHECK_GW);
+  }
+
+  // The last WIFI_CONN_SAMPLES, sorted.
+  memcpy(sorted, &lengths[CHECK_CONNECTS - WIFI_CONN_SAMPLES], sizeof(sorted));
+  for(i = 1; i < WIFI_CONN_SAMPLES; i++)
+  {
+    v = sorted[i];
+    for(j = i; j > 0 && sorted[j - 1] > v; j--)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = v;
+  }
+
+  wifi_conn_get_stats(&conn, now, &stats);
+  ok = bad == 0 && stats.connect_p50_ms == sorted[WIFI_CONN_SAMPLES / 2] &&
+       stats.connect_p90_ms == sorted[WIFI_CONN_SAMPLES * 9 / 10] &&
+       stats.connect_max_ms == sorted[WIFI_CONN_SAMPLES - 1] &&
+       stats.attempts_per_h == (uint32_t) ((uint64_t) CHECK_CONNECTS * 3600000000ULL / now);
+
+  printf("{\"test\":\"wifi_conn_check\",\"check\":\"percentile\",\"connects\":%d,\"p50_ms\":%u,\"p90_ms\":%u,"
+         "\"max_ms\":%u,\"want_p50_ms\":%u,\"want_p90_ms\":%u,\"attempts_per_h\":%u,\"ok\":%d}\n",
+         CHECK_CONNECTS, stats.connect_p50_ms, stats.connect_p90_ms, stats.connect_max_ms,
+         sorted[WIFI_CONN_SAMPLES / 2], sorted[WIFI_CONN_SAMPLES * 9 / 10], stats.attempts_per_h, ok);
+
+  return ok ? 0 : 1;
+}
+
+
+/*
+* @brief Sets the policy up at time 0 with the given cache.
+*/
+static void init(wifi_conn_t *conn, wifi_conn_cache_t *cache, check_cache_t kind)
+{
+  memset(cache, 0, sizeof(*cache));
+  if(kind != CACHE_NONE)
+  {
+    cache->valid = 1;
+    memcpy(cache->bssid, check_bssids[0], sizeof(cache->bssid));
+    cache->channel = check_channels[0];
+    cache->ip = CHECK_IP_OLD;
+    cache->netmask = CHECK_NETMASK;
+    cache->gw = CHECK_GW;
+    cache->lease_utc_s = CHECK_UTC0_S - ((kind == CACHE_FRESH) ? CHECK_FRESH_S : check_config.lease_s);
+  }
+
+  wifi_conn_init(conn, &check_config, cache, 0);
+}
+
+
+/*
+* @brief Wall clock in s at a time.
+*/
+static int64_t utc(int64_t now_us)
+{
+  return CHECK_UTC0_S + now_us / 1000000;
+}
+
+
+/*
+* @brief xorshift32
+*/
+static uint32_t rnd()
+{
+  check_seed ^= check_seed << 13;
+  check_seed ^= check_seed >> 17;
+  check_seed ^= check_seed << 5;
+
+  return check_seed;
+}
@@ -0,0 +1,99 @@
+/*
+*	trace_decode.c
+*
+*	Last Modified: October 17, 2026
+*	 Author: Trenton Taylor
+*
+*/
+
+/*
+*   Expands a RAM dump of the trace rings (trace.h) on the host, as
+*   vTrace_task would on the node: the rings of every core, merged into
+*   time order and formatted with trace_format(). For a node that crashed
+*   or hung before vTrace_task got to them, or one built with TRACE_PRINT 0.
+*
+*   The dump is the trace_rings array of trace_esp.c, one trace_ring_t per
+*   core back to back, e.g. with the address of trace_rings from the ELF:
+*     esptool.py dump_mem ADDRESS SIZE rings.bin
+*   The ring has fixed size fields and no pointers, so it is laid out the
+*   same on the ESP32 as on a little endian host. Entries that were being
+*   written or had been overwritten when the dump was taken are counted as
+*   lost.
+*
+*   Usage: trace_decode DUMP [CORES]   (default 2)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+
+#define DECODE_MAX_CORES  2
+
+
+int main(int argc, char **argv)
+{
+  static trace_ring_t rings[DECODE_MAX_CORES];
+  static trace_entry_t entries[DECODE_MAX_CORES][TRACE_RING_SIZE];
+  size_t count[DECODE_MAX_CORES] = { 0 };
+  size_t next[DECODE_MAX_CORES] = { 0 };
+  uint32_t lost = 0;
+  uint32_t total = 0;
+  char line[128];
+  size_t cores = DECODE_MAX_CORES;
+  size_t c;
+  size_t best;
+  FILE *f;
+
+  if(argc < 2)
+  {
+    fprintf(stderr, "usage: %s dump [cores]\n", argv[0]);
+    return 2;
+  }
+  if(argc > 2)
+    cores = strtoul(argv[2], NULL, 0);
+  if(cores == 0 || cores > DECODE_MAX_CORES)
+  {
+    fprintf(stderr, "1 to %d cores\n", DECODE_MAX_CORES);
+    return 2;
+  }
+
+  f = fopen(argv[1], "rb");
+  if(f == NULL || fread(rings, sizeof(trace_ring_t), cores, f) != cores)
+  {
+    fprintf(stderr, "cannot read %zu rings from %s\n", cores, argv[1]);
+    return 1;
+  }
+  fclose(f);
+
+  // Everything still in the ring, whatever the node had already read.
+  for(c = 0; c < cores; c++)
+  {
+    rings[c].tail = rings[c].head - ((rings[c].head > TRACE_RING_SIZE) ? TRACE_RING_SIZE : rings[c].head);
+    rings[c].lost = 0;
+    count[c] = trace_ring_drain(&rings[c], entries[c], TRACE_RING_SIZE);
+    lost += rings[c].lost;
+    total += count[c];
+  }
+
+  // Merge by time, the low 32 bits wrap every 71 minutes.
+  for(;;)
+  {
+    best = cores;
+    for(c = 0; c < cores; c++)
+    {
+      if(next[c] < count[c] &&
+         (best == cores || (int32_t) (entries[c][next[c]].time_us - entries[best][next[best]].time_us) < 0))
+        best = c;
+    }
+    if(best == cores)
+      break;
+
+    entries[best][next[best]].core = best;
+    trace_format(&entries[best][next[best]], line, sizeof(line));
+    puts(line);
+    next[best]++;
+  }
+
+  fprintf(stderr, "%u entries, %u lost\n", total, lost);
+  return 0;
+}
@@ -7,7 +7,7 @@
    CONDITIONS OF ANY KIND, either express or implied.
 
 
-  Last Modified: October 6, 2018
+  Last Modified: October 17, 2026
 */
 /*
 #include <string.h>
@@ -28,10 +28,26 @@
 
 #include "internet_if.h"
 #include "pm_if.h"
+#include "uplink.h"
+#include "sdlog.h"
+#include "duty.h"
+#include "power.h"
+#include "sensor.h"
+#include "hdc1080.h"
+#include "mics.h"
+#include "gps.h"
+#include "timesync.h"
+#include "trace.h"
+#include "settings.h"
+#include "ble_prov.h"
+#include "ble_data.h"
 
 /* Global constants */
+static const char *TAG_MAIN = "MAIN";
 
 /* Global vairables */
+static sdlog_t sd_backlog;
+static settings_t settings;         // As at boot; the uplink keeps a pointer to the URL
 
 
 /* Function prototypes */
@@ -49,9 +65,75 @@
 */
 void app_main()
 {
+  uplink_config_t uplink_config = UPLINK_CONFIG_DEFAULT();
+  duty_config_t duty_config = DUTY_CONFIG_DEFAULT();
+  pm_power_config_t pm_power = { 0, 0, PM_POWER_SETTLE_MS, PM_POWER_QUERY_MS };
+  settings_stats_t settings_stats;
+  uint8_t provision;
+
   esp_log_level_set(TAG_PM, ESP_LOG_INFO);
 
-  PM_init();
+  // Hot paths log through the trace rings; this prints them at idle priority.
+  trace_init();
+
+  // Scale between 80 and 160 MHz and light sleep when idle; subsystems
+  // take power locks while they need more.
+  power_init();
+
+  // UTC for every sample: GPS PPS/NMEA, else SNTP, else what the RTC kept.
+  timesync_init();
+
+  // Credentials, endpoint, periods and sensors from NVS, read once here;
+  // from now on only the RAM copy is used.
+  settings_init();
+  settings_get(&settings);
+  settings_get_stats(&settings_stats);
+  provision = BLE_PROV_ENABLED && settings_stats.source == SETTINGS_FROM_DEFAULTS;
+
+  // Sample, store in RTC memory and deep sleep; never returns.
+  if(settings.duty)
+  {
+    duty_config.period_s = settings.duty_period_s;
+    duty_config.uplink_every = settings.duty_uplink_every;
+    duty_config.url = settings.url;
+    duty_run(&duty_config);
+  }
+
+  pm_power.period_s = settings.pm_period_s;
+  pm_power.measure_s = settings.pm_measure_s;
+  PM_set_power(&pm_power);
+  // Without the PM sensor the node still has its other sensors to report.
+  if(PM_init() != ESP_OK)
+    ESP_LOGE(TAG_MAIN, "PM sensor not started");
+  hdc1080_i2c_start();
+  if(settings.sensors & SETTINGS_MICS)
+    mics_start();
+  if(settings.sensors & SETTINGS_GPS)
+    gps_start();
+  // A provisioned node keeps the history a phone can pull over BLE.
+  if(BLE_DATA_ENABLED && !provision)
+    ble_data_init();
+  sensor_start();
+
+  // Connects in the background, fast from the cached AP after the first time.
+  wifi_start_sta();
+
+  // Never provisioned: take credentials over BLE until connected with them.
+  // Otherwise BLE serves sensor data, or its memory is only wanted as heap.
+  if(provision)
+    ble_prov_start();
+  else if(BLE_DATA_ENABLED)
+    ble_data_start();
+  else
+    ble_prov_release();
+
+  // The SD card is optional, without it the uplink only buffers in RAM.
+  if(sdlog_sdmmc_mount(&sd_backlog) == ESP_OK)
+    uplink_config.backlog = &sd_backlog;
+  uplink_config.url = settings.url;
+  uplink_config.flush_interval_s = settings.flush_interval_s;
+  uplink_config.flush_samples = settings.flush_samples;
+  uplink_init(&uplink_config);
 
 
 }